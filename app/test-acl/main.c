@@ -41,6 +41,11 @@
 #define	OPT_ITER_NUM		"iter"
 #define	OPT_VERBOSE		"verbose"
 #define	OPT_IPV6		"ipv6"
+#define	OPT_MAX_TRIES		"maxtries"
+#define	OPT_NODE_MAX		"nodemax"
+#define	OPT_NODE_MIN		"nodemin"
+#define	OPT_WILD_LIMIT		"wildlimit"
+#define	OPT_STUDY		"study"
 
 #define	TRACE_DEFAULT_NUM	0x10000
 #define	TRACE_STEP_MAX		0x1000
@@ -81,6 +86,16 @@ static const struct acl_alg acl_alg[] = {
 		.name = "altivec",
 		.alg = RTE_ACL_CLASSIFY_ALTIVEC,
 	},
+	{
+		.name = "avx512",
+		.alg = RTE_ACL_CLASSIFY_AVX512,
+	},
+};
+
+/* run the search with each method supported by the CPU in turn */
+static const struct acl_alg acl_alg_all = {
+	.name = "all",
+	.alg = RTE_ACL_CLASSIFY_NUM,
 };
 
 static struct {
@@ -97,7 +112,10 @@ static struct {
 	uint32_t            iter_num;
 	uint32_t            verbose;
 	uint32_t            ipv6;
+	uint32_t            study;
 	struct acl_alg      alg;
+	struct rte_acl_build_param bld_param;
+	struct rte_acl_config bld_cfg;
 	uint32_t            used_traces;
 	void               *traces;
 	struct rte_acl_ctx *acx;
@@ -753,36 +771,65 @@ add_cb_rules(FILE *f, struct rte_acl_ctx *ctx)
 	return 0;
 }
 
+static void
+dump_build_stats(void)
+{
+	uint32_t i;
+	struct rte_acl_build_stats st;
+
+	if (rte_acl_get_ctx_build_stats(config.acx, &st) != 0)
+		return;
+
+	dump_verbose(DUMP_NONE, stdout,
+		"build stats: %u tries, node limit: %u, build nodes: %u, "
+		"build memory: %zu\n"
+		"run-time nodes dfa/quad/single/match: %u/%u/%u/%u, "
+		"run-time memory: %zu, classify cost: %u transitions\n",
+		st.num_tries, st.node_limit, st.num_nodes, st.build_mem,
+		st.num_dfa, st.num_quad, st.num_single, st.num_match,
+		st.rt_mem, st.classify_cost);
+
+	for (i = 0; i != st.num_tries; i++)
+		dump_verbose(DUMP_SEARCH, stdout, "trie %u: %u rules\n",
+			i, st.trie_rules[i]);
+}
+
 static void
 acx_init(void)
 {
 	int ret;
 	FILE *f;
-	struct rte_acl_config cfg;
+	struct rte_acl_config *cfg;
 
-	memset(&cfg, 0, sizeof(cfg));
+	cfg = &config.bld_cfg;
+	memset(cfg, 0, sizeof(*cfg));
 
 	/* setup ACL build config. */
 	if (config.ipv6) {
-		cfg.num_fields = RTE_DIM(ipv6_defs);
-		memcpy(&cfg.defs, ipv6_defs, sizeof(ipv6_defs));
+		cfg->num_fields = RTE_DIM(ipv6_defs);
+		memcpy(&cfg->defs, ipv6_defs, sizeof(ipv6_defs));
 	} else {
-		cfg.num_fields = RTE_DIM(ipv4_defs);
-		memcpy(&cfg.defs, ipv4_defs, sizeof(ipv4_defs));
+		cfg->num_fields = RTE_DIM(ipv4_defs);
+		memcpy(&cfg->defs, ipv4_defs, sizeof(ipv4_defs));
 	}
-	cfg.num_categories = config.bld_categories;
-	cfg.max_size = config.max_size;
+	cfg->num_categories = config.bld_categories;
+	cfg->max_size = config.max_size;
 
 	/* setup ACL creation parameters. */
-	prm.rule_size = RTE_ACL_RULE_SZ(cfg.num_fields);
+	prm.rule_size = RTE_ACL_RULE_SZ(cfg->num_fields);
 	prm.max_rule_num = config.nb_rules;
 
 	config.acx = rte_acl_create(&prm);
 	if (config.acx == NULL)
 		rte_exit(rte_errno, "failed to create ACL context\n");
 
+	ret = rte_acl_set_ctx_build_param(config.acx, &config.bld_param);
+	if (ret != 0)
+		rte_exit(-ret, "invalid ACL build parameters\n");
+
 	/* set default classify method for this context. */
-	if (config.alg.alg != RTE_ACL_CLASSIFY_DEFAULT) {
+	if (config.alg.alg != RTE_ACL_CLASSIFY_DEFAULT &&
+			config.alg.alg != acl_alg_all.alg) {
 		ret = rte_acl_set_ctx_classify(config.acx, config.alg.alg);
 		if (ret != 0)
 			rte_exit(ret, "failed to setup %s method "
@@ -801,14 +848,19 @@ acx_init(void)
 
 	fclose(f);
 
+	/* no need to build with the default parameters for a study */
+	if (config.study != 0)
+		return;
+
 	/* perform build. */
-	ret = rte_acl_build(config.acx, &cfg);
+	ret = rte_acl_build(config.acx, cfg);
 
 	dump_verbose(DUMP_NONE, stdout,
 		"rte_acl_build(%u) finished with %d\n",
 		config.bld_categories, ret);
 
 	rte_acl_dump(config.acx);
+	dump_build_stats();
 
 	if (ret != 0)
 		rte_exit(ret, "failed to build search context\n");
@@ -874,9 +926,10 @@ search_ip5tuples(__attribute__((unused)) void *arg)
 
 	tm = rte_rdtsc() - start;
 	dump_verbose(DUMP_NONE, stdout,
-		"%s  @lcore %u: %" PRIu32 " iterations, %" PRIu64 " pkts, %"
+		"%s(%s)  @lcore %u: %" PRIu32 " iterations, %" PRIu64 " pkts, %"
 		PRIu32 " categories, %" PRIu64 " cycles, %#Lf cycles/pkt\n",
-		__func__, lcore, i, pkt, config.run_categories,
+		__func__, config.alg.name, lcore, i, pkt,
+		config.run_categories,
 		tm, (pkt == 0) ? 0 : (long double)tm / pkt);
 
 	return 0;
@@ -908,6 +961,11 @@ get_alg_opt(const char *opt, const char *name)
 		}
 	}
 
+	if (strcmp(opt, acl_alg_all.name) == 0) {
+		config.alg = acl_alg_all;
+		return;
+	}
+
 	rte_exit(-EINVAL, "invalid value: \"%s\" for option: %s\n",
 		opt, name);
 }
@@ -921,7 +979,7 @@ print_usage(const char *prgname)
 	n = 0;
 	buf[0] = 0;
 
-	for (i = 0; i < RTE_DIM(acl_alg) - 1; i++) {
+	for (i = 0; i < RTE_DIM(acl_alg); i++) {
 		rc = snprintf(buf + n, sizeof(buf) - n, "%s|",
 			acl_alg[i].name);
 		if (rc > sizeof(buf) - n)
@@ -929,7 +987,7 @@ print_usage(const char *prgname)
 		n += rc;
 	}
 
-	strlcpy(buf + n, acl_alg[i].name, sizeof(buf) - n);
+	strlcpy(buf + n, acl_alg_all.name, sizeof(buf) - n);
 
 	fprintf(stdout,
 		PRINT_USAGE_START
@@ -953,7 +1011,20 @@ print_usage(const char *prgname)
 		"[--" OPT_ITER_NUM "=<number of iterations to perform>]\n"
 		"[--" OPT_VERBOSE "=<verbose level>]\n"
 		"[--" OPT_SEARCH_ALG "=%s]\n"
-		"[--" OPT_IPV6 "=<IPv6 rules and trace files>]\n",
+		"[--" OPT_IPV6 "=<IPv6 rules and trace files>]\n"
+		"[--" OPT_MAX_TRIES
+			"=<maximum number of tries to build>]\n"
+		"[--" OPT_NODE_MAX
+			"=<node limit of the first build attempt with "
+			OPT_MAX_SIZE ">]\n"
+		"[--" OPT_NODE_MIN
+			"=<node limit without " OPT_MAX_SIZE
+			", lowest one with it>]\n"
+		"[--" OPT_WILD_LIMIT
+			"=<wildness percentage of the rules to build "
+			"in separate tries>]\n"
+		"[--" OPT_STUDY "=<build with a range of build parameters "
+			"and report statistics and performance of each>]\n",
 		prgname, RTE_ACL_RESULTS_MULTIPLIER,
 		(uint32_t)RTE_ACL_MAX_CATEGORIES,
 		buf);
@@ -976,6 +1047,11 @@ dump_config(FILE *f)
 	fprintf(f, "%s:%u(%s)\n", OPT_SEARCH_ALG, config.alg.alg,
 		config.alg.name);
 	fprintf(f, "%s:%u\n", OPT_IPV6, config.ipv6);
+	fprintf(f, "%s:%u\n", OPT_MAX_TRIES, config.bld_param.max_tries);
+	fprintf(f, "%s:%u\n", OPT_NODE_MAX, config.bld_param.node_max);
+	fprintf(f, "%s:%u\n", OPT_NODE_MIN, config.bld_param.node_min);
+	fprintf(f, "%s:%u\n", OPT_WILD_LIMIT, config.bld_param.wild_limit);
+	fprintf(f, "%s:%u\n", OPT_STUDY, config.study);
 }
 
 static void
@@ -1005,6 +1081,11 @@ get_input_opts(int argc, char **argv)
 		{OPT_VERBOSE, 1, 0, 0},
 		{OPT_SEARCH_ALG, 1, 0, 0},
 		{OPT_IPV6, 0, 0, 0},
+		{OPT_MAX_TRIES, 1, 0, 0},
+		{OPT_NODE_MAX, 1, 0, 0},
+		{OPT_NODE_MIN, 1, 0, 0},
+		{OPT_WILD_LIMIT, 1, 0, 0},
+		{OPT_STUDY, 0, 0, 0},
 		{NULL, 0, 0, 0}
 	};
 
@@ -1054,6 +1135,21 @@ get_input_opts(int argc, char **argv)
 			get_alg_opt(optarg, lgopts[opt_idx].name);
 		} else if (strcmp(lgopts[opt_idx].name, OPT_IPV6) == 0) {
 			config.ipv6 = 1;
+		} else if (strcmp(lgopts[opt_idx].name, OPT_MAX_TRIES) == 0) {
+			config.bld_param.max_tries = get_ulong_opt(optarg,
+				lgopts[opt_idx].name, 1, RTE_ACL_MAX_TRIES);
+		} else if (strcmp(lgopts[opt_idx].name, OPT_NODE_MAX) == 0) {
+			config.bld_param.node_max = get_ulong_opt(optarg,
+				lgopts[opt_idx].name, 1, INT32_MAX);
+		} else if (strcmp(lgopts[opt_idx].name, OPT_NODE_MIN) == 0) {
+			config.bld_param.node_min = get_ulong_opt(optarg,
+				lgopts[opt_idx].name, 1, INT32_MAX);
+		} else if (strcmp(lgopts[opt_idx].name,
+				OPT_WILD_LIMIT) == 0) {
+			config.bld_param.wild_limit = get_ulong_opt(optarg,
+				lgopts[opt_idx].name, 1, 100);
+		} else if (strcmp(lgopts[opt_idx].name, OPT_STUDY) == 0) {
+			config.study = 1;
 		}
 	}
 	config.trace_sz = config.ipv6 ? sizeof(struct ipv6_5tuple) :
@@ -1061,11 +1157,121 @@ get_input_opts(int argc, char **argv)
 
 }
 
+static void
+search_all_lcores(void)
+{
+	uint32_t lcore;
+
+	RTE_LCORE_FOREACH_SLAVE(lcore)
+		 rte_eal_remote_launch(search_ip5tuples, NULL, lcore);
+
+	search_ip5tuples(NULL);
+
+	rte_eal_mp_wait_lcore();
+}
+
+/*
+ * Run the same search with each classify method supported by the CPU,
+ * to compare their performance.
+ */
+static void
+search_all_algs(void)
+{
+	uint32_t i;
+	int ret;
+
+	for (i = 0; i != RTE_DIM(acl_alg); i++) {
+		ret = rte_acl_set_ctx_classify(config.acx, acl_alg[i].alg);
+		if (ret != 0) {
+			dump_verbose(DUMP_NONE, stdout,
+				"%s method is not supported, skipping\n",
+				acl_alg[i].name);
+			continue;
+		}
+
+		config.alg = acl_alg[i];
+		search_all_lcores();
+	}
+}
+
+/*
+ * Build the rules with the given build parameters, report the build
+ * statistics, the build time and, with a trace file, the classify time
+ * on the master lcore.
+ */
+static void
+study_build_one(const struct rte_acl_build_param *prm)
+{
+	struct rte_acl_build_stats st;
+	uint64_t bld_tm, pkt, tm;
+	uint32_t i;
+	int ret;
+
+	ret = rte_acl_set_ctx_build_param(config.acx, prm);
+	if (ret == 0) {
+		bld_tm = rte_rdtsc();
+		ret = rte_acl_build(config.acx, &config.bld_cfg);
+		bld_tm = rte_rdtsc() - bld_tm;
+	}
+
+	if (ret != 0) {
+		dump_verbose(DUMP_NONE, stdout, "%u,%#x,%u,%d\n",
+			prm->max_tries, prm->node_min, prm->wild_limit, ret);
+		return;
+	}
+
+	rte_acl_get_ctx_build_stats(config.acx, &st);
+
+	pkt = 0;
+	tm = rte_rdtsc();
+	for (i = 0; i != config.iter_num && config.traces != NULL; i++)
+		pkt += search_ip5tuples_once(config.run_categories,
+			config.trace_step, config.alg.name);
+	tm = rte_rdtsc() - tm;
+
+	dump_verbose(DUMP_NONE, stdout,
+		"%u,%#x,%u,%d,%u,%u,%zu,%zu,%u,%" PRIu64 ",%#Lf\n",
+		prm->max_tries, prm->node_min, prm->wild_limit, ret,
+		st.num_tries, st.num_nodes, st.build_mem, st.rt_mem,
+		st.classify_cost, bld_tm * US_PER_S / rte_get_tsc_hz(),
+		(pkt == 0) ? 0 : (long double)tm / pkt);
+}
+
+/*
+ * Sweep the maximum number of tries, the node limit and the wildness
+ * limit, to trade build memory against classify speed.
+ */
+static void
+study_build_params(void)
+{
+	static const uint32_t max_tries[] = {1, 2, 4, RTE_ACL_MAX_TRIES};
+	static const uint32_t node_limits[] = {0x200, 0x800, 0x2000, 0x8000};
+	static const uint32_t wild_limits[] = {0, 50, 75};
+	struct rte_acl_build_param prm;
+	uint32_t i, j, k;
+
+	dump_verbose(DUMP_NONE, stdout,
+		"maxtries,nodelimit,wildlimit,result,tries,build_nodes,"
+		"build_mem,rt_mem,classify_cost,build_us,cycles/pkt\n");
+
+	memset(&prm, 0, sizeof(prm));
+	for (i = 0; i != RTE_DIM(max_tries); i++) {
+		prm.max_tries = max_tries[i];
+		for (j = 0; j != RTE_DIM(node_limits); j++) {
+			prm.node_max = node_limits[j];
+			prm.node_min = node_limits[j];
+			for (k = 0; k != RTE_DIM(wild_limits); k++) {
+				prm.wild_limit = wild_limits[k];
+				study_build_one(&prm);
+			}
+		}
+	}
+}
+
 int
 main(int argc, char **argv)
 {
 	int ret;
-	uint32_t lcore;
 
 	ret = rte_eal_init(argc, argv);
 	if (ret < 0)
@@ -1085,12 +1291,12 @@ main(int argc, char **argv)
 	if (config.trace_file != NULL)
 		tracef_init();
 
-	RTE_LCORE_FOREACH_SLAVE(lcore)
-		 rte_eal_remote_launch(search_ip5tuples, NULL, lcore);
-
-	search_ip5tuples(NULL);
-
-	rte_eal_mp_wait_lcore();
+	if (config.study != 0)
+		study_build_params();
+	else if (config.alg.alg == acl_alg_all.alg)
+		search_all_algs();
+	else
+		search_all_lcores();
 
 	rte_acl_free(config.acx);
 	return 0;
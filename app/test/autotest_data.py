@@ -718,6 +718,30 @@
         "Func":    default_autotest,
         "Report":  None,
     },
+    {
+        "Name":    "Reorder perf autotest",
+        "Command": "reorder_perf_autotest",
+        "Func":    default_autotest,
+        "Report":  None,
+    },
+    {
+        "Name":    "GRO perf autotest",
+        "Command": "gro_perf_autotest",
+        "Func":    default_autotest,
+        "Report":  None,
+    },
+    {
+        "Name":    "GSO perf autotest",
+        "Command": "gso_perf_autotest",
+        "Func":    default_autotest,
+        "Report":  None,
+    },
+    {
+        "Name":    "IP fragmentation perf autotest",
+        "Command": "ip_frag_perf_autotest",
+        "Func":    default_autotest,
+        "Report":  None,
+    },
     {
         "Name":    "Red_perf",
         "Command": "red_perf",
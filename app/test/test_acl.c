@@ -4,6 +4,7 @@
 
 #include <string.h>
 #include <errno.h>
+#include <pthread.h>
 
 #include "test.h"
 
@@ -13,6 +14,9 @@
 #include <rte_ip.h>
 #include <rte_acl.h>
 #include <rte_common.h>
+#include <rte_lcore.h>
+#include <rte_malloc.h>
+#include <rte_rcu_qsbr.h>
 
 #include "test_acl.h"
 
@@ -266,13 +270,57 @@ rte_acl_ipv4vlan_build(struct rte_acl_ctx *ctx,
 }
 
 /*
- * Test scalar and SSE ACL lookup.
+ * Check allow and deny results of the first count test data entries.
+ */
+static int
+test_classify_check(const uint32_t *results, uint32_t count)
+{
+	uint32_t i, result;
+
+	/* check if we allow everything we should allow */
+	for (i = 0; i < count; i++) {
+		result = results[i * RTE_ACL_MAX_CATEGORIES + ACL_ALLOW];
+		if (result != acl_test_data[i].allow) {
+			printf("Line %i: Error in allow results at %i "
+				"(expected %"PRIu32" got %"PRIu32")!\n",
+				__LINE__, i, acl_test_data[i].allow,
+				result);
+			return -EINVAL;
+		}
+	}
+
+	/* check if we deny everything we should deny */
+	for (i = 0; i < count; i++) {
+		result = results[i * RTE_ACL_MAX_CATEGORIES + ACL_DENY];
+		if (result != acl_test_data[i].deny) {
+			printf("Line %i: Error in deny results at %i "
+				"(expected %"PRIu32" got %"PRIu32")!\n",
+				__LINE__, i, acl_test_data[i].deny,
+				result);
+			return -EINVAL;
+		}
+	}
+
+	return 0;
+}
+
+/*
+ * Test ACL lookup with the default method, then with all the methods
+ * supported by the CPU.
  */
 static int
 test_classify_run(struct rte_acl_ctx *acx)
 {
+	static const enum rte_acl_classify_alg algs[] = {
+		RTE_ACL_CLASSIFY_SCALAR,
+		RTE_ACL_CLASSIFY_SSE,
+		RTE_ACL_CLASSIFY_AVX2,
+		RTE_ACL_CLASSIFY_AVX512,
+		RTE_ACL_CLASSIFY_NEON,
+		RTE_ACL_CLASSIFY_ALTIVEC,
+	};
 	int ret, i;
-	uint32_t result, count;
+	uint32_t count, n;
 	uint32_t results[RTE_DIM(acl_test_data) * RTE_ACL_MAX_CATEGORIES];
 	const uint8_t *data[RTE_DIM(acl_test_data)];
 
@@ -285,7 +333,7 @@ test_classify_run(struct rte_acl_ctx *acx)
 
 	/**
 	 * these will run quite a few times, it's necessary to test code paths
-	 * from num=0 to num>8
+	 * from num=0 to num>16
 	 */
 	for (count = 0; count <= RTE_DIM(acl_test_data); count++) {
 		ret = rte_acl_classify(acx, data, results,
@@ -295,69 +343,34 @@ test_classify_run(struct rte_acl_ctx *acx)
 			goto err;
 		}
 
-		/* check if we allow everything we should allow */
-		for (i = 0; i < (int) count; i++) {
-			result =
-				results[i * RTE_ACL_MAX_CATEGORIES + ACL_ALLOW];
-			if (result != acl_test_data[i].allow) {
-				printf("Line %i: Error in allow results at %i "
-					"(expected %"PRIu32" got %"PRIu32")!\n",
-					__LINE__, i, acl_test_data[i].allow,
-					result);
-				ret = -EINVAL;
+		ret = test_classify_check(results, count);
+		if (ret != 0)
+			goto err;
+	}
+
+	/* check each method the CPU supports, the same way */
+	for (n = 0; n != RTE_DIM(algs); n++) {
+		if (rte_acl_set_ctx_classify(acx, algs[n]) != 0)
+			continue;
+
+		for (count = 0; count <= RTE_DIM(acl_test_data); count++) {
+			ret = rte_acl_classify_alg(acx, data, results,
+				count, RTE_ACL_MAX_CATEGORIES, algs[n]);
+			if (ret != 0) {
+				printf("Line %i: classify method %d failed!\n",
+					__LINE__, algs[n]);
 				goto err;
 			}
-		}
 
-		/* check if we deny everything we should deny */
-		for (i = 0; i < (int) count; i++) {
-			result = results[i * RTE_ACL_MAX_CATEGORIES + ACL_DENY];
-			if (result != acl_test_data[i].deny) {
-				printf("Line %i: Error in deny results at %i "
-					"(expected %"PRIu32" got %"PRIu32")!\n",
-					__LINE__, i, acl_test_data[i].deny,
-					result);
-				ret = -EINVAL;
+			ret = test_classify_check(results, count);
+			if (ret != 0) {
+				printf("Line %i: classify method %d failed!\n",
+					__LINE__, algs[n]);
 				goto err;
 			}
 		}
 	}
 
-	/* make a quick check for scalar */
-	ret = rte_acl_classify_alg(acx, data, results,
-			RTE_DIM(acl_test_data), RTE_ACL_MAX_CATEGORIES,
-			RTE_ACL_CLASSIFY_SCALAR);
-	if (ret != 0) {
-		printf("Line %i: scalar classify failed!\n", __LINE__);
-		goto err;
-	}
-
-	/* check if we allow everything we should allow */
-	for (i = 0; i < (int) RTE_DIM(acl_test_data); i++) {
-		result = results[i * RTE_ACL_MAX_CATEGORIES + ACL_ALLOW];
-		if (result != acl_test_data[i].allow) {
-			printf("Line %i: Error in allow results at %i "
-					"(expected %"PRIu32" got %"PRIu32")!\n",
-					__LINE__, i, acl_test_data[i].allow,
-					result);
-			ret = -EINVAL;
-			goto err;
-		}
-	}
-
-	/* check if we deny everything we should deny */
-	for (i = 0; i < (int) RTE_DIM(acl_test_data); i++) {
-		result = results[i * RTE_ACL_MAX_CATEGORIES + ACL_DENY];
-		if (result != acl_test_data[i].deny) {
-			printf("Line %i: Error in deny results at %i "
-					"(expected %"PRIu32" got %"PRIu32")!\n",
-					__LINE__, i, acl_test_data[i].deny,
-					result);
-			ret = -EINVAL;
-			goto err;
-		}
-	}
-
 	ret = 0;
 
 err:
@@ -446,6 +459,323 @@ test_classify(void)
 	return ret;
 }
 
+/*
+ * Test ACL build parameters: the rules are split into as many tries as
+ * allowed with tiny node limits, and classify the same way whatever the
+ * parameters.
+ */
+static int
+test_build_param(void)
+{
+	static const struct rte_acl_build_param prms[] = {
+		{ .max_tries = 0, },
+		{ .max_tries = 1, },
+		{ .max_tries = 3, .node_max = 1, .node_min = 1, },
+		{ .max_tries = RTE_ACL_MAX_TRIES, .node_min = 1, },
+		{ .node_min = 1, .wild_limit = 50, },
+		{ .max_tries = 2, .node_min = 1, .wild_limit = 50, },
+	};
+	static const struct rte_acl_build_param inval[] = {
+		{ .max_tries = RTE_ACL_MAX_TRIES + 1, },
+		{ .node_max = 0x100, .node_min = 0x200, },
+		{ .node_max = (uint32_t)INT32_MAX + 1, },
+		{ .wild_limit = 101, },
+	};
+	struct rte_acl_build_stats st;
+	struct rte_acl_ctx *acx;
+	uint32_t i, n, num;
+	int ret;
+
+	acx = rte_acl_create(&acl_param);
+	if (acx == NULL) {
+		printf("Line %i: Error creating ACL context!\n", __LINE__);
+		return -1;
+	}
+
+	for (i = 0; i != RTE_DIM(inval); i++) {
+		if (rte_acl_set_ctx_build_param(acx, inval + i) != -EINVAL) {
+			printf("Line %i: invalid build parameters %u "
+				"accepted!\n", __LINE__, i);
+			rte_acl_free(acx);
+			return -1;
+		}
+	}
+
+	ret = 0;
+	for (i = 0; i != RTE_DIM(prms) && ret == 0; i++) {
+
+		rte_acl_reset(acx);
+
+		ret = rte_acl_set_ctx_build_param(acx, prms + i);
+		if (ret != 0) {
+			printf("Line %i: build parameters %u rejected!\n",
+				__LINE__, i);
+			break;
+		}
+
+		ret = test_classify_buid(acx, acl_test_rules,
+			RTE_DIM(acl_test_rules));
+		if (ret != 0) {
+			printf("Line %i: build with parameters %u failed!\n",
+				__LINE__, i);
+			break;
+		}
+
+		ret = rte_acl_get_ctx_build_stats(acx, &st);
+		num = 0;
+		for (n = 0; n != st.num_tries; n++)
+			num += st.trie_rules[n];
+
+		if (ret != 0 || st.num_tries == 0 ||
+				st.num_tries > RTE_ACL_MAX_TRIES ||
+				(prms[i].max_tries != 0 &&
+				st.num_tries > prms[i].max_tries) ||
+				num != RTE_DIM(acl_test_rules) ||
+				st.num_nodes == 0 || st.num_match == 0 ||
+				st.rt_mem == 0 || st.build_mem == 0 ||
+				st.classify_cost == 0) {
+			printf("Line %i: invalid stats for parameters %u!\n",
+				__LINE__, i);
+			ret = -1;
+			break;
+		}
+
+		/* node limit of 1 splits until the last trie */
+		if (prms[i].node_max == 1 &&
+				st.num_tries != prms[i].max_tries) {
+			printf("Line %i: %u tries built instead of %u!\n",
+				__LINE__, st.num_tries, prms[i].max_tries);
+			ret = -1;
+			break;
+		}
+
+		ret = test_classify_run(acx);
+		if (ret != 0)
+			printf("Line %i: classify with parameters %u failed!\n",
+				__LINE__, i);
+	}
+
+	/* stats are cleared with the run-time structures */
+	rte_acl_reset(acx);
+	if (ret == 0 && (rte_acl_get_ctx_build_stats(acx, &st) != 0 ||
+			st.num_tries != 0)) {
+		printf("Line %i: stats not cleared on reset!\n", __LINE__);
+		ret = -1;
+	}
+
+	rte_acl_free(acx);
+	return ret;
+}
+
+#define	TEST_INC_NAME		"acl_inc"
+#define	TEST_INC_MAX_DELTA	8
+#define	TEST_INC_BATCH		3U
+
+struct test_inc_merge_arg {
+	struct rte_acl_inc_ctx *ctx;
+	int ret;
+	uint32_t done;
+};
+
+static void *
+test_inc_merge_thread(void *arg)
+{
+	struct test_inc_merge_arg *ma = arg;
+
+	ma->ret = rte_acl_inc_merge(ma->ctx);
+	__atomic_store_n(&ma->done, 1, __ATOMIC_RELEASE);
+	return NULL;
+}
+
+/*
+ * Classify the test data with an incremental ACL context.
+ * Data must be in network order.
+ */
+static int
+test_inc_classify_run(struct rte_acl_inc_ctx *ctx, const uint8_t **data)
+{
+	uint32_t results[RTE_DIM(acl_test_data) * RTE_ACL_MAX_CATEGORIES];
+	uint32_t count;
+	int ret;
+
+	for (count = 0; count <= RTE_DIM(acl_test_data); count++) {
+		ret = rte_acl_inc_classify(ctx, data, results, count,
+			RTE_ACL_MAX_CATEGORIES);
+		if (ret != 0) {
+			printf("Line %i: incremental classify failed!\n",
+				__LINE__);
+			return ret;
+		}
+
+		ret = test_classify_check(results, count);
+		if (ret != 0)
+			return ret;
+	}
+
+	return 0;
+}
+
+/*
+ * Test incremental ACL context: rules are added in small batches, the
+ * delta being merged into the main context when it is full, then the
+ * last delta is merged from a control thread while the test data is
+ * classified with RCU protection.
+ */
+static int
+test_incremental(void)
+{
+	struct acl_ipv4vlan_rule rules[RTE_DIM(acl_test_rules)];
+	uint32_t results[RTE_ACL_MAX_CATEGORIES];
+	const uint8_t *data[RTE_DIM(acl_test_data)];
+	struct test_inc_merge_arg ma;
+	struct rte_acl_inc_param prm;
+	struct rte_acl_inc_ctx *ctx;
+	struct rte_acl_config cfg;
+	struct rte_rcu_qsbr *v;
+	pthread_t tid;
+	uint32_t i, n;
+	int ret;
+
+	memset(&cfg, 0, sizeof(cfg));
+	acl_ipv4vlan_config(&cfg, ipv4_7tuple_layout, RTE_ACL_MAX_CATEGORIES);
+
+	prm.name = TEST_INC_NAME;
+	prm.socket_id = SOCKET_ID_ANY;
+	prm.rule_size = RTE_ACL_IPV4VLAN_RULE_SZ;
+	prm.max_rule_num = RTE_DIM(acl_test_rules);
+	prm.max_delta_rule_num = 0;
+
+	/* invalid parameters */
+	ctx = rte_acl_inc_create(&prm, &cfg);
+	if (ctx != NULL || rte_errno != EINVAL) {
+		printf("Line %i: Created context without delta rules!\n",
+			__LINE__);
+		rte_acl_inc_free(ctx);
+		return -1;
+	}
+	if (rte_acl_inc_merge(NULL) != -EINVAL) {
+		printf("Line %i: Merged NULL context!\n", __LINE__);
+		return -1;
+	}
+
+	prm.max_delta_rule_num = TEST_INC_MAX_DELTA;
+	ctx = rte_acl_inc_create(&prm, &cfg);
+	if (ctx == NULL) {
+		printf("Line %i: Error creating incremental context!\n",
+			__LINE__);
+		return -1;
+	}
+
+	v = rte_zmalloc(NULL, rte_rcu_qsbr_get_memsize(1), RTE_CACHE_LINE_SIZE);
+	if (v == NULL) {
+		printf("Line %i: Error allocating RCU variable!\n", __LINE__);
+		rte_acl_inc_free(ctx);
+		return -1;
+	}
+	rte_rcu_qsbr_init(v, 1);
+	rte_rcu_qsbr_thread_register(v, 0);
+
+	for (i = 0; i != RTE_DIM(acl_test_rules); i++)
+		acl_ipv4vlan_convert_rule(acl_test_rules + i, rules + i);
+
+	bswap_test_data(acl_test_data, RTE_DIM(acl_test_data), 1);
+	for (i = 0; i != RTE_DIM(acl_test_data); i++)
+		data[i] = (uint8_t *)&acl_test_data[i];
+
+	ret = -1;
+
+	if (rte_acl_inc_rcu_qsbr_add(ctx, v) != 0 ||
+			rte_acl_inc_rcu_qsbr_add(ctx, v) != -EEXIST) {
+		printf("Line %i: Error attaching RCU variable!\n", __LINE__);
+		goto err;
+	}
+
+	if (rte_acl_inc_classify(ctx, data, results, 1, 3) != -EINVAL) {
+		printf("Line %i: Classified with 3 categories!\n", __LINE__);
+		goto err;
+	}
+
+	/* nothing should match in an empty context */
+	if (rte_acl_inc_classify(ctx, data, results, 1,
+			RTE_ACL_MAX_CATEGORIES) != 0 ||
+			results[ACL_ALLOW] != 0 || results[ACL_DENY] != 0) {
+		printf("Line %i: Empty context classify failed!\n", __LINE__);
+		goto err;
+	}
+
+	rules[0].data.userdata = 0;
+	if (rte_acl_inc_add_rules(ctx, (struct rte_acl_rule *)rules, 1) !=
+			-EINVAL) {
+		printf("Line %i: Added a rule without user data!\n", __LINE__);
+		goto err;
+	}
+	rules[0].data.userdata = acl_test_rules[0].data.userdata;
+
+	/* add the rules in batches, merge each time the delta is full */
+	for (i = 0; i != RTE_DIM(acl_test_rules); i += n) {
+		n = RTE_MIN(RTE_DIM(acl_test_rules) - i, TEST_INC_BATCH);
+		ret = rte_acl_inc_add_rules(ctx,
+			(struct rte_acl_rule *)(rules + i), n);
+		if (ret == -ENOSPC) {
+			ret = rte_acl_inc_merge(ctx);
+			if (ret == 0)
+				ret = rte_acl_inc_add_rules(ctx,
+					(struct rte_acl_rule *)(rules + i), n);
+		}
+		if (ret != 0) {
+			printf("Line %i: Adding rules %u-%u failed!\n",
+				__LINE__, i, i + n - 1);
+			goto err;
+		}
+	}
+
+	/* matches are split between the main and the delta contexts */
+	ret = test_inc_classify_run(ctx, data);
+	if (ret != 0) {
+		printf("Line %i: Classify with delta failed!\n", __LINE__);
+		goto err;
+	}
+
+	/* merge from a control thread, while classifying */
+	ma.ctx = ctx;
+	ma.ret = -1;
+	ma.done = 0;
+	ret = rte_ctrl_thread_create(&tid, "acl-inc-merge", NULL,
+		test_inc_merge_thread, &ma);
+	if (ret != 0) {
+		printf("Line %i: Error creating merge thread!\n", __LINE__);
+		goto err;
+	}
+
+	rte_rcu_qsbr_thread_online(v, 0);
+	do {
+		ret = test_inc_classify_run(ctx, data);
+		rte_rcu_qsbr_quiescent(v, 0);
+	} while (ret == 0 && __atomic_load_n(&ma.done, __ATOMIC_ACQUIRE) == 0);
+	rte_rcu_qsbr_thread_offline(v, 0);
+	pthread_join(tid, NULL);
+
+	if (ret != 0 || ma.ret != 0) {
+		printf("Line %i: Classify during merge failed!\n", __LINE__);
+		ret = -1;
+		goto err;
+	}
+
+	/* all rules are in the main context now */
+	ret = rte_acl_inc_merge(ctx);
+	if (ret == 0)
+		ret = test_inc_classify_run(ctx, data);
+	if (ret != 0)
+		printf("Line %i: Classify after merge failed!\n", __LINE__);
+
+err:
+	bswap_test_data(acl_test_data, RTE_DIM(acl_test_data), 0);
+	rte_rcu_qsbr_thread_unregister(v, 0);
+	rte_acl_inc_free(ctx);
+	rte_free(v);
+	return ret;
+}
+
 static int
 test_build_ports_range(void)
 {
@@ -1616,6 +1946,10 @@ test_acl(void)
 		return -1;
 	if (test_convert() < 0)
 		return -1;
+	if (test_build_param() < 0)
+		return -1;
+	if (test_incremental() < 0)
+		return -1;
 
 	return 0;
 }
@@ -159,6 +159,24 @@ test_cpuflags(void)
 
 	printf("Check for INVTSC:\t");
 	CHECK_FOR_FLAG(RTE_CPUFLAG_INVTSC);
+
+	printf("Check for AVX512DQ:\t");
+	CHECK_FOR_FLAG(RTE_CPUFLAG_AVX512DQ);
+
+	printf("Check for AVX512IFMA:\t");
+	CHECK_FOR_FLAG(RTE_CPUFLAG_AVX512IFMA);
+
+	printf("Check for AVX512CD:\t");
+	CHECK_FOR_FLAG(RTE_CPUFLAG_AVX512CD);
+
+	printf("Check for AVX512BW:\t");
+	CHECK_FOR_FLAG(RTE_CPUFLAG_AVX512BW);
+
+	printf("Check for AVX512VL:\t");
+	CHECK_FOR_FLAG(RTE_CPUFLAG_AVX512VL);
+
+	printf("Check for AVX512VBMI:\t");
+	CHECK_FOR_FLAG(RTE_CPUFLAG_AVX512VBMI);
 #endif
 
 	/*
@@ -6,6 +6,7 @@
 
 #include <unistd.h>
 #include <string.h>
+#include <inttypes.h>
 #include <rte_cycles.h>
 #include <rte_errno.h>
 #include <rte_mempool.h>
@@ -510,6 +511,231 @@ test_flush_with_worker_shutdown(struct worker_params *wp,
 	return 0;
 }
 
+#define BALANCE_FLOWS 64
+#define BALANCE_ROUNDS 64
+
+/* test the flow balancing mode of the burst distributor. This test:
+ * - sends BIG_BATCH packets per round over BALANCE_FLOWS flows, where the
+ *   even flows start carrying most of the traffic after a while, and
+ *   checks that all packets come back.
+ * - checks the per worker counters account for all packets and for the
+ *   flows still carrying traffic, and that flows were moved, as many in
+ *   as out.
+ * - checks that the busiest worker load at the last epoch is within
+ *   twice the mean.
+ */
+static int
+sanity_test_balance(struct worker_params *wp, struct rte_mempool *p)
+{
+	struct rte_distributor *db = wp->dist;
+	struct rte_distributor_balance_params params = {
+		.epoch_pkts = BIG_BATCH,
+		.hysteresis = 10,
+		.max_moves = 4,
+	};
+	struct rte_distributor_worker_stats before[RTE_MAX_LCORE];
+	struct rte_distributor_worker_stats stats;
+	struct rte_mbuf *bufs[BIG_BATCH], *returns[BIG_BATCH];
+	const unsigned int num_workers = rte_lcore_count() - 1;
+	uint64_t pkts = 0, moved_in = 0, moved_out = 0;
+	uint32_t load = 0, max_load = 0, flows = 0;
+	unsigned int i, r, count, retries;
+
+	printf("=== Burst distributor flow balancing test ===\n");
+	clear_packet_count();
+
+	for (i = 0; i < num_workers; i++)
+		rte_distributor_get_worker_stats(db, i, &before[i]);
+	if (rte_distributor_get_worker_stats(db, num_workers, &stats) !=
+			-EINVAL) {
+		printf("line %d: No error getting stats of invalid worker\n",
+				__LINE__);
+		return -1;
+	}
+
+	if (rte_distributor_balance_enable(db, &params) != 0) {
+		printf("line %d: Error enabling flow balancing\n", __LINE__);
+		return -1;
+	}
+
+	for (r = 0; r < BALANCE_ROUNDS; r++) {
+		if (rte_mempool_get_bulk(p, (void *)bufs, BIG_BATCH) != 0) {
+			printf("line %d: Error getting mbufs from pool\n",
+					__LINE__);
+			goto err;
+		}
+		/*
+		 * The flows are evenly loaded at first, so that they get
+		 * spread over the workers in turn, then half the packets go
+		 * to the even flows, pinned to the same workers.
+		 */
+		for (i = 0; i < BIG_BATCH; i++) {
+			if (r < BALANCE_ROUNDS / 4 || (i & 1) == 0)
+				bufs[i]->hash.usr = i % BALANCE_FLOWS << 1;
+			else
+				bufs[i]->hash.usr =
+					i % (BALANCE_FLOWS / 2) << 2;
+		}
+
+		count = 0;
+		for (i = 0; i < BIG_BATCH / BURST; i++) {
+			rte_distributor_process(db, &bufs[i * BURST], BURST);
+			count += rte_distributor_returned_pkts(db, returns,
+					BIG_BATCH);
+		}
+		retries = 0;
+		do {
+			rte_distributor_flush(db);
+			count += rte_distributor_returned_pkts(db,
+					returns, BIG_BATCH);
+			retries++;
+		} while (count < BIG_BATCH && retries < 1000);
+		rte_mempool_put_bulk(p, (void *)bufs, BIG_BATCH);
+		if (count != BIG_BATCH) {
+			printf("line %d: Missing packets, expected %d, got %u\n",
+					__LINE__, BIG_BATCH, count);
+			goto err;
+		}
+	}
+
+	if (total_packet_count() != BIG_BATCH * BALANCE_ROUNDS) {
+		printf("Line %d: Error, not all packets handled. "
+				"Expected %u, got %u\n", __LINE__,
+				BIG_BATCH * BALANCE_ROUNDS,
+				total_packet_count());
+		goto err;
+	}
+
+	for (i = 0; i < num_workers; i++) {
+		rte_distributor_get_worker_stats(db, i, &stats);
+		printf("Worker %u: %"PRIu64" packets, load %u, %u flows, "
+				"%"PRIu64" flows in, %"PRIu64" flows out\n", i,
+				stats.pkts - before[i].pkts, stats.load,
+				stats.flows,
+				stats.flows_in - before[i].flows_in,
+				stats.flows_out - before[i].flows_out);
+		pkts += stats.pkts - before[i].pkts;
+		moved_in += stats.flows_in - before[i].flows_in;
+		moved_out += stats.flows_out - before[i].flows_out;
+		load += stats.load;
+		max_load = RTE_MAX(max_load, stats.load);
+		flows += stats.flows;
+	}
+
+	if (pkts != BIG_BATCH * BALANCE_ROUNDS || moved_in == 0 ||
+			moved_in != moved_out) {
+		printf("line %d: Wrong worker stats, %"PRIu64" packets, "
+				"%"PRIu64" flows in, %"PRIu64" flows out\n",
+				__LINE__, pkts, moved_in, moved_out);
+		goto err;
+	}
+	/* the flows left without packets decay and get unpinned */
+	if (flows != BALANCE_FLOWS / 2) {
+		printf("line %d: %u flows pinned to the workers, expected "
+				"%u\n", __LINE__, flows, BALANCE_FLOWS / 2);
+		goto err;
+	}
+	if ((uint64_t)max_load * num_workers > 2 * (uint64_t)load) {
+		printf("line %d: Workers not balanced, max load %u, "
+				"total %u\n", __LINE__, max_load, load);
+		goto err;
+	}
+
+	rte_distributor_balance_disable(db);
+	printf("Flow balancing test passed\n\n");
+	return 0;
+
+err:
+	rte_distributor_balance_disable(db);
+	return -1;
+}
+
+/* test a ring mode distributor with one partition per worker. This test:
+ * - checks a ring mode distributor can have more than 64 workers.
+ * - sends BIG_BATCH packets to each partition, with the tag giving the
+ *   partition, and checks that each worker only handled the packets of its
+ *   partition, and that all packets come back from their partition.
+ */
+static int
+sanity_test_partitions(struct rte_distributor *d, struct rte_mempool *p)
+{
+	struct rte_distributor_ring_params params = {
+		.name = "Test_dist_max",
+		.socket_id = rte_socket_id(),
+		.num_workers = RTE_MAX_LCORE + 1,
+	};
+	struct rte_mbuf *bufs[BIG_BATCH], *returns[BIG_BATCH];
+	const unsigned int num_parts = rte_lcore_count() - 1;
+	unsigned int i, part, count, retries;
+	static struct rte_distributor *dmax;
+
+	printf("=== Ring distributor partitions test ===\n");
+
+	if (rte_distributor_create_ring(&params) != NULL ||
+			rte_errno != EINVAL) {
+		printf("line %d: No error on create() with num_workers > MAX\n",
+				__LINE__);
+		return -1;
+	}
+	params.num_workers = RTE_MAX_LCORE;
+	if (dmax == NULL)
+		dmax = rte_distributor_create_ring(&params);
+	if (dmax == NULL) {
+		printf("line %d: Error creating distributor with %u workers\n",
+				__LINE__, params.num_workers);
+		return -1;
+	}
+	if (rte_distributor_process_partition(dmax, 1, NULL, 0) != -EINVAL) {
+		printf("line %d: No error processing invalid partition\n",
+				__LINE__);
+		return -1;
+	}
+
+	clear_packet_count();
+	for (part = 0; part < num_parts; part++) {
+		if (rte_mempool_get_bulk(p, (void *)bufs, BIG_BATCH) != 0) {
+			printf("line %d: Error getting mbufs from pool\n",
+					__LINE__);
+			return -1;
+		}
+		for (i = 0; i < BIG_BATCH; i++)
+			bufs[i]->hash.usr = i * num_parts + part;
+
+		count = 0;
+		for (i = 0; i < BIG_BATCH / BURST; i++) {
+			rte_distributor_process_partition(d, part,
+					&bufs[i * BURST], BURST);
+			count += rte_distributor_returned_pkts_partition(d,
+					part, &returns[count], BIG_BATCH - count);
+		}
+		retries = 0;
+		while (count < BIG_BATCH && retries++ < 1000) {
+			rte_delay_us(100);
+			rte_distributor_process_partition(d, part, NULL, 0);
+			count += rte_distributor_returned_pkts_partition(d,
+					part, &returns[count], BIG_BATCH - count);
+		}
+		rte_mempool_put_bulk(p, (void *)bufs, BIG_BATCH);
+		if (count != BIG_BATCH) {
+			printf("line %d: Missing packets in partition %u, "
+					"expected %d, got %u\n", __LINE__,
+					part, BIG_BATCH, count);
+			return -1;
+		}
+		if (worker_stats[part].handled_packets != BIG_BATCH) {
+			printf("line %d: Partition %u packets handled by "
+					"other workers\n", __LINE__, part);
+			return -1;
+		}
+	}
+
+	for (i = 0; i < num_parts; i++)
+		printf("Worker %u handled %u packets\n", i,
+				worker_stats[i].handled_packets);
+	printf("Ring distributor partitions test passed\n\n");
+	return 0;
+}
+
 static
 int test_error_distributor_create_name(void)
 {
@@ -588,12 +814,30 @@ quit_workers(struct worker_params *wp, struct rte_mempool *p)
 	worker_idx = 0;
 }
 
+/* Same as quit_workers, for a distributor with a partition per worker */
+static void
+quit_partitions(struct rte_distributor *d)
+{
+	const unsigned int num_parts = rte_lcore_count() - 1;
+	unsigned int i;
+
+	quit = 1;
+	/* wake up the workers with an empty burst */
+	for (i = 0; i < num_parts; i++)
+		rte_distributor_process_partition(d, i, NULL, 0);
+	rte_eal_mp_wait_lcore();
+	quit = 0;
+	worker_idx = 0;
+}
+
 static int
 test_distributor(void)
 {
 	static struct rte_distributor *ds;
 	static struct rte_distributor *db;
-	static struct rte_distributor *dist[2];
+	static struct rte_distributor *dr;
+	static struct rte_distributor *dp;
+	static struct rte_distributor *dist[3];
 	static struct rte_mempool *p;
 	int i;
 
@@ -629,6 +873,36 @@ test_distributor(void)
 		rte_distributor_clear_returns(ds);
 	}
 
+	if (dr == NULL) {
+		dr = rte_distributor_create("Test_dist_ring", rte_socket_id(),
+				rte_lcore_count() - 1,
+				RTE_DIST_ALG_RING);
+		if (dr == NULL) {
+			printf("Error creating ring distributor\n");
+			return -1;
+		}
+	} else {
+		rte_distributor_flush(dr);
+		rte_distributor_clear_returns(dr);
+	}
+
+	if (dp == NULL) {
+		struct rte_distributor_ring_params params = {
+			.name = "Test_dist_part",
+			.socket_id = rte_socket_id(),
+			.num_workers = rte_lcore_count() - 1,
+			.num_partitions = rte_lcore_count() - 1,
+		};
+
+		dp = rte_distributor_create_ring(&params);
+		if (dp == NULL) {
+			printf("Error creating partitioned distributor\n");
+			return -1;
+		}
+	} else {
+		rte_distributor_clear_returns(dp);
+	}
+
 	const unsigned nb_bufs = (511 * rte_lcore_count()) < BIG_BATCH ?
 			(BIG_BATCH * 2) - 1 : (511 * rte_lcore_count());
 	if (p == NULL) {
@@ -642,11 +916,15 @@ test_distributor(void)
 
 	dist[0] = ds;
 	dist[1] = db;
+	dist[2] = dr;
 
-	for (i = 0; i < 2; i++) {
+	for (i = 0; i < 3; i++) {
 
 		worker_params.dist = dist[i];
-		if (i)
+		if (i == 2)
+			strlcpy(worker_params.name, "ring",
+					sizeof(worker_params.name));
+		else if (i)
 			strlcpy(worker_params.name, "burst",
 					sizeof(worker_params.name));
 		else
@@ -686,7 +964,24 @@ test_distributor(void)
 			printf("Too few cores to run worker shutdown test\n");
 		}
 
+		if (i == 1 && rte_lcore_count() > 2) {
+			rte_eal_mp_remote_launch(handle_work,
+					&worker_params, SKIP_MASTER);
+			if (sanity_test_balance(&worker_params, p) < 0)
+				goto err;
+			quit_workers(&worker_params, p);
+		}
+
+	}
+
+	worker_params.dist = dp;
+	strlcpy(worker_params.name, "partitions", sizeof(worker_params.name));
+	rte_eal_mp_remote_launch(handle_work, &worker_params, SKIP_MASTER);
+	if (sanity_test_partitions(dp, p) < 0) {
+		quit_partitions(dp);
+		return -1;
 	}
+	quit_partitions(dp);
 
 	if (test_error_distributor_create_numworkers() == -1 ||
 			test_error_distributor_create_name() == -1) {
@@ -205,6 +205,7 @@ test_distributor_perf(void)
 {
 	static struct rte_distributor *ds;
 	static struct rte_distributor *db;
+	static struct rte_distributor *dr;
 	static struct rte_mempool *p;
 
 	if (rte_lcore_count() < 2) {
@@ -239,6 +240,18 @@ test_distributor_perf(void)
 		rte_distributor_clear_returns(db);
 	}
 
+	if (dr == NULL) {
+		dr = rte_distributor_create("Test_ring", rte_socket_id(),
+				rte_lcore_count() - 1,
+				RTE_DIST_ALG_RING);
+		if (dr == NULL) {
+			printf("Error creating ring distributor\n");
+			return -1;
+		}
+	} else {
+		rte_distributor_clear_returns(dr);
+	}
+
 	const unsigned nb_bufs = (511 * rte_lcore_count()) < BIG_BATCH ?
 			(BIG_BATCH * 2) - 1 : (511 * rte_lcore_count());
 	if (p == NULL) {
@@ -262,6 +275,12 @@ test_distributor_perf(void)
 		return -1;
 	quit_workers(db, p);
 
+	printf("=== Performance test of distributor (ring mode) ===\n");
+	rte_eal_mp_remote_launch(handle_work, dr, SKIP_MASTER);
+	if (perf_test(dr, p) < 0)
+		return -1;
+	quit_workers(dr, p);
+
 	return 0;
 }
 
@@ -6,10 +6,17 @@
 #include <stdio.h>
 #include <stdint.h>
 #include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <inttypes.h>
 
 #include <rte_ip.h>
 #include <rte_log.h>
+#include <rte_errno.h>
+#include <rte_rib.h>
 #include <rte_fib.h>
+#include <rte_malloc.h>
+#include <rte_random.h>
 
 #include "test.h"
 
@@ -21,6 +28,12 @@ static int32_t test_free_null(void);
 static int32_t test_add_del_invalid(void);
 static int32_t test_get_invalid(void);
 static int32_t test_lookup(void);
+static int32_t test_invalid_rcu(void);
+static int32_t test_fib_rcu_qsbr(void);
+static int32_t test_bulk(void);
+static int32_t test_bulk_rollback(void);
+static int32_t test_cache(void);
+static int32_t test_save_restore(void);
 
 #define MAX_ROUTES	(1 << 16)
 #define MAX_TBL8	(1 << 15)
@@ -195,6 +208,10 @@ test_get_invalid(void)
 	RTE_TEST_ASSERT(p == NULL,
 		"Call succeeded with invalid parameters\n");
 
+	RTE_TEST_ASSERT(rte_fib_set_lookup_fn(NULL,
+		RTE_FIB_LOOKUP_DEFAULT) < 0,
+		"Call succeeded with invalid parameters\n");
+
 	return TEST_SUCCESS;
 }
 
@@ -317,6 +334,16 @@ test_lookup(void)
 	struct rte_fib *fib = NULL;
 	struct rte_fib_conf config;
 	uint64_t def_nh = 100;
+	const enum rte_fib_lookup_type lookup_types[] = {
+		RTE_FIB_LOOKUP_DEFAULT,
+		RTE_FIB_LOOKUP_DIR24_8_SCALAR_MACRO,
+		RTE_FIB_LOOKUP_DIR24_8_SCALAR_INLINE,
+		RTE_FIB_LOOKUP_DIR24_8_SCALAR_UNI,
+		RTE_FIB_LOOKUP_DIR24_8_VECTOR_AVX512
+	};
+	const uint32_t num_tbl8[] = {127, MAX_TBL8 - 1, MAX_TBL8, MAX_TBL8};
+	enum rte_fib_dir24_8_nh_sz nh_sz;
+	unsigned int i;
 	int ret;
 
 	config.max_routes = MAX_ROUTES;
@@ -332,45 +359,673 @@ test_lookup(void)
 
 	config.type = RTE_FIB_DIR24_8;
 
-	config.dir24_8.nh_sz = RTE_FIB_DIR24_8_1B;
-	config.dir24_8.num_tbl8 = 127;
+	for (nh_sz = RTE_FIB_DIR24_8_1B; nh_sz <= RTE_FIB_DIR24_8_8B;
+			nh_sz++) {
+		config.dir24_8.nh_sz = nh_sz;
+		config.dir24_8.num_tbl8 = num_tbl8[nh_sz];
+		for (i = 0; i < RTE_DIM(lookup_types); i++) {
+			fib = rte_fib_create(__func__, SOCKET_ID_ANY, &config);
+			RTE_TEST_ASSERT(fib != NULL, "Failed to create FIB\n");
+			if (rte_fib_set_lookup_fn(fib, lookup_types[i]) != 0) {
+				/* Vector lookup not supported by the CPU */
+				RTE_TEST_ASSERT(lookup_types[i] ==
+					RTE_FIB_LOOKUP_DIR24_8_VECTOR_AVX512,
+					"Failed to set lookup function\n");
+				rte_fib_free(fib);
+				continue;
+			}
+			ret = check_fib(fib);
+			RTE_TEST_ASSERT(ret == TEST_SUCCESS,
+				"Check_fib fails for DIR24_8_%uB type, "
+				"lookup type %d\n", 1 << nh_sz,
+				lookup_types[i]);
+			rte_fib_free(fib);
+		}
+	}
+
+	return TEST_SUCCESS;
+}
+
+/*
+ * rte_fib_rcu_qsbr_add positive and negative tests.
+ *  - Add RCU QSBR variable to FIB
+ *  - Add another RCU QSBR variable to FIB
+ *  - Check returns
+ */
+int32_t
+test_invalid_rcu(void)
+{
+	struct rte_fib *fib = NULL;
+	struct rte_fib_conf config;
+	size_t sz;
+	struct rte_rcu_qsbr *qsv;
+	struct rte_rcu_qsbr *qsv2;
+	int32_t status;
+	struct rte_fib_rcu_config rcu_cfg = {0};
+
+	config.max_routes = MAX_ROUTES;
+	config.default_nh = 0;
+	config.type = RTE_FIB_DUMMY;
+
+	/* Create RCU QSBR variable */
+	sz = rte_rcu_qsbr_get_memsize(RTE_MAX_LCORE);
+	qsv = (struct rte_rcu_qsbr *)rte_zmalloc_socket(NULL, sz,
+					RTE_CACHE_LINE_SIZE, SOCKET_ID_ANY);
+	RTE_TEST_ASSERT(qsv != NULL, "Can not allocate memory for RCU\n");
+
+	status = rte_rcu_qsbr_init(qsv, RTE_MAX_LCORE);
+	RTE_TEST_ASSERT(status == 0, "Can not initialize RCU\n");
+
+	rcu_cfg.v = qsv;
+
+	/* rte_fib_rcu_qsbr_add: fib == NULL */
+	status = rte_fib_rcu_qsbr_add(NULL, &rcu_cfg);
+	RTE_TEST_ASSERT(status == -EINVAL,
+		"Call succeeded with invalid parameters\n");
+
+	/* RIB based FIB does not support RCU */
 	fib = rte_fib_create(__func__, SOCKET_ID_ANY, &config);
 	RTE_TEST_ASSERT(fib != NULL, "Failed to create FIB\n");
-	ret = check_fib(fib);
-	RTE_TEST_ASSERT(ret == TEST_SUCCESS,
-		"Check_fib fails for DIR24_8_1B type\n");
+	status = rte_fib_rcu_qsbr_add(fib, &rcu_cfg);
+	RTE_TEST_ASSERT(status == -ENOTSUP,
+		"Call succeeded with unsupported FIB type\n");
 	rte_fib_free(fib);
 
-	config.dir24_8.nh_sz = RTE_FIB_DIR24_8_2B;
-	config.dir24_8.num_tbl8 = MAX_TBL8 - 1;
+	config.type = RTE_FIB_DIR24_8;
+	config.dir24_8.nh_sz = RTE_FIB_DIR24_8_4B;
+	config.dir24_8.num_tbl8 = MAX_TBL8;
 	fib = rte_fib_create(__func__, SOCKET_ID_ANY, &config);
 	RTE_TEST_ASSERT(fib != NULL, "Failed to create FIB\n");
-	ret = check_fib(fib);
-	RTE_TEST_ASSERT(ret == TEST_SUCCESS,
-		"Check_fib fails for DIR24_8_2B type\n");
+
+	/* rte_fib_rcu_qsbr_add: cfg == NULL */
+	status = rte_fib_rcu_qsbr_add(fib, NULL);
+	RTE_TEST_ASSERT(status == -EINVAL,
+		"Call succeeded with invalid parameters\n");
+
+	/* rte_fib_rcu_qsbr_add: invalid mode */
+	rcu_cfg.mode = 2;
+	status = rte_fib_rcu_qsbr_add(fib, &rcu_cfg);
+	RTE_TEST_ASSERT(status == -EINVAL,
+		"Call succeeded with invalid parameters\n");
+
+	/* Attach RCU QSBR to FIB table */
+	rcu_cfg.mode = RTE_FIB_QSBR_MODE_DQ;
+	status = rte_fib_rcu_qsbr_add(fib, &rcu_cfg);
+	RTE_TEST_ASSERT(status == 0, "Can not attach RCU to FIB\n");
+
+	/* Create and attach another RCU QSBR to FIB table */
+	qsv2 = (struct rte_rcu_qsbr *)rte_zmalloc_socket(NULL, sz,
+					RTE_CACHE_LINE_SIZE, SOCKET_ID_ANY);
+	RTE_TEST_ASSERT(qsv2 != NULL, "Can not allocate memory for RCU\n");
+
+	rcu_cfg.v = qsv2;
+	rcu_cfg.mode = RTE_FIB_QSBR_MODE_SYNC;
+	status = rte_fib_rcu_qsbr_add(fib, &rcu_cfg);
+	RTE_TEST_ASSERT(status == -EEXIST,
+		"Secondary RCU was mistakenly attached\n");
+
 	rte_fib_free(fib);
+	rte_free(qsv);
+	rte_free(qsv2);
+
+	return TEST_SUCCESS;
+}
+
+/*
+ * Exhaust the tbl8 groups with routes, delete them while a reader is
+ * online and check the groups are given back once the reader went
+ * through a quiescent state, in both reclamation modes.
+ */
+int32_t
+test_fib_rcu_qsbr(void)
+{
+	struct rte_fib *fib = NULL;
+	struct rte_fib_conf config;
+	struct rte_fib_rcu_config rcu_cfg = {0};
+	struct rte_rcu_qsbr *qsv;
+	uint32_t ip, num_tbl8 = 64;
+	uint64_t nh;
+	unsigned int i, j;
+	int32_t status;
+	const enum rte_fib_qsbr_mode modes[] = {
+		RTE_FIB_QSBR_MODE_DQ,
+		RTE_FIB_QSBR_MODE_SYNC
+	};
+
+	qsv = (struct rte_rcu_qsbr *)rte_zmalloc_socket(NULL,
+			rte_rcu_qsbr_get_memsize(RTE_MAX_LCORE),
+			RTE_CACHE_LINE_SIZE, SOCKET_ID_ANY);
+	RTE_TEST_ASSERT(qsv != NULL, "Can not allocate memory for RCU\n");
 
+	config.max_routes = MAX_ROUTES;
+	config.default_nh = 0;
+	config.type = RTE_FIB_DIR24_8;
+	config.dir24_8.nh_sz = RTE_FIB_DIR24_8_4B;
+	config.dir24_8.num_tbl8 = num_tbl8;
+
+	for (i = 0; i < RTE_DIM(modes); i++) {
+		status = rte_rcu_qsbr_init(qsv, RTE_MAX_LCORE);
+		RTE_TEST_ASSERT(status == 0, "Can not initialize RCU\n");
+		rte_rcu_qsbr_thread_register(qsv, 0);
+
+		fib = rte_fib_create(__func__, SOCKET_ID_ANY, &config);
+		RTE_TEST_ASSERT(fib != NULL, "Failed to create FIB\n");
+		rcu_cfg.v = qsv;
+		rcu_cfg.mode = modes[i];
+		status = rte_fib_rcu_qsbr_add(fib, &rcu_cfg);
+		RTE_TEST_ASSERT(status == 0, "Can not attach RCU to FIB\n");
+
+		/* Use every tbl8 group, one /32 route in each /24 */
+		for (j = 0; j < num_tbl8; j++) {
+			ip = RTE_IPV4(10, 0, j, 1);
+			status = rte_fib_add(fib, ip, 32, j + 1);
+			RTE_TEST_ASSERT(status == 0, "Failed to add a route\n");
+		}
+
+		/* In blocking mode the reader must not hold the writer */
+		if (modes[i] == RTE_FIB_QSBR_MODE_DQ)
+			rte_rcu_qsbr_thread_online(qsv, 0);
+		for (j = 0; j < num_tbl8; j++) {
+			ip = RTE_IPV4(10, 0, j, 1);
+			status = rte_fib_delete(fib, ip, 32);
+			RTE_TEST_ASSERT(status == 0,
+				"Failed to delete a route\n");
+			rte_fib_lookup_bulk(fib, &ip, &nh, 1);
+			RTE_TEST_ASSERT(nh == 0,
+				"Failed to get proper nexthop\n");
+		}
+		rte_rcu_qsbr_quiescent(qsv, 0);
+		rte_rcu_qsbr_thread_offline(qsv, 0);
+
+		/* All the groups must be available again */
+		for (j = 0; j < num_tbl8; j++) {
+			ip = RTE_IPV4(10, 1, j, 1);
+			status = rte_fib_add(fib, ip, 32, j + 1);
+			RTE_TEST_ASSERT(status == 0,
+				"tbl8 groups were not reclaimed\n");
+			rte_fib_lookup_bulk(fib, &ip, &nh, 1);
+			RTE_TEST_ASSERT(nh == j + 1,
+				"Failed to get proper nexthop\n");
+		}
+
+		rte_rcu_qsbr_thread_unregister(qsv, 0);
+		rte_fib_free(fib);
+	}
+
+	rte_free(qsv);
+
+	return TEST_SUCCESS;
+}
+
+#define BULK_ROUTES	4096
+#define BULK_LOOKUPS	(1 << 16)
+
+static int
+compare_fib(struct rte_fib *fib, struct rte_fib *ref, const uint32_t *ips,
+	unsigned int n)
+{
+	static uint32_t ip_arr[BULK_LOOKUPS];
+	static uint64_t nh[BULK_LOOKUPS], ref_nh[BULK_LOOKUPS];
+	unsigned int i;
+
+	/* Check the route addresses, their last address and random ones */
+	for (i = 0; i < BULK_LOOKUPS; i++) {
+		if (i < n)
+			ip_arr[i] = ips[i];
+		else if (i < 2 * n)
+			ip_arr[i] = ips[i - n] | (UINT32_MAX >> (i & 0x1f));
+		else
+			ip_arr[i] = rte_rand();
+	}
+	rte_fib_lookup_bulk(fib, ip_arr, nh, BULK_LOOKUPS);
+	rte_fib_lookup_bulk(ref, ip_arr, ref_nh, BULK_LOOKUPS);
+	for (i = 0; i < BULK_LOOKUPS; i++)
+		RTE_TEST_ASSERT(nh[i] == ref_nh[i],
+			"Lookup of %08x gives %"PRIu64" instead of %"PRIu64"\n",
+			ip_arr[i], nh[i], ref_nh[i]);
+
+	return TEST_SUCCESS;
+}
+
+/*
+ * Add and delete nested routes with rte_fib_add_bulk and
+ * rte_fib_delete_bulk, the FIB must give the same lookup results
+ * as one built route by route.
+ */
+int32_t
+test_bulk(void)
+{
+	static uint32_t ips[BULK_ROUTES];
+	static uint8_t depths[BULK_ROUTES];
+	static uint64_t nhs[BULK_ROUTES];
+	static int status[BULK_ROUTES], ref_status[BULK_ROUTES];
+	struct rte_fib *fib, *ref;
+	struct rte_fib_conf config;
+	unsigned int i, half = BULK_ROUTES / 2;
+	int ret;
+
+	config.max_routes = MAX_ROUTES;
+	config.default_nh = 0;
+	config.type = RTE_FIB_DIR24_8;
 	config.dir24_8.nh_sz = RTE_FIB_DIR24_8_4B;
 	config.dir24_8.num_tbl8 = MAX_TBL8;
+
 	fib = rte_fib_create(__func__, SOCKET_ID_ANY, &config);
 	RTE_TEST_ASSERT(fib != NULL, "Failed to create FIB\n");
-	ret = check_fib(fib);
-	RTE_TEST_ASSERT(ret == TEST_SUCCESS,
-		"Check_fib fails for DIR24_8_4B type\n");
+	ref = rte_fib_create("test_bulk_ref", SOCKET_ID_ANY, &config);
+	RTE_TEST_ASSERT(ref != NULL, "Failed to create FIB\n");
+
+	/* Nested prefixes within 10.0.0.0/8 and some duplicates */
+	for (i = 0; i < BULK_ROUTES; i++) {
+		depths[i] = 8 + rte_rand() % 25;
+		ips[i] = (RTE_IPV4(10, 0, 0, 0) | (rte_rand() & 0xfff0ff)) &
+			rte_rib_depth_to_mask(depths[i]);
+		nhs[i] = 1 + rte_rand() % 1000;
+		if ((i % 64) == 63) {
+			ips[i] = ips[i - 1];
+			depths[i] = depths[i - 1];
+		}
+		rte_fib_add(ref, ips[i], depths[i], nhs[i]);
+	}
+
+	ret = rte_fib_add_bulk(fib, ips, depths, nhs, BULK_ROUTES, status);
+	RTE_TEST_ASSERT(ret == BULK_ROUTES, "Failed to add routes\n");
+	for (i = 0; i < BULK_ROUTES; i++)
+		RTE_TEST_ASSERT(status[i] == 0, "Failed to add a route\n");
+	ret = compare_fib(fib, ref, ips, BULK_ROUTES);
+	RTE_TEST_ASSERT(ret == TEST_SUCCESS, "Bulk add mismatch\n");
+
+	/* Delete one half, duplicates fail on their second delete */
+	for (i = 0; i < half; i++)
+		ref_status[i] = rte_fib_delete(ref, ips[i], depths[i]);
+	ret = rte_fib_delete_bulk(fib, ips, depths, half, status);
+	RTE_TEST_ASSERT(ret > 0, "Failed to delete routes\n");
+	for (i = 0; i < half; i++)
+		RTE_TEST_ASSERT(status[i] == ref_status[i],
+			"Failed to delete a route\n");
+	ret = compare_fib(fib, ref, ips, BULK_ROUTES);
+	RTE_TEST_ASSERT(ret == TEST_SUCCESS, "Bulk delete mismatch\n");
+
+	/* Invalid routes are reported without stopping the batch */
+	depths[0] = RTE_FIB_MAXDEPTH + 1;
+	nhs[1] = UINT64_MAX;
+	ret = rte_fib_add_bulk(fib, ips, depths, nhs, half, status);
+	RTE_TEST_ASSERT(ret == (int)half - 2, "Failed to add routes\n");
+	RTE_TEST_ASSERT((status[0] == -EINVAL) && (status[1] == -EINVAL),
+		"Invalid routes were added\n");
+
+	ret = rte_fib_add_bulk(NULL, ips, depths, nhs, half, NULL);
+	RTE_TEST_ASSERT(ret == -EINVAL,
+		"Call succeeded with invalid parameters\n");
+	ret = rte_fib_delete_bulk(fib, NULL, depths, half, NULL);
+	RTE_TEST_ASSERT(ret == -EINVAL,
+		"Call succeeded with invalid parameters\n");
+
 	rte_fib_free(fib);
+	rte_fib_free(ref);
 
-	config.dir24_8.nh_sz = RTE_FIB_DIR24_8_8B;
+	return TEST_SUCCESS;
+}
+
+#define ROLLBACK_TBL8	64
+
+/*
+ * Run a bulk add out of tbl8 groups in the dataplane, the routes not
+ * written must be reported and left out of both the RIB and the dataplane.
+ */
+int32_t
+test_bulk_rollback(void)
+{
+	/* the /16 is written before its new /25, and its range, cut by
+	 * the /25, then needs two tbl8 groups at once
+	 */
+	const uint32_t ips[] = {RTE_IPV4(10, 1, 0, 0), RTE_IPV4(10, 1, 5, 0),
+		RTE_IPV4(10, 0, 0, 1)};
+	const uint8_t depths[] = {16, 25, 32};
+	const uint64_t nhs[] = {2, 3, 4};
+	int status[RTE_DIM(ips)];
+	struct rte_fib *fib;
+	struct rte_rib *rib;
+	struct rte_fib_conf config;
+	uint32_t ip;
+	uint64_t nh;
+	unsigned int i;
+	int ret;
+
+	config.max_routes = MAX_ROUTES;
+	config.default_nh = 0;
+	config.type = RTE_FIB_DIR24_8;
+	config.dir24_8.nh_sz = RTE_FIB_DIR24_8_4B;
+	config.dir24_8.num_tbl8 = ROLLBACK_TBL8;
+
+	fib = rte_fib_create(__func__, SOCKET_ID_ANY, &config);
+	RTE_TEST_ASSERT(fib != NULL, "Failed to create FIB\n");
+	rib = rte_fib_get_rib(fib);
+
+	/* use all the tbl8 groups but one */
+	for (i = 0; i < ROLLBACK_TBL8 - 1; i++) {
+		ret = rte_fib_add(fib, RTE_IPV4(10, 0, i, 1), 32, 1);
+		RTE_TEST_ASSERT(ret == 0, "Failed to add a route\n");
+	}
+
+	ret = rte_fib_add_bulk(fib, ips, depths, nhs, RTE_DIM(ips), status);
+	RTE_TEST_ASSERT(ret == 1, "Unexpected number of routes added\n");
+	RTE_TEST_ASSERT((status[0] == -ENOSPC) && (status[1] == -ENOSPC) &&
+		(status[2] == 0), "Unexpected route status\n");
+	for (i = 0; i < 2; i++) {
+		RTE_TEST_ASSERT(rte_rib_lookup_exact(rib, ips[i],
+			depths[i]) == NULL, "Failed route kept in the RIB\n");
+		ip = ips[i] + 1;
+		rte_fib_lookup_bulk(fib, &ip, &nh, 1);
+		RTE_TEST_ASSERT(nh == config.default_nh,
+			"Failed route kept in the dataplane\n");
+	}
+	ip = ips[2];
+	rte_fib_lookup_bulk(fib, &ip, &nh, 1);
+	RTE_TEST_ASSERT(nh == nhs[2], "Route not updated\n");
+
+	/* the tbl8 reservation was restored, one by one the routes fit */
+	ret = rte_fib_add(fib, ips[1], depths[1], nhs[1]);
+	RTE_TEST_ASSERT(ret == 0, "Failed to add a route\n");
+	ret = rte_fib_add(fib, ips[0], depths[0], nhs[0]);
+	RTE_TEST_ASSERT(ret == 0, "Failed to add a route\n");
+	for (i = 0; i < 2; i++) {
+		ip = ips[i] + 1;
+		rte_fib_lookup_bulk(fib, &ip, &nh, 1);
+		RTE_TEST_ASSERT(nh == nhs[i], "Lookup mismatch\n");
+	}
+
+	rte_fib_free(fib);
+
+	return TEST_SUCCESS;
+}
+
+#define CACHE_ENTRIES	256
+#define CACHE_DESTS	128
+#define CACHE_LOOKUPS	1024
+#define CACHE_ROUNDS	64
+
+/* Look up one address through the cache and the FIB */
+static int
+cache_lookup_one(struct rte_fib_cache *cache, struct rte_fib *fib,
+	uint32_t ip, uint64_t expected_nh)
+{
+	uint64_t nh, fib_nh;
+
+	rte_fib_cache_lookup_bulk(cache, &ip, &nh, 1);
+	rte_fib_lookup_bulk(fib, &ip, &fib_nh, 1);
+	RTE_TEST_ASSERT((nh == fib_nh) && (nh == expected_nh),
+		"Lookup of %08x gives %"PRIu64" instead of %"PRIu64"\n",
+		ip, nh, expected_nh);
+
+	return TEST_SUCCESS;
+}
+
+static int
+cache_check_stats(struct rte_fib_cache *cache, uint64_t hits,
+	uint64_t misses)
+{
+	struct rte_fib_cache_stats stats;
+
+	RTE_TEST_ASSERT(rte_fib_cache_stats_get(cache, &stats) == 0,
+		"Failed to get cache stats\n");
+	RTE_TEST_ASSERT((stats.hits == hits) && (stats.misses == misses),
+		"Unexpected cache stats: %"PRIu64" hits, %"PRIu64" misses\n",
+		stats.hits, stats.misses);
+	rte_fib_cache_stats_reset(cache);
+
+	return TEST_SUCCESS;
+}
+
+/*
+ * Check the lookup cache gives the FIB results and that route updates
+ * invalidate the cached addresses they cover, then compare cached and
+ * FIB lookups of a small set of destinations under random route churn.
+ */
+int32_t
+test_cache(void)
+{
+	static uint32_t ips[CACHE_LOOKUPS];
+	static uint64_t nh[CACHE_LOOKUPS], fib_nh[CACHE_LOOKUPS];
+	uint32_t dests[CACHE_DESTS];
+	struct rte_fib_cache *cache;
+	struct rte_fib_cache_stats stats;
+	struct rte_fib *fib;
+	struct rte_fib_conf config;
+	uint32_t ip = RTE_IPV4(10, 1, 2, 3);
+	unsigned int i, j;
+	uint8_t depth;
+	int ret;
+
+	config.max_routes = MAX_ROUTES;
+	config.default_nh = 1;
+	config.type = RTE_FIB_DIR24_8;
+	config.dir24_8.nh_sz = RTE_FIB_DIR24_8_4B;
 	config.dir24_8.num_tbl8 = MAX_TBL8;
+
 	fib = rte_fib_create(__func__, SOCKET_ID_ANY, &config);
 	RTE_TEST_ASSERT(fib != NULL, "Failed to create FIB\n");
-	ret = check_fib(fib);
-	RTE_TEST_ASSERT(ret == TEST_SUCCESS,
-		"Check_fib fails for DIR24_8_8B type\n");
+
+	cache = rte_fib_cache_create(NULL, CACHE_ENTRIES, SOCKET_ID_ANY);
+	RTE_TEST_ASSERT(cache == NULL,
+		"Call succeeded with invalid parameters\n");
+	cache = rte_fib_cache_create(fib, CACHE_ENTRIES - 1, SOCKET_ID_ANY);
+	RTE_TEST_ASSERT(cache == NULL,
+		"Call succeeded with invalid parameters\n");
+	cache = rte_fib_cache_create(fib, RTE_FIB_CACHE_ENTRIES_MAX * 2,
+		SOCKET_ID_ANY);
+	RTE_TEST_ASSERT(cache == NULL,
+		"Call succeeded with invalid parameters\n");
+	ret = rte_fib_cache_lookup_bulk(NULL, ips, nh, 1);
+	RTE_TEST_ASSERT(ret == -EINVAL,
+		"Call succeeded with invalid parameters\n");
+	ret = rte_fib_cache_stats_get(NULL, &stats);
+	RTE_TEST_ASSERT(ret == -EINVAL,
+		"Call succeeded with invalid parameters\n");
+
+	cache = rte_fib_cache_create(fib, CACHE_ENTRIES, SOCKET_ID_ANY);
+	RTE_TEST_ASSERT(cache != NULL, "Failed to create cache\n");
+
+	/* First lookup misses, the next one hits */
+	ret = cache_lookup_one(cache, fib, ip, 1);
+	ret |= cache_lookup_one(cache, fib, ip, 1);
+	ret |= cache_check_stats(cache, 1, 1);
+	RTE_TEST_ASSERT(ret == TEST_SUCCESS, "Cache lookup fails\n");
+
+	/* Covering routes invalidate the entry, others do not */
+	ret = rte_fib_add(fib, RTE_IPV4(10, 1, 0, 0), 16, 2);
+	RTE_TEST_ASSERT(ret == 0, "Failed to add a route\n");
+	ret = cache_lookup_one(cache, fib, ip, 2);
+	ret |= cache_check_stats(cache, 0, 1);
+	RTE_TEST_ASSERT(ret == TEST_SUCCESS, "Cache lookup fails\n");
+
+	ret = rte_fib_add(fib, RTE_IPV4(192, 168, 0, 0), 16, 3);
+	RTE_TEST_ASSERT(ret == 0, "Failed to add a route\n");
+	ret = cache_lookup_one(cache, fib, ip, 2);
+	ret |= cache_check_stats(cache, 1, 0);
+	RTE_TEST_ASSERT(ret == TEST_SUCCESS, "Cache lookup fails\n");
+
+	ret = rte_fib_add(fib, ip, 32, 4);
+	RTE_TEST_ASSERT(ret == 0, "Failed to add a route\n");
+	ret = cache_lookup_one(cache, fib, ip, 4);
+	RTE_TEST_ASSERT(ret == TEST_SUCCESS, "Cache lookup fails\n");
+
+	ret = rte_fib_delete_bulk(fib, &ip, &(uint8_t){32}, 1, NULL);
+	RTE_TEST_ASSERT(ret == 1, "Failed to delete a route\n");
+	ret = cache_lookup_one(cache, fib, ip, 2);
+	RTE_TEST_ASSERT(ret == TEST_SUCCESS, "Cache lookup fails\n");
+
+	ret = rte_fib_add(fib, 0, 0, 5);
+	RTE_TEST_ASSERT(ret == 0, "Failed to add a route\n");
+	ret = cache_lookup_one(cache, fib, RTE_IPV4(172, 16, 0, 1), 5);
+	RTE_TEST_ASSERT(ret == TEST_SUCCESS, "Cache lookup fails\n");
+	rte_fib_cache_stats_reset(cache);
+
+	/* Random route churn around a few destinations */
+	for (i = 0; i < CACHE_DESTS; i++)
+		dests[i] = RTE_IPV4(10, 0, 0, 0) | (rte_rand() & 0xffffff);
+	for (i = 0; i < CACHE_ROUNDS; i++) {
+		for (j = 0; j < CACHE_LOOKUPS; j++)
+			ips[j] = dests[rte_rand() % CACHE_DESTS];
+		rte_fib_cache_lookup_bulk(cache, ips, nh, CACHE_LOOKUPS);
+		rte_fib_lookup_bulk(fib, ips, fib_nh, CACHE_LOOKUPS);
+		for (j = 0; j < CACHE_LOOKUPS; j++)
+			RTE_TEST_ASSERT(nh[j] == fib_nh[j],
+				"Lookup of %08x gives %"PRIu64
+				" instead of %"PRIu64"\n",
+				ips[j], nh[j], fib_nh[j]);
+
+		depth = 8 + rte_rand() % 25;
+		ip = dests[rte_rand() % CACHE_DESTS] &
+			rte_rib_depth_to_mask(depth);
+		if (rte_rand() & 1)
+			rte_fib_add(fib, ip, depth, 10 + i);
+		else
+			rte_fib_delete(fib, ip, depth);
+	}
+	ret = rte_fib_cache_stats_get(cache, &stats);
+	RTE_TEST_ASSERT((ret == 0) && (stats.hits + stats.misses ==
+		CACHE_ROUNDS * CACHE_LOOKUPS) && (stats.hits != 0),
+		"Unexpected cache stats\n");
+
+	rte_fib_cache_free(cache);
 	rte_fib_free(fib);
 
 	return TEST_SUCCESS;
 }
 
+#define SAVE_ROUTES	1024
+#define SAVE_TBL8	(1 << 12)
+#define SAVE_LOOKUPS	(1 << 16)
+
+/* Random addresses, plus addresses inside the routes */
+static void
+gen_save_ips(uint32_t *ips, const uint32_t *route_ips)
+{
+	unsigned int i;
+
+	for (i = 0; i < SAVE_LOOKUPS; i++) {
+		ips[i] = rte_rand();
+		if (i & 1)
+			ips[i] = route_ips[i % SAVE_ROUTES] ^ (ips[i] & 0xff);
+	}
+}
+
+static int
+compare_lookups(struct rte_fib *fib, struct rte_fib *restored,
+	const uint32_t *route_ips)
+{
+	static uint32_t ips[SAVE_LOOKUPS];
+	static uint64_t nh[SAVE_LOOKUPS], restored_nh[SAVE_LOOKUPS];
+
+	gen_save_ips(ips, route_ips);
+	rte_fib_lookup_bulk(fib, ips, nh, SAVE_LOOKUPS);
+	rte_fib_lookup_bulk(restored, ips, restored_nh, SAVE_LOOKUPS);
+	RTE_TEST_ASSERT(memcmp(nh, restored_nh, sizeof(nh)) == 0,
+		"Restored FIB lookups differ\n");
+
+	return TEST_SUCCESS;
+}
+
+/*
+ * Save FIBs with random routes, check the restored FIB gives the same
+ * lookup results, then that both stay the same after the same updates,
+ * which needs the RIB and the tbl8 allocation state to be restored too.
+ */
+int32_t
+test_save_restore(void)
+{
+	static uint32_t route_ips[SAVE_ROUTES];
+	static uint8_t depths[SAVE_ROUTES];
+	char filename[] = "/tmp/test_fib_XXXXXX";
+	struct rte_fib *fib, *restored;
+	struct rte_fib_conf config;
+	enum rte_fib_dir24_8_nh_sz nh_sz;
+	unsigned int i;
+	uint64_t nh;
+	FILE *f;
+	int fd, ret;
+
+	fd = mkstemp(filename);
+	RTE_TEST_ASSERT(fd >= 0, "Failed to create a temporary file\n");
+	close(fd);
+
+	config.max_routes = MAX_ROUTES;
+	config.default_nh = 1;
+	config.type = RTE_FIB_DIR24_8;
+
+	for (nh_sz = RTE_FIB_DIR24_8_1B; nh_sz <= RTE_FIB_DIR24_8_8B;
+			nh_sz++) {
+		config.dir24_8.nh_sz = nh_sz;
+		/* 1B next hops run out of tbl8s, failed adds must match too */
+		config.dir24_8.num_tbl8 = (nh_sz == RTE_FIB_DIR24_8_1B) ?
+			UINT8_MAX >> 1 : SAVE_TBL8;
+		fib = rte_fib_create(__func__, SOCKET_ID_ANY, &config);
+		RTE_TEST_ASSERT(fib != NULL, "Failed to create FIB\n");
+
+		for (i = 0; i < SAVE_ROUTES; i++) {
+			route_ips[i] = rte_rand();
+			depths[i] = 1 + rte_rand() % 32;
+			rte_fib_add(fib, route_ips[i], depths[i],
+				rte_rand() % 100);
+		}
+
+		ret = rte_fib_save(fib, filename);
+		RTE_TEST_ASSERT(ret == 0, "Failed to save FIB\n");
+		restored = rte_fib_restore("test_fib_restored", SOCKET_ID_ANY,
+			filename);
+		RTE_TEST_ASSERT(restored != NULL, "Failed to restore FIB\n");
+
+		ret = compare_lookups(fib, restored, route_ips);
+		RTE_TEST_ASSERT(ret == TEST_SUCCESS,
+			"Lookups differ for %uB next hops\n", 1 << nh_sz);
+
+		/* deletes fall back to the restored covering routes */
+		for (i = 0; i < SAVE_ROUTES; i += 2) {
+			nh = rte_rand() % 100;
+			rte_fib_delete(fib, route_ips[i], depths[i]);
+			rte_fib_delete(restored, route_ips[i], depths[i]);
+			rte_fib_add(fib, route_ips[i + 1], 28, nh);
+			rte_fib_add(restored, route_ips[i + 1], 28, nh);
+		}
+		ret = compare_lookups(fib, restored, route_ips);
+		RTE_TEST_ASSERT(ret == TEST_SUCCESS,
+			"Lookups differ after updates for %uB next hops\n",
+			1 << nh_sz);
+
+		rte_fib_free(restored);
+		rte_fib_free(fib);
+	}
+
+	/* invalid parameters and files */
+	ret = rte_fib_save(NULL, filename);
+	RTE_TEST_ASSERT(ret == -EINVAL,
+		"Call succeeded with invalid parameters\n");
+	restored = rte_fib_restore(NULL, SOCKET_ID_ANY, filename);
+	RTE_TEST_ASSERT(restored == NULL,
+		"Call succeeded with invalid parameters\n");
+	restored = rte_fib_restore("test_fib_restored", SOCKET_ID_ANY, NULL);
+	RTE_TEST_ASSERT(restored == NULL,
+		"Call succeeded with invalid parameters\n");
+
+	f = fopen(filename, "w");
+	RTE_TEST_ASSERT(f != NULL, "Failed to open the temporary file\n");
+	fprintf(f, "not a FIB");
+	fclose(f);
+	restored = rte_fib_restore("test_fib_restored", SOCKET_ID_ANY,
+		filename);
+	RTE_TEST_ASSERT((restored == NULL) && (rte_errno == EINVAL),
+		"Restored an invalid file\n");
+
+	unlink(filename);
+	restored = rte_fib_restore("test_fib_restored", SOCKET_ID_ANY,
+		filename);
+	RTE_TEST_ASSERT((restored == NULL) && (rte_errno == ENOENT),
+		"Restored a missing file\n");
+
+	return TEST_SUCCESS;
+}
+
 static struct unit_test_suite fib_fast_tests = {
 	.suite_name = "fib autotest",
 	.setup = NULL,
@@ -381,6 +1036,12 @@ static struct unit_test_suite fib_fast_tests = {
 	TEST_CASE(test_add_del_invalid),
 	TEST_CASE(test_get_invalid),
 	TEST_CASE(test_lookup),
+	TEST_CASE(test_invalid_rcu),
+	TEST_CASE(test_fib_rcu_qsbr),
+	TEST_CASE(test_bulk),
+	TEST_CASE(test_bulk_rollback),
+	TEST_CASE(test_cache),
+	TEST_CASE(test_save_restore),
 	TEST_CASES_END()
 	}
 };
@@ -6,11 +6,15 @@
 #include <stdio.h>
 #include <stdint.h>
 #include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
 
 #include <rte_memory.h>
 #include <rte_log.h>
 #include <rte_rib6.h>
 #include <rte_fib6.h>
+#include <rte_malloc.h>
+#include <rte_random.h>
 
 #include "test.h"
 
@@ -22,6 +26,9 @@ static int32_t test_free_null(void);
 static int32_t test_add_del_invalid(void);
 static int32_t test_get_invalid(void);
 static int32_t test_lookup(void);
+static int32_t test_invalid_rcu(void);
+static int32_t test_fib6_rcu_qsbr(void);
+static int32_t test_save_restore(void);
 
 #define MAX_ROUTES	(1 << 16)
 /** Maximum number of tbl8 for 2-byte entries */
@@ -35,7 +42,7 @@ int32_t
 test_create_invalid(void)
 {
 	struct rte_fib6 *fib = NULL;
-	struct rte_fib6_conf config;
+	struct rte_fib6_conf config = {0};
 
 	config.max_routes = MAX_ROUTES;
 	config.default_nh = 0;
@@ -79,6 +86,13 @@ test_create_invalid(void)
 
 	config.trie.num_tbl8 = 0;
 	fib = rte_fib6_create(__func__, SOCKET_ID_ANY, &config);
+	RTE_TEST_ASSERT(fib == NULL,
+		"Call succeeded with invalid parameters\n");
+	config.trie.num_tbl8 = MAX_TBL8;
+
+	/* first level stride not a multiple of 8 */
+	config.trie.root_stride = 12;
+	fib = rte_fib6_create(__func__, SOCKET_ID_ANY, &config);
 	RTE_TEST_ASSERT(fib == NULL,
 		"Call succeeded with invalid parameters\n");
 
@@ -93,7 +107,7 @@ int32_t
 test_multiple_create(void)
 {
 	struct rte_fib6 *fib = NULL;
-	struct rte_fib6_conf config;
+	struct rte_fib6_conf config = {0};
 	int32_t i;
 
 	config.default_nh = 0;
@@ -119,7 +133,7 @@ int32_t
 test_free_null(void)
 {
 	struct rte_fib6 *fib = NULL;
-	struct rte_fib6_conf config;
+	struct rte_fib6_conf config = {0};
 
 	config.max_routes = MAX_ROUTES;
 	config.default_nh = 0;
@@ -142,7 +156,7 @@ int32_t
 test_add_del_invalid(void)
 {
 	struct rte_fib6 *fib = NULL;
-	struct rte_fib6_conf config;
+	struct rte_fib6_conf config = {0};
 	uint64_t nh = 100;
 	uint8_t ip[RTE_FIB6_IPV6_ADDR_SIZE] = {0};
 	int ret;
@@ -198,6 +212,10 @@ test_get_invalid(void)
 	RTE_TEST_ASSERT(p == NULL,
 		"Call succeeded with invalid parameters\n");
 
+	RTE_TEST_ASSERT(rte_fib6_set_lookup_fn(NULL,
+		RTE_FIB6_LOOKUP_DEFAULT) < 0,
+		"Call succeeded with invalid parameters\n");
+
 	return TEST_SUCCESS;
 }
 
@@ -333,8 +351,18 @@ int32_t
 test_lookup(void)
 {
 	struct rte_fib6 *fib = NULL;
-	struct rte_fib6_conf config;
+	struct rte_fib6_conf config = {0};
 	uint64_t def_nh = 100;
+	const enum rte_fib6_lookup_type lookup_types[] = {
+		RTE_FIB6_LOOKUP_DEFAULT,
+		RTE_FIB6_LOOKUP_TRIE_SCALAR,
+		RTE_FIB6_LOOKUP_TRIE_VECTOR_AVX512
+	};
+	/* default 24-bit first level, then the compressed ones */
+	const uint8_t root_strides[] = {0, 16, 8};
+	enum rte_fib6_lookup_type type;
+	enum rte_fib_trie_nh_sz nh_sz;
+	unsigned int i;
 	int ret;
 
 	config.max_routes = MAX_ROUTES;
@@ -350,32 +378,339 @@ test_lookup(void)
 
 	config.type = RTE_FIB6_TRIE;
 
-	config.trie.nh_sz = RTE_FIB6_TRIE_2B;
-	config.trie.num_tbl8 = MAX_TBL8 - 1;
+	for (nh_sz = RTE_FIB6_TRIE_2B; nh_sz <= RTE_FIB6_TRIE_8B; nh_sz++) {
+		config.trie.nh_sz = nh_sz;
+		config.trie.num_tbl8 = (nh_sz == RTE_FIB6_TRIE_2B) ?
+			MAX_TBL8 - 1 : MAX_TBL8;
+		for (i = 0; i < RTE_DIM(root_strides) *
+				RTE_DIM(lookup_types); i++) {
+			config.trie.root_stride =
+				root_strides[i / RTE_DIM(lookup_types)];
+			type = lookup_types[i % RTE_DIM(lookup_types)];
+			fib = rte_fib6_create(__func__, SOCKET_ID_ANY,
+				&config);
+			RTE_TEST_ASSERT(fib != NULL,
+				"Failed to create FIB\n");
+			if (rte_fib6_set_lookup_fn(fib, type) != 0) {
+				/* Vector lookup not supported by the CPU */
+				RTE_TEST_ASSERT(type ==
+					RTE_FIB6_LOOKUP_TRIE_VECTOR_AVX512,
+					"Failed to set lookup function\n");
+				rte_fib6_free(fib);
+				continue;
+			}
+			ret = check_fib(fib);
+			RTE_TEST_ASSERT(ret == TEST_SUCCESS,
+				"Check_fib fails for TRIE_%uB type, "
+				"root stride %u, lookup type %d\n",
+				1 << nh_sz, config.trie.root_stride, type);
+			rte_fib6_free(fib);
+		}
+	}
+
+	return TEST_SUCCESS;
+}
+
+/*
+ * rte_fib6_rcu_qsbr_add positive and negative tests.
+ *  - Add RCU QSBR variable to FIB
+ *  - Add another RCU QSBR variable to FIB
+ *  - Check returns
+ */
+int32_t
+test_invalid_rcu(void)
+{
+	struct rte_fib6 *fib = NULL;
+	struct rte_fib6_conf config = {0};
+	size_t sz;
+	struct rte_rcu_qsbr *qsv;
+	struct rte_rcu_qsbr *qsv2;
+	int32_t status;
+	struct rte_fib6_rcu_config rcu_cfg = {0};
+
+	config.max_routes = MAX_ROUTES;
+	config.default_nh = 0;
+	config.type = RTE_FIB6_DUMMY;
+
+	/* Create RCU QSBR variable */
+	sz = rte_rcu_qsbr_get_memsize(RTE_MAX_LCORE);
+	qsv = (struct rte_rcu_qsbr *)rte_zmalloc_socket(NULL, sz,
+					RTE_CACHE_LINE_SIZE, SOCKET_ID_ANY);
+	RTE_TEST_ASSERT(qsv != NULL, "Can not allocate memory for RCU\n");
+
+	status = rte_rcu_qsbr_init(qsv, RTE_MAX_LCORE);
+	RTE_TEST_ASSERT(status == 0, "Can not initialize RCU\n");
+
+	rcu_cfg.v = qsv;
+
+	/* rte_fib6_rcu_qsbr_add: fib == NULL */
+	status = rte_fib6_rcu_qsbr_add(NULL, &rcu_cfg);
+	RTE_TEST_ASSERT(status == -EINVAL,
+		"Call succeeded with invalid parameters\n");
+
+	/* RIB based FIB6 does not support RCU */
 	fib = rte_fib6_create(__func__, SOCKET_ID_ANY, &config);
 	RTE_TEST_ASSERT(fib != NULL, "Failed to create FIB\n");
-	ret = check_fib(fib);
-	RTE_TEST_ASSERT(ret == TEST_SUCCESS,
-		"Check_fib fails for TRIE_2B type\n");
+	status = rte_fib6_rcu_qsbr_add(fib, &rcu_cfg);
+	RTE_TEST_ASSERT(status == -ENOTSUP,
+		"Call succeeded with unsupported FIB type\n");
 	rte_fib6_free(fib);
 
+	config.type = RTE_FIB6_TRIE;
 	config.trie.nh_sz = RTE_FIB6_TRIE_4B;
 	config.trie.num_tbl8 = MAX_TBL8;
 	fib = rte_fib6_create(__func__, SOCKET_ID_ANY, &config);
 	RTE_TEST_ASSERT(fib != NULL, "Failed to create FIB\n");
-	ret = check_fib(fib);
-	RTE_TEST_ASSERT(ret == TEST_SUCCESS,
-		"Check_fib fails for TRIE_4B type\n");
-	rte_fib6_free(fib);
 
-	config.trie.nh_sz = RTE_FIB6_TRIE_8B;
-	config.trie.num_tbl8 = MAX_TBL8;
-	fib = rte_fib6_create(__func__, SOCKET_ID_ANY, &config);
-	RTE_TEST_ASSERT(fib != NULL, "Failed to create FIB\n");
-	ret = check_fib(fib);
-	RTE_TEST_ASSERT(ret == TEST_SUCCESS,
-		"Check_fib fails for TRIE_8B type\n");
+	/* rte_fib6_rcu_qsbr_add: cfg == NULL */
+	status = rte_fib6_rcu_qsbr_add(fib, NULL);
+	RTE_TEST_ASSERT(status == -EINVAL,
+		"Call succeeded with invalid parameters\n");
+
+	/* rte_fib6_rcu_qsbr_add: invalid mode */
+	rcu_cfg.mode = 2;
+	status = rte_fib6_rcu_qsbr_add(fib, &rcu_cfg);
+	RTE_TEST_ASSERT(status == -EINVAL,
+		"Call succeeded with invalid parameters\n");
+
+	/* Attach RCU QSBR to FIB table */
+	rcu_cfg.mode = RTE_FIB6_QSBR_MODE_DQ;
+	status = rte_fib6_rcu_qsbr_add(fib, &rcu_cfg);
+	RTE_TEST_ASSERT(status == 0, "Can not attach RCU to FIB\n");
+
+	/* Create and attach another RCU QSBR to FIB table */
+	qsv2 = (struct rte_rcu_qsbr *)rte_zmalloc_socket(NULL, sz,
+					RTE_CACHE_LINE_SIZE, SOCKET_ID_ANY);
+	RTE_TEST_ASSERT(qsv2 != NULL, "Can not allocate memory for RCU\n");
+
+	rcu_cfg.v = qsv2;
+	rcu_cfg.mode = RTE_FIB6_QSBR_MODE_SYNC;
+	status = rte_fib6_rcu_qsbr_add(fib, &rcu_cfg);
+	RTE_TEST_ASSERT(status == -EEXIST,
+		"Secondary RCU was mistakenly attached\n");
+
 	rte_fib6_free(fib);
+	rte_free(qsv);
+	rte_free(qsv2);
+
+	return TEST_SUCCESS;
+}
+
+/*
+ * Delete routes while a reader is online and check the tbl8 groups are
+ * given back once the reader went through a quiescent state, in both
+ * reclamation modes. A deletion may need a transient tbl8 group, leave
+ * enough free groups for the deletions not to wait for the reader.
+ */
+int32_t
+test_fib6_rcu_qsbr(void)
+{
+	struct rte_fib6 *fib = NULL;
+	struct rte_fib6_conf config = {0};
+	struct rte_fib6_rcu_config rcu_cfg = {0};
+	struct rte_rcu_qsbr *qsv;
+	uint8_t ip[RTE_FIB6_IPV6_ADDR_SIZE] = {0x20, 0x01};
+	uint8_t ip_arr[1][RTE_FIB6_IPV6_ADDR_SIZE];
+	uint32_t num_tbl8 = 64, num_routes = num_tbl8 / 4;
+	uint64_t nh;
+	unsigned int i, j;
+	int32_t status;
+	const enum rte_fib6_qsbr_mode modes[] = {
+		RTE_FIB6_QSBR_MODE_DQ,
+		RTE_FIB6_QSBR_MODE_SYNC
+	};
+
+	qsv = (struct rte_rcu_qsbr *)rte_zmalloc_socket(NULL,
+			rte_rcu_qsbr_get_memsize(RTE_MAX_LCORE),
+			RTE_CACHE_LINE_SIZE, SOCKET_ID_ANY);
+	RTE_TEST_ASSERT(qsv != NULL, "Can not allocate memory for RCU\n");
+
+	config.max_routes = MAX_ROUTES;
+	config.default_nh = 0;
+	config.type = RTE_FIB6_TRIE;
+	config.trie.nh_sz = RTE_FIB6_TRIE_4B;
+	config.trie.num_tbl8 = num_tbl8;
+
+	for (i = 0; i < RTE_DIM(modes); i++) {
+		status = rte_rcu_qsbr_init(qsv, RTE_MAX_LCORE);
+		RTE_TEST_ASSERT(status == 0, "Can not initialize RCU\n");
+		rte_rcu_qsbr_thread_register(qsv, 0);
+
+		fib = rte_fib6_create(__func__, SOCKET_ID_ANY, &config);
+		RTE_TEST_ASSERT(fib != NULL, "Failed to create FIB\n");
+		rcu_cfg.v = qsv;
+		rcu_cfg.mode = modes[i];
+		status = rte_fib6_rcu_qsbr_add(fib, &rcu_cfg);
+		RTE_TEST_ASSERT(status == 0, "Can not attach RCU to FIB\n");
+
+		/* One /32 route in each /24 */
+		for (j = 0; j < num_routes; j++) {
+			ip[2] = j;
+			status = rte_fib6_add(fib, ip, 32, j + 1);
+			RTE_TEST_ASSERT(status == 0, "Failed to add a route\n");
+		}
+
+		/* In blocking mode the reader must not hold the writer */
+		if (modes[i] == RTE_FIB6_QSBR_MODE_DQ)
+			rte_rcu_qsbr_thread_online(qsv, 0);
+		for (j = 0; j < num_routes; j++) {
+			ip[2] = j;
+			status = rte_fib6_delete(fib, ip, 32);
+			RTE_TEST_ASSERT(status == 0,
+				"Failed to delete a route\n");
+			memcpy(ip_arr[0], ip, RTE_FIB6_IPV6_ADDR_SIZE);
+			rte_fib6_lookup_bulk(fib, ip_arr, &nh, 1);
+			RTE_TEST_ASSERT(nh == 0,
+				"Failed to get proper nexthop\n");
+		}
+		rte_rcu_qsbr_quiescent(qsv, 0);
+		rte_rcu_qsbr_thread_offline(qsv, 0);
+
+		/*
+		 * All the groups must be available again, one is kept spare
+		 * by the tbl8 reservation
+		 */
+		ip[1] = 0x02;
+		for (j = 0; j < num_tbl8 - 1; j++) {
+			ip[2] = j;
+			status = rte_fib6_add(fib, ip, 32, j + 1);
+			RTE_TEST_ASSERT(status == 0,
+				"tbl8 groups were not reclaimed\n");
+			memcpy(ip_arr[0], ip, RTE_FIB6_IPV6_ADDR_SIZE);
+			rte_fib6_lookup_bulk(fib, ip_arr, &nh, 1);
+			RTE_TEST_ASSERT(nh == j + 1,
+				"Failed to get proper nexthop\n");
+		}
+
+		ip[1] = 0x01;
+		rte_rcu_qsbr_thread_unregister(qsv, 0);
+		rte_fib6_free(fib);
+	}
+
+	rte_free(qsv);
+
+	return TEST_SUCCESS;
+}
+
+#define SAVE_ROUTES	1024
+#define SAVE_TBL8	(1 << 12)
+#define SAVE_LOOKUPS	(1 << 14)
+
+static void
+gen_rand_ip6(uint8_t ip[RTE_FIB6_IPV6_ADDR_SIZE])
+{
+	unsigned int i;
+
+	for (i = 0; i < RTE_FIB6_IPV6_ADDR_SIZE; i++)
+		ip[i] = rte_rand();
+}
+
+static int
+compare_lookups(struct rte_fib6 *fib, struct rte_fib6 *restored,
+	uint8_t route_ips[][RTE_FIB6_IPV6_ADDR_SIZE])
+{
+	static uint8_t ips[SAVE_LOOKUPS][RTE_FIB6_IPV6_ADDR_SIZE];
+	static uint64_t nh[SAVE_LOOKUPS], restored_nh[SAVE_LOOKUPS];
+	unsigned int i;
+
+	/* random addresses, plus addresses inside the routes */
+	for (i = 0; i < SAVE_LOOKUPS; i++) {
+		gen_rand_ip6(ips[i]);
+		if (i & 1)
+			memcpy(ips[i], route_ips[i % SAVE_ROUTES],
+				RTE_FIB6_IPV6_ADDR_SIZE - 1);
+	}
+	rte_fib6_lookup_bulk(fib, ips, nh, SAVE_LOOKUPS);
+	rte_fib6_lookup_bulk(restored, ips, restored_nh, SAVE_LOOKUPS);
+	RTE_TEST_ASSERT(memcmp(nh, restored_nh, sizeof(nh)) == 0,
+		"Restored FIB lookups differ\n");
+
+	return TEST_SUCCESS;
+}
+
+/*
+ * Save FIBs with random routes, check the restored FIB gives the same
+ * lookup results, then that both stay the same after the same updates.
+ */
+int32_t
+test_save_restore(void)
+{
+	static uint8_t route_ips[SAVE_ROUTES][RTE_FIB6_IPV6_ADDR_SIZE];
+	static uint8_t depths[SAVE_ROUTES];
+	const struct {
+		enum rte_fib_trie_nh_sz nh_sz;
+		uint8_t root_stride;
+	} configs[] = {
+		{ RTE_FIB6_TRIE_2B, 0 },
+		{ RTE_FIB6_TRIE_4B, 16 },
+		{ RTE_FIB6_TRIE_8B, 8 },
+	};
+	char filename[] = "/tmp/test_fib6_XXXXXX";
+	struct rte_fib6 *fib, *restored;
+	struct rte_fib6_conf config = {0};
+	unsigned int i, j;
+	uint64_t nh;
+	int fd, ret;
+
+	fd = mkstemp(filename);
+	RTE_TEST_ASSERT(fd >= 0, "Failed to create a temporary file\n");
+	close(fd);
+
+	config.max_routes = MAX_ROUTES;
+	config.default_nh = 1;
+	config.type = RTE_FIB6_TRIE;
+	config.trie.num_tbl8 = SAVE_TBL8;
+
+	for (j = 0; j < RTE_DIM(configs); j++) {
+		config.trie.nh_sz = configs[j].nh_sz;
+		config.trie.root_stride = configs[j].root_stride;
+		fib = rte_fib6_create(__func__, SOCKET_ID_ANY, &config);
+		RTE_TEST_ASSERT(fib != NULL, "Failed to create FIB\n");
+
+		for (i = 0; i < SAVE_ROUTES; i++) {
+			gen_rand_ip6(route_ips[i]);
+			depths[i] = 1 + rte_rand() % 64;
+			rte_fib6_add(fib, route_ips[i], depths[i],
+				rte_rand() % 100);
+		}
+
+		ret = rte_fib6_save(fib, filename);
+		RTE_TEST_ASSERT(ret == 0, "Failed to save FIB\n");
+		restored = rte_fib6_restore("test_fib6_restored",
+			SOCKET_ID_ANY, filename);
+		RTE_TEST_ASSERT(restored != NULL, "Failed to restore FIB\n");
+
+		ret = compare_lookups(fib, restored, route_ips);
+		RTE_TEST_ASSERT(ret == TEST_SUCCESS,
+			"Lookups differ for config %u\n", j);
+
+		/* deletes fall back to the restored covering routes */
+		for (i = 0; i < SAVE_ROUTES; i += 2) {
+			nh = rte_rand() % 100;
+			rte_fib6_delete(fib, route_ips[i], depths[i]);
+			rte_fib6_delete(restored, route_ips[i], depths[i]);
+			rte_fib6_add(fib, route_ips[i + 1], 96, nh);
+			rte_fib6_add(restored, route_ips[i + 1], 96, nh);
+		}
+		ret = compare_lookups(fib, restored, route_ips);
+		RTE_TEST_ASSERT(ret == TEST_SUCCESS,
+			"Lookups differ after updates for config %u\n", j);
+
+		rte_fib6_free(restored);
+		rte_fib6_free(fib);
+	}
+
+	ret = rte_fib6_save(NULL, filename);
+	RTE_TEST_ASSERT(ret == -EINVAL,
+		"Call succeeded with invalid parameters\n");
+	restored = rte_fib6_restore(NULL, SOCKET_ID_ANY, filename);
+	RTE_TEST_ASSERT(restored == NULL,
+		"Call succeeded with invalid parameters\n");
+
+	unlink(filename);
+	restored = rte_fib6_restore("test_fib6_restored", SOCKET_ID_ANY,
+		filename);
+	RTE_TEST_ASSERT(restored == NULL, "Restored a missing file\n");
 
 	return TEST_SUCCESS;
 }
@@ -390,6 +725,9 @@ static struct unit_test_suite fib6_fast_tests = {
 	TEST_CASE(test_add_del_invalid),
 	TEST_CASE(test_get_invalid),
 	TEST_CASE(test_lookup),
+	TEST_CASE(test_invalid_rcu),
+	TEST_CASE(test_fib6_rcu_qsbr),
+	TEST_CASE(test_save_restore),
 	TEST_CASES_END()
 	}
 };
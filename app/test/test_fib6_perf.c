@@ -66,14 +66,23 @@ static int
 test_fib6_perf(void)
 {
 	struct rte_fib6 *fib = NULL;
-	struct rte_fib6_conf conf;
+	struct rte_fib6_conf conf = {0};
 	uint64_t begin, total_time;
-	unsigned int i, j;
+	unsigned int i, j, r, t;
 	uint64_t next_hop_add;
 	int status = 0;
 	int64_t count = 0;
 	uint8_t ip_batch[NUM_IPS_ENTRIES][16];
 	uint64_t next_hops[NUM_IPS_ENTRIES];
+	/* default 24-bit first level, then the compressed ones */
+	static const uint8_t root_strides[] = {24, 16, 8};
+	static const struct {
+		enum rte_fib6_lookup_type type;
+		const char *name;
+	} lookup_types[] = {
+		{ RTE_FIB6_LOOKUP_TRIE_SCALAR, "scalar" },
+		{ RTE_FIB6_LOOKUP_TRIE_VECTOR_AVX512, "vector AVX512" },
+	};
 
 	conf.type = RTE_FIB6_TRIE;
 	conf.default_nh = 0;
@@ -93,63 +102,81 @@ test_fib6_perf(void)
 	 */
 	generate_large_ips_table(0);
 
-	fib = rte_fib6_create(__func__, SOCKET_ID_ANY, &conf);
-	TEST_FIB_ASSERT(fib != NULL);
-
-	/* Measure add. */
-	begin = rte_rdtsc();
-
-	for (i = 0; i < NUM_ROUTE_ENTRIES; i++) {
-		next_hop_add = (i & ((1 << 14) - 1)) + 1;
-		if (rte_fib6_add(fib, large_route_table[i].ip,
-				large_route_table[i].depth, next_hop_add) == 0)
-			status++;
-	}
-	/* End Timer. */
-	total_time = rte_rdtsc() - begin;
-
-	printf("Unique added entries = %d\n", status);
-	printf("Average FIB Add: %g cycles\n",
-			(double)total_time / NUM_ROUTE_ENTRIES);
-
-	/* Measure bulk Lookup */
-	total_time = 0;
-	count = 0;
-
 	for (i = 0; i < NUM_IPS_ENTRIES; i++)
 		memcpy(ip_batch[i], large_ips_table[i].ip, 16);
 
-	for (i = 0; i < ITERATIONS; i++) {
+	for (r = 0; r < RTE_DIM(root_strides); r++) {
+		conf.trie.root_stride = root_strides[r];
+		printf("First level stride: %u bits\n", root_strides[r]);
 
-		/* Lookup per batch */
+		fib = rte_fib6_create(__func__, SOCKET_ID_ANY, &conf);
+		TEST_FIB_ASSERT(fib != NULL);
+
+		/* Measure add. */
+		status = 0;
 		begin = rte_rdtsc();
-		rte_fib6_lookup_bulk(fib, ip_batch, next_hops, NUM_IPS_ENTRIES);
-		total_time += rte_rdtsc() - begin;
 
-		for (j = 0; j < NUM_IPS_ENTRIES; j++)
-			if (next_hops[j] == 0)
-				count++;
-	}
-	printf("BULK FIB Lookup: %.1f cycles (fails = %.1f%%)\n",
-			(double)total_time / ((double)ITERATIONS * BATCH_SIZE),
-			(count * 100.0) / (double)(ITERATIONS * BATCH_SIZE));
-
-	/* Delete */
-	status = 0;
-	begin = rte_rdtsc();
-
-	for (i = 0; i < NUM_ROUTE_ENTRIES; i++) {
-		/* rte_fib_delete(fib, ip, depth) */
-		status += rte_fib6_delete(fib, large_route_table[i].ip,
-				large_route_table[i].depth);
-	}
+		for (i = 0; i < NUM_ROUTE_ENTRIES; i++) {
+			next_hop_add = (i & ((1 << 14) - 1)) + 1;
+			if (rte_fib6_add(fib, large_route_table[i].ip,
+					large_route_table[i].depth,
+					next_hop_add) == 0)
+				status++;
+		}
+		/* End Timer. */
+		total_time = rte_rdtsc() - begin;
+
+		printf("Unique added entries = %d\n", status);
+		printf("Average FIB Add: %g cycles\n",
+				(double)total_time / NUM_ROUTE_ENTRIES);
+
+		/* Measure bulk Lookup with each lookup function */
+		for (t = 0; t < RTE_DIM(lookup_types); t++) {
+			if (rte_fib6_set_lookup_fn(fib,
+					lookup_types[t].type) != 0) {
+				printf("BULK FIB Lookup %s: not supported\n",
+					lookup_types[t].name);
+				continue;
+			}
+			total_time = 0;
+			count = 0;
+			for (i = 0; i < ITERATIONS; i++) {
+
+				/* Lookup per batch */
+				begin = rte_rdtsc();
+				rte_fib6_lookup_bulk(fib, ip_batch, next_hops,
+					NUM_IPS_ENTRIES);
+				total_time += rte_rdtsc() - begin;
+
+				for (j = 0; j < NUM_IPS_ENTRIES; j++)
+					if (next_hops[j] == 0)
+						count++;
+			}
+			printf("BULK FIB Lookup %s: %.1f cycles "
+				"(fails = %.1f%%)\n", lookup_types[t].name,
+				(double)total_time /
+				((double)ITERATIONS * BATCH_SIZE),
+				(count * 100.0) /
+				(double)(ITERATIONS * BATCH_SIZE));
+		}
+
+		/* Delete */
+		status = 0;
+		begin = rte_rdtsc();
+
+		for (i = 0; i < NUM_ROUTE_ENTRIES; i++) {
+			/* rte_fib_delete(fib, ip, depth) */
+			status += rte_fib6_delete(fib, large_route_table[i].ip,
+					large_route_table[i].depth);
+		}
 
-	total_time = rte_rdtsc() - begin;
+		total_time = rte_rdtsc() - begin;
 
-	printf("Average FIB Delete: %g cycles\n",
-			(double)total_time / NUM_ROUTE_ENTRIES);
+		printf("Average FIB Delete: %g cycles\n",
+				(double)total_time / NUM_ROUTE_ENTRIES);
 
-	rte_fib6_free(fib);
+		rte_fib6_free(fib);
+	}
 
 	return 0;
 }
@@ -30,6 +30,11 @@
 
 #define MAX_RULE_NUM (1200000)
 
+#define CACHE_ENTRIES (1 << 14)
+#define CACHE_HOT_DESTS (1 << 12)
+/* 1 in CACHE_COLD_RATIO addresses is not taken from the hot set */
+#define CACHE_COLD_RATIO 16
+
 struct route_rule {
 	uint32_t ip;
 	uint8_t depth;
@@ -316,6 +321,130 @@ print_route_distribution(const struct route_rule *table, uint32_t n)
 	printf("\n");
 }
 
+/*
+ * Load the whole route table with rte_fib_add_bulk, check it gives the
+ * same lookup results as the FIB built route by route, then delete it
+ * with rte_fib_delete_bulk.
+ */
+static int
+test_fib_perf_bulk(struct rte_fib *ref, struct rte_fib_conf *config,
+	uint32_t next_hop_add)
+{
+	static uint32_t ips[MAX_RULE_NUM];
+	static uint8_t depths[MAX_RULE_NUM];
+	static uint64_t next_hops[MAX_RULE_NUM];
+	static uint32_t ip_batch[BATCH_SIZE];
+	static uint64_t nh[BATCH_SIZE], ref_nh[BATCH_SIZE];
+	struct rte_fib *fib;
+	uint64_t begin, total_time;
+	unsigned int i, j;
+	int ret;
+
+	for (i = 0; i < NUM_ROUTE_ENTRIES; i++) {
+		ips[i] = large_route_table[i].ip;
+		depths[i] = large_route_table[i].depth;
+		next_hops[i] = next_hop_add + (i & 0xff);
+	}
+
+	fib = rte_fib_create("test_fib_perf_bulk", SOCKET_ID_ANY, config);
+	TEST_FIB_ASSERT(fib != NULL);
+
+	begin = rte_rdtsc();
+	ret = rte_fib_add_bulk(fib, ips, depths, next_hops,
+		NUM_ROUTE_ENTRIES, NULL);
+	total_time = rte_rdtsc() - begin;
+	TEST_FIB_ASSERT(ret > 0);
+
+	printf("Bulk added entries = %d\n", ret);
+	printf("Average FIB Bulk Add: %g cycles, table loaded in %.1f ms\n",
+		(double)total_time / NUM_ROUTE_ENTRIES,
+		(double)total_time * 1000 / rte_get_tsc_hz());
+
+	for (i = 0; i < ITERATIONS; i++) {
+		for (j = 0; j < BATCH_SIZE; j++)
+			ip_batch[j] = rte_rand();
+		rte_fib_lookup_bulk(fib, ip_batch, nh, BATCH_SIZE);
+		rte_fib_lookup_bulk(ref, ip_batch, ref_nh, BATCH_SIZE);
+		for (j = 0; j < BATCH_SIZE; j++) {
+			if (nh[j] != ref_nh[j]) {
+				printf("Bulk FIB mismatch for %08x\n",
+					ip_batch[j]);
+				rte_fib_free(fib);
+				return -1;
+			}
+		}
+	}
+
+	begin = rte_rdtsc();
+	ret = rte_fib_delete_bulk(fib, ips, depths, NUM_ROUTE_ENTRIES, NULL);
+	total_time = rte_rdtsc() - begin;
+	TEST_FIB_ASSERT(ret > 0);
+
+	printf("Average FIB Bulk Delete: %g cycles\n",
+		(double)total_time / NUM_ROUTE_ENTRIES);
+
+	rte_fib_free(fib);
+
+	return 0;
+}
+
+/*
+ * Compare plain bulk lookups with lookups through a cache on skewed
+ * traffic, where most of the addresses come from a small hot set of
+ * destinations.
+ */
+static int
+test_fib_perf_cache(struct rte_fib *fib)
+{
+	static uint32_t hot[CACHE_HOT_DESTS];
+	static uint32_t ip_batch[BATCH_SIZE];
+	uint64_t next_hops[BULK_SIZE];
+	uint64_t begin, fib_time = 0, cache_time = 0;
+	struct rte_fib_cache_stats stats;
+	struct rte_fib_cache *cache;
+	unsigned int i, j;
+
+	cache = rte_fib_cache_create(fib, CACHE_ENTRIES, SOCKET_ID_ANY);
+	TEST_FIB_ASSERT(cache != NULL);
+
+	for (i = 0; i < CACHE_HOT_DESTS; i++)
+		hot[i] = rte_rand();
+
+	for (i = 0; i < ITERATIONS; i++) {
+		for (j = 0; j < BATCH_SIZE; j++) {
+			if (rte_rand() % CACHE_COLD_RATIO == 0)
+				ip_batch[j] = rte_rand();
+			else
+				ip_batch[j] = hot[rte_rand() % CACHE_HOT_DESTS];
+		}
+
+		begin = rte_rdtsc();
+		for (j = 0; j < BATCH_SIZE; j += BULK_SIZE)
+			rte_fib_lookup_bulk(fib, &ip_batch[j], next_hops,
+				BULK_SIZE);
+		fib_time += rte_rdtsc() - begin;
+
+		begin = rte_rdtsc();
+		for (j = 0; j < BATCH_SIZE; j += BULK_SIZE)
+			rte_fib_cache_lookup_bulk(cache, &ip_batch[j],
+				next_hops, BULK_SIZE);
+		cache_time += rte_rdtsc() - begin;
+	}
+
+	rte_fib_cache_stats_get(cache, &stats);
+	printf("Skewed traffic, %u hot destinations, %u cache entries:\n",
+		CACHE_HOT_DESTS, CACHE_ENTRIES);
+	printf("BULK FIB Lookup: %.1f cycles\n",
+		(double)fib_time / ((double)ITERATIONS * BATCH_SIZE));
+	printf("BULK FIB Cache Lookup: %.1f cycles (hits = %.1f%%)\n",
+		(double)cache_time / ((double)ITERATIONS * BATCH_SIZE),
+		(stats.hits * 100.0) / (double)(stats.hits + stats.misses));
+
+	rte_fib_cache_free(cache);
+
+	return 0;
+}
+
 static int
 test_fib_perf(void)
 {
@@ -328,8 +457,17 @@ test_fib_perf(void)
 	config.dir24_8.nh_sz = RTE_FIB_DIR24_8_4B;
 	config.dir24_8.num_tbl8 = 65535;
 	uint64_t begin, total_time;
-	unsigned int i, j;
+	unsigned int i, j, t;
 	uint32_t next_hop_add = 0xAA;
+	static const struct {
+		enum rte_fib_lookup_type type;
+		const char *name;
+	} lookup_types[] = {
+		{ RTE_FIB_LOOKUP_DIR24_8_SCALAR_MACRO, "scalar macro" },
+		{ RTE_FIB_LOOKUP_DIR24_8_SCALAR_INLINE, "scalar inline" },
+		{ RTE_FIB_LOOKUP_DIR24_8_SCALAR_UNI, "scalar uni" },
+		{ RTE_FIB_LOOKUP_DIR24_8_VECTOR_AVX512, "vector AVX512" },
+	};
 	int status = 0;
 	int64_t count = 0;
 
@@ -350,7 +488,8 @@ test_fib_perf(void)
 
 	for (i = 0; i < NUM_ROUTE_ENTRIES; i++) {
 		if (rte_fib_add(fib, large_route_table[i].ip,
-				large_route_table[i].depth, next_hop_add) == 0)
+				large_route_table[i].depth,
+				next_hop_add + (i & 0xff)) == 0)
 			status++;
 	}
 	/* End Timer. */
@@ -358,38 +497,56 @@ test_fib_perf(void)
 
 	printf("Unique added entries = %d\n", status);
 
-	printf("Average FIB Add: %g cycles\n",
-			(double)total_time / NUM_ROUTE_ENTRIES);
+	printf("Average FIB Add: %g cycles, table loaded in %.1f ms\n",
+			(double)total_time / NUM_ROUTE_ENTRIES,
+			(double)total_time * 1000 / rte_get_tsc_hz());
 
-	/* Measure bulk Lookup */
-	total_time = 0;
-	count = 0;
-	for (i = 0; i < ITERATIONS; i++) {
-		static uint32_t ip_batch[BATCH_SIZE];
-		uint64_t next_hops[BULK_SIZE];
-
-		/* Create array of random IP addresses */
-		for (j = 0; j < BATCH_SIZE; j++)
-			ip_batch[j] = rte_rand();
-
-		/* Lookup per batch */
-		begin = rte_rdtsc();
-		for (j = 0; j < BATCH_SIZE; j += BULK_SIZE) {
-			uint32_t k;
-			rte_fib_lookup_bulk(fib, &ip_batch[j], next_hops,
-				BULK_SIZE);
-			for (k = 0; k < BULK_SIZE; k++)
-				if (unlikely(!(next_hops[k] != 0)))
-					count++;
+	/* Measure bulk Lookup with each lookup function */
+	for (t = 0; t < RTE_DIM(lookup_types); t++) {
+		if (rte_fib_set_lookup_fn(fib, lookup_types[t].type) != 0) {
+			printf("BULK FIB Lookup %s: not supported\n",
+				lookup_types[t].name);
+			continue;
 		}
-
-		total_time += rte_rdtsc() - begin;
-	}
-	printf("BULK FIB Lookup: %.1f cycles (fails = %.1f%%)\n",
+		total_time = 0;
+		count = 0;
+		for (i = 0; i < ITERATIONS; i++) {
+			static uint32_t ip_batch[BATCH_SIZE];
+			uint64_t next_hops[BULK_SIZE];
+
+			/* Create array of random IP addresses */
+			for (j = 0; j < BATCH_SIZE; j++)
+				ip_batch[j] = rte_rand();
+
+			/* Lookup per batch */
+			begin = rte_rdtsc();
+			for (j = 0; j < BATCH_SIZE; j += BULK_SIZE) {
+				uint32_t k;
+				rte_fib_lookup_bulk(fib, &ip_batch[j],
+					next_hops, BULK_SIZE);
+				for (k = 0; k < BULK_SIZE; k++)
+					if (unlikely(!(next_hops[k] != 0)))
+						count++;
+			}
+
+			total_time += rte_rdtsc() - begin;
+		}
+		printf("BULK FIB Lookup %s: %.1f cycles (fails = %.1f%%)\n",
+			lookup_types[t].name,
 			(double)total_time / ((double)ITERATIONS * BATCH_SIZE),
 			(count * 100.0) / (double)(ITERATIONS * BATCH_SIZE));
+	}
+
+	/* Measure the same table loaded with one bulk add */
+	status = test_fib_perf_bulk(fib, &config, next_hop_add);
+	TEST_FIB_ASSERT(status == 0);
+
+	/* Measure lookups through a cache */
+	status = test_fib_perf_cache(fib);
+	TEST_FIB_ASSERT(status == 0);
 
 	/* Delete */
+	total_time = 0;
 	status = 0;
 	begin = rte_rdtsc();
 	for (i = 0; i < NUM_ROUTE_ENTRIES; i++) {
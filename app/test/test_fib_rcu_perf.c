@@ -0,0 +1,308 @@
+/* SPDX-License-Identifier: BSD-3-Clause
+ * Copyright(c) 2020 Intel Corporation
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <inttypes.h>
+
+#include <rte_cycles.h>
+#include <rte_lcore.h>
+#include <rte_launch.h>
+#include <rte_malloc.h>
+#include <rte_ip.h>
+#include <rte_rcu_qsbr.h>
+#include <rte_fib.h>
+#include <rte_fib6.h>
+
+#include "test.h"
+
+/*
+ * Readers do bulk lookups and report a quiescent state after each burst,
+ * while the writer adds and deletes routes that each need their own tbl8
+ * group. A reader must only ever see the covering route or the more
+ * specific one, a freed tbl8 group reused or cleared under its feet
+ * would show up as any other next hop.
+ */
+
+#define NUM_ROUTES		256
+#define NUM_TBL8		1024
+#define LOOKUP_BURST		32
+#define WRITER_ITERATIONS	16
+#define WRITER_ITERATIONS_SYNC	1
+
+#define DEFAULT_NH		2
+#define COVER_NH		1
+#define ROUTE_NH(i)		(100 + (i))
+
+static struct rte_rcu_qsbr *rv;
+static struct rte_fib *fib;
+static struct rte_fib6 *fib6;
+static volatile uint8_t writer_done;
+static uint64_t lookups;
+static uint64_t errors;
+
+/* 10.0.0.0/16 covers 10.0.<i>.0/32 */
+static inline uint32_t
+route_ip4(uint32_t i)
+{
+	return RTE_IPV4(10, 0, i, 0);
+}
+
+/* 2001:db8::/32 covers 2001:db8:<i>00::/48 */
+static inline void
+route_ip6(uint8_t ip[RTE_FIB6_IPV6_ADDR_SIZE], uint32_t i)
+{
+	static const uint8_t cover[RTE_FIB6_IPV6_ADDR_SIZE] = {
+		0x20, 0x01, 0x0d, 0xb8
+	};
+
+	memcpy(ip, cover, RTE_FIB6_IPV6_ADDR_SIZE);
+	ip[4] = i;
+}
+
+static inline int
+check_nh(uint64_t nh, uint32_t i)
+{
+	return (nh == COVER_NH) || (nh == ROUTE_NH(i));
+}
+
+static int
+test_fib_rcu_reader(void *arg)
+{
+	int is_v6 = (uintptr_t)arg;
+	uint32_t thread_id = rte_lcore_id();
+	uint32_t ip4[LOOKUP_BURST];
+	uint8_t ip6[LOOKUP_BURST][RTE_FIB6_IPV6_ADDR_SIZE];
+	uint64_t nh[LOOKUP_BURST];
+	uint64_t nb_lookups = 0, nb_errors = 0;
+	uint32_t i, n = thread_id;
+
+	rte_rcu_qsbr_thread_register(rv, thread_id);
+	rte_rcu_qsbr_thread_online(rv, thread_id);
+
+	do {
+		for (i = 0; i < LOOKUP_BURST; i++) {
+			if (is_v6)
+				route_ip6(ip6[i], (n + i) % NUM_ROUTES);
+			else
+				ip4[i] = route_ip4((n + i) % NUM_ROUTES);
+		}
+		if (is_v6)
+			rte_fib6_lookup_bulk(fib6, ip6, nh, LOOKUP_BURST);
+		else
+			rte_fib_lookup_bulk(fib, ip4, nh, LOOKUP_BURST);
+		for (i = 0; i < LOOKUP_BURST; i++)
+			nb_errors += !check_nh(nh[i], (n + i) % NUM_ROUTES);
+		nb_lookups += LOOKUP_BURST;
+		n += LOOKUP_BURST;
+
+		/* Done with the tbl8 groups seen by this burst */
+		rte_rcu_qsbr_quiescent(rv, thread_id);
+	} while (!writer_done);
+
+	rte_rcu_qsbr_thread_offline(rv, thread_id);
+	rte_rcu_qsbr_thread_unregister(rv, thread_id);
+
+	__atomic_fetch_add(&lookups, nb_lookups, __ATOMIC_RELAXED);
+	__atomic_fetch_add(&errors, nb_errors, __ATOMIC_RELAXED);
+
+	return 0;
+}
+
+static inline int
+route_update(int is_v6, uint32_t i, int add)
+{
+	uint8_t ip6[RTE_FIB6_IPV6_ADDR_SIZE];
+
+	if (is_v6) {
+		route_ip6(ip6, i);
+		return add ? rte_fib6_add(fib6, ip6, 48, ROUTE_NH(i)) :
+			rte_fib6_delete(fib6, ip6, 48);
+	}
+	return add ? rte_fib_add(fib, route_ip4(i), 32, ROUTE_NH(i)) :
+		rte_fib_delete(fib, route_ip4(i), 32);
+}
+
+static int
+test_fib_rcu_writer(int is_v6, uint32_t iterations)
+{
+	uint64_t begin, add_cycles = 0, del_cycles = 0;
+	uint32_t i, j;
+	int ret;
+
+	for (j = 0; j < iterations; j++) {
+		begin = rte_rdtsc_precise();
+		for (i = 0; i < NUM_ROUTES; i++) {
+			ret = route_update(is_v6, i, 1);
+			if (ret != 0) {
+				printf("Failed to add route %u, err %d\n",
+					i, ret);
+				return -1;
+			}
+		}
+		add_cycles += rte_rdtsc_precise() - begin;
+
+		begin = rte_rdtsc_precise();
+		for (i = 0; i < NUM_ROUTES; i++) {
+			ret = route_update(is_v6, i, 0);
+			if (ret != 0) {
+				printf("Failed to delete route %u, err %d\n",
+					i, ret);
+				return -1;
+			}
+		}
+		del_cycles += rte_rdtsc_precise() - begin;
+	}
+
+	printf("Average add cycles: %"PRIu64", "
+		"average delete cycles: %"PRIu64"\n",
+		add_cycles / (iterations * NUM_ROUTES),
+		del_cycles / (iterations * NUM_ROUTES));
+
+	return 0;
+}
+
+static int
+create_fib(int is_v6)
+{
+	struct rte_fib_conf conf;
+	struct rte_fib6_conf conf6 = {0};
+	uint8_t ip6[RTE_FIB6_IPV6_ADDR_SIZE];
+
+	if (is_v6) {
+		conf6.type = RTE_FIB6_TRIE;
+		conf6.default_nh = DEFAULT_NH;
+		conf6.max_routes = NUM_ROUTES * 2;
+		conf6.trie.nh_sz = RTE_FIB6_TRIE_4B;
+		conf6.trie.num_tbl8 = NUM_TBL8;
+		fib6 = rte_fib6_create("fib6_rcu_perf", SOCKET_ID_ANY, &conf6);
+		if (fib6 == NULL)
+			return -1;
+		route_ip6(ip6, 0);
+		return rte_fib6_add(fib6, ip6, 32, COVER_NH);
+	}
+
+	conf.type = RTE_FIB_DIR24_8;
+	conf.default_nh = DEFAULT_NH;
+	conf.max_routes = NUM_ROUTES * 2;
+	conf.dir24_8.nh_sz = RTE_FIB_DIR24_8_4B;
+	conf.dir24_8.num_tbl8 = NUM_TBL8;
+	fib = rte_fib_create("fib_rcu_perf", SOCKET_ID_ANY, &conf);
+	if (fib == NULL)
+		return -1;
+	return rte_fib_add(fib, route_ip4(0), 16, COVER_NH);
+}
+
+static void
+free_fib(void)
+{
+	rte_fib_free(fib);
+	rte_fib6_free(fib6);
+	fib = NULL;
+	fib6 = NULL;
+}
+
+/*
+ * Run the writer on the master lcore, with readers on all the slave
+ * lcores if rcu_mode is not negative.
+ */
+static int
+test_fib_rcu_run(int is_v6, int rcu_mode)
+{
+	struct rte_fib_rcu_config cfg = {0};
+	struct rte_fib6_rcu_config cfg6 = {0};
+	uint32_t iterations = WRITER_ITERATIONS;
+	unsigned int lcore_id;
+	int ret;
+
+	if (create_fib(is_v6) != 0) {
+		printf("Failed to create FIB\n");
+		free_fib();
+		return -1;
+	}
+
+	if (rcu_mode < 0) {
+		printf("%s, writer only, no RCU:\n", is_v6 ? "IPv6" : "IPv4");
+		ret = test_fib_rcu_writer(is_v6, iterations);
+		free_fib();
+		return ret;
+	}
+
+	rte_rcu_qsbr_init(rv, RTE_MAX_LCORE);
+	if (is_v6) {
+		cfg6.v = rv;
+		cfg6.mode = rcu_mode;
+		ret = rte_fib6_rcu_qsbr_add(fib6, &cfg6);
+	} else {
+		cfg.v = rv;
+		cfg.mode = rcu_mode;
+		ret = rte_fib_rcu_qsbr_add(fib, &cfg);
+	}
+	if (ret != 0) {
+		printf("Failed to attach RCU to FIB\n");
+		free_fib();
+		return -1;
+	}
+	if (rcu_mode == RTE_FIB_QSBR_MODE_SYNC)
+		iterations = WRITER_ITERATIONS_SYNC;
+
+	printf("%s, %u readers, RCU %s mode:\n", is_v6 ? "IPv6" : "IPv4",
+		rte_lcore_count() - 1,
+		rcu_mode == RTE_FIB_QSBR_MODE_DQ ? "defer queue" : "blocking");
+
+	writer_done = 0;
+	lookups = 0;
+	errors = 0;
+	RTE_LCORE_FOREACH_SLAVE(lcore_id)
+		rte_eal_remote_launch(test_fib_rcu_reader,
+			(void *)(uintptr_t)is_v6, lcore_id);
+
+	ret = test_fib_rcu_writer(is_v6, iterations);
+
+	writer_done = 1;
+	rte_eal_mp_wait_lcore();
+	free_fib();
+
+	printf("Reader lookups: %"PRIu64", wrong next hops: %"PRIu64"\n",
+		lookups, errors);
+	if (errors != 0)
+		ret = -1;
+
+	return ret;
+}
+
+static int
+test_fib_rcu_perf(void)
+{
+	const int modes[] = {
+		-1,
+		RTE_FIB_QSBR_MODE_DQ,
+		RTE_FIB_QSBR_MODE_SYNC
+	};
+	unsigned int i;
+	int is_v6, ret = 0;
+
+	if (rte_lcore_count() < 2) {
+		printf("Not enough cores for fib_rcu_perf_autotest, expecting at least 2\n");
+		return TEST_SKIPPED;
+	}
+
+	rv = rte_zmalloc(NULL, rte_rcu_qsbr_get_memsize(RTE_MAX_LCORE),
+		RTE_CACHE_LINE_SIZE);
+	if (rv == NULL) {
+		printf("Failed to allocate RCU QSBR variable\n");
+		return -1;
+	}
+
+	for (is_v6 = 0; (is_v6 <= 1) && (ret == 0); is_v6++)
+		for (i = 0; (i < RTE_DIM(modes)) && (ret == 0); i++)
+			ret = test_fib_rcu_run(is_v6, modes[i]);
+
+	rte_free(rv);
+
+	return ret;
+}
+
+REGISTER_TEST_COMMAND(fib_rcu_perf_autotest, test_fib_rcu_perf);
@@ -0,0 +1,703 @@
+/* SPDX-License-Identifier: BSD-3-Clause
+ * Copyright(c) 2020 Intel Corporation
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <string.h>
+
+#include <rte_ether.h>
+#include <rte_ip.h>
+#include <rte_tcp.h>
+#include <rte_udp.h>
+#include <rte_vxlan.h>
+#include <rte_mbuf.h>
+#include <rte_gro.h>
+
+#include "test.h"
+
+/*
+ * Functional tests of the GRO types in burst mode, and of the TCP/IPv4
+ * and VxLAN tables in a context. The payload byte at offset k of a flow
+ * is k & 0xff, so the payload of a merged packet can be checked against
+ * the same pattern.
+ */
+
+#define NUM_MBUFS		1024
+#define SEG_LEN			100
+#define UDP_MAX_MERGED		64
+#define IPV6_EXT_LEN		8
+#define NB_FLOWS		3
+#define NB_SEGS			4
+#define CTX_FLOWS		64
+
+/* packet flags of build_pkt() */
+#define PKT_IPV6		(1 << 0)
+#define PKT_UDP			(1 << 1)
+#define PKT_IPV6_EXT		(1 << 2) /**< hop-by-hop options header */
+#define PKT_IPV4_MF		(1 << 3) /**< more fragments flag */
+#define PKT_IPV4_OFFSET		(1 << 4) /**< non zero fragment offset */
+#define PKT_VXLAN		(1 << 5) /**< VxLAN over IPv4 encapsulation */
+/* flows only differ by their TCP or UDP source port */
+#define PKT_FLOW(f)		((uint32_t)(f) << 8)
+#define PKT_FLOW_ID(flags)	((flags) >> 8)
+#define PKT_PORT		1024
+
+static struct rte_mempool *pool;
+
+/* Encapsulate a packet in VxLAN over IPv4, with a VNI per flow */
+static int
+add_vxlan_hdr(struct rte_mbuf *m, uint32_t flow)
+{
+	struct rte_ether_hdr *eth;
+	struct rte_ipv4_hdr *ip;
+	struct rte_udp_hdr *udp;
+	struct rte_vxlan_hdr *vxlan;
+	uint16_t len;
+
+	len = sizeof(*eth) + sizeof(*ip) + sizeof(*udp) + sizeof(*vxlan);
+	eth = (struct rte_ether_hdr *)rte_pktmbuf_prepend(m, len);
+	if (eth == NULL)
+		return -1;
+	memset(eth, 0, len);
+	eth->d_addr.addr_bytes[5] = 3;
+	eth->s_addr.addr_bytes[5] = 4;
+	eth->ether_type = rte_cpu_to_be_16(RTE_ETHER_TYPE_IPV4);
+
+	ip = (struct rte_ipv4_hdr *)(eth + 1);
+	ip->version_ihl = RTE_IPV4_VHL_DEF;
+	ip->total_length = rte_cpu_to_be_16(m->pkt_len - sizeof(*eth));
+	ip->fragment_offset = rte_cpu_to_be_16(RTE_IPV4_HDR_DF_FLAG);
+	ip->time_to_live = 64;
+	ip->next_proto_id = IPPROTO_UDP;
+	ip->src_addr = rte_cpu_to_be_32(RTE_IPV4(192, 168, 0, 2));
+	ip->dst_addr = rte_cpu_to_be_32(RTE_IPV4(192, 168, 0, 1));
+
+	udp = (struct rte_udp_hdr *)(ip + 1);
+	udp->src_port = rte_cpu_to_be_16(49152);
+	udp->dst_port = rte_cpu_to_be_16(RTE_VXLAN_DEFAULT_PORT);
+	udp->dgram_len = rte_cpu_to_be_16(m->pkt_len - sizeof(*eth) -
+			sizeof(*ip));
+
+	vxlan = (struct rte_vxlan_hdr *)(udp + 1);
+	vxlan->vx_flags = rte_cpu_to_be_32(0x08000000);
+	vxlan->vx_vni = rte_cpu_to_be_32((flow + 1) << 8);
+
+	/* l2_len of a tunnelled packet covers the tunnel headers */
+	m->outer_l2_len = sizeof(*eth);
+	m->outer_l3_len = sizeof(*ip);
+	m->l2_len += sizeof(*udp) + sizeof(*vxlan);
+	m->packet_type = RTE_PTYPE_L2_ETHER | RTE_PTYPE_L3_IPV4 |
+		RTE_PTYPE_L4_UDP | RTE_PTYPE_TUNNEL_VXLAN |
+		RTE_PTYPE_INNER_L2_ETHER | RTE_PTYPE_INNER_L3_IPV4 |
+		RTE_PTYPE_INNER_L4_TCP;
+
+	return 0;
+}
+
+/*
+ * Build a packet of the flow given in flags, carrying len bytes of
+ * payload at the given offset of the flow.
+ */
+static struct rte_mbuf *
+build_pkt(uint32_t flags, uint32_t offset, uint16_t len)
+{
+	struct rte_ether_hdr *eth;
+	struct rte_ipv4_hdr *ip;
+	struct rte_ipv6_hdr *ip6;
+	struct rte_tcp_hdr *tcp;
+	struct rte_udp_hdr *udp;
+	struct rte_mbuf *m;
+	uint8_t *ext, *payload;
+	uint16_t l4_len, i;
+
+	m = rte_pktmbuf_alloc(pool);
+	if (m == NULL)
+		return NULL;
+
+	m->l2_len = sizeof(struct rte_ether_hdr);
+	if (flags & PKT_IPV6)
+		m->l3_len = sizeof(struct rte_ipv6_hdr) +
+			((flags & PKT_IPV6_EXT) ? IPV6_EXT_LEN : 0);
+	else
+		m->l3_len = sizeof(struct rte_ipv4_hdr);
+	m->l4_len = (flags & PKT_UDP) ? sizeof(struct rte_udp_hdr) :
+		sizeof(struct rte_tcp_hdr);
+	m->packet_type = RTE_PTYPE_L2_ETHER |
+		((flags & PKT_IPV6) ? RTE_PTYPE_L3_IPV6 : RTE_PTYPE_L3_IPV4) |
+		((flags & PKT_UDP) ? RTE_PTYPE_L4_UDP : RTE_PTYPE_L4_TCP);
+	l4_len = m->l4_len + len;
+
+	eth = (struct rte_ether_hdr *)rte_pktmbuf_append(m,
+			m->l2_len + m->l3_len + l4_len);
+	if (eth == NULL) {
+		rte_pktmbuf_free(m);
+		return NULL;
+	}
+	memset(eth, 0, m->l2_len + m->l3_len + m->l4_len);
+	eth->d_addr.addr_bytes[5] = 1;
+	eth->s_addr.addr_bytes[5] = 2;
+
+	if (flags & PKT_IPV6) {
+		eth->ether_type = rte_cpu_to_be_16(RTE_ETHER_TYPE_IPV6);
+		ip6 = (struct rte_ipv6_hdr *)(eth + 1);
+		ip6->vtc_flow = rte_cpu_to_be_32(6 << 28);
+		ip6->payload_len = rte_cpu_to_be_16(m->l3_len -
+				sizeof(*ip6) + l4_len);
+		ip6->proto = (flags & PKT_UDP) ? IPPROTO_UDP : IPPROTO_TCP;
+		ip6->hop_limits = 64;
+		ip6->src_addr[0] = 0xfd;
+		ip6->src_addr[15] = 2;
+		ip6->dst_addr[0] = 0xfd;
+		ip6->dst_addr[15] = 1;
+		if (flags & PKT_IPV6_EXT) {
+			ext = (uint8_t *)(ip6 + 1);
+			ext[0] = ip6->proto;
+			ip6->proto = IPPROTO_HOPOPTS;
+		}
+	} else {
+		eth->ether_type = rte_cpu_to_be_16(RTE_ETHER_TYPE_IPV4);
+		ip = (struct rte_ipv4_hdr *)(eth + 1);
+		ip->version_ihl = RTE_IPV4_VHL_DEF;
+		ip->total_length = rte_cpu_to_be_16(m->l3_len + l4_len);
+		if (flags & PKT_IPV4_MF)
+			ip->fragment_offset =
+				rte_cpu_to_be_16(RTE_IPV4_HDR_MF_FLAG);
+		else if (flags & PKT_IPV4_OFFSET)
+			ip->fragment_offset = rte_cpu_to_be_16(l4_len / 8);
+		else if (!(flags & PKT_UDP))
+			/* the IPv4 IDs of segments with DF aren't checked */
+			ip->fragment_offset =
+				rte_cpu_to_be_16(RTE_IPV4_HDR_DF_FLAG);
+		ip->time_to_live = 64;
+		ip->next_proto_id = (flags & PKT_UDP) ? IPPROTO_UDP :
+			IPPROTO_TCP;
+		ip->src_addr = rte_cpu_to_be_32(RTE_IPV4(10, 0, 0, 2));
+		ip->dst_addr = rte_cpu_to_be_32(RTE_IPV4(10, 0, 0, 1));
+	}
+
+	if (flags & PKT_UDP) {
+		udp = rte_pktmbuf_mtod_offset(m, struct rte_udp_hdr *,
+				m->l2_len + m->l3_len);
+		udp->src_port = rte_cpu_to_be_16(PKT_PORT +
+				PKT_FLOW_ID(flags));
+		udp->dst_port = rte_cpu_to_be_16(4789);
+		udp->dgram_len = rte_cpu_to_be_16(l4_len);
+	} else {
+		tcp = rte_pktmbuf_mtod_offset(m, struct rte_tcp_hdr *,
+				m->l2_len + m->l3_len);
+		tcp->src_port = rte_cpu_to_be_16(PKT_PORT +
+				PKT_FLOW_ID(flags));
+		tcp->dst_port = rte_cpu_to_be_16(80);
+		tcp->sent_seq = rte_cpu_to_be_32(offset);
+		tcp->data_off = (sizeof(struct rte_tcp_hdr) / 4) << 4;
+		tcp->tcp_flags = RTE_TCP_ACK_FLAG;
+	}
+
+	payload = rte_pktmbuf_mtod_offset(m, uint8_t *,
+			m->l2_len + m->l3_len + m->l4_len);
+	for (i = 0; i < len; i++)
+		payload[i] = offset + i;
+
+	if ((flags & PKT_VXLAN) &&
+			add_vxlan_hdr(m, PKT_FLOW_ID(flags)) < 0) {
+		rte_pktmbuf_free(m);
+		return NULL;
+	}
+
+	return m;
+}
+
+/* Build nb packets of len bytes of payload, following each other */
+static int
+build_pkts(struct rte_mbuf **pkts, uint32_t nb, uint32_t flags,
+		uint32_t offset, uint16_t len)
+{
+	uint32_t i;
+
+	for (i = 0; i < nb; i++) {
+		pkts[i] = build_pkt(flags, offset + i * len, len);
+		if (pkts[i] == NULL) {
+			rte_pktmbuf_free_bulk(pkts, i);
+			return -1;
+		}
+	}
+
+	return 0;
+}
+
+/*
+ * Build nb_segs packets of nb_flows flows, the flows being interleaved:
+ * packet i is segment i / nb_flows of flow i % nb_flows.
+ */
+static int
+build_flows(struct rte_mbuf **pkts, uint32_t nb_flows, uint32_t nb_segs,
+		uint32_t flags, uint32_t offset)
+{
+	uint32_t i;
+
+	for (i = 0; i < nb_flows * nb_segs; i++) {
+		pkts[i] = build_pkt(flags | PKT_FLOW(i % nb_flows),
+				offset + (i / nb_flows) * SEG_LEN, SEG_LEN);
+		if (pkts[i] == NULL) {
+			rte_pktmbuf_free_bulk(pkts, i);
+			return -1;
+		}
+	}
+
+	return 0;
+}
+
+/* Return the flow of a packet, from its (inner) L4 source port */
+static uint32_t
+pkt_flow(struct rte_mbuf *m)
+{
+	const struct rte_tcp_hdr *tcp;
+
+	/* the source port is at the same offset in UDP and TCP headers */
+	tcp = rte_pktmbuf_mtod_offset(m, const struct rte_tcp_hdr *,
+			m->outer_l2_len + m->outer_l3_len + m->l2_len +
+			m->l3_len);
+	return rte_be_to_cpu_16(tcp->src_port) - PKT_PORT;
+}
+
+/*
+ * Check the length fields of a merged packet carrying len bytes of
+ * payload from the given offset of its flow, and the payload itself.
+ */
+static int
+check_merged(struct rte_mbuf *m, uint32_t offset, uint32_t len)
+{
+	static uint8_t buf[UDP_MAX_MERGED * SEG_LEN];
+	const struct rte_ipv4_hdr *ip;
+	const struct rte_ipv6_hdr *ip6;
+	const struct rte_udp_hdr *udp;
+	const struct rte_tcp_hdr *tcp;
+	const uint8_t *payload;
+	uint32_t outer_len, hdr_len, i;
+
+	outer_len = m->outer_l2_len + m->outer_l3_len;
+	hdr_len = outer_len + m->l2_len + m->l3_len + m->l4_len;
+	TEST_ASSERT_EQUAL(m->pkt_len, hdr_len + len,
+			"Wrong packet length %u", m->pkt_len);
+
+	if (m->packet_type & RTE_PTYPE_TUNNEL_MASK) {
+		ip = rte_pktmbuf_mtod_offset(m, const struct rte_ipv4_hdr *,
+				m->outer_l2_len);
+		TEST_ASSERT_EQUAL(rte_be_to_cpu_16(ip->total_length),
+				m->pkt_len - m->outer_l2_len,
+				"Wrong outer IPv4 total length");
+		udp = rte_pktmbuf_mtod_offset(m, const struct rte_udp_hdr *,
+				outer_len);
+		TEST_ASSERT_EQUAL(rte_be_to_cpu_16(udp->dgram_len),
+				m->pkt_len - outer_len,
+				"Wrong outer UDP datagram length");
+	}
+
+	if (RTE_ETH_IS_IPV6_HDR(m->packet_type)) {
+		ip6 = rte_pktmbuf_mtod_offset(m, const struct rte_ipv6_hdr *,
+				m->l2_len);
+		TEST_ASSERT_EQUAL(rte_be_to_cpu_16(ip6->payload_len),
+				m->l3_len - sizeof(*ip6) + m->l4_len + len,
+				"Wrong IPv6 payload length");
+	} else {
+		ip = rte_pktmbuf_mtod_offset(m, const struct rte_ipv4_hdr *,
+				outer_len + m->l2_len);
+		TEST_ASSERT_EQUAL(rte_be_to_cpu_16(ip->total_length),
+				m->l3_len + m->l4_len + len,
+				"Wrong IPv4 total length");
+	}
+	if ((m->packet_type & RTE_PTYPE_L4_MASK) == RTE_PTYPE_L4_UDP &&
+			!(m->packet_type & RTE_PTYPE_TUNNEL_MASK)) {
+		udp = rte_pktmbuf_mtod_offset(m, const struct rte_udp_hdr *,
+				m->l2_len + m->l3_len);
+		TEST_ASSERT_EQUAL(rte_be_to_cpu_16(udp->dgram_len),
+				m->l4_len + len, "Wrong UDP datagram length");
+	} else {
+		tcp = rte_pktmbuf_mtod_offset(m, const struct rte_tcp_hdr *,
+				outer_len + m->l2_len + m->l3_len);
+		TEST_ASSERT_EQUAL(rte_be_to_cpu_32(tcp->sent_seq), offset,
+				"Wrong TCP sequence number");
+	}
+
+	TEST_ASSERT(len <= sizeof(buf), "Merged payload too long");
+	payload = rte_pktmbuf_read(m, hdr_len, len, buf);
+	TEST_ASSERT_NOT_NULL(payload, "Can not read merged payload");
+	for (i = 0; i < len; i++)
+		TEST_ASSERT_EQUAL(payload[i], (uint8_t)(offset + i),
+				"Wrong payload byte at %u", i);
+
+	return TEST_SUCCESS;
+}
+
+static uint16_t
+reassemble(struct rte_mbuf **pkts, uint16_t nb_pkts, uint64_t gro_types)
+{
+	const struct rte_gro_param param = {
+		.gro_types = gro_types,
+		.max_flow_num = RTE_GRO_MAX_BURST_ITEM_NUM,
+		.max_item_per_flow = RTE_GRO_MAX_BURST_ITEM_NUM,
+	};
+
+	return rte_gro_reassemble_burst(pkts, nb_pkts, &param);
+}
+
+static int
+test_gro_tcp6(void)
+{
+	struct rte_mbuf *pkts[4];
+	uint16_t nb;
+	int ret;
+
+	TEST_ASSERT_SUCCESS(build_pkts(pkts, RTE_DIM(pkts), PKT_IPV6, 0,
+			SEG_LEN), "Failed to build packets");
+
+	nb = reassemble(pkts, RTE_DIM(pkts), RTE_GRO_TCP_IPV6);
+	ret = (nb == 1) ? check_merged(pkts[0], 0, RTE_DIM(pkts) * SEG_LEN) :
+		TEST_FAILED;
+	rte_pktmbuf_free_bulk(pkts, nb);
+	TEST_ASSERT_EQUAL(nb, 1, "%u packets out of one flow", nb);
+
+	return ret;
+}
+
+static int
+test_gro_udp6(void)
+{
+	struct rte_mbuf *pkts[5];
+	uint16_t nb;
+	int ret;
+
+	TEST_ASSERT_SUCCESS(build_pkts(pkts, RTE_DIM(pkts), PKT_IPV6 | PKT_UDP,
+			0, SEG_LEN), "Failed to build packets");
+
+	nb = reassemble(pkts, RTE_DIM(pkts), RTE_GRO_UDP_IPV6);
+	ret = (nb == 1) ? check_merged(pkts[0], 0, RTE_DIM(pkts) * SEG_LEN) :
+		TEST_FAILED;
+	if (ret == TEST_SUCCESS && pkts[0]->tso_segsz != SEG_LEN) {
+		printf("Wrong datagram size %u\n", pkts[0]->tso_segsz);
+		ret = TEST_FAILED;
+	}
+	rte_pktmbuf_free_bulk(pkts, nb);
+	TEST_ASSERT_EQUAL(nb, 1, "%u packets out of one flow", nb);
+
+	return ret;
+}
+
+/* a shorter datagram is the last one of its packet */
+static int
+test_gro_udp_short(void)
+{
+	struct rte_mbuf *pkts[4];
+	uint16_t nb;
+	int ret = TEST_FAILED;
+
+	TEST_ASSERT_SUCCESS(build_pkts(pkts, 2, PKT_UDP, 0, SEG_LEN),
+			"Failed to build packets");
+	pkts[2] = build_pkt(PKT_UDP, 2 * SEG_LEN, SEG_LEN / 2);
+	pkts[3] = build_pkt(PKT_UDP, 2 * SEG_LEN + SEG_LEN / 2, SEG_LEN);
+	if (pkts[2] == NULL || pkts[3] == NULL) {
+		rte_pktmbuf_free_bulk(pkts, RTE_DIM(pkts));
+		return TEST_FAILED;
+	}
+
+	nb = reassemble(pkts, RTE_DIM(pkts), RTE_GRO_UDP_IPV4);
+	if (nb == 2 && check_merged(pkts[0], 0, 2 * SEG_LEN + SEG_LEN / 2) ==
+			TEST_SUCCESS && check_merged(pkts[1],
+			2 * SEG_LEN + SEG_LEN / 2, SEG_LEN) == TEST_SUCCESS)
+		ret = TEST_SUCCESS;
+	rte_pktmbuf_free_bulk(pkts, nb);
+	TEST_ASSERT_EQUAL(nb, 2, "%u packets out of one flow", nb);
+
+	return ret;
+}
+
+/* at most 64 datagrams are merged in a packet */
+static int
+test_gro_udp_max(void)
+{
+	struct rte_mbuf *pkts[UDP_MAX_MERGED + 1];
+	uint16_t nb;
+	int ret = TEST_FAILED;
+
+	TEST_ASSERT_SUCCESS(build_pkts(pkts, RTE_DIM(pkts), PKT_UDP, 0,
+			SEG_LEN), "Failed to build packets");
+
+	nb = reassemble(pkts, RTE_DIM(pkts), RTE_GRO_UDP_IPV4);
+	if (nb == 2 && check_merged(pkts[0], 0, UDP_MAX_MERGED * SEG_LEN) ==
+			TEST_SUCCESS && check_merged(pkts[1],
+			UDP_MAX_MERGED * SEG_LEN, SEG_LEN) == TEST_SUCCESS &&
+			pkts[0]->nb_segs == UDP_MAX_MERGED)
+		ret = TEST_SUCCESS;
+	rte_pktmbuf_free_bulk(pkts, nb);
+	TEST_ASSERT_EQUAL(nb, 2, "%u packets out of one flow", nb);
+
+	return ret;
+}
+
+/*
+ * IPv4 fragments and IPv6 packets with extension headers are returned
+ * unprocessed, after the merged packets.
+ */
+static int
+test_gro_udp_unprocessed(void)
+{
+	static const uint32_t flags[] = {
+		PKT_UDP | PKT_IPV4_MF,
+		PKT_UDP | PKT_IPV4_OFFSET,
+		PKT_IPV6 | PKT_UDP | PKT_IPV6_EXT,
+		PKT_IPV6 | PKT_UDP | PKT_IPV6_EXT,
+	};
+	const uint16_t nb_unprocessed = RTE_DIM(flags);
+	struct rte_mbuf *pkts[2 + RTE_DIM(flags)];
+	struct rte_mbuf *unprocessed[RTE_DIM(flags)];
+	uint16_t nb, i;
+	int ret = TEST_FAILED;
+
+	TEST_ASSERT_SUCCESS(build_pkts(pkts, 2, PKT_UDP, 0, SEG_LEN),
+			"Failed to build packets");
+	for (i = 0; i < nb_unprocessed; i++) {
+		pkts[2 + i] = build_pkt(flags[i], (i & 1) * SEG_LEN, SEG_LEN);
+		if (pkts[2 + i] == NULL) {
+			rte_pktmbuf_free_bulk(pkts, 2 + i);
+			return TEST_FAILED;
+		}
+		unprocessed[i] = pkts[2 + i];
+	}
+
+	nb = reassemble(pkts, RTE_DIM(pkts), RTE_GRO_UDP_IPV4 |
+			RTE_GRO_UDP_IPV6);
+	if (nb == 1 + nb_unprocessed &&
+			check_merged(pkts[0], 0, 2 * SEG_LEN) == TEST_SUCCESS) {
+		ret = TEST_SUCCESS;
+		for (i = 0; i < nb_unprocessed; i++)
+			if (pkts[1 + i] != unprocessed[i] ||
+					pkts[1 + i]->nb_segs != 1 ||
+					check_merged(pkts[1 + i],
+					(i & 1) * SEG_LEN, SEG_LEN) !=
+					TEST_SUCCESS)
+				ret = TEST_FAILED;
+	}
+	rte_pktmbuf_free_bulk(pkts, nb);
+	TEST_ASSERT_EQUAL(nb, 1 + nb_unprocessed,
+			"%u packets out of %u flows", nb, 1 + nb_unprocessed);
+
+	return ret;
+}
+
+/*
+ * Interleaved segments of several flows are merged per flow, and the
+ * flows are kept apart.
+ */
+static int
+test_gro_flows(uint32_t flags, uint64_t gro_types)
+{
+	struct rte_mbuf *pkts[NB_FLOWS * NB_SEGS];
+	uint8_t seen[NB_FLOWS];
+	uint16_t nb, i;
+	uint32_t f;
+	int ret = TEST_SUCCESS;
+
+	TEST_ASSERT_SUCCESS(build_flows(pkts, NB_FLOWS, NB_SEGS, flags, 0),
+			"Failed to build packets");
+
+	nb = reassemble(pkts, RTE_DIM(pkts), gro_types);
+	memset(seen, 0, sizeof(seen));
+	for (i = 0; i < nb && ret == TEST_SUCCESS; i++) {
+		f = pkt_flow(pkts[i]);
+		if (f >= NB_FLOWS || seen[f] || pkts[i]->nb_segs != NB_SEGS) {
+			printf("Unexpected packet of flow %u\n", f);
+			ret = TEST_FAILED;
+			break;
+		}
+		seen[f] = 1;
+		ret = check_merged(pkts[i], 0, NB_SEGS * SEG_LEN);
+	}
+	rte_pktmbuf_free_bulk(pkts, nb);
+	TEST_ASSERT_EQUAL(nb, NB_FLOWS, "%u packets out of %u flows", nb,
+			NB_FLOWS);
+
+	return ret;
+}
+
+static int
+test_gro_tcp4(void)
+{
+	return test_gro_flows(0, RTE_GRO_TCP_IPV4);
+}
+
+static int
+test_gro_vxlan(void)
+{
+	return test_gro_flows(PKT_VXLAN, RTE_GRO_IPV4_VXLAN_TCP_IPV4);
+}
+
+/*
+ * Fill the table of a context with the first segment of CTX_FLOWS flows,
+ * flush half of them, then send the second segment of every flow. The
+ * flows left in the table must still be found after the deletion of
+ * the flushed ones from the flow hash table, the others taking the items
+ * and flows freed by the flush.
+ */
+static int
+test_gro_ctx(uint32_t flags, uint64_t gro_types)
+{
+	const struct rte_gro_param param = {
+		.gro_types = gro_types,
+		.max_flow_num = CTX_FLOWS,
+		.max_item_per_flow = 1,
+		.socket_id = rte_socket_id(),
+	};
+	struct rte_mbuf *pkts[CTX_FLOWS + 1];
+	struct rte_mbuf *out[CTX_FLOWS];
+	struct rte_mbuf *m;
+	uint8_t flushed[CTX_FLOWS], seen[CTX_FLOWS];
+	uint16_t nb, nb_out = 0, i;
+	uint32_t f;
+	void *ctx;
+	int ret = TEST_FAILED;
+
+	ctx = rte_gro_ctx_create(&param);
+	TEST_ASSERT_NOT_NULL(ctx, "Failed to create GRO context");
+	memset(flushed, 0, sizeof(flushed));
+	memset(seen, 0, sizeof(seen));
+
+	/* the packet of the flow which doesn't fit is returned */
+	if (build_flows(pkts, CTX_FLOWS + 1, 1, flags, 0) < 0)
+		goto exit;
+	nb = rte_gro_reassemble(pkts, CTX_FLOWS + 1, ctx);
+	if (nb != 1 || pkt_flow(pkts[0]) != CTX_FLOWS ||
+			rte_gro_get_pkt_count(ctx) != CTX_FLOWS) {
+		printf("%u packets returned out of a full table\n", nb);
+		rte_pktmbuf_free_bulk(pkts, nb);
+		goto exit;
+	}
+	rte_pktmbuf_free(pkts[0]);
+
+	nb_out = rte_gro_timeout_flush(ctx, 0, gro_types, out,
+			CTX_FLOWS / 2);
+	if (nb_out != CTX_FLOWS / 2) {
+		printf("%u packets flushed\n", nb_out);
+		goto exit;
+	}
+	for (i = 0; i < nb_out; i++) {
+		f = pkt_flow(out[i]);
+		if (f >= CTX_FLOWS || flushed[f] ||
+				check_merged(out[i], 0, SEG_LEN) !=
+				TEST_SUCCESS) {
+			printf("Unexpected packet of flow %u\n", f);
+			goto exit;
+		}
+		flushed[f] = 1;
+	}
+	rte_pktmbuf_free_bulk(out, nb_out);
+	nb_out = 0;
+
+	/*
+	 * The flows left in the table are looked up first, while the
+	 * buckets of the flushed ones are still empty.
+	 */
+	if (build_flows(pkts, CTX_FLOWS, 1, flags, SEG_LEN) < 0)
+		goto exit;
+	for (i = 0; i < CTX_FLOWS / 2; i++) {
+		m = pkts[i];
+		pkts[i] = pkts[CTX_FLOWS - 1 - i];
+		pkts[CTX_FLOWS - 1 - i] = m;
+	}
+	nb = rte_gro_reassemble(pkts, CTX_FLOWS, ctx);
+	if (nb != 0 || rte_gro_get_pkt_count(ctx) != CTX_FLOWS) {
+		printf("%u packets returned, %"PRIu64" in the table\n", nb,
+				rte_gro_get_pkt_count(ctx));
+		rte_pktmbuf_free_bulk(pkts, nb);
+		goto exit;
+	}
+
+	nb_out = rte_gro_timeout_flush(ctx, 0, gro_types, out, CTX_FLOWS);
+	if (nb_out != CTX_FLOWS || rte_gro_get_pkt_count(ctx) != 0) {
+		printf("%u packets flushed\n", nb_out);
+		goto exit;
+	}
+	for (i = 0; i < nb_out; i++) {
+		f = pkt_flow(out[i]);
+		if (f >= CTX_FLOWS || seen[f] || (flushed[f] ?
+				check_merged(out[i], SEG_LEN, SEG_LEN) :
+				check_merged(out[i], 0, 2 * SEG_LEN)) !=
+				TEST_SUCCESS) {
+			printf("Unexpected packet of flow %u\n", f);
+			goto exit;
+		}
+		seen[f] = 1;
+	}
+
+	ret = TEST_SUCCESS;
+exit:
+	rte_pktmbuf_free_bulk(out, nb_out);
+	/* free what a failed test left in the table */
+	do {
+		nb_out = rte_gro_timeout_flush(ctx, 0, gro_types, out,
+				CTX_FLOWS);
+		rte_pktmbuf_free_bulk(out, nb_out);
+	} while (nb_out != 0);
+	rte_gro_ctx_destroy(ctx);
+
+	return ret;
+}
+
+static int
+test_gro_tcp4_ctx(void)
+{
+	return test_gro_ctx(0, RTE_GRO_TCP_IPV4);
+}
+
+static int
+test_gro_vxlan_ctx(void)
+{
+	return test_gro_ctx(PKT_VXLAN, RTE_GRO_IPV4_VXLAN_TCP_IPV4);
+}
+
+static int
+test_setup(void)
+{
+	pool = rte_pktmbuf_pool_create("gro_pool", NUM_MBUFS, 32, 0,
+			RTE_MBUF_DEFAULT_BUF_SIZE, rte_socket_id());
+	if (pool == NULL) {
+		printf("Failed to create mbuf pool\n");
+		return -1;
+	}
+
+	return 0;
+}
+
+static void
+test_teardown(void)
+{
+	rte_mempool_free(pool);
+	pool = NULL;
+}
+
+static struct unit_test_suite gro_test_suite = {
+	.setup = test_setup,
+	.teardown = test_teardown,
+	.suite_name = "GRO Unit Test Suite",
+	.unit_test_cases = {
+		TEST_CASE(test_gro_tcp6),
+		TEST_CASE(test_gro_udp6),
+		TEST_CASE(test_gro_udp_short),
+		TEST_CASE(test_gro_udp_max),
+		TEST_CASE(test_gro_udp_unprocessed),
+		TEST_CASE(test_gro_tcp4),
+		TEST_CASE(test_gro_vxlan),
+		TEST_CASE(test_gro_tcp4_ctx),
+		TEST_CASE(test_gro_vxlan_ctx),
+		TEST_CASES_END()
+	}
+};
+
+static int
+test_gro(void)
+{
+	return unit_test_suite_runner(&gro_test_suite);
+}
+
+REGISTER_TEST_COMMAND(gro_autotest, test_gro);
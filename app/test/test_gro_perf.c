@@ -0,0 +1,276 @@
+/* SPDX-License-Identifier: BSD-3-Clause
+ * Copyright(c) 2020 Intel Corporation
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <inttypes.h>
+
+#include <rte_cycles.h>
+#include <rte_ether.h>
+#include <rte_ip.h>
+#include <rte_tcp.h>
+#include <rte_udp.h>
+#include <rte_mbuf.h>
+#include <rte_gro.h>
+
+#include "test.h"
+
+/*
+ * Bursts of TCP/IPv4 packets, spread round robin over a growing number of
+ * flows, are merged with rte_gro_reassemble_burst(), and with
+ * rte_gro_reassemble() on a context flushed every FLUSH_BURSTS bursts.
+ * The burst mode is also run with TCP/IPv6, UDP/IPv4 and UDP/IPv6 packets.
+ * Only the GRO calls are timed, the packets being built and freed out of
+ * the measurement.
+ */
+
+#define NUM_MBUFS		8192
+#define BURST_SIZE		RTE_GRO_MAX_BURST_ITEM_NUM
+#define CTX_BURST_SIZE		32
+#define CTX_MAX_FLOWS		1024
+#define CTX_MAX_ITEMS		16
+#define FLUSH_BURSTS		8
+#define ITERATIONS		(1 << 12)
+#define PAYLOAD_LEN		64
+#define HDR_MAX_LEN		(sizeof(struct rte_ether_hdr) + \
+				sizeof(struct rte_ipv6_hdr) + \
+				sizeof(struct rte_tcp_hdr))
+
+static struct rte_mempool *pool;
+
+/* build the packet of the given index in its flow, of the given GRO type */
+static void
+build_pkt(struct rte_mbuf *m, uint64_t gro_type, uint32_t flow, uint32_t idx)
+{
+	struct rte_ether_hdr *eth;
+	struct rte_ipv4_hdr *ip;
+	struct rte_ipv6_hdr *ip6;
+	struct rte_tcp_hdr *tcp;
+	struct rte_udp_hdr *udp;
+	uint8_t is_ipv6, is_udp;
+	uint16_t l4_len;
+
+	is_ipv6 = (gro_type & (RTE_GRO_TCP_IPV6 | RTE_GRO_UDP_IPV6)) != 0;
+	is_udp = (gro_type & (RTE_GRO_UDP_IPV4 | RTE_GRO_UDP_IPV6)) != 0;
+
+	m->l2_len = sizeof(struct rte_ether_hdr);
+	m->l3_len = is_ipv6 ? sizeof(struct rte_ipv6_hdr) :
+		sizeof(struct rte_ipv4_hdr);
+	m->l4_len = is_udp ? sizeof(struct rte_udp_hdr) :
+		sizeof(struct rte_tcp_hdr);
+	m->packet_type = RTE_PTYPE_L2_ETHER |
+		(is_ipv6 ? RTE_PTYPE_L3_IPV6 : RTE_PTYPE_L3_IPV4) |
+		(is_udp ? RTE_PTYPE_L4_UDP : RTE_PTYPE_L4_TCP);
+	l4_len = m->l4_len + PAYLOAD_LEN;
+
+	eth = (struct rte_ether_hdr *)rte_pktmbuf_append(m,
+			m->l2_len + m->l3_len + l4_len);
+	memset(eth, 0, HDR_MAX_LEN);
+	eth->d_addr.addr_bytes[5] = 1;
+	eth->s_addr.addr_bytes[5] = 2;
+
+	if (is_ipv6) {
+		eth->ether_type = rte_cpu_to_be_16(RTE_ETHER_TYPE_IPV6);
+		ip6 = (struct rte_ipv6_hdr *)(eth + 1);
+		ip6->vtc_flow = rte_cpu_to_be_32(6 << 28);
+		ip6->payload_len = rte_cpu_to_be_16(l4_len);
+		ip6->proto = is_udp ? IPPROTO_UDP : IPPROTO_TCP;
+		ip6->hop_limits = 64;
+		ip6->src_addr[0] = 0xfd;
+		ip6->src_addr[14] = flow >> 8;
+		ip6->src_addr[15] = flow;
+		ip6->dst_addr[0] = 0xfd;
+		ip6->dst_addr[15] = 1;
+	} else {
+		eth->ether_type = rte_cpu_to_be_16(RTE_ETHER_TYPE_IPV4);
+		ip = (struct rte_ipv4_hdr *)(eth + 1);
+		ip->version_ihl = RTE_IPV4_VHL_DEF;
+		ip->total_length = rte_cpu_to_be_16(m->l3_len + l4_len);
+		ip->fragment_offset = rte_cpu_to_be_16(RTE_IPV4_HDR_DF_FLAG);
+		ip->time_to_live = 64;
+		ip->next_proto_id = is_udp ? IPPROTO_UDP : IPPROTO_TCP;
+		ip->src_addr = rte_cpu_to_be_32(RTE_IPV4(10, 0, flow >> 8,
+					flow));
+		ip->dst_addr = rte_cpu_to_be_32(RTE_IPV4(10, 1, 0, 1));
+	}
+
+	if (is_udp) {
+		udp = rte_pktmbuf_mtod_offset(m, struct rte_udp_hdr *,
+				m->l2_len + m->l3_len);
+		udp->src_port = rte_cpu_to_be_16(1024 + flow);
+		udp->dst_port = rte_cpu_to_be_16(4789);
+		udp->dgram_len = rte_cpu_to_be_16(l4_len);
+	} else {
+		tcp = rte_pktmbuf_mtod_offset(m, struct rte_tcp_hdr *,
+				m->l2_len + m->l3_len);
+		tcp->src_port = rte_cpu_to_be_16(1024 + flow);
+		tcp->dst_port = rte_cpu_to_be_16(80);
+		tcp->sent_seq = rte_cpu_to_be_32(idx * PAYLOAD_LEN);
+		tcp->data_off = (sizeof(struct rte_tcp_hdr) / 4) << 4;
+		tcp->tcp_flags = RTE_TCP_ACK_FLAG;
+	}
+}
+
+static const char *
+gro_type_name(uint64_t gro_type)
+{
+	switch (gro_type) {
+	case RTE_GRO_TCP_IPV4:
+		return "TCP/IPv4";
+	case RTE_GRO_TCP_IPV6:
+		return "TCP/IPv6";
+	case RTE_GRO_UDP_IPV4:
+		return "UDP/IPv4";
+	case RTE_GRO_UDP_IPV6:
+		return "UDP/IPv6";
+	default:
+		return "unknown";
+	}
+}
+
+static int
+test_gro_perf_burst(uint64_t gro_type, uint32_t nb_flows)
+{
+	const struct rte_gro_param param = {
+		.gro_types = gro_type,
+		.max_flow_num = BURST_SIZE,
+		.max_item_per_flow = BURST_SIZE,
+	};
+	struct rte_mbuf *pkts[BURST_SIZE];
+	uint64_t begin, cycles = 0;
+	uint32_t i, j, nb_out = 0, nb_expected = nb_flows;
+
+	/* UDP GRO merges at most 64 datagrams in a packet */
+	if (gro_type & (RTE_GRO_UDP_IPV4 | RTE_GRO_UDP_IPV6))
+		nb_expected = nb_flows * RTE_MAX(BURST_SIZE / nb_flows / 64, 1U);
+
+	for (i = 0; i < ITERATIONS; i++) {
+		if (rte_pktmbuf_alloc_bulk(pool, pkts, BURST_SIZE) != 0) {
+			printf("Failed to allocate mbufs\n");
+			return -1;
+		}
+		for (j = 0; j < BURST_SIZE; j++)
+			build_pkt(pkts[j], gro_type, j % nb_flows,
+				j / nb_flows);
+
+		begin = rte_rdtsc_precise();
+		nb_out = rte_gro_reassemble_burst(pkts, BURST_SIZE, &param);
+		cycles += rte_rdtsc_precise() - begin;
+
+		rte_pktmbuf_free_bulk(pkts, nb_out);
+		if (nb_out != nb_expected) {
+			printf("%u %s packets out of %u flows\n", nb_out,
+				gro_type_name(gro_type), nb_flows);
+			return -1;
+		}
+	}
+
+	printf("Burst mode, %s, %4u flows: %"PRIu64" cycles per packet\n",
+		gro_type_name(gro_type), nb_flows,
+		cycles / ((uint64_t)ITERATIONS * BURST_SIZE));
+	return 0;
+}
+
+static int
+test_gro_perf_ctx(uint32_t nb_flows)
+{
+	const struct rte_gro_param param = {
+		.gro_types = RTE_GRO_TCP_IPV4,
+		.max_flow_num = CTX_MAX_FLOWS,
+		.max_item_per_flow = CTX_MAX_ITEMS,
+		.socket_id = rte_socket_id(),
+	};
+	struct rte_mbuf *pkts[CTX_BURST_SIZE];
+	struct rte_mbuf *out[CTX_MAX_FLOWS];
+	uint64_t begin, cycles = 0;
+	uint32_t i, j, seq = 0;
+	uint16_t n;
+	void *ctx;
+	int ret = -1;
+
+	ctx = rte_gro_ctx_create(&param);
+	if (ctx == NULL) {
+		printf("Failed to create GRO context\n");
+		return -1;
+	}
+
+	for (i = 0; i < ITERATIONS; i++) {
+		if (rte_pktmbuf_alloc_bulk(pool, pkts, CTX_BURST_SIZE) != 0) {
+			printf("Failed to allocate mbufs\n");
+			goto exit;
+		}
+		for (j = 0; j < CTX_BURST_SIZE; j++, seq++)
+			build_pkt(pkts[j], RTE_GRO_TCP_IPV4, seq % nb_flows,
+				seq / nb_flows);
+
+		begin = rte_rdtsc_precise();
+		n = rte_gro_reassemble(pkts, CTX_BURST_SIZE, ctx);
+		cycles += rte_rdtsc_precise() - begin;
+		if (n != 0) {
+			printf("%u packets not merged\n", n);
+			rte_pktmbuf_free_bulk(pkts, n);
+			goto exit;
+		}
+
+		if ((i + 1) % FLUSH_BURSTS != 0)
+			continue;
+
+		begin = rte_rdtsc_precise();
+		n = rte_gro_timeout_flush(ctx, 0, RTE_GRO_TCP_IPV4, out,
+				CTX_MAX_FLOWS);
+		cycles += rte_rdtsc_precise() - begin;
+		rte_pktmbuf_free_bulk(out, n);
+		if (n != RTE_MIN(nb_flows,
+				(uint32_t)CTX_BURST_SIZE * FLUSH_BURSTS)) {
+			printf("%u packets flushed out of %u flows\n", n,
+				nb_flows);
+			goto exit;
+		}
+		seq = 0;
+	}
+
+	printf("Context mode, %4u flows: %"PRIu64" cycles per packet\n",
+		nb_flows, cycles / ((uint64_t)ITERATIONS * CTX_BURST_SIZE));
+	ret = 0;
+exit:
+	n = rte_gro_timeout_flush(ctx, 0, RTE_GRO_TCP_IPV4, out,
+			CTX_MAX_FLOWS);
+	rte_pktmbuf_free_bulk(out, n);
+	rte_gro_ctx_destroy(ctx);
+	return ret;
+}
+
+static int
+test_gro_perf(void)
+{
+	static const uint64_t gro_types[] = {
+		RTE_GRO_TCP_IPV4, RTE_GRO_TCP_IPV6,
+		RTE_GRO_UDP_IPV4, RTE_GRO_UDP_IPV6,
+	};
+	uint32_t i, nb_flows;
+	int ret = 0;
+
+	pool = rte_pktmbuf_pool_create("gro_perf_pool", NUM_MBUFS,
+		BURST_SIZE, 0, RTE_MBUF_DEFAULT_BUF_SIZE, rte_socket_id());
+	if (pool == NULL) {
+		printf("Failed to create mbuf pool\n");
+		return -1;
+	}
+
+	for (i = 0; i < RTE_DIM(gro_types) && ret == 0; i++)
+		for (nb_flows = 1; nb_flows <= BURST_SIZE && ret == 0;
+				nb_flows *= 2)
+			ret = test_gro_perf_burst(gro_types[i], nb_flows);
+	for (nb_flows = 1; nb_flows <= CTX_MAX_FLOWS && ret == 0;
+			nb_flows *= 4)
+		ret = test_gro_perf_ctx(nb_flows);
+
+	rte_mempool_free(pool);
+	pool = NULL;
+
+	return ret;
+}
+
+REGISTER_TEST_COMMAND(gro_perf_autotest, test_gro_perf);
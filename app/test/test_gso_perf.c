@@ -0,0 +1,322 @@
+/* SPDX-License-Identifier: BSD-3-Clause
+ * Copyright(c) 2020 Intel Corporation
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <inttypes.h>
+
+#include <rte_cycles.h>
+#include <rte_ethdev.h>
+#include <rte_ether.h>
+#include <rte_ip.h>
+#include <rte_tcp.h>
+#include <rte_mbuf.h>
+#include <rte_gso.h>
+
+#include "test.h"
+
+/*
+ * 64KB TCP/IPv4 and TCP/IPv6 packets, made of PKT_SEGS mbufs, are
+ * segmented with rte_gso_segment(), with the packet headers copied in
+ * direct mbufs and with RTE_GSO_FLAG_EXTBUF_HDR. The output segments are
+ * checked once, then the segmentation and the freeing of the segments
+ * are timed. All the mbufs must be back in their pools at the end.
+ */
+
+#define GSO_SIZE		1514
+#define PKT_SEGS		8
+#define SEG_DATA_LEN		8000
+#define NUM_PKT_MBUFS		(4 * PKT_SEGS)
+#define NUM_MBUFS		4096
+#define MAX_GSO_SEGS		64
+#define ITERATIONS		(1 << 12)
+#define HDR_LEN(is_ipv6)	(sizeof(struct rte_ether_hdr) + \
+				((is_ipv6) ? sizeof(struct rte_ipv6_hdr) : \
+				 sizeof(struct rte_ipv4_hdr)) + \
+				sizeof(struct rte_tcp_hdr))
+
+static struct rte_mempool *pkt_pool;
+static struct rte_mempool *direct_pool;
+static struct rte_mempool *indirect_pool;
+
+/* build a TCP packet of PKT_SEGS mbufs, the first one holding the headers */
+static struct rte_mbuf *
+build_pkt(uint8_t is_ipv6)
+{
+	struct rte_mbuf *pkt, *seg;
+	struct rte_ether_hdr *eth;
+	struct rte_ipv4_hdr *ip;
+	struct rte_ipv6_hdr *ip6;
+	struct rte_tcp_hdr *tcp;
+	uint16_t hdr_len = HDR_LEN(is_ipv6);
+	uint32_t i;
+
+	pkt = rte_pktmbuf_alloc(pkt_pool);
+	if (pkt == NULL)
+		return NULL;
+	eth = (struct rte_ether_hdr *)rte_pktmbuf_append(pkt, hdr_len +
+			SEG_DATA_LEN);
+	memset(eth, 0, hdr_len);
+	for (i = 1; i < PKT_SEGS; i++) {
+		seg = rte_pktmbuf_alloc(pkt_pool);
+		if (seg == NULL || rte_pktmbuf_append(seg,
+					SEG_DATA_LEN) == NULL ||
+				rte_pktmbuf_chain(pkt, seg) != 0) {
+			rte_pktmbuf_free(seg);
+			rte_pktmbuf_free(pkt);
+			return NULL;
+		}
+	}
+
+	eth->d_addr.addr_bytes[5] = 1;
+	eth->s_addr.addr_bytes[5] = 2;
+	pkt->l2_len = sizeof(struct rte_ether_hdr);
+	pkt->l4_len = sizeof(struct rte_tcp_hdr);
+
+	if (is_ipv6) {
+		eth->ether_type = rte_cpu_to_be_16(RTE_ETHER_TYPE_IPV6);
+		ip6 = (struct rte_ipv6_hdr *)(eth + 1);
+		ip6->vtc_flow = rte_cpu_to_be_32(6 << 28);
+		ip6->payload_len = rte_cpu_to_be_16(pkt->pkt_len -
+				pkt->l2_len - sizeof(*ip6));
+		ip6->proto = IPPROTO_TCP;
+		ip6->hop_limits = 64;
+		ip6->src_addr[0] = 0xfd;
+		ip6->dst_addr[0] = 0xfd;
+		ip6->dst_addr[15] = 1;
+		pkt->l3_len = sizeof(*ip6);
+		pkt->ol_flags = PKT_TX_IPV6 | PKT_TX_TCP_SEG;
+		tcp = (struct rte_tcp_hdr *)(ip6 + 1);
+	} else {
+		eth->ether_type = rte_cpu_to_be_16(RTE_ETHER_TYPE_IPV4);
+		ip = (struct rte_ipv4_hdr *)(eth + 1);
+		ip->version_ihl = RTE_IPV4_VHL_DEF;
+		ip->fragment_offset = rte_cpu_to_be_16(RTE_IPV4_HDR_DF_FLAG);
+		ip->time_to_live = 64;
+		ip->next_proto_id = IPPROTO_TCP;
+		ip->src_addr = rte_cpu_to_be_32(RTE_IPV4(10, 0, 0, 1));
+		ip->dst_addr = rte_cpu_to_be_32(RTE_IPV4(10, 1, 0, 1));
+		pkt->l3_len = sizeof(*ip);
+		pkt->ol_flags = PKT_TX_IPV4 | PKT_TX_TCP_SEG;
+		tcp = (struct rte_tcp_hdr *)(ip + 1);
+	}
+
+	tcp->src_port = rte_cpu_to_be_16(1024);
+	tcp->dst_port = rte_cpu_to_be_16(80);
+	tcp->sent_seq = rte_cpu_to_be_32(1000);
+	tcp->data_off = (sizeof(struct rte_tcp_hdr) / 4) << 4;
+	tcp->tcp_flags = RTE_TCP_ACK_FLAG | RTE_TCP_PSH_FLAG;
+
+	return pkt;
+}
+
+/* check the lengths and sequence numbers of the GSO segments */
+static int
+check_segs(struct rte_mbuf **segs, int nb_segs, uint8_t is_ipv6)
+{
+	struct rte_ipv4_hdr *ip;
+	struct rte_ipv6_hdr *ip6;
+	struct rte_tcp_hdr *tcp;
+	uint16_t hdr_len = HDR_LEN(is_ipv6);
+	uint32_t seq = 1000, pyld_len, total = 0;
+	int i;
+
+	for (i = 0; i < nb_segs; i++) {
+		pyld_len = segs[i]->pkt_len - hdr_len;
+		if (segs[i]->pkt_len > GSO_SIZE ||
+				(i < nb_segs - 1 &&
+				 segs[i]->pkt_len != GSO_SIZE) ||
+				rte_pktmbuf_data_len(segs[i]) != hdr_len) {
+			printf("Segment %d has a bad length %u\n", i,
+				segs[i]->pkt_len);
+			return -1;
+		}
+		if (is_ipv6) {
+			ip6 = rte_pktmbuf_mtod_offset(segs[i],
+				struct rte_ipv6_hdr *, segs[i]->l2_len);
+			if (rte_be_to_cpu_16(ip6->payload_len) !=
+					pyld_len + sizeof(*tcp)) {
+				printf("Segment %d has a bad IPv6 length\n", i);
+				return -1;
+			}
+		} else {
+			ip = rte_pktmbuf_mtod_offset(segs[i],
+				struct rte_ipv4_hdr *, segs[i]->l2_len);
+			if (rte_be_to_cpu_16(ip->total_length) !=
+					pyld_len + sizeof(*ip) + sizeof(*tcp)) {
+				printf("Segment %d has a bad IPv4 length\n", i);
+				return -1;
+			}
+		}
+		tcp = rte_pktmbuf_mtod_offset(segs[i], struct rte_tcp_hdr *,
+				segs[i]->l2_len + segs[i]->l3_len);
+		if (rte_be_to_cpu_32(tcp->sent_seq) != seq ||
+				((tcp->tcp_flags & RTE_TCP_PSH_FLAG) != 0) !=
+				(i == nb_segs - 1)) {
+			printf("Segment %d has a bad TCP header\n", i);
+			return -1;
+		}
+		seq += pyld_len;
+		total += pyld_len;
+	}
+
+	if (total != PKT_SEGS * SEG_DATA_LEN) {
+		printf("%u payload bytes out of %u\n", total,
+			PKT_SEGS * SEG_DATA_LEN);
+		return -1;
+	}
+	return 0;
+}
+
+static void
+free_segs(struct rte_mbuf **segs, int nb_segs)
+{
+	int i;
+
+	for (i = 0; i < nb_segs; i++)
+		rte_pktmbuf_free(segs[i]);
+}
+
+static int
+test_gso_perf_type(uint8_t is_ipv6, uint64_t flag)
+{
+	const struct rte_gso_ctx ctx = {
+		.direct_pool = direct_pool,
+		.indirect_pool = indirect_pool,
+		.flag = flag,
+		.gso_types = DEV_TX_OFFLOAD_TCP_TSO,
+		.gso_size = GSO_SIZE,
+	};
+	struct rte_mbuf *pkts[NUM_PKT_MBUFS / PKT_SEGS];
+	struct rte_mbuf *segs[MAX_GSO_SEGS];
+	uint64_t begin, cycles = 0, nb_total = 0;
+	uint32_t i, j;
+	int nb_segs;
+
+	for (i = 0; i < ITERATIONS; i++) {
+		for (j = 0; j < RTE_DIM(pkts); j++) {
+			pkts[j] = build_pkt(is_ipv6);
+			if (pkts[j] == NULL) {
+				printf("Failed to build packets\n");
+				while (j > 0)
+					rte_pktmbuf_free(pkts[--j]);
+				return -1;
+			}
+		}
+
+		for (j = 0; j < RTE_DIM(pkts); j++) {
+			begin = rte_rdtsc_precise();
+			nb_segs = rte_gso_segment(pkts[j], &ctx, segs,
+					MAX_GSO_SEGS);
+			if (nb_segs > 0)
+				free_segs(segs, nb_segs);
+			cycles += rte_rdtsc_precise() - begin;
+
+			if (nb_segs <= 1) {
+				printf("rte_gso_segment() returned %d\n",
+					nb_segs);
+				if (nb_segs == 1)
+					rte_pktmbuf_free(segs[0]);
+				while (++j < RTE_DIM(pkts))
+					rte_pktmbuf_free(pkts[j]);
+				return -1;
+			}
+			nb_total += nb_segs;
+		}
+	}
+
+	printf("%s, %s headers: %"PRIu64" cycles per segment\n",
+		is_ipv6 ? "TCP/IPv6" : "TCP/IPv4",
+		(flag & RTE_GSO_FLAG_EXTBUF_HDR) ? "extbuf" : "direct",
+		cycles / nb_total);
+	return 0;
+}
+
+static int
+test_gso_check_type(uint8_t is_ipv6, uint64_t flag)
+{
+	const struct rte_gso_ctx ctx = {
+		.direct_pool = direct_pool,
+		.indirect_pool = indirect_pool,
+		.flag = flag,
+		.gso_types = DEV_TX_OFFLOAD_TCP_TSO,
+		.gso_size = GSO_SIZE,
+	};
+	struct rte_mbuf *segs[MAX_GSO_SEGS];
+	struct rte_mbuf *pkt;
+	int nb_segs, ret;
+
+	pkt = build_pkt(is_ipv6);
+	if (pkt == NULL) {
+		printf("Failed to build a packet\n");
+		return -1;
+	}
+
+	nb_segs = rte_gso_segment(pkt, &ctx, segs, MAX_GSO_SEGS);
+	if (nb_segs <= 1) {
+		printf("rte_gso_segment() returned %d\n", nb_segs);
+		rte_pktmbuf_free(pkt);
+		return -1;
+	}
+	ret = check_segs(segs, nb_segs, is_ipv6);
+	free_segs(segs, nb_segs);
+
+	/* the input packet and the header areas are freed with the segments */
+	if (rte_mempool_in_use_count(pkt_pool) != 0 ||
+			rte_mempool_in_use_count(direct_pool) != 0 ||
+			rte_mempool_in_use_count(indirect_pool) != 0) {
+		printf("mbufs leaked: %u %u %u\n",
+			rte_mempool_in_use_count(pkt_pool),
+			rte_mempool_in_use_count(direct_pool),
+			rte_mempool_in_use_count(indirect_pool));
+		return -1;
+	}
+
+	return ret;
+}
+
+static int
+test_gso_perf(void)
+{
+	static const uint64_t flags[] = {0, RTE_GSO_FLAG_EXTBUF_HDR};
+	uint32_t i;
+	uint8_t is_ipv6;
+	int ret = -1;
+
+	pkt_pool = rte_pktmbuf_pool_create("gso_perf_pkt_pool",
+		NUM_PKT_MBUFS, 0, 0, RTE_PKTMBUF_HEADROOM + SEG_DATA_LEN +
+		HDR_LEN(1), rte_socket_id());
+	direct_pool = rte_pktmbuf_pool_create("gso_perf_direct_pool",
+		NUM_MBUFS, 0, 0, RTE_MBUF_DEFAULT_BUF_SIZE, rte_socket_id());
+	indirect_pool = rte_pktmbuf_pool_create("gso_perf_indirect_pool",
+		2 * NUM_MBUFS, 0, 0, 0, rte_socket_id());
+	if (pkt_pool == NULL || direct_pool == NULL || indirect_pool == NULL) {
+		printf("Failed to create mbuf pools\n");
+		goto exit;
+	}
+
+	for (i = 0; i < RTE_DIM(flags); i++)
+		for (is_ipv6 = 0; is_ipv6 <= 1; is_ipv6++)
+			if (test_gso_check_type(is_ipv6, flags[i]) != 0)
+				goto exit;
+
+	for (i = 0; i < RTE_DIM(flags); i++)
+		for (is_ipv6 = 0; is_ipv6 <= 1; is_ipv6++)
+			if (test_gso_perf_type(is_ipv6, flags[i]) != 0)
+				goto exit;
+
+	ret = 0;
+exit:
+	rte_mempool_free(pkt_pool);
+	rte_mempool_free(direct_pool);
+	rte_mempool_free(indirect_pool);
+	pkt_pool = NULL;
+	direct_pool = NULL;
+	indirect_pool = NULL;
+
+	return ret;
+}
+
+REGISTER_TEST_COMMAND(gso_perf_autotest, test_gso_perf);
@@ -774,6 +774,97 @@ static int test_five_keys(void)
 	return 0;
 }
 
+/*
+ * Bulk add/delete five keys, with and without lock free concurrency.
+ *	- bulk add keys with data
+ *	- lookup keys: hit, correct data
+ *	- bulk add keys (update)
+ *	- bulk delete keys: hit
+ *	- lookup keys: miss
+ *	- bulk delete keys: miss
+ */
+static int test_five_keys_bulk(void)
+{
+	struct rte_hash *handle;
+	const void *key_array[5] = {0};
+	void *data[5], *ret_data[5];
+	int32_t pos[5], expected_pos[5];
+	uint64_t hit_mask;
+	uint8_t extra_flag;
+	unsigned int i, lf;
+	int ret;
+
+	for (i = 0; i < 5; i++) {
+		key_array[i] = &keys[i];
+		data[i] = (void *)(uintptr_t)(i + 1);
+	}
+
+	extra_flag = ut_params.extra_flag;
+	for (lf = 0; lf <= 1; lf++) {
+		ut_params.name = "test_bulk";
+		ut_params.extra_flag = lf ?
+			RTE_HASH_EXTRA_FLAGS_RW_CONCURRENCY_LF : 0;
+		handle = rte_hash_create(&ut_params);
+		ut_params.extra_flag = extra_flag;
+		RETURN_IF_ERROR(handle == NULL, "hash creation failed");
+
+		/* Add */
+		ret = rte_hash_add_key_bulk(handle, key_array, data, 5, pos);
+		RETURN_IF_ERROR(ret != 5, "failed to bulk add keys (ret=%d)",
+				ret);
+		for (i = 0; i < 5; i++) {
+			print_key_info("Add", &keys[i], pos[i]);
+			expected_pos[i] = pos[i];
+		}
+
+		/* Lookup */
+		ret = rte_hash_lookup_bulk_data(handle, key_array, 5,
+						&hit_mask, ret_data);
+		RETURN_IF_ERROR(ret != 5, "failed to find keys (ret=%d)", ret);
+		for (i = 0; i < 5; i++)
+			RETURN_IF_ERROR(ret_data[i] != data[i],
+					"wrong data for key %u", i);
+
+		/* Add - update */
+		ret = rte_hash_add_key_bulk(handle, key_array, NULL, 5, pos);
+		RETURN_IF_ERROR(ret != 5, "failed to bulk update keys (ret=%d)",
+				ret);
+		for (i = 0; i < 5; i++)
+			RETURN_IF_ERROR(pos[i] != expected_pos[i],
+				"failed to update key (pos[%u]=%d)", i, pos[i]);
+
+		/* Delete */
+		ret = rte_hash_del_key_bulk(handle, key_array, 5, pos);
+		RETURN_IF_ERROR(ret != 5, "failed to bulk delete keys (ret=%d)",
+				ret);
+		for (i = 0; i < 5; i++) {
+			print_key_info("Del", &keys[i], pos[i]);
+			RETURN_IF_ERROR(pos[i] != expected_pos[i],
+				"failed to delete key (pos[%u]=%d)", i, pos[i]);
+		}
+
+		/* Lookup */
+		for (i = 0; i < 5; i++) {
+			pos[i] = rte_hash_lookup(handle, &keys[i]);
+			RETURN_IF_ERROR(pos[i] != -ENOENT,
+				"found non-existent key (pos[%u]=%d)", i, pos[i]);
+		}
+
+		/* Delete - miss */
+		ret = rte_hash_del_key_bulk(handle, key_array, 5, pos);
+		RETURN_IF_ERROR(ret != 0, "deleted non-existent keys (ret=%d)",
+				ret);
+		for (i = 0; i < 5; i++)
+			RETURN_IF_ERROR(pos[i] != -ENOENT,
+				"deleted non-existent key (pos[%u]=%d)", i,
+				pos[i]);
+
+		rte_hash_free(handle);
+	}
+
+	return 0;
+}
+
 /*
  * Add keys to the same bucket until bucket full.
  *	- add 5 keys to the same bucket (hash created with 4 keys per bucket):
@@ -994,6 +1085,296 @@ static int test_extendable_bucket(void)
 	return 0;
 }
 
+#define RCU_TEST_ENTRIES 16
+#define AGING_TEST_BURST 8
+
+static uint32_t rcu_key_data_freed;
+
+static void
+test_hash_rcu_free_key_data(void *p, void *key_data)
+{
+	RTE_SET_USED(p);
+
+	rcu_key_data_freed += (uint32_t)(uintptr_t)key_data;
+}
+
+/*
+ * Integrated RCU QSBR reclamation of deleted key indexes.
+ *	- the hash table must not free the key index on delete
+ *	- in defer queue mode, a deleted key index is reused only after the
+ *	  registered reader reported its quiescent state
+ *	- in sync mode, delete waits for the readers and frees the key index
+ */
+static int test_hash_rcu_qsbr(void)
+{
+	struct rte_hash_parameters params = {
+		.name = "test_rcu",
+		.entries = RCU_TEST_ENTRIES,
+		.key_len = sizeof(uint32_t),
+		.hash_func = rte_jhash,
+		.hash_func_init_val = 0,
+		.socket_id = 0,
+	};
+	struct rte_hash_rcu_config rcu_cfg = {0};
+	struct rte_hash *handle = NULL;
+	struct rte_rcu_qsbr *qsv;
+	uint32_t key, mode;
+	int32_t pos;
+	int ret;
+
+	qsv = rte_zmalloc(NULL, rte_rcu_qsbr_get_memsize(RTE_MAX_LCORE),
+			RTE_CACHE_LINE_SIZE);
+	RETURN_IF_ERROR(qsv == NULL, "QSBR variable allocation failed");
+	rte_rcu_qsbr_init(qsv, RTE_MAX_LCORE);
+	rcu_cfg.v = qsv;
+	rcu_cfg.free_key_data_func = test_hash_rcu_free_key_data;
+
+	/* Key index freed on delete, nothing to protect */
+	handle = rte_hash_create(&params);
+	RETURN_IF_ERROR(handle == NULL, "hash creation failed");
+	ret = rte_hash_rcu_qsbr_add(handle, &rcu_cfg);
+	RETURN_IF_ERROR(ret != -EINVAL,
+			"RCU added to hash freeing key index on delete");
+	rte_hash_free(handle);
+
+	params.extra_flag = RTE_HASH_EXTRA_FLAGS_RW_CONCURRENCY_LF;
+	for (mode = RTE_HASH_QSBR_MODE_DQ; mode <= RTE_HASH_QSBR_MODE_SYNC;
+			mode++) {
+		handle = rte_hash_create(&params);
+		RETURN_IF_ERROR(handle == NULL, "hash creation failed");
+
+		rcu_cfg.mode = mode;
+		/* No automatic reclamation, only when out of key indexes */
+		rcu_cfg.trigger_reclaim_limit = RCU_TEST_ENTRIES + 1;
+		ret = rte_hash_rcu_qsbr_add(handle, &rcu_cfg);
+		RETURN_IF_ERROR(ret != 0, "failed to add RCU (ret=%d)", ret);
+		ret = rte_hash_rcu_qsbr_add(handle, &rcu_cfg);
+		RETURN_IF_ERROR(ret != -EEXIST, "RCU added twice (ret=%d)", ret);
+
+		rte_rcu_qsbr_thread_register(qsv, 0);
+		if (mode == RTE_HASH_QSBR_MODE_DQ)
+			rte_rcu_qsbr_thread_online(qsv, 0);
+
+		for (key = 0; key < RCU_TEST_ENTRIES; key++) {
+			ret = rte_hash_add_key_data(handle, &key,
+					(void *)(uintptr_t)(key + 1));
+			RETURN_IF_ERROR(ret != 0, "failed to add key %u", key);
+		}
+		ret = rte_hash_add_key(handle, &key);
+		RETURN_IF_ERROR(ret != -ENOSPC, "added key to full table");
+
+		rcu_key_data_freed = 0;
+		key = 0;
+		pos = rte_hash_del_key(handle, &key);
+		RETURN_IF_ERROR(pos < 0, "failed to delete key %u", key);
+
+		key = RCU_TEST_ENTRIES;
+		if (mode == RTE_HASH_QSBR_MODE_DQ) {
+			/* The reader may still reference the deleted entry */
+			RETURN_IF_ERROR(rcu_key_data_freed != 0,
+					"key data freed before grace period");
+			ret = rte_hash_add_key(handle, &key);
+			RETURN_IF_ERROR(ret != -ENOSPC,
+				"reused key index before grace period");
+			rte_rcu_qsbr_quiescent(qsv, 0);
+		}
+
+		/* Grace period is over, the key index can be reused */
+		ret = rte_hash_add_key(handle, &key);
+		RETURN_IF_ERROR(ret != pos,
+			"failed to reuse key index %d (ret=%d)", pos, ret);
+		RETURN_IF_ERROR(rcu_key_data_freed != 1,
+				"key data not freed after grace period");
+
+		if (mode == RTE_HASH_QSBR_MODE_DQ)
+			rte_rcu_qsbr_thread_offline(qsv, 0);
+		rte_rcu_qsbr_thread_unregister(qsv, 0);
+		rte_hash_free(handle);
+	}
+
+	rte_free(qsv);
+
+	return 0;
+}
+
+/*
+ * Aging of idle keys.
+ *	- add 4 keys, wait, look up 2 of them
+ *	- scan the whole table: only the 2 other keys have expired
+ *	- scan one entry at a time: same result, iterator wraps around
+ */
+static int test_hash_aging(void)
+{
+	struct rte_hash *handle;
+	const void *key_array[2];
+	const void *expired[AGING_TEST_BURST];
+	int32_t pos[4], expired_pos[AGING_TEST_BURST];
+	const uint64_t timeout = rte_get_tsc_hz() / 100;
+	uint32_t next = 0, num_expired = 0, i;
+	int ret;
+
+	ut_params.name = "test_aging";
+	handle = rte_hash_create(&ut_params);
+	RETURN_IF_ERROR(handle == NULL, "hash creation failed");
+	ret = rte_hash_age_scan(handle, timeout, &next, 1, expired, NULL,
+				NULL, AGING_TEST_BURST);
+	RETURN_IF_ERROR(ret != -EINVAL, "aging scan without aging enabled");
+	rte_hash_free(handle);
+
+	ut_params.extra_flag = RTE_HASH_EXTRA_FLAGS_AGING;
+	handle = rte_hash_create(&ut_params);
+	ut_params.extra_flag = 0;
+	RETURN_IF_ERROR(handle == NULL, "hash creation failed");
+
+	for (i = 0; i < 4; i++) {
+		pos[i] = rte_hash_add_key(handle, &keys[i]);
+		RETURN_IF_ERROR(pos[i] < 0, "failed to add key %u", i);
+	}
+
+	/* Nothing is idle yet */
+	ret = rte_hash_age_scan(handle, timeout, &next, UINT32_MAX, expired,
+				NULL, expired_pos, AGING_TEST_BURST);
+	RETURN_IF_ERROR(ret != 0, "%d keys expired right after add", ret);
+	RETURN_IF_ERROR(next != 0, "iterator did not wrap around");
+
+	rte_delay_ms(50);
+
+	RETURN_IF_ERROR(rte_hash_lookup(handle, &keys[0]) != pos[0],
+			"failed to find key 0");
+	key_array[0] = &keys[1];
+	ret = rte_hash_lookup_bulk(handle, key_array, 1, expired_pos);
+	RETURN_IF_ERROR(ret != 0 || expired_pos[0] != pos[1],
+			"failed to find key 1");
+
+	ret = rte_hash_age_scan(handle, timeout, &next, UINT32_MAX, expired,
+				NULL, expired_pos, AGING_TEST_BURST);
+	RETURN_IF_ERROR(ret != 2, "%d keys expired, expected 2", ret);
+	for (i = 0; i < 2; i++)
+		RETURN_IF_ERROR(expired_pos[i] != pos[2] &&
+				expired_pos[i] != pos[3],
+				"key at %d should not expire", expired_pos[i]);
+
+	/* Incremental scan, one bucket entry per call */
+	do {
+		ret = rte_hash_age_scan(handle, timeout, &next, 1, expired,
+					NULL, NULL, AGING_TEST_BURST);
+		RETURN_IF_ERROR(ret < 0, "aging scan failed");
+		num_expired += ret;
+	} while (next != 0);
+	RETURN_IF_ERROR(num_expired != 2, "%u keys expired, expected 2",
+			num_expired);
+
+	rte_hash_free(handle);
+
+	return 0;
+}
+
+#define BULK_CMP_KEYS 64
+#define BULK_CMP_GROUP 8
+
+/* All the keys of a group get the same bucket and signature */
+static uint32_t
+test_hash_group(const void *key, uint32_t length __rte_unused,
+		uint32_t initval __rte_unused)
+{
+	return *(const uint8_t *)key;
+}
+
+/*
+ * Bulk lookups of 16 and 32-byte keys, which may compare several keys at
+ * a time. Each key shares its bucket and signature with the other keys of
+ * its group, and only differs from them in its last byte, so the first
+ * signature hit of a lookup is often another key. Only the even keys are
+ * added.
+ */
+static int test_hash_bulk_key_len(void)
+{
+	static const uint32_t key_lens[] = {16, 32};
+	static const uint32_t lookup_nums[] = {BULK_CMP_KEYS, 7, 1};
+	struct rte_hash_parameters params = {
+		.name = "test_bulk_cmp",
+		.entries = 2 * BULK_CMP_KEYS,
+		.hash_func = test_hash_group,
+		.socket_id = 0,
+	};
+	uint8_t bulk_keys[BULK_CMP_KEYS][32];
+	const void *key_array[BULK_CMP_KEYS];
+	int32_t added[BULK_CMP_KEYS], pos[BULK_CMP_KEYS];
+	void *data[BULK_CMP_KEYS];
+	const char *sig_cmp, *key_cmp;
+	struct rte_hash *handle;
+	uint64_t hit_mask, expected;
+	uint32_t i, k, lf, n;
+	int ret;
+
+	memset(bulk_keys, 0, sizeof(bulk_keys));
+	for (i = 0; i < BULK_CMP_KEYS; i++)
+		key_array[i] = bulk_keys[i];
+
+	for (k = 0; k < RTE_DIM(key_lens); k++) {
+		for (lf = 0; lf <= 1; lf++) {
+			params.key_len = key_lens[k];
+			params.extra_flag = lf ?
+				RTE_HASH_EXTRA_FLAGS_RW_CONCURRENCY_LF : 0;
+			handle = rte_hash_create(&params);
+			RETURN_IF_ERROR(handle == NULL,
+					"hash creation failed");
+			RETURN_IF_ERROR(rte_hash_get_cmp_path(handle, &sig_cmp,
+					&key_cmp) != 0, "no compare path");
+			if (lf == 0)
+				printf("%u-byte keys: %s signature compare, "
+					"%s key compare\n", key_lens[k],
+					sig_cmp, key_cmp);
+
+			for (i = 0; i < BULK_CMP_KEYS; i++) {
+				bulk_keys[i][0] = i / BULK_CMP_GROUP;
+				bulk_keys[i][key_lens[k] - 1] = i;
+				added[i] = -ENOENT;
+				if (i & 1)
+					continue;
+				added[i] = rte_hash_add_key_data(handle,
+						bulk_keys[i],
+						(void *)(uintptr_t)(i + 1));
+				RETURN_IF_ERROR(added[i] < 0,
+						"failed to add key %u", i);
+				added[i] = rte_hash_lookup(handle,
+						bulk_keys[i]);
+			}
+
+			for (n = 0; n < RTE_DIM(lookup_nums); n++) {
+				ret = rte_hash_lookup_bulk(handle, key_array,
+						lookup_nums[n], pos);
+				RETURN_IF_ERROR(ret != 0, "bulk lookup failed");
+				ret = rte_hash_lookup_bulk_data(handle,
+						key_array, lookup_nums[n],
+						&hit_mask, data);
+				expected = 0;
+				for (i = 0; i < lookup_nums[n]; i++) {
+					RETURN_IF_ERROR(pos[i] != added[i],
+						"key %u found at %d", i,
+						pos[i]);
+					if (added[i] < 0)
+						continue;
+					expected |= 1ULL << i;
+					RETURN_IF_ERROR(data[i] !=
+						(void *)(uintptr_t)(i + 1),
+						"wrong data of key %u", i);
+				}
+				RETURN_IF_ERROR(ret != __builtin_popcountll(
+						expected) ||
+						hit_mask != expected,
+						"wrong hits of %u keys",
+						lookup_nums[n]);
+			}
+
+			rte_hash_free(handle);
+			memset(bulk_keys, 0, sizeof(bulk_keys));
+		}
+	}
+
+	return 0;
+}
+
 /******************************************************************************/
 static int
 fbk_hash_unit_test(void)
@@ -1839,10 +2220,18 @@ test_hash(void)
 		return -1;
 	if (test_five_keys() < 0)
 		return -1;
+	if (test_five_keys_bulk() < 0)
+		return -1;
 	if (test_full_bucket() < 0)
 		return -1;
 	if (test_extendable_bucket() < 0)
 		return -1;
+	if (test_hash_rcu_qsbr() < 0)
+		return -1;
+	if (test_hash_aging() < 0)
+		return -1;
+	if (test_hash_bulk_key_len() < 0)
+		return -1;
 
 	if (test_fbk_hash_find_existing() < 0)
 		return -1;
@@ -0,0 +1,361 @@
+/* SPDX-License-Identifier: BSD-3-Clause
+ * Copyright(c) 2020 Intel Corporation
+ */
+
+#include <inttypes.h>
+#include <errno.h>
+#include <string.h>
+
+#include <rte_cycles.h>
+#include <rte_errno.h>
+#include <rte_hash_flow_cache.h>
+#include <rte_lcore.h>
+#include <rte_malloc.h>
+#include <rte_random.h>
+
+#include "test.h"
+
+#define PERF_ENTRIES	(64 * 1024)
+#define PERF_PACKETS	(1 << 20)
+#define PERF_BURST	32
+
+/* IPv4 5-tuple, 13 bytes */
+struct flow_key {
+	uint32_t src;
+	uint32_t dst;
+	uint16_t sport;
+	uint16_t dport;
+	uint8_t proto;
+} __attribute__((packed));
+
+static uint32_t evicted_src;
+static uint32_t evicted_count;
+static uint64_t evicted_packets;
+
+static void
+test_evict(void *arg, const void *key,
+		const struct rte_hash_flow_cache_entry *entry)
+{
+	const struct flow_key *k = key;
+
+	RTE_SET_USED(arg);
+	evicted_src = k->src;
+	evicted_count++;
+	evicted_packets += entry->packets;
+}
+
+static void
+make_key(struct flow_key *k, uint32_t i)
+{
+	memset(k, 0, sizeof(*k));
+	k->src = i;
+	k->dst = ~i;
+	k->sport = i & 0xffff;
+	k->dport = 80;
+	k->proto = 6;
+}
+
+/* Hash sending every key to the single bucket of a small cache */
+static uint32_t
+same_bucket_hash(const void *key, uint32_t key_len, uint32_t init_val)
+{
+	const struct flow_key *k = key;
+
+	RTE_SET_USED(key_len);
+	RTE_SET_USED(init_val);
+	return k->src << 16;
+}
+
+static int
+test_hash_flow_cache_create(void)
+{
+	struct rte_hash_flow_cache_params params = {
+		.name = "fc_create",
+		.entries = 1024,
+		.key_len = sizeof(struct flow_key),
+		.socket_id = rte_socket_id(),
+	};
+	struct rte_hash_flow_cache *fc, *fc2;
+
+	params.entries = 1000;
+	TEST_ASSERT_NULL(rte_hash_flow_cache_create(&params),
+			"created with entries not a power of 2");
+	params.entries = RTE_HASH_FLOW_CACHE_BUCKET_ENTRIES / 2;
+	TEST_ASSERT_NULL(rte_hash_flow_cache_create(&params),
+			"created with less entries than a bucket");
+	params.entries = 1024;
+	params.key_len = RTE_HASH_FLOW_CACHE_KEY_LEN_MAX + 1;
+	TEST_ASSERT_NULL(rte_hash_flow_cache_create(&params),
+			"created with too long keys");
+	TEST_ASSERT_EQUAL(rte_errno, EINVAL, "wrong rte_errno");
+	params.key_len = sizeof(struct flow_key);
+
+	fc = rte_hash_flow_cache_create(&params);
+	TEST_ASSERT_NOT_NULL(fc, "creation failed");
+	TEST_ASSERT_NULL(rte_hash_flow_cache_create(&params),
+			"created twice with the same name");
+	TEST_ASSERT_EQUAL(rte_errno, EEXIST, "wrong rte_errno");
+	fc2 = rte_hash_flow_cache_find_existing("fc_create");
+	TEST_ASSERT_EQUAL(fc, fc2, "find existing returned another cache");
+	rte_hash_flow_cache_free(fc);
+	TEST_ASSERT_NULL(rte_hash_flow_cache_find_existing("fc_create"),
+			"found a freed cache");
+
+	return 0;
+}
+
+static int
+test_hash_flow_cache_lru(void)
+{
+	struct rte_hash_flow_cache_params params = {
+		.name = "fc_lru",
+		.entries = RTE_HASH_FLOW_CACHE_BUCKET_ENTRIES,
+		.key_len = sizeof(struct flow_key),
+		.socket_id = rte_socket_id(),
+		.hash_func = same_bucket_hash,
+		.evict_cb = test_evict,
+	};
+	struct rte_hash_flow_cache_stats stats;
+	struct rte_hash_flow_cache_entry *e;
+	struct rte_hash_flow_cache *fc;
+	struct flow_key k;
+	uint32_t i;
+	int added;
+
+	fc = rte_hash_flow_cache_create(&params);
+	TEST_ASSERT_NOT_NULL(fc, "creation failed");
+	evicted_count = 0;
+	evicted_packets = 0;
+
+	/* Fill the bucket, key i gets i + 1 packets of 100 bytes */
+	for (i = 0; i < RTE_HASH_FLOW_CACHE_BUCKET_ENTRIES; i++) {
+		make_key(&k, i);
+		e = rte_hash_flow_cache_lookup_or_add(fc, &k, 100, i, &added);
+		TEST_ASSERT(e != NULL && added == 1, "key %u not added", i);
+		e->data = i;
+	}
+	for (i = 0; i < RTE_HASH_FLOW_CACHE_BUCKET_ENTRIES; i++) {
+		make_key(&k, i);
+		e = rte_hash_flow_cache_lookup_or_add(fc, &k, 100, i, &added);
+		TEST_ASSERT(e != NULL && added == 0, "key %u not found", i);
+		TEST_ASSERT_EQUAL(e->data, i, "wrong data");
+	}
+	TEST_ASSERT_EQUAL(evicted_count, 0, "eviction in a non full bucket");
+
+	make_key(&k, 3);
+	e = rte_hash_flow_cache_lookup(fc, &k);
+	TEST_ASSERT_NOT_NULL(e, "key 3 not found");
+	TEST_ASSERT_EQUAL(e->packets, 2, "wrong packet count");
+	TEST_ASSERT_EQUAL(e->bytes, 200, "wrong byte count");
+	TEST_ASSERT_EQUAL(e->last_seen, 3, "wrong last seen");
+
+	/* Key 0 is the least recently used, then key 1 */
+	make_key(&k, 0);
+	TEST_ASSERT_NOT_NULL(rte_hash_flow_cache_lookup(fc, &k),
+			"key 0 not found");
+	make_key(&k, 100);
+	e = rte_hash_flow_cache_lookup_or_add(fc, &k, 100, 100, &added);
+	TEST_ASSERT(e != NULL && added == 1, "key 100 not added");
+	TEST_ASSERT_EQUAL(evicted_count, 1, "no eviction");
+	TEST_ASSERT_EQUAL(evicted_src, 1, "evicted key %u instead of 1",
+			evicted_src);
+	TEST_ASSERT_EQUAL(evicted_packets, 2, "wrong evicted counters");
+	TEST_ASSERT_EQUAL(e->data, 0, "data of evicted key kept");
+	TEST_ASSERT_EQUAL(e->packets, 1, "counters of evicted key kept");
+	make_key(&k, 1);
+	TEST_ASSERT_NULL(rte_hash_flow_cache_lookup(fc, &k),
+			"evicted key found");
+
+	/* A deleted entry is reused before evicting */
+	make_key(&k, 5);
+	TEST_ASSERT_SUCCESS(rte_hash_flow_cache_del(fc, &k), "delete failed");
+	TEST_ASSERT_EQUAL(rte_hash_flow_cache_del(fc, &k), -ENOENT,
+			"deleted twice");
+	make_key(&k, 101);
+	TEST_ASSERT_NOT_NULL(rte_hash_flow_cache_lookup_or_add(fc, &k, 0, 0,
+			NULL), "key 101 not added");
+	TEST_ASSERT_EQUAL(evicted_count, 1, "evicted with a free entry");
+
+	rte_hash_flow_cache_stats_get(fc, &stats);
+	TEST_ASSERT_EQUAL(stats.used, RTE_HASH_FLOW_CACHE_BUCKET_ENTRIES,
+			"wrong used count");
+	TEST_ASSERT_EQUAL(stats.evictions, 1, "wrong eviction count");
+	TEST_ASSERT_EQUAL(stats.misses, RTE_HASH_FLOW_CACHE_BUCKET_ENTRIES + 2,
+			"wrong miss count");
+
+	rte_hash_flow_cache_reset(fc);
+	rte_hash_flow_cache_stats_get(fc, &stats);
+	TEST_ASSERT_EQUAL(stats.used, 0, "entries left after reset");
+	make_key(&k, 0);
+	TEST_ASSERT_NULL(rte_hash_flow_cache_lookup(fc, &k),
+			"key found after reset");
+
+	rte_hash_flow_cache_free(fc);
+
+	return 0;
+}
+
+static int
+test_hash_flow_cache_bulk(void)
+{
+	struct rte_hash_flow_cache_params params = {
+		.name = "fc_bulk",
+		.entries = 1024,
+		.key_len = sizeof(struct flow_key),
+		.socket_id = rte_socket_id(),
+	};
+	struct rte_hash_flow_cache_entry *
+		entries[RTE_HASH_FLOW_CACHE_LOOKUP_BULK_MAX];
+	struct flow_key keys[RTE_HASH_FLOW_CACHE_LOOKUP_BULK_MAX];
+	const void *key_ptrs[RTE_HASH_FLOW_CACHE_LOOKUP_BULK_MAX];
+	uint32_t pkt_len[RTE_HASH_FLOW_CACHE_LOOKUP_BULK_MAX];
+	struct rte_hash_flow_cache_entry *e;
+	struct rte_hash_flow_cache *fc;
+	const void *key;
+	uint64_t added_mask;
+	uint32_t i, next, count;
+	int ret;
+
+	fc = rte_hash_flow_cache_create(&params);
+	TEST_ASSERT_NOT_NULL(fc, "creation failed");
+
+	/* 32 flows, each seen twice in the burst */
+	for (i = 0; i < RTE_DIM(keys); i++) {
+		make_key(&keys[i], i % 32);
+		key_ptrs[i] = &keys[i];
+		pkt_len[i] = 64;
+	}
+
+	ret = rte_hash_flow_cache_lookup_or_add_bulk(fc, key_ptrs, pkt_len,
+			RTE_DIM(keys), 1, entries, &added_mask);
+	TEST_ASSERT_EQUAL(ret, 32, "%d keys added instead of 32", ret);
+	TEST_ASSERT_EQUAL(added_mask, UINT32_MAX, "wrong added mask");
+	for (i = 32; i < RTE_DIM(keys); i++)
+		TEST_ASSERT_EQUAL(entries[i], entries[i - 32],
+				"duplicate key %u got another entry", i);
+
+	ret = rte_hash_flow_cache_lookup_or_add_bulk(fc, key_ptrs, NULL,
+			RTE_DIM(keys), 2, entries, &added_mask);
+	TEST_ASSERT(ret == 0 && added_mask == 0, "keys added twice");
+	for (i = 0; i < 32; i++) {
+		TEST_ASSERT_EQUAL(entries[i]->packets, 4, "wrong packets");
+		TEST_ASSERT_EQUAL(entries[i]->bytes, 128, "wrong bytes");
+		TEST_ASSERT_EQUAL(entries[i]->last_seen, 2, "wrong last seen");
+	}
+
+	count = 0;
+	next = 0;
+	while (rte_hash_flow_cache_iterate(fc, &key, &e, &next) == 0) {
+		TEST_ASSERT_EQUAL(e, rte_hash_flow_cache_lookup(fc, key),
+				"iterated key not found");
+		count++;
+	}
+	TEST_ASSERT_EQUAL(count, 32, "iterated %u entries instead of 32",
+			count);
+
+	TEST_ASSERT_EQUAL(rte_hash_flow_cache_lookup_or_add_bulk(fc, key_ptrs,
+			NULL, RTE_HASH_FLOW_CACHE_LOOKUP_BULK_MAX + 1, 0,
+			entries, NULL), -EINVAL, "too large burst accepted");
+
+	rte_hash_flow_cache_free(fc);
+
+	return 0;
+}
+
+/* Packets of num_flows random flows, looked up in bursts */
+static int
+test_hash_flow_cache_perf_run(struct rte_hash_flow_cache *fc,
+		uint32_t num_flows)
+{
+	struct rte_hash_flow_cache_entry *entries[PERF_BURST];
+	const void *key_ptrs[PERF_BURST];
+	struct rte_hash_flow_cache_stats stats;
+	struct flow_key *keys;
+	uint64_t begin, bulk_cycles = 0, single_cycles = 0;
+	uint32_t i, j;
+
+	keys = rte_malloc(NULL, sizeof(*keys) * PERF_PACKETS, 0);
+	if (keys == NULL)
+		return -1;
+	for (i = 0; i < PERF_PACKETS; i++)
+		make_key(&keys[i], rte_rand_max(num_flows));
+
+	rte_hash_flow_cache_reset(fc);
+	for (i = 0; i < PERF_PACKETS; i += PERF_BURST) {
+		for (j = 0; j < PERF_BURST; j++)
+			key_ptrs[j] = &keys[i + j];
+		begin = rte_rdtsc();
+		rte_hash_flow_cache_lookup_or_add_bulk(fc, key_ptrs, NULL,
+				PERF_BURST, i, entries, NULL);
+		bulk_cycles += rte_rdtsc() - begin;
+	}
+	rte_hash_flow_cache_stats_get(fc, &stats);
+
+	rte_hash_flow_cache_reset(fc);
+	for (i = 0; i < PERF_PACKETS; i += PERF_BURST) {
+		begin = rte_rdtsc();
+		for (j = 0; j < PERF_BURST; j++)
+			rte_hash_flow_cache_lookup_or_add(fc, &keys[i + j],
+					0, i, NULL);
+		single_cycles += rte_rdtsc() - begin;
+	}
+
+	printf("%-10u %-10.1f %-12"PRIu64" %-10.1f %-10.1f\n", num_flows,
+			100.0 * stats.hits / PERF_PACKETS, stats.evictions,
+			(double)bulk_cycles / PERF_PACKETS,
+			(double)single_cycles / PERF_PACKETS);
+
+	rte_free(keys);
+	return 0;
+}
+
+static int
+test_hash_flow_cache_perf(void)
+{
+	struct rte_hash_flow_cache_params params = {
+		.name = "fc_perf",
+		.entries = PERF_ENTRIES,
+		.key_len = sizeof(struct flow_key),
+		.socket_id = rte_socket_id(),
+	};
+	static const uint32_t num_flows[] = {
+		PERF_ENTRIES / 16, PERF_ENTRIES / 2, PERF_ENTRIES,
+		PERF_ENTRIES * 4
+	};
+	struct rte_hash_flow_cache *fc;
+	uint32_t i;
+
+	fc = rte_hash_flow_cache_create(&params);
+	TEST_ASSERT_NOT_NULL(fc, "creation failed");
+
+	printf("\n%u entries, %u packets, burst of %u\n", PERF_ENTRIES,
+			PERF_PACKETS, PERF_BURST);
+	printf("%-10s %-10s %-12s %-10s %-10s\n", "flows", "hit %",
+			"evictions", "bulk cyc", "single cyc");
+	for (i = 0; i < RTE_DIM(num_flows); i++)
+		if (test_hash_flow_cache_perf_run(fc, num_flows[i]) != 0) {
+			rte_hash_flow_cache_free(fc);
+			return -1;
+		}
+
+	rte_hash_flow_cache_free(fc);
+
+	return 0;
+}
+
+static int
+test_hash_flow_cache(void)
+{
+	if (test_hash_flow_cache_create() < 0)
+		return -1;
+	if (test_hash_flow_cache_lru() < 0)
+		return -1;
+	if (test_hash_flow_cache_bulk() < 0)
+		return -1;
+	if (test_hash_flow_cache_perf() < 0)
+		return -1;
+
+	return 0;
+}
+
+REGISTER_TEST_COMMAND(hash_flow_cache_autotest, test_hash_flow_cache);
@@ -34,6 +34,8 @@ enum operations {
 	LOOKUP,
 	LOOKUP_MULTI,
 	DELETE,
+	ADD_MULTI,
+	DELETE_MULTI,
 	NUM_OPERATIONS
 };
 
@@ -55,6 +57,10 @@ struct rte_hash *h[NUM_KEYSIZES];
 /* Array that stores if a slot is full */
 static uint8_t slot_taken[MAX_ENTRIES];
 
+/* Signature and key compare functions picked for each key size */
+static const char *sig_cmp_path[NUM_KEYSIZES];
+static const char *key_cmp_path[NUM_KEYSIZES];
+
 /* Array to store number of cycles per operation */
 static uint64_t cycles[NUM_KEYSIZES][NUM_OPERATIONS][2][2];
 
@@ -117,6 +123,8 @@ create_table(unsigned int with_data, unsigned int table_index,
 		printf("Error creating table\n");
 		return -1;
 	}
+	rte_hash_get_cmp_path(h[table_index], &sig_cmp_path[table_index],
+			&key_cmp_path[table_index]);
 	return 0;
 
 }
@@ -505,6 +513,98 @@ timed_deletes(unsigned int with_hash, unsigned int with_data,
 	return 0;
 }
 
+static int
+timed_adds_multi(unsigned int with_data, unsigned int table_index,
+							unsigned int ext)
+{
+	unsigned int i, k, burst;
+	int32_t positions_burst[BURST_SIZE];
+	const void *keys_burst[BURST_SIZE];
+	void *data_burst[BURST_SIZE];
+	int ret;
+	unsigned int keys_to_add;
+
+	if (!ext)
+		keys_to_add = KEYS_TO_ADD * ADD_PERCENT;
+	else
+		keys_to_add = KEYS_TO_ADD;
+
+	const uint64_t start_tsc = rte_rdtsc();
+
+	for (i = 0; i < keys_to_add; i += burst) {
+		burst = RTE_MIN(keys_to_add - i, (unsigned int)BURST_SIZE);
+		for (k = 0; k < burst; k++) {
+			keys_burst[k] = keys[i + k];
+			data_burst[k] = (void *) ((uintptr_t) signatures[i + k]);
+		}
+		ret = rte_hash_add_key_bulk(h[table_index],
+				(const void **) keys_burst,
+				with_data ? data_burst : NULL,
+				burst, positions_burst);
+		if (ret != (int)burst) {
+			printf("Expect to add %u keys, but added %d\n",
+				burst, ret);
+			return -1;
+		}
+		for (k = 0; k < burst; k++)
+			positions[i + k] = positions_burst[k];
+	}
+
+	const uint64_t end_tsc = rte_rdtsc();
+	const uint64_t time_taken = end_tsc - start_tsc;
+
+	cycles[table_index][ADD_MULTI][0][with_data] = time_taken/keys_to_add;
+
+	return 0;
+}
+
+static int
+timed_deletes_multi(unsigned int with_data, unsigned int table_index,
+							unsigned int ext)
+{
+	unsigned int i, k, burst;
+	int32_t positions_burst[BURST_SIZE];
+	const void *keys_burst[BURST_SIZE];
+	int ret;
+	unsigned int keys_to_add;
+
+	if (!ext)
+		keys_to_add = KEYS_TO_ADD * ADD_PERCENT;
+	else
+		keys_to_add = KEYS_TO_ADD;
+
+	const uint64_t start_tsc = rte_rdtsc();
+
+	for (i = 0; i < keys_to_add; i += burst) {
+		burst = RTE_MIN(keys_to_add - i, (unsigned int)BURST_SIZE);
+		for (k = 0; k < burst; k++)
+			keys_burst[k] = keys[i + k];
+		ret = rte_hash_del_key_bulk(h[table_index],
+				(const void **) keys_burst,
+				burst, positions_burst);
+		if (ret != (int)burst) {
+			printf("Expect to delete %u keys, but deleted %d\n",
+				burst, ret);
+			return -1;
+		}
+		for (k = 0; k < burst; k++) {
+			if (positions_burst[k] != positions[i + k]) {
+				printf("Key deleted from %d, should be %d\n",
+					positions_burst[k], positions[i + k]);
+				return -1;
+			}
+		}
+	}
+
+	const uint64_t end_tsc = rte_rdtsc();
+	const uint64_t time_taken = end_tsc - start_tsc;
+
+	cycles[table_index][DELETE_MULTI][0][with_data] =
+						time_taken/keys_to_add;
+
+	return 0;
+}
+
 static void
 free_table(unsigned table_index)
 {
@@ -549,6 +649,12 @@ run_all_tbl_perf_tests(unsigned int with_pushes, unsigned int with_locks,
 				if (timed_deletes(with_hash, with_data, i, ext) < 0)
 					return -1;
 
+				if (timed_adds_multi(with_data, i, ext) < 0)
+					return -1;
+
+				if (timed_deletes_multi(with_data, i, ext) < 0)
+					return -1;
+
 				/* Print a dot to show progress on operations */
 				printf(".");
 				fflush(stdout);
@@ -572,8 +678,9 @@ run_all_tbl_perf_tests(unsigned int with_pushes, unsigned int with_locks,
 			else
 				printf("\nWithout pre-computed hash values\n");
 
-			printf("\n%-18s%-18s%-18s%-18s%-18s\n",
-			"Keysize", "Add", "Lookup", "Lookup_bulk", "Delete");
+			printf("\n%-18s%-18s%-18s%-18s%-18s%-18s%-18s\n",
+			"Keysize", "Add", "Lookup", "Lookup_bulk", "Delete",
+			"Add_bulk", "Delete_bulk");
 			for (i = 0; i < NUM_KEYSIZES; i++) {
 				printf("%-18d", hashtest_key_lens[i]);
 				for (j = 0; j < NUM_OPERATIONS; j++)
@@ -582,6 +689,11 @@ run_all_tbl_perf_tests(unsigned int with_pushes, unsigned int with_locks,
 			}
 		}
 	}
+
+	printf("\n%-18s%-18s%-18s\n", "Keysize", "Signature_cmp", "Key_cmp");
+	for (i = 0; i < NUM_KEYSIZES; i++)
+		printf("%-18d%-18s%-18s\n", hashtest_key_lens[i],
+				sig_cmp_path[i], key_cmp_path[i]);
 	return 0;
 }
 
@@ -672,6 +784,7 @@ static int
 test_hash_perf(void)
 {
 	unsigned int with_pushes, with_locks;
+
 	for (with_locks = 0; with_locks <= 1; with_locks++) {
 		if (with_locks)
 			printf("\nWith locks in the code\n");
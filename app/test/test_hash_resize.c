@@ -0,0 +1,391 @@
+/* SPDX-License-Identifier: BSD-3-Clause
+ * Copyright(c) 2020 Intel Corporation
+ */
+
+#include <inttypes.h>
+#include <errno.h>
+#include <string.h>
+
+#include <rte_cycles.h>
+#include <rte_hash.h>
+#include <rte_hash_crc.h>
+#include <rte_launch.h>
+#include <rte_lcore.h>
+#include <rte_malloc.h>
+#include <rte_random.h>
+#include <rte_rcu_qsbr.h>
+
+#include "test.h"
+
+/*
+ * Online resize of the lock-free hash table.
+ *
+ * The functional test checks that every key stays reachable while the
+ * buckets are migrated in small batches, with adds and deletes done in
+ * between. The concurrent test keeps readers looking up on the other
+ * lcores while the writer fills the table and doubles it several times,
+ * and reports how long the migration steps and the lookups took.
+ */
+
+#define RESIZE_ENTRIES		1024
+#define RESIZE_STEP_BUCKETS	8
+
+#define RESIZE_PERF_ENTRIES	(16 * 1024)
+#define RESIZE_PERF_DOUBLINGS	3
+#define RESIZE_PERF_STEP_BUCKETS 64
+#define RESIZE_PERF_BULK	8
+
+static struct rte_rcu_qsbr *qsv;
+
+static struct rte_hash *
+resize_create(const char *name, uint32_t entries, uint8_t extra_flag)
+{
+	struct rte_hash_parameters params = {
+		.name = name,
+		.entries = entries,
+		.key_len = sizeof(uint32_t),
+		.hash_func = rte_hash_crc,
+		.hash_func_init_val = 0,
+		.socket_id = rte_socket_id(),
+		.extra_flag = extra_flag,
+	};
+
+	return rte_hash_create(&params);
+}
+
+static int
+resize_qsbr_add(struct rte_hash *h)
+{
+	struct rte_hash_rcu_config rcu_cfg = {
+		.v = qsv,
+		.mode = RTE_HASH_QSBR_MODE_SYNC,
+	};
+
+	return rte_hash_rcu_qsbr_add(h, &rcu_cfg);
+}
+
+/* Check that keys [0, num) are present except the deleted odd ones */
+static int
+resize_check_keys(struct rte_hash *h, uint32_t num, uint32_t del_limit)
+{
+	uint32_t key, i, n;
+	const void *key_ptrs[RTE_HASH_LOOKUP_BULK_MAX];
+	uint32_t keys[RTE_HASH_LOOKUP_BULK_MAX];
+	int32_t positions[RTE_HASH_LOOKUP_BULK_MAX];
+	int32_t ret;
+
+	for (key = 0; key < num; key++) {
+		ret = rte_hash_lookup(h, &key);
+		if ((key & 1) && key < del_limit) {
+			if (ret != -ENOENT) {
+				printf("deleted key %u found\n", key);
+				return -1;
+			}
+		} else if (ret < 0) {
+			printf("key %u not found (%d)\n", key, ret);
+			return -1;
+		}
+	}
+
+	for (key = 0; key < num; key += n) {
+		n = RTE_MIN(num - key, (uint32_t)RTE_HASH_LOOKUP_BULK_MAX);
+		for (i = 0; i < n; i++) {
+			keys[i] = key + i;
+			key_ptrs[i] = &keys[i];
+		}
+		if (rte_hash_lookup_bulk(h, key_ptrs, n, positions) != 0)
+			return -1;
+		for (i = 0; i < n; i++) {
+			if ((keys[i] & 1) && keys[i] < del_limit)
+				continue;
+			if (positions[i] < 0) {
+				printf("key %u not found by bulk lookup\n",
+						keys[i]);
+				return -1;
+			}
+		}
+	}
+
+	return 0;
+}
+
+static int
+test_hash_resize_functional(void)
+{
+	struct rte_hash *h;
+	uint32_t key, num_keys, del_key, steps;
+	int ret;
+
+	/* Only lock-free tables with RCU can be resized */
+	h = resize_create("resize_nolf", RESIZE_ENTRIES, 0);
+	TEST_ASSERT_NOT_NULL(h, "hash creation failed");
+	TEST_ASSERT_EQUAL(rte_hash_resize_start(h), -ENOTSUP,
+			"resize of a table without lock-free readers");
+	rte_hash_free(h);
+
+	h = resize_create("resize_func", RESIZE_ENTRIES,
+			RTE_HASH_EXTRA_FLAGS_RW_CONCURRENCY_LF);
+	TEST_ASSERT_NOT_NULL(h, "hash creation failed");
+	TEST_ASSERT_EQUAL(rte_hash_resize_start(h), -ENOTSUP,
+			"resize of a table without RCU");
+	TEST_ASSERT_SUCCESS(resize_qsbr_add(h), "RCU add failed");
+	TEST_ASSERT_EQUAL(rte_hash_resize_step(h, 1), 0,
+			"step without a resize in progress");
+
+	/* Fill the table up */
+	for (key = 0; rte_hash_add_key(h, &key) >= 0; key++)
+		;
+	num_keys = key;
+	printf("table full with %u keys\n", num_keys);
+
+	TEST_ASSERT_SUCCESS(rte_hash_resize_start(h), "resize start failed");
+	TEST_ASSERT_EQUAL(rte_hash_resize_start(h), -EBUSY,
+			"resize started twice");
+	TEST_ASSERT_EQUAL(rte_hash_max_key_id(h), 2 * RESIZE_ENTRIES,
+			"capacity not doubled");
+
+	/* Add and delete keys while the buckets move */
+	del_key = 1;
+	steps = 0;
+	do {
+		ret = rte_hash_resize_step(h, RESIZE_STEP_BUCKETS);
+		TEST_ASSERT(ret >= 0, "resize step failed (%d)", ret);
+		steps++;
+
+		TEST_ASSERT(rte_hash_add_key(h, &num_keys) >= 0,
+				"add of key %u during resize failed",
+				num_keys);
+		num_keys++;
+		TEST_ASSERT(rte_hash_del_key(h, &del_key) >= 0,
+				"delete of key %u during resize failed",
+				del_key);
+		del_key += 2;
+
+		TEST_ASSERT_SUCCESS(resize_check_keys(h, num_keys, del_key),
+				"lookup failed after %u steps", steps);
+	} while (ret != 0);
+	printf("resize done in %u steps\n", steps);
+
+	TEST_ASSERT_EQUAL(rte_hash_count(h),
+			(int32_t)(num_keys - (del_key - 1) / 2),
+			"wrong number of keys after resize");
+
+	/* The new capacity is usable */
+	while (rte_hash_count(h) < RESIZE_ENTRIES + RESIZE_ENTRIES / 2) {
+		TEST_ASSERT(rte_hash_add_key(h, &num_keys) >= 0,
+				"add of key %u after resize failed", num_keys);
+		num_keys++;
+	}
+	TEST_ASSERT_SUCCESS(resize_check_keys(h, num_keys, del_key),
+			"lookup failed after resize");
+
+	/* A reset drops a resize in progress */
+	TEST_ASSERT_SUCCESS(rte_hash_resize_start(h), "resize start failed");
+	TEST_ASSERT(rte_hash_resize_step(h, RESIZE_STEP_BUCKETS) > 0,
+			"resize finished too early");
+	rte_hash_reset(h);
+	TEST_ASSERT_EQUAL(rte_hash_count(h), 0, "keys left after reset");
+	TEST_ASSERT_EQUAL(rte_hash_resize_step(h, 1), 0,
+			"resize still in progress after reset");
+	key = 0;
+	TEST_ASSERT(rte_hash_add_key(h, &key) >= 0, "add after reset failed");
+	TEST_ASSERT(rte_hash_lookup(h, &key) >= 0,
+			"lookup after reset failed");
+
+	rte_hash_free(h);
+
+	return 0;
+}
+
+static struct {
+	struct rte_hash *h;
+	uint32_t num_keys;
+	uint32_t stop;
+	uint64_t lookups[RTE_MAX_LCORE];
+	uint64_t misses[RTE_MAX_LCORE];
+	uint64_t cycles[RTE_MAX_LCORE];
+	uint64_t max_cycles[RTE_MAX_LCORE];
+} resize_perf;
+
+static int
+resize_reader(__attribute__((unused)) void *arg)
+{
+	unsigned int lcore_id = rte_lcore_id();
+	const void *key_ptrs[RESIZE_PERF_BULK];
+	uint32_t keys[RESIZE_PERF_BULK];
+	int32_t positions[RESIZE_PERF_BULK];
+	uint64_t lookups = 0, misses = 0, cycles = 0, max_cycles = 0;
+	uint64_t begin, diff;
+	uint32_t num_keys, i;
+
+	for (i = 0; i < RESIZE_PERF_BULK; i++)
+		key_ptrs[i] = &keys[i];
+
+	rte_rcu_qsbr_thread_register(qsv, lcore_id);
+	rte_rcu_qsbr_thread_online(qsv, lcore_id);
+
+	while (!__atomic_load_n(&resize_perf.stop, __ATOMIC_RELAXED)) {
+		/* Only look up keys which have been added already */
+		num_keys = __atomic_load_n(&resize_perf.num_keys,
+				__ATOMIC_ACQUIRE);
+		for (i = 0; i < RESIZE_PERF_BULK; i++)
+			keys[i] = rte_rand_max(num_keys);
+
+		begin = rte_rdtsc_precise();
+		rte_hash_lookup_bulk(resize_perf.h, key_ptrs,
+				RESIZE_PERF_BULK, positions);
+		diff = rte_rdtsc_precise() - begin;
+
+		for (i = 0; i < RESIZE_PERF_BULK; i++)
+			if (positions[i] < 0)
+				misses++;
+		lookups += RESIZE_PERF_BULK;
+		cycles += diff;
+		if (diff > max_cycles)
+			max_cycles = diff;
+
+		rte_rcu_qsbr_quiescent(qsv, lcore_id);
+	}
+
+	rte_rcu_qsbr_thread_offline(qsv, lcore_id);
+	rte_rcu_qsbr_thread_unregister(qsv, lcore_id);
+
+	resize_perf.lookups[lcore_id] = lookups;
+	resize_perf.misses[lcore_id] = misses;
+	resize_perf.cycles[lcore_id] = cycles;
+	resize_perf.max_cycles[lcore_id] = max_cycles;
+
+	return 0;
+}
+
+static int
+test_hash_resize_concurrent(void)
+{
+	struct rte_hash *h;
+	uint64_t begin, resize_cycles, step_cycles, max_step_cycles;
+	uint64_t lookups = 0, misses = 0, cycles = 0, max_cycles = 0;
+	uint32_t key, steps, doublings = 0;
+	unsigned int lcore_id;
+	int ret;
+
+	if (rte_lcore_count() < 2) {
+		printf("Not enough cores for concurrent resize test, "
+				"skipping\n");
+		return 0;
+	}
+
+	h = resize_create("resize_perf", RESIZE_PERF_ENTRIES,
+			RTE_HASH_EXTRA_FLAGS_RW_CONCURRENCY_LF);
+	TEST_ASSERT_NOT_NULL(h, "hash creation failed");
+	TEST_ASSERT_SUCCESS(resize_qsbr_add(h), "RCU add failed");
+
+	/* Start with one key so that readers always have one to find */
+	key = 0;
+	TEST_ASSERT(rte_hash_add_key(h, &key) >= 0, "add failed");
+	memset(&resize_perf, 0, sizeof(resize_perf));
+	resize_perf.h = h;
+	resize_perf.num_keys = 1;
+
+	RTE_LCORE_FOREACH_SLAVE(lcore_id)
+		rte_eal_remote_launch(resize_reader, NULL, lcore_id);
+
+	printf("%-9s %-8s %-8s %-14s %-14s %-14s\n", "entries", "keys",
+			"steps", "total cycles", "avg step", "max step");
+
+	key = 1;
+	while (doublings < RESIZE_PERF_DOUBLINGS) {
+		/* Fill the table until an add fails, then double it */
+		ret = rte_hash_add_key(h, &key);
+		if (ret >= 0) {
+			key++;
+			__atomic_store_n(&resize_perf.num_keys, key,
+					__ATOMIC_RELEASE);
+			continue;
+		}
+
+		ret = rte_hash_resize_start(h);
+		if (ret != 0) {
+			printf("resize start failed (%d)\n", ret);
+			break;
+		}
+
+		steps = 0;
+		resize_cycles = 0;
+		max_step_cycles = 0;
+		do {
+			begin = rte_rdtsc_precise();
+			ret = rte_hash_resize_step(h, RESIZE_PERF_STEP_BUCKETS);
+			step_cycles = rte_rdtsc_precise() - begin;
+			if (ret < 0)
+				break;
+			steps++;
+			resize_cycles += step_cycles;
+			if (step_cycles > max_step_cycles)
+				max_step_cycles = step_cycles;
+
+			/* Keep adding while the buckets move */
+			if (rte_hash_add_key(h, &key) >= 0) {
+				key++;
+				__atomic_store_n(&resize_perf.num_keys, key,
+						__ATOMIC_RELEASE);
+			}
+		} while (ret != 0);
+		if (ret < 0) {
+			printf("resize step failed (%d)\n", ret);
+			break;
+		}
+
+		doublings++;
+		printf("%-9d %-8u %-8u %-14"PRIu64" %-14"PRIu64" %-14"PRIu64
+				"\n", rte_hash_max_key_id(h), key, steps,
+				resize_cycles, resize_cycles / steps,
+				max_step_cycles);
+	}
+
+	__atomic_store_n(&resize_perf.stop, 1, __ATOMIC_RELAXED);
+	rte_eal_mp_wait_lcore();
+
+	RTE_LCORE_FOREACH_SLAVE(lcore_id) {
+		lookups += resize_perf.lookups[lcore_id];
+		misses += resize_perf.misses[lcore_id];
+		cycles += resize_perf.cycles[lcore_id];
+		if (resize_perf.max_cycles[lcore_id] > max_cycles)
+			max_cycles = resize_perf.max_cycles[lcore_id];
+	}
+	printf("readers: %"PRIu64" lookups, %"PRIu64" misses, "
+			"avg %"PRIu64" max %"PRIu64" cycles per bulk of %u\n",
+			lookups, misses,
+			lookups ? cycles * RESIZE_PERF_BULK / lookups : 0,
+			max_cycles, RESIZE_PERF_BULK);
+
+	rte_hash_free(h);
+
+	TEST_ASSERT_EQUAL(doublings, RESIZE_PERF_DOUBLINGS,
+			"table not resized %u times", RESIZE_PERF_DOUBLINGS);
+	TEST_ASSERT_EQUAL(misses, 0, "readers missed keys during resize");
+
+	return 0;
+}
+
+static int
+test_hash_resize(void)
+{
+	size_t sz;
+	int ret;
+
+	sz = rte_rcu_qsbr_get_memsize(RTE_MAX_LCORE);
+	qsv = rte_zmalloc(NULL, sz, RTE_CACHE_LINE_SIZE);
+	if (qsv == NULL)
+		return TEST_FAILED;
+	rte_rcu_qsbr_init(qsv, RTE_MAX_LCORE);
+
+	ret = test_hash_resize_functional();
+	if (ret == 0)
+		ret = test_hash_resize_concurrent();
+
+	rte_free(qsv);
+
+	return ret == 0 ? TEST_SUCCESS : TEST_FAILED;
+}
+
+REGISTER_TEST_COMMAND(hash_resize_autotest, test_hash_resize);
@@ -0,0 +1,710 @@
+/* SPDX-License-Identifier: BSD-3-Clause
+ * Copyright(c) 2020 Intel Corporation
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <inttypes.h>
+
+#include <rte_cycles.h>
+#include <rte_ether.h>
+#include <rte_ip.h>
+#include <rte_errno.h>
+#include <rte_mbuf.h>
+#include <rte_memcpy.h>
+#include <rte_ip_frag.h>
+
+#include "test.h"
+
+/*
+ * Synthetic streams of IPv4 and IPv6 fragments are reassembled with the
+ * fragment table and rte_ipv4/6_frag_reassemble_packet(), then with a
+ * reassembly engine shard and rte_ipv4/6_frag_reassemble_burst(). The
+ * fragments of NB_FLOWS packets are interleaved, the ones of every other
+ * packet in reverse order. The per source limit and the expiry of the
+ * engine are checked as well.
+ *
+ * Bursts of two segments IPv4 and IPv6 packets are fragmented with
+ * rte_ipv4/6_fragment_packet(), then with rte_ipv4/6_fragment_burst(),
+ * with and without RTE_IP_FRAG_BURST_F_COPY. The fragments of the burst
+ * functions are checked by reassembling them.
+ */
+
+#define NB_FLOWS		1024
+#define NB_FRAGS		4
+#define FRAG_LEN		1024
+#define NB_MBUFS		(2 * NB_FLOWS * NB_FRAGS)
+#define BURST_SIZE		32
+#define TBL_BUCKET_ENTRIES	16
+#define ITERATIONS		64
+#define SRC_LIMIT		8
+#define SRC_FLOWS		64
+#define IPV6_L3_LEN		(sizeof(struct rte_ipv6_hdr) + \
+				sizeof(struct ipv6_extension_fragment))
+#define FRAG_MTU		1500
+#define FRAG_SEG_LEN		1800
+#define FRAG_PYLD_LEN		(2 * FRAG_SEG_LEN)
+#define FRAG_OUT_SIZE		(BURST_SIZE * NB_FRAGS)
+
+static struct rte_mempool *pkt_pool;
+static struct rte_mempool *indirect_pool;
+static struct rte_mbuf *frags[NB_FLOWS * NB_FRAGS];
+
+/* build fragment frag_idx of the packet of a flow, from source src */
+static struct rte_mbuf *
+build_frag(uint8_t is_ipv6, uint32_t src, uint32_t flow, uint32_t frag_idx)
+{
+	struct rte_ipv6_hdr *ip6;
+	struct rte_ipv4_hdr *ip;
+	struct ipv6_extension_fragment *frag_hdr;
+	struct rte_ether_hdr *eth;
+	struct rte_mbuf *m;
+	uint16_t ofs = frag_idx * FRAG_LEN;
+	uint16_t mf = (frag_idx != NB_FRAGS - 1);
+	uint16_t l3_len = is_ipv6 ? IPV6_L3_LEN : sizeof(*ip);
+
+	m = rte_pktmbuf_alloc(pkt_pool);
+	if (m == NULL)
+		return NULL;
+	eth = (struct rte_ether_hdr *)rte_pktmbuf_append(m, sizeof(*eth) +
+			l3_len + FRAG_LEN);
+	memset(eth, 0, sizeof(*eth) + l3_len);
+	m->l2_len = sizeof(*eth);
+	m->l3_len = l3_len;
+
+	if (is_ipv6) {
+		eth->ether_type = rte_cpu_to_be_16(RTE_ETHER_TYPE_IPV6);
+		ip6 = (struct rte_ipv6_hdr *)(eth + 1);
+		ip6->vtc_flow = rte_cpu_to_be_32(6 << 28);
+		ip6->payload_len = rte_cpu_to_be_16(sizeof(*frag_hdr) +
+				FRAG_LEN);
+		ip6->proto = IPPROTO_FRAGMENT;
+		ip6->hop_limits = 64;
+		ip6->src_addr[0] = 0xfd;
+		ip6->src_addr[14] = src >> 8;
+		ip6->src_addr[15] = src;
+		ip6->dst_addr[0] = 0xfd;
+		ip6->dst_addr[15] = 1;
+		frag_hdr = (struct ipv6_extension_fragment *)(ip6 + 1);
+		frag_hdr->next_header = IPPROTO_UDP;
+		frag_hdr->frag_data = rte_cpu_to_be_16(
+				RTE_IPV6_SET_FRAG_DATA(ofs, mf));
+		frag_hdr->id = rte_cpu_to_be_32(flow);
+	} else {
+		eth->ether_type = rte_cpu_to_be_16(RTE_ETHER_TYPE_IPV4);
+		ip = (struct rte_ipv4_hdr *)(eth + 1);
+		ip->version_ihl = RTE_IPV4_VHL_DEF;
+		ip->total_length = rte_cpu_to_be_16(sizeof(*ip) + FRAG_LEN);
+		ip->packet_id = rte_cpu_to_be_16(flow);
+		ip->fragment_offset = rte_cpu_to_be_16(
+				(ofs / RTE_IPV4_HDR_OFFSET_UNITS) |
+				(mf ? RTE_IPV4_HDR_MF_FLAG : 0));
+		ip->time_to_live = 64;
+		ip->next_proto_id = IPPROTO_UDP;
+		ip->src_addr = rte_cpu_to_be_32(RTE_IPV4(10, 0, 0, 0) + src);
+		ip->dst_addr = rte_cpu_to_be_32(RTE_IPV4(10, 1, 0, 1));
+		ip->hdr_checksum = rte_ipv4_cksum(ip);
+	}
+
+	return m;
+}
+
+static void
+free_mbufs(struct rte_mbuf **mbufs, uint32_t nb)
+{
+	uint32_t i;
+
+	for (i = 0; i < nb; i++) {
+		rte_pktmbuf_free(mbufs[i]);
+		mbufs[i] = NULL;
+	}
+}
+
+/*
+ * Fill frags with the fragments of NB_FLOWS packets, interleaved, the
+ * fragments of the odd flows in reverse order. The flow i comes from
+ * source i.
+ */
+static int
+build_frags(uint8_t is_ipv6)
+{
+	uint32_t i, k, n = 0;
+
+	for (k = 0; k < NB_FRAGS; k++) {
+		for (i = 0; i < NB_FLOWS; i++) {
+			frags[n] = build_frag(is_ipv6, i, i,
+					(i & 1) ? NB_FRAGS - 1 - k : k);
+			if (frags[n] == NULL) {
+				printf("Failed to build fragments\n");
+				free_mbufs(frags, n);
+				return -1;
+			}
+			n++;
+		}
+	}
+
+	return 0;
+}
+
+/* check and free the reassembled packets */
+static int
+check_pkts(struct rte_mbuf **pkts, uint16_t nb_pkts, uint8_t is_ipv6)
+{
+	uint32_t len = sizeof(struct rte_ether_hdr) + NB_FRAGS * FRAG_LEN +
+		(is_ipv6 ? sizeof(struct rte_ipv6_hdr) :
+		 sizeof(struct rte_ipv4_hdr));
+	uint16_t i;
+	int ret = 0;
+
+	for (i = 0; i < nb_pkts; i++) {
+		if (pkts[i]->pkt_len != len) {
+			printf("Reassembled packet of %u bytes instead of %u\n",
+				pkts[i]->pkt_len, len);
+			ret = -1;
+		}
+		rte_pktmbuf_free(pkts[i]);
+	}
+
+	return ret;
+}
+
+static uint64_t
+reassemble_table(struct rte_ip_frag_tbl *tbl,
+		struct rte_ip_frag_death_row *dr, uint8_t is_ipv6,
+		uint32_t *nb_pkts)
+{
+	struct rte_mbuf *out[BURST_SIZE];
+	struct rte_ipv6_hdr *ip6;
+	struct rte_mbuf *m;
+	uint64_t begin, tms, cycles = 0;
+	uint32_t i, j, nb_out;
+
+	for (i = 0; i < RTE_DIM(frags); i += BURST_SIZE) {
+		begin = rte_rdtsc_precise();
+		tms = rte_rdtsc();
+		nb_out = 0;
+		for (j = i; j < i + BURST_SIZE; j++) {
+			if (is_ipv6) {
+				ip6 = rte_pktmbuf_mtod_offset(frags[j],
+					struct rte_ipv6_hdr *,
+					frags[j]->l2_len);
+				m = rte_ipv6_frag_reassemble_packet(tbl, dr,
+					frags[j], tms, ip6,
+					rte_ipv6_frag_get_ipv6_fragment_header(
+						ip6));
+			} else {
+				m = rte_ipv4_frag_reassemble_packet(tbl, dr,
+					frags[j], tms,
+					rte_pktmbuf_mtod_offset(frags[j],
+						struct rte_ipv4_hdr *,
+						frags[j]->l2_len));
+			}
+			if (m != NULL)
+				out[nb_out++] = m;
+		}
+		rte_ip_frag_free_death_row(dr, 3);
+		cycles += rte_rdtsc_precise() - begin;
+
+		if (check_pkts(out, nb_out, is_ipv6) != 0)
+			*nb_pkts = UINT32_MAX;
+		else if (*nb_pkts != UINT32_MAX)
+			*nb_pkts += nb_out;
+	}
+
+	return cycles;
+}
+
+static uint64_t
+reassemble_shard(struct rte_ip_frag_shard *shard,
+		struct rte_ip_frag_death_row *dr, uint8_t is_ipv6,
+		uint32_t *nb_pkts)
+{
+	struct rte_mbuf *out[BURST_SIZE];
+	uint64_t begin, cycles = 0;
+	uint32_t i;
+	uint16_t nb_out;
+
+	for (i = 0; i < RTE_DIM(frags); i += BURST_SIZE) {
+		begin = rte_rdtsc_precise();
+		if (is_ipv6)
+			nb_out = rte_ipv6_frag_reassemble_burst(shard, dr,
+				&frags[i], BURST_SIZE, rte_rdtsc(), out);
+		else
+			nb_out = rte_ipv4_frag_reassemble_burst(shard, dr,
+				&frags[i], BURST_SIZE, rte_rdtsc(), out);
+		rte_ip_frag_free_death_row(dr, 3);
+		cycles += rte_rdtsc_precise() - begin;
+
+		if (check_pkts(out, nb_out, is_ipv6) != 0)
+			*nb_pkts = UINT32_MAX;
+		else if (*nb_pkts != UINT32_MAX)
+			*nb_pkts += nb_out;
+	}
+
+	return cycles;
+}
+
+static int
+test_ip_frag_perf_type(uint8_t is_ipv6)
+{
+	const struct rte_ip_frag_engine_params params = {
+		.nb_shards = 1,
+		.max_entries = NB_FLOWS,
+		.max_cycles = rte_get_tsc_hz(),
+		.socket_id = rte_socket_id(),
+	};
+	struct rte_ip_frag_death_row dr = { .cnt = 0 };
+	struct rte_ip_frag_engine *engine;
+	struct rte_ip_frag_tbl *tbl;
+	uint64_t tbl_cycles = 0, shard_cycles = 0;
+	uint32_t i, tbl_pkts = 0, shard_pkts = 0;
+	int ret = -1;
+
+	tbl = rte_ip_frag_table_create(NB_FLOWS, TBL_BUCKET_ENTRIES,
+		NB_FLOWS, rte_get_tsc_hz(), rte_socket_id());
+	engine = rte_ip_frag_engine_create(&params);
+	if (tbl == NULL || engine == NULL) {
+		printf("Failed to create the reassembly tables\n");
+		goto exit;
+	}
+
+	for (i = 0; i < ITERATIONS; i++) {
+		if (build_frags(is_ipv6) != 0)
+			goto exit;
+		tbl_cycles += reassemble_table(tbl, &dr, is_ipv6, &tbl_pkts);
+
+		if (build_frags(is_ipv6) != 0)
+			goto exit;
+		shard_cycles += reassemble_shard(
+			rte_ip_frag_engine_get_shard(engine, 0), &dr,
+			is_ipv6, &shard_pkts);
+	}
+
+	if (tbl_pkts != ITERATIONS * NB_FLOWS ||
+			shard_pkts != ITERATIONS * NB_FLOWS) {
+		printf("%u and %u packets reassembled out of %u\n",
+			tbl_pkts, shard_pkts, ITERATIONS * NB_FLOWS);
+		goto exit;
+	}
+
+	printf("%s: table %"PRIu64", engine %"PRIu64" cycles per fragment\n",
+		is_ipv6 ? "IPv6" : "IPv4",
+		tbl_cycles / (ITERATIONS * RTE_DIM(frags)),
+		shard_cycles / (ITERATIONS * RTE_DIM(frags)));
+	ret = 0;
+exit:
+	rte_ip_frag_table_destroy(tbl);
+	rte_ip_frag_engine_destroy(engine);
+	return ret;
+}
+
+/*
+ * Start SRC_FLOWS packets from a single source, then one from another
+ * source, in a shard limited to src_limit packets per source. Only
+ * src_limit + 1 packets may be reassembled, the fragments of the others
+ * are freed when they expire. All of them are reassembled without limit.
+ */
+static int
+test_ip_frag_src_limit(uint8_t is_ipv6, uint32_t src_limit)
+{
+	const struct rte_ip_frag_engine_params params = {
+		.nb_shards = 1,
+		.max_entries = NB_FLOWS,
+		.max_entries_per_src = src_limit,
+		.max_cycles = rte_get_tsc_hz(),
+		.socket_id = rte_socket_id(),
+	};
+	struct rte_mbuf *mbufs[SRC_FLOWS + 1];
+	struct rte_ip_frag_death_row dr = { .cnt = 0 };
+	struct rte_ip_frag_engine *engine;
+	struct rte_ip_frag_shard *shard;
+	uint64_t tms = rte_rdtsc();
+	uint32_t i, k, nb_pkts = 0;
+	uint32_t expected = (src_limit != 0) ? src_limit + 1 : SRC_FLOWS + 1;
+	uint16_t nb_out;
+	int ret = -1;
+
+	engine = rte_ip_frag_engine_create(&params);
+	if (engine == NULL) {
+		printf("Failed to create the reassembly engine\n");
+		return -1;
+	}
+	shard = rte_ip_frag_engine_get_shard(engine, 0);
+
+	for (k = 0; k < NB_FRAGS; k++) {
+		for (i = 0; i < RTE_DIM(mbufs); i++) {
+			mbufs[i] = build_frag(is_ipv6,
+				i == SRC_FLOWS ? 2 : 1, i, k);
+			if (mbufs[i] == NULL) {
+				printf("Failed to build fragments\n");
+				free_mbufs(mbufs, i);
+				goto exit;
+			}
+		}
+		if (is_ipv6)
+			nb_out = rte_ipv6_frag_reassemble_burst(shard, &dr,
+				mbufs, RTE_DIM(mbufs), tms, mbufs);
+		else
+			nb_out = rte_ipv4_frag_reassemble_burst(shard, &dr,
+				mbufs, RTE_DIM(mbufs), tms, mbufs);
+		rte_ip_frag_free_death_row(&dr, 3);
+		if (check_pkts(mbufs, nb_out, is_ipv6) != 0)
+			goto exit;
+		nb_pkts += nb_out;
+	}
+
+	if (nb_pkts != expected) {
+		printf("%u packets reassembled instead of %u\n", nb_pkts,
+			expected);
+		goto exit;
+	}
+
+	/* expire the remaining fragments */
+	rte_ip_frag_shard_expire(shard, &dr, tms + 2 * rte_get_tsc_hz());
+	rte_ip_frag_free_death_row(&dr, 3);
+	if (rte_mempool_in_use_count(pkt_pool) != 0) {
+		printf("%u mbufs not freed on expiry\n",
+			rte_mempool_in_use_count(pkt_pool));
+		rte_ip_frag_engine_statistics_dump(stdout, engine);
+		goto exit;
+	}
+
+	ret = 0;
+exit:
+	rte_ip_frag_engine_destroy(engine);
+	return ret;
+}
+
+/*
+ * Build a burst of IPv4 or IPv6 packets of FRAG_PYLD_LEN payload bytes,
+ * split in two segments. The payload of packet i is i, i + 1, ...
+ */
+static int
+build_pkts(struct rte_mbuf **pkts, uint8_t is_ipv6)
+{
+	struct rte_ipv6_hdr *ip6;
+	struct rte_ipv4_hdr *ip;
+	struct rte_ether_hdr *eth;
+	struct rte_mbuf *m, *seg;
+	uint16_t l3_len = is_ipv6 ? sizeof(*ip6) : sizeof(*ip);
+	uint8_t *p;
+	uint32_t i, j;
+
+	for (i = 0; i < BURST_SIZE; i++) {
+		m = rte_pktmbuf_alloc(pkt_pool);
+		seg = rte_pktmbuf_alloc(pkt_pool);
+		if (m == NULL || seg == NULL) {
+			rte_pktmbuf_free(m);
+			rte_pktmbuf_free(seg);
+			free_mbufs(pkts, i);
+			return -1;
+		}
+		eth = (struct rte_ether_hdr *)rte_pktmbuf_append(m,
+				sizeof(*eth) + l3_len + FRAG_SEG_LEN);
+		p = (uint8_t *)rte_pktmbuf_append(seg, FRAG_SEG_LEN);
+		rte_pktmbuf_chain(m, seg);
+
+		memset(eth, 0, sizeof(*eth) + l3_len);
+		m->l2_len = sizeof(*eth);
+		m->l3_len = l3_len;
+		if (is_ipv6) {
+			eth->ether_type = rte_cpu_to_be_16(RTE_ETHER_TYPE_IPV6);
+			ip6 = (struct rte_ipv6_hdr *)(eth + 1);
+			ip6->vtc_flow = rte_cpu_to_be_32(6 << 28);
+			ip6->payload_len = rte_cpu_to_be_16(FRAG_PYLD_LEN);
+			ip6->proto = IPPROTO_UDP;
+			ip6->hop_limits = 64;
+			ip6->src_addr[0] = 0xfd;
+			ip6->dst_addr[0] = 0xfd;
+			ip6->dst_addr[15] = 1;
+			m->ol_flags = PKT_TX_IPV6;
+		} else {
+			eth->ether_type = rte_cpu_to_be_16(RTE_ETHER_TYPE_IPV4);
+			ip = (struct rte_ipv4_hdr *)(eth + 1);
+			ip->version_ihl = RTE_IPV4_VHL_DEF;
+			ip->total_length = rte_cpu_to_be_16(sizeof(*ip) +
+					FRAG_PYLD_LEN);
+			ip->packet_id = rte_cpu_to_be_16(i);
+			ip->time_to_live = 64;
+			ip->next_proto_id = IPPROTO_UDP;
+			ip->src_addr = rte_cpu_to_be_32(RTE_IPV4(10, 0, 0, 1));
+			ip->dst_addr = rte_cpu_to_be_32(RTE_IPV4(10, 1, 0, 1));
+			ip->hdr_checksum = rte_ipv4_cksum(ip);
+			m->ol_flags = PKT_TX_IPV4;
+		}
+
+		for (j = 0; j < FRAG_SEG_LEN; j++) {
+			((uint8_t *)(eth + 1))[l3_len + j] = i + j;
+			p[j] = i + FRAG_SEG_LEN + j;
+		}
+		pkts[i] = m;
+	}
+
+	return 0;
+}
+
+/* check the headers of IPv4 fragments, and the payload of packets */
+static int
+check_frag_pkts(struct rte_mbuf **pkts, uint16_t nb_pkts, uint8_t is_ipv6,
+		uint8_t is_frag)
+{
+	static uint8_t buf[FRAG_PYLD_LEN];
+	const struct rte_ipv4_hdr *ip;
+	const uint8_t *p;
+	uint32_t i, j, hdr_len;
+	uint8_t first;
+
+	hdr_len = sizeof(struct rte_ether_hdr) + (is_ipv6 ?
+			sizeof(struct rte_ipv6_hdr) :
+			sizeof(struct rte_ipv4_hdr));
+	for (i = 0; i < nb_pkts; i++) {
+		if (is_frag) {
+			if (pkts[i]->pkt_len > sizeof(struct rte_ether_hdr) +
+					FRAG_MTU) {
+				printf("Fragment of %u bytes\n",
+					pkts[i]->pkt_len);
+				return -1;
+			}
+			if (is_ipv6)
+				continue;
+			ip = rte_pktmbuf_mtod_offset(pkts[i],
+				const struct rte_ipv4_hdr *,
+				sizeof(struct rte_ether_hdr));
+			if (rte_ipv4_cksum(ip) != 0 &&
+					rte_ipv4_cksum(ip) != 0xffff) {
+				printf("Bad IPv4 fragment checksum\n");
+				return -1;
+			}
+			continue;
+		}
+
+		if (pkts[i]->pkt_len != hdr_len + FRAG_PYLD_LEN) {
+			printf("Reassembled packet of %u bytes instead of %u\n",
+				pkts[i]->pkt_len, hdr_len + FRAG_PYLD_LEN);
+			return -1;
+		}
+		p = rte_pktmbuf_read(pkts[i], hdr_len, FRAG_PYLD_LEN, buf);
+		first = p[0];
+		for (j = 0; j < FRAG_PYLD_LEN; j++) {
+			if (p[j] != (uint8_t)(first + j)) {
+				printf("Bad payload byte %u\n", j);
+				return -1;
+			}
+		}
+	}
+
+	return 0;
+}
+
+/* fragment with the burst function, check and reassemble the fragments */
+static int
+test_ip_frag_fragment_check(uint8_t is_ipv6, uint16_t flags)
+{
+	const struct rte_ip_frag_engine_params eparams = {
+		.nb_shards = 1,
+		.max_entries = NB_FLOWS,
+		.max_cycles = rte_get_tsc_hz(),
+		.socket_id = rte_socket_id(),
+	};
+	const struct rte_ip_frag_burst_params params = {
+		.mtu_size = FRAG_MTU,
+		.flags = flags,
+		.pool_direct = pkt_pool,
+		.pool_indirect = indirect_pool,
+	};
+	struct rte_mbuf *pkts[BURST_SIZE];
+	struct rte_mbuf *out[FRAG_OUT_SIZE];
+	struct rte_ip_frag_death_row dr = { .cnt = 0 };
+	struct rte_ip_frag_engine *engine;
+	uint16_t nb_in, nb_out = RTE_DIM(out);
+	int ret = -1;
+
+	engine = rte_ip_frag_engine_create(&eparams);
+	if (engine == NULL || build_pkts(pkts, is_ipv6) != 0) {
+		printf("Failed to create the engine or the packets\n");
+		rte_ip_frag_engine_destroy(engine);
+		return -1;
+	}
+
+	if (is_ipv6)
+		nb_in = rte_ipv6_fragment_burst(pkts, BURST_SIZE, out,
+				&nb_out, &params);
+	else
+		nb_in = rte_ipv4_fragment_burst(pkts, BURST_SIZE, out,
+				&nb_out, &params);
+	if (nb_in != BURST_SIZE || nb_out <= BURST_SIZE) {
+		printf("%u packets fragmented in %u fragments: %s\n", nb_in,
+			nb_out, rte_strerror(rte_errno));
+		free_mbufs(&pkts[nb_in], BURST_SIZE - nb_in);
+		free_mbufs(out, nb_out);
+		goto exit;
+	}
+	if (check_frag_pkts(out, nb_out, is_ipv6, 1) != 0) {
+		free_mbufs(out, nb_out);
+		goto exit;
+	}
+
+	if (is_ipv6)
+		nb_out = rte_ipv6_frag_reassemble_burst(
+			rte_ip_frag_engine_get_shard(engine, 0), &dr,
+			out, nb_out, rte_rdtsc(), out);
+	else
+		nb_out = rte_ipv4_frag_reassemble_burst(
+			rte_ip_frag_engine_get_shard(engine, 0), &dr,
+			out, nb_out, rte_rdtsc(), out);
+	rte_ip_frag_free_death_row(&dr, 3);
+	ret = check_frag_pkts(out, nb_out, is_ipv6, 0);
+	if (ret == 0 && nb_out != BURST_SIZE) {
+		printf("%u packets reassembled instead of %u\n", nb_out,
+			BURST_SIZE);
+		ret = -1;
+	}
+	free_mbufs(out, nb_out);
+exit:
+	rte_ip_frag_engine_destroy(engine);
+	return ret;
+}
+
+/* fragment with rte_ipv4/6_fragment_packet(), like the example */
+static uint16_t
+fragment_packets(struct rte_mbuf **pkts, struct rte_mbuf **out,
+		uint8_t is_ipv6)
+{
+	struct rte_ether_hdr *eth;
+	struct rte_mbuf *m;
+	uint16_t i, nb_out = 0;
+	int32_t j, n;
+
+	for (i = 0; i < BURST_SIZE; i++) {
+		m = pkts[i];
+		eth = rte_pktmbuf_mtod(m, struct rte_ether_hdr *);
+		rte_pktmbuf_adj(m, sizeof(*eth));
+		if (is_ipv6)
+			n = rte_ipv6_fragment_packet(m, &out[nb_out],
+				FRAG_OUT_SIZE - nb_out, FRAG_MTU, pkt_pool,
+				indirect_pool);
+		else
+			n = rte_ipv4_fragment_packet(m, &out[nb_out],
+				FRAG_OUT_SIZE - nb_out, FRAG_MTU, pkt_pool,
+				indirect_pool);
+		for (j = 0; j < n; j++)
+			rte_memcpy(rte_pktmbuf_prepend(out[nb_out + j],
+					sizeof(*eth)), eth, sizeof(*eth));
+		rte_pktmbuf_free(m);
+		if (n > 0)
+			nb_out += n;
+	}
+
+	return nb_out;
+}
+
+static int
+test_ip_frag_fragment_perf(uint8_t is_ipv6)
+{
+	static const uint16_t flags[] = {0, RTE_IP_FRAG_BURST_F_COPY};
+	struct rte_ip_frag_burst_params params = {
+		.mtu_size = FRAG_MTU,
+		.pool_direct = pkt_pool,
+		.pool_indirect = indirect_pool,
+	};
+	struct rte_mbuf *pkts[BURST_SIZE];
+	struct rte_mbuf *out[FRAG_OUT_SIZE];
+	uint64_t begin, cycles[RTE_DIM(flags) + 1] = {0};
+	uint32_t i, k;
+	uint16_t nb_out;
+
+	for (i = 0; i < ITERATIONS; i++) {
+		for (k = 0; k <= RTE_DIM(flags); k++) {
+			if (build_pkts(pkts, is_ipv6) != 0) {
+				printf("Failed to build packets\n");
+				return -1;
+			}
+
+			begin = rte_rdtsc_precise();
+			if (k == RTE_DIM(flags)) {
+				nb_out = fragment_packets(pkts, out, is_ipv6);
+			} else {
+				params.flags = flags[k];
+				nb_out = RTE_DIM(out);
+				if (is_ipv6)
+					rte_ipv6_fragment_burst(pkts,
+						BURST_SIZE, out, &nb_out,
+						&params);
+				else
+					rte_ipv4_fragment_burst(pkts,
+						BURST_SIZE, out, &nb_out,
+						&params);
+			}
+			cycles[k] += rte_rdtsc_precise() - begin;
+
+			free_mbufs(out, nb_out);
+		}
+	}
+
+	printf("%s: fragment_packet %"PRIu64", fragment_burst %"PRIu64
+		", fragment_burst copy %"PRIu64" cycles per packet\n",
+		is_ipv6 ? "IPv6" : "IPv4",
+		cycles[RTE_DIM(flags)] / (ITERATIONS * BURST_SIZE),
+		cycles[0] / (ITERATIONS * BURST_SIZE),
+		cycles[1] / (ITERATIONS * BURST_SIZE));
+	return 0;
+}
+
+static int
+test_ip_frag_perf(void)
+{
+	uint8_t is_ipv6;
+	int ret = -1;
+
+	pkt_pool = rte_pktmbuf_pool_create("ip_frag_perf_pool", NB_MBUFS, 0,
+		0, RTE_MBUF_DEFAULT_BUF_SIZE, rte_socket_id());
+	if (pkt_pool == NULL) {
+		printf("Failed to create mbuf pool\n");
+		return -1;
+	}
+	indirect_pool = rte_pktmbuf_pool_create("ip_frag_perf_ind_pool",
+		NB_MBUFS, 0, 0, 0, rte_socket_id());
+	if (indirect_pool == NULL) {
+		printf("Failed to create indirect mbuf pool\n");
+		goto exit;
+	}
+
+	for (is_ipv6 = 0; is_ipv6 <= 1; is_ipv6++)
+		if (test_ip_frag_src_limit(is_ipv6, SRC_LIMIT) != 0 ||
+				test_ip_frag_src_limit(is_ipv6, 0) != 0)
+			goto exit;
+
+	for (is_ipv6 = 0; is_ipv6 <= 1; is_ipv6++)
+		if (test_ip_frag_perf_type(is_ipv6) != 0)
+			goto exit;
+
+	for (is_ipv6 = 0; is_ipv6 <= 1; is_ipv6++)
+		if (test_ip_frag_fragment_check(is_ipv6, 0) != 0 ||
+				test_ip_frag_fragment_check(is_ipv6,
+					RTE_IP_FRAG_BURST_F_COPY) != 0)
+			goto exit;
+
+	for (is_ipv6 = 0; is_ipv6 <= 1; is_ipv6++)
+		if (test_ip_frag_fragment_perf(is_ipv6) != 0)
+			goto exit;
+
+	if (rte_mempool_in_use_count(pkt_pool) != 0 ||
+			rte_mempool_in_use_count(indirect_pool) != 0) {
+		printf("%u and %u mbufs leaked\n",
+			rte_mempool_in_use_count(pkt_pool),
+			rte_mempool_in_use_count(indirect_pool));
+		goto exit;
+	}
+
+	ret = 0;
+exit:
+	rte_mempool_free(pkt_pool);
+	rte_mempool_free(indirect_pool);
+	pkt_pool = NULL;
+	indirect_pool = NULL;
+
+	return ret;
+}
+
+REGISTER_TEST_COMMAND(ip_frag_perf_autotest, test_ip_frag_perf);
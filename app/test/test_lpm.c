@@ -5,9 +5,13 @@
 #include <stdio.h>
 #include <stdint.h>
 #include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
 
+#include <rte_errno.h>
 #include <rte_ip.h>
 #include <rte_lpm.h>
+#include <rte_random.h>
 
 #include "test.h"
 #include "test_xmmt_ops.h"
@@ -40,6 +44,7 @@ static int32_t test15(void);
 static int32_t test16(void);
 static int32_t test17(void);
 static int32_t test18(void);
+static int32_t test19(void);
 
 rte_lpm_test tests[] = {
 /* Test Cases */
@@ -61,7 +66,8 @@ rte_lpm_test tests[] = {
 	test15,
 	test16,
 	test17,
-	test18
+	test18,
+	test19
 };
 
 #define NUM_LPM_TESTS (sizeof(tests)/sizeof(tests[0]))
@@ -1266,6 +1272,170 @@ test18(void)
 	return PASS;
 }
 
+/*
+ * Save a table with random rules, restore it and check that:
+ *  - lookups of random and rule addresses give the same results
+ *  - the rules are present in the restored table
+ *  - both tables still agree after deleting and adding the same rules
+ *  - corrupted rule groups and tbl8 indexes are rejected with EINVAL
+ */
+#define SAVE_RULES 128
+#define SAVE_LOOKUPS 4096
+
+static int32_t
+compare_lookups(struct rte_lpm *lpm, struct rte_lpm *restored,
+		const uint32_t *rule_ips)
+{
+	uint32_t i, ip, next_hop, restored_next_hop;
+	int ret, restored_ret;
+
+	for (i = 0; i < SAVE_LOOKUPS; i++) {
+		ip = rte_rand();
+		if (i & 1)
+			ip = rule_ips[i % SAVE_RULES] ^ (ip & 0xff);
+		next_hop = restored_next_hop = 0;
+		ret = rte_lpm_lookup(lpm, ip, &next_hop);
+		restored_ret = rte_lpm_lookup(restored, ip, &restored_next_hop);
+		TEST_LPM_ASSERT(ret == restored_ret);
+		TEST_LPM_ASSERT(next_hop == restored_next_hop);
+	}
+
+	return PASS;
+}
+
+/*
+ * Save the table, overwrite len bytes at offset of the file with data and
+ * check that the restore rejects it with EINVAL.
+ */
+static int32_t
+restore_corrupted(struct rte_lpm *lpm, const char *filename, long offset,
+		const void *data, size_t len)
+{
+	struct rte_lpm *restored;
+	FILE *f;
+
+	TEST_LPM_ASSERT(rte_lpm_save(lpm, filename) == 0);
+	f = fopen(filename, "r+");
+	TEST_LPM_ASSERT(f != NULL);
+	if ((fseek(f, offset, SEEK_SET) != 0) ||
+			(fwrite(data, len, 1, f) != 1)) {
+		fclose(f);
+		return -1;
+	}
+	TEST_LPM_ASSERT(fclose(f) == 0);
+
+	restored = rte_lpm_restore("test_lpm_restored", SOCKET_ID_ANY,
+			filename);
+	if (restored != NULL) {
+		rte_lpm_free(restored);
+		return -1;
+	}
+	TEST_LPM_ASSERT(rte_errno == EINVAL);
+
+	return PASS;
+}
+
+int32_t
+test19(void)
+{
+	struct rte_lpm *lpm = NULL, *restored = NULL;
+	struct rte_lpm_config config;
+	uint32_t rule_ips[SAVE_RULES], next_hop;
+	uint8_t depths[SAVE_RULES];
+	struct rte_lpm_rule_info info;
+	struct rte_lpm_tbl_entry entry;
+	char filename[] = "/tmp/test_lpm_XXXXXX";
+	long info_off, tbl24_off;
+	uint32_t i;
+	int fd;
+
+	fd = mkstemp(filename);
+	TEST_LPM_ASSERT(fd >= 0);
+	close(fd);
+
+	config.max_rules = MAX_RULES;
+	config.number_tbl8s = NUMBER_TBL8S;
+	config.flags = 0;
+
+	lpm = rte_lpm_create(__func__, SOCKET_ID_ANY, &config);
+	TEST_LPM_ASSERT(lpm != NULL);
+
+	for (i = 0; i < SAVE_RULES; i++) {
+		rule_ips[i] = rte_rand();
+		depths[i] = 1 + rte_rand() % MAX_DEPTH;
+		rte_lpm_add(lpm, rule_ips[i], depths[i], rte_rand() % 1000);
+	}
+
+	TEST_LPM_ASSERT(rte_lpm_save(lpm, filename) == 0);
+	restored = rte_lpm_restore("test_lpm_restored", SOCKET_ID_ANY,
+			filename);
+	TEST_LPM_ASSERT(restored != NULL);
+
+	TEST_LPM_ASSERT(compare_lookups(lpm, restored, rule_ips) == PASS);
+	for (i = 0; i < SAVE_RULES; i++)
+		TEST_LPM_ASSERT(rte_lpm_is_rule_present(restored, rule_ips[i],
+				depths[i], &next_hop) == 1);
+
+	for (i = 0; i < SAVE_RULES; i += 2) {
+		next_hop = rte_rand() % 1000;
+		rte_lpm_delete(lpm, rule_ips[i], depths[i]);
+		rte_lpm_delete(restored, rule_ips[i], depths[i]);
+		rte_lpm_add(lpm, rule_ips[i + 1], 30, next_hop);
+		rte_lpm_add(restored, rule_ips[i + 1], 30, next_hop);
+	}
+	TEST_LPM_ASSERT(compare_lookups(lpm, restored, rule_ips) == PASS);
+	rte_lpm_free(restored);
+
+	/*
+	 * The file starts with magic, version, max_rules, number_tbl8s,
+	 * nb_rules and nb_tbl8s, followed by the rule info, the saved rules
+	 * and tbl24.
+	 */
+	info_off = 6 * sizeof(uint32_t);
+	tbl24_off = info_off + sizeof(lpm->rule_info);
+	for (i = 0; i < RTE_LPM_MAX_DEPTH; i++)
+		if (lpm->rule_info[i].used_rules != 0)
+			tbl24_off = info_off + sizeof(lpm->rule_info) +
+				(lpm->rule_info[i].first_rule +
+				lpm->rule_info[i].used_rules) *
+				sizeof(lpm->rules_tbl[0]);
+
+	/* a rule group going past the saved rules */
+	info.first_rule = MAX_RULES - 1;
+	info.used_rules = 2;
+	TEST_LPM_ASSERT(restore_corrupted(lpm, filename, info_off +
+			(RTE_LPM_MAX_DEPTH - 1) * sizeof(info), &info,
+			sizeof(info)) == PASS);
+	/* an empty rule group starting past max_rules */
+	info.first_rule = MAX_RULES + 1;
+	info.used_rules = 0;
+	TEST_LPM_ASSERT(restore_corrupted(lpm, filename, info_off +
+			(RTE_LPM_MAX_DEPTH - 1) * sizeof(info), &info,
+			sizeof(info)) == PASS);
+
+	/* tbl24 entries pointing past the tbl8s or to an unused group */
+	memset(&entry, 0, sizeof(entry));
+	entry.valid = 1;
+	entry.valid_group = 1;
+	entry.next_hop = NUMBER_TBL8S;
+	TEST_LPM_ASSERT(restore_corrupted(lpm, filename, tbl24_off,
+			&entry, sizeof(entry)) == PASS);
+	entry.next_hop = NUMBER_TBL8S - 1;
+	TEST_LPM_ASSERT(restore_corrupted(lpm, filename, tbl24_off,
+			&entry, sizeof(entry)) == PASS);
+
+	rte_lpm_free(lpm);
+
+	/* invalid parameters and a missing file */
+	TEST_LPM_ASSERT(rte_lpm_save(NULL, filename) < 0);
+	TEST_LPM_ASSERT(rte_lpm_restore(NULL, SOCKET_ID_ANY, filename) == NULL);
+	unlink(filename);
+	TEST_LPM_ASSERT(rte_lpm_restore("test_lpm_restored", SOCKET_ID_ANY,
+			filename) == NULL);
+
+	return PASS;
+}
+
 /*
  * Do all unit tests.
  */
@@ -26,6 +26,9 @@
 #define BATCH_SIZE 100000
 #define NUMBER_TBL8S                                           (1 << 16)
 
+#define CHURN_ROUNDS 256
+#define CHURN_ROUTES 64
+
 static void
 print_route_distribution(const struct rules_tbl_entry *table, uint32_t n)
 {
@@ -50,6 +53,83 @@ print_route_distribution(const struct rules_tbl_entry *table, uint32_t n)
 	printf("\n");
 }
 
+/* Look up all the addresses of the large IPs table, -1 on a miss */
+static void
+lookup_large_ips(struct rte_lpm6 *lpm, int64_t *next_hops)
+{
+	uint32_t next_hop;
+	unsigned int i;
+
+	for (i = 0; i < NUM_IPS_ENTRIES; i++) {
+		if (rte_lpm6_lookup(lpm, large_ips_table[i].ip, &next_hop) == 0)
+			next_hops[i] = next_hop;
+		else
+			next_hops[i] = -1;
+	}
+}
+
+/*
+ * Route churn: delete random sets of routes one by one, then with
+ * rte_lpm6_delete_bulk_func, adding them back after each pass. The
+ * table must give the same lookup results once all routes are back.
+ */
+static int
+test_lpm6_perf_churn(struct rte_lpm6 *lpm, uint32_t next_hop)
+{
+	static int64_t ref_next_hops[NUM_IPS_ENTRIES];
+	static int64_t next_hops[NUM_IPS_ENTRIES];
+	uint8_t ips[CHURN_ROUTES][RTE_LPM6_IPV6_ADDR_SIZE];
+	uint8_t depths[CHURN_ROUTES];
+	uint64_t begin, del_time = 0, bulk_time = 0, add_time = 0;
+	unsigned int i, j, k;
+
+	lookup_large_ips(lpm, ref_next_hops);
+
+	for (i = 0; i < CHURN_ROUNDS; i++) {
+		for (j = 0; j < CHURN_ROUTES; j++) {
+			k = rte_rand() % NUM_ROUTE_ENTRIES;
+			memcpy(ips[j], large_route_table[k].ip,
+				RTE_LPM6_IPV6_ADDR_SIZE);
+			depths[j] = large_route_table[k].depth;
+		}
+
+		begin = rte_rdtsc();
+		for (j = 0; j < CHURN_ROUTES; j++)
+			rte_lpm6_delete(lpm, ips[j], depths[j]);
+		del_time += rte_rdtsc() - begin;
+
+		begin = rte_rdtsc();
+		for (j = 0; j < CHURN_ROUTES; j++)
+			TEST_LPM_ASSERT(rte_lpm6_add(lpm, ips[j], depths[j],
+				next_hop) == 0);
+		add_time += rte_rdtsc() - begin;
+
+		begin = rte_rdtsc();
+		TEST_LPM_ASSERT(rte_lpm6_delete_bulk_func(lpm, ips, depths,
+			CHURN_ROUTES) == 0);
+		bulk_time += rte_rdtsc() - begin;
+
+		for (j = 0; j < CHURN_ROUTES; j++)
+			TEST_LPM_ASSERT(rte_lpm6_add(lpm, ips[j], depths[j],
+				next_hop) == 0);
+	}
+
+	lookup_large_ips(lpm, next_hops);
+	for (i = 0; i < NUM_IPS_ENTRIES; i++)
+		TEST_LPM_ASSERT(next_hops[i] == ref_next_hops[i]);
+
+	printf("Route churn, %u rounds of %u routes:\n", CHURN_ROUNDS,
+		CHURN_ROUTES);
+	printf("Average LPM Churn Delete: %g cycles\n",
+		(double)del_time / (CHURN_ROUNDS * CHURN_ROUTES));
+	printf("Average LPM Churn Bulk Delete: %g cycles\n",
+		(double)bulk_time / (CHURN_ROUNDS * CHURN_ROUTES));
+	printf("Average LPM Churn Add: %g cycles\n",
+		(double)add_time / (CHURN_ROUNDS * CHURN_ROUTES));
+
+	return 0;
+}
+
 static int
 test_lpm6_perf(void)
 {
@@ -139,8 +219,13 @@ test_lpm6_perf(void)
 			(double)total_time / ((double)ITERATIONS * BATCH_SIZE),
 			(count * 100.0) / (double)(ITERATIONS * BATCH_SIZE));
 
+	/* Delete and add back random sets of routes */
+	status = test_lpm6_perf_churn(lpm, next_hop_add);
+	TEST_LPM_ASSERT(status == 0);
+
 	/* Delete */
 	status = 0;
+	total_time = 0;
 	begin = rte_rdtsc();
 
 	for (i = 0; i < NUM_ROUTE_ENTRIES; i++) {
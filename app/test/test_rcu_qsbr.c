@@ -3,6 +3,7 @@
  */
 
 #include <stdio.h>
+#include <string.h>
 #include <rte_pause.h>
 #include <rte_rcu_qsbr.h>
 #include <rte_hash.h>
@@ -32,6 +33,7 @@ static unsigned int num_cores;
 static uint32_t *keys;
 #define TOTAL_ENTRY (1024 * 8)
 #define COUNTER_VALUE 4096
+#define TEST_RCU_DQ_SIZE 64
 static uint32_t *hash_data[RTE_MAX_LCORE][TOTAL_ENTRY];
 static uint8_t writer_done;
 
@@ -617,6 +619,152 @@ test_rcu_qsbr_dump(void)
 	return 0;
 }
 
+static uint32_t dq_freed[TEST_RCU_DQ_SIZE + 1];
+static uint32_t dq_num_freed;
+
+static void
+test_rcu_qsbr_free_resource(void *p, void *e, unsigned int n)
+{
+	RTE_SET_USED(p);
+	RTE_SET_USED(n);
+
+	dq_freed[dq_num_freed++] = *(uint32_t *)e;
+}
+
+/*
+ * rte_rcu_qsbr_dq_create: create a queue used to store the data structure
+ * elements that can be freed later.
+ */
+static int
+test_rcu_qsbr_dq_create(void)
+{
+	struct rte_rcu_qsbr_dq_parameters params;
+	struct rte_rcu_qsbr_dq *dq;
+
+	printf("\nTest rte_rcu_qsbr_dq_create()\n");
+
+	/* Negative tests */
+	dq = rte_rcu_qsbr_dq_create(NULL);
+	TEST_RCU_QSBR_RETURN_IF_ERROR((dq != NULL), "dq create NULL params");
+
+	memset(&params, 0, sizeof(struct rte_rcu_qsbr_dq_parameters));
+	params.name = "TEST_RCU";
+	dq = rte_rcu_qsbr_dq_create(&params);
+	TEST_RCU_QSBR_RETURN_IF_ERROR((dq != NULL), "dq create invalid params");
+
+	params.free_fn = test_rcu_qsbr_free_resource;
+	params.v = t[0];
+	params.size = TEST_RCU_DQ_SIZE;
+	params.esize = 3;
+	dq = rte_rcu_qsbr_dq_create(&params);
+	TEST_RCU_QSBR_RETURN_IF_ERROR((dq != NULL), "dq create invalid esize");
+
+	params.esize = 4;
+	dq = rte_rcu_qsbr_dq_create(&params);
+	TEST_RCU_QSBR_RETURN_IF_ERROR((dq != NULL),
+		"dq create auto reclaim without max reclaim size");
+
+	/* Auto reclamation disabled */
+	params.trigger_reclaim_limit = TEST_RCU_DQ_SIZE + 1;
+	dq = rte_rcu_qsbr_dq_create(&params);
+	TEST_RCU_QSBR_RETURN_IF_ERROR((dq == NULL), "dq create valid params");
+
+	TEST_RCU_QSBR_RETURN_IF_ERROR((rte_rcu_qsbr_dq_delete(dq) != 0),
+		"dq delete valid params");
+
+	return 0;
+}
+
+/*
+ * rte_rcu_qsbr_dq_enqueue/reclaim/delete: resources are freed in order,
+ * only after the readers went through a grace period.
+ */
+static int
+test_rcu_qsbr_dq_reclaim(void)
+{
+	struct rte_rcu_qsbr_dq_parameters params;
+	struct rte_rcu_qsbr_dq *dq;
+	unsigned int freed, pending, available;
+	uint32_t i;
+	int ret;
+
+	printf("\nTest rte_rcu_qsbr_dq_enqueue/reclaim/delete()\n");
+
+	rte_rcu_qsbr_init(t[0], RTE_MAX_LCORE);
+	rte_rcu_qsbr_thread_register(t[0], enabled_core_ids[0]);
+	rte_rcu_qsbr_thread_online(t[0], enabled_core_ids[0]);
+
+	memset(&params, 0, sizeof(struct rte_rcu_qsbr_dq_parameters));
+	params.name = "TEST_RCU";
+	params.free_fn = test_rcu_qsbr_free_resource;
+	params.v = t[0];
+	params.size = TEST_RCU_DQ_SIZE;
+	params.esize = sizeof(uint32_t);
+	params.trigger_reclaim_limit = TEST_RCU_DQ_SIZE + 1;
+	dq = rte_rcu_qsbr_dq_create(&params);
+	TEST_RCU_QSBR_RETURN_IF_ERROR((dq == NULL), "dq create");
+
+	/* Negative tests */
+	ret = rte_rcu_qsbr_dq_enqueue(NULL, &i);
+	TEST_RCU_QSBR_RETURN_IF_ERROR((ret == 0), "dq enqueue NULL dq");
+	ret = rte_rcu_qsbr_dq_enqueue(dq, NULL);
+	TEST_RCU_QSBR_RETURN_IF_ERROR((ret == 0), "dq enqueue NULL element");
+	ret = rte_rcu_qsbr_dq_reclaim(NULL, 1, NULL, NULL, NULL);
+	TEST_RCU_QSBR_RETURN_IF_ERROR((ret == 0), "dq reclaim NULL dq");
+
+	dq_num_freed = 0;
+	for (i = 0; i < TEST_RCU_DQ_SIZE; i++) {
+		ret = rte_rcu_qsbr_dq_enqueue(dq, &i);
+		TEST_RCU_QSBR_RETURN_IF_ERROR((ret != 0), "dq enqueue");
+	}
+	/* The queue is full and the reader did not report its QS */
+	ret = rte_rcu_qsbr_dq_enqueue(dq, &i);
+	TEST_RCU_QSBR_RETURN_IF_ERROR((ret == 0), "dq enqueue when full");
+
+	ret = rte_rcu_qsbr_dq_reclaim(dq, TEST_RCU_DQ_SIZE, &freed, &pending,
+					&available);
+	TEST_RCU_QSBR_RETURN_IF_ERROR((ret != 0 || freed != 0 ||
+		pending != TEST_RCU_DQ_SIZE || dq_num_freed != 0),
+		"dq reclaim before grace period");
+
+	ret = rte_rcu_qsbr_dq_delete(dq);
+	TEST_RCU_QSBR_RETURN_IF_ERROR((ret == 0), "dq delete with pending");
+
+	rte_rcu_qsbr_quiescent(t[0], enabled_core_ids[0]);
+
+	/* Partial reclaim */
+	ret = rte_rcu_qsbr_dq_reclaim(dq, TEST_RCU_DQ_SIZE / 2, &freed,
+					&pending, &available);
+	TEST_RCU_QSBR_RETURN_IF_ERROR((ret != 0 ||
+		freed != TEST_RCU_DQ_SIZE / 2 ||
+		pending != TEST_RCU_DQ_SIZE - TEST_RCU_DQ_SIZE / 2),
+		"dq reclaim after grace period");
+
+	/* Enqueued after the QS report, must wait for the next one */
+	ret = rte_rcu_qsbr_dq_enqueue(dq, &i);
+	TEST_RCU_QSBR_RETURN_IF_ERROR((ret != 0), "dq enqueue");
+	ret = rte_rcu_qsbr_dq_reclaim(dq, TEST_RCU_DQ_SIZE + 1, &freed,
+					&pending, &available);
+	TEST_RCU_QSBR_RETURN_IF_ERROR((ret != 0 ||
+		freed != TEST_RCU_DQ_SIZE - TEST_RCU_DQ_SIZE / 2 ||
+		pending != 1), "dq reclaim stops at new element");
+
+	for (i = 0; i < TEST_RCU_DQ_SIZE; i++)
+		TEST_RCU_QSBR_RETURN_IF_ERROR((dq_freed[i] != i),
+			"dq reclaim order, element %u freed as %u", i,
+			dq_freed[i]);
+
+	rte_rcu_qsbr_thread_offline(t[0], enabled_core_ids[0]);
+	ret = rte_rcu_qsbr_dq_delete(dq);
+	TEST_RCU_QSBR_RETURN_IF_ERROR((ret != 0), "dq delete");
+	TEST_RCU_QSBR_RETURN_IF_ERROR((dq_num_freed != TEST_RCU_DQ_SIZE + 1),
+		"dq delete frees pending resources");
+
+	rte_rcu_qsbr_thread_unregister(t[0], enabled_core_ids[0]);
+
+	return 0;
+}
+
 static int
 test_rcu_qsbr_reader(void *arg)
 {
@@ -1028,6 +1176,12 @@ test_rcu_qsbr_main(void)
 	if (test_rcu_qsbr_thread_offline() < 0)
 		goto test_fail;
 
+	if (test_rcu_qsbr_dq_create() < 0)
+		goto test_fail;
+
+	if (test_rcu_qsbr_dq_reclaim() < 0)
+		goto test_fail;
+
 	printf("\nFunctional tests\n");
 
 	if (test_rcu_qsbr_sw_sv_3qs() < 0)
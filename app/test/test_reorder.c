@@ -12,6 +12,7 @@
 #include <rte_reorder.h>
 #include <rte_lcore.h>
 #include <rte_malloc.h>
+#include <rte_random.h>
 
 #include "test.h"
 
@@ -268,8 +269,10 @@ test_reorder_drain(void)
 		ret = -1;
 		goto exit;
 	}
-	if (robufs[0] != NULL)
+	if (robufs[0] != NULL) {
 		rte_pktmbuf_free(robufs[0]);
+		robufs[0] = NULL;
+	}
 
 	/* Insert more packets
 	 * RB[] = {NULL, NULL, NULL, NULL}
@@ -303,8 +306,10 @@ test_reorder_drain(void)
 		goto exit;
 	}
 	for (i = 0; i < 3; i++) {
-		if (robufs[i] != NULL)
+		if (robufs[i] != NULL) {
 			rte_pktmbuf_free(robufs[i]);
+			robufs[i] = NULL;
+		}
 	}
 
 	/*
@@ -330,6 +335,471 @@ test_reorder_drain(void)
 	return ret;
 }
 
+static int
+test_reorder_mt(void)
+{
+	struct rte_reorder_params params = {
+		.name = "test_mt",
+		.socket_id = rte_socket_id(),
+		.size = 8,
+		.gap_timeout = rte_get_timer_hz() / 1000,
+	};
+	static const uint32_t seqn[] = {0, 2, 1, 4, 3, 13, 21, 5, 6, 13, 7};
+	struct rte_reorder_buffer *b = NULL;
+	struct rte_mempool *p = test_params->p;
+	const unsigned int num_bufs = RTE_DIM(seqn);
+	struct rte_mbuf *bufs[num_bufs];
+	struct rte_mbuf *robufs[num_bufs];
+	unsigned int i, cnt;
+	int ret = -1;
+
+	memset(bufs, 0, sizeof(bufs));
+	memset(robufs, 0, sizeof(robufs));
+
+	/* gap timeout is only supported in concurrent mode */
+	b = rte_reorder_create_params(&params);
+	TEST_ASSERT((b == NULL) && (rte_errno == EINVAL),
+			"No error on create with gap timeout and no MT flag");
+
+	params.flags = RTE_REORDER_F_MT;
+	b = rte_reorder_create_params(&params);
+	TEST_ASSERT_NOT_NULL(b, "Failed to create reorder buffer");
+
+	for (i = 0; i < num_bufs; i++) {
+		bufs[i] = rte_pktmbuf_alloc(p);
+		if (bufs[i] == NULL) {
+			printf("%s:%d: Packet allocation failed\n",
+					__func__, __LINE__);
+			goto exit;
+		}
+		bufs[i]->seqn = seqn[i];
+	}
+
+	/* 0 starts the window, 1 and 2 come out in order after it */
+	cnt = rte_reorder_insert_burst(b, bufs, 3);
+	if (cnt != 3) {
+		printf("%s:%d: Error inserting burst\n", __func__, __LINE__);
+		goto exit;
+	}
+	memset(bufs, 0, 3 * sizeof(bufs[0]));
+	cnt = rte_reorder_drain(b, robufs, num_bufs);
+	if (cnt != 3 || robufs[0]->seqn != 0 || robufs[1]->seqn != 1 ||
+			robufs[2]->seqn != 2) {
+		printf("%s:%d: Error draining in order\n", __func__, __LINE__);
+		goto exit;
+	}
+	for (i = 0; i < cnt; i++) {
+		rte_pktmbuf_free(robufs[i]);
+		robufs[i] = NULL;
+	}
+
+	/* 4 is held back by the gap at 3 until the gap times out */
+	if (rte_reorder_insert(b, bufs[3]) != 0) {
+		printf("%s:%d: Error inserting packet\n", __func__, __LINE__);
+		goto exit;
+	}
+	bufs[3] = NULL;
+	cnt = rte_reorder_drain(b, robufs, num_bufs);
+	if (cnt != 0) {
+		printf("%s:%d: Drained packet behind a gap\n",
+				__func__, __LINE__);
+		goto exit;
+	}
+	rte_delay_ms(2);
+	cnt = rte_reorder_drain(b, robufs, num_bufs);
+	if (cnt != 1 || robufs[0]->seqn != 4) {
+		printf("%s:%d: Gap not skipped after timeout\n",
+				__func__, __LINE__);
+		goto exit;
+	}
+	rte_pktmbuf_free(robufs[0]);
+	robufs[0] = NULL;
+
+	/* 3 is now late, 13 is early and 21 is out of range */
+	ret = rte_reorder_insert(b, bufs[4]);
+	if (!((ret == -1) && (rte_errno == ERANGE))) {
+		printf("%s:%d: No error inserting late packet\n",
+				__func__, __LINE__);
+		ret = -1;
+		goto exit;
+	}
+	ret = rte_reorder_insert(b, bufs[5]);
+	if (!((ret == -1) && (rte_errno == ENOSPC))) {
+		printf("%s:%d: No error inserting early packet\n",
+				__func__, __LINE__);
+		ret = -1;
+		goto exit;
+	}
+	ret = rte_reorder_insert(b, bufs[6]);
+	if (!((ret == -1) && (rte_errno == ERANGE))) {
+		printf("%s:%d: No error inserting out of range packet\n",
+				__func__, __LINE__);
+		ret = -1;
+		goto exit;
+	}
+	ret = -1;
+
+	/* burst insert stops at the first failure */
+	cnt = rte_reorder_insert_burst(b, &bufs[7], 4);
+	if (cnt != 2 || rte_errno != ENOSPC) {
+		printf("%s:%d: Burst insert did not stop at early packet\n",
+				__func__, __LINE__);
+		goto exit;
+	}
+	bufs[7] = NULL;
+	bufs[8] = NULL;
+
+	/* anything left in the buffer is freed along with it */
+	ret = 0;
+exit:
+	rte_reorder_free(b);
+	for (i = 0; i < num_bufs; i++) {
+		if (bufs[i] != NULL)
+			rte_pktmbuf_free(bufs[i]);
+		if (robufs[i] != NULL)
+			rte_pktmbuf_free(robufs[i]);
+	}
+	return ret;
+}
+
+/*
+ * Gap skips interleaved with late inserts: each round skips the gap left
+ * by a missing mbuf, which is then rejected as late, while the mbuf of
+ * the next lap using its slot is accepted and drained in order.
+ */
+#define GAP_ROUNDS 4
+
+static int
+test_reorder_mt_gap_late(void)
+{
+	struct rte_reorder_params params = {
+		.name = "test_mt_gap_late",
+		.socket_id = rte_socket_id(),
+		.size = 8,
+		.flags = RTE_REORDER_F_MT,
+		.gap_timeout = rte_get_timer_hz() / 1000,
+	};
+	struct rte_reorder_buffer *b = NULL;
+	struct rte_mempool *p = test_params->p;
+	const unsigned int num_bufs = params.size + 1;
+	struct rte_mbuf *bufs[num_bufs];
+	struct rte_mbuf *robufs[num_bufs];
+	unsigned int i, round, cnt;
+	uint32_t head = 0;
+	int ret = -1;
+
+	memset(bufs, 0, sizeof(bufs));
+	memset(robufs, 0, sizeof(robufs));
+
+	b = rte_reorder_create_params(&params);
+	TEST_ASSERT_NOT_NULL(b, "Failed to create reorder buffer");
+
+	/* the first mbuf starts the window */
+	bufs[0] = rte_pktmbuf_alloc(p);
+	if (bufs[0] == NULL) {
+		printf("%s:%d: Packet allocation failed\n", __func__, __LINE__);
+		goto exit;
+	}
+	bufs[0]->seqn = head;
+	if (rte_reorder_insert(b, bufs[0]) != 0) {
+		printf("%s:%d: Error inserting packet\n", __func__, __LINE__);
+		goto exit;
+	}
+	bufs[0] = NULL;
+	cnt = rte_reorder_drain(b, robufs, num_bufs);
+	if (cnt != 1) {
+		printf("%s:%d: Error draining packet\n", __func__, __LINE__);
+		goto exit;
+	}
+	rte_pktmbuf_free(robufs[0]);
+	robufs[0] = NULL;
+	head++;
+
+	for (round = 0; round < GAP_ROUNDS; round++) {
+		if (rte_pktmbuf_alloc_bulk(p, bufs, num_bufs) != 0) {
+			printf("%s:%d: Packet allocation failed\n",
+					__func__, __LINE__);
+			goto exit;
+		}
+		/*
+		 * head is missing: it comes last, and first is the mbuf
+		 * using its slot on the next lap
+		 */
+		bufs[0]->seqn = head + params.size;
+		for (i = 1; i < params.size; i++)
+			bufs[i]->seqn = head + i;
+		bufs[params.size]->seqn = head;
+
+		if (rte_reorder_insert(b, bufs[1]) != 0) {
+			printf("%s:%d: Error inserting packet\n",
+					__func__, __LINE__);
+			goto exit;
+		}
+		bufs[1] = NULL;
+
+		/* skip the gap at head once it timed out */
+		cnt = rte_reorder_drain(b, robufs, num_bufs);
+		if (cnt != 0) {
+			printf("%s:%d: Drained packet behind a gap\n",
+					__func__, __LINE__);
+			goto exit;
+		}
+		rte_delay_ms(2);
+		cnt = rte_reorder_drain(b, robufs, num_bufs);
+		if (cnt != 1 || robufs[0]->seqn != head + 1) {
+			printf("%s:%d: Gap not skipped after timeout\n",
+					__func__, __LINE__);
+			goto exit;
+		}
+		rte_pktmbuf_free(robufs[0]);
+		robufs[0] = NULL;
+
+		/* the missing mbuf is late now, its slot is free */
+		ret = rte_reorder_insert(b, bufs[params.size]);
+		if (!((ret == -1) && (rte_errno == ERANGE))) {
+			printf("%s:%d: No error inserting late packet\n",
+					__func__, __LINE__);
+			ret = -1;
+			goto exit;
+		}
+		ret = -1;
+		if (rte_reorder_insert(b, bufs[0]) != 0) {
+			printf("%s:%d: Error inserting packet of next lap\n",
+					__func__, __LINE__);
+			goto exit;
+		}
+		bufs[0] = NULL;
+		cnt = rte_reorder_insert_burst(b, &bufs[2], params.size - 2);
+		if (cnt != params.size - 2) {
+			printf("%s:%d: Error inserting burst\n",
+					__func__, __LINE__);
+			goto exit;
+		}
+		memset(&bufs[2], 0, cnt * sizeof(bufs[0]));
+
+		/* a run wrapping around the order buffer takes two drains */
+		cnt = rte_reorder_drain(b, robufs, num_bufs);
+		cnt += rte_reorder_drain(b, robufs + cnt, num_bufs - cnt);
+		if (cnt != params.size - 1) {
+			printf("%s:%d:%u: number of expected packets not drained\n",
+					__func__, __LINE__, cnt);
+			goto exit;
+		}
+		for (i = 0; i < cnt; i++) {
+			if (robufs[i]->seqn != head + 2 + i) {
+				printf("%s:%d: Error draining in order\n",
+						__func__, __LINE__);
+				goto exit;
+			}
+			rte_pktmbuf_free(robufs[i]);
+			robufs[i] = NULL;
+		}
+		rte_pktmbuf_free(bufs[params.size]);
+		bufs[params.size] = NULL;
+		head += params.size + 1;
+	}
+
+	ret = 0;
+exit:
+	rte_reorder_free(b);
+	for (i = 0; i < num_bufs; i++) {
+		if (bufs[i] != NULL)
+			rte_pktmbuf_free(bufs[i]);
+		if (robufs[i] != NULL)
+			rte_pktmbuf_free(robufs[i]);
+	}
+	return ret;
+}
+
+/*
+ * A worker inserts mbufs slightly out of order, with pauses long enough
+ * for the drain to skip gaps, while the main lcore keeps draining. Late
+ * inserts race the drain moving the window, and every mbuf accepted by
+ * the buffer must come out of it.
+ */
+#define RACE_MBUFS 20000
+
+struct reorder_race {
+	struct rte_reorder_buffer *b;
+	struct rte_mempool *p;
+	uint32_t inserted;
+	int done;
+};
+
+static int
+reorder_race_insert(void *arg)
+{
+	struct reorder_race *r = arg;
+	struct rte_mbuf *m;
+	uint32_t i;
+	int err, ret = 0;
+
+	for (i = 0; i < RACE_MBUFS; i++) {
+		m = rte_pktmbuf_alloc(r->p);
+		if (m == NULL) {
+			ret = -1;
+			break;
+		}
+		/* 0 starts the window, then blocks of 4 in reverse order */
+		m->seqn = (i == 0) ? 0 : ((i - 1) | 3) - ((i - 1) & 3) + 1;
+		/* wait for the drain to make room, drop late mbufs */
+		while ((err = rte_reorder_insert(r->b, m)) != 0 &&
+				rte_errno == ENOSPC)
+			rte_pause();
+		if (err == 0)
+			r->inserted++;
+		else
+			rte_pktmbuf_free(m);
+		if ((rte_rand() & 63) == 0)
+			rte_delay_us_sleep(1 + rte_rand() % 20);
+	}
+
+	__atomic_store_n(&r->done, 1, __ATOMIC_RELEASE);
+	return ret;
+}
+
+static int
+test_reorder_mt_race(void)
+{
+	struct rte_reorder_params params = {
+		.name = "test_mt_race",
+		.socket_id = rte_socket_id(),
+		.size = 64,
+		.flags = RTE_REORDER_F_MT,
+		.gap_timeout = rte_get_timer_hz() / 100000,
+	};
+	struct reorder_race r = {
+		.p = test_params->p,
+	};
+	struct rte_mbuf *robufs[BURST];
+	uint64_t deadline = 0;
+	uint32_t drained = 0;
+	unsigned int i, cnt, lcore;
+	int ret;
+
+	lcore = rte_get_next_lcore(-1, 1, 0);
+	if (lcore >= RTE_MAX_LCORE) {
+		printf("%s: at least 2 lcores are needed\n", __func__);
+		return TEST_SKIPPED;
+	}
+
+	params.gap_timeout = RTE_MAX(params.gap_timeout, 1ULL);
+	r.b = rte_reorder_create_params(&params);
+	TEST_ASSERT_NOT_NULL(r.b, "Failed to create reorder buffer");
+
+	rte_eal_remote_launch(reorder_race_insert, &r, lcore);
+
+	/* once the worker is done, gap skips flush what is left */
+	for (;;) {
+		cnt = rte_reorder_drain(r.b, robufs, BURST);
+		for (i = 0; i < cnt; i++)
+			rte_pktmbuf_free(robufs[i]);
+		drained += cnt;
+		if (!__atomic_load_n(&r.done, __ATOMIC_ACQUIRE))
+			continue;
+		if (drained == r.inserted)
+			break;
+		if (deadline == 0)
+			deadline = rte_get_timer_cycles() + rte_get_timer_hz();
+		else if (rte_get_timer_cycles() > deadline)
+			break;
+	}
+
+	ret = rte_eal_wait_lcore(lcore);
+	rte_reorder_free(r.b);
+
+	TEST_ASSERT_SUCCESS(ret, "Worker failed to allocate packets");
+	TEST_ASSERT_EQUAL(drained, r.inserted,
+			"%u packets inserted but %u drained",
+			r.inserted, drained);
+
+	return 0;
+}
+
+static int
+test_reorder_seqn_dynfield(void)
+{
+	struct rte_reorder_params params = {
+		.name = "test_dynfield",
+		.socket_id = rte_socket_id(),
+		.size = 128,
+		.flags = RTE_REORDER_F_MT | RTE_REORDER_F_SEQN_DYNFIELD,
+	};
+	struct rte_reorder_buffer *b = NULL;
+	struct rte_mempool *p = test_params->p;
+	const unsigned int num_bufs = 100;
+	struct rte_mbuf *bufs[num_bufs];
+	struct rte_mbuf *robufs[num_bufs];
+	unsigned int i, lap, cnt;
+	int ret = -1;
+
+	memset(bufs, 0, sizeof(bufs));
+	memset(robufs, 0, sizeof(robufs));
+
+	b = rte_reorder_create_params(&params);
+	TEST_ASSERT_NOT_NULL(b, "Failed to create reorder buffer");
+	TEST_ASSERT(rte_reorder_seqn_dynfield_offset >= 0,
+			"Sequence number field not registered");
+
+	/*
+	 * Runs of filled slots across bitmap words, and across the end of
+	 * the order buffer on the second lap. The seqn field of the mbufs
+	 * is ignored.
+	 */
+	for (lap = 0; lap < 2; lap++) {
+		if (rte_pktmbuf_alloc_bulk(p, bufs, num_bufs) != 0) {
+			printf("%s:%d: Packet allocation failed\n",
+					__func__, __LINE__);
+			goto exit;
+		}
+		/*
+		 * Lowest sequence number first, as the first mbuf inserted
+		 * sets the start of the window, then the others backwards.
+		 */
+		for (i = 0; i < num_bufs; i++) {
+			*rte_reorder_seqn(bufs[i]) = lap * num_bufs +
+				(i == 0 ? 0 : num_bufs - i);
+			bufs[i]->seqn = UINT32_MAX;
+		}
+
+		cnt = rte_reorder_insert_burst(b, bufs, num_bufs);
+		if (cnt != num_bufs) {
+			printf("%s:%d: Error inserting burst\n",
+					__func__, __LINE__);
+			goto exit;
+		}
+		memset(bufs, 0, sizeof(bufs));
+
+		cnt = rte_reorder_drain(b, robufs, num_bufs);
+		if (cnt != num_bufs) {
+			printf("%s:%d:%u: number of expected packets not drained\n",
+					__func__, __LINE__, cnt);
+			goto exit;
+		}
+		for (i = 0; i < cnt; i++) {
+			if (*rte_reorder_seqn(robufs[i]) !=
+					lap * num_bufs + i) {
+				printf("%s:%d: Error draining in order\n",
+						__func__, __LINE__);
+				goto exit;
+			}
+			rte_pktmbuf_free(robufs[i]);
+			robufs[i] = NULL;
+		}
+	}
+
+	ret = 0;
+exit:
+	rte_reorder_free(b);
+	for (i = 0; i < num_bufs; i++) {
+		if (bufs[i] != NULL)
+			rte_pktmbuf_free(bufs[i]);
+		if (robufs[i] != NULL)
+			rte_pktmbuf_free(robufs[i]);
+	}
+	return ret;
+}
+
 static int
 test_setup(void)
 {
@@ -380,6 +850,10 @@ static struct unit_test_suite reorder_test_suite  = {
 		TEST_CASE(test_reorder_free),
 		TEST_CASE(test_reorder_insert),
 		TEST_CASE(test_reorder_drain),
+		TEST_CASE(test_reorder_mt),
+		TEST_CASE(test_reorder_mt_gap_late),
+		TEST_CASE(test_reorder_mt_race),
+		TEST_CASE(test_reorder_seqn_dynfield),
 		TEST_CASES_END()
 	}
 };
@@ -0,0 +1,284 @@
+/* SPDX-License-Identifier: BSD-3-Clause
+ * Copyright(c) 2020 Intel Corporation
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <inttypes.h>
+
+#include <rte_cycles.h>
+#include <rte_errno.h>
+#include <rte_lcore.h>
+#include <rte_launch.h>
+#include <rte_mbuf.h>
+#include <rte_pause.h>
+#include <rte_random.h>
+#include <rte_reorder.h>
+
+#include "test.h"
+
+/*
+ * Single lcore: bursts of mbufs shuffled within the burst are inserted and
+ * drained straight away, to compare the per packet cost of both modes.
+ *
+ * Multiple lcores: the slave lcores act as pipeline workers, each taking
+ * the next burst of sequence numbers, dropping one packet in DROP_RATE and
+ * inserting the rest in a concurrent reorder buffer, while the master
+ * lcore drains it and checks the order. The sequence numbers are kept in
+ * the mbuf dynamic field.
+ */
+
+#define REORDER_SIZE		1024
+#define NUM_MBUFS		(4 * REORDER_SIZE)
+#define BURST			32
+#define ST_ITERATIONS		(1 << 14)
+#define MT_PACKETS		(1 << 22)
+#define DROP_RATE		4096
+#define GAP_TIMEOUT_US		100
+#define IDLE_TIMEOUT_S		1
+
+static struct rte_mempool *pool;
+static struct rte_reorder_buffer *rb;
+static uint32_t next_seqn;
+static uint32_t workers_done;
+static uint64_t dropped;
+static uint64_t late;
+
+static void
+shuffle(struct rte_mbuf **mbufs, uint32_t n)
+{
+	struct rte_mbuf *tmp;
+	uint32_t i, j;
+
+	for (i = n - 1; i > 0; i--) {
+		j = rte_rand_max(i + 1);
+		tmp = mbufs[i];
+		mbufs[i] = mbufs[j];
+		mbufs[j] = tmp;
+	}
+}
+
+static int
+test_reorder_perf_st(uint32_t flags)
+{
+	struct rte_reorder_params params = {
+		.name = "reorder_perf_st",
+		.socket_id = rte_socket_id(),
+		.size = REORDER_SIZE,
+		.flags = flags,
+	};
+	struct rte_mbuf *in[BURST], *out[BURST];
+	uint64_t begin, ins_cycles = 0, drain_cycles = 0;
+	uint32_t i, j, n, seqn = 0;
+	int ret = -1;
+
+	rb = rte_reorder_create_params(&params);
+	if (rb == NULL) {
+		printf("Failed to create reorder buffer\n");
+		return -1;
+	}
+
+	for (i = 0; i < ST_ITERATIONS; i++) {
+		if (rte_pktmbuf_alloc_bulk(pool, in, BURST) != 0) {
+			printf("Failed to allocate mbufs\n");
+			goto exit;
+		}
+		for (j = 0; j < BURST; j++)
+			in[j]->seqn = seqn + j;
+		/* the first mbuf inserted sets the start of the window */
+		if (seqn == 0)
+			shuffle(in + 1, BURST - 1);
+		else
+			shuffle(in, BURST);
+
+		begin = rte_rdtsc_precise();
+		n = rte_reorder_insert_burst(rb, in, BURST);
+		ins_cycles += rte_rdtsc_precise() - begin;
+		if (n != BURST) {
+			printf("Failed to insert burst, err %d\n", rte_errno);
+			rte_pktmbuf_free_bulk(in + n, BURST - n);
+			goto exit;
+		}
+
+		begin = rte_rdtsc_precise();
+		n = rte_reorder_drain(rb, out, BURST);
+		drain_cycles += rte_rdtsc_precise() - begin;
+		for (j = 0; j < n; j++) {
+			if (out[j]->seqn != seqn + j) {
+				printf("Drained seqn %u, expected %u\n",
+					out[j]->seqn, seqn + j);
+				rte_pktmbuf_free_bulk(out, n);
+				goto exit;
+			}
+		}
+		rte_pktmbuf_free_bulk(out, n);
+		if (n != BURST) {
+			printf("Drained %u packets, expected %u\n", n, BURST);
+			goto exit;
+		}
+		seqn += BURST;
+	}
+
+	printf("%s mode, average insert cycles: %"PRIu64", "
+		"average drain cycles: %"PRIu64"\n",
+		(flags & RTE_REORDER_F_MT) ? "Concurrent" : "Single-threaded",
+		ins_cycles / ((uint64_t)ST_ITERATIONS * BURST),
+		drain_cycles / ((uint64_t)ST_ITERATIONS * BURST));
+	ret = 0;
+exit:
+	rte_reorder_free(rb);
+	rb = NULL;
+	return ret;
+}
+
+static int
+test_reorder_perf_worker(__rte_unused void *arg)
+{
+	struct rte_mbuf *mbufs[BURST];
+	uint64_t nb_dropped = 0, nb_late = 0;
+	uint32_t i, n, seqn;
+
+	for (;;) {
+		seqn = __atomic_fetch_add(&next_seqn, BURST, __ATOMIC_RELAXED);
+		if (seqn >= MT_PACKETS)
+			break;
+
+		while (rte_pktmbuf_alloc_bulk(pool, mbufs, BURST) != 0)
+			rte_pause();
+
+		for (i = 0, n = 0; i < BURST; i++) {
+			if ((seqn + i) % DROP_RATE == DROP_RATE - 1) {
+				rte_pktmbuf_free(mbufs[i]);
+				nb_dropped++;
+				continue;
+			}
+			mbufs[n] = mbufs[i];
+			*rte_reorder_seqn(mbufs[n++]) = seqn + i;
+		}
+
+		for (i = 0; i < n; ) {
+			i += rte_reorder_insert_burst(rb, mbufs + i, n - i);
+			if (i == n)
+				break;
+			if (rte_errno == ENOSPC) {
+				rte_pause();
+				continue;
+			}
+			/* behind the window after a gap skip */
+			rte_pktmbuf_free(mbufs[i++]);
+			nb_late++;
+		}
+	}
+
+	__atomic_fetch_add(&dropped, nb_dropped, __ATOMIC_RELAXED);
+	__atomic_fetch_add(&late, nb_late, __ATOMIC_RELAXED);
+	__atomic_fetch_add(&workers_done, 1, __ATOMIC_RELEASE);
+
+	return 0;
+}
+
+static int
+test_reorder_perf_mt(void)
+{
+	struct rte_reorder_params params = {
+		.name = "reorder_perf_mt",
+		.socket_id = rte_socket_id(),
+		.size = REORDER_SIZE,
+		.flags = RTE_REORDER_F_MT | RTE_REORDER_F_SEQN_DYNFIELD,
+		.gap_timeout = rte_get_timer_hz() * GAP_TIMEOUT_US / US_PER_S,
+	};
+	struct rte_mbuf *out[BURST];
+	uint64_t begin, cycles, idle = 0, drained = 0, disorder = 0;
+	uint32_t i, n, nb_workers, seqn, last = 0;
+	unsigned int lcore_id;
+	int ret = 0;
+
+	rb = rte_reorder_create_params(&params);
+	if (rb == NULL) {
+		printf("Failed to create reorder buffer\n");
+		return -1;
+	}
+
+	next_seqn = 0;
+	workers_done = 0;
+	dropped = 0;
+	late = 0;
+	nb_workers = rte_lcore_count() - 1;
+
+	begin = rte_rdtsc_precise();
+	RTE_LCORE_FOREACH_SLAVE(lcore_id)
+		rte_eal_remote_launch(test_reorder_perf_worker, NULL,
+			lcore_id);
+
+	for (;;) {
+		n = rte_reorder_drain(rb, out, BURST);
+		for (i = 0; i < n; i++) {
+			/* a late mbuf comes after those following its gap */
+			seqn = *rte_reorder_seqn(out[i]);
+			if (drained + i != 0 && seqn <= last)
+				disorder++;
+			else
+				last = seqn;
+		}
+		rte_pktmbuf_free_bulk(out, n);
+		drained += n;
+		if (n != 0 || __atomic_load_n(&workers_done,
+				__ATOMIC_ACQUIRE) != nb_workers) {
+			idle = 0;
+			continue;
+		}
+		if (drained + dropped + late == MT_PACKETS)
+			break;
+		if (idle == 0)
+			idle = rte_get_timer_cycles();
+		else if (rte_get_timer_cycles() - idle >
+				rte_get_timer_hz() * IDLE_TIMEOUT_S) {
+			printf("Packets missing from the reorder buffer\n");
+			ret = -1;
+			break;
+		}
+	}
+	cycles = rte_rdtsc_precise() - begin;
+	rte_eal_mp_wait_lcore();
+
+	printf("Concurrent mode, %u workers: %"PRIu64" packets drained, "
+		"%"PRIu64" dropped, %"PRIu64" late, %"PRIu64" out of order, "
+		"%.2f Mpps\n", nb_workers, drained, dropped, late, disorder,
+		(double)drained * rte_get_tsc_hz() / cycles / 1e6);
+
+	rte_reorder_free(rb);
+	rb = NULL;
+	return ret;
+}
+
+static int
+test_reorder_perf(void)
+{
+	int ret;
+
+	pool = rte_pktmbuf_pool_create("reorder_perf_pool", NUM_MBUFS,
+		BURST, 0, RTE_MBUF_DEFAULT_BUF_SIZE, rte_socket_id());
+	if (pool == NULL) {
+		printf("Failed to create mbuf pool\n");
+		return -1;
+	}
+
+	ret = test_reorder_perf_st(0);
+	if (ret == 0)
+		ret = test_reorder_perf_st(RTE_REORDER_F_MT);
+	if (ret == 0) {
+		if (rte_lcore_count() < 2)
+			printf("Not enough cores for concurrent reorder test, "
+				"expecting at least 2\n");
+		else
+			ret = test_reorder_perf_mt();
+	}
+
+	rte_mempool_free(pool);
+	pool = NULL;
+
+	return ret;
+}
+
+REGISTER_TEST_COMMAND(reorder_perf_autotest, test_reorder_perf);
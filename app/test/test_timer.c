@@ -83,6 +83,24 @@
  *      - At initialization, timer3 is loaded by the master core, on
  *        another core in "periodical" mode (time = 1 second).
  *      - It is stopped at t=25s by timer2.
+ *
+ * #. Timer wheel tests.
+ *
+ *    These tests run on a timer data instance allocated with
+ *    rte_timer_data_alloc_wheel(), with one cycle ticks so that all the
+ *    wheel levels are crossed in a few tens of milliseconds. The master
+ *    core manages the timers with rte_timer_alt_manage(), and every
+ *    callback checks that its timer does not expire early.
+ *
+ *    - Timers expiring from every level, and beyond the 2^24 ticks covered
+ *      by the wheels, are cascaded down and expire once.
+ *    - A periodical timer is reloaded twice by the manage function, then
+ *      reloaded with another period from its callback, and stopped from
+ *      its callback.
+ *    - rte_timer_stop_all() stops timers of all levels, and a timer added
+ *      after it expires alone.
+ *    - Another core resets and stops timers while the master core expires
+ *      them, then all the timers are loaded once and must expire once.
  */
 
 #include <stdio.h>
@@ -494,6 +512,283 @@ timer_basic_main_loop(__attribute__((unused)) void *arg)
 	return 0;
 }
 
+#define WHEEL_NB_RACE_TIMERS 16
+#define WHEEL_RACE_TICKS 2000
+
+struct wheel_timer {
+	struct rte_timer tim;
+	unsigned int count;
+};
+
+static uint32_t wheel_id;
+static volatile int wheel_race_stop;
+static int wheel_failed;
+
+static void
+wheel_manage_cb(struct rte_timer *tim)
+{
+	tim->f(tim, tim->arg);
+}
+
+static void
+wheel_expiry_cb(struct rte_timer *tim, void *arg)
+{
+	struct wheel_timer *wt = arg;
+
+	if (rte_get_timer_cycles() < tim->expire) {
+		printf("Timer expired %"PRIu64" cycles early\n",
+				tim->expire - rte_get_timer_cycles());
+		wheel_failed = 1;
+	}
+	wt->count++;
+}
+
+/* Manage the wheel of this core until n callbacks ran or cycles elapsed */
+static unsigned int
+wheel_manage(struct wheel_timer *wts, unsigned int nb_timers,
+		unsigned int n, uint64_t cycles)
+{
+	uint64_t end = rte_get_timer_cycles() + cycles;
+	unsigned int i, count;
+
+	do {
+		rte_timer_alt_manage(wheel_id, NULL, 0, wheel_manage_cb);
+		for (i = 0, count = 0; i < nb_timers; i++)
+			count += wts[i].count;
+	} while (count < n && rte_get_timer_cycles() < end);
+
+	return count;
+}
+
+static int
+wheel_reset(struct wheel_timer *wt, uint64_t ticks, enum rte_timer_type type,
+		rte_timer_cb_t fct)
+{
+	if (rte_timer_alt_reset(wheel_id, &wt->tim, ticks, type,
+			rte_lcore_id(), fct, wt) != 0) {
+		printf("Cannot reset wheel timer\n");
+		return -1;
+	}
+
+	return 0;
+}
+
+/* timers of all the levels, and beyond the range of the wheels */
+static const uint64_t wheel_ticks[] = {
+	0, 10, 100, 5000, 100000, 300000, 5000000,
+	(1 << 24) + 1000, 1 << 25, 3 << 24,
+};
+
+static int
+timer_wheel_cascade_test(void)
+{
+	struct wheel_timer wts[RTE_DIM(wheel_ticks)];
+	unsigned int i, count;
+
+	memset(wts, 0, sizeof(wts));
+	for (i = 0; i < RTE_DIM(wts); i++) {
+		rte_timer_init(&wts[i].tim);
+		if (wheel_reset(&wts[i], wheel_ticks[i], SINGLE,
+				wheel_expiry_cb) < 0)
+			return -1;
+	}
+
+	count = wheel_manage(wts, RTE_DIM(wts), RTE_DIM(wts),
+			(3 << 24) + rte_get_timer_hz());
+	for (i = 0; i < RTE_DIM(wts); i++) {
+		if (wts[i].count != 1) {
+			printf("Timer of %"PRIu64" ticks expired %u times\n",
+					wheel_ticks[i], wts[i].count);
+			return -1;
+		}
+	}
+
+	/* nothing expires a second time */
+	count = wheel_manage(wts, RTE_DIM(wts), RTE_DIM(wts) + 1,
+			rte_get_timer_hz() / 100);
+	if (count != RTE_DIM(wts)) {
+		printf("Timers expired again\n");
+		return -1;
+	}
+
+	return 0;
+}
+
+static void
+wheel_periodic_cb(struct rte_timer *tim, void *arg)
+{
+	struct wheel_timer *wt = arg;
+	uint64_t period = tim->period;
+
+	wheel_expiry_cb(tim, arg);
+	if (wt->count == 3 &&
+			wheel_reset(wt, 2 * period, PERIODICAL,
+				wheel_periodic_cb) < 0)
+		wheel_failed = 1;
+	else if (wt->count == 6 &&
+			rte_timer_alt_stop(wheel_id, tim) != 0)
+		wheel_failed = 1;
+}
+
+static int
+timer_wheel_periodic_test(void)
+{
+	const uint64_t period = rte_get_timer_hz() / 1000;
+	struct wheel_timer wt;
+
+	memset(&wt, 0, sizeof(wt));
+	rte_timer_init(&wt.tim);
+	if (wheel_reset(&wt, period, PERIODICAL, wheel_periodic_cb) < 0)
+		return -1;
+
+	/* 3 periods, 3 double periods, then some more time */
+	wheel_manage(&wt, 1, 7, 20 * period);
+	if (wt.count != 6 || rte_timer_pending(&wt.tim)) {
+		printf("Periodical timer expired %u times\n", wt.count);
+		rte_timer_alt_stop(wheel_id, &wt.tim);
+		return -1;
+	}
+
+	return 0;
+}
+
+static void
+wheel_stop_cb(struct rte_timer *tim __rte_unused, void *arg)
+{
+	unsigned int *stopped = arg;
+
+	(*stopped)++;
+}
+
+static int
+timer_wheel_stop_all_test(void)
+{
+	struct wheel_timer wts[RTE_DIM(wheel_ticks)];
+	unsigned int lcore_id = rte_lcore_id();
+	unsigned int i, count, stopped = 0;
+
+	memset(wts, 0, sizeof(wts));
+	for (i = 0; i < RTE_DIM(wts); i++) {
+		rte_timer_init(&wts[i].tim);
+		if (wheel_reset(&wts[i], wheel_ticks[i] + 1000, SINGLE,
+				wheel_expiry_cb) < 0)
+			return -1;
+	}
+
+	if (rte_timer_stop_all(wheel_id, &lcore_id, 1, wheel_stop_cb,
+			&stopped) != 0 || stopped != RTE_DIM(wts)) {
+		printf("%u timers stopped out of %zu\n", stopped,
+				RTE_DIM(wts));
+		return -1;
+	}
+	for (i = 0; i < RTE_DIM(wts); i++) {
+		if (rte_timer_pending(&wts[i].tim)) {
+			printf("Timer still pending after stop all\n");
+			return -1;
+		}
+	}
+
+	/* the wheel is empty, a new timer expires alone */
+	if (wheel_reset(&wts[0], 1000, SINGLE, wheel_expiry_cb) < 0)
+		return -1;
+	count = wheel_manage(wts, RTE_DIM(wts), RTE_DIM(wts),
+			(3 << 24) + rte_get_timer_hz() / 100);
+	if (count != 1 || wts[0].count != 1) {
+		printf("%u timers expired after stop all\n", count);
+		return -1;
+	}
+
+	return 0;
+}
+
+/* reset and stop the timers of the master core at random */
+static int
+wheel_race_loop(void *arg)
+{
+	struct wheel_timer *wts = arg;
+	unsigned int master = rte_get_master_lcore();
+	struct wheel_timer *wt;
+	uint64_t r;
+
+	while (!wheel_race_stop) {
+		r = rte_rand();
+		wt = &wts[r % WHEEL_NB_RACE_TIMERS];
+		if (r & (1ULL << 32))
+			rte_timer_alt_reset(wheel_id, &wt->tim,
+					(r >> 33) % WHEEL_RACE_TICKS, SINGLE,
+					master, wheel_expiry_cb, wt);
+		else
+			rte_timer_alt_stop(wheel_id, &wt->tim);
+	}
+
+	return 0;
+}
+
+static int
+timer_wheel_race_test(void)
+{
+	struct wheel_timer wts[WHEEL_NB_RACE_TIMERS];
+	unsigned int lcore_id, i, count;
+
+	memset(wts, 0, sizeof(wts));
+	for (i = 0; i < RTE_DIM(wts); i++)
+		rte_timer_init(&wts[i].tim);
+
+	lcore_id = rte_get_next_lcore(-1, 1, 0);
+	wheel_race_stop = 0;
+	rte_eal_remote_launch(wheel_race_loop, wts, lcore_id);
+	wheel_manage(wts, RTE_DIM(wts), UINT32_MAX, rte_get_timer_hz() / 10);
+	wheel_race_stop = 1;
+	rte_eal_wait_lcore(lcore_id);
+
+	/* the wheel must still expire every timer once */
+	for (i = 0; i < RTE_DIM(wts); i++) {
+		rte_timer_alt_stop(wheel_id, &wts[i].tim);
+		wts[i].count = 0;
+		if (wheel_reset(&wts[i], i * WHEEL_RACE_TICKS, SINGLE,
+				wheel_expiry_cb) < 0)
+			return -1;
+	}
+	count = wheel_manage(wts, RTE_DIM(wts), RTE_DIM(wts),
+			rte_get_timer_hz() / 10);
+	for (i = 0; i < RTE_DIM(wts); i++) {
+		if (wts[i].count != 1) {
+			printf("%u timers expired out of %zu after race\n",
+					count, RTE_DIM(wts));
+			return -1;
+		}
+	}
+
+	return 0;
+}
+
+static int
+timer_wheel_tests(void)
+{
+	int ret;
+
+	/* one cycle ticks */
+	if (rte_timer_data_alloc_wheel(&wheel_id, 1) != 0) {
+		printf("Cannot allocate wheel timer data\n");
+		return -1;
+	}
+
+	wheel_failed = 0;
+	ret = timer_wheel_cascade_test();
+	if (ret == 0)
+		ret = timer_wheel_periodic_test();
+	if (ret == 0)
+		ret = timer_wheel_stop_all_test();
+	if (ret == 0)
+		ret = timer_wheel_race_test();
+	if (wheel_failed)
+		ret = -1;
+
+	rte_timer_data_dealloc(wheel_id);
+
+	return ret;
+}
+
 static int
 timer_sanity_check(void)
 {
@@ -594,6 +889,10 @@ test_timer(void)
 
 	rte_timer_dump_stats(stdout);
 
+	printf("\nStart timer wheel tests\n");
+	if (timer_wheel_tests() < 0)
+		return TEST_FAILED;
+
 	return TEST_SUCCESS;
 }
 
@@ -33,6 +33,148 @@ timer_cb(struct rte_timer *t __rte_unused, void *param __rte_unused)
 #define do_delay() rte_pause()
 #endif
 
+#define BACKEND_NB_SIZES 3
+static const unsigned int backend_nb_timers[BACKEND_NB_SIZES] = {
+	1000, 100000, MAX_ITERATIONS
+};
+
+static void
+alt_manage_cb(struct rte_timer *tim)
+{
+	tim->f(tim, tim->arg);
+}
+
+/*
+ * Measure the cycles per timer of the operations on a timer data instance:
+ * arm timers, re-arm them while pending as done for idle timers, stop them,
+ * and expire them. Then measure a manage call without expired timer.
+ */
+static int
+timer_perf_backend(const char *name, uint32_t timer_data_id,
+		   struct rte_timer *tms, unsigned int nb_timers)
+{
+	unsigned int lcore_id = rte_lcore_id();
+	uint64_t add, reset, stop, expire, idle;
+	uint64_t start_tsc, deadline;
+	unsigned int i;
+
+	/* far timers spread on one second, never expiring during the test */
+	const uint64_t far = rte_get_timer_hz() * DELAY_SECONDS;
+	/* near timers spread on 10 ms */
+	const uint64_t near = rte_get_timer_hz() / 100;
+
+	start_tsc = rte_rdtsc();
+	for (i = 0; i < nb_timers; i++)
+		if (rte_timer_alt_reset(timer_data_id, &tms[i],
+				far + rte_rand() % far, SINGLE, lcore_id,
+				timer_cb, NULL) != 0)
+			goto reset_error;
+	add = (rte_rdtsc() - start_tsc) / nb_timers;
+
+	start_tsc = rte_rdtsc();
+	for (i = 0; i < nb_timers; i++)
+		if (rte_timer_alt_reset(timer_data_id, &tms[i],
+				far + rte_rand() % far, SINGLE, lcore_id,
+				timer_cb, NULL) != 0)
+			goto reset_error;
+	reset = (rte_rdtsc() - start_tsc) / nb_timers;
+
+	start_tsc = rte_rdtsc();
+	for (i = 0; i < nb_timers; i++)
+		rte_timer_alt_stop(timer_data_id, &tms[i]);
+	stop = (rte_rdtsc() - start_tsc) / nb_timers;
+
+	for (i = 0; i < nb_timers; i++)
+		if (rte_timer_alt_reset(timer_data_id, &tms[i],
+				rte_rand() % near, SINGLE, lcore_id,
+				timer_cb, NULL) != 0)
+			goto reset_error;
+	outstanding_count = nb_timers;
+	deadline = rte_get_timer_cycles() + 2 * near;
+	while (rte_get_timer_cycles() < deadline)
+		do_delay();
+
+	deadline = rte_get_timer_cycles() + far;
+	start_tsc = rte_rdtsc();
+	while (outstanding_count && rte_get_timer_cycles() < deadline)
+		rte_timer_alt_manage(timer_data_id, NULL, 0, alt_manage_cb);
+	expire = (rte_rdtsc() - start_tsc) / nb_timers;
+	if (outstanding_count != 0) {
+		printf("Error: %s: outstanding callback count = %d\n",
+				name, outstanding_count);
+		return -1;
+	}
+
+	if (rte_timer_alt_reset(timer_data_id, &tms[0], far, SINGLE, lcore_id,
+			timer_cb, NULL) != 0)
+		goto reset_error;
+	start_tsc = rte_rdtsc();
+	for (i = 0; i < MAX_ITERATIONS; i++)
+		rte_timer_alt_manage(timer_data_id, NULL, 0, alt_manage_cb);
+	idle = (rte_rdtsc() - start_tsc) / MAX_ITERATIONS;
+	rte_timer_alt_stop(timer_data_id, &tms[0]);
+
+	printf("%-8s %7u %8"PRIu64" %8"PRIu64" %8"PRIu64" %8"PRIu64" %8"PRIu64"\n",
+			name, nb_timers, add, reset, stop, expire, idle);
+
+	return 0;
+
+reset_error:
+	printf("Error: %s: cannot reset timer\n", name);
+	/* the caller frees the timers, don't leave them armed */
+	rte_timer_stop_all(timer_data_id, &lcore_id, 1, NULL, NULL);
+	return -1;
+}
+
+/* compare the skiplist and timer wheel timer data instances */
+static int
+test_timer_perf_backends(void)
+{
+	uint32_t list_id, wheel_id;
+	struct rte_timer *tms;
+	unsigned int i;
+	int ret = -1;
+
+	tms = rte_malloc(NULL, sizeof(*tms) * MAX_ITERATIONS, 0);
+	if (tms == NULL)
+		return -1;
+
+	for (i = 0; i < MAX_ITERATIONS; i++)
+		rte_timer_init(&tms[i]);
+
+	if (rte_timer_data_alloc(&list_id) != 0) {
+		printf("Error: cannot allocate skiplist timer data\n");
+		goto free_tms;
+	}
+	/* 100 us ticks */
+	if (rte_timer_data_alloc_wheel(&wheel_id,
+			rte_get_timer_hz() / 10000) != 0) {
+		printf("Error: cannot allocate wheel timer data\n");
+		goto free_list;
+	}
+
+	printf("\nCycles per timer for add, reset of a pending timer, stop, "
+			"expiry, and per manage call without expiry:\n");
+	printf("%-8s %7s %8s %8s %8s %8s %8s\n", "backend", "timers",
+			"add", "reset", "stop", "expire", "manage");
+	for (i = 0; i < BACKEND_NB_SIZES; i++) {
+		if (timer_perf_backend("skiplist", list_id, tms,
+				backend_nb_timers[i]) < 0 ||
+		    timer_perf_backend("wheel", wheel_id, tms,
+				backend_nb_timers[i]) < 0)
+			goto free_wheel;
+	}
+	ret = 0;
+
+free_wheel:
+	rte_timer_data_dealloc(wheel_id);
+free_list:
+	rte_timer_data_dealloc(list_id);
+free_tms:
+	rte_free(tms);
+	return ret;
+}
+
 static int
 test_timer_perf(void)
 {
@@ -128,7 +270,7 @@ test_timer_perf(void)
 			(end_tsc - start_tsc + iterations/2) / iterations);
 
 	rte_free(tms);
-	return 0;
+	return test_timer_perf_backends();
 }
 
 REGISTER_TEST_COMMAND(timer_perf_autotest, test_timer_perf);
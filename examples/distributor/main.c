@@ -26,6 +26,8 @@
 #define SCHED_RX_RING_SZ 8192
 #define SCHED_TX_RING_SZ 65536
 #define BURST_SIZE_TX 32
+#define LAT_BUCKETS 1024 /* 1 us buckets, the last one is an overflow */
+#define ELEPHANT_TAG 0x5a5a
 
 #define RTE_LOGTYPE_DISTRAPP RTE_LOGTYPE_USER1
 
@@ -34,6 +36,10 @@
 
 /* mask of enabled ports */
 static uint32_t enabled_port_mask;
+/* flow balancing mode of the distributor */
+static int balance;
+/* percentage of the received packets turned into a single heavy flow */
+static unsigned int skew_pct;
 volatile uint8_t quit_signal;
 volatile uint8_t quit_signal_rx;
 volatile uint8_t quit_signal_dist;
@@ -74,6 +80,10 @@ static volatile struct app_stats {
 
 	uint64_t port_rx_pkts[64] __rte_cache_aligned;
 	uint64_t port_tx_pkts[64] __rte_cache_aligned;
+
+	/* rx to tx latency of the packets, in us, and max in cycles */
+	uint64_t latency[LAT_BUCKETS] __rte_cache_aligned;
+	uint64_t latency_max;
 } app_stats;
 
 struct app_stats prev_app_stats;
@@ -99,7 +109,7 @@ struct output_buffer {
 	struct rte_mbuf *mbufs[BURST_SIZE];
 };
 
-static void print_stats(void);
+static void print_stats(struct rte_distributor *d);
 
 /*
  * Initialises a given port using global settings and with the rx buffers
@@ -243,6 +253,7 @@ lcore_rx(struct lcore_params *p)
 
 	printf("\nCore %u doing packet RX.\n", rte_lcore_id());
 	port = 0;
+	unsigned int skew_count = 0;
 	while (!quit_signal_rx) {
 
 		/* skip ports that are not enabled */
@@ -260,6 +271,21 @@ lcore_rx(struct lcore_params *p)
 		}
 		app_stats.rx.rx_pkts += nb_rx;
 
+		/*
+		 * Timestamp the packets for the latency stats, and send
+		 * skew_pct percent of them to the same flow, to emulate a
+		 * heavy flow in the traffic.
+		 */
+		uint16_t i;
+		const uint64_t now = rte_rdtsc();
+		for (i = 0; i < nb_rx; i++) {
+			bufs[i]->udata64 = now;
+			if (skew_count < skew_pct)
+				bufs[i]->hash.usr = ELEPHANT_TAG;
+			if (++skew_count == 100)
+				skew_count = 0;
+		}
+
 /*
  * You can run the distributor on the rx core with this code. Returned
  * packets are then send straight to the tx core.
@@ -402,6 +428,7 @@ lcore_tx(struct rte_ring *in_r)
 {
 	static struct output_buffer tx_buffers[RTE_MAX_ETHPORTS];
 	const int socket_id = rte_socket_id();
+	const uint64_t cycles_per_us = rte_get_tsc_hz() / US_PER_S;
 	uint16_t port;
 
 	RTE_ETH_FOREACH_DEV(port) {
@@ -440,10 +467,17 @@ lcore_tx(struct rte_ring *in_r)
 			rte_prefetch_non_temporal((void *)bufs[0]);
 			rte_prefetch_non_temporal((void *)bufs[1]);
 			rte_prefetch_non_temporal((void *)bufs[2]);
+			const uint64_t now = rte_rdtsc();
 			for (i = 0; i < nb_rx; i++) {
 				struct output_buffer *outbuf;
+				uint64_t lat;
 				uint8_t outp;
 				rte_prefetch_non_temporal((void *)bufs[i + 3]);
+				lat = now - bufs[i]->udata64;
+				if (lat > app_stats.latency_max)
+					app_stats.latency_max = lat;
+				app_stats.latency[RTE_MIN(lat / cycles_per_us,
+						(uint64_t)LAT_BUCKETS - 1)]++;
 				/*
 				 * workers should update in_port to hold the
 				 * output port value
@@ -474,9 +508,42 @@ int_handler(int sig_num)
 	quit_signal_dist = 1;
 }
 
+/* print the rx to tx latency percentiles of the last period, and reset */
+static void
+print_latency(void)
+{
+	uint64_t count[LAT_BUCKETS];
+	uint64_t total = 0, sum = 0, max;
+	unsigned int i, p50 = 0, p99 = 0;
+
+	for (i = 0; i < LAT_BUCKETS; i++) {
+		count[i] = app_stats.latency[i];
+		app_stats.latency[i] = 0;
+		total += count[i];
+	}
+	max = app_stats.latency_max;
+	app_stats.latency_max = 0;
+	if (total == 0)
+		return;
+
+	for (i = 0; i < LAT_BUCKETS; i++) {
+		sum += count[i];
+		if (sum * 2 < total)
+			p50 = i + 1;
+		if (sum * 100 < total * 99)
+			p99 = i + 1;
+	}
+
+	printf("Latency (us): p50 %s%u, p99 %s%u, max %.1f\n",
+			p50 == LAT_BUCKETS - 1 ? ">" : "", p50,
+			p99 == LAT_BUCKETS - 1 ? ">" : "", p99,
+			(double)max * US_PER_S / rte_get_tsc_hz());
+}
+
 static void
-print_stats(void)
+print_stats(struct rte_distributor *d)
 {
+	struct rte_distributor_worker_stats wstats;
 	struct rte_eth_stats eth_stats;
 	unsigned int i, j;
 	const unsigned int num_workers = rte_lcore_count() - 4;
@@ -553,6 +620,8 @@ print_stats(void)
 	prev_app_stats.tx.tx_pkts = app_stats.tx.tx_pkts;
 	prev_app_stats.tx.enqdrop_pkts = app_stats.tx.enqdrop_pkts;
 
+	print_latency();
+
 	for (i = 0; i < num_workers; i++) {
 		printf("Worker %02u Pkts: %5.2f. Bursts(1-8): ", i,
 				(app_stats.worker_pkts[i] -
@@ -561,6 +630,13 @@ print_stats(void)
 			printf("%"PRIu64" ", app_stats.worker_bursts[i][j]);
 			app_stats.worker_bursts[i][j] = 0;
 		}
+		if (balance &&
+				rte_distributor_get_worker_stats(d, i,
+					&wstats) == 0)
+			printf("Load: %u, Flows: %u, In: %"PRIu64
+					", Out: %"PRIu64, wstats.load,
+					wstats.flows, wstats.flows_in,
+					wstats.flows_out);
 		printf("\n");
 		prev_app_stats.worker_pkts[i] = app_stats.worker_pkts[i];
 	}
@@ -633,8 +709,10 @@ init_power_library(void)
 static void
 print_usage(const char *prgname)
 {
-	printf("%s [EAL options] -- -p PORTMASK\n"
-			"  -p PORTMASK: hexadecimal bitmask of ports to configure\n",
+	printf("%s [EAL options] -- -p PORTMASK [--balance] [--skew PCT]\n"
+			"  -p PORTMASK: hexadecimal bitmask of ports to configure\n"
+			"  --balance: enable the flow balancing mode\n"
+			"  --skew PCT: send PCT percent of the packets to one flow\n",
 			prgname);
 }
 
@@ -663,7 +741,10 @@ parse_args(int argc, char **argv)
 	char **argvopt;
 	int option_index;
 	char *prgname = argv[0];
+	char *end;
 	static struct option lgopts[] = {
+		{"balance", no_argument, 0, 'b'},
+		{"skew", required_argument, 0, 's'},
 		{NULL, 0, 0, 0}
 	};
 
@@ -683,6 +764,20 @@ parse_args(int argc, char **argv)
 			}
 			break;
 
+		case 'b':
+			balance = 1;
+			break;
+
+		case 's':
+			skew_pct = strtoul(optarg, &end, 10);
+			if (optarg[0] == '\0' || *end != '\0' ||
+					skew_pct > 100) {
+				printf("invalid skew percentage\n");
+				print_usage(prgname);
+				return -1;
+			}
+			break;
+
 		default:
 			print_usage(prgname);
 			return -1;
@@ -784,6 +879,18 @@ main(int argc, char *argv[])
 	if (d == NULL)
 		rte_exit(EXIT_FAILURE, "Cannot create distributor\n");
 
+	if (balance) {
+		struct rte_distributor_balance_params bp = {
+			.epoch_pkts = 64 * 1024,
+			.hysteresis = 10,
+			.max_moves = 8,
+		};
+
+		if (rte_distributor_balance_enable(d, &bp) != 0)
+			rte_exit(EXIT_FAILURE,
+					"Cannot enable flow balancing\n");
+	}
+
 	/*
 	 * scheduler ring is read by the transmitter core, and written to
 	 * by scheduler core
@@ -919,7 +1026,7 @@ main(int argc, char *argv[])
 	t = rte_rdtsc() + freq;
 	while (!quit_signal_dist) {
 		if (t < rte_rdtsc()) {
-			print_stats();
+			print_stats(d);
 			t = rte_rdtsc() + freq;
 		}
 		usleep(1000);
@@ -930,7 +1037,7 @@ main(int argc, char *argv[])
 			return -1;
 	}
 
-	print_stats();
+	print_stats(d);
 
 	rte_free(pd);
 	rte_free(pr);
@@ -20,6 +20,7 @@
 #include <rte_memory.h>
 #include <rte_memcpy.h>
 #include <rte_eal.h>
+#include <rte_errno.h>
 #include <rte_launch.h>
 #include <rte_atomic.h>
 #include <rte_cycles.h>
@@ -78,6 +79,7 @@
 
 #define MAX_PKT_BURST	32
 #define BURST_TX_DRAIN_US 100 /* TX drain every ~100us */
+#define STATS_PERIOD_S	10 /* statistics display period */
 
 /* Configure how many packets ahead to prefetch, when reading packets */
 #define PREFETCH_OFFSET	3
@@ -119,6 +121,12 @@ static int enabled_port_mask = 0;
 
 static int rx_queue_per_lcore = 1;
 
+/* fragment the packets with rte_ipv4/6_fragment_burst() */
+static int burst_mode;
+
+/* display the forwarding cycles periodically */
+static int stats_enabled;
+
 #define MBUF_TABLE_SIZE  (2 * MAX(MAX_PKT_BURST, MAX_PACKET_FRAG))
 
 struct mbuf_table {
@@ -141,6 +149,9 @@ struct lcore_queue_conf {
 	uint16_t tx_queue_id[RTE_MAX_ETHPORTS];
 	struct rx_queue rx_queue_list[MAX_RX_QUEUE_PER_LCORE];
 	struct mbuf_table tx_mbufs[RTE_MAX_ETHPORTS];
+	uint64_t fwd_cycles;
+	uint64_t fwd_pkts;
+	uint64_t tx_pkts;
 } __rte_cache_aligned;
 struct lcore_queue_conf lcore_queue_conf[RTE_MAX_LCORE];
 
@@ -227,6 +238,7 @@ send_burst(struct lcore_queue_conf *qconf, uint16_t n, uint16_t port)
 	m_table = (struct rte_mbuf **)qconf->tx_mbufs[port].m_table;
 
 	ret = rte_eth_tx_burst(port, queueid, m_table, n);
+	qconf->tx_pkts += ret;
 	if (unlikely(ret < n)) {
 		do {
 			rte_pktmbuf_free(m_table[ret]);
@@ -380,19 +392,176 @@ l3fwd_simple_forward(struct rte_mbuf *m, struct lcore_queue_conf *qconf,
 	qconf->tx_mbufs[port_out].len = 0;
 }
 
+/* Forward a burst of packets one by one */
+static inline void
+l3fwd_simple_forward_burst(struct rte_mbuf **pkts_burst, int nb_rx,
+		struct lcore_queue_conf *qconf, uint8_t queueid,
+		uint16_t portid)
+{
+	int j;
+
+	/* Prefetch first packets */
+	for (j = 0; j < PREFETCH_OFFSET && j < nb_rx; j++) {
+		rte_prefetch0(rte_pktmbuf_mtod(
+				pkts_burst[j], void *));
+	}
+
+	/* Prefetch and forward already prefetched packets */
+	for (j = 0; j < (nb_rx - PREFETCH_OFFSET); j++) {
+		rte_prefetch0(rte_pktmbuf_mtod(pkts_burst[
+				j + PREFETCH_OFFSET], void *));
+		l3fwd_simple_forward(pkts_burst[j], qconf, queueid, portid);
+	}
+
+	/* Forward remaining prefetched packets */
+	for (; j < nb_rx; j++) {
+		l3fwd_simple_forward(pkts_burst[j], qconf, queueid, portid);
+	}
+}
+
+/*
+ * Queue a run of packets going to the same port, fragmenting them if
+ * they are IP packets bigger than the MTU.
+ */
+static inline void
+l3fwd_burst_queue(struct rte_mbuf **pkts, uint16_t nb_pkts,
+		struct lcore_queue_conf *qconf, struct rx_queue *rxq,
+		uint16_t port_out, uint8_t ip_version)
+{
+	struct rte_ip_frag_burst_params params = {
+		.pool_direct = rxq->direct_pool,
+		.pool_indirect = rxq->indirect_pool,
+	};
+	struct mbuf_table *txm = &qconf->tx_mbufs[port_out];
+	uint16_t i, done, nb_out;
+
+	for (i = 0; i != nb_pkts; i += done) {
+		nb_out = MBUF_TABLE_SIZE - txm->len;
+		if (ip_version == 4) {
+			params.mtu_size = IPV4_MTU_DEFAULT;
+			done = rte_ipv4_fragment_burst(&pkts[i], nb_pkts - i,
+				&txm->m_table[txm->len], &nb_out, &params);
+		} else if (ip_version == 6) {
+			params.mtu_size = IPV6_MTU_DEFAULT;
+			done = rte_ipv6_fragment_burst(&pkts[i], nb_pkts - i,
+				&txm->m_table[txm->len], &nb_out, &params);
+		} else {
+			/* less than MAX_PKT_BURST packets are queued */
+			done = nb_pkts - i;
+			rte_memcpy(&txm->m_table[txm->len], &pkts[i],
+				done * sizeof(pkts[0]));
+			nb_out = done;
+		}
+		txm->len += nb_out;
+
+		if (i + done != nb_pkts) {
+			/* send the queued packets to make room */
+			if (rte_errno == ENOSPC && txm->len != 0) {
+				send_burst(qconf, txm->len, port_out);
+				txm->len = 0;
+				continue;
+			}
+			/* drop the packet which can't be fragmented */
+			rte_pktmbuf_free(pkts[i + done]);
+			done++;
+		}
+
+		if (txm->len >= MAX_PKT_BURST) {
+			send_burst(qconf, txm->len, port_out);
+			txm->len = 0;
+		}
+	}
+}
+
+/*
+ * Forward a burst of packets, keeping their Ethernet header, which is
+ * copied in the fragments by rte_ipv4/6_fragment_burst().
+ */
+static inline void
+l3fwd_burst_forward(struct rte_mbuf **pkts, uint16_t nb_pkts,
+		struct lcore_queue_conf *qconf, uint8_t queueid,
+		uint16_t port_in)
+{
+	struct rx_queue *rxq = &qconf->rx_queue_list[queueid];
+	struct rte_ether_hdr *eth_hdr;
+	struct rte_ipv4_hdr *ip_hdr;
+	struct rte_ipv6_hdr *ip6_hdr;
+	struct rte_mbuf *m;
+	uint16_t i, start = 0, port_out, run_port = 0;
+	uint8_t ip_version, run_version = 0;
+	uint32_t next_hop;
+	void *d_addr_bytes;
+
+	for (i = 0; i != nb_pkts; i++) {
+		m = pkts[i];
+		eth_hdr = rte_pktmbuf_mtod(m, struct rte_ether_hdr *);
+		m->l2_len = sizeof(struct rte_ether_hdr);
+
+		/* by default, send everything back to the source port */
+		port_out = port_in;
+		ip_version = 0;
+
+		if (RTE_ETH_IS_IPV4_HDR(m->packet_type)) {
+			ip_hdr = (struct rte_ipv4_hdr *)(eth_hdr + 1);
+			if (rte_lpm_lookup(rxq->lpm,
+					rte_be_to_cpu_32(ip_hdr->dst_addr),
+					&next_hop) == 0 &&
+					(enabled_port_mask & 1 << next_hop))
+				port_out = next_hop;
+
+			/* request HW to regenerate IPv4 cksum */
+			m->l3_len = sizeof(struct rte_ipv4_hdr);
+			m->ol_flags |= (PKT_TX_IPV4 | PKT_TX_IP_CKSUM);
+			ip_version = 4;
+		} else if (RTE_ETH_IS_IPV6_HDR(m->packet_type)) {
+			ip6_hdr = (struct rte_ipv6_hdr *)(eth_hdr + 1);
+			if (rte_lpm6_lookup(rxq->lpm6, ip6_hdr->dst_addr,
+					&next_hop) == 0 &&
+					(enabled_port_mask & 1 << next_hop))
+				port_out = next_hop;
+			ip_version = 6;
+		}
+
+		/* 02:00:00:00:00:xx */
+		d_addr_bytes = &eth_hdr->d_addr.addr_bytes[0];
+		*((uint64_t *)d_addr_bytes) = 0x000000000002 +
+			((uint64_t)port_out << 40);
+
+		/* src addr */
+		rte_ether_addr_copy(&ports_eth_addr[port_out],
+				&eth_hdr->s_addr);
+
+		/* queue the previous packets, going to another port */
+		if (i != start && (port_out != run_port ||
+					ip_version != run_version)) {
+			l3fwd_burst_queue(&pkts[start], i - start, qconf, rxq,
+				run_port, run_version);
+			start = i;
+		}
+		run_port = port_out;
+		run_version = ip_version;
+	}
+
+	if (start != nb_pkts)
+		l3fwd_burst_queue(&pkts[start], nb_pkts - start, qconf, rxq,
+			run_port, run_version);
+}
+
 /* main processing loop */
 static int
 main_loop(__attribute__((unused)) void *dummy)
 {
 	struct rte_mbuf *pkts_burst[MAX_PKT_BURST];
 	unsigned lcore_id;
-	uint64_t prev_tsc, diff_tsc, cur_tsc;
-	int i, j, nb_rx;
+	uint64_t prev_tsc, diff_tsc, cur_tsc, begin_tsc, prev_stats_tsc;
+	int i, nb_rx;
 	uint16_t portid;
 	struct lcore_queue_conf *qconf;
 	const uint64_t drain_tsc = (rte_get_tsc_hz() + US_PER_S - 1) / US_PER_S * BURST_TX_DRAIN_US;
+	const uint64_t stats_tsc = rte_get_tsc_hz() * STATS_PERIOD_S;
 
 	prev_tsc = 0;
+	prev_stats_tsc = rte_rdtsc();
 
 	lcore_id = rte_lcore_id();
 	qconf = &lcore_queue_conf[lcore_id];
@@ -437,6 +606,23 @@ main_loop(__attribute__((unused)) void *dummy)
 			prev_tsc = cur_tsc;
 		}
 
+		/*
+		 * Display statistics
+		 */
+		if (unlikely(stats_enabled &&
+				cur_tsc - prev_stats_tsc > stats_tsc)) {
+			RTE_LOG(INFO, IP_FRAG, "lcore %u: %"PRIu64
+				" packets received, %"PRIu64" sent, %"PRIu64
+				" cycles per received packet\n",
+				lcore_id, qconf->fwd_pkts, qconf->tx_pkts,
+				qconf->fwd_pkts != 0 ?
+				qconf->fwd_cycles / qconf->fwd_pkts : 0);
+			qconf->fwd_cycles = 0;
+			qconf->fwd_pkts = 0;
+			qconf->tx_pkts = 0;
+			prev_stats_tsc = cur_tsc;
+		}
+
 		/*
 		 * Read packet from RX queues
 		 */
@@ -445,23 +631,20 @@ main_loop(__attribute__((unused)) void *dummy)
 			portid = qconf->rx_queue_list[i].portid;
 			nb_rx = rte_eth_rx_burst(portid, 0, pkts_burst,
 						 MAX_PKT_BURST);
-
-			/* Prefetch first packets */
-			for (j = 0; j < PREFETCH_OFFSET && j < nb_rx; j++) {
-				rte_prefetch0(rte_pktmbuf_mtod(
-						pkts_burst[j], void *));
-			}
-
-			/* Prefetch and forward already prefetched packets */
-			for (j = 0; j < (nb_rx - PREFETCH_OFFSET); j++) {
-				rte_prefetch0(rte_pktmbuf_mtod(pkts_burst[
-						j + PREFETCH_OFFSET], void *));
-				l3fwd_simple_forward(pkts_burst[j], qconf, i, portid);
-			}
-
-			/* Forward remaining prefetched packets */
-			for (; j < nb_rx; j++) {
-				l3fwd_simple_forward(pkts_burst[j], qconf, i, portid);
+			if (nb_rx == 0)
+				continue;
+			begin_tsc = stats_enabled ? rte_rdtsc() : 0;
+
+			if (burst_mode)
+				l3fwd_burst_forward(pkts_burst, nb_rx, qconf,
+					i, portid);
+			else
+				l3fwd_simple_forward_burst(pkts_burst, nb_rx,
+					qconf, i, portid);
+
+			if (stats_enabled) {
+				qconf->fwd_cycles += rte_rdtsc() - begin_tsc;
+				qconf->fwd_pkts += nb_rx;
 			}
 		}
 	}
@@ -471,10 +654,12 @@ main_loop(__attribute__((unused)) void *dummy)
 static void
 print_usage(const char *prgname)
 {
-	printf("%s [EAL options] -- -p PORTMASK [-q NQ]\n"
+	printf("%s [EAL options] -- -p PORTMASK [-q NQ] [--burst] [--stats]\n"
 	       "  -p PORTMASK: hexadecimal bitmask of ports to configure\n"
-	       "  -q NQ: number of queue (=ports) per lcore (default is 1)\n",
-	       prgname);
+	       "  -q NQ: number of queue (=ports) per lcore (default is 1)\n"
+	       "  --burst: fragment the packets by bursts\n"
+	       "  --stats: display the forwarding cycles every %u seconds\n",
+	       prgname, STATS_PERIOD_S);
 }
 
 static int
@@ -521,6 +706,8 @@ parse_args(int argc, char **argv)
 	int option_index;
 	char *prgname = argv[0];
 	static struct option lgopts[] = {
+		{"burst", 0, &burst_mode, 1},
+		{"stats", 0, &stats_enabled, 1},
 		{NULL, 0, 0, 0}
 	};
 
@@ -552,8 +739,7 @@ parse_args(int argc, char **argv)
 
 		/* long options */
 		case 0:
-			print_usage(prgname);
-			return -1;
+			break;
 
 		default:
 			print_usage(prgname);
@@ -136,10 +136,6 @@ enum {
 	RTE_ACL_UNUSED_TRIE = 0x80000000
 };
 
-
-/** MAX number of tries per one ACL context.*/
-#define RTE_ACL_MAX_TRIES	8
-
 /** Max number of characters in PM name.*/
 #define RTE_ACL_NAMESIZE	32
 
@@ -162,6 +158,7 @@ struct rte_acl_ctx {
 	int32_t             socket_id;
 	/** Socket ID to allocate memory from. */
 	enum rte_acl_classify_alg alg;
+	struct rte_acl_build_param bld_param; /* build parameters. */
 	void               *rules;
 	uint32_t            max_rules;
 	uint32_t            rule_sz;
@@ -177,6 +174,7 @@ struct rte_acl_ctx {
 	void               *mem;
 	size_t              mem_sz;
 	struct rte_acl_config config; /* copy of build config. */
+	struct rte_acl_build_stats stats; /* last build statistics. */
 };
 
 int rte_acl_gen(struct rte_acl_ctx *ctx, struct rte_acl_trie *trie,
@@ -201,6 +199,10 @@ int
 rte_acl_classify_avx2(const struct rte_acl_ctx *ctx, const uint8_t **data,
 	uint32_t *results, uint32_t num, uint32_t categories);
 
+int
+rte_acl_classify_avx512(const struct rte_acl_ctx *ctx, const uint8_t **data,
+	uint32_t *results, uint32_t num, uint32_t categories);
+
 int
 rte_acl_classify_neon(const struct rte_acl_ctx *ctx, const uint8_t **data,
 	uint32_t *results, uint32_t num, uint32_t categories);
@@ -13,8 +13,6 @@
 #define ACL_PTR_ALLOC	32
 
 /* macros for dividing rule sets heuristics */
-#define NODE_MAX	0x4000
-#define NODE_MIN	0x800
 
 /* TALLY are statistics per field */
 enum {
@@ -69,6 +67,8 @@ struct acl_build_context {
 	struct rte_acl_config     cfg;
 	int32_t                   node_max;
 	int32_t                   cur_node_max;
+	uint32_t                  max_tries;
+	uint32_t                  wild_limit;
 	uint32_t                  node;
 	uint32_t                  num_nodes;
 	uint32_t                  category_mask;
@@ -1271,17 +1271,66 @@ build_one_trie(struct acl_build_context *context,
 	return last;
 }
 
+/*
+ * Move the rules that are, on average over their fields, at least
+ * wild_limit percent wild to a separate list, with their own copy of the
+ * config. Returns the list of the other rules.
+ */
+static struct rte_acl_build_rule *
+acl_split_wild(struct acl_build_context *context,
+	struct rte_acl_build_rule *head, struct rte_acl_build_rule **wild)
+{
+	uint32_t n, sum;
+	struct rte_acl_config *config;
+	struct rte_acl_build_rule *next, *rule, *rest;
+
+	config = head->config;
+	rest = NULL;
+	*wild = NULL;
+
+	for (rule = head; rule != NULL; rule = next) {
+		next = rule->next;
+
+		sum = 0;
+		for (n = 0; n < config->num_fields; n++)
+			sum += rule->wildness[config->defs[n].field_index];
+
+		if (sum >= context->wild_limit * config->num_fields) {
+			rule->next = *wild;
+			*wild = rule;
+		} else {
+			rule->next = rest;
+			rest = rule;
+		}
+	}
+
+	/* nothing to split */
+	if (rest == NULL || *wild == NULL) {
+		if (rest == NULL)
+			rest = *wild;
+		*wild = NULL;
+		return rest;
+	}
+
+	config = acl_build_alloc(context, 1, sizeof(*config));
+	memcpy(config, head->config, sizeof(*config));
+	for (rule = *wild; rule != NULL; rule = rule->next)
+		rule->config = config;
+
+	return rest;
+}
+
 static int
 acl_build_tries(struct acl_build_context *context,
 	struct rte_acl_build_rule *head)
 {
 	uint32_t n, num_tries;
-	struct rte_acl_config *config;
-	struct rte_acl_build_rule *last;
+	int32_t node_max;
+	struct rte_acl_config *config, *wild_config;
+	struct rte_acl_build_rule *last, *wild;
 	struct rte_acl_build_rule *rule_sets[RTE_ACL_MAX_TRIES];
 
 	config = head->config;
-	rule_sets[0] = head;
 
 	/* initialize tries */
 	for (n = 0; n < RTE_DIM(context->tries); n++) {
@@ -1295,25 +1344,58 @@ acl_build_tries(struct acl_build_context *context,
 	/* calc wildness of each field of each rule */
 	acl_calc_wildness(head, config);
 
+	/* the wild rules go into their own tries, after the other ones */
+	wild = NULL;
+	wild_config = NULL;
+	if (context->wild_limit != 0 && context->max_tries > 1) {
+		head = acl_split_wild(context, head, &wild);
+		if (wild != NULL) {
+			/* unchanged config, for the last trie. */
+			wild_config = acl_build_alloc(context, 1,
+				sizeof(*wild_config));
+			memcpy(wild_config, wild->config,
+				sizeof(*wild_config));
+		}
+	}
+
+	rule_sets[0] = head;
+
 	for (n = 0;; n = num_tries) {
 
 		num_tries = n + 1;
 
-		last = build_one_trie(context, rule_sets, n, context->node_max);
+		/*
+		 * The last trie takes all the remaining rules,
+		 * including the wild ones not built yet.
+		 */
+		node_max = context->node_max;
+		if (num_tries == context->max_tries) {
+			node_max = INT32_MAX;
+			if (wild != NULL) {
+				for (last = rule_sets[n]; last->next != NULL;
+						last = last->next)
+					;
+				last->next = wild;
+				for (last = rule_sets[n]; last != NULL;
+						last = last->next)
+					last->config = wild_config;
+				wild = NULL;
+			}
+		}
+
+		last = build_one_trie(context, rule_sets, n, node_max);
 		if (context->bld_tries[n].trie == NULL) {
 			RTE_LOG(ERR, ACL, "Build of %u-th trie failed\n", n);
 			return -ENOMEM;
 		}
 
-		/* Build of the last trie completed. */
-		if (last == NULL)
-			break;
-
-		if (num_tries == RTE_DIM(context->tries)) {
-			RTE_LOG(ERR, ACL,
-				"Exceeded max number of tries: %u\n",
-				num_tries);
-			return -ENOMEM;
+		/* Build of the trie completed, go on with the wild rules. */
+		if (last == NULL) {
+			if (wild == NULL)
+				break;
+			rule_sets[num_tries] = wild;
+			wild = NULL;
+			continue;
 		}
 
 		/* Trie is getting too big, split remaining rule set. */
@@ -1353,10 +1435,14 @@ acl_build_log(const struct acl_build_context *ctx)
 
 	RTE_LOG(DEBUG, ACL, "Build phase for ACL \"%s\":\n"
 		"node limit for tree split: %u\n"
+		"max number of tries: %u\n"
+		"wildness limit: %u\n"
 		"nodes created: %u\n"
 		"memory consumed: %zu\n",
 		ctx->acx->name,
 		ctx->node_max,
+		ctx->max_tries,
+		ctx->wild_limit,
 		ctx->num_nodes,
 		ctx->pool.alloc);
 
@@ -1427,6 +1513,32 @@ acl_set_data_indexes(struct rte_acl_ctx *ctx)
 	}
 }
 
+/*
+ * Fill the build statistics, rte_acl_gen() already set the run-time ones.
+ */
+static void
+acl_set_build_stats(struct rte_acl_ctx *ctx,
+	const struct acl_build_context *bcx)
+{
+	uint32_t i;
+	struct rte_acl_build_stats *st;
+
+	st = &ctx->stats;
+	st->num_tries = bcx->num_tries;
+	st->node_limit = bcx->node_max;
+	st->num_nodes = bcx->num_nodes;
+	st->build_mem = bcx->pool.alloc;
+	st->rt_mem = ctx->mem_sz;
+
+	/* the first input byte, then 4 bytes for each other data index. */
+	st->classify_cost = 0;
+	for (i = 0; i != bcx->num_tries; i++) {
+		st->trie_rules[i] = bcx->tries[i].count;
+		st->classify_cost += 1 + RTE_ACL_QUAD_SIZE *
+			(bcx->tries[i].num_data_indexes - 1);
+	}
+}
+
 /*
  * Internal routine, performs 'build' phase of trie generation:
  * - setups build context.
@@ -1448,6 +1560,8 @@ acl_bld(struct acl_build_context *bcx, struct rte_acl_ctx *ctx,
 	bcx->category_mask = RTE_LEN2MASK(bcx->cfg.num_categories,
 		typeof(bcx->category_mask));
 	bcx->node_max = node_max;
+	bcx->max_tries = ctx->bld_param.max_tries;
+	bcx->wild_limit = ctx->bld_param.wild_limit;
 
 	rc = sigsetjmp(bcx->pool.fail, 0);
 
@@ -1532,14 +1646,15 @@ rte_acl_build(struct rte_acl_ctx *ctx, const struct rte_acl_config *cfg)
 	acl_build_reset(ctx);
 
 	if (cfg->max_size == 0) {
-		n = NODE_MIN;
+		n = ctx->bld_param.node_min;
 		max_size = SIZE_MAX;
 	} else {
-		n = NODE_MAX;
+		n = ctx->bld_param.node_max;
 		max_size = cfg->max_size;
 	}
 
-	for (rc = -ERANGE; n >= NODE_MIN && rc == -ERANGE; n /= 2) {
+	for (rc = -ERANGE; n >= ctx->bld_param.node_min && rc == -ERANGE;
+			n /= 2) {
 
 		/* perform build phase. */
 		rc = acl_bld(&bcx, ctx, cfg, n);
@@ -1556,6 +1671,8 @@ rte_acl_build(struct rte_acl_ctx *ctx, const struct rte_acl_config *cfg)
 
 				/* copy in build config. */
 				ctx->config = *cfg;
+
+				acl_set_build_stats(ctx, &bcx);
 			}
 		}
 
@@ -527,6 +527,11 @@ rte_acl_gen(struct rte_acl_ctx *ctx, struct rte_acl_trie *trie,
 	ctx->trans_table = node_array;
 	memcpy(ctx->trie, trie, sizeof(ctx->trie));
 
+	ctx->stats.num_dfa = counts.dfa;
+	ctx->stats.num_quad = counts.quad;
+	ctx->stats.num_single = counts.single;
+	ctx->stats.num_match = counts.match;
+
 	acl_gen_log_stats(ctx, &counts, &indices, max_size);
 	return 0;
 }
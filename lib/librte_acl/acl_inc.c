@@ -0,0 +1,402 @@
+/* SPDX-License-Identifier: BSD-3-Clause
+ * Copyright(c) 2020 Intel Corporation
+ */
+
+#include <string.h>
+
+#include <rte_errno.h>
+#include <rte_malloc.h>
+#include <rte_spinlock.h>
+#include <rte_string_fns.h>
+#include <rte_rcu_qsbr.h>
+#include <rte_acl.h>
+
+#include "acl.h"
+
+/*
+ * Incremental ACL context.
+ * All the rules are kept in one table, in the order they were added.
+ * The main ACL context is built from the first num_main rules of the
+ * table, the delta one from the following rules. Both are built with
+ * the rule index + 1 as user data, so their matches can be compared by
+ * priority and then translated into the user data of the rules.
+ * Rules are only appended to the table, the entries seen by a
+ * classification never change.
+ */
+
+#define	ACL_INC_BURST	64
+
+/* main and delta contexts in use, replaced as a whole on each update. */
+struct acl_inc_gen {
+	struct rte_acl_ctx *main_acx;
+	struct rte_acl_ctx *delta_acx;
+	uint32_t num_main;  /* rules in the main context. */
+	uint32_t num_rules; /* rules in the main and delta contexts. */
+};
+
+struct acl_inc_rule {
+	uint32_t userdata;
+	int32_t priority;
+};
+
+struct rte_acl_inc_ctx {
+	char name[RTE_ACL_INC_NAMESIZE];
+	int socket_id;
+	uint32_t rule_sz;
+	uint32_t max_rules;
+	uint32_t max_delta;
+	struct rte_acl_config cfg;
+	struct acl_inc_gen *gen;     /* current generation. */
+	rte_spinlock_t lock;         /* serializes generation updates. */
+	rte_spinlock_t merge_lock;   /* held by the running merge. */
+	struct rte_rcu_qsbr *v;      /* RCU QSBR variable. */
+	uint32_t num_rules;          /* rules in the table. */
+	struct acl_inc_rule *info;   /* user data and priority of each rule. */
+	uint8_t *rules;              /* table of rules. */
+};
+
+/* ACL context names have to be unique. */
+static uint32_t acl_inc_seq;
+
+static struct rte_acl_ctx *
+acl_inc_build(const struct rte_acl_inc_ctx *ctx, char type, uint32_t first,
+	uint32_t num, int *rc)
+{
+	struct rte_acl_ctx *acx;
+	struct rte_acl_param prm;
+	char name[RTE_ACL_NAMESIZE];
+
+	snprintf(name, sizeof(name), "%s%c%x", ctx->name, type,
+		__atomic_fetch_add(&acl_inc_seq, 1, __ATOMIC_RELAXED));
+
+	prm.name = name;
+	prm.socket_id = ctx->socket_id;
+	prm.rule_size = ctx->rule_sz;
+	prm.max_rule_num = num;
+
+	acx = rte_acl_create(&prm);
+	if (acx == NULL) {
+		*rc = -rte_errno;
+		return NULL;
+	}
+
+	*rc = rte_acl_add_rules(acx, (const struct rte_acl_rule *)
+		(ctx->rules + (size_t)first * ctx->rule_sz), num);
+	if (*rc == 0)
+		*rc = rte_acl_build(acx, &ctx->cfg);
+	if (*rc != 0) {
+		RTE_LOG(ERR, ACL, "%s(%s): build of %u rules failed: %d\n",
+			__func__, name, num, *rc);
+		rte_acl_free(acx);
+		return NULL;
+	}
+
+	return acx;
+}
+
+/*
+ * Publish a new generation, then free what it replaces, once no
+ * classification can use it anymore.
+ * Called with the update lock held.
+ */
+static int
+acl_inc_publish(struct rte_acl_inc_ctx *ctx, struct rte_acl_ctx *main_acx,
+	struct rte_acl_ctx *delta_acx, uint32_t num_main, uint32_t num_rules)
+{
+	struct acl_inc_gen *gen, *old;
+
+	gen = rte_zmalloc_socket(ctx->name, sizeof(*gen), RTE_CACHE_LINE_SIZE,
+		ctx->socket_id);
+	if (gen == NULL)
+		return -ENOMEM;
+
+	gen->main_acx = main_acx;
+	gen->delta_acx = delta_acx;
+	gen->num_main = num_main;
+	gen->num_rules = num_rules;
+
+	old = ctx->gen;
+	__atomic_store_n(&ctx->gen, gen, __ATOMIC_RELEASE);
+
+	if (ctx->v != NULL)
+		rte_rcu_qsbr_synchronize(ctx->v, RTE_QSBR_THRID_INVALID);
+
+	if (old->main_acx != main_acx)
+		rte_acl_free(old->main_acx);
+	if (old->delta_acx != delta_acx)
+		rte_acl_free(old->delta_acx);
+	rte_free(old);
+
+	return 0;
+}
+
+struct rte_acl_inc_ctx *
+rte_acl_inc_create(const struct rte_acl_inc_param *param,
+	const struct rte_acl_config *cfg)
+{
+	struct rte_acl_inc_ctx *ctx;
+
+	if (param == NULL || param->name == NULL || cfg == NULL ||
+			strnlen(param->name, RTE_ACL_INC_NAMESIZE) ==
+			RTE_ACL_INC_NAMESIZE ||
+			param->rule_size < sizeof(struct rte_acl_rule) ||
+			param->max_rule_num == 0 ||
+			param->max_delta_rule_num == 0 ||
+			cfg->num_categories == 0 ||
+			cfg->num_categories > RTE_ACL_MAX_CATEGORIES) {
+		rte_errno = EINVAL;
+		return NULL;
+	}
+
+	ctx = rte_zmalloc_socket(param->name, sizeof(*ctx),
+		RTE_CACHE_LINE_SIZE, param->socket_id);
+	if (ctx == NULL)
+		goto nomem;
+
+	ctx->rules = rte_malloc_socket(param->name,
+		(size_t)param->max_rule_num * param->rule_size,
+		RTE_CACHE_LINE_SIZE, param->socket_id);
+	ctx->info = rte_malloc_socket(param->name,
+		(size_t)param->max_rule_num * sizeof(ctx->info[0]),
+		RTE_CACHE_LINE_SIZE, param->socket_id);
+	ctx->gen = rte_zmalloc_socket(param->name, sizeof(*ctx->gen),
+		RTE_CACHE_LINE_SIZE, param->socket_id);
+	if (ctx->rules == NULL || ctx->info == NULL || ctx->gen == NULL)
+		goto nomem;
+
+	strlcpy(ctx->name, param->name, sizeof(ctx->name));
+	ctx->socket_id = param->socket_id;
+	ctx->rule_sz = param->rule_size;
+	ctx->max_rules = param->max_rule_num;
+	ctx->max_delta = param->max_delta_rule_num;
+	ctx->cfg = *cfg;
+	rte_spinlock_init(&ctx->lock);
+	rte_spinlock_init(&ctx->merge_lock);
+
+	return ctx;
+
+nomem:
+	RTE_LOG(ERR, ACL, "%s(%s): allocation failed\n", __func__,
+		param->name);
+	rte_acl_inc_free(ctx);
+	rte_errno = ENOMEM;
+	return NULL;
+}
+
+void
+rte_acl_inc_free(struct rte_acl_inc_ctx *ctx)
+{
+	if (ctx == NULL)
+		return;
+
+	if (ctx->gen != NULL) {
+		rte_acl_free(ctx->gen->main_acx);
+		rte_acl_free(ctx->gen->delta_acx);
+		rte_free(ctx->gen);
+	}
+	rte_free(ctx->info);
+	rte_free(ctx->rules);
+	rte_free(ctx);
+}
+
+int
+rte_acl_inc_rcu_qsbr_add(struct rte_acl_inc_ctx *ctx, struct rte_rcu_qsbr *v)
+{
+	if (ctx == NULL || v == NULL)
+		return -EINVAL;
+
+	if (ctx->v != NULL)
+		return -EEXIST;
+
+	ctx->v = v;
+	return 0;
+}
+
+int
+rte_acl_inc_add_rules(struct rte_acl_inc_ctx *ctx,
+	const struct rte_acl_rule *rules, uint32_t num)
+{
+	struct rte_acl_rule *rule;
+	struct rte_acl_ctx *delta_acx;
+	struct acl_inc_gen *gen;
+	uint32_t i, idx;
+	int rc;
+
+	if (ctx == NULL || rules == NULL)
+		return -EINVAL;
+
+	if (num == 0)
+		return 0;
+
+	rte_spinlock_lock(&ctx->lock);
+
+	gen = ctx->gen;
+	if (num > ctx->max_rules - ctx->num_rules) {
+		rc = -ENOMEM;
+		goto exit;
+	}
+	if (ctx->num_rules - gen->num_main + num > ctx->max_delta) {
+		rc = -ENOSPC;
+		goto exit;
+	}
+
+	/*
+	 * Fill the table past the rules in use, it only becomes visible
+	 * to classification with the new generation.
+	 */
+	for (i = 0; i != num; i++) {
+		idx = ctx->num_rules + i;
+		rule = (struct rte_acl_rule *)(ctx->rules +
+			(size_t)idx * ctx->rule_sz);
+		memcpy(rule, (const uint8_t *)rules + (size_t)i * ctx->rule_sz,
+			ctx->rule_sz);
+		if (rule->data.userdata == 0) {
+			RTE_LOG(ERR, ACL, "%s(%s): rule #%u is invalid\n",
+				__func__, ctx->name, i + 1);
+			rc = -EINVAL;
+			goto exit;
+		}
+		ctx->info[idx].userdata = rule->data.userdata;
+		ctx->info[idx].priority = rule->data.priority;
+		rule->data.userdata = idx + 1;
+	}
+
+	delta_acx = acl_inc_build(ctx, 'd', gen->num_main,
+		ctx->num_rules + num - gen->num_main, &rc);
+	if (delta_acx == NULL)
+		goto exit;
+
+	rc = acl_inc_publish(ctx, gen->main_acx, delta_acx, gen->num_main,
+		ctx->num_rules + num);
+	if (rc != 0) {
+		rte_acl_free(delta_acx);
+		goto exit;
+	}
+	ctx->num_rules += num;
+
+exit:
+	rte_spinlock_unlock(&ctx->lock);
+	return rc;
+}
+
+int
+rte_acl_inc_merge(struct rte_acl_inc_ctx *ctx)
+{
+	struct rte_acl_ctx *main_acx, *delta_acx;
+	uint32_t num;
+	int rc;
+
+	if (ctx == NULL)
+		return -EINVAL;
+
+	if (rte_spinlock_trylock(&ctx->merge_lock) == 0)
+		return -EBUSY;
+
+	rte_spinlock_lock(&ctx->lock);
+	num = ctx->num_rules;
+	rc = (num == ctx->gen->num_main);
+	rte_spinlock_unlock(&ctx->lock);
+
+	/* nothing to merge. */
+	if (rc != 0) {
+		rte_spinlock_unlock(&ctx->merge_lock);
+		return 0;
+	}
+
+	/* the first num rules of the table don't change during the build. */
+	main_acx = acl_inc_build(ctx, 'm', 0, num, &rc);
+	if (main_acx == NULL) {
+		rte_spinlock_unlock(&ctx->merge_lock);
+		return rc;
+	}
+
+	rte_spinlock_lock(&ctx->lock);
+
+	/* rules added during the build go into a new delta. */
+	delta_acx = NULL;
+	if (ctx->num_rules != num)
+		delta_acx = acl_inc_build(ctx, 'd', num, ctx->num_rules - num,
+			&rc);
+
+	if (rc == 0)
+		rc = acl_inc_publish(ctx, main_acx, delta_acx, num,
+			ctx->num_rules);
+	if (rc != 0) {
+		rte_acl_free(main_acx);
+		rte_acl_free(delta_acx);
+	}
+
+	rte_spinlock_unlock(&ctx->lock);
+	rte_spinlock_unlock(&ctx->merge_lock);
+	return rc;
+}
+
+/* translate the matches of the main context into user data. */
+static inline void
+acl_inc_resolve_main(const struct acl_inc_rule *info, uint32_t *res,
+	uint32_t num)
+{
+	uint32_t i;
+
+	for (i = 0; i != num; i++) {
+		if (res[i] != 0)
+			res[i] = info[res[i] - 1].userdata;
+	}
+}
+
+/*
+ * Keep the match with the highest priority of the main and delta contexts,
+ * translated into user data.
+ */
+static inline void
+acl_inc_resolve(const struct acl_inc_rule *info, uint32_t *res,
+	const uint32_t *dres, uint32_t num)
+{
+	uint32_t i, m, d;
+
+	for (i = 0; i != num; i++) {
+		m = res[i];
+		d = dres[i];
+		if (d != 0 && (m == 0 ||
+				info[d - 1].priority > info[m - 1].priority))
+			m = d;
+		res[i] = (m != 0) ? info[m - 1].userdata : 0;
+	}
+}
+
+int
+rte_acl_inc_classify(const struct rte_acl_inc_ctx *ctx, const uint8_t **data,
+	uint32_t *results, uint32_t num, uint32_t categories)
+{
+	uint32_t dres[ACL_INC_BURST * RTE_ACL_MAX_CATEGORIES];
+	const struct acl_inc_gen *gen;
+	uint32_t i, n, *res;
+
+	if (ctx == NULL || categories == 0 ||
+			categories > ctx->cfg.num_categories ||
+			(categories != 1 &&
+			((RTE_ACL_RESULTS_MULTIPLIER - 1) & categories) != 0))
+		return -EINVAL;
+
+	gen = __atomic_load_n(&ctx->gen, __ATOMIC_ACQUIRE);
+
+	for (i = 0; i < num; i += n) {
+		n = RTE_MIN(num - i, (uint32_t)ACL_INC_BURST);
+		res = results + i * categories;
+
+		if (gen->main_acx != NULL)
+			rte_acl_classify(gen->main_acx, data + i, res, n,
+				categories);
+		else
+			memset(res, 0, n * categories * sizeof(res[0]));
+
+		if (gen->delta_acx != NULL) {
+			rte_acl_classify(gen->delta_acx, data + i, dres, n,
+				categories);
+			acl_inc_resolve(ctx->info, res, dres, n * categories);
+		} else
+			acl_inc_resolve_main(ctx->info, res, n * categories);
+	}
+
+	return 0;
+}
@@ -0,0 +1,319 @@
+/* SPDX-License-Identifier: BSD-3-Clause
+ * Copyright(c) 2020 Intel Corporation
+ */
+
+#include "acl_run_sse.h"
+
+static const rte_zmm_t zmm_match_mask = {
+	.u32 = {
+		RTE_ACL_NODE_MATCH, RTE_ACL_NODE_MATCH,
+		RTE_ACL_NODE_MATCH, RTE_ACL_NODE_MATCH,
+		RTE_ACL_NODE_MATCH, RTE_ACL_NODE_MATCH,
+		RTE_ACL_NODE_MATCH, RTE_ACL_NODE_MATCH,
+		RTE_ACL_NODE_MATCH, RTE_ACL_NODE_MATCH,
+		RTE_ACL_NODE_MATCH, RTE_ACL_NODE_MATCH,
+		RTE_ACL_NODE_MATCH, RTE_ACL_NODE_MATCH,
+		RTE_ACL_NODE_MATCH, RTE_ACL_NODE_MATCH,
+	},
+};
+
+static const rte_zmm_t zmm_index_mask = {
+	.u32 = {
+		RTE_ACL_NODE_INDEX, RTE_ACL_NODE_INDEX,
+		RTE_ACL_NODE_INDEX, RTE_ACL_NODE_INDEX,
+		RTE_ACL_NODE_INDEX, RTE_ACL_NODE_INDEX,
+		RTE_ACL_NODE_INDEX, RTE_ACL_NODE_INDEX,
+		RTE_ACL_NODE_INDEX, RTE_ACL_NODE_INDEX,
+		RTE_ACL_NODE_INDEX, RTE_ACL_NODE_INDEX,
+		RTE_ACL_NODE_INDEX, RTE_ACL_NODE_INDEX,
+		RTE_ACL_NODE_INDEX, RTE_ACL_NODE_INDEX,
+	},
+};
+
+static const rte_zmm_t zmm_shuffle_input = {
+	.u32 = {
+		0x00000000, 0x04040404, 0x08080808, 0x0c0c0c0c,
+		0x00000000, 0x04040404, 0x08080808, 0x0c0c0c0c,
+		0x00000000, 0x04040404, 0x08080808, 0x0c0c0c0c,
+		0x00000000, 0x04040404, 0x08080808, 0x0c0c0c0c,
+	},
+};
+
+static const rte_zmm_t zmm_ones_16 = {
+	.u16 = {
+		1, 1, 1, 1, 1, 1, 1, 1,
+		1, 1, 1, 1, 1, 1, 1, 1,
+		1, 1, 1, 1, 1, 1, 1, 1,
+		1, 1, 1, 1, 1, 1, 1, 1,
+	},
+};
+
+static const rte_zmm_t zmm_range_base = {
+	.u32 = {
+		0xffffff00, 0xffffff04, 0xffffff08, 0xffffff0c,
+		0xffffff00, 0xffffff04, 0xffffff08, 0xffffff0c,
+		0xffffff00, 0xffffff04, 0xffffff08, 0xffffff0c,
+		0xffffff00, 0xffffff04, 0xffffff08, 0xffffff0c,
+	},
+};
+
+/* Indexes of the low and high 32 bits of 16 transitions in 2 ZMM registers */
+static const rte_zmm_t zmm_pmidx_lo = {
+	.u32 = {
+		0, 2, 4, 6, 8, 10, 12, 14,
+		16, 18, 20, 22, 24, 26, 28, 30,
+	},
+};
+
+static const rte_zmm_t zmm_pmidx_hi = {
+	.u32 = {
+		1, 3, 5, 7, 9, 11, 13, 15,
+		17, 19, 21, 23, 25, 27, 29, 31,
+	},
+};
+
+/*
+ * Calculate the address of the next transition for 16 flows,
+ * same as ACL_TR_CALC_ADDR(), but AVX512 comparisons give masks:
+ * for quad range nodes the boundaries less than the input byte are
+ * counted from the comparison mask, and DFA offsets are blended in
+ * with a mask move.
+ */
+static __rte_always_inline zmm_t
+calc_addr_avx512x16(zmm_t index_mask, zmm_t next_input, zmm_t shuffle_input,
+	zmm_t ones_16, zmm_t range_base, zmm_t tr_lo, zmm_t tr_hi)
+{
+	__mmask64 qm;
+	__mmask16 dfa_msk;
+	zmm_t addr, in, node_type, r, t;
+	zmm_t dfa_ofs, quad_ofs;
+
+	in = _mm512_shuffle_epi8(next_input, shuffle_input);
+
+	/* Calc node type and node addr */
+	node_type = _mm512_andnot_si512(index_mask, tr_lo);
+	addr = _mm512_and_si512(index_mask, tr_lo);
+
+	/* mask for DFA type(0) nodes */
+	dfa_msk = _mm512_cmpeq_epi32_mask(node_type, _mm512_setzero_si512());
+
+	/* DFA calculations. */
+	r = _mm512_srli_epi32(in, 30);
+	r = _mm512_add_epi8(r, range_base);
+	t = _mm512_srli_epi32(in, 24);
+	r = _mm512_shuffle_epi8(tr_hi, r);
+
+	dfa_ofs = _mm512_sub_epi32(t, r);
+
+	/* QUAD/SINGLE calculations. */
+	qm = _mm512_cmpgt_epi8_mask(in, tr_hi);
+	t = _mm512_maskz_set1_epi8(qm, 1);
+	t = _mm512_maddubs_epi16(t, t);
+	quad_ofs = _mm512_madd_epi16(t, ones_16);
+
+	/* blend DFA and QUAD/SINGLE. */
+	t = _mm512_mask_mov_epi32(quad_ofs, dfa_msk, dfa_ofs);
+
+	/* calculate address for next transitions. */
+	return _mm512_add_epi32(addr, t);
+}
+
+/*
+ * Process 16 transitions in parallel.
+ * tr_lo contains low 32 bits for 16 transitions.
+ * tr_hi contains high 32 bits for 16 transitions.
+ * next_input contains up to 4 input bytes for 16 flows.
+ */
+static __rte_always_inline zmm_t
+transition16(zmm_t next_input, const uint64_t *trans, zmm_t *tr_lo,
+	zmm_t *tr_hi)
+{
+	const int32_t *tr;
+	zmm_t addr;
+
+	tr = (const int32_t *)(uintptr_t)trans;
+
+	/* Calculate the address (array index) for all 16 transitions. */
+	addr = calc_addr_avx512x16(zmm_index_mask.z, next_input,
+		zmm_shuffle_input.z, zmm_ones_16.z, zmm_range_base.z,
+		*tr_lo, *tr_hi);
+
+	/* load lower 32 bits of 16 transactions at once. */
+	*tr_lo = _mm512_i32gather_epi32(addr, tr, sizeof(trans[0]));
+
+	next_input = _mm512_srli_epi32(next_input, CHAR_BIT);
+
+	/* load high 32 bits of 16 transactions at once. */
+	*tr_hi = _mm512_i32gather_epi32(addr, tr + 1, sizeof(trans[0]));
+
+	return next_input;
+}
+
+/*
+ * Check for matches in 16 flows, complete the matched traversals and
+ * start the next tries in their slots.
+ * Low 32 bits of a transition are enough to process the match.
+ */
+static inline void
+acl_match_check_avx512x16(const struct rte_acl_ctx *ctx, struct parms *parms,
+	struct acl_flow_data *flows, uint32_t slot,
+	zmm_t *tr_lo, zmm_t *tr_hi, zmm_t match_mask)
+{
+	uint32_t i, msk, n;
+	uint64_t tr;
+	rte_zmm_t lo, hi;
+
+	msk = _mm512_test_epi32_mask(*tr_lo, match_mask);
+
+	while (msk != 0) {
+
+		lo.z = *tr_lo;
+		hi.z = *tr_hi;
+
+		for (n = msk; n != 0; n &= n - 1) {
+			i = rte_bsf32(n);
+			tr = acl_match_check(lo.u32[i], slot + i,
+				ctx, parms, flows, resolve_priority_sse);
+			lo.u32[i] = tr;
+			hi.u32[i] = tr >> 32;
+		}
+
+		*tr_lo = lo.z;
+		*tr_hi = hi.z;
+		msk = _mm512_test_epi32_mask(*tr_lo, match_mask);
+	}
+}
+
+/*
+ * Execute trie traversal for up to 16 flows in parallel.
+ */
+static inline int
+search_avx512x16(const struct rte_acl_ctx *ctx, const uint8_t **data,
+	uint32_t *results, uint32_t total_packets, uint32_t categories)
+{
+	uint32_t n;
+	struct acl_flow_data flows;
+	uint64_t index_array[MAX_SEARCHES_AVX16];
+	struct completion cmplt[MAX_SEARCHES_AVX16];
+	struct parms parms[MAX_SEARCHES_AVX16];
+	uint32_t in[MAX_SEARCHES_AVX16];
+	zmm_t input, tr_lo, tr_hi;
+	zmm_t t0, t1;
+
+	acl_set_flow(&flows, cmplt, RTE_DIM(cmplt), data, results,
+		total_packets, categories, ctx->trans_table);
+
+	for (n = 0; n < RTE_DIM(cmplt); n++) {
+		cmplt[n].count = 0;
+		index_array[n] = acl_start_next_trie(&flows, parms, n, ctx);
+	}
+
+	/* put low 32 bits of the transitions into tr_lo, high into tr_hi */
+	t0 = _mm512_loadu_si512(index_array);
+	t1 = _mm512_loadu_si512(index_array + 8);
+	tr_lo = _mm512_permutex2var_epi32(t0, zmm_pmidx_lo.z, t1);
+	tr_hi = _mm512_permutex2var_epi32(t0, zmm_pmidx_hi.z, t1);
+
+	 /* Check for any matches. */
+	acl_match_check_avx512x16(ctx, parms, &flows, 0, &tr_lo, &tr_hi,
+		zmm_match_mask.z);
+
+	while (flows.started > 0) {
+
+		/* Gather 4 bytes of input data for all 16 flows. */
+		for (n = 0; n != RTE_DIM(in); n++)
+			in[n] = GET_NEXT_4BYTES(parms, n);
+		input = _mm512_loadu_si512(in);
+
+		input = transition16(input, flows.trans, &tr_lo, &tr_hi);
+		input = transition16(input, flows.trans, &tr_lo, &tr_hi);
+		input = transition16(input, flows.trans, &tr_lo, &tr_hi);
+		input = transition16(input, flows.trans, &tr_lo, &tr_hi);
+
+		 /* Check for any matches. */
+		acl_match_check_avx512x16(ctx, parms, &flows, 0,
+			&tr_lo, &tr_hi, zmm_match_mask.z);
+	}
+
+	return 0;
+}
+
+/*
+ * Execute trie traversal for up to 32 flows in parallel: two sets
+ * of 16 flows, interleaved to hide the latency of the gathers.
+ */
+static inline int
+search_avx512x16x2(const struct rte_acl_ctx *ctx, const uint8_t **data,
+	uint32_t *results, uint32_t total_packets, uint32_t categories)
+{
+	uint32_t n;
+	struct acl_flow_data flows;
+	uint64_t index_array[MAX_SEARCHES_AVX512X16X2];
+	struct completion cmplt[MAX_SEARCHES_AVX512X16X2];
+	struct parms parms[MAX_SEARCHES_AVX512X16X2];
+	uint32_t in[MAX_SEARCHES_AVX512X16X2];
+	zmm_t input[2], tr_lo[2], tr_hi[2];
+	zmm_t t0, t1;
+
+	acl_set_flow(&flows, cmplt, RTE_DIM(cmplt), data, results,
+		total_packets, categories, ctx->trans_table);
+
+	for (n = 0; n < RTE_DIM(cmplt); n++) {
+		cmplt[n].count = 0;
+		index_array[n] = acl_start_next_trie(&flows, parms, n, ctx);
+	}
+
+	/* put low 32 bits of the transitions into tr_lo, high into tr_hi */
+	t0 = _mm512_loadu_si512(index_array);
+	t1 = _mm512_loadu_si512(index_array + 8);
+	tr_lo[0] = _mm512_permutex2var_epi32(t0, zmm_pmidx_lo.z, t1);
+	tr_hi[0] = _mm512_permutex2var_epi32(t0, zmm_pmidx_hi.z, t1);
+
+	t0 = _mm512_loadu_si512(index_array + 16);
+	t1 = _mm512_loadu_si512(index_array + 24);
+	tr_lo[1] = _mm512_permutex2var_epi32(t0, zmm_pmidx_lo.z, t1);
+	tr_hi[1] = _mm512_permutex2var_epi32(t0, zmm_pmidx_hi.z, t1);
+
+	 /* Check for any matches. */
+	acl_match_check_avx512x16(ctx, parms, &flows, 0, &tr_lo[0], &tr_hi[0],
+		zmm_match_mask.z);
+	acl_match_check_avx512x16(ctx, parms, &flows, 16, &tr_lo[1], &tr_hi[1],
+		zmm_match_mask.z);
+
+	while (flows.started > 0) {
+
+		/* Gather 4 bytes of input data for all 32 flows. */
+		for (n = 0; n != RTE_DIM(in); n++)
+			in[n] = GET_NEXT_4BYTES(parms, n);
+		input[0] = _mm512_loadu_si512(in);
+		input[1] = _mm512_loadu_si512(in + 16);
+
+		input[0] = transition16(input[0], flows.trans,
+			&tr_lo[0], &tr_hi[0]);
+		input[1] = transition16(input[1], flows.trans,
+			&tr_lo[1], &tr_hi[1]);
+
+		input[0] = transition16(input[0], flows.trans,
+			&tr_lo[0], &tr_hi[0]);
+		input[1] = transition16(input[1], flows.trans,
+			&tr_lo[1], &tr_hi[1]);
+
+		input[0] = transition16(input[0], flows.trans,
+			&tr_lo[0], &tr_hi[0]);
+		input[1] = transition16(input[1], flows.trans,
+			&tr_lo[1], &tr_hi[1]);
+
+		input[0] = transition16(input[0], flows.trans,
+			&tr_lo[0], &tr_hi[0]);
+		input[1] = transition16(input[1], flows.trans,
+			&tr_lo[1], &tr_hi[1]);
+
+		 /* Check for any matches. */
+		acl_match_check_avx512x16(ctx, parms, &flows, 0,
+			&tr_lo[0], &tr_hi[0], zmm_match_mask.z);
+		acl_match_check_avx512x16(ctx, parms, &flows, 16,
+			&tr_lo[1], &tr_hi[1], zmm_match_mask.z);
+	}
+
+	return 0;
+}
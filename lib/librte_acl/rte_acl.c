@@ -16,6 +16,22 @@ static struct rte_tailq_elem rte_acl_tailq = {
 };
 EAL_REGISTER_TAILQ(rte_acl_tailq)
 
+#ifndef CC_AVX512_SUPPORT
+/*
+ * If the compiler doesn't support AVX512 instructions,
+ * then the dummy one would be used instead for AVX512 classify method.
+ */
+int
+rte_acl_classify_avx512(__rte_unused const struct rte_acl_ctx *ctx,
+	__rte_unused const uint8_t **data,
+	__rte_unused uint32_t *results,
+	__rte_unused uint32_t num,
+	__rte_unused uint32_t categories)
+{
+	return -ENOTSUP;
+}
+#endif
+
 #ifndef RTE_ARCH_X86
 #ifndef CC_AVX2_SUPPORT
 /*
@@ -77,6 +93,7 @@ static const rte_acl_classify_t classify_fns[] = {
 	[RTE_ACL_CLASSIFY_AVX2] = rte_acl_classify_avx2,
 	[RTE_ACL_CLASSIFY_NEON] = rte_acl_classify_neon,
 	[RTE_ACL_CLASSIFY_ALTIVEC] = rte_acl_classify_altivec,
+	[RTE_ACL_CLASSIFY_AVX512] = rte_acl_classify_avx512,
 };
 
 /* by default, use always available scalar code path. */
@@ -89,44 +106,132 @@ rte_acl_set_default_classify(enum rte_acl_classify_alg alg)
 	rte_acl_default_classify = alg;
 }
 
+/*
+ * Check that a classify method is built in and can run on this CPU.
+ */
+static int
+acl_check_alg(enum rte_acl_classify_alg alg)
+{
+	switch (alg) {
+	case RTE_ACL_CLASSIFY_DEFAULT:
+	case RTE_ACL_CLASSIFY_SCALAR:
+		return 0;
+#if defined(RTE_ARCH_X86)
+	case RTE_ACL_CLASSIFY_SSE:
+		if (rte_cpu_get_flag_enabled(RTE_CPUFLAG_SSE4_1))
+			return 0;
+		break;
+#ifdef CC_AVX2_SUPPORT
+	case RTE_ACL_CLASSIFY_AVX2:
+		if (rte_cpu_get_flag_enabled(RTE_CPUFLAG_AVX2))
+			return 0;
+		break;
+#endif
+#ifdef CC_AVX512_SUPPORT
+	case RTE_ACL_CLASSIFY_AVX512:
+		if (rte_cpu_get_flag_enabled(RTE_CPUFLAG_AVX512F) &&
+				rte_cpu_get_flag_enabled(RTE_CPUFLAG_AVX512BW))
+			return 0;
+		break;
+#endif
+#elif defined(RTE_ARCH_ARM64)
+	case RTE_ACL_CLASSIFY_NEON:
+		return 0;
+#elif defined(RTE_ARCH_ARM)
+	case RTE_ACL_CLASSIFY_NEON:
+		if (rte_cpu_get_flag_enabled(RTE_CPUFLAG_NEON))
+			return 0;
+		break;
+#elif defined(RTE_ARCH_PPC_64)
+	case RTE_ACL_CLASSIFY_ALTIVEC:
+		return 0;
+#endif
+	default:
+		break;
+	}
+
+	return -ENOTSUP;
+}
+
 extern int
 rte_acl_set_ctx_classify(struct rte_acl_ctx *ctx, enum rte_acl_classify_alg alg)
 {
 	if (ctx == NULL || (uint32_t)alg >= RTE_DIM(classify_fns))
 		return -EINVAL;
 
+	if (acl_check_alg(alg) != 0)
+		return -ENOTSUP;
+
 	ctx->alg = alg;
 	return 0;
 }
 
+int
+rte_acl_set_ctx_build_param(struct rte_acl_ctx *ctx,
+	const struct rte_acl_build_param *prm)
+{
+	struct rte_acl_build_param p;
+
+	if (ctx == NULL)
+		return -EINVAL;
+
+	memset(&p, 0, sizeof(p));
+	if (prm != NULL)
+		p = *prm;
+
+	if (p.max_tries == 0)
+		p.max_tries = RTE_ACL_MAX_TRIES;
+	if (p.node_max == 0)
+		p.node_max = RTE_MAX((uint32_t)RTE_ACL_NODE_MAX_DEFAULT,
+			p.node_min);
+	if (p.node_min == 0)
+		p.node_min = RTE_MIN((uint32_t)RTE_ACL_NODE_MIN_DEFAULT,
+			p.node_max);
+
+	if (p.max_tries > RTE_ACL_MAX_TRIES || p.node_min > p.node_max ||
+			p.node_max > INT32_MAX || p.wild_limit > 100)
+		return -EINVAL;
+
+	ctx->bld_param = p;
+	return 0;
+}
+
+int
+rte_acl_get_ctx_build_stats(const struct rte_acl_ctx *ctx,
+	struct rte_acl_build_stats *stats)
+{
+	if (ctx == NULL || stats == NULL)
+		return -EINVAL;
+
+	*stats = ctx->stats;
+	return 0;
+}
+
 /*
  * Select highest available classify method as default one.
- * Note that CLASSIFY_AVX2 should be set as a default only
- * if both conditions are met:
- * at build time compiler supports AVX2 and target cpu supports AVX2.
+ * Note that a vector method is set as a default only if both
+ * the compiler supports it at build time and the target cpu
+ * supports it.
  */
 RTE_INIT(rte_acl_init)
 {
+	static const enum rte_acl_classify_alg algs[] = {
+		RTE_ACL_CLASSIFY_AVX512,
+		RTE_ACL_CLASSIFY_AVX2,
+		RTE_ACL_CLASSIFY_SSE,
+		RTE_ACL_CLASSIFY_NEON,
+		RTE_ACL_CLASSIFY_ALTIVEC,
+	};
 	enum rte_acl_classify_alg alg = RTE_ACL_CLASSIFY_DEFAULT;
+	uint32_t i;
 
-#if defined(RTE_ARCH_ARM64)
-	alg =  RTE_ACL_CLASSIFY_NEON;
-#elif defined(RTE_ARCH_ARM)
-	if (rte_cpu_get_flag_enabled(RTE_CPUFLAG_NEON))
-		alg =  RTE_ACL_CLASSIFY_NEON;
-#elif defined(RTE_ARCH_PPC_64)
-	alg = RTE_ACL_CLASSIFY_ALTIVEC;
-#else
-#ifdef CC_AVX2_SUPPORT
-	if (rte_cpu_get_flag_enabled(RTE_CPUFLAG_AVX2))
-		alg = RTE_ACL_CLASSIFY_AVX2;
-	else if (rte_cpu_get_flag_enabled(RTE_CPUFLAG_SSE4_1))
-#else
-	if (rte_cpu_get_flag_enabled(RTE_CPUFLAG_SSE4_1))
-#endif
-		alg = RTE_ACL_CLASSIFY_SSE;
+	for (i = 0; i != RTE_DIM(algs); i++) {
+		if (acl_check_alg(algs[i]) == 0) {
+			alg = algs[i];
+			break;
+		}
+	}
 
-#endif
 	rte_acl_set_default_classify(alg);
 }
 
@@ -263,6 +368,7 @@ rte_acl_create(const struct rte_acl_param *param)
 		ctx->rule_sz = param->rule_size;
 		ctx->socket_id = param->socket_id;
 		ctx->alg = rte_acl_default_classify;
+		rte_acl_set_ctx_build_param(ctx, NULL);
 		strlcpy(ctx->name, param->name, sizeof(ctx->name));
 
 		te->data = (void *) ctx;
@@ -11,6 +11,7 @@
  * RTE Classifier.
  */
 
+#include <rte_compat.h>
 #include <rte_acl_osdep.h>
 
 #ifdef __cplusplus
@@ -220,6 +221,105 @@ rte_acl_reset_rules(struct rte_acl_ctx *ctx);
 int
 rte_acl_build(struct rte_acl_ctx *ctx, const struct rte_acl_config *cfg);
 
+/** Maximum number of tries built for an ACL context. */
+#define	RTE_ACL_MAX_TRIES	8
+
+/** Default node limit of the first build attempt with a memory limit. */
+#define	RTE_ACL_NODE_MAX_DEFAULT	0x4000
+
+/** Default node limit of a build without memory limit. */
+#define	RTE_ACL_NODE_MIN_DEFAULT	0x800
+
+/**
+ * ACL build parameters, tuning how rte_acl_build() splits the rules
+ * into several tries. Fewer tries make classification faster, but need
+ * more memory.
+ * The build adds the rules to a trie, sorted by wildness, until one of them
+ * creates more nodes than the node limit. The remaining rules go into
+ * the next trie.
+ * Zero values select the default behavior.
+ */
+struct rte_acl_build_param {
+	uint32_t max_tries;
+	/**<
+	 * Maximum number of tries, default RTE_ACL_MAX_TRIES. The last trie
+	 * holds all the remaining rules, without node limit.
+	 */
+	uint32_t node_max;
+	/**<
+	 * Node limit of the first build attempt when max_size is set in the
+	 * build config, halved on each attempt exceeding max_size.
+	 * Default RTE_ACL_NODE_MAX_DEFAULT.
+	 */
+	uint32_t node_min;
+	/**<
+	 * Node limit when max_size is not set in the build config, lowest
+	 * node limit tried otherwise. Default RTE_ACL_NODE_MIN_DEFAULT.
+	 */
+	uint32_t wild_limit;
+	/**<
+	 * Rules whose fields are, on average, at least that percentage wild
+	 * are built into separate tries from the other rules.
+	 * 0 (default) to build all the rules together.
+	 */
+};
+
+/**
+ * ACL build statistics, of the last successful rte_acl_build().
+ */
+struct rte_acl_build_stats {
+	uint32_t num_tries;     /**< Number of tries. */
+	uint32_t trie_rules[RTE_ACL_MAX_TRIES]; /**< Rules of each trie. */
+	uint32_t node_limit;    /**< Node limit of the successful attempt. */
+	uint32_t num_nodes;     /**< Nodes created by the build phase. */
+	uint32_t num_dfa;       /**< Run-time DFA nodes. */
+	uint32_t num_quad;      /**< Run-time quad range nodes. */
+	uint32_t num_single;    /**< Run-time single range nodes. */
+	uint32_t num_match;     /**< Run-time match nodes. */
+	size_t build_mem;       /**< Memory used by the build phase. */
+	size_t rt_mem;          /**< Memory of the run-time structures. */
+	uint32_t classify_cost;
+	/**<
+	 * Estimated classify cost: number of trie transitions for one input
+	 * buffer, over all the tries.
+	 */
+};
+
+/**
+ * Set the build parameters of an ACL context, used by the following
+ * calls to rte_acl_build().
+ * This function is not multi-thread safe.
+ *
+ * @param ctx
+ *   ACL context to change.
+ * @param prm
+ *   Build parameters, NULL for the defaults.
+ * @return
+ *   - -EINVAL if the parameters are invalid.
+ *   - Zero if operation completed successfully.
+ */
+__rte_experimental
+int
+rte_acl_set_ctx_build_param(struct rte_acl_ctx *ctx,
+	const struct rte_acl_build_param *prm);
+
+/**
+ * Get the statistics of the last successful build of an ACL context.
+ * They are cleared when the context is reset or a build fails.
+ *
+ * @param ctx
+ *   ACL context.
+ * @param stats
+ *   Build statistics.
+ * @return
+ *   - -EINVAL if the parameters are invalid.
+ *   - Zero if operation completed successfully.
+ */
+__rte_experimental
+int
+rte_acl_get_ctx_build_stats(const struct rte_acl_ctx *ctx,
+	struct rte_acl_build_stats *stats);
+
 /**
  * Delete all rules from the ACL context and
  * destroy all internal run-time structures.
@@ -241,6 +341,7 @@ enum rte_acl_classify_alg {
 	RTE_ACL_CLASSIFY_AVX2 = 3,    /**< requires AVX2 support. */
 	RTE_ACL_CLASSIFY_NEON = 4,    /**< requires NEON support. */
 	RTE_ACL_CLASSIFY_ALTIVEC = 5,    /**< requires ALTIVEC support. */
+	RTE_ACL_CLASSIFY_AVX512 = 6,  /**< requires AVX512F and AVX512BW. */
 	RTE_ACL_CLASSIFY_NUM          /* should always be the last one. */
 };
 
@@ -326,16 +427,177 @@ rte_acl_classify_alg(const struct rte_acl_ctx *ctx,
  *   ACL context to change classify function for.
  * @param alg
  *   New default classify algorithm for given ACL context.
- *   It is the caller responsibility to ensure that the value refers to the
- *   existing algorithm, and that it could be run on the given CPU.
  * @return
  *   - -EINVAL if the parameters are invalid.
+ *   - -ENOTSUP if the algorithm is not built in or can't run on this CPU.
  *   - Zero if operation completed successfully.
  */
 extern int
 rte_acl_set_ctx_classify(struct rte_acl_ctx *ctx,
 	enum rte_acl_classify_alg alg);
 
+/** Incremental ACL context, opaque. */
+struct rte_acl_inc_ctx;
+
+struct rte_rcu_qsbr;
+
+/**
+ * Parameters used when creating an incremental ACL context.
+ */
+struct rte_acl_inc_param {
+	const char *name;
+	/**< Name, at most RTE_ACL_INC_NAMESIZE - 1 characters. */
+	int socket_id;            /**< Socket ID to allocate memory for. */
+	uint32_t rule_size;       /**< Size of each rule. */
+	uint32_t max_rule_num;    /**< Maximum number of rules. */
+	uint32_t max_delta_rule_num;
+	/**< Maximum number of rules added since the last merge. */
+};
+
+/** Max number of characters in the name of an incremental ACL context. */
+#define	RTE_ACL_INC_NAMESIZE	(RTE_ACL_NAMESIZE - 10)
+
+/**
+ * Create an incremental ACL context.
+ *
+ * An incremental context classifies with a main ACL context, built from
+ * the rules known at the last merge, and a delta ACL context holding the
+ * rules added since. Adding rules only rebuilds the delta context, the
+ * main one is rebuilt by rte_acl_inc_merge(), which can run in a
+ * background thread while classification goes on.
+ * Rules can only be added, removing rules needs a new context.
+ *
+ * @param param
+ *   Parameters used to create the incremental context.
+ * @param cfg
+ *   Build configuration of the main and delta ACL contexts.
+ * @return
+ *   Pointer to the incremental context, or NULL on error, with error code
+ *   set in rte_errno:
+ *   - EINVAL - invalid parameter passed to function
+ *   - ENOMEM - no appropriate memory area found
+ */
+__rte_experimental
+struct rte_acl_inc_ctx *
+rte_acl_inc_create(const struct rte_acl_inc_param *param,
+	const struct rte_acl_config *cfg);
+
+/**
+ * De-allocate all memory used by an incremental ACL context.
+ * No classification or update may run on the context.
+ *
+ * @param ctx
+ *   Incremental ACL context to free, may be NULL.
+ */
+__rte_experimental
+void
+rte_acl_inc_free(struct rte_acl_inc_ctx *ctx);
+
+/**
+ * Associate an RCU QSBR variable with an incremental ACL context.
+ *
+ * The threads calling rte_acl_inc_classify() report their quiescent
+ * states on this variable, updates then wait for a grace period before
+ * freeing the main and delta ACL contexts they replaced. Without RCU
+ * variable, the replaced contexts are freed at once and the application
+ * must make sure no classification runs during updates.
+ *
+ * @param ctx
+ *   Incremental ACL context.
+ * @param v
+ *   RCU QSBR variable.
+ * @return
+ *   - -EINVAL if the parameters are invalid.
+ *   - -EEXIST if an RCU QSBR variable is already associated.
+ *   - Zero if operation completed successfully.
+ */
+__rte_experimental
+int
+rte_acl_inc_rcu_qsbr_add(struct rte_acl_inc_ctx *ctx, struct rte_rcu_qsbr *v);
+
+/**
+ * Add rules to an incremental ACL context.
+ *
+ * The rules are added to the delta ACL context, which is rebuilt and
+ * swapped in. They are in effect for classification when the function
+ * returns. Updates are serialized with rte_acl_inc_merge(), and wait for
+ * an RCU grace period if an RCU QSBR variable is associated.
+ *
+ * @param ctx
+ *   Incremental ACL context.
+ * @param rules
+ *   Array of rules to add, in the same format as for rte_acl_add_rules().
+ *   The user data of each rule must not be zero.
+ * @param num
+ *   Number of elements in the input array of rules.
+ * @return
+ *   - -EINVAL if the parameters are invalid.
+ *   - -ENOMEM if there is no space in the context for these rules.
+ *   - -ENOSPC if there is no space in the delta context for these rules,
+ *     rte_acl_inc_merge() must be called first.
+ *   - Negative error code if the delta context build failed.
+ *   - Zero if operation completed successfully.
+ */
+__rte_experimental
+int
+rte_acl_inc_add_rules(struct rte_acl_inc_ctx *ctx,
+	const struct rte_acl_rule *rules, uint32_t num);
+
+/**
+ * Merge the delta rules of an incremental ACL context into its main
+ * ACL context.
+ *
+ * A new main ACL context is built from all the rules, without blocking
+ * classification or rte_acl_inc_add_rules(), then swapped in along with
+ * a delta context holding the rules added during the build. Memory for
+ * both main contexts is needed until the old one is freed.
+ * This is meant to be called from a control thread, whenever the delta
+ * context grows too big.
+ *
+ * @param ctx
+ *   Incremental ACL context.
+ * @return
+ *   - -EINVAL if the parameters are invalid.
+ *   - -EBUSY if another merge is in progress.
+ *   - Negative error code if the main context build failed.
+ *   - Zero if operation completed successfully.
+ */
+__rte_experimental
+int
+rte_acl_inc_merge(struct rte_acl_inc_ctx *ctx);
+
+/**
+ * Perform search for a matching rule for each input data buffer in
+ * an incremental ACL context.
+ * Both the main and the delta ACL contexts are searched, for each
+ * category the match with the highest priority is returned, the main
+ * context match when the priorities are equal.
+ * Parameters and results are the same as for rte_acl_classify(),
+ * categories must not be bigger than the number of categories of the
+ * build configuration.
+ * This function is multi-thread safe with updates of the context when
+ * an RCU QSBR variable is associated to it.
+ *
+ * @param ctx
+ *   Incremental ACL context to search with.
+ * @param data
+ *   Array of pointers to input data buffers to perform search.
+ * @param results
+ *   Array of search results, *categories* results per each input data buffer.
+ * @param num
+ *   Number of elements in the input data buffers array.
+ * @param categories
+ *   Number of maximum possible matches for each input buffer, one possible
+ *   match per category.
+ * @return
+ *   zero on successful completion.
+ *   -EINVAL for incorrect arguments.
+ */
+__rte_experimental
+int
+rte_acl_inc_classify(const struct rte_acl_inc_ctx *ctx, const uint8_t **data,
+	uint32_t *results, uint32_t num, uint32_t categories);
+
 /**
  * Dump an ACL context structure to the console.
  *
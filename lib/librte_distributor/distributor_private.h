@@ -13,6 +13,8 @@
  * one-at-a-time to workers, with dynamic load balancing.
  */
 
+#include "rte_distributor.h"
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -101,6 +103,95 @@ struct rte_distributor_single {
 	struct rte_distributor_returned_pkts returns;
 };
 
+/*
+ * Flow tags handed to workers are 16-bit with the low bit set, so the
+ * balancer indexes them with the remaining 15 bits. RTE_DIST_BALANCE_TAGS
+ * itself stands for no flow.
+ */
+#define RTE_DIST_BALANCE_TAGS (1 << 15)
+
+/* Per-flow load tracking and worker assignment of the balance mode */
+struct rte_distributor_balance {
+	struct rte_distributor_balance_params params;
+	uint32_t epoch_count;   /**< packets distributed in this epoch */
+	uint32_t wload[RTE_DISTRIB_MAX_WORKERS];
+		/**< decayed number of packets per epoch of each worker */
+	uint32_t load[RTE_DIST_BALANCE_TAGS];
+		/**< decayed number of packets per epoch of each flow */
+	uint16_t owner[RTE_DIST_BALANCE_TAGS];
+		/**< worker ID + 1 the flow is pinned to, 0 for none */
+	uint16_t head[RTE_DISTRIB_MAX_WORKERS];
+		/**< first flow of the list of flows pinned to each worker */
+	uint16_t next[RTE_DIST_BALANCE_TAGS];
+	uint16_t prev[RTE_DIST_BALANCE_TAGS];
+		/**< links of the list of flows pinned to the same worker */
+};
+
+/*
+ * Ring mode: each worker gets packets through its own SPSC ring, so the
+ * number of workers is not bound by the in-flight tag matching.
+ */
+#define RTE_DIST_RING_MAX_WORKERS RTE_MAX_LCORE
+#define RTE_DIST_RING_DEFAULT_SIZE 1024
+#define RTE_DIST_RING_MAX_SIZE 16384
+/* Number of tags tracked per partition, indexed by the tag low bits */
+#define RTE_DIST_RING_FLOWS (1 << 15)
+/* Packets staged per worker before they are enqueued in bulk */
+#define RTE_DIST_RING_BURST 32
+
+/* Worker states of the ring mode, see rte_distributor_return_pkt() */
+enum rte_distributor_ring_state {
+	RTE_DIST_RING_ACTIVE = 0, /**< worker dequeues from its ring */
+	RTE_DIST_RING_RETIRING,   /**< worker stopped, ring to take over */
+	RTE_DIST_RING_TAKEOVER,   /**< distributor dequeues from the ring */
+	RTE_DIST_RING_RETIRED,    /**< distributor took the ring over */
+};
+
+struct rte_distributor_ring_worker {
+	/* Written by the worker */
+	uint64_t done;          /**< packets the worker is done with */
+	uint32_t state;         /**< enum rte_distributor_ring_state */
+	uint32_t last;          /**< packets got at the last request */
+	uint32_t kick_seen;     /**< last partition kick seen */
+	uint64_t ret_drops;     /**< returns dropped, return ring full */
+	struct rte_ring *to_w;  /**< packets to the worker */
+	struct rte_ring *from_w; /**< packets returned by the worker */
+
+	/* Distributor private */
+	uint64_t sent __rte_cache_aligned; /**< packets given to the worker */
+	uint64_t acked;         /**< sent packets seen done */
+	uint64_t done_off;      /**< packets taken back from the worker */
+	uint16_t *tags;         /**< tags of the packets sent, in order */
+	uint32_t tag_mask;
+	uint32_t active;        /**< worker can be given new flows */
+	uint32_t count;         /**< packets staged */
+	struct rte_mbuf *stage[RTE_DIST_RING_BURST];
+	struct rte_mbuf **takeback; /**< packets taken back at retirement */
+} __rte_cache_aligned;
+
+/* Partition of the flows and workers served by one distributor lcore */
+struct rte_distributor_ring_part {
+	uint32_t kick;          /**< bumped to wake up idle workers */
+
+	unsigned int num_workers __rte_cache_aligned;
+	unsigned int next;      /**< next worker in turn for new flows */
+	unsigned int ret_next;  /**< next worker to take returns from */
+	uint16_t owner[RTE_DIST_RING_FLOWS];
+		/**< local worker ID + 1 the flow last went to, 0 for none */
+	uint16_t inflight[RTE_DIST_RING_FLOWS];
+		/**< packets of the flow sent and not done */
+};
+
+struct rte_distributor_ring {
+	char name[RTE_DISTRIBUTOR_NAMESIZE];
+	unsigned int num_workers;
+	unsigned int num_parts;
+	unsigned int ring_size;
+	struct rte_distributor_ring_part **parts;
+	struct rte_distributor_ring_worker *workers;
+		/**< worker w serves partition w % num_parts */
+};
+
 /* All different signature compare functions */
 enum rte_distributor_match_function {
 	RTE_DIST_MATCH_SCALAR = 0,
@@ -136,6 +227,7 @@ struct rte_distributor {
 	char name[RTE_DISTRIBUTOR_NAMESIZE];  /**< Name of the ring. */
 	unsigned int num_workers;             /**< Number of workers polling */
 	unsigned int alg_type;                /**< Number of alg types */
+	int socket_id;                        /**< Socket of the instance */
 
 	/**>
 	 * First cache line in the this array are the tags inflight
@@ -155,6 +247,12 @@ struct rte_distributor {
 	enum rte_distributor_match_function dist_match_fn;
 
 	struct rte_distributor_single *d_single;
+
+	struct rte_distributor_ring *d_ring;
+
+	struct rte_distributor_balance *balance; /**< NULL if not balancing */
+
+	struct rte_distributor_worker_stats wstats[RTE_DISTRIB_MAX_WORKERS];
 };
 
 void
@@ -167,6 +265,39 @@ find_match_vec(struct rte_distributor *d,
 			uint16_t *data_ptr,
 			uint16_t *output_ptr);
 
+/* Ring mode, see rte_distributor_ring.c */
+struct rte_distributor_ring *
+rte_distributor_create_ring_mode(const struct rte_distributor_ring_params *p);
+
+void
+rte_distributor_request_pkt_ring(struct rte_distributor_ring *dr,
+		unsigned int worker_id, struct rte_mbuf **oldpkt,
+		unsigned int count);
+
+int
+rte_distributor_poll_pkt_ring(struct rte_distributor_ring *dr,
+		unsigned int worker_id, struct rte_mbuf **pkts);
+
+int
+rte_distributor_return_pkt_ring(struct rte_distributor_ring *dr,
+		unsigned int worker_id, struct rte_mbuf **oldpkt, int num);
+
+int
+rte_distributor_process_ring(struct rte_distributor_ring *dr,
+		unsigned int part_id, struct rte_mbuf **mbufs,
+		unsigned int num_mbufs);
+
+int
+rte_distributor_returned_pkts_ring(struct rte_distributor_ring *dr,
+		unsigned int part_id, struct rte_mbuf **mbufs,
+		unsigned int max_mbufs);
+
+int
+rte_distributor_flush_ring(struct rte_distributor_ring *dr);
+
+void
+rte_distributor_clear_returns_ring(struct rte_distributor_ring *dr);
+
 #ifdef __cplusplus
 }
 #endif
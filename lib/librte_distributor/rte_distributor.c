@@ -13,6 +13,7 @@
 #include <rte_errno.h>
 #include <rte_string_fns.h>
 #include <rte_eal_memconfig.h>
+#include <rte_malloc.h>
 #include <rte_pause.h>
 #include <rte_tailq.h>
 
@@ -47,6 +48,12 @@ rte_distributor_request_pkt(struct rte_distributor *d,
 		return;
 	}
 
+	if (unlikely(d->alg_type == RTE_DIST_ALG_RING)) {
+		rte_distributor_request_pkt_ring(d->d_ring, worker_id,
+			oldpkt, count);
+		return;
+	}
+
 	retptr64 = &(buf->retptr64[0]);
 	/* Spin while handshake bits are set (scheduler clears it).
 	 * Sync with worker on GET_BUF flag.
@@ -98,6 +105,9 @@ rte_distributor_poll_pkt(struct rte_distributor *d,
 		return (pkts[0]) ? 1 : 0;
 	}
 
+	if (unlikely(d->alg_type == RTE_DIST_ALG_RING))
+		return rte_distributor_poll_pkt_ring(d->d_ring, worker_id, pkts);
+
 	/* If bit is set, return
 	 * Sync with distributor to acquire bufptrs
 	 */
@@ -170,6 +180,10 @@ rte_distributor_return_pkt(struct rte_distributor *d,
 			return -EINVAL;
 	}
 
+	if (unlikely(d->alg_type == RTE_DIST_ALG_RING))
+		return rte_distributor_return_pkt_ring(d->d_ring, worker_id,
+			oldpkt, num);
+
 	/* Sync with distributor to acquire retptrs */
 	__atomic_thread_fence(__ATOMIC_ACQUIRE);
 	for (i = 0; i < RTE_DIST_BURST_SIZE; i++)
@@ -323,6 +337,7 @@ release(struct rte_distributor *d, unsigned int wkr)
 		d->in_flight_tags[wkr][i] = d->backlog[wkr].tags[i];
 	}
 	buf->count = i;
+	d->wstats[wkr].pkts += i;
 	for ( ; i < RTE_DIST_BURST_SIZE ; i++) {
 		buf->bufptr64[i] = RTE_DISTRIB_GET_BUF;
 		d->in_flight_tags[wkr][i] = 0;
@@ -340,6 +355,154 @@ release(struct rte_distributor *d, unsigned int wkr)
 }
 
 
+/* Pin a flow to a worker, adding it to the flows of the worker */
+static inline void
+balance_pin(struct rte_distributor_balance *bal, unsigned int flow,
+		unsigned int wid)
+{
+	bal->owner[flow] = wid + 1;
+	bal->prev[flow] = RTE_DIST_BALANCE_TAGS;
+	bal->next[flow] = bal->head[wid];
+	if (bal->head[wid] != RTE_DIST_BALANCE_TAGS)
+		bal->prev[bal->head[wid]] = flow;
+	bal->head[wid] = flow;
+}
+
+/* Unpin a flow, removing it from the flows of its worker */
+static inline void
+balance_unpin(struct rte_distributor_balance *bal, unsigned int flow)
+{
+	unsigned int wid = bal->owner[flow] - 1;
+
+	if (bal->prev[flow] != RTE_DIST_BALANCE_TAGS)
+		bal->next[bal->prev[flow]] = bal->next[flow];
+	else
+		bal->head[wid] = bal->next[flow];
+	if (bal->next[flow] != RTE_DIST_BALANCE_TAGS)
+		bal->prev[bal->next[flow]] = bal->prev[flow];
+	bal->owner[flow] = 0;
+}
+
+/*
+ * Return the worker a flow with no packet in flight goes to: the worker
+ * it is pinned to, or else the least loaded worker, to which it gets
+ * pinned.
+ */
+static inline unsigned int
+balance_assign(struct rte_distributor *d, uint16_t tag)
+{
+	struct rte_distributor_balance *bal = d->balance;
+	unsigned int i, wid;
+
+	wid = bal->owner[tag >> 1];
+	if (likely(wid != 0))
+		return wid - 1;
+
+	wid = 0;
+	for (i = 1; i < d->num_workers; i++)
+		if (bal->wload[i] < bal->wload[wid])
+			wid = i;
+	balance_pin(bal, tag >> 1, wid);
+
+	return wid;
+}
+
+static inline void
+balance_account(struct rte_distributor *d, uint16_t tag, unsigned int wid)
+{
+	struct rte_distributor_balance *bal = d->balance;
+
+	bal->load[tag >> 1]++;
+	bal->wload[wid]++;
+	bal->epoch_count++;
+}
+
+/*
+ * Move the heaviest flow of the busiest worker which is lighter than the
+ * load difference with the least busy worker, so that the move lowers the
+ * busiest load without making the other worker busier than it was.
+ * Return 0 if the workers are balanced within the hysteresis, or no flow
+ * can be moved.
+ */
+static int
+balance_move_one(struct rte_distributor *d)
+{
+	struct rte_distributor_balance *bal = d->balance;
+	unsigned int i, hot = 0, cold = 0;
+	uint32_t gap, best, best_load = 0;
+	uint64_t total = 0;
+
+	for (i = 0; i < d->num_workers; i++) {
+		total += bal->wload[i];
+		if (bal->wload[i] > bal->wload[hot])
+			hot = i;
+		if (bal->wload[i] < bal->wload[cold])
+			cold = i;
+	}
+
+	if ((uint64_t)bal->wload[hot] * d->num_workers * 100 <=
+			total * (100 + bal->params.hysteresis))
+		return 0;
+
+	gap = bal->wload[hot] - bal->wload[cold];
+	best = RTE_DIST_BALANCE_TAGS;
+	for (i = bal->head[hot]; i != RTE_DIST_BALANCE_TAGS; i = bal->next[i]) {
+		if (bal->load[i] < gap && bal->load[i] > best_load) {
+			best = i;
+			best_load = bal->load[i];
+		}
+	}
+	if (best == RTE_DIST_BALANCE_TAGS)
+		return 0;
+
+	/*
+	 * Packets of the flow still in flight or backlogged on the old
+	 * worker match there first, so the flow only really moves once
+	 * they are all done.
+	 */
+	balance_unpin(bal, best);
+	balance_pin(bal, best, cold);
+	bal->wload[hot] -= best_load;
+	bal->wload[cold] += best_load;
+	d->wstats[hot].flows_out++;
+	d->wstats[cold].flows_in++;
+
+	return 1;
+}
+
+/*
+ * End of a balance epoch: rebalance, then halve the loads so that they
+ * follow the recent traffic, and unpin the flows which went idle.
+ */
+static void
+balance_epoch(struct rte_distributor *d)
+{
+	struct rte_distributor_balance *bal = d->balance;
+	unsigned int i, f, next, moves;
+	uint32_t flows;
+
+	for (moves = 0; moves < bal->params.max_moves; moves++)
+		if (balance_move_one(d) == 0)
+			break;
+
+	for (i = 0; i < d->num_workers; i++) {
+		flows = 0;
+		for (f = bal->head[i]; f != RTE_DIST_BALANCE_TAGS; f = next) {
+			next = bal->next[f];
+			bal->load[f] >>= 1;
+			if (bal->load[f] == 0)
+				balance_unpin(bal, f);
+			else
+				flows++;
+		}
+
+		d->wstats[i].load = bal->wload[i];
+		d->wstats[i].flows = flows;
+		bal->wload[i] >>= 1;
+	}
+	bal->epoch_count = 0;
+}
+
 /* process a set of packets to distribute them to workers */
 int
 rte_distributor_process(struct rte_distributor *d,
@@ -359,6 +522,10 @@ rte_distributor_process(struct rte_distributor *d,
 			mbufs, num_mbufs);
 	}
 
+	if (d->alg_type == RTE_DIST_ALG_RING)
+		return rte_distributor_process_ring(d->d_ring, 0,
+			mbufs, num_mbufs);
+
 	if (unlikely(num_mbufs == 0)) {
 		/* Flush out all non-full cache-lines to workers. */
 		for (wid = 0 ; wid < d->num_workers; wid++) {
@@ -446,11 +613,18 @@ rte_distributor_process(struct rte_distributor *d,
 				bl->pkts[idx] = next_value;
 
 			} else {
+				/*
+				 * In balance mode, the flow goes back to the
+				 * worker it is pinned to, rather than to the
+				 * current worker.
+				 */
+				unsigned int target = (d->balance != NULL) ?
+					balance_assign(d, new_tag) : wkr;
 				struct rte_distributor_backlog *bl =
-						&d->backlog[wkr];
+						&d->backlog[target];
 				if (unlikely(bl->count ==
 						RTE_DIST_BURST_SIZE)) {
-					release(d, wkr);
+					release(d, target);
 				}
 
 				/* Add to current worker worker */
@@ -466,14 +640,21 @@ rte_distributor_process(struct rte_distributor *d,
 				 */
 				for (w = j; w < pkts; w++)
 					if (flows[w] == new_tag)
-						matches[w] = wkr+1;
+						matches[w] = target+1;
 			}
+
+			if (d->balance != NULL)
+				balance_account(d, new_tag, matches[j] - 1);
 		}
 		wkr++;
 		if (wkr >= d->num_workers)
 			wkr = 0;
 	}
 
+	if (d->balance != NULL && d->balance->epoch_count >=
+			d->balance->params.epoch_pkts)
+		balance_epoch(d);
+
 	/* Flush out all non-full cache-lines to workers. */
 	for (wid = 0 ; wid < d->num_workers; wid++)
 		/* Sync with worker on GET_BUF flag. */
@@ -500,6 +681,10 @@ rte_distributor_returned_pkts(struct rte_distributor *d,
 				mbufs, max_mbufs);
 	}
 
+	if (d->alg_type == RTE_DIST_ALG_RING)
+		return rte_distributor_returned_pkts_ring(d->d_ring, 0,
+				mbufs, max_mbufs);
+
 	for (i = 0; i < retval; i++) {
 		unsigned int idx = (returns->start + i) &
 				RTE_DISTRIB_RETURNS_MASK;
@@ -542,6 +727,9 @@ rte_distributor_flush(struct rte_distributor *d)
 		return rte_distributor_flush_single(d->d_single);
 	}
 
+	if (d->alg_type == RTE_DIST_ALG_RING)
+		return rte_distributor_flush_ring(d->d_ring);
+
 	flushed = total_outstanding(d);
 
 	while (total_outstanding(d) > 0)
@@ -574,6 +762,11 @@ rte_distributor_clear_returns(struct rte_distributor *d)
 		return;
 	}
 
+	if (d->alg_type == RTE_DIST_ALG_RING) {
+		rte_distributor_clear_returns_ring(d->d_ring);
+		return;
+	}
+
 	/* throw away returns, so workers can exit */
 	for (wkr = 0; wkr < d->num_workers; wkr++)
 		/* Sync with worker. Release retptrs. */
@@ -581,6 +774,128 @@ rte_distributor_clear_returns(struct rte_distributor *d)
 				__ATOMIC_RELEASE);
 }
 
+/* enables flow balancing, or updates its parameters */
+int
+rte_distributor_balance_enable(struct rte_distributor *d,
+		const struct rte_distributor_balance_params *params)
+{
+	struct rte_distributor_balance *bal;
+	unsigned int i;
+
+	if (d == NULL || params == NULL || params->epoch_pkts == 0)
+		return -EINVAL;
+	if (d->alg_type != RTE_DIST_ALG_BURST)
+		return -ENOTSUP;
+
+	if (d->balance != NULL) {
+		d->balance->params = *params;
+		return 0;
+	}
+
+	bal = rte_zmalloc_socket(d->name, sizeof(*bal), RTE_CACHE_LINE_SIZE,
+			d->socket_id);
+	if (bal == NULL)
+		return -ENOMEM;
+	bal->params = *params;
+	for (i = 0; i < RTE_DISTRIB_MAX_WORKERS; i++)
+		bal->head[i] = RTE_DIST_BALANCE_TAGS;
+	d->balance = bal;
+
+	return 0;
+}
+
+/* disables flow balancing, flows go back to the default assignment */
+void
+rte_distributor_balance_disable(struct rte_distributor *d)
+{
+	if (d == NULL || d->alg_type != RTE_DIST_ALG_BURST)
+		return;
+
+	rte_free(d->balance);
+	d->balance = NULL;
+}
+
+/* gets the per worker counters of the distributor */
+int
+rte_distributor_get_worker_stats(struct rte_distributor *d,
+		unsigned int worker_id,
+		struct rte_distributor_worker_stats *stats)
+{
+	if (d == NULL || stats == NULL)
+		return -EINVAL;
+	if (d->alg_type == RTE_DIST_ALG_SINGLE)
+		return -ENOTSUP;
+
+	if (d->alg_type == RTE_DIST_ALG_RING) {
+		if (worker_id >= d->d_ring->num_workers)
+			return -EINVAL;
+		memset(stats, 0, sizeof(*stats));
+		stats->pkts = d->d_ring->workers[worker_id].sent;
+		return 0;
+	}
+
+	if (worker_id >= d->num_workers)
+		return -EINVAL;
+
+	*stats = d->wstats[worker_id];
+
+	return 0;
+}
+
+/* processes a set of packets of a partition of a ring mode distributor */
+int
+rte_distributor_process_partition(struct rte_distributor *d,
+		unsigned int partition, struct rte_mbuf **mbufs,
+		unsigned int num_mbufs)
+{
+	if (d->alg_type != RTE_DIST_ALG_RING ||
+			partition >= d->d_ring->num_parts)
+		return -EINVAL;
+
+	return rte_distributor_process_ring(d->d_ring, partition,
+			mbufs, num_mbufs);
+}
+
+/* return to the caller the packets returned to a partition */
+int
+rte_distributor_returned_pkts_partition(struct rte_distributor *d,
+		unsigned int partition, struct rte_mbuf **mbufs,
+		unsigned int max_mbufs)
+{
+	if (d->alg_type != RTE_DIST_ALG_RING ||
+			partition >= d->d_ring->num_parts)
+		return -EINVAL;
+
+	return rte_distributor_returned_pkts_ring(d->d_ring, partition,
+			mbufs, max_mbufs);
+}
+
+/* creates a ring mode distributor instance */
+struct rte_distributor *
+rte_distributor_create_ring(const struct rte_distributor_ring_params *params)
+{
+	struct rte_distributor *d;
+
+	if (params == NULL) {
+		rte_errno = EINVAL;
+		return NULL;
+	}
+
+	d = malloc(sizeof(struct rte_distributor));
+	if (d == NULL) {
+		rte_errno = ENOMEM;
+		return NULL;
+	}
+	d->d_ring = rte_distributor_create_ring_mode(params);
+	if (d->d_ring == NULL) {
+		free(d);
+		/* rte_errno will have been set */
+		return NULL;
+	}
+	d->alg_type = RTE_DIST_ALG_RING;
+	return d;
+}
+
 /* creates a distributor instance */
 struct rte_distributor *
 rte_distributor_create(const char *name,
@@ -600,6 +915,16 @@ rte_distributor_create(const char *name,
 	RTE_BUILD_BUG_ON((sizeof(*d) & RTE_CACHE_LINE_MASK) != 0);
 	RTE_BUILD_BUG_ON((RTE_DISTRIB_MAX_WORKERS & 7) != 0);
 
+	if (alg_type == RTE_DIST_ALG_RING) {
+		struct rte_distributor_ring_params params = {
+			.name = name,
+			.socket_id = socket_id,
+			.num_workers = num_workers,
+		};
+
+		return rte_distributor_create_ring(&params);
+	}
+
 	if (name == NULL || num_workers >=
 		(unsigned int)RTE_MIN(RTE_DISTRIB_MAX_WORKERS, RTE_MAX_LCORE)) {
 		rte_errno = EINVAL;
@@ -634,6 +959,9 @@ rte_distributor_create(const char *name,
 	strlcpy(d->name, name, sizeof(d->name));
 	d->num_workers = num_workers;
 	d->alg_type = alg_type;
+	d->socket_id = mz->socket_id;
+	d->balance = NULL;
+	memset(d->wstats, 0, sizeof(d->wstats));
 
 	d->dist_match_fn = RTE_DIST_MATCH_SCALAR;
 #if defined(RTE_ARCH_X86)
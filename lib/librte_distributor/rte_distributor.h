@@ -13,14 +13,19 @@
  * one-at-a-time to workers, with dynamic load balancing.
  */
 
+#include <stdint.h>
+
+#include <rte_compat.h>
+
 #ifdef __cplusplus
 extern "C" {
 #endif
 
-/* Type of distribution (burst/single) */
+/* Type of distribution (burst/single/ring) */
 enum rte_distributor_alg_type {
 	RTE_DIST_ALG_BURST = 0,
 	RTE_DIST_ALG_SINGLE,
+	RTE_DIST_ALG_RING, /**< per worker rings, see rte_distributor_create_ring() */
 	RTE_DIST_NUM_ALG_TYPES
 };
 
@@ -44,6 +49,8 @@ struct rte_mbuf;
  *   Call the legacy API, or use the new burst API. legacy uses 32-bit
  *   flow ID, and works on a single packet at a time. Latest uses 15-
  *   bit flow ID and works on up to 8 packets at a time to workers.
+ *   The ring mode uses the default parameters of
+ *   rte_distributor_create_ring().
  * @return
  *   The newly created distributor instance
  */
@@ -52,6 +59,58 @@ rte_distributor_create(const char *name, unsigned int socket_id,
 		unsigned int num_workers,
 		unsigned int alg_type);
 
+/**
+ * Parameters of a ring mode distributor.
+ */
+struct rte_distributor_ring_params {
+	const char *name;            /**< Name of the distributor instance. */
+	int socket_id;               /**< NUMA node of the memory. */
+	unsigned int num_workers;    /**< Number of workers, up to RTE_MAX_LCORE. */
+	/**
+	 * Number of distributor lcores, each serving a partition of the
+	 * flows and of the workers. 0 means 1.
+	 */
+	unsigned int num_partitions;
+	/** Size of the ring of each worker, a power of 2, 0 for default. */
+	unsigned int ring_size;
+};
+
+/**
+ * @warning
+ * @b EXPERIMENTAL: this API may change without prior notice
+ *
+ * Create a distributor instance in ring mode.
+ *
+ * In ring mode, each worker gets its packets through its own single
+ * producer, single consumer ring, which the distributor fills in bulk, and
+ * returns them through another one. The packets of a flow go to the worker
+ * which has packets of that flow in flight, and a flow with no packet in
+ * flight goes to the least busy of the worker it last went to and the next
+ * worker in turn. The flows are identified by the 15 low bits of the tag.
+ * Unlike the burst mode, the number of workers is not limited to 64, and
+ * the distributor does not wait for a worker to request packets.
+ *
+ * The workers and flows can be split in partitions, each served by its own
+ * distributor lcore calling rte_distributor_process_partition(). Worker
+ * worker_id serves partition worker_id % num_partitions. The application
+ * gives each packet to the partition of its tag, for instance
+ * hash.usr % num_partitions, so that a flow always goes to the same
+ * partition.
+ *
+ * The worker APIs are unchanged. A worker calling
+ * rte_distributor_return_pkt() gets its pending packets given to other
+ * workers at the next call to rte_distributor_process() of its partition.
+ *
+ * @param params
+ *   The distributor parameters
+ * @return
+ *   The newly created distributor instance, or NULL with rte_errno set to
+ *   EINVAL or ENOMEM
+ */
+__rte_experimental
+struct rte_distributor *
+rte_distributor_create_ring(const struct rte_distributor_ring_params *params);
+
 /*  *** APIS to be called on the distributor lcore ***  */
 /*
  * The following APIs are the public APIs which are designed for use on a
@@ -132,6 +191,160 @@ rte_distributor_flush(struct rte_distributor *d);
 void
 rte_distributor_clear_returns(struct rte_distributor *d);
 
+/**
+ * @warning
+ * @b EXPERIMENTAL: this API may change without prior notice
+ *
+ * Process a set of packets of one partition of a ring mode distributor.
+ * rte_distributor_process() processes the partition 0.
+ *
+ * Each partition must be processed on a single lcore at a time.
+ *
+ * @param d
+ *   The distributor instance to be used
+ * @param partition
+ *   The partition of the packets
+ * @param mbufs
+ *   The mbufs to be distributed
+ * @param num_mbufs
+ *   The number of mbufs in the mbufs array
+ * @return
+ *   The number of mbufs processed, or -EINVAL if the distributor is not in
+ *   ring mode or the partition is invalid
+ */
+__rte_experimental
+int
+rte_distributor_process_partition(struct rte_distributor *d,
+		unsigned int partition, struct rte_mbuf **mbufs,
+		unsigned int num_mbufs);
+
+/**
+ * @warning
+ * @b EXPERIMENTAL: this API may change without prior notice
+ *
+ * Get the packets returned by the workers of one partition of a ring mode
+ * distributor. rte_distributor_returned_pkts() returns the packets of the
+ * partition 0.
+ *
+ * @param d
+ *   The distributor instance to be used
+ * @param partition
+ *   The partition
+ * @param mbufs
+ *   The mbufs pointer array to be filled in
+ * @param max_mbufs
+ *   The size of the mbufs array
+ * @return
+ *   The number of mbufs returned in the mbufs array, or -EINVAL if the
+ *   distributor is not in ring mode or the partition is invalid
+ */
+__rte_experimental
+int
+rte_distributor_returned_pkts_partition(struct rte_distributor *d,
+		unsigned int partition, struct rte_mbuf **mbufs,
+		unsigned int max_mbufs);
+
+/**
+ * Parameters of the flow balancing mode.
+ */
+struct rte_distributor_balance_params {
+	/** Number of packets processed between two rebalancing steps. */
+	uint32_t epoch_pkts;
+	/**
+	 * Percentage by which the busiest worker load must exceed the mean
+	 * worker load for flows to be moved away from it.
+	 */
+	uint32_t hysteresis;
+	/** Maximum number of flows moved at each rebalancing step. */
+	uint32_t max_moves;
+};
+
+/**
+ * Per worker counters of a burst mode distributor.
+ */
+struct rte_distributor_worker_stats {
+	uint64_t pkts;      /**< Packets handed to the worker. */
+	uint64_t flows_in;  /**< Flows moved to the worker by balancing. */
+	uint64_t flows_out; /**< Flows moved away from the worker. */
+	uint32_t load;      /**< Decayed packet load at the last epoch. */
+	uint32_t flows;     /**< Flows pinned to the worker at the last epoch. */
+};
+
+/**
+ * @warning
+ * @b EXPERIMENTAL: this API may change without prior notice
+ *
+ * Enable the flow balancing mode of a burst mode distributor, or update
+ * its parameters if already enabled.
+ *
+ * By default, a flow with no packet in flight goes to whichever worker is
+ * next in turn. In balancing mode, each flow stays pinned to a worker and
+ * a per flow packet load is kept. New flows go to the least loaded worker,
+ * and every epoch_pkts packets, the heaviest flows which fit are moved
+ * from the busiest worker to the least busy one, until the busiest load is
+ * within the hysteresis of the mean. A moved flow only switches worker
+ * once the packets still in flight on the old worker are done, so the
+ * flow ordering is kept. The loads are halved at each epoch, and idle
+ * flows are unpinned.
+ *
+ * Flows are identified by the 15-bit tag used for burst mode matching.
+ *
+ * This is not multi-thread safe and should only be called on the
+ * distributor lcore.
+ *
+ * @param d
+ *   The distributor instance to be used
+ * @param params
+ *   The balancing parameters
+ * @return
+ *   - 0 on success
+ *   - -EINVAL if a parameter is invalid
+ *   - -ENOTSUP if the distributor is not in burst mode
+ *   - -ENOMEM if the flow table cannot be allocated
+ */
+__rte_experimental
+int
+rte_distributor_balance_enable(struct rte_distributor *d,
+		const struct rte_distributor_balance_params *params);
+
+/**
+ * @warning
+ * @b EXPERIMENTAL: this API may change without prior notice
+ *
+ * Disable the flow balancing mode of a distributor, and release its flow
+ * table. This should only be called on the distributor lcore.
+ *
+ * @param d
+ *   The distributor instance to be used
+ */
+__rte_experimental
+void
+rte_distributor_balance_disable(struct rte_distributor *d);
+
+/**
+ * @warning
+ * @b EXPERIMENTAL: this API may change without prior notice
+ *
+ * Get the counters of a worker of a burst or ring mode distributor. The
+ * load and flows fields are only updated in flow balancing mode.
+ *
+ * @param d
+ *   The distributor instance to be used
+ * @param worker_id
+ *   The worker instance number
+ * @param stats
+ *   Where to store the counters
+ * @return
+ *   - 0 on success
+ *   - -EINVAL if a parameter is invalid
+ *   - -ENOTSUP if the distributor uses the single packet algorithm
+ */
+__rte_experimental
+int
+rte_distributor_get_worker_stats(struct rte_distributor *d,
+		unsigned int worker_id,
+		struct rte_distributor_worker_stats *stats);
+
 /*  *** APIS to be called on the worker lcores ***  */
 /*
  * The following APIs are the public APIs which are designed for use on
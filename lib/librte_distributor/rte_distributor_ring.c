@@ -0,0 +1,558 @@
+/* SPDX-License-Identifier: BSD-3-Clause
+ * Copyright(c) 2020 Intel Corporation
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <sys/queue.h>
+#include <rte_mbuf.h>
+#include <rte_memory.h>
+#include <rte_errno.h>
+#include <rte_string_fns.h>
+#include <rte_malloc.h>
+#include <rte_pause.h>
+#include <rte_ring.h>
+
+#include "rte_distributor.h"
+#include "distributor_private.h"
+
+/*
+ * Ring mode of the distributor.
+ *
+ * Each worker has a SPSC ring of packets to process, filled in bursts of
+ * RTE_DIST_RING_BURST by the distributor, and a SPSC ring of returned
+ * packets. Instead of matching the incoming tags against the tags in flight
+ * on every worker, the distributor counts the packets in flight of each
+ * flow: the packets of a flow go to the worker which has some of them in
+ * flight, and an idle flow goes either to the worker it last went to or
+ * to the next worker in turn, whichever has the fewest packets pending.
+ *
+ * A worker tells the packets it got are done by bumping a counter at its
+ * next request, and the distributor keeps the tags of the packets sent to
+ * each worker in order, to know which flows they belong to.
+ *
+ * The workers and flows are split in partitions, each served by its own
+ * distributor lcore without any sharing.
+ */
+
+static inline struct rte_distributor_ring_worker *
+ring_worker(struct rte_distributor_ring *dr, unsigned int part_id,
+		unsigned int local_id)
+{
+	return &dr->workers[local_id * dr->num_parts + part_id];
+}
+
+/**** APIs called by workers ****/
+
+void
+rte_distributor_request_pkt_ring(struct rte_distributor_ring *dr,
+		unsigned int worker_id, struct rte_mbuf **oldpkt,
+		unsigned int count)
+{
+	struct rte_distributor_ring_worker *wk = &dr->workers[worker_id];
+	unsigned int n = 0;
+
+	if (count != 0)
+		n = rte_ring_enqueue_burst(wk->from_w, (void **)oldpkt, count,
+				NULL);
+	/*
+	 * Nobody drains the returns, do not block on them. Like the burst
+	 * mode dropping the oldest returns, the mbufs are left to the
+	 * application.
+	 */
+	if (unlikely(n < count))
+		wk->ret_drops += count - n;
+
+	if (unlikely(__atomic_load_n(&wk->state, __ATOMIC_RELAXED) !=
+			RTE_DIST_RING_ACTIVE)) {
+		uint32_t state = RTE_DIST_RING_RETIRING;
+
+		/* coming back before the distributor took the ring over */
+		wk->last = 0;
+		if (__atomic_compare_exchange_n(&wk->state, &state,
+				RTE_DIST_RING_ACTIVE, 0, __ATOMIC_ACQUIRE,
+				__ATOMIC_RELAXED))
+			return;
+
+		/* otherwise wait for it to be done with the ring */
+		while (__atomic_load_n(&wk->state, __ATOMIC_ACQUIRE) !=
+				RTE_DIST_RING_RETIRED)
+			rte_pause();
+		__atomic_store_n(&wk->state, RTE_DIST_RING_ACTIVE,
+				__ATOMIC_RELEASE);
+		return;
+	}
+
+	/* Sync with distributor on done. */
+	__atomic_store_n(&wk->done, wk->done + wk->last, __ATOMIC_RELEASE);
+	wk->last = 0;
+}
+
+int
+rte_distributor_poll_pkt_ring(struct rte_distributor_ring *dr,
+		unsigned int worker_id, struct rte_mbuf **pkts)
+{
+	struct rte_distributor_ring_worker *wk = &dr->workers[worker_id];
+	struct rte_distributor_ring_part *part =
+		dr->parts[worker_id % dr->num_parts];
+	uint32_t kick;
+	unsigned int n;
+
+	n = rte_ring_dequeue_burst(wk->to_w, (void **)pkts,
+			RTE_DIST_BURST_SIZE, NULL);
+	if (n != 0) {
+		wk->last = n;
+		return n;
+	}
+
+	/* an empty burst when the distributor flushes */
+	kick = __atomic_load_n(&part->kick, __ATOMIC_RELAXED);
+	if (kick != wk->kick_seen) {
+		wk->kick_seen = kick;
+		return 0;
+	}
+
+	return -1;
+}
+
+int
+rte_distributor_return_pkt_ring(struct rte_distributor_ring *dr,
+		unsigned int worker_id, struct rte_mbuf **oldpkt, int num)
+{
+	struct rte_distributor_ring_worker *wk = &dr->workers[worker_id];
+
+	rte_distributor_request_pkt_ring(dr, worker_id, oldpkt, num);
+
+	/*
+	 * The worker stops dequeuing: the distributor takes its ring over
+	 * to give the packets left in it to other workers.
+	 * Sync with distributor on state. Release done.
+	 */
+	__atomic_store_n(&wk->state, RTE_DIST_RING_RETIRING, __ATOMIC_RELEASE);
+
+	return 0;
+}
+
+/**** APIs called on distributor core ***/
+
+/* account for the packets the worker is done with */
+static inline void
+ring_ack(struct rte_distributor_ring_part *part,
+		struct rte_distributor_ring_worker *wk)
+{
+	uint64_t done;
+
+	/* Sync with worker on done. */
+	done = __atomic_load_n(&wk->done, __ATOMIC_ACQUIRE) + wk->done_off;
+	while (wk->acked < done)
+		part->inflight[wk->tags[wk->acked++ & wk->tag_mask]]--;
+}
+
+static void
+ring_dispatch(struct rte_distributor_ring *dr,
+		struct rte_distributor_ring_part *part, unsigned int part_id,
+		struct rte_mbuf **mbufs, unsigned int num_mbufs);
+
+/*
+ * Take the ring of a retiring worker over, and give the packets left in it
+ * to the other workers. Return 0 if the worker came back in the meantime.
+ */
+static int
+ring_retire(struct rte_distributor_ring *dr,
+		struct rte_distributor_ring_part *part, unsigned int part_id,
+		struct rte_distributor_ring_worker *wk)
+{
+	uint32_t state = RTE_DIST_RING_RETIRING;
+	unsigned int n, count = 0;
+
+	/* Sync with worker on state. Acquire done. */
+	if (!__atomic_compare_exchange_n(&wk->state, &state,
+			RTE_DIST_RING_TAKEOVER, 0, __ATOMIC_ACQUIRE,
+			__ATOMIC_RELAXED))
+		return 0;
+
+	wk->active = 0;
+
+	/* the worker is gone, so the distributor is the only consumer */
+	do {
+		n = rte_ring_dequeue_burst(wk->to_w,
+				(void **)&wk->takeback[count],
+				RTE_DIST_RING_BURST, NULL);
+		count += n;
+	} while (n != 0);
+	memcpy(&wk->takeback[count], wk->stage,
+			wk->count * sizeof(wk->stage[0]));
+	count += wk->count;
+	wk->count = 0;
+
+	/* all the packets sent are now either done or taken back */
+	while (wk->acked < wk->sent)
+		part->inflight[wk->tags[wk->acked++ & wk->tag_mask]]--;
+	wk->done_off = wk->sent - wk->done;
+
+	/* may retire other workers, each using its own take back buffer */
+	ring_dispatch(dr, part, part_id, wk->takeback, count);
+
+	/* Sync with worker on state. */
+	__atomic_store_n(&wk->state, RTE_DIST_RING_RETIRED, __ATOMIC_RELEASE);
+
+	return 1;
+}
+
+/*
+ * Account for the done packets of all the workers of the partition, and
+ * check for workers leaving or coming back.
+ */
+static void
+ring_reap(struct rte_distributor_ring *dr,
+		struct rte_distributor_ring_part *part, unsigned int part_id)
+{
+	struct rte_distributor_ring_worker *wk;
+	unsigned int i;
+	uint32_t state;
+
+	for (i = 0; i < part->num_workers; i++) {
+		wk = ring_worker(dr, part_id, i);
+		ring_ack(part, wk);
+
+		state = __atomic_load_n(&wk->state, __ATOMIC_ACQUIRE);
+		if (state == RTE_DIST_RING_RETIRING && wk->active)
+			ring_retire(dr, part, part_id, wk);
+		else if (state == RTE_DIST_RING_ACTIVE && !wk->active)
+			wk->active = 1;
+	}
+}
+
+/* enqueue the staged packets of a worker in its ring */
+static void
+ring_push(struct rte_distributor_ring *dr,
+		struct rte_distributor_ring_part *part, unsigned int part_id,
+		struct rte_distributor_ring_worker *wk)
+{
+	unsigned int n = 0;
+
+	/* keep the tags of the packets pending within the tag FIFO */
+	ring_ack(part, wk);
+
+	while (n < wk->count) {
+		n += rte_ring_enqueue_burst(wk->to_w, (void **)&wk->stage[n],
+				wk->count - n, NULL);
+		if (n == wk->count)
+			break;
+		rte_pause();
+		/* a worker leaving with a full ring won't make room */
+		if (__atomic_load_n(&wk->state, __ATOMIC_RELAXED) ==
+				RTE_DIST_RING_RETIRING) {
+			memmove(wk->stage, &wk->stage[n],
+					(wk->count - n) * sizeof(wk->stage[0]));
+			wk->count -= n;
+			n = 0;
+			if (ring_retire(dr, part, part_id, wk))
+				return;
+		}
+	}
+	wk->count = 0;
+}
+
+/*
+ * Pick the worker for a packet of the given flow: the worker the flow is
+ * in flight on, otherwise the least busy of the worker the flow last went
+ * to and the next worker in turn. Return -1 if no worker is active.
+ */
+static inline int
+ring_pick(struct rte_distributor_ring *dr,
+		struct rte_distributor_ring_part *part, unsigned int part_id,
+		uint16_t flow)
+{
+	struct rte_distributor_ring_worker *wk, *owner = NULL;
+	unsigned int i, next;
+
+	if (part->inflight[flow] != 0)
+		return part->owner[flow] - 1;
+
+	if (part->owner[flow] != 0) {
+		owner = ring_worker(dr, part_id, part->owner[flow] - 1);
+		if (!owner->active)
+			owner = NULL;
+	}
+
+	for (i = 0; i < part->num_workers; i++) {
+		next = part->next;
+		wk = ring_worker(dr, part_id, next);
+		if (!wk->active) {
+			if (++part->next == part->num_workers)
+				part->next = 0;
+			continue;
+		}
+		/* move on only when the next worker is given the flow */
+		if (owner == NULL ||
+				wk->sent - wk->acked < owner->sent - owner->acked) {
+			if (++part->next == part->num_workers)
+				part->next = 0;
+			part->owner[flow] = next + 1;
+		}
+		return part->owner[flow] - 1;
+	}
+
+	return owner != NULL ? part->owner[flow] - 1 : -1;
+}
+
+static void
+ring_dispatch(struct rte_distributor_ring *dr,
+		struct rte_distributor_ring_part *part, unsigned int part_id,
+		struct rte_mbuf **mbufs, unsigned int num_mbufs)
+{
+	struct rte_distributor_ring_worker *wk;
+	unsigned int i;
+	uint16_t flow;
+	int w;
+
+	for (i = 0; i < num_mbufs; i++) {
+		flow = mbufs[i]->hash.usr & (RTE_DIST_RING_FLOWS - 1);
+
+		while ((w = ring_pick(dr, part, part_id, flow)) < 0) {
+			/* wait for a worker to come back */
+			rte_pause();
+			ring_reap(dr, part, part_id);
+		}
+
+		wk = ring_worker(dr, part_id, w);
+		wk->tags[wk->sent++ & wk->tag_mask] = flow;
+		part->inflight[flow]++;
+		wk->stage[wk->count++] = mbufs[i];
+		if (wk->count == RTE_DIST_RING_BURST)
+			ring_push(dr, part, part_id, wk);
+	}
+}
+
+static void
+ring_push_all(struct rte_distributor_ring *dr,
+		struct rte_distributor_ring_part *part, unsigned int part_id)
+{
+	struct rte_distributor_ring_worker *wk;
+	unsigned int i;
+
+	for (i = 0; i < part->num_workers; i++) {
+		wk = ring_worker(dr, part_id, i);
+		if (wk->count != 0 && wk->active)
+			ring_push(dr, part, part_id, wk);
+	}
+}
+
+int
+rte_distributor_process_ring(struct rte_distributor_ring *dr,
+		unsigned int part_id, struct rte_mbuf **mbufs,
+		unsigned int num_mbufs)
+{
+	struct rte_distributor_ring_part *part = dr->parts[part_id];
+
+	ring_reap(dr, part, part_id);
+
+	if (unlikely(num_mbufs == 0)) {
+		ring_push_all(dr, part, part_id);
+		/* Wake up the idle workers with an empty burst. */
+		__atomic_store_n(&part->kick, part->kick + 1,
+				__ATOMIC_RELAXED);
+		return 0;
+	}
+
+	ring_dispatch(dr, part, part_id, mbufs, num_mbufs);
+	ring_push_all(dr, part, part_id);
+
+	return num_mbufs;
+}
+
+int
+rte_distributor_returned_pkts_ring(struct rte_distributor_ring *dr,
+		unsigned int part_id, struct rte_mbuf **mbufs,
+		unsigned int max_mbufs)
+{
+	struct rte_distributor_ring_part *part = dr->parts[part_id];
+	struct rte_distributor_ring_worker *wk;
+	unsigned int i, w, count = 0;
+
+	for (i = 0; i < part->num_workers && count < max_mbufs; i++) {
+		w = part->ret_next;
+		if (++part->ret_next == part->num_workers)
+			part->ret_next = 0;
+		wk = ring_worker(dr, part_id, w);
+		count += rte_ring_dequeue_burst(wk->from_w,
+				(void **)&mbufs[count], max_mbufs - count,
+				NULL);
+	}
+
+	return count;
+}
+
+static unsigned int
+ring_outstanding(struct rte_distributor_ring *dr,
+		struct rte_distributor_ring_part *part, unsigned int part_id)
+{
+	struct rte_distributor_ring_worker *wk;
+	unsigned int i, outstanding = 0;
+
+	for (i = 0; i < part->num_workers; i++) {
+		wk = ring_worker(dr, part_id, i);
+		outstanding += wk->sent - wk->acked;
+	}
+
+	return outstanding;
+}
+
+int
+rte_distributor_flush_ring(struct rte_distributor_ring *dr)
+{
+	struct rte_distributor_ring_part *part;
+	unsigned int p, flushed = 0;
+
+	for (p = 0; p < dr->num_parts; p++) {
+		part = dr->parts[p];
+		ring_reap(dr, part, p);
+		flushed += ring_outstanding(dr, part, p);
+
+		while (ring_outstanding(dr, part, p) > 0) {
+			rte_distributor_process_ring(dr, p, NULL, 0);
+			rte_pause();
+		}
+
+		/*
+		 * Send empty burst to all workers to allow them to exit
+		 * gracefully, should they need to.
+		 */
+		rte_distributor_process_ring(dr, p, NULL, 0);
+	}
+
+	return flushed;
+}
+
+void
+rte_distributor_clear_returns_ring(struct rte_distributor_ring *dr)
+{
+	struct rte_mbuf *mbufs[RTE_DIST_RING_BURST];
+	unsigned int w;
+
+	/* throw away returns, so workers can exit */
+	for (w = 0; w < dr->num_workers; w++)
+		while (rte_ring_dequeue_burst(dr->workers[w].from_w,
+				(void **)mbufs, RTE_DIST_RING_BURST, NULL) != 0)
+			;
+}
+
+static void
+ring_free(struct rte_distributor_ring *dr)
+{
+	unsigned int i;
+
+	if (dr->workers != NULL) {
+		for (i = 0; i < dr->num_workers; i++) {
+			rte_free(dr->workers[i].to_w);
+			rte_free(dr->workers[i].from_w);
+			rte_free(dr->workers[i].tags);
+			rte_free(dr->workers[i].takeback);
+		}
+		rte_free(dr->workers);
+	}
+	if (dr->parts != NULL) {
+		for (i = 0; i < dr->num_parts; i++) {
+			rte_free(dr->parts[i]);
+		}
+		rte_free(dr->parts);
+	}
+	rte_free(dr);
+}
+
+static struct rte_ring *
+ring_alloc(const char *name, unsigned int worker_id, const char *dir,
+		unsigned int size, int socket_id)
+{
+	char ring_name[RTE_RING_NAMESIZE];
+	struct rte_ring *r;
+
+	/* not looked up by name, so not registered */
+	r = rte_zmalloc_socket(name, rte_ring_get_memsize(size),
+			RTE_CACHE_LINE_SIZE, socket_id);
+	if (r == NULL)
+		return NULL;
+	snprintf(ring_name, sizeof(ring_name), "%s_%u%s", name, worker_id,
+			dir);
+	rte_ring_init(r, ring_name, size, RING_F_SP_ENQ | RING_F_SC_DEQ);
+
+	return r;
+}
+
+/* creates the ring mode part of a distributor instance */
+struct rte_distributor_ring *
+rte_distributor_create_ring_mode(const struct rte_distributor_ring_params *p)
+{
+	struct rte_distributor_ring *dr;
+	struct rte_distributor_ring_worker *wk;
+	unsigned int i, size, num_parts;
+
+	num_parts = (p->num_partitions == 0) ? 1 : p->num_partitions;
+	size = (p->ring_size == 0) ? RTE_DIST_RING_DEFAULT_SIZE : p->ring_size;
+	if (p->name == NULL || p->num_workers == 0 ||
+			p->num_workers > RTE_DIST_RING_MAX_WORKERS ||
+			num_parts > p->num_workers ||
+			!rte_is_power_of_2(size) ||
+			size < RTE_DIST_RING_BURST * 2 ||
+			size > RTE_DIST_RING_MAX_SIZE) {
+		rte_errno = EINVAL;
+		return NULL;
+	}
+
+	dr = rte_zmalloc_socket(p->name, sizeof(*dr), RTE_CACHE_LINE_SIZE,
+			p->socket_id);
+	if (dr == NULL)
+		goto nomem;
+	strlcpy(dr->name, p->name, sizeof(dr->name));
+	dr->num_workers = p->num_workers;
+	dr->num_parts = num_parts;
+	dr->ring_size = size;
+
+	dr->workers = rte_zmalloc_socket(p->name,
+			sizeof(*dr->workers) * dr->num_workers,
+			RTE_CACHE_LINE_SIZE, p->socket_id);
+	dr->parts = rte_zmalloc_socket(p->name,
+			sizeof(*dr->parts) * num_parts, 0, p->socket_id);
+	if (dr->workers == NULL || dr->parts == NULL)
+		goto nomem;
+
+	for (i = 0; i < num_parts; i++) {
+		dr->parts[i] = rte_zmalloc_socket(p->name,
+				sizeof(*dr->parts[i]), RTE_CACHE_LINE_SIZE,
+				p->socket_id);
+		if (dr->parts[i] == NULL)
+			goto nomem;
+		dr->parts[i]->num_workers = (dr->num_workers - i +
+				num_parts - 1) / num_parts;
+	}
+
+	for (i = 0; i < dr->num_workers; i++) {
+		wk = &dr->workers[i];
+		wk->active = 1;
+		wk->to_w = ring_alloc(dr->name, i, "i", size, p->socket_id);
+		wk->from_w = ring_alloc(dr->name, i, "o", size * 2,
+				p->socket_id);
+		/* sent and not acked packets are at most a full ring, the
+		 * staging buffer and a worker burst
+		 */
+		wk->tag_mask = size * 2 - 1;
+		wk->tags = rte_zmalloc_socket(p->name,
+				sizeof(uint16_t) * size * 2, 0, p->socket_id);
+		/* room for a full ring and staging buffer */
+		wk->takeback = rte_zmalloc_socket(p->name,
+				sizeof(struct rte_mbuf *) *
+				(size + RTE_DIST_RING_BURST), 0, p->socket_id);
+		if (wk->to_w == NULL || wk->from_w == NULL ||
+				wk->tags == NULL || wk->takeback == NULL)
+			goto nomem;
+	}
+
+	return dr;
+
+nomem:
+	if (dr != NULL)
+		ring_free(dr);
+	rte_errno = ENOMEM;
+	return NULL;
+}
@@ -15,176 +15,21 @@
 #include <rte_errno.h>
 #include <rte_memory.h>
 #include <rte_branch_prediction.h>
+#include <rte_cpuflags.h>
 
 #include <rte_fib.h>
 #include <rte_rib.h>
 #include "dir24_8.h"
 
-#define DIR24_8_NAMESIZE	64
-
-#define DIR24_8_TBL24_NUM_ENT		(1 << 24)
-#define DIR24_8_TBL8_GRP_NUM_ENT	256U
-#define DIR24_8_EXT_ENT			1
-#define DIR24_8_TBL24_MASK		0xffffff00
-
-#define BITMAP_SLAB_BIT_SIZE_LOG2	6
-#define BITMAP_SLAB_BIT_SIZE		(1 << BITMAP_SLAB_BIT_SIZE_LOG2)
-#define BITMAP_SLAB_BITMASK		(BITMAP_SLAB_BIT_SIZE - 1)
-
-struct dir24_8_tbl {
-	uint32_t	number_tbl8s;	/**< Total number of tbl8s */
-	uint32_t	rsvd_tbl8s;	/**< Number of reserved tbl8s */
-	uint32_t	cur_tbl8s;	/**< Current number of tbl8s */
-	enum rte_fib_dir24_8_nh_sz	nh_sz;	/**< Size of nexthop entry */
-	uint64_t	def_nh;		/**< Default next hop */
-	uint64_t	*tbl8;		/**< tbl8 table. */
-	uint64_t	*tbl8_idxes;	/**< bitmap containing free tbl8 idxes*/
-	/* tbl24 table. */
-	__extension__ uint64_t	tbl24[0] __rte_cache_aligned;
-};
-
-#define ROUNDUP(x, y)	 RTE_ALIGN_CEIL(x, (1 << (32 - y)))
-
-enum lookup_type {
-	MACRO,
-	INLINE,
-	UNI
-};
-enum lookup_type test_lookup = MACRO;
-
-static inline void *
-get_tbl24_p(struct dir24_8_tbl *dp, uint32_t ip, uint8_t nh_sz)
-{
-	return (void *)&((uint8_t *)dp->tbl24)[(ip &
-		DIR24_8_TBL24_MASK) >> (8 - nh_sz)];
-}
-
-static inline  uint8_t
-bits_in_nh(uint8_t nh_sz)
-{
-	return 8 * (1 << nh_sz);
-}
-
-static inline uint64_t
-get_max_nh(uint8_t nh_sz)
-{
-	return ((1ULL << (bits_in_nh(nh_sz) - 1)) - 1);
-}
-
-static  inline uint32_t
-get_tbl24_idx(uint32_t ip)
-{
-	return ip >> 8;
-}
-
-static  inline uint32_t
-get_tbl8_idx(uint32_t res, uint32_t ip)
-{
-	return (res >> 1) * DIR24_8_TBL8_GRP_NUM_ENT + (uint8_t)ip;
-}
-
-static inline uint64_t
-lookup_msk(uint8_t nh_sz)
-{
-	return ((1ULL << ((1 << (nh_sz + 3)) - 1)) << 1) - 1;
-}
+#ifdef CC_AVX512_SUPPORT
 
-static inline uint8_t
-get_psd_idx(uint32_t val, uint8_t nh_sz)
-{
-	return val & ((1 << (3 - nh_sz)) - 1);
-}
+#include "dir24_8_avx512.h"
 
-static inline uint32_t
-get_tbl_idx(uint32_t val, uint8_t nh_sz)
-{
-	return val >> (3 - nh_sz);
-}
-
-static inline uint64_t
-get_tbl24(struct dir24_8_tbl *dp, uint32_t ip, uint8_t nh_sz)
-{
-	return ((dp->tbl24[get_tbl_idx(get_tbl24_idx(ip), nh_sz)] >>
-		(get_psd_idx(get_tbl24_idx(ip), nh_sz) *
-		bits_in_nh(nh_sz))) & lookup_msk(nh_sz));
-}
-
-static inline uint64_t
-get_tbl8(struct dir24_8_tbl *dp, uint32_t res, uint32_t ip, uint8_t nh_sz)
-{
-	return ((dp->tbl8[get_tbl_idx(get_tbl8_idx(res, ip), nh_sz)] >>
-		(get_psd_idx(get_tbl8_idx(res, ip), nh_sz) *
-		bits_in_nh(nh_sz))) & lookup_msk(nh_sz));
-}
-
-static inline int
-is_entry_extended(uint64_t ent)
-{
-	return (ent & DIR24_8_EXT_ENT) == DIR24_8_EXT_ENT;
-}
-
-#define LOOKUP_FUNC(suffix, type, bulk_prefetch, nh_sz)			\
-static void dir24_8_lookup_bulk_##suffix(void *p, const uint32_t *ips,	\
-	uint64_t *next_hops, const unsigned int n)			\
-{									\
-	struct dir24_8_tbl *dp = (struct dir24_8_tbl *)p;		\
-	uint64_t tmp;							\
-	uint32_t i;							\
-	uint32_t prefetch_offset =					\
-		RTE_MIN((unsigned int)bulk_prefetch, n);		\
-									\
-	for (i = 0; i < prefetch_offset; i++)				\
-		rte_prefetch0(get_tbl24_p(dp, ips[i], nh_sz));		\
-	for (i = 0; i < (n - prefetch_offset); i++) {			\
-		rte_prefetch0(get_tbl24_p(dp,				\
-			ips[i + prefetch_offset], nh_sz));		\
-		tmp = ((type *)dp->tbl24)[ips[i] >> 8];			\
-		if (unlikely(is_entry_extended(tmp)))			\
-			tmp = ((type *)dp->tbl8)[(uint8_t)ips[i] +	\
-				((tmp >> 1) * DIR24_8_TBL8_GRP_NUM_ENT)]; \
-		next_hops[i] = tmp >> 1;				\
-	}								\
-	for (; i < n; i++) {						\
-		tmp = ((type *)dp->tbl24)[ips[i] >> 8];			\
-		if (unlikely(is_entry_extended(tmp)))			\
-			tmp = ((type *)dp->tbl8)[(uint8_t)ips[i] +	\
-				((tmp >> 1) * DIR24_8_TBL8_GRP_NUM_ENT)]; \
-		next_hops[i] = tmp >> 1;				\
-	}								\
-}									\
-
-LOOKUP_FUNC(1b, uint8_t, 5, 0)
-LOOKUP_FUNC(2b, uint16_t, 6, 1)
-LOOKUP_FUNC(4b, uint32_t, 15, 2)
-LOOKUP_FUNC(8b, uint64_t, 12, 3)
+#endif /* CC_AVX512_SUPPORT */
 
-static inline void
-dir24_8_lookup_bulk(struct dir24_8_tbl *dp, const uint32_t *ips,
-	uint64_t *next_hops, const unsigned int n, uint8_t nh_sz)
-{
-	uint64_t tmp;
-	uint32_t i;
-	uint32_t prefetch_offset = RTE_MIN(15U, n);
-
-	for (i = 0; i < prefetch_offset; i++)
-		rte_prefetch0(get_tbl24_p(dp, ips[i], nh_sz));
-	for (i = 0; i < (n - prefetch_offset); i++) {
-		rte_prefetch0(get_tbl24_p(dp, ips[i + prefetch_offset],
-			nh_sz));
-		tmp = get_tbl24(dp, ips[i], nh_sz);
-		if (unlikely(is_entry_extended(tmp)))
-			tmp = get_tbl8(dp, tmp, ips[i], nh_sz);
-
-		next_hops[i] = tmp >> 1;
-	}
-	for (; i < n; i++) {
-		tmp = get_tbl24(dp, ips[i], nh_sz);
-		if (unlikely(is_entry_extended(tmp)))
-			tmp = get_tbl8(dp, tmp, ips[i], nh_sz);
+#define DIR24_8_NAMESIZE	64
 
-		next_hops[i] = tmp >> 1;
-	}
-}
+#define ROUNDUP(x, y)	 RTE_ALIGN_CEIL(x, (1 << (32 - y)))
 
 static void
 dir24_8_lookup_bulk_0(void *p, const uint32_t *ips,
@@ -252,35 +97,91 @@ dir24_8_lookup_bulk_uni(void *p, const uint32_t *ips,
 	}
 }
 
+static rte_fib_lookup_fn_t
+get_scalar_fn(enum rte_fib_dir24_8_nh_sz nh_sz)
+{
+	switch (nh_sz) {
+	case RTE_FIB_DIR24_8_1B:
+		return dir24_8_lookup_bulk_1b;
+	case RTE_FIB_DIR24_8_2B:
+		return dir24_8_lookup_bulk_2b;
+	case RTE_FIB_DIR24_8_4B:
+		return dir24_8_lookup_bulk_4b;
+	case RTE_FIB_DIR24_8_8B:
+		return dir24_8_lookup_bulk_8b;
+	default:
+		return NULL;
+	}
+}
+
+static rte_fib_lookup_fn_t
+get_scalar_fn_inlined(enum rte_fib_dir24_8_nh_sz nh_sz)
+{
+	switch (nh_sz) {
+	case RTE_FIB_DIR24_8_1B:
+		return dir24_8_lookup_bulk_0;
+	case RTE_FIB_DIR24_8_2B:
+		return dir24_8_lookup_bulk_1;
+	case RTE_FIB_DIR24_8_4B:
+		return dir24_8_lookup_bulk_2;
+	case RTE_FIB_DIR24_8_8B:
+		return dir24_8_lookup_bulk_3;
+	default:
+		return NULL;
+	}
+}
+
+static rte_fib_lookup_fn_t
+get_vector_fn(struct dir24_8_tbl *dp)
+{
+#ifdef CC_AVX512_SUPPORT
+	if (rte_cpu_get_flag_enabled(RTE_CPUFLAG_AVX512F) <= 0)
+		return NULL;
+
+	switch (dp->nh_sz) {
+	case RTE_FIB_DIR24_8_1B:
+		return rte_dir24_8_vec_lookup_bulk_1b;
+	case RTE_FIB_DIR24_8_2B:
+		return rte_dir24_8_vec_lookup_bulk_2b;
+	case RTE_FIB_DIR24_8_4B:
+		/* Gather indexes are signed 32 bits */
+		if ((uint64_t)dp->number_tbl8s * DIR24_8_TBL8_GRP_NUM_ENT >
+				INT32_MAX)
+			return NULL;
+		return rte_dir24_8_vec_lookup_bulk_4b;
+	case RTE_FIB_DIR24_8_8B:
+		return rte_dir24_8_vec_lookup_bulk_8b;
+	default:
+		return NULL;
+	}
+#else
+	RTE_SET_USED(dp);
+	return NULL;
+#endif
+}
+
 rte_fib_lookup_fn_t
-dir24_8_get_lookup_fn(struct rte_fib_conf *fib_conf)
-{
-	enum rte_fib_dir24_8_nh_sz nh_sz = fib_conf->dir24_8.nh_sz;
-
-	if (test_lookup == MACRO) {
-		switch (nh_sz) {
-		case RTE_FIB_DIR24_8_1B:
-			return dir24_8_lookup_bulk_1b;
-		case RTE_FIB_DIR24_8_2B:
-			return dir24_8_lookup_bulk_2b;
-		case RTE_FIB_DIR24_8_4B:
-			return dir24_8_lookup_bulk_4b;
-		case RTE_FIB_DIR24_8_8B:
-			return dir24_8_lookup_bulk_8b;
-		}
-	} else if (test_lookup == INLINE) {
-		switch (nh_sz) {
-		case RTE_FIB_DIR24_8_1B:
-			return dir24_8_lookup_bulk_0;
-		case RTE_FIB_DIR24_8_2B:
-			return dir24_8_lookup_bulk_1;
-		case RTE_FIB_DIR24_8_4B:
-			return dir24_8_lookup_bulk_2;
-		case RTE_FIB_DIR24_8_8B:
-			return dir24_8_lookup_bulk_3;
-		}
-	} else
+dir24_8_get_lookup_fn(void *p, enum rte_fib_lookup_type type)
+{
+	struct dir24_8_tbl *dp = (struct dir24_8_tbl *)p;
+	rte_fib_lookup_fn_t ret_fn;
+
+	switch (type) {
+	case RTE_FIB_LOOKUP_DIR24_8_SCALAR_MACRO:
+		return get_scalar_fn(dp->nh_sz);
+	case RTE_FIB_LOOKUP_DIR24_8_SCALAR_INLINE:
+		return get_scalar_fn_inlined(dp->nh_sz);
+	case RTE_FIB_LOOKUP_DIR24_8_SCALAR_UNI:
 		return dir24_8_lookup_bulk_uni;
+	case RTE_FIB_LOOKUP_DIR24_8_VECTOR_AVX512:
+		return get_vector_fn(dp);
+	case RTE_FIB_LOOKUP_DEFAULT:
+		ret_fn = get_vector_fn(dp);
+		return (ret_fn != NULL) ? ret_fn : get_scalar_fn(dp->nh_sz);
+	default:
+		return NULL;
+	}
+
 	return NULL;
 }
 
@@ -316,9 +217,11 @@ write_to_fib(void *ptr, uint64_t val, enum rte_fib_dir24_8_nh_sz size, int n)
 static int
 tbl8_get_idx(struct dir24_8_tbl *dp)
 {
+	unsigned int freed;
 	uint32_t i;
 	int bit_idx;
 
+retry:
 	for (i = 0; (i < (dp->number_tbl8s >> BITMAP_SLAB_BIT_SIZE_LOG2)) &&
 			(dp->tbl8_idxes[i] == UINT64_MAX); i++)
 		;
@@ -327,6 +230,18 @@ tbl8_get_idx(struct dir24_8_tbl *dp)
 		dp->tbl8_idxes[i] |= (1ULL << bit_idx);
 		return (i << BITMAP_SLAB_BIT_SIZE_LOG2) + bit_idx;
 	}
+	/*
+	 * Released tbl8 groups may still be waiting in the defer queue,
+	 * wait for the readers and take them back.
+	 */
+	if (dp->dq != NULL) {
+		freed = 0;
+		rte_rcu_qsbr_synchronize(dp->v, RTE_QSBR_THRID_INVALID);
+		rte_rcu_qsbr_dq_reclaim(dp->dq, dp->number_tbl8s,
+			&freed, NULL, NULL);
+		if (freed != 0)
+			goto retry;
+	}
 	return -ENOSPC;
 }
 
@@ -353,10 +268,50 @@ tbl8_alloc(struct dir24_8_tbl *dp, uint64_t nh)
 	write_to_fib((void *)tbl8_ptr, nh|
 		DIR24_8_EXT_ENT, dp->nh_sz,
 		DIR24_8_TBL8_GRP_NUM_ENT);
+	/*
+	 * The group must be initialized before a tbl24 entry pointing
+	 * to it becomes visible to the readers.
+	 */
+	rte_smp_wmb();
 	dp->cur_tbl8s++;
 	return tbl8_idx;
 }
 
+static void
+tbl8_cleanup_and_free(struct dir24_8_tbl *dp, uint64_t tbl8_idx)
+{
+	uint8_t *ptr = (uint8_t *)dp->tbl8 +
+		((tbl8_idx * DIR24_8_TBL8_GRP_NUM_ENT) << dp->nh_sz);
+
+	memset(ptr, 0, DIR24_8_TBL8_GRP_NUM_ENT << dp->nh_sz);
+	tbl8_free_idx(dp, tbl8_idx);
+	dp->cur_tbl8s--;
+}
+
+static void
+__rcu_qsbr_free_resource(void *p, void *data, unsigned int n __rte_unused)
+{
+	tbl8_cleanup_and_free((struct dir24_8_tbl *)p, *(uint32_t *)data);
+}
+
+/*
+ * Release a tbl8 group no longer referenced by tbl24. Readers may still
+ * be walking it, so with RCU it is only reused after a grace period.
+ */
+static void
+tbl8_free(struct dir24_8_tbl *dp, uint64_t tbl8_idx)
+{
+	uint32_t idx = tbl8_idx;
+
+	if (dp->v != NULL) {
+		if (dp->rcu_mode == RTE_FIB_QSBR_MODE_DQ &&
+				rte_rcu_qsbr_dq_enqueue(dp->dq, &idx) == 0)
+			return;
+		rte_rcu_qsbr_synchronize(dp->v, RTE_QSBR_THRID_INVALID);
+	}
+	tbl8_cleanup_and_free(dp, tbl8_idx);
+}
+
 static void
 tbl8_recycle(struct dir24_8_tbl *dp, uint32_t ip, uint64_t tbl8_idx)
 {
@@ -378,8 +333,6 @@ tbl8_recycle(struct dir24_8_tbl *dp, uint32_t ip, uint64_t tbl8_idx)
 		}
 		((uint8_t *)dp->tbl24)[ip >> 8] =
 			nh & ~DIR24_8_EXT_ENT;
-		for (i = 0; i < DIR24_8_TBL8_GRP_NUM_ENT; i++)
-			ptr8[i] = 0;
 		break;
 	case RTE_FIB_DIR24_8_2B:
 		ptr16 = &((uint16_t *)dp->tbl8)[tbl8_idx *
@@ -391,8 +344,6 @@ tbl8_recycle(struct dir24_8_tbl *dp, uint32_t ip, uint64_t tbl8_idx)
 		}
 		((uint16_t *)dp->tbl24)[ip >> 8] =
 			nh & ~DIR24_8_EXT_ENT;
-		for (i = 0; i < DIR24_8_TBL8_GRP_NUM_ENT; i++)
-			ptr16[i] = 0;
 		break;
 	case RTE_FIB_DIR24_8_4B:
 		ptr32 = &((uint32_t *)dp->tbl8)[tbl8_idx *
@@ -404,8 +355,6 @@ tbl8_recycle(struct dir24_8_tbl *dp, uint32_t ip, uint64_t tbl8_idx)
 		}
 		((uint32_t *)dp->tbl24)[ip >> 8] =
 			nh & ~DIR24_8_EXT_ENT;
-		for (i = 0; i < DIR24_8_TBL8_GRP_NUM_ENT; i++)
-			ptr32[i] = 0;
 		break;
 	case RTE_FIB_DIR24_8_8B:
 		ptr64 = &((uint64_t *)dp->tbl8)[tbl8_idx *
@@ -417,12 +366,9 @@ tbl8_recycle(struct dir24_8_tbl *dp, uint32_t ip, uint64_t tbl8_idx)
 		}
 		((uint64_t *)dp->tbl24)[ip >> 8] =
 			nh & ~DIR24_8_EXT_ENT;
-		for (i = 0; i < DIR24_8_TBL8_GRP_NUM_ENT; i++)
-			ptr64[i] = 0;
 		break;
 	}
-	tbl8_free_idx(dp, tbl8_idx);
-	dp->cur_tbl8s--;
+	tbl8_free(dp, tbl8_idx);
 }
 
 static int
@@ -660,6 +606,390 @@ dir24_8_modify(struct rte_fib *fib, uint32_t ip, uint8_t depth,
 	return -EINVAL;
 }
 
+/*
+ * A route of a bulk update is sorted as a 64-bit key made of its prefix,
+ * its depth and its index in the batch, so covering prefixes come first
+ * and the duplicates of a prefix stay in the batch order.
+ */
+#define BULK_IDX_BITS		26
+#define BULK_MAX		(1U << BULK_IDX_BITS)
+#define BULK_KEY(ip, depth, idx)	(((uint64_t)(ip) << 32) | \
+	((uint64_t)(depth) << BULK_IDX_BITS) | (idx))
+#define BULK_KEY_IP(key)	((uint32_t)((key) >> 32))
+#define BULK_KEY_DEPTH(key)	((uint8_t)(((key) >> BULK_IDX_BITS) & 0x3f))
+#define BULK_KEY_IDX(key)	((uint32_t)((key) & (BULK_MAX - 1)))
+#define BULK_KEY_PREFIX(key)	((key) >> BULK_IDX_BITS)
+
+/* LSD radix sort of the keys, 8 bits at a time */
+static void
+bulk_sort(uint64_t *keys, uint64_t *tmp, unsigned int n)
+{
+	uint32_t cnt[UINT8_MAX + 1];
+	uint64_t *src = keys, *dst = tmp, *swap;
+	unsigned int i, shift;
+	uint32_t sum, c;
+
+	for (shift = 0; shift < 64; shift += 8) {
+		memset(cnt, 0, sizeof(cnt));
+		for (i = 0; i < n; i++)
+			cnt[(src[i] >> shift) & UINT8_MAX]++;
+		/* all the keys share this byte */
+		if (cnt[(src[0] >> shift) & UINT8_MAX] == n)
+			continue;
+		for (i = 0, sum = 0; i <= UINT8_MAX; i++) {
+			c = cnt[i];
+			cnt[i] = sum;
+			sum += c;
+		}
+		for (i = 0; i < n; i++)
+			dst[cnt[(src[i] >> shift) & UINT8_MAX]++] = src[i];
+		swap = src;
+		src = dst;
+		dst = swap;
+	}
+	if (src != keys)
+		memcpy(keys, src, n * sizeof(*keys));
+}
+
+static inline int
+prefix_is_covered(uint32_t sup_ip, uint8_t sup_depth, uint32_t ip,
+	uint8_t depth)
+{
+	return (sup_depth <= depth) &&
+		((ip & rte_rib_depth_to_mask(sup_depth)) == sup_ip);
+}
+
+/* How to undo the RIB change of a bulk route */
+enum bulk_undo_op {
+	BULK_UNDO_SET_NH,	/**< restore the previous next hop */
+	BULK_UNDO_REMOVE,	/**< remove the added prefix */
+	BULK_UNDO_INSERT,	/**< insert the deleted prefix again */
+};
+
+struct bulk_undo {
+	uint64_t nh;		/**< next hop before the update */
+	uint8_t op;		/**< enum bulk_undo_op */
+	uint8_t rsvd;		/**< the update changed rsvd_tbl8s */
+};
+
+/*
+ * Update the RIB for one route of a bulk request, following
+ * dir24_8_modify() but leaving the dataplane untouched.
+ * Return 1 if the dataplane range of the prefix has to be rewritten, with
+ * upd_node set to its RIB node, or NULL if the prefix was removed, and
+ * undo set to revert the change.
+ */
+static int
+rib_modify(struct dir24_8_tbl *dp, struct rte_rib *rib, uint32_t ip,
+	uint8_t depth, uint64_t next_hop, int op, int *ret,
+	struct rte_rib_node **upd_node, struct bulk_undo *undo)
+{
+	struct rte_rib_node *tmp = NULL;
+	struct rte_rib_node *node;
+	uint64_t node_nh;
+
+	*ret = 0;
+	if ((depth > RTE_FIB_MAXDEPTH) ||
+			((op == RTE_FIB_ADD) &&
+			(next_hop > get_max_nh(dp->nh_sz)))) {
+		*ret = -EINVAL;
+		return 0;
+	}
+
+	node = rte_rib_lookup_exact(rib, ip, depth);
+	switch (op) {
+	case RTE_FIB_ADD:
+		if (node != NULL) {
+			rte_rib_get_nh(node, &node_nh);
+			if (node_nh == next_hop)
+				return 0;
+			rte_rib_set_nh(node, next_hop);
+			*upd_node = node;
+			undo->nh = node_nh;
+			undo->op = BULK_UNDO_SET_NH;
+			undo->rsvd = 0;
+			return 1;
+		}
+		if (depth > 24) {
+			tmp = rte_rib_get_nxt(rib, ip, 24, NULL,
+				RTE_RIB_GET_NXT_COVER);
+			if ((tmp == NULL) &&
+					(dp->rsvd_tbl8s >= dp->number_tbl8s)) {
+				*ret = -ENOSPC;
+				return 0;
+			}
+		}
+		node = rte_rib_insert(rib, ip, depth);
+		if (node == NULL) {
+			*ret = -rte_errno;
+			return 0;
+		}
+		rte_rib_set_nh(node, next_hop);
+		undo->op = BULK_UNDO_REMOVE;
+		undo->rsvd = 0;
+		if ((depth > 24) && (tmp == NULL)) {
+			dp->rsvd_tbl8s++;
+			undo->rsvd = 1;
+		}
+		*upd_node = node;
+		return 1;
+	case RTE_FIB_DEL:
+		if (node == NULL) {
+			*ret = -ENOENT;
+			return 0;
+		}
+		rte_rib_get_nh(node, &undo->nh);
+		undo->op = BULK_UNDO_INSERT;
+		undo->rsvd = 0;
+		rte_rib_remove(rib, ip, depth);
+		*upd_node = NULL;
+		if (depth > 24) {
+			tmp = rte_rib_get_nxt(rib, ip, 24, NULL,
+				RTE_RIB_GET_NXT_COVER);
+			if (tmp == NULL) {
+				dp->rsvd_tbl8s--;
+				undo->rsvd = 1;
+			}
+		}
+		return 1;
+	default:
+		*ret = -EINVAL;
+		return 0;
+	}
+}
+
+/*
+ * Revert the RIB change of a bulk route.
+ * Return 0 if the route is back to its previous state.
+ */
+static int
+rib_undo(struct dir24_8_tbl *dp, struct rte_rib *rib, uint32_t ip,
+	uint8_t depth, const struct bulk_undo *undo)
+{
+	struct rte_rib_node *node;
+
+	switch (undo->op) {
+	case BULK_UNDO_SET_NH:
+		node = rte_rib_lookup_exact(rib, ip, depth);
+		rte_rib_set_nh(node, undo->nh);
+		break;
+	case BULK_UNDO_REMOVE:
+		rte_rib_remove(rib, ip, depth);
+		if (undo->rsvd)
+			dp->rsvd_tbl8s--;
+		break;
+	case BULK_UNDO_INSERT:
+		node = rte_rib_insert(rib, ip, depth);
+		if (node == NULL)
+			return -rte_errno;
+		rte_rib_set_nh(node, undo->nh);
+		if (undo->rsvd)
+			dp->rsvd_tbl8s++;
+		break;
+	}
+	return 0;
+}
+
+/*
+ * Rewrite the dataplane range of each updated prefix once, in address
+ * order. The range of a prefix left in the RIB excludes its more specific
+ * routes, so it never overlaps the one of another prefix still in the RIB.
+ * A deleted prefix is skipped when its range was already rewritten as a
+ * part of an updated covering prefix.
+ */
+static int
+dp_update(struct dir24_8_tbl *dp, struct rte_rib *rib,
+	const uint64_t *keys, struct rte_rib_node **nodes, unsigned int n,
+	unsigned int *failed)
+{
+	uint32_t stack_ip[RTE_FIB_MAXDEPTH + 1];
+	uint8_t stack_depth[RTE_FIB_MAXDEPTH + 1];
+	struct rte_rib_node *node;
+	unsigned int i, top = 0;
+	uint32_t ip;
+	uint64_t nh;
+	uint8_t depth, par_depth;
+	int ret;
+
+	for (i = 0; i < n; i++) {
+		/* the last duplicate holds the final state of the prefix */
+		if ((i + 1 < n) && (BULK_KEY_PREFIX(keys[i]) ==
+				BULK_KEY_PREFIX(keys[i + 1])))
+			continue;
+		ip = BULK_KEY_IP(keys[i]);
+		depth = BULK_KEY_DEPTH(keys[i]);
+		/* keep only the rewritten prefixes covering this one */
+		while ((top > 0) && !prefix_is_covered(stack_ip[top - 1],
+				stack_depth[top - 1], ip, depth))
+			top--;
+
+		node = nodes[i];
+		if (node != NULL)
+			rte_rib_get_nh(node, &nh);
+		else {
+			/* find the longest remaining covering route */
+			node = rte_rib_lookup(rib, ip);
+			while (node != NULL) {
+				rte_rib_get_depth(node, &par_depth);
+				if (par_depth < depth)
+					break;
+				node = rte_rib_lookup_parent(node);
+			}
+			if (node != NULL)
+				rte_rib_get_nh(node, &nh);
+			else
+				nh = dp->def_nh;
+			if ((top > 0) && ((node == NULL) ||
+					(par_depth <= stack_depth[top - 1])))
+				continue;
+		}
+
+		ret = modify_fib(dp, rib, ip, depth, nh);
+		if (ret != 0) {
+			*failed = i;
+			return ret;
+		}
+		stack_ip[top] = ip;
+		stack_depth[top] = depth;
+		top++;
+	}
+
+	return 0;
+}
+
+/*
+ * The dataplane update of a bulk request failed at the prefix at position
+ * failed, e.g. for lack of tbl8 groups. Revert the RIB changes of this
+ * prefix and of the next ones, which were not written, reporting the error
+ * for their routes, then rewrite their ranges from the restored RIB.
+ * Return the number of routes reverted, or a negative value if the
+ * dataplane could not be restored.
+ */
+static int
+bulk_rollback(struct dir24_8_tbl *dp, struct rte_rib *rib, uint64_t *keys,
+	struct rte_rib_node **nodes, const struct bulk_undo *undo,
+	unsigned int nb_upd, unsigned int failed, int error, int *status)
+{
+	unsigned int i, unused;
+	int ret, cnt = 0;
+
+	/* the duplicates of the failed prefix were not written either */
+	while ((failed > 0) && (BULK_KEY_PREFIX(keys[failed - 1]) ==
+			BULK_KEY_PREFIX(keys[failed])))
+		failed--;
+
+	/* revert in reverse order, to undo the duplicates one by one */
+	for (i = nb_upd; i-- > failed; ) {
+		if (rib_undo(dp, rib, BULK_KEY_IP(keys[i]),
+				BULK_KEY_DEPTH(keys[i]),
+				&undo[BULK_KEY_IDX(keys[i])]) != 0)
+			continue;
+		if (status != NULL)
+			status[BULK_KEY_IDX(keys[i])] = error;
+		cnt++;
+	}
+
+	for (i = failed; i < nb_upd; i++)
+		nodes[i] = rte_rib_lookup_exact(rib, BULK_KEY_IP(keys[i]),
+			BULK_KEY_DEPTH(keys[i]));
+	ret = dp_update(dp, rib, keys + failed, nodes + failed,
+		nb_upd - failed, &unused);
+
+	return (ret != 0) ? ret : cnt;
+}
+
+static int
+modify_bulk(struct dir24_8_tbl *dp, struct rte_rib *rib, const uint32_t *ips,
+	const uint8_t *depths, const uint64_t *next_hops, unsigned int n,
+	int *status, int op)
+{
+	struct rte_rib_node **nodes;
+	struct bulk_undo *undo;
+	uint64_t *keys;
+	unsigned int i, nb_keys = 0, nb_upd = 0, failed;
+	uint32_t idx;
+	int ret, cnt = 0;
+
+	keys = rte_malloc(NULL, 2 * n * sizeof(*keys), 0);
+	nodes = rte_malloc(NULL, n * sizeof(*nodes), 0);
+	undo = rte_malloc(NULL, n * sizeof(*undo), 0);
+	if ((keys == NULL) || (nodes == NULL) || (undo == NULL)) {
+		rte_free(keys);
+		rte_free(nodes);
+		rte_free(undo);
+		return -ENOMEM;
+	}
+
+	for (i = 0; i < n; i++) {
+		if (depths[i] > RTE_FIB_MAXDEPTH) {
+			if (status != NULL)
+				status[i] = -EINVAL;
+			continue;
+		}
+		keys[nb_keys++] = BULK_KEY(ips[i] &
+			rte_rib_depth_to_mask(depths[i]), depths[i], i);
+	}
+	if (nb_keys != 0)
+		bulk_sort(keys, keys + n, nb_keys);
+
+	/* Update the RIB in address order, keep the prefixes to rewrite */
+	for (i = 0; i < nb_keys; i++) {
+		idx = BULK_KEY_IDX(keys[i]);
+		if (rib_modify(dp, rib, BULK_KEY_IP(keys[i]),
+				BULK_KEY_DEPTH(keys[i]),
+				(op == RTE_FIB_ADD) ? next_hops[idx] : 0,
+				op, &ret, &nodes[nb_upd], &undo[idx]) != 0)
+			keys[nb_upd++] = keys[i];
+		if (status != NULL)
+			status[idx] = ret;
+		if (ret == 0)
+			cnt++;
+	}
+
+	ret = dp_update(dp, rib, keys, nodes, nb_upd, &failed);
+	if (ret != 0) {
+		ret = bulk_rollback(dp, rib, keys, nodes, undo, nb_upd,
+			failed, ret, status);
+		if (ret >= 0) {
+			cnt -= ret;
+			ret = 0;
+		}
+	}
+	rte_free(keys);
+	rte_free(nodes);
+	rte_free(undo);
+
+	return (ret != 0) ? ret : cnt;
+}
+
+int
+dir24_8_modify_bulk(struct rte_fib *fib, const uint32_t *ips,
+	const uint8_t *depths, const uint64_t *next_hops, unsigned int n,
+	int *status, int op)
+{
+	struct dir24_8_tbl *dp;
+	struct rte_rib *rib;
+	unsigned int i, sz;
+	int ret, cnt = 0;
+
+	dp = rte_fib_get_dp(fib);
+	rib = rte_fib_get_rib(fib);
+	RTE_ASSERT((dp != NULL) && (rib != NULL));
+
+	/* Batches too large for the sort key are split */
+	for (i = 0; i < n; i += sz) {
+		sz = RTE_MIN(n - i, BULK_MAX);
+		ret = modify_bulk(dp, rib, ips + i, depths + i,
+			(next_hops != NULL) ? next_hops + i : NULL, sz,
+			(status != NULL) ? status + i : NULL, op);
+		if (ret < 0)
+			return ret;
+		cnt += ret;
+	}
+
+	return cnt;
+}
+
 void *
 dir24_8_create(const char *name, int socket_id, struct rte_fib_conf *fib_conf)
 {
@@ -687,9 +1017,10 @@ dir24_8_create(const char *name, int socket_id, struct rte_fib_conf *fib_conf)
 			BITMAP_SLAB_BIT_SIZE);
 
 	snprintf(mem_name, sizeof(mem_name), "DP_%s", name);
+	/* Vector lookup reads 4 bytes for any next hop size */
 	dp = rte_zmalloc_socket(name, sizeof(struct dir24_8_tbl) +
-		DIR24_8_TBL24_NUM_ENT * (1 << nh_sz), RTE_CACHE_LINE_SIZE,
-		socket_id);
+		DIR24_8_TBL24_NUM_ENT * (1 << nh_sz) + sizeof(uint32_t),
+		RTE_CACHE_LINE_SIZE, socket_id);
 	if (dp == NULL) {
 		rte_errno = ENOMEM;
 		return NULL;
@@ -731,7 +1062,137 @@ dir24_8_free(void *p)
 {
 	struct dir24_8_tbl *dp = (struct dir24_8_tbl *)p;
 
+	rte_rcu_qsbr_dq_delete(dp->dq);
 	rte_free(dp->tbl8_idxes);
 	rte_free(dp->tbl8);
 	rte_free(dp);
 }
+
+int
+dir24_8_rcu_qsbr_add(void *p, struct rte_fib_rcu_config *cfg,
+	const char *name)
+{
+	struct rte_rcu_qsbr_dq_parameters params = {0};
+	char rcu_dq_name[RTE_RCU_QSBR_DQ_NAMESIZE];
+	struct dir24_8_tbl *dp = p;
+
+	if ((dp == NULL) || (cfg == NULL) || (cfg->v == NULL) ||
+			((cfg->mode != RTE_FIB_QSBR_MODE_DQ) &&
+			(cfg->mode != RTE_FIB_QSBR_MODE_SYNC)))
+		return -EINVAL;
+
+	if (dp->v != NULL)
+		return -EEXIST;
+
+	if (cfg->mode == RTE_FIB_QSBR_MODE_DQ) {
+		/* Init QSBR defer queue. */
+		snprintf(rcu_dq_name, sizeof(rcu_dq_name), "FIB_%s", name);
+		params.name = rcu_dq_name;
+		params.size = cfg->dq_size;
+		if (params.size == 0)
+			params.size = dp->number_tbl8s;
+		params.trigger_reclaim_limit = cfg->reclaim_thd;
+		params.max_reclaim_size = cfg->reclaim_max;
+		if (params.max_reclaim_size == 0)
+			params.max_reclaim_size = RTE_FIB_RCU_DQ_RECLAIM_MAX;
+		params.esize = sizeof(uint32_t);	/* tbl8 group index */
+		params.free_fn = __rcu_qsbr_free_resource;
+		params.p = dp;
+		params.v = cfg->v;
+		dp->dq = rte_rcu_qsbr_dq_create(&params);
+		if (dp->dq == NULL) {
+			RTE_LOG(ERR, LPM, "FIB defer queue creation failed\n");
+			return -ENOMEM;
+		}
+	}
+
+	dp->rcu_mode = cfg->mode;
+	dp->v = cfg->v;
+
+	return 0;
+}
+
+/* Size of a tbl8 group in bytes */
+static inline size_t
+tbl8_grp_sz(struct dir24_8_tbl *dp)
+{
+	return (size_t)DIR24_8_TBL8_GRP_NUM_ENT << dp->nh_sz;
+}
+
+static inline void *
+get_tbl8_grp_p(struct dir24_8_tbl *dp, uint32_t idx)
+{
+	return (uint8_t *)dp->tbl8 + idx * tbl8_grp_sz(dp);
+}
+
+static inline int
+is_tbl8_used(struct dir24_8_tbl *dp, uint32_t idx)
+{
+	return (dp->tbl8_idxes[idx >> BITMAP_SLAB_BIT_SIZE_LOG2] >>
+		(idx & BITMAP_SLAB_BITMASK)) & 1;
+}
+
+/*
+ * Save the tables as they are: the tbl24, the bitmap of used tbl8
+ * groups, then only the used groups. tbl8 groups are referenced by
+ * index so the saved tables need no relocation.
+ */
+int
+dir24_8_save(void *p, FILE *f)
+{
+	struct dir24_8_tbl *dp = p;
+	uint32_t cnt[2], i;
+	unsigned int freed;
+
+	/* don't save groups only waiting for the readers */
+	if (dp->dq != NULL) {
+		rte_rcu_qsbr_synchronize(dp->v, RTE_QSBR_THRID_INVALID);
+		rte_rcu_qsbr_dq_reclaim(dp->dq, dp->number_tbl8s,
+			&freed, NULL, NULL);
+	}
+
+	cnt[0] = dp->rsvd_tbl8s;
+	cnt[1] = dp->cur_tbl8s;
+	if ((fwrite(cnt, sizeof(cnt), 1, f) != 1) ||
+			(fwrite(dp->tbl24, (size_t)DIR24_8_TBL24_NUM_ENT <<
+			dp->nh_sz, 1, f) != 1) ||
+			(fwrite(dp->tbl8_idxes, dp->number_tbl8s >> 3, 1,
+			f) != 1))
+		return -EIO;
+
+	for (i = 0; i < dp->number_tbl8s; i++) {
+		if (is_tbl8_used(dp, i) &&
+				(fwrite(get_tbl8_grp_p(dp, i), tbl8_grp_sz(dp), 1,
+				f) != 1))
+			return -EIO;
+	}
+
+	return 0;
+}
+
+int
+dir24_8_restore(void *p, FILE *f)
+{
+	struct dir24_8_tbl *dp = p;
+	uint32_t cnt[2], i;
+
+	if ((fread(cnt, sizeof(cnt), 1, f) != 1) ||
+			(fread(dp->tbl24, (size_t)DIR24_8_TBL24_NUM_ENT <<
+			dp->nh_sz, 1, f) != 1) ||
+			(fread(dp->tbl8_idxes, dp->number_tbl8s >> 3, 1,
+			f) != 1))
+		return -EIO;
+	if ((cnt[0] > dp->number_tbl8s) || (cnt[1] > dp->number_tbl8s))
+		return -EINVAL;
+	dp->rsvd_tbl8s = cnt[0];
+	dp->cur_tbl8s = cnt[1];
+
+	for (i = 0; i < dp->number_tbl8s; i++) {
+		if (is_tbl8_used(dp, i) &&
+				(fread(get_tbl8_grp_p(dp, i), tbl8_grp_sz(dp), 1,
+				f) != 1))
+			return -EIO;
+	}
+
+	return 0;
+}
@@ -3,13 +3,17 @@
  * Copyright(c) 2019 Intel Corporation
  */
 
+#include <errno.h>
 #include <stdint.h>
+#include <stdio.h>
 #include <string.h>
 
+#include <rte_branch_prediction.h>
 #include <rte_eal.h>
 #include <rte_eal_memconfig.h>
 #include <rte_errno.h>
 #include <rte_malloc.h>
+#include <rte_prefetch.h>
 #include <rte_rwlock.h>
 #include <rte_string_fns.h>
 #include <rte_tailq.h>
@@ -37,6 +41,22 @@ EAL_REGISTER_TAILQ(rte_fib_tailq)
 #define FIB_RETURN_IF_TRUE(cond, retval)
 #endif
 
+/*
+ * The address space is split in ranges, each with a generation counter
+ * bumped by the route updates overlapping the range. A lookup cache entry
+ * is valid as long as the generation of its range did not change.
+ */
+#define FIB_GEN_BITS		10
+#define FIB_GEN_NUM		(1 << FIB_GEN_BITS)
+#define FIB_GEN_SHIFT		(32 - FIB_GEN_BITS)
+
+/* Number of addresses a lookup cache handles at once. */
+#define FIB_CACHE_BURST		64
+
+/* Saved FIB file identification and layout version */
+#define FIB_FILE_MAGIC		0x34424946 /* "FIB4" */
+#define FIB_FILE_VERSION	1
+
 struct rte_fib {
 	char			name[RTE_FIB_NAMESIZE];
 	enum rte_fib_type	type;	/**< Type of FIB struct */
@@ -45,6 +65,23 @@ struct rte_fib {
 	rte_fib_lookup_fn_t	lookup;	/**< fib lookup function */
 	rte_fib_modify_fn_t	modify; /**< modify fib datastruct */
 	uint64_t		def_nh;
+	struct rte_fib_conf	conf;	/**< configuration, for saving */
+	/** generation of each address range, never 0 */
+	uint32_t		gen[FIB_GEN_NUM] __rte_cache_aligned;
+};
+
+struct fib_cache_ent {
+	uint32_t	ip;
+	uint32_t	gen;	/**< generation of the range of ip, 0 if unused */
+	uint64_t	nh;
+};
+
+struct rte_fib_cache {
+	struct rte_fib	*fib;
+	uint32_t	shift;	/**< shift of the hash giving the entry */
+	uint64_t	hits;
+	uint64_t	misses;
+	__extension__ struct fib_cache_ent	ent[0] __rte_cache_aligned;
 };
 
 static void
@@ -107,7 +144,8 @@ init_dataplane(struct rte_fib *fib, __rte_unused int socket_id,
 		fib->dp = dir24_8_create(dp_name, socket_id, conf);
 		if (fib->dp == NULL)
 			return -rte_errno;
-		fib->lookup = dir24_8_get_lookup_fn(conf);
+		fib->lookup = dir24_8_get_lookup_fn(fib->dp,
+			RTE_FIB_LOOKUP_DEFAULT);
 		fib->modify = dir24_8_modify;
 		return 0;
 	default:
@@ -116,22 +154,115 @@ init_dataplane(struct rte_fib *fib, __rte_unused int socket_id,
 	return 0;
 }
 
+/*
+ * Invalidate the lookup cache entries of the ranges overlapping a
+ * prefix, once the dataplane is updated. A cache reads the generation
+ * before looking up a missed address, so a lookup racing with the update
+ * either sees the new generation and the new dataplane, or caches its
+ * result with the old generation.
+ */
+static void
+gen_bump(struct rte_fib *fib, uint32_t ip, uint8_t depth)
+{
+	uint32_t i, first, num, gen;
+
+	first = (ip & rte_rib_depth_to_mask(depth)) >> FIB_GEN_SHIFT;
+	num = (depth >= FIB_GEN_BITS) ? 1 : 1 << (FIB_GEN_BITS - depth);
+	for (i = first; i < first + num; i++) {
+		gen = fib->gen[i] + 1;
+		if (unlikely(gen == 0))
+			gen = 1;
+		__atomic_store_n(&fib->gen[i], gen, __ATOMIC_RELEASE);
+	}
+}
+
 int
 rte_fib_add(struct rte_fib *fib, uint32_t ip, uint8_t depth, uint64_t next_hop)
 {
+	int ret;
+
 	if ((fib == NULL) || (fib->modify == NULL) ||
 			(depth > RTE_FIB_MAXDEPTH))
 		return -EINVAL;
-	return fib->modify(fib, ip, depth, next_hop, RTE_FIB_ADD);
+	ret = fib->modify(fib, ip, depth, next_hop, RTE_FIB_ADD);
+	gen_bump(fib, ip, depth);
+	return ret;
 }
 
 int
 rte_fib_delete(struct rte_fib *fib, uint32_t ip, uint8_t depth)
 {
+	int ret;
+
 	if ((fib == NULL) || (fib->modify == NULL) ||
 			(depth > RTE_FIB_MAXDEPTH))
 		return -EINVAL;
-	return fib->modify(fib, ip, depth, 0, RTE_FIB_DEL);
+	ret = fib->modify(fib, ip, depth, 0, RTE_FIB_DEL);
+	gen_bump(fib, ip, depth);
+	return ret;
+}
+
+static int
+__modify_bulk(struct rte_fib *fib, const uint32_t *ips, const uint8_t *depths,
+	const uint64_t *next_hops, unsigned int n, int *status, int op)
+{
+	unsigned int i;
+	int ret, cnt = 0;
+
+	if ((fib == NULL) || (fib->modify == NULL) || (ips == NULL) ||
+			(depths == NULL) ||
+			((op == RTE_FIB_ADD) && (next_hops == NULL)))
+		return -EINVAL;
+
+	switch (fib->type) {
+	case RTE_FIB_DIR24_8:
+		return dir24_8_modify_bulk(fib, ips, depths, next_hops, n,
+			status, op);
+	default:
+		/* Nothing to coalesce, update the routes one by one */
+		for (i = 0; i < n; i++) {
+			ret = fib->modify(fib, ips[i], depths[i],
+				(op == RTE_FIB_ADD) ? next_hops[i] : 0, op);
+			if (status != NULL)
+				status[i] = ret;
+			if (ret == 0)
+				cnt++;
+		}
+		return cnt;
+	}
+}
+
+static int
+modify_bulk(struct rte_fib *fib, const uint32_t *ips, const uint8_t *depths,
+	const uint64_t *next_hops, unsigned int n, int *status, int op)
+{
+	unsigned int i;
+	int ret;
+
+	ret = __modify_bulk(fib, ips, depths, next_hops, n, status, op);
+	if (ret == -EINVAL)
+		return ret;
+	for (i = 0; i < n; i++) {
+		if (depths[i] <= RTE_FIB_MAXDEPTH)
+			gen_bump(fib, ips[i], depths[i]);
+	}
+	return ret;
+}
+
+int
+rte_fib_add_bulk(struct rte_fib *fib, const uint32_t *ips,
+	const uint8_t *depths, const uint64_t *next_hops, unsigned int n,
+	int *status)
+{
+	return modify_bulk(fib, ips, depths, next_hops, n, status,
+		RTE_FIB_ADD);
+}
+
+int
+rte_fib_delete_bulk(struct rte_fib *fib, const uint32_t *ips,
+	const uint8_t *depths, unsigned int n, int *status)
+{
+	return modify_bulk(fib, ips, depths, NULL, n, status, RTE_FIB_DEL);
 }
 
 int
@@ -150,6 +281,7 @@ rte_fib_create(const char *name, int socket_id, struct rte_fib_conf *conf)
 {
 	char mem_name[RTE_FIB_NAMESIZE];
 	int ret;
+	unsigned int i;
 	struct rte_fib *fib = NULL;
 	struct rte_rib *rib = NULL;
 	struct rte_tailq_entry *te;
@@ -209,9 +341,12 @@ rte_fib_create(const char *name, int socket_id, struct rte_fib_conf *conf)
 	}
 
 	rte_strlcpy(fib->name, name, sizeof(fib->name));
+	for (i = 0; i < FIB_GEN_NUM; i++)
+		fib->gen[i] = 1;
 	fib->rib = rib;
 	fib->type = conf->type;
 	fib->def_nh = conf->default_nh;
+	fib->conf = *conf;
 	ret = init_dataplane(fib, socket_id, conf);
 	if (ret < 0) {
 		RTE_LOG(ERR, LPM,
@@ -317,3 +452,244 @@ rte_fib_get_rib(struct rte_fib *fib)
 {
 	return (fib == NULL) ? NULL : fib->rib;
 }
+
+int
+rte_fib_set_lookup_fn(struct rte_fib *fib,
+	enum rte_fib_lookup_type type)
+{
+	rte_fib_lookup_fn_t fn;
+
+	if (fib == NULL)
+		return -EINVAL;
+
+	switch (fib->type) {
+	case RTE_FIB_DIR24_8:
+		fn = dir24_8_get_lookup_fn(fib->dp, type);
+		if (fn == NULL)
+			return -EINVAL;
+		fib->lookup = fn;
+		return 0;
+	default:
+		return -EINVAL;
+	}
+}
+
+int
+rte_fib_rcu_qsbr_add(struct rte_fib *fib, struct rte_fib_rcu_config *cfg)
+{
+	if (fib == NULL)
+		return -EINVAL;
+
+	switch (fib->type) {
+	case RTE_FIB_DIR24_8:
+		return dir24_8_rcu_qsbr_add(fib->dp, cfg, fib->name);
+	default:
+		return -ENOTSUP;
+	}
+}
+
+struct rte_fib_cache *
+rte_fib_cache_create(struct rte_fib *fib, uint32_t entries, int socket_id)
+{
+	struct rte_fib_cache *cache;
+
+	if ((fib == NULL) || (entries < 2) ||
+			(entries > RTE_FIB_CACHE_ENTRIES_MAX) ||
+			!rte_is_power_of_2(entries)) {
+		rte_errno = EINVAL;
+		return NULL;
+	}
+
+	cache = rte_zmalloc_socket("FIB_CACHE", sizeof(*cache) +
+		entries * sizeof(cache->ent[0]), RTE_CACHE_LINE_SIZE,
+		socket_id);
+	if (cache == NULL) {
+		RTE_LOG(ERR, LPM, "FIB cache memory allocation failed\n");
+		rte_errno = ENOMEM;
+		return NULL;
+	}
+	cache->fib = fib;
+	cache->shift = 32 - rte_log2_u32(entries);
+
+	return cache;
+}
+
+void
+rte_fib_cache_free(struct rte_fib_cache *cache)
+{
+	rte_free(cache);
+}
+
+/* Multiplicative hashing of the address, spreading the low bits */
+static inline struct fib_cache_ent *
+cache_get_ent(struct rte_fib_cache *cache, uint32_t ip)
+{
+	return &cache->ent[(ip * 2654435761U) >> cache->shift];
+}
+
+int
+rte_fib_cache_lookup_bulk(struct rte_fib_cache *cache, const uint32_t *ips,
+	uint64_t *next_hops, unsigned int n)
+{
+	struct fib_cache_ent *ent[FIB_CACHE_BURST];
+	uint32_t gen[FIB_CACHE_BURST];
+	uint32_t miss_ips[FIB_CACHE_BURST];
+	uint64_t miss_nh[FIB_CACHE_BURST];
+	uint8_t miss_idx[FIB_CACHE_BURST];
+	struct rte_fib *fib;
+	unsigned int i, j, k, nb, nb_miss;
+	uint64_t misses = 0;
+
+	if ((cache == NULL) || (ips == NULL) || (next_hops == NULL))
+		return -EINVAL;
+
+	fib = cache->fib;
+	for (i = 0; i < n; i += nb, ips += nb, next_hops += nb) {
+		nb = RTE_MIN(n - i, (unsigned int)FIB_CACHE_BURST);
+		for (j = 0; j < nb; j++) {
+			ent[j] = cache_get_ent(cache, ips[j]);
+			rte_prefetch0(ent[j]);
+		}
+
+		nb_miss = 0;
+		for (j = 0; j < nb; j++) {
+			gen[j] = __atomic_load_n(
+				&fib->gen[ips[j] >> FIB_GEN_SHIFT],
+				__ATOMIC_ACQUIRE);
+			if (likely((ent[j]->ip == ips[j]) &&
+					(ent[j]->gen == gen[j]))) {
+				next_hops[j] = ent[j]->nh;
+				continue;
+			}
+			miss_idx[nb_miss] = j;
+			miss_ips[nb_miss++] = ips[j];
+		}
+		if (nb_miss == 0)
+			continue;
+
+		fib->lookup(fib->dp, miss_ips, miss_nh, nb_miss);
+		for (k = 0; k < nb_miss; k++) {
+			j = miss_idx[k];
+			next_hops[j] = miss_nh[k];
+			ent[j]->ip = miss_ips[k];
+			ent[j]->gen = gen[j];
+			ent[j]->nh = miss_nh[k];
+		}
+		misses += nb_miss;
+	}
+
+	cache->hits += n - misses;
+	cache->misses += misses;
+
+	return 0;
+}
+
+int
+rte_fib_cache_stats_get(const struct rte_fib_cache *cache,
+	struct rte_fib_cache_stats *stats)
+{
+	if ((cache == NULL) || (stats == NULL))
+		return -EINVAL;
+
+	stats->hits = cache->hits;
+	stats->misses = cache->misses;
+
+	return 0;
+}
+
+void
+rte_fib_cache_stats_reset(struct rte_fib_cache *cache)
+{
+	if (cache == NULL)
+		return;
+
+	cache->hits = 0;
+	cache->misses = 0;
+}
+
+/* Header of a saved FIB, followed by its RIB then its dataplane tables */
+struct fib_file_hdr {
+	uint32_t		magic;
+	uint32_t		version;
+	struct rte_fib_conf	conf;
+};
+
+int
+rte_fib_save(struct rte_fib *fib, const char *filename)
+{
+	struct fib_file_hdr hdr;
+	FILE *f;
+	int ret = 0;
+
+	if ((fib == NULL) || (filename == NULL))
+		return -EINVAL;
+
+	f = fopen(filename, "w");
+	if (f == NULL)
+		return -errno;
+
+	memset(&hdr, 0, sizeof(hdr));
+	hdr.magic = FIB_FILE_MAGIC;
+	hdr.version = FIB_FILE_VERSION;
+	hdr.conf = fib->conf;
+	if (fwrite(&hdr, sizeof(hdr), 1, f) != 1)
+		ret = -EIO;
+	if (ret == 0)
+		ret = rte_rib_save(fib->rib, f);
+	if ((ret == 0) && (fib->type == RTE_FIB_DIR24_8))
+		ret = dir24_8_save(fib->dp, f);
+
+	if ((fclose(f) != 0) && (ret == 0))
+		ret = -EIO;
+
+	return ret;
+}
+
+struct rte_fib *
+rte_fib_restore(const char *name, int socket_id, const char *filename)
+{
+	struct fib_file_hdr hdr;
+	struct rte_fib *fib;
+	FILE *f;
+	int ret;
+
+	if ((name == NULL) || (filename == NULL)) {
+		rte_errno = EINVAL;
+		return NULL;
+	}
+
+	f = fopen(filename, "r");
+	if (f == NULL) {
+		rte_errno = errno;
+		return NULL;
+	}
+
+	if ((fread(&hdr, sizeof(hdr), 1, f) != 1) ||
+			(hdr.magic != FIB_FILE_MAGIC) ||
+			(hdr.version != FIB_FILE_VERSION)) {
+		fclose(f);
+		rte_errno = EINVAL;
+		return NULL;
+	}
+
+	fib = rte_fib_create(name, socket_id, &hdr.conf);
+	if (fib == NULL) {
+		fclose(f);
+		return NULL;
+	}
+
+	ret = rte_rib_restore(fib->rib, f);
+	if ((ret == 0) && (fib->type == RTE_FIB_DIR24_8))
+		ret = dir24_8_restore(fib->dp, f);
+	fclose(f);
+
+	if (ret != 0) {
+		RTE_LOG(ERR, LPM, "Can not restore FIB %s from %s, err %d\n",
+			name, filename, ret);
+		rte_fib_free(fib);
+		rte_errno = -ret;
+		return NULL;
+	}
+
+	return fib;
+}
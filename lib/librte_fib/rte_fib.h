@@ -13,13 +13,18 @@
  */
 
 #include <rte_compat.h>
+#include <rte_rcu_qsbr.h>
 
 struct rte_fib;
 struct rte_rib;
+struct rte_fib_cache;
 
 /** Maximum depth value possible for IPv4 FIB. */
 #define RTE_FIB_MAXDEPTH	32
 
+/** Maximum number of entries of a FIB lookup cache. */
+#define RTE_FIB_CACHE_ENTRIES_MAX	(1 << 24)
+
 /** Type of FIB struct */
 enum rte_fib_type {
 	RTE_FIB_DUMMY,		/**< RIB tree based FIB */
@@ -47,6 +52,52 @@ enum rte_fib_dir24_8_nh_sz {
 	RTE_FIB_DIR24_8_8B
 };
 
+/** Type of lookup function implementation */
+enum rte_fib_lookup_type {
+	RTE_FIB_LOOKUP_DEFAULT,
+	/**< Selects the best implementation supported by the CPU */
+	RTE_FIB_LOOKUP_DIR24_8_SCALAR_MACRO,
+	/**< Macro based lookup function */
+	RTE_FIB_LOOKUP_DIR24_8_SCALAR_INLINE,
+	/**<
+	 * Lookup implementation using inlined functions
+	 * for different next hop sizes
+	 */
+	RTE_FIB_LOOKUP_DIR24_8_SCALAR_UNI,
+	/**<
+	 * Unified lookup function for all next hop sizes
+	 */
+	RTE_FIB_LOOKUP_DIR24_8_VECTOR_AVX512
+	/**< Vector implementation using AVX512 */
+};
+
+/** @internal Default RCU defer queue entries to reclaim in one go. */
+#define RTE_FIB_RCU_DQ_RECLAIM_MAX	16
+
+/** RCU reclamation modes */
+enum rte_fib_qsbr_mode {
+	/** Create defer queue for reclaim. */
+	RTE_FIB_QSBR_MODE_DQ = 0,
+	/** Use blocking mode reclaim. No defer queue created. */
+	RTE_FIB_QSBR_MODE_SYNC
+};
+
+/** FIB RCU QSBR configuration structure. */
+struct rte_fib_rcu_config {
+	struct rte_rcu_qsbr *v;	/**< RCU QSBR variable. */
+	/** Mode of RCU QSBR. RTE_FIB_QSBR_MODE_xxx
+	 * '0' for default: create defer queue for reclaim.
+	 */
+	enum rte_fib_qsbr_mode mode;
+	uint32_t dq_size;	/**< RCU defer queue size.
+				 * default: number of tbl8 groups.
+				 */
+	uint32_t reclaim_thd;	/**< Threshold to trigger auto reclaim. */
+	uint32_t reclaim_max;	/**< Max entries to reclaim in one go.
+				 * default: RTE_FIB_RCU_DQ_RECLAIM_MAX.
+				 */
+};
+
 /** FIB configuration structure */
 struct rte_fib_conf {
 	enum rte_fib_type type; /**< Type of FIB struct */
@@ -61,6 +112,12 @@ struct rte_fib_conf {
 	};
 };
 
+/** FIB lookup cache statistics */
+struct rte_fib_cache_stats {
+	uint64_t hits;		/**< Addresses found in the cache */
+	uint64_t misses;	/**< Addresses looked up in the FIB */
+};
+
 /**
  * Create FIB
  *
@@ -138,6 +195,74 @@ __rte_experimental
 int
 rte_fib_delete(struct rte_fib *fib, uint32_t ip, uint8_t depth);
 
+/**
+ * Add a batch of routes to the FIB.
+ *
+ * All the routes are first added to the RIB, then the dataplane ranges
+ * they affect are rewritten once for the whole batch, so a covering prefix
+ * is not rewritten by each of its more specific routes. The batch does not
+ * need to be sorted. A route already present gets its next hop updated,
+ * when a prefix appears several times its last next hop is kept.
+ *
+ * If the dataplane update fails, e.g. for lack of tbl8 groups, the routes
+ * not yet written to the dataplane are reverted in the RIB, and get the
+ * error in status.
+ *
+ * @param fib
+ *   FIB object handle
+ * @param ips
+ *   IPv4 prefix addresses to be added to the FIB
+ * @param depths
+ *   Prefix lengths
+ * @param next_hops
+ *   Next hops to be added to the FIB
+ * @param n
+ *   Number of routes
+ * @param status
+ *   Output array of n values, the same as rte_fib_add() would return for
+ *   each route. May be NULL.
+ * @return
+ *   Number of routes added or updated on success,
+ *   -EINVAL if parameters are invalid,
+ *   other negative value if the dataplane could not be restored after a
+ *   failed update.
+ */
+__rte_experimental
+int
+rte_fib_add_bulk(struct rte_fib *fib, const uint32_t *ips,
+	const uint8_t *depths, const uint64_t *next_hops, unsigned int n,
+	int *status);
+
+/**
+ * Delete a batch of routes from the FIB.
+ *
+ * As with rte_fib_add_bulk(), the routes are first removed from the RIB,
+ * then the dataplane ranges they affect are rewritten once for the batch,
+ * and the routes not written when the dataplane update fails are put back
+ * in the RIB, with the error in status.
+ *
+ * @param fib
+ *   FIB object handle
+ * @param ips
+ *   IPv4 prefix addresses to be deleted from the FIB
+ * @param depths
+ *   Prefix lengths
+ * @param n
+ *   Number of routes
+ * @param status
+ *   Output array of n values, the same as rte_fib_delete() would return
+ *   for each route. May be NULL.
+ * @return
+ *   Number of routes deleted on success,
+ *   -EINVAL if parameters are invalid,
+ *   other negative value if the dataplane could not be restored after a
+ *   failed update.
+ */
+__rte_experimental
+int
+rte_fib_delete_bulk(struct rte_fib *fib, const uint32_t *ips,
+	const uint8_t *depths, unsigned int n, int *status);
+
 /**
  * Lookup multiple IP addresses in the FIB.
  *
@@ -185,4 +310,174 @@ __rte_experimental
 struct rte_rib *
 rte_fib_get_rib(struct rte_fib *fib);
 
+/**
+ * Set lookup function based on type
+ *
+ * @param fib
+ *   FIB object handle
+ * @param type
+ *   type of lookup function
+ *
+ * @return
+ *   0 on success
+ *   -EINVAL on failure, e.g. the FIB type does not support it or the
+ *   CPU lacks the needed instruction set
+ */
+__rte_experimental
+int
+rte_fib_set_lookup_fn(struct rte_fib *fib,
+	enum rte_fib_lookup_type type);
+
+/**
+ * Associate RCU QSBR variable with a FIB object.
+ * tbl8 groups released by route deletions are then returned to the free
+ * pool only once all the reader threads registered on the QSBR variable
+ * went through a quiescent state, so the lookup functions may be called
+ * concurrently with rte_fib_add()/rte_fib_delete() from a single writer.
+ *
+ * @param fib
+ *   FIB object handle
+ * @param cfg
+ *   RCU QSBR configuration
+ * @return
+ *   0 on success
+ *   -EINVAL if parameters are invalid
+ *   -EEXIST if already added
+ *   -ENOTSUP if the FIB type does not support it
+ *   -ENOMEM if the defer queue cannot be created
+ */
+__rte_experimental
+int
+rte_fib_rcu_qsbr_add(struct rte_fib *fib, struct rte_fib_rcu_config *cfg);
+
+/**
+ * Save a FIB to a file.
+ *
+ * The RIB and the dataplane tables are written in a layout without
+ * pointers, to be restored by rte_fib_restore() on the same architecture.
+ * Only the used tbl8 groups are saved. Lookups can go on while the FIB
+ * is saved but it must not be modified.
+ *
+ * @param fib
+ *   FIB object handle
+ * @param filename
+ *   Path of the file to write
+ * @return
+ *   0 on success, negative errno value otherwise
+ */
+__rte_experimental
+int
+rte_fib_save(struct rte_fib *fib, const char *filename);
+
+/**
+ * Create a FIB from a file written by rte_fib_save().
+ *
+ * The FIB is created with the saved configuration, then its RIB and
+ * dataplane tables are loaded without adding the routes again. The RCU
+ * configuration and the lookup function are not saved.
+ *
+ * @param name
+ *   FIB name
+ * @param socket_id
+ *   NUMA socket ID for FIB table memory allocation
+ * @param filename
+ *   Path of the file to read
+ * @return
+ *   Handle to FIB object on success
+ *   NULL otherwise with rte_errno set to an appropriate values.
+ */
+__rte_experimental
+struct rte_fib *
+rte_fib_restore(const char *name, int socket_id, const char *filename);
+
+/**
+ * Create a lookup cache in front of a FIB.
+ *
+ * The cache is a direct mapped table of destination addresses and their
+ * next hop, meant for traffic concentrated on a limited number of
+ * destinations. Route updates done with rte_fib_add(), rte_fib_delete()
+ * and their bulk versions invalidate the cached addresses covered by the
+ * updated prefix, and the ones sharing the same address range.
+ *
+ * A cache is not multi-thread safe, each lcore should use its own cache.
+ * Lookups through a cache may run concurrently with route updates, as
+ * long as the FIB itself allows it (see rte_fib_rcu_qsbr_add()).
+ * The cache must be freed before its FIB.
+ *
+ * @param fib
+ *   FIB object handle
+ * @param entries
+ *   Number of entries of the cache, a power of 2 of at least 2 and at
+ *   most RTE_FIB_CACHE_ENTRIES_MAX
+ * @param socket_id
+ *   NUMA socket ID for the cache memory allocation
+ * @return
+ *   Handle to the cache on success, NULL otherwise with rte_errno set to:
+ *    - EINVAL - invalid parameter passed to function
+ *    - ENOMEM - no appropriate memory area found
+ */
+__rte_experimental
+struct rte_fib_cache *
+rte_fib_cache_create(struct rte_fib *fib, uint32_t entries, int socket_id);
+
+/**
+ * Free a FIB lookup cache.
+ *
+ * @param cache
+ *   Cache handle, may be NULL
+ */
+__rte_experimental
+void
+rte_fib_cache_free(struct rte_fib_cache *cache);
+
+/**
+ * Lookup multiple IP addresses through a lookup cache.
+ * Addresses found in the cache with an up to date entry get their cached
+ * next hop, the other ones are looked up in the FIB with one bulk lookup
+ * per burst, and their result is cached.
+ *
+ * @param cache
+ *   Cache handle
+ * @param ips
+ *   Array of IPs to be looked up in the FIB
+ * @param next_hops
+ *   Next hop of the most specific rule found for IP.
+ *   This is an array of eight byte values.
+ *   If the lookup for the given IP failed, then corresponding element would
+ *   contain default nexthop value configured for a FIB.
+ * @param n
+ *   Number of elements in ips (and next_hops) array to lookup.
+ *  @return
+ *   -EINVAL for incorrect arguments, otherwise 0
+ */
+__rte_experimental
+int
+rte_fib_cache_lookup_bulk(struct rte_fib_cache *cache, const uint32_t *ips,
+	uint64_t *next_hops, unsigned int n);
+
+/**
+ * Get the hit and miss counters of a lookup cache.
+ *
+ * @param cache
+ *   Cache handle
+ * @param stats
+ *   Output statistics
+ * @return
+ *   -EINVAL for incorrect arguments, otherwise 0
+ */
+__rte_experimental
+int
+rte_fib_cache_stats_get(const struct rte_fib_cache *cache,
+	struct rte_fib_cache_stats *stats);
+
+/**
+ * Clear the hit and miss counters of a lookup cache.
+ *
+ * @param cache
+ *   Cache handle
+ */
+__rte_experimental
+void
+rte_fib_cache_stats_reset(struct rte_fib_cache *cache);
+
 #endif /* _RTE_FIB_H_ */
@@ -3,7 +3,9 @@
  * Copyright(c) 2019 Intel Corporation
  */
 
+#include <errno.h>
 #include <stdint.h>
+#include <stdio.h>
 #include <string.h>
 
 #include <rte_eal.h>
@@ -19,6 +21,10 @@
 
 #include "trie.h"
 
+/* Saved FIB6 file identification and layout version */
+#define FIB6_FILE_MAGIC		0x36424946 /* "FIB6" */
+#define FIB6_FILE_VERSION	1
+
 TAILQ_HEAD(rte_fib6_list, rte_tailq_entry);
 static struct rte_tailq_elem rte_fib6_tailq = {
 	.name = "RTE_FIB6",
@@ -45,6 +51,7 @@ struct rte_fib6 {
 	rte_fib6_lookup_fn_t	lookup;	/**< fib lookup function */
 	rte_fib6_modify_fn_t	modify; /**< modify fib datastruct */
 	uint64_t		def_nh;
+	struct rte_fib6_conf	conf;	/**< configuration, for saving */
 };
 
 static void
@@ -107,7 +114,8 @@ init_dataplane(struct rte_fib6 *fib, __rte_unused int socket_id,
 		fib->dp = trie_create(dp_name, socket_id, conf);
 		if (fib->dp == NULL)
 			return -rte_errno;
-		fib->lookup = rte_trie_get_lookup_fn(conf);
+		fib->lookup = trie_get_lookup_fn(fib->dp,
+			RTE_FIB6_LOOKUP_DEFAULT);
 		fib->modify = trie_modify;
 		return 0;
 	default:
@@ -214,6 +222,7 @@ rte_fib6_create(const char *name, int socket_id, struct rte_fib6_conf *conf)
 	fib->rib = rib;
 	fib->type = conf->type;
 	fib->def_nh = conf->default_nh;
+	fib->conf = *conf;
 	ret = init_dataplane(fib, socket_id, conf);
 	if (ret < 0) {
 		RTE_LOG(ERR, LPM,
@@ -319,3 +328,125 @@ rte_fib6_get_rib(struct rte_fib6 *fib)
 {
 	return (fib == NULL) ? NULL : fib->rib;
 }
+
+int
+rte_fib6_set_lookup_fn(struct rte_fib6 *fib,
+	enum rte_fib6_lookup_type type)
+{
+	rte_fib6_lookup_fn_t fn;
+
+	if (fib == NULL)
+		return -EINVAL;
+
+	switch (fib->type) {
+	case RTE_FIB6_TRIE:
+		fn = trie_get_lookup_fn(fib->dp, type);
+		if (fn == NULL)
+			return -EINVAL;
+		fib->lookup = fn;
+		return 0;
+	default:
+		return -EINVAL;
+	}
+}
+
+int
+rte_fib6_rcu_qsbr_add(struct rte_fib6 *fib, struct rte_fib6_rcu_config *cfg)
+{
+	if (fib == NULL)
+		return -EINVAL;
+
+	switch (fib->type) {
+	case RTE_FIB6_TRIE:
+		return trie_rcu_qsbr_add(fib->dp, cfg, fib->name);
+	default:
+		return -ENOTSUP;
+	}
+}
+
+/* Header of a saved FIB, followed by its RIB then its dataplane tables */
+struct fib6_file_hdr {
+	uint32_t		magic;
+	uint32_t		version;
+	struct rte_fib6_conf	conf;
+};
+
+int
+rte_fib6_save(struct rte_fib6 *fib, const char *filename)
+{
+	struct fib6_file_hdr hdr;
+	FILE *f;
+	int ret = 0;
+
+	if ((fib == NULL) || (filename == NULL))
+		return -EINVAL;
+
+	f = fopen(filename, "w");
+	if (f == NULL)
+		return -errno;
+
+	memset(&hdr, 0, sizeof(hdr));
+	hdr.magic = FIB6_FILE_MAGIC;
+	hdr.version = FIB6_FILE_VERSION;
+	hdr.conf = fib->conf;
+	if (fwrite(&hdr, sizeof(hdr), 1, f) != 1)
+		ret = -EIO;
+	if (ret == 0)
+		ret = rte_rib6_save(fib->rib, f);
+	if ((ret == 0) && (fib->type == RTE_FIB6_TRIE))
+		ret = trie_save(fib->dp, f);
+
+	if ((fclose(f) != 0) && (ret == 0))
+		ret = -EIO;
+
+	return ret;
+}
+
+struct rte_fib6 *
+rte_fib6_restore(const char *name, int socket_id, const char *filename)
+{
+	struct fib6_file_hdr hdr;
+	struct rte_fib6 *fib;
+	FILE *f;
+	int ret;
+
+	if ((name == NULL) || (filename == NULL)) {
+		rte_errno = EINVAL;
+		return NULL;
+	}
+
+	f = fopen(filename, "r");
+	if (f == NULL) {
+		rte_errno = errno;
+		return NULL;
+	}
+
+	if ((fread(&hdr, sizeof(hdr), 1, f) != 1) ||
+			(hdr.magic != FIB6_FILE_MAGIC) ||
+			(hdr.version != FIB6_FILE_VERSION)) {
+		fclose(f);
+		rte_errno = EINVAL;
+		return NULL;
+	}
+
+	fib = rte_fib6_create(name, socket_id, &hdr.conf);
+	if (fib == NULL) {
+		fclose(f);
+		return NULL;
+	}
+
+	ret = rte_rib6_restore(fib->rib, f);
+	if ((ret == 0) && (fib->type == RTE_FIB6_TRIE))
+		ret = trie_restore(fib->dp, f);
+	fclose(f);
+
+	if (ret != 0) {
+		RTE_LOG(ERR, LPM, "Can not restore FIB6 %s from %s, err %d\n",
+			name, filename, ret);
+		rte_fib6_free(fib);
+		rte_errno = -ret;
+		return NULL;
+	}
+
+	return fib;
+}
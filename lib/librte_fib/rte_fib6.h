@@ -13,6 +13,7 @@
  */
 
 #include <rte_compat.h>
+#include <rte_rcu_qsbr.h>
 
 #define RTE_FIB6_IPV6_ADDR_SIZE		16
 /** Maximum depth value possible for IPv6 FIB. */
@@ -48,6 +49,46 @@ enum rte_fib_trie_nh_sz {
 	RTE_FIB6_TRIE_8B
 };
 
+/** Type of lookup function implementation */
+enum rte_fib6_lookup_type {
+	RTE_FIB6_LOOKUP_DEFAULT,
+	/**< Selects the best implementation supported by the CPU */
+	RTE_FIB6_LOOKUP_TRIE_SCALAR,
+	/**< Scalar lookup function, one address at a time */
+	RTE_FIB6_LOOKUP_TRIE_VECTOR_AVX512
+	/**<
+	 * Vector implementation using AVX512, walking the trie levels
+	 * of 16 addresses (8 with 8-byte next hops) in lockstep
+	 */
+};
+
+/** @internal Default RCU defer queue entries to reclaim in one go. */
+#define RTE_FIB6_RCU_DQ_RECLAIM_MAX	16
+
+/** RCU reclamation modes */
+enum rte_fib6_qsbr_mode {
+	/** Create defer queue for reclaim. */
+	RTE_FIB6_QSBR_MODE_DQ = 0,
+	/** Use blocking mode reclaim. No defer queue created. */
+	RTE_FIB6_QSBR_MODE_SYNC
+};
+
+/** FIB6 RCU QSBR configuration structure. */
+struct rte_fib6_rcu_config {
+	struct rte_rcu_qsbr *v;	/**< RCU QSBR variable. */
+	/** Mode of RCU QSBR. RTE_FIB6_QSBR_MODE_xxx
+	 * '0' for default: create defer queue for reclaim.
+	 */
+	enum rte_fib6_qsbr_mode mode;
+	uint32_t dq_size;	/**< RCU defer queue size.
+				 * default: number of tbl8 groups.
+				 */
+	uint32_t reclaim_thd;	/**< Threshold to trigger auto reclaim. */
+	uint32_t reclaim_max;	/**< Max entries to reclaim in one go.
+				 * default: RTE_FIB6_RCU_DQ_RECLAIM_MAX.
+				 */
+};
+
 /** FIB configuration structure */
 struct rte_fib6_conf {
 	enum rte_fib6_type type; /**< Type of FIB struct */
@@ -58,6 +99,14 @@ struct rte_fib6_conf {
 		struct {
 			enum rte_fib_trie_nh_sz nh_sz;
 			uint32_t	num_tbl8;
+			/**
+			 * Number of address bits indexing the first level
+			 * table, next levels use 8 bits each. 24 by default
+			 * (0), 16 or 8 shrink the first level from
+			 * 2^24 entries to 2^16 or 2^8 for sparse tables,
+			 * at the cost of more levels to walk on lookup.
+			 */
+			uint8_t		root_stride;
 		} trie;
 	};
 };
@@ -190,4 +239,84 @@ __rte_experimental
 struct rte_rib6 *
 rte_fib6_get_rib(struct rte_fib6 *fib);
 
+/**
+ * Set lookup function based on type
+ *
+ * @param fib
+ *   FIB object handle
+ * @param type
+ *   type of lookup function
+ *
+ * @return
+ *   0 on success
+ *   -EINVAL on failure, e.g. the FIB type does not support it or the
+ *   CPU lacks the needed instruction set
+ */
+__rte_experimental
+int
+rte_fib6_set_lookup_fn(struct rte_fib6 *fib,
+	enum rte_fib6_lookup_type type);
+
+/**
+ * Associate RCU QSBR variable with a FIB6 object.
+ * tbl8 groups released by route deletions are then returned to the free
+ * pool only once all the reader threads registered on the QSBR variable
+ * went through a quiescent state, so the lookup functions may be called
+ * concurrently with rte_fib6_add()/rte_fib6_delete() from a single writer.
+ *
+ * @param fib
+ *   FIB6 object handle
+ * @param cfg
+ *   RCU QSBR configuration
+ * @return
+ *   0 on success
+ *   -EINVAL if parameters are invalid
+ *   -EEXIST if already added
+ *   -ENOTSUP if the FIB6 type does not support it
+ *   -ENOMEM if the defer queue cannot be created
+ */
+__rte_experimental
+int
+rte_fib6_rcu_qsbr_add(struct rte_fib6 *fib, struct rte_fib6_rcu_config *cfg);
+
+/**
+ * Save a FIB to a file.
+ *
+ * The RIB and the dataplane tables are written in a layout without
+ * pointers, to be restored by rte_fib6_restore() on the same architecture.
+ * Only the used tbl8 groups are saved. Lookups can go on while the FIB
+ * is saved but it must not be modified.
+ *
+ * @param fib
+ *   FIB object handle
+ * @param filename
+ *   Path of the file to write
+ * @return
+ *   0 on success, negative errno value otherwise
+ */
+__rte_experimental
+int
+rte_fib6_save(struct rte_fib6 *fib, const char *filename);
+
+/**
+ * Create a FIB from a file written by rte_fib6_save().
+ *
+ * The FIB is created with the saved configuration, then its RIB and
+ * dataplane tables are loaded without adding the routes again. The RCU
+ * configuration and the lookup function are not saved.
+ *
+ * @param name
+ *   FIB name
+ * @param socket_id
+ *   NUMA socket ID for FIB table memory allocation
+ * @param filename
+ *   Path of the file to read
+ * @return
+ *   Handle to FIB object on success
+ *   NULL otherwise with rte_errno set to an appropriate values.
+ */
+__rte_experimental
+struct rte_fib6 *
+rte_fib6_restore(const char *name, int socket_id, const char *filename);
+
 #endif /* _RTE_FIB6_H_ */
@@ -15,163 +15,83 @@
 #include <rte_errno.h>
 #include <rte_memory.h>
 #include <rte_branch_prediction.h>
+#include <rte_cpuflags.h>
 
 #include <rte_rib6.h>
 #include <rte_fib6.h>
 #include "trie.h"
 
-/* @internal Total number of tbl24 entries. */
-#define TRIE_TBL24_NUM_ENT	(1 << 24)
+#ifdef CC_AVX512_SUPPORT
 
-/* Maximum depth value possible for IPv6 LPM. */
-#define TRIE_MAX_DEPTH		128
+#include "trie_avx512.h"
 
-/* @internal Number of entries in a tbl8 group. */
-#define TRIE_TBL8_GRP_NUM_ENT	256ULL
-
-/* @internal Total number of tbl8 groups in the tbl8. */
-#define TRIE_TBL8_NUM_GROUPS	65536
-
-/* @internal bitmask with valid and valid_group fields set */
-#define TRIE_EXT_ENT		1
-
-#define TRIE_NAMESIZE		64
-
-#define BITMAP_SLAB_BIT_SIZE_LOG2	6
-#define BITMAP_SLAB_BIT_SIZE		(1ULL << BITMAP_SLAB_BIT_SIZE_LOG2)
-#define BITMAP_SLAB_BITMASK		(BITMAP_SLAB_BIT_SIZE - 1)
-
-struct rte_trie_tbl {
-	uint32_t	number_tbl8s;	/**< Total number of tbl8s */
-	uint32_t	rsvd_tbl8s;	/**< Number of reserved tbl8s */
-	uint32_t	cur_tbl8s;	/**< Current cumber of tbl8s */
-	uint64_t	def_nh;		/**< Default next hop */
-	enum rte_fib_trie_nh_sz	nh_sz;	/**< Size of nexthop entry */
-	uint64_t	*tbl8;		/**< tbl8 table. */
-	uint32_t	*tbl8_pool;	/**< bitmap containing free tbl8 idxes*/
-	uint32_t	tbl8_pool_pos;
-	/* tbl24 table. */
-	__extension__ uint64_t	tbl24[0] __rte_cache_aligned;
-};
+#endif /* CC_AVX512_SUPPORT */
 
 enum edge {
 	LEDGE,
 	REDGE
 };
 
-enum lookup_type {
-	MACRO,
-	INLINE,
-	UNI
-};
-static enum lookup_type test_lookup = MACRO;
-
-static inline uint32_t
-get_tbl24_idx(const uint8_t *ip)
-{
-	return ip[0] << 16|ip[1] << 8|ip[2];
-}
-
-static inline void *
-get_tbl24_p(struct rte_trie_tbl *dp, const uint8_t *ip, uint8_t nh_sz)
-{
-	uint32_t tbl24_idx;
-
-	tbl24_idx = get_tbl24_idx(ip);
-	return (void *)&((uint8_t *)dp->tbl24)[tbl24_idx << nh_sz];
-}
-
-static inline uint8_t
-bits_in_nh(uint8_t nh_sz)
-{
-	return 8 * (1 << nh_sz);
-}
-
-static inline uint64_t
-get_max_nh(uint8_t nh_sz)
-{
-	return ((1ULL << (bits_in_nh(nh_sz) - 1)) - 1);
-}
-
-static inline uint64_t
-lookup_msk(uint8_t nh_sz)
+static rte_fib6_lookup_fn_t
+get_scalar_fn(enum rte_fib_trie_nh_sz nh_sz)
 {
-	return ((1ULL << ((1 << (nh_sz + 3)) - 1)) << 1) - 1;
-}
-
-static inline uint8_t
-get_psd_idx(uint32_t val, uint8_t nh_sz)
-{
-	return val & ((1 << (3 - nh_sz)) - 1);
-}
-
-static inline uint32_t
-get_tbl_pos(uint32_t val, uint8_t nh_sz)
-{
-	return val >> (3 - nh_sz);
-}
-
-static inline uint64_t
-get_tbl_val_by_idx(uint64_t *tbl, uint32_t idx, uint8_t nh_sz)
-{
-	return ((tbl[get_tbl_pos(idx, nh_sz)] >> (get_psd_idx(idx, nh_sz) *
-		bits_in_nh(nh_sz))) & lookup_msk(nh_sz));
-}
-
-static inline void *
-get_tbl_p_by_idx(uint64_t *tbl, uint64_t idx, uint8_t nh_sz)
-{
-	return (uint8_t *)tbl + (idx << nh_sz);
+	switch (nh_sz) {
+	case RTE_FIB6_TRIE_2B:
+		return trie_lookup_bulk_2b;
+	case RTE_FIB6_TRIE_4B:
+		return trie_lookup_bulk_4b;
+	case RTE_FIB6_TRIE_8B:
+		return trie_lookup_bulk_8b;
+	default:
+		return NULL;
+	}
 }
 
-static inline int
-is_entry_extended(uint64_t ent)
+static rte_fib6_lookup_fn_t
+get_vector_fn(struct rte_trie_tbl *dp)
 {
-	return (ent & TRIE_EXT_ENT) == TRIE_EXT_ENT;
-}
+#ifdef CC_AVX512_SUPPORT
+	if (rte_cpu_get_flag_enabled(RTE_CPUFLAG_AVX512F) <= 0)
+		return NULL;
 
-#define LOOKUP_FUNC(suffix, type, nh_sz)				\
-static void rte_trie_lookup_bulk_##suffix(void *p,			\
-	uint8_t ips[][RTE_FIB6_IPV6_ADDR_SIZE],			\
-	uint64_t *next_hops, const unsigned int n)			\
-{									\
-	struct rte_trie_tbl *dp = (struct rte_trie_tbl *)p;		\
-	uint64_t tmp;							\
-	uint32_t i, j;							\
-									\
-	for (i = 0; i < n; i++) {					\
-		tmp = ((type *)dp->tbl24)[get_tbl24_idx(&ips[i][0])];	\
-		j = 3;							\
-		while (is_entry_extended(tmp)) {			\
-			tmp = ((type *)dp->tbl8)[ips[i][j++] +		\
-				((tmp >> 1) * TRIE_TBL8_GRP_NUM_ENT)];	\
-		}							\
-		next_hops[i] = tmp >> 1;				\
-	}								\
+	switch (dp->nh_sz) {
+	case RTE_FIB6_TRIE_2B:
+		return rte_trie_vec_lookup_bulk_2b;
+	case RTE_FIB6_TRIE_4B:
+		/* Gather indexes are signed 32 bits */
+		if ((uint64_t)dp->number_tbl8s * TRIE_TBL8_GRP_NUM_ENT >
+				INT32_MAX)
+			return NULL;
+		return rte_trie_vec_lookup_bulk_4b;
+	case RTE_FIB6_TRIE_8B:
+		return rte_trie_vec_lookup_bulk_8b;
+	default:
+		return NULL;
+	}
+#else
+	RTE_SET_USED(dp);
+	return NULL;
+#endif
 }
-LOOKUP_FUNC(2b, uint16_t, 1)
-LOOKUP_FUNC(4b, uint32_t, 2)
-LOOKUP_FUNC(8b, uint64_t, 3)
 
 rte_fib6_lookup_fn_t
-rte_trie_get_lookup_fn(struct rte_fib6_conf *conf)
+trie_get_lookup_fn(void *p, enum rte_fib6_lookup_type type)
 {
-	enum rte_fib_trie_nh_sz nh_sz = conf->trie.nh_sz;
-
-	if (test_lookup == MACRO) {
-		switch (nh_sz) {
-		case RTE_FIB6_TRIE_2B:
-			return rte_trie_lookup_bulk_2b;
-		case RTE_FIB6_TRIE_4B:
-			return rte_trie_lookup_bulk_4b;
-		case RTE_FIB6_TRIE_8B:
-			return rte_trie_lookup_bulk_8b;
-		}
+	struct rte_trie_tbl *dp = (struct rte_trie_tbl *)p;
+	rte_fib6_lookup_fn_t ret_fn;
+
+	switch (type) {
+	case RTE_FIB6_LOOKUP_TRIE_SCALAR:
+		return get_scalar_fn(dp->nh_sz);
+	case RTE_FIB6_LOOKUP_TRIE_VECTOR_AVX512:
+		return get_vector_fn(dp);
+	case RTE_FIB6_LOOKUP_DEFAULT:
+		ret_fn = get_vector_fn(dp);
+		return (ret_fn != NULL) ? ret_fn : get_scalar_fn(dp->nh_sz);
+	default:
+		return NULL;
 	}
-
-	return NULL;
 }
-
 static void
 write_to_dp(void *ptr, uint64_t val, enum rte_fib_trie_nh_sz size, int n)
 {
@@ -214,6 +134,17 @@ tbl8_pool_init(struct rte_trie_tbl *dp)
 static inline int32_t
 tbl8_get(struct rte_trie_tbl *dp)
 {
+	unsigned int freed = 0;
+
+	/*
+	 * Released tbl8 groups may still be waiting in the defer queue,
+	 * wait for the readers and take them back.
+	 */
+	if ((dp->tbl8_pool_pos == dp->number_tbl8s) && (dp->dq != NULL)) {
+		rte_rcu_qsbr_synchronize(dp->v, RTE_QSBR_THRID_INVALID);
+		rte_rcu_qsbr_dq_reclaim(dp->dq, dp->number_tbl8s,
+			&freed, NULL, NULL);
+	}
 	if (dp->tbl8_pool_pos == dp->number_tbl8s)
 		/* no more free tbl8 */
 		return -ENOSPC;
@@ -246,9 +177,48 @@ tbl8_alloc(struct rte_trie_tbl *dp, uint64_t nh)
 	/*Init tbl8 entries with nexthop from tbl24*/
 	write_to_dp((void *)tbl8_ptr, nh, dp->nh_sz,
 		TRIE_TBL8_GRP_NUM_ENT);
+	/*
+	 * The group must be initialized before an entry pointing
+	 * to it becomes visible to the readers.
+	 */
+	rte_smp_wmb();
 	return tbl8_idx;
 }
 
+static void
+tbl8_cleanup_and_free(struct rte_trie_tbl *dp, uint64_t tbl8_idx)
+{
+	uint8_t *ptr = (uint8_t *)dp->tbl8 +
+		((tbl8_idx * TRIE_TBL8_GRP_NUM_ENT) << dp->nh_sz);
+
+	memset(ptr, 0, TRIE_TBL8_GRP_NUM_ENT << dp->nh_sz);
+	tbl8_put(dp, tbl8_idx);
+}
+
+static void
+__rcu_qsbr_free_resource(void *p, void *data, unsigned int n __rte_unused)
+{
+	tbl8_cleanup_and_free((struct rte_trie_tbl *)p, *(uint32_t *)data);
+}
+
+/*
+ * Release a tbl8 group no longer referenced by its parent. Readers may
+ * still be walking it, so with RCU it is only reused after a grace period.
+ */
+static void
+tbl8_free(struct rte_trie_tbl *dp, uint64_t tbl8_idx)
+{
+	uint32_t idx = tbl8_idx;
+
+	if (dp->v != NULL) {
+		if (dp->rcu_mode == RTE_FIB6_QSBR_MODE_DQ &&
+				rte_rcu_qsbr_dq_enqueue(dp->dq, &idx) == 0)
+			return;
+		rte_rcu_qsbr_synchronize(dp->v, RTE_QSBR_THRID_INVALID);
+	}
+	tbl8_cleanup_and_free(dp, tbl8_idx);
+}
+
 static void
 tbl8_recycle(struct rte_trie_tbl *dp, void *par, uint64_t tbl8_idx)
 {
@@ -270,8 +240,6 @@ tbl8_recycle(struct rte_trie_tbl *dp, void *par, uint64_t tbl8_idx)
 				return;
 		}
 		write_to_dp(par, nh, dp->nh_sz, 1);
-		for (i = 0; i < TRIE_TBL8_GRP_NUM_ENT; i++)
-			ptr16[i] = 0;
 		break;
 	case RTE_FIB6_TRIE_4B:
 		ptr32 = &((uint32_t *)dp->tbl8)[tbl8_idx *
@@ -284,8 +252,6 @@ tbl8_recycle(struct rte_trie_tbl *dp, void *par, uint64_t tbl8_idx)
 				return;
 		}
 		write_to_dp(par, nh, dp->nh_sz, 1);
-		for (i = 0; i < TRIE_TBL8_GRP_NUM_ENT; i++)
-			ptr32[i] = 0;
 		break;
 	case RTE_FIB6_TRIE_8B:
 		ptr64 = &((uint64_t *)dp->tbl8)[tbl8_idx *
@@ -298,11 +264,9 @@ tbl8_recycle(struct rte_trie_tbl *dp, void *par, uint64_t tbl8_idx)
 				return;
 		}
 		write_to_dp(par, nh, dp->nh_sz, 1);
-		for (i = 0; i < TRIE_TBL8_GRP_NUM_ENT; i++)
-			ptr64[i] = 0;
 		break;
 	}
-	tbl8_put(dp, tbl8_idx);
+	tbl8_free(dp, tbl8_idx);
 }
 
 #define BYTE_SIZE	8
@@ -371,7 +335,7 @@ build_common_root(struct rte_trie_tbl *dp, const uint8_t *ip,
 	int i, j, idx, prev_idx = 0;
 
 	cur_tbl = dp->tbl24;
-	for (i = 3, j = 0; i <= common_bytes; i++) {
+	for (i = dp->tbl24_bytes, j = 0; i <= common_bytes; i++) {
 		idx = get_idx(ip, prev_idx, i - j, j);
 		val = get_tbl_val_by_idx(cur_tbl, idx, dp->nh_sz);
 		tbl_ptr = get_tbl_p_by_idx(cur_tbl, idx, dp->nh_sz);
@@ -424,7 +388,13 @@ write_edge(struct rte_trie_tbl *dp, const uint8_t *ip_part, uint64_t next_hop,
 				dp->nh_sz),
 				next_hop << 1, dp->nh_sz, *ip_part);
 		}
-		tbl8_recycle(dp, &val, tbl8_idx);
+		/*
+		 * Link the tbl8 first, so that it is unlinked before
+		 * being released if it gets recycled.
+		 */
+		write_to_dp(ent, val, dp->nh_sz, 1);
+		tbl8_recycle(dp, ent, tbl8_idx);
+		return ret;
 	}
 
 	write_to_dp(ent, val, dp->nh_sz, 1);
@@ -432,8 +402,6 @@ write_edge(struct rte_trie_tbl *dp, const uint8_t *ip_part, uint64_t next_hop,
 }
 
 #define IPV6_MAX_IDX	(RTE_FIB6_IPV6_ADDR_SIZE - 1)
-#define TBL24_BYTES	3
-#define TBL8_LEN	(RTE_FIB6_IPV6_ADDR_SIZE - TBL24_BYTES)
 
 static int
 install_to_dp(struct rte_trie_tbl *dp, const uint8_t *ledge, const uint8_t *r,
@@ -446,6 +414,8 @@ install_to_dp(struct rte_trie_tbl *dp, const uint8_t *ledge, const uint8_t *r,
 	int common_bytes;
 	int llen, rlen;
 	uint8_t redge[16];
+	uint8_t tbl24_bytes = dp->tbl24_bytes;
+	int in_tbl24;
 
 	/* decrement redge by 1*/
 	rte_rib6_copy_addr(redge, r);
@@ -464,30 +434,32 @@ install_to_dp(struct rte_trie_tbl *dp, const uint8_t *ledge, const uint8_t *r,
 	if (unlikely(ret != 0))
 		return ret;
 	/*first uncommon tbl8 byte idx*/
-	uint8_t first_tbl8_byte = RTE_MAX(common_bytes, TBL24_BYTES);
+	uint8_t first_tbl8_byte = RTE_MAX(common_bytes, tbl24_bytes);
+	/* the edges differ within the tbl24 index */
+	in_tbl24 = (common_bytes < tbl24_bytes);
 
 	for (i = IPV6_MAX_IDX; i > first_tbl8_byte; i--) {
 		if (ledge[i] != 0)
 			break;
 	}
 
-	llen = i - first_tbl8_byte + (common_bytes < 3);
+	llen = i - first_tbl8_byte + in_tbl24;
 
 	for (i = IPV6_MAX_IDX; i > first_tbl8_byte; i--) {
 		if (redge[i] != UINT8_MAX)
 			break;
 	}
-	rlen = i - first_tbl8_byte + (common_bytes < 3);
+	rlen = i - first_tbl8_byte + in_tbl24;
 
 	/*first noncommon byte*/
-	uint8_t first_byte_idx = (common_bytes < 3) ? 0 : common_bytes;
-	uint8_t first_idx_len = (common_bytes < 3) ? 3 : 1;
+	uint8_t first_byte_idx = in_tbl24 ? 0 : common_bytes;
+	uint8_t first_idx_len = in_tbl24 ? tbl24_bytes : 1;
 
 	uint32_t left_idx = get_idx(ledge, 0, first_idx_len, first_byte_idx);
 	uint32_t right_idx = get_idx(redge, 0, first_idx_len, first_byte_idx);
 
 	ent = get_tbl_p_by_idx(common_root_tbl, left_idx, dp->nh_sz);
-	ret = write_edge(dp, &ledge[first_tbl8_byte + !(common_bytes < 3)],
+	ret = write_edge(dp, &ledge[first_tbl8_byte + !in_tbl24],
 		next_hop, llen, LEDGE, ent);
 	if (ret < 0)
 		return ret;
@@ -499,15 +471,15 @@ install_to_dp(struct rte_trie_tbl *dp, const uint8_t *ledge, const uint8_t *r,
 			right_idx - (left_idx + 1));
 	}
 	ent = get_tbl_p_by_idx(common_root_tbl, right_idx, dp->nh_sz);
-	ret = write_edge(dp, &redge[first_tbl8_byte + !((common_bytes < 3))],
+	ret = write_edge(dp, &redge[first_tbl8_byte + !in_tbl24],
 		next_hop, rlen, REDGE, ent);
 	if (ret < 0)
 		return ret;
 
-	uint8_t	common_tbl8 = (common_bytes < TBL24_BYTES) ?
-			0 : common_bytes - (TBL24_BYTES - 1);
+	uint8_t	common_tbl8 = in_tbl24 ?
+			0 : common_bytes - (tbl24_bytes - 1);
 	ent = get_tbl24_p(dp, ledge, dp->nh_sz);
-	recycle_root_path(dp, ledge + TBL24_BYTES, common_tbl8, ent);
+	recycle_root_path(dp, ledge + tbl24_bytes, common_tbl8, ent);
 	return 0;
 }
 
@@ -592,7 +564,7 @@ trie_modify(struct rte_fib6 *fib, const uint8_t ip[RTE_FIB6_IPV6_ADDR_SIZE],
 	uint8_t	ip_masked[RTE_FIB6_IPV6_ADDR_SIZE];
 	int i, ret = 0;
 	uint64_t par_nh, node_nh;
-	uint8_t tmp_depth, depth_diff = 0, parent_depth = 24;
+	uint8_t tmp_depth, depth_diff = 0, parent_depth, tbl24_depth;
 
 	if ((fib == NULL) || (ip == NULL) || (depth > RTE_FIB6_MAXDEPTH))
 		return -EINVAL;
@@ -601,26 +573,30 @@ trie_modify(struct rte_fib6 *fib, const uint8_t ip[RTE_FIB6_IPV6_ADDR_SIZE],
 	RTE_ASSERT(dp);
 	rib = rte_fib6_get_rib(fib);
 	RTE_ASSERT(rib);
+	tbl24_depth = dp->tbl24_bytes * 8;
+	parent_depth = tbl24_depth;
 
 	for (i = 0; i < RTE_FIB6_IPV6_ADDR_SIZE; i++)
 		ip_masked[i] = ip[i] & get_msk_part(depth, i);
 
-	if (depth > 24) {
+	node = rte_rib6_lookup_exact(rib, ip_masked, depth);
+	if (depth > tbl24_depth) {
 		tmp = rte_rib6_get_nxt(rib, ip_masked,
 			RTE_ALIGN_FLOOR(depth, 8), NULL,
 			RTE_RIB6_GET_NXT_COVER);
 		if (tmp == NULL) {
-			tmp = rte_rib6_lookup(rib, ip);
+			/* the route itself must not be taken as its parent */
+			tmp = (node != NULL) ? rte_rib6_lookup_parent(node) :
+				rte_rib6_lookup(rib, ip);
 			if (tmp != NULL) {
 				rte_rib6_get_depth(tmp, &tmp_depth);
-				parent_depth = RTE_MAX(tmp_depth, 24);
+				parent_depth = RTE_MAX(tmp_depth, tbl24_depth);
 			}
 			depth_diff = RTE_ALIGN_CEIL(depth, 8) -
 				RTE_ALIGN_CEIL(parent_depth, 8);
 			depth_diff = depth_diff >> 3;
 		}
 	}
-	node = rte_rib6_lookup_exact(rib, ip_masked, depth);
 	switch (op) {
 	case RTE_FIB6_ADD:
 		if (node != NULL) {
@@ -633,7 +609,7 @@ trie_modify(struct rte_fib6 *fib, const uint8_t ip[RTE_FIB6_IPV6_ADDR_SIZE],
 			return 0;
 		}
 
-		if ((depth > 24) && (dp->rsvd_tbl8s >=
+		if ((depth > tbl24_depth) && (dp->rsvd_tbl8s >=
 				dp->number_tbl8s - depth_diff))
 			return -ENOSPC;
 
@@ -690,6 +666,7 @@ trie_create(const char *name, int socket_id,
 	uint64_t	def_nh;
 	uint32_t	num_tbl8;
 	enum rte_fib_trie_nh_sz	nh_sz;
+	uint8_t		root_stride;
 
 	if ((name == NULL) || (conf == NULL) ||
 			(conf->trie.nh_sz < RTE_FIB6_TRIE_2B) ||
@@ -704,20 +681,33 @@ trie_create(const char *name, int socket_id,
 		return NULL;
 	}
 
+	root_stride = conf->trie.root_stride;
+	if (root_stride == 0)
+		root_stride = TRIE_TBL24_DEPTH;
+	if ((root_stride != 8) && (root_stride != 16) &&
+			(root_stride != TRIE_TBL24_DEPTH)) {
+		rte_errno = EINVAL;
+		return NULL;
+	}
+
 	def_nh = conf->default_nh;
 	nh_sz = conf->trie.nh_sz;
 	num_tbl8 = conf->trie.num_tbl8;
 
 	snprintf(mem_name, sizeof(mem_name), "DP_%s", name);
+	/*
+	 * The vector lookup reads 2-byte next hops as 4 bytes, keep room
+	 * for it after the last tbl24 entry (tbl8 has a spare group).
+	 */
 	dp = rte_zmalloc_socket(name, sizeof(struct rte_trie_tbl) +
-		TRIE_TBL24_NUM_ENT * (1 << nh_sz), RTE_CACHE_LINE_SIZE,
-		socket_id);
+		(1 << root_stride) * (1 << nh_sz) + sizeof(uint32_t),
+		RTE_CACHE_LINE_SIZE, socket_id);
 	if (dp == NULL) {
 		rte_errno = ENOMEM;
 		return dp;
 	}
 
-	write_to_dp(&dp->tbl24, (def_nh << 1), nh_sz, 1 << 24);
+	write_to_dp(&dp->tbl24, (def_nh << 1), nh_sz, 1 << root_stride);
 
 	snprintf(mem_name, sizeof(mem_name), "TBL8_%p", dp);
 	dp->tbl8 = rte_zmalloc_socket(mem_name, TRIE_TBL8_GRP_NUM_ENT *
@@ -730,6 +720,7 @@ trie_create(const char *name, int socket_id,
 	}
 	dp->def_nh = def_nh;
 	dp->nh_sz = nh_sz;
+	dp->tbl24_bytes = root_stride / 8;
 	dp->number_tbl8s = num_tbl8;
 
 	snprintf(mem_name, sizeof(mem_name), "TBL8_idxes_%p", dp);
@@ -753,7 +744,175 @@ trie_free(void *p)
 {
 	struct rte_trie_tbl *dp = (struct rte_trie_tbl *)p;
 
+	rte_rcu_qsbr_dq_delete(dp->dq);
 	rte_free(dp->tbl8_pool);
 	rte_free(dp->tbl8);
 	rte_free(dp);
 }
+
+int
+trie_rcu_qsbr_add(void *p, struct rte_fib6_rcu_config *cfg, const char *name)
+{
+	struct rte_rcu_qsbr_dq_parameters params = {0};
+	char rcu_dq_name[RTE_RCU_QSBR_DQ_NAMESIZE];
+	struct rte_trie_tbl *dp = p;
+
+	if ((dp == NULL) || (cfg == NULL) || (cfg->v == NULL) ||
+			((cfg->mode != RTE_FIB6_QSBR_MODE_DQ) &&
+			(cfg->mode != RTE_FIB6_QSBR_MODE_SYNC)))
+		return -EINVAL;
+
+	if (dp->v != NULL)
+		return -EEXIST;
+
+	if (cfg->mode == RTE_FIB6_QSBR_MODE_DQ) {
+		/* Init QSBR defer queue. */
+		snprintf(rcu_dq_name, sizeof(rcu_dq_name), "FIB6_%s", name);
+		params.name = rcu_dq_name;
+		params.size = cfg->dq_size;
+		if (params.size == 0)
+			params.size = dp->number_tbl8s;
+		params.trigger_reclaim_limit = cfg->reclaim_thd;
+		params.max_reclaim_size = cfg->reclaim_max;
+		if (params.max_reclaim_size == 0)
+			params.max_reclaim_size = RTE_FIB6_RCU_DQ_RECLAIM_MAX;
+		params.esize = sizeof(uint32_t);	/* tbl8 group index */
+		params.free_fn = __rcu_qsbr_free_resource;
+		params.p = dp;
+		params.v = cfg->v;
+		dp->dq = rte_rcu_qsbr_dq_create(&params);
+		if (dp->dq == NULL) {
+			RTE_LOG(ERR, LPM, "FIB6 defer queue creation failed\n");
+			return -ENOMEM;
+		}
+	}
+
+	dp->rcu_mode = cfg->mode;
+	dp->v = cfg->v;
+
+	return 0;
+}
+
+/* Size of a tbl8 group in bytes */
+static inline size_t
+tbl8_grp_sz(struct rte_trie_tbl *dp)
+{
+	return (size_t)TRIE_TBL8_GRP_NUM_ENT << dp->nh_sz;
+}
+
+static inline void *
+get_tbl8_grp_p(struct rte_trie_tbl *dp, uint32_t idx)
+{
+	return (uint8_t *)dp->tbl8 + idx * tbl8_grp_sz(dp);
+}
+
+/*
+ * The pool is a stack of free tbl8 indexes above tbl8_pool_pos, the used
+ * groups are the ones missing from it. Mark them in used[].
+ */
+static uint8_t *
+get_used_tbl8s(struct rte_trie_tbl *dp)
+{
+	uint8_t *used;
+	uint32_t i;
+
+	used = rte_malloc(NULL, dp->number_tbl8s, 0);
+	if (used == NULL)
+		return NULL;
+
+	memset(used, 1, dp->number_tbl8s);
+	for (i = dp->tbl8_pool_pos; i < dp->number_tbl8s; i++)
+		used[dp->tbl8_pool[i]] = 0;
+
+	return used;
+}
+
+/*
+ * Save the tables as they are: the tbl24, the pool of free tbl8 indexes,
+ * then the used groups in index order. tbl8 groups are referenced by
+ * index so the saved tables need no relocation.
+ */
+int
+trie_save(void *p, FILE *f)
+{
+	struct rte_trie_tbl *dp = p;
+	uint32_t cnt[3], i;
+	unsigned int freed;
+	uint8_t *used;
+	int ret = 0;
+
+	/* don't save groups only waiting for the readers */
+	if (dp->dq != NULL) {
+		rte_rcu_qsbr_synchronize(dp->v, RTE_QSBR_THRID_INVALID);
+		rte_rcu_qsbr_dq_reclaim(dp->dq, dp->number_tbl8s,
+			&freed, NULL, NULL);
+	}
+
+	cnt[0] = dp->rsvd_tbl8s;
+	cnt[1] = dp->cur_tbl8s;
+	cnt[2] = dp->tbl8_pool_pos;
+	if ((fwrite(cnt, sizeof(cnt), 1, f) != 1) ||
+			(fwrite(dp->tbl24, (size_t)1 <<
+			(dp->tbl24_bytes * 8 + dp->nh_sz), 1,
+			f) != 1) ||
+			(fwrite(dp->tbl8_pool, sizeof(dp->tbl8_pool[0]),
+			dp->number_tbl8s, f) != dp->number_tbl8s))
+		return -EIO;
+
+	used = get_used_tbl8s(dp);
+	if (used == NULL)
+		return -ENOMEM;
+
+	for (i = 0; i < dp->number_tbl8s; i++) {
+		if (used[i] && (fwrite(get_tbl8_grp_p(dp, i),
+				tbl8_grp_sz(dp), 1, f) != 1)) {
+			ret = -EIO;
+			break;
+		}
+	}
+
+	rte_free(used);
+	return ret;
+}
+
+int
+trie_restore(void *p, FILE *f)
+{
+	struct rte_trie_tbl *dp = p;
+	uint32_t cnt[3], i;
+	uint8_t *used;
+	int ret = 0;
+
+	if ((fread(cnt, sizeof(cnt), 1, f) != 1) ||
+			(fread(dp->tbl24, (size_t)1 <<
+			(dp->tbl24_bytes * 8 + dp->nh_sz), 1,
+			f) != 1) ||
+			(fread(dp->tbl8_pool, sizeof(dp->tbl8_pool[0]),
+			dp->number_tbl8s, f) != dp->number_tbl8s))
+		return -EIO;
+	if ((cnt[0] > dp->number_tbl8s) || (cnt[1] > dp->number_tbl8s) ||
+			(cnt[2] > dp->number_tbl8s))
+		return -EINVAL;
+	for (i = 0; i < dp->number_tbl8s; i++) {
+		if (dp->tbl8_pool[i] >= dp->number_tbl8s)
+			return -EINVAL;
+	}
+	dp->rsvd_tbl8s = cnt[0];
+	dp->cur_tbl8s = cnt[1];
+	dp->tbl8_pool_pos = cnt[2];
+
+	used = get_used_tbl8s(dp);
+	if (used == NULL)
+		return -ENOMEM;
+
+	for (i = 0; i < dp->number_tbl8s; i++) {
+		if (used[i] && (fread(get_tbl8_grp_p(dp, i),
+				tbl8_grp_sz(dp), 1, f) != 1)) {
+			ret = -EIO;
+			break;
+		}
+	}
+
+	rte_free(used);
+	return ret;
+}
@@ -0,0 +1,205 @@
+/* SPDX-License-Identifier: BSD-3-Clause
+ * Copyright(c) 2020 Intel Corporation
+ */
+
+#include <rte_vect.h>
+#include <rte_fib6.h>
+
+#include "trie.h"
+#include "trie_avx512.h"
+
+/*
+ * Transpose the 4 address words of 8 addresses held in two vectors:
+ * the first result holds word 0 of the 8 addresses then their word 1,
+ * the second one their words 2 and 3.
+ */
+static __rte_always_inline void
+transpose_x8(__m512i a, __m512i b, __m512i *w01, __m512i *w23)
+{
+	const __m512i perm_01 = _mm512_set_epi32(29, 25, 21, 17, 13, 9, 5, 1,
+		28, 24, 20, 16, 12, 8, 4, 0);
+	const __m512i perm_23 = _mm512_set_epi32(31, 27, 23, 19, 15, 11, 7, 3,
+		30, 26, 22, 18, 14, 10, 6, 2);
+
+	*w01 = _mm512_permutex2var_epi32(a, perm_01, b);
+	*w23 = _mm512_permutex2var_epi32(a, perm_23, b);
+}
+
+/* tbl24 index of each address from its first word, in network order */
+static __rte_always_inline __m512i
+get_tbl24_idx_vec(__m512i w, uint8_t tbl24_bytes)
+{
+	const __m512i odd_bytes = _mm512_set1_epi32(0xff00ff00);
+	__m512i bswap;
+
+	bswap = _mm512_ternarylogic_epi32(odd_bytes, _mm512_ror_epi32(w, 8),
+		_mm512_rol_epi32(w, 8), 0xca);
+	return _mm512_srl_epi32(bswap,
+		_mm_cvtsi32_si128(32 - tbl24_bytes * 8));
+}
+
+/* Byte j of each address, from its 4 words */
+static __rte_always_inline __m512i
+get_byte_vec(const __m512i *words, unsigned int j)
+{
+	return _mm512_and_epi32(_mm512_srl_epi32(words[j >> 2],
+		_mm_cvtsi32_si128((j & 3) * 8)), _mm512_set1_epi32(UINT8_MAX));
+}
+
+/*
+ * Look up 16 addresses at once: one gather in tbl24, then one masked
+ * gather per trie level for the addresses whose entry is still extended,
+ * until all of them reached their next hop.
+ * 2-byte next hops are read as 4 bytes and masked, the tables are
+ * allocated with enough room at the end for it.
+ */
+static __rte_always_inline void
+trie_vec_lookup_x16(void *p, uint8_t ips[][RTE_FIB6_IPV6_ADDR_SIZE],
+	uint64_t *next_hops, int size)
+{
+	struct rte_trie_tbl *dp = (struct rte_trie_tbl *)p;
+	const __m512i zero = _mm512_set1_epi32(0);
+	const __m512i lsb = _mm512_set1_epi32(1);
+	__m512i res_msk = _mm512_set1_epi32(UINT32_MAX);
+	__m512i t01_lo, t01_hi, t23_lo, t23_hi;
+	__m512i words[4], idxes, res, tmp;
+	__mmask16 msk_ext;
+	unsigned int j;
+
+	/* used to mask gathered values if next hops are 2 bytes */
+	if (size == sizeof(uint16_t))
+		res_msk = _mm512_set1_epi32(UINT16_MAX);
+
+	/* word k of the 16 addresses in words[k] */
+	transpose_x8(_mm512_loadu_si512(ips[0]), _mm512_loadu_si512(ips[4]),
+		&t01_lo, &t23_lo);
+	transpose_x8(_mm512_loadu_si512(ips[8]), _mm512_loadu_si512(ips[12]),
+		&t01_hi, &t23_hi);
+	words[0] = _mm512_shuffle_i64x2(t01_lo, t01_hi, 0x44);
+	words[1] = _mm512_shuffle_i64x2(t01_lo, t01_hi, 0xee);
+	words[2] = _mm512_shuffle_i64x2(t23_lo, t23_hi, 0x44);
+	words[3] = _mm512_shuffle_i64x2(t23_lo, t23_hi, 0xee);
+
+	idxes = get_tbl24_idx_vec(words[0], dp->tbl24_bytes);
+
+	/* the scale of a gather must be an immediate */
+	if (size == sizeof(uint16_t))
+		res = _mm512_i32gather_epi32(idxes,
+			(const int *)dp->tbl24, 2);
+	else
+		res = _mm512_i32gather_epi32(idxes,
+			(const int *)dp->tbl24, 4);
+	res = _mm512_and_epi32(res, res_msk);
+
+	/* extended entries point to a tbl8 group of the next level */
+	msk_ext = _mm512_test_epi32_mask(res, lsb);
+
+	for (j = dp->tbl24_bytes; msk_ext != 0; j++) {
+		idxes = _mm512_srli_epi32(res, 1);
+		idxes = _mm512_slli_epi32(idxes, 8);
+		idxes = _mm512_add_epi32(idxes, get_byte_vec(words, j));
+		if (size == sizeof(uint16_t))
+			tmp = _mm512_mask_i32gather_epi32(zero, msk_ext,
+				idxes, (const int *)dp->tbl8, 2);
+		else
+			tmp = _mm512_mask_i32gather_epi32(zero, msk_ext,
+				idxes, (const int *)dp->tbl8, 4);
+		tmp = _mm512_and_epi32(tmp, res_msk);
+
+		res = _mm512_mask_blend_epi32(msk_ext, res, tmp);
+		msk_ext = _mm512_mask_test_epi32_mask(msk_ext, res, lsb);
+	}
+
+	res = _mm512_srli_epi32(res, 1);
+	/* zero extend to the 64-bit next hops */
+	_mm512_storeu_si512(next_hops,
+		_mm512_cvtepu32_epi64(_mm512_castsi512_si256(res)));
+	_mm512_storeu_si512(next_hops + 8,
+		_mm512_cvtepu32_epi64(_mm512_extracti64x4_epi64(res, 1)));
+}
+
+/* Look up 8 addresses at once in a FIB with 8-byte next hops */
+static __rte_always_inline void
+trie_vec_lookup_x8_8b(void *p, uint8_t ips[][RTE_FIB6_IPV6_ADDR_SIZE],
+	uint64_t *next_hops)
+{
+	struct rte_trie_tbl *dp = (struct rte_trie_tbl *)p;
+	const __m512i zero = _mm512_set1_epi32(0);
+	const __m512i lsb = _mm512_set1_epi64(1);
+	const __m512i lsbyte_msk = _mm512_set1_epi64(UINT8_MAX);
+	__m512i w01, w23, words[4], idxes, res, tmp;
+	__m256i idxes_256;
+	__mmask8 msk_ext;
+	unsigned int j;
+
+	transpose_x8(_mm512_loadu_si512(ips[0]), _mm512_loadu_si512(ips[4]),
+		&w01, &w23);
+	/* word k of the 8 addresses in the 64-bit lanes of words[k] */
+	words[0] = _mm512_cvtepu32_epi64(_mm512_castsi512_si256(w01));
+	words[1] = _mm512_cvtepu32_epi64(_mm512_extracti64x4_epi64(w01, 1));
+	words[2] = _mm512_cvtepu32_epi64(_mm512_castsi512_si256(w23));
+	words[3] = _mm512_cvtepu32_epi64(_mm512_extracti64x4_epi64(w23, 1));
+
+	idxes_256 = _mm512_castsi512_si256(get_tbl24_idx_vec(w01,
+		dp->tbl24_bytes));
+	res = _mm512_i32gather_epi64(idxes_256, (const void *)dp->tbl24, 8);
+
+	/* extended entries point to a tbl8 group of the next level */
+	msk_ext = _mm512_test_epi64_mask(res, lsb);
+
+	for (j = dp->tbl24_bytes; msk_ext != 0; j++) {
+		idxes = _mm512_srli_epi64(res, 1);
+		idxes = _mm512_slli_epi64(idxes, 8);
+		tmp = _mm512_and_epi64(_mm512_srl_epi64(words[j >> 2],
+			_mm_cvtsi32_si128((j & 3) * 8)), lsbyte_msk);
+		idxes = _mm512_add_epi64(idxes, tmp);
+		tmp = _mm512_mask_i64gather_epi64(zero, msk_ext, idxes,
+			(const void *)dp->tbl8, 8);
+
+		res = _mm512_mask_blend_epi64(msk_ext, res, tmp);
+		msk_ext = _mm512_mask_test_epi64_mask(msk_ext, res, lsb);
+	}
+
+	res = _mm512_srli_epi64(res, 1);
+	_mm512_storeu_si512(next_hops, res);
+}
+
+void
+rte_trie_vec_lookup_bulk_2b(void *p, uint8_t ips[][RTE_FIB6_IPV6_ADDR_SIZE],
+	uint64_t *next_hops, const unsigned int n)
+{
+	uint32_t i;
+
+	for (i = 0; i < (n / 16); i++)
+		trie_vec_lookup_x16(p, ips + i * 16, next_hops + i * 16,
+			sizeof(uint16_t));
+
+	trie_lookup_bulk_2b(p, ips + i * 16, next_hops + i * 16,
+		n - i * 16);
+}
+
+void
+rte_trie_vec_lookup_bulk_4b(void *p, uint8_t ips[][RTE_FIB6_IPV6_ADDR_SIZE],
+	uint64_t *next_hops, const unsigned int n)
+{
+	uint32_t i;
+
+	for (i = 0; i < (n / 16); i++)
+		trie_vec_lookup_x16(p, ips + i * 16, next_hops + i * 16,
+			sizeof(uint32_t));
+
+	trie_lookup_bulk_4b(p, ips + i * 16, next_hops + i * 16,
+		n - i * 16);
+}
+
+void
+rte_trie_vec_lookup_bulk_8b(void *p, uint8_t ips[][RTE_FIB6_IPV6_ADDR_SIZE],
+	uint64_t *next_hops, const unsigned int n)
+{
+	uint32_t i;
+
+	for (i = 0; i < (n / 8); i++)
+		trie_vec_lookup_x8_8b(p, ips + i * 8, next_hops + i * 8);
+
+	trie_lookup_bulk_8b(p, ips + i * 8, next_hops + i * 8, n - i * 8);
+}
@@ -16,7 +16,7 @@ gro_tcp4_tbl_create(uint16_t socket_id,
 {
 	struct gro_tcp4_tbl *tbl;
 	size_t size;
-	uint32_t entries_num, i;
+	uint32_t entries_num, hash_size, i;
 
 	entries_num = max_flow_num * max_item_per_flow;
 	entries_num = RTE_MIN(entries_num, GRO_TCP4_TBL_MAX_ITEM_NUM);
@@ -57,6 +57,25 @@ gro_tcp4_tbl_create(uint16_t socket_id,
 		tbl->flows[i].start_index = INVALID_ARRAY_INDEX;
 	tbl->max_flow_num = entries_num;
 
+	hash_size = gro_flow_hash_size(entries_num);
+	size = sizeof(uint32_t) * (hash_size + 2 * entries_num);
+	tbl->flow_hash = rte_malloc_socket(__func__,
+			size,
+			RTE_CACHE_LINE_SIZE,
+			socket_id);
+	if (tbl->flow_hash == NULL) {
+		rte_free(tbl->flows);
+		rte_free(tbl->items);
+		rte_free(tbl);
+		return NULL;
+	}
+	tbl->free_items = tbl->flow_hash + hash_size;
+	tbl->free_flows = tbl->free_items + entries_num;
+	tbl->flow_hash_mask = hash_size - 1;
+	gro_tbl_init_free(tbl->flow_hash, hash_size,
+			tbl->free_items, entries_num,
+			tbl->free_flows, entries_num);
+
 	return tbl;
 }
 
@@ -68,6 +87,7 @@ gro_tcp4_tbl_destroy(void *tbl)
 	if (tcp_tbl) {
 		rte_free(tcp_tbl->items);
 		rte_free(tcp_tbl->flows);
+		rte_free(tcp_tbl->flow_hash);
 	}
 	rte_free(tcp_tbl);
 }
@@ -75,24 +95,42 @@ gro_tcp4_tbl_destroy(void *tbl)
 static inline uint32_t
 find_an_empty_item(struct gro_tcp4_tbl *tbl)
 {
-	uint32_t i;
-	uint32_t max_item_num = tbl->max_item_num;
-
-	for (i = 0; i < max_item_num; i++)
-		if (tbl->items[i].firstseg == NULL)
-			return i;
-	return INVALID_ARRAY_INDEX;
+	if (unlikely(tbl->item_num == tbl->max_item_num))
+		return INVALID_ARRAY_INDEX;
+	return tbl->free_items[tbl->max_item_num - tbl->item_num - 1];
 }
 
 static inline uint32_t
 find_an_empty_flow(struct gro_tcp4_tbl *tbl)
 {
-	uint32_t i;
-	uint32_t max_flow_num = tbl->max_flow_num;
+	if (unlikely(tbl->flow_num == tbl->max_flow_num))
+		return INVALID_ARRAY_INDEX;
+	return tbl->free_flows[tbl->max_flow_num - tbl->flow_num - 1];
+}
 
-	for (i = 0; i < max_flow_num; i++)
-		if (tbl->flows[i].start_index == INVALID_ARRAY_INDEX)
-			return i;
+/*
+ * Look a flow up in the flow hash table. If it isn't found, the empty
+ * bucket where to insert it is returned in 'bucket'.
+ */
+static inline uint32_t
+find_a_flow(struct gro_tcp4_tbl *tbl,
+		struct tcp4_flow_key *key,
+		uint32_t hash,
+		uint32_t *bucket)
+{
+	uint32_t mask = tbl->flow_hash_mask;
+	uint32_t b, flow_idx;
+
+	for (b = hash & mask; ; b = (b + 1) & mask) {
+		flow_idx = tbl->flow_hash[b];
+		if (flow_idx == INVALID_ARRAY_INDEX)
+			break;
+		if (tbl->flows[flow_idx].hash == hash &&
+				is_same_tcp4_flow(tbl->flows[flow_idx].key,
+					*key))
+			return flow_idx;
+	}
+	*bucket = b;
 	return INVALID_ARRAY_INDEX;
 }
 
@@ -140,6 +178,7 @@ delete_item(struct gro_tcp4_tbl *tbl, uint32_t item_idx,
 	/* NULL indicates an empty item */
 	tbl->items[item_idx].firstseg = NULL;
 	tbl->item_num--;
+	tbl->free_items[tbl->max_item_num - tbl->item_num - 1] = item_idx;
 	if (prev_item_idx != INVALID_ARRAY_INDEX)
 		tbl->items[prev_item_idx].next_pkt_idx = next_idx;
 
@@ -149,6 +188,8 @@ delete_item(struct gro_tcp4_tbl *tbl, uint32_t item_idx,
 static inline uint32_t
 insert_new_flow(struct gro_tcp4_tbl *tbl,
 		struct tcp4_flow_key *src,
+		uint32_t hash,
+		uint32_t bucket,
 		uint32_t item_idx)
 {
 	struct tcp4_flow_key *dst;
@@ -168,12 +209,45 @@ insert_new_flow(struct gro_tcp4_tbl *tbl,
 	dst->src_port = src->src_port;
 	dst->dst_port = src->dst_port;
 
+	tbl->flows[flow_idx].hash = hash;
 	tbl->flows[flow_idx].start_index = item_idx;
+	tbl->flow_hash[bucket] = flow_idx;
 	tbl->flow_num++;
 
 	return flow_idx;
 }
 
+/*
+ * Delete an empty flow, shifting back the following entries of its probe
+ * sequence in the flow hash table.
+ */
+static inline void
+delete_flow(struct gro_tcp4_tbl *tbl, uint32_t flow_idx)
+{
+	uint32_t mask = tbl->flow_hash_mask;
+	uint32_t i, j, idx, home;
+
+	i = tbl->flows[flow_idx].hash & mask;
+	while (tbl->flow_hash[i] != flow_idx)
+		i = (i + 1) & mask;
+
+	for (j = (i + 1) & mask; tbl->flow_hash[j] != INVALID_ARRAY_INDEX;
+			j = (j + 1) & mask) {
+		idx = tbl->flow_hash[j];
+		home = tbl->flows[idx].hash & mask;
+		/* an entry can't move before its home bucket */
+		if (((j - home) & mask) < ((j - i) & mask))
+			continue;
+		tbl->flow_hash[i] = idx;
+		i = j;
+	}
+	tbl->flow_hash[i] = INVALID_ARRAY_INDEX;
+
+	tbl->flows[flow_idx].start_index = INVALID_ARRAY_INDEX;
+	tbl->flow_num--;
+	tbl->free_flows[tbl->max_flow_num - tbl->flow_num - 1] = flow_idx;
+}
+
 /*
  * update the packet length for the flushed packet.
  */
@@ -204,9 +278,8 @@ gro_tcp4_reassemble(struct rte_mbuf *pkt,
 
 	struct tcp4_flow_key key;
 	uint32_t cur_idx, prev_idx, item_idx;
-	uint32_t i, max_flow_num, remaining_flow_num;
+	uint32_t flow_idx, hash, bucket;
 	int cmp;
-	uint8_t find;
 
 	/*
 	 * Don't process the packet whose TCP header length is greater
@@ -252,30 +325,20 @@ gro_tcp4_reassemble(struct rte_mbuf *pkt,
 	key.recv_ack = tcp_hdr->recv_ack;
 
 	/* Search for a matched flow. */
-	max_flow_num = tbl->max_flow_num;
-	remaining_flow_num = tbl->flow_num;
-	find = 0;
-	for (i = 0; i < max_flow_num && remaining_flow_num; i++) {
-		if (tbl->flows[i].start_index != INVALID_ARRAY_INDEX) {
-			if (is_same_tcp4_flow(tbl->flows[i].key, key)) {
-				find = 1;
-				break;
-			}
-			remaining_flow_num--;
-		}
-	}
+	hash = tcp4_flow_hash(&key);
+	flow_idx = find_a_flow(tbl, &key, hash, &bucket);
 
 	/*
 	 * Fail to find a matched flow. Insert a new flow and store the
 	 * packet into the flow.
 	 */
-	if (find == 0) {
+	if (flow_idx == INVALID_ARRAY_INDEX) {
 		item_idx = insert_new_item(tbl, pkt, start_time,
 				INVALID_ARRAY_INDEX, sent_seq, ip_id,
 				is_atomic);
 		if (item_idx == INVALID_ARRAY_INDEX)
 			return -1;
-		if (insert_new_flow(tbl, &key, item_idx) ==
+		if (insert_new_flow(tbl, &key, hash, bucket, item_idx) ==
 				INVALID_ARRAY_INDEX) {
 			/*
 			 * Fail to insert a new flow, so delete the
@@ -291,7 +354,7 @@ gro_tcp4_reassemble(struct rte_mbuf *pkt,
 	 * Check all packets in the flow and try to find a neighbor for
 	 * the input packet.
 	 */
-	cur_idx = tbl->flows[i].start_index;
+	cur_idx = tbl->flows[flow_idx].start_index;
 	prev_idx = cur_idx;
 	do {
 		cmp = check_seq_option(&(tbl->items[cur_idx]), tcp_hdr,
@@ -351,7 +414,7 @@ gro_tcp4_tbl_timeout_flush(struct gro_tcp4_tbl *tbl,
 				j = delete_item(tbl, j, INVALID_ARRAY_INDEX);
 				tbl->flows[i].start_index = j;
 				if (j == INVALID_ARRAY_INDEX)
-					tbl->flow_num--;
+					delete_flow(tbl, i);
 
 				if (unlikely(k == nb_out))
 					return k;
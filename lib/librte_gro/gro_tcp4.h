@@ -37,6 +37,8 @@ struct tcp4_flow_key {
 
 struct gro_tcp4_flow {
 	struct tcp4_flow_key key;
+	/* hash of the key, see tcp4_flow_hash() */
+	uint32_t hash;
 	/*
 	 * The index of the first packet in the flow.
 	 * INVALID_ARRAY_INDEX indicates an empty flow.
@@ -82,6 +84,15 @@ struct gro_tcp4_tbl {
 	struct gro_tcp4_item *items;
 	/* flow array */
 	struct gro_tcp4_flow *flows;
+	/*
+	 * Open addressed hash table of flow indexes, with linear probing.
+	 * INVALID_ARRAY_INDEX indicates an empty bucket.
+	 */
+	uint32_t *flow_hash;
+	/* free item indexes, the next one to use last */
+	uint32_t *free_items;
+	/* free flow indexes, the next one to use last */
+	uint32_t *free_flows;
 	/* current item number */
 	uint32_t item_num;
 	/* current flow num */
@@ -90,6 +101,8 @@ struct gro_tcp4_tbl {
 	uint32_t max_item_num;
 	/* flow array size */
 	uint32_t max_flow_num;
+	/* number of buckets in the flow hash table minus 1 */
+	uint32_t flow_hash_mask;
 };
 
 /**
@@ -182,6 +195,67 @@ uint16_t gro_tcp4_tbl_timeout_flush(struct gro_tcp4_tbl *tbl,
  */
 uint32_t gro_tcp4_tbl_pkt_count(void *tbl);
 
+/*
+ * Number of buckets of a flow hash table, keeping it at most half full.
+ */
+static inline uint32_t
+gro_flow_hash_size(uint32_t max_flow_num)
+{
+	return rte_align32pow2(RTE_MAX(max_flow_num, 1U) * 2);
+}
+
+/*
+ * Initialize the flow hash table and the free lists of a table, so that
+ * the items and flows are used in index order.
+ */
+static inline void
+gro_tbl_init_free(uint32_t *flow_hash, uint32_t flow_hash_size,
+		uint32_t *free_items, uint32_t max_item_num,
+		uint32_t *free_flows, uint32_t max_flow_num)
+{
+	uint32_t i;
+
+	memset(flow_hash, 0xff, sizeof(uint32_t) * flow_hash_size);
+	for (i = 0; i < max_item_num; i++)
+		free_items[i] = max_item_num - 1 - i;
+	for (i = 0; i < max_flow_num; i++)
+		free_flows[i] = max_flow_num - 1 - i;
+}
+
+/*
+ * Final mix of a flow hash, so that the low bits select the bucket.
+ */
+static inline uint32_t
+gro_hash_fini(uint32_t h)
+{
+	h ^= h >> 16;
+	h *= 0x85ebca6b;
+	h ^= h >> 13;
+	h *= 0xc2b2ae35;
+	h ^= h >> 16;
+
+	return h;
+}
+
+#define GRO_HASH_PRIME 0x9e3779b1
+
+/*
+ * Hash of a TCP/IPv4 flow. The Ethernet addresses are left out, as they
+ * rarely tell flows apart, but are still compared on lookup.
+ */
+static inline uint32_t
+tcp4_flow_hash(const struct tcp4_flow_key *k)
+{
+	uint32_t h;
+
+	h = k->ip_src_addr;
+	h = h * GRO_HASH_PRIME ^ k->ip_dst_addr;
+	h = h * GRO_HASH_PRIME ^ ((uint32_t)k->src_port << 16 | k->dst_port);
+	h = h * GRO_HASH_PRIME ^ k->recv_ack;
+
+	return gro_hash_fini(h);
+}
+
 /*
  * Check if two TCP/IPv4 packets belong to the same flow.
  */
@@ -0,0 +1,477 @@
+/* SPDX-License-Identifier: BSD-3-Clause
+ * Copyright(c) 2020 Intel Corporation
+ */
+
+#include <rte_malloc.h>
+#include <rte_mbuf.h>
+#include <rte_cycles.h>
+#include <rte_ethdev.h>
+
+#include "gro_udp.h"
+
+void *
+gro_udp_tbl_create(uint16_t socket_id,
+		uint16_t max_flow_num,
+		uint16_t max_item_per_flow)
+{
+	struct gro_udp_tbl *tbl;
+	size_t size;
+	uint32_t entries_num, hash_size, i;
+
+	entries_num = max_flow_num * max_item_per_flow;
+	entries_num = RTE_MIN(entries_num, GRO_UDP_TBL_MAX_ITEM_NUM);
+
+	if (entries_num == 0)
+		return NULL;
+
+	tbl = rte_zmalloc_socket(__func__,
+			sizeof(struct gro_udp_tbl),
+			RTE_CACHE_LINE_SIZE,
+			socket_id);
+	if (tbl == NULL)
+		return NULL;
+
+	size = sizeof(struct gro_udp_item) * entries_num;
+	tbl->items = rte_zmalloc_socket(__func__,
+			size,
+			RTE_CACHE_LINE_SIZE,
+			socket_id);
+	if (tbl->items == NULL) {
+		rte_free(tbl);
+		return NULL;
+	}
+	tbl->max_item_num = entries_num;
+
+	size = sizeof(struct gro_udp_flow) * entries_num;
+	tbl->flows = rte_zmalloc_socket(__func__,
+			size,
+			RTE_CACHE_LINE_SIZE,
+			socket_id);
+	if (tbl->flows == NULL) {
+		rte_free(tbl->items);
+		rte_free(tbl);
+		return NULL;
+	}
+	/* INVALID_ARRAY_INDEX indicates an empty flow */
+	for (i = 0; i < entries_num; i++)
+		tbl->flows[i].start_index = INVALID_ARRAY_INDEX;
+	tbl->max_flow_num = entries_num;
+
+	hash_size = gro_flow_hash_size(entries_num);
+	size = sizeof(uint32_t) * (hash_size + 2 * entries_num);
+	tbl->flow_hash = rte_malloc_socket(__func__,
+			size,
+			RTE_CACHE_LINE_SIZE,
+			socket_id);
+	if (tbl->flow_hash == NULL) {
+		rte_free(tbl->flows);
+		rte_free(tbl->items);
+		rte_free(tbl);
+		return NULL;
+	}
+	tbl->free_items = tbl->flow_hash + hash_size;
+	tbl->free_flows = tbl->free_items + entries_num;
+	tbl->flow_hash_mask = hash_size - 1;
+	gro_tbl_init_free(tbl->flow_hash, hash_size,
+			tbl->free_items, entries_num,
+			tbl->free_flows, entries_num);
+
+	return tbl;
+}
+
+void
+gro_udp_tbl_destroy(void *tbl)
+{
+	struct gro_udp_tbl *udp_tbl = tbl;
+
+	if (udp_tbl) {
+		rte_free(udp_tbl->items);
+		rte_free(udp_tbl->flows);
+		rte_free(udp_tbl->flow_hash);
+	}
+	rte_free(udp_tbl);
+}
+
+static inline uint32_t
+find_an_empty_item(struct gro_udp_tbl *tbl)
+{
+	if (unlikely(tbl->item_num == tbl->max_item_num))
+		return INVALID_ARRAY_INDEX;
+	return tbl->free_items[tbl->max_item_num - tbl->item_num - 1];
+}
+
+static inline uint32_t
+find_an_empty_flow(struct gro_udp_tbl *tbl)
+{
+	if (unlikely(tbl->flow_num == tbl->max_flow_num))
+		return INVALID_ARRAY_INDEX;
+	return tbl->free_flows[tbl->max_flow_num - tbl->flow_num - 1];
+}
+
+/*
+ * Look a flow up in the flow hash table. If it isn't found, the empty
+ * bucket where to insert it is returned in 'bucket'.
+ */
+static inline uint32_t
+find_a_flow(struct gro_udp_tbl *tbl,
+		struct udp_flow_key *key,
+		uint32_t hash,
+		uint32_t *bucket)
+{
+	uint32_t mask = tbl->flow_hash_mask;
+	uint32_t b, flow_idx;
+
+	for (b = hash & mask; ; b = (b + 1) & mask) {
+		flow_idx = tbl->flow_hash[b];
+		if (flow_idx == INVALID_ARRAY_INDEX)
+			break;
+		if (tbl->flows[flow_idx].hash == hash &&
+				is_same_udp_flow(&tbl->flows[flow_idx].key,
+					key))
+			return flow_idx;
+	}
+	*bucket = b;
+	return INVALID_ARRAY_INDEX;
+}
+
+static inline uint32_t
+insert_new_item(struct gro_udp_tbl *tbl,
+		struct rte_mbuf *pkt,
+		uint64_t start_time,
+		uint32_t prev_idx,
+		uint16_t seg_size)
+{
+	uint32_t item_idx;
+
+	item_idx = find_an_empty_item(tbl);
+	if (item_idx == INVALID_ARRAY_INDEX)
+		return INVALID_ARRAY_INDEX;
+
+	tbl->items[item_idx].firstseg = pkt;
+	tbl->items[item_idx].lastseg = rte_pktmbuf_lastseg(pkt);
+	tbl->items[item_idx].start_time = start_time;
+	tbl->items[item_idx].next_pkt_idx = INVALID_ARRAY_INDEX;
+	tbl->items[item_idx].seg_size = seg_size;
+	tbl->items[item_idx].nb_merged = 1;
+	tbl->items[item_idx].closed = 0;
+	tbl->item_num++;
+
+	/* if the previous packet exists, chain them together. */
+	if (prev_idx != INVALID_ARRAY_INDEX) {
+		tbl->items[item_idx].next_pkt_idx =
+			tbl->items[prev_idx].next_pkt_idx;
+		tbl->items[prev_idx].next_pkt_idx = item_idx;
+	}
+
+	return item_idx;
+}
+
+static inline uint32_t
+delete_item(struct gro_udp_tbl *tbl, uint32_t item_idx,
+		uint32_t prev_item_idx)
+{
+	uint32_t next_idx = tbl->items[item_idx].next_pkt_idx;
+
+	/* NULL indicates an empty item */
+	tbl->items[item_idx].firstseg = NULL;
+	tbl->item_num--;
+	tbl->free_items[tbl->max_item_num - tbl->item_num - 1] = item_idx;
+	if (prev_item_idx != INVALID_ARRAY_INDEX)
+		tbl->items[prev_item_idx].next_pkt_idx = next_idx;
+
+	return next_idx;
+}
+
+static inline uint32_t
+insert_new_flow(struct gro_udp_tbl *tbl,
+		struct udp_flow_key *src,
+		uint32_t hash,
+		uint32_t bucket,
+		uint32_t item_idx)
+{
+	struct udp_flow_key *dst;
+	uint32_t flow_idx;
+
+	flow_idx = find_an_empty_flow(tbl);
+	if (unlikely(flow_idx == INVALID_ARRAY_INDEX))
+		return INVALID_ARRAY_INDEX;
+
+	dst = &(tbl->flows[flow_idx].key);
+
+	rte_ether_addr_copy(&(src->eth_saddr), &(dst->eth_saddr));
+	rte_ether_addr_copy(&(src->eth_daddr), &(dst->eth_daddr));
+	memcpy(dst->ip_src_addr, src->ip_src_addr, sizeof(dst->ip_src_addr));
+	memcpy(dst->ip_dst_addr, src->ip_dst_addr, sizeof(dst->ip_dst_addr));
+	dst->src_port = src->src_port;
+	dst->dst_port = src->dst_port;
+	dst->is_ipv6 = src->is_ipv6;
+
+	tbl->flows[flow_idx].hash = hash;
+	tbl->flows[flow_idx].start_index = item_idx;
+	tbl->flows[flow_idx].last_index = item_idx;
+	tbl->flow_hash[bucket] = flow_idx;
+	tbl->flow_num++;
+
+	return flow_idx;
+}
+
+/*
+ * Delete an empty flow, shifting back the following entries of its probe
+ * sequence in the flow hash table.
+ */
+static inline void
+delete_flow(struct gro_udp_tbl *tbl, uint32_t flow_idx)
+{
+	uint32_t mask = tbl->flow_hash_mask;
+	uint32_t i, j, idx, home;
+
+	i = tbl->flows[flow_idx].hash & mask;
+	while (tbl->flow_hash[i] != flow_idx)
+		i = (i + 1) & mask;
+
+	for (j = (i + 1) & mask; tbl->flow_hash[j] != INVALID_ARRAY_INDEX;
+			j = (j + 1) & mask) {
+		idx = tbl->flow_hash[j];
+		home = tbl->flows[idx].hash & mask;
+		/* an entry can't move before its home bucket */
+		if (((j - home) & mask) < ((j - i) & mask))
+			continue;
+		tbl->flow_hash[i] = idx;
+		i = j;
+	}
+	tbl->flow_hash[i] = INVALID_ARRAY_INDEX;
+
+	tbl->flows[flow_idx].start_index = INVALID_ARRAY_INDEX;
+	tbl->flow_num--;
+	tbl->free_flows[tbl->max_flow_num - tbl->flow_num - 1] = flow_idx;
+}
+
+/*
+ * Append a datagram to the packet of an item, if it is not longer than the
+ * datagrams of the packet and the packet is not closed yet.
+ */
+static inline int
+merge_udp_packet(struct gro_udp_item *item,
+		struct rte_mbuf *pkt,
+		uint16_t hdr_len,
+		uint16_t udp_dl)
+{
+	struct rte_mbuf *pkt_head = item->firstseg;
+
+	if (item->closed || udp_dl > item->seg_size ||
+			item->nb_merged >= GRO_UDP_MAX_MERGED)
+		return 0;
+
+	/* check if the IP packet length is greater than the max value */
+	if (unlikely(pkt_head->pkt_len - pkt_head->l2_len + udp_dl >
+				MAX_IPV4_PKT_LENGTH))
+		return 0;
+
+	/* remove the packet header and chain it */
+	rte_pktmbuf_adj(pkt, hdr_len);
+	item->lastseg->next = pkt;
+	item->lastseg = rte_pktmbuf_lastseg(pkt);
+	item->nb_merged++;
+	/* a shorter datagram is the last one */
+	if (udp_dl < item->seg_size)
+		item->closed = 1;
+
+	/* update MBUF metadata for the merged packet */
+	pkt_head->nb_segs += pkt->nb_segs;
+	pkt_head->pkt_len += pkt->pkt_len;
+
+	return 1;
+}
+
+/*
+ * update the packet lengths and the datagram size for the flushed packet.
+ */
+static inline void
+update_header(struct gro_udp_tbl *tbl, struct gro_udp_item *item,
+		uint32_t flow_idx)
+{
+	struct rte_ipv4_hdr *ipv4_hdr;
+	struct rte_ipv6_hdr *ipv6_hdr;
+	struct rte_udp_hdr *udp_hdr;
+	struct rte_mbuf *pkt = item->firstseg;
+	char *l3_hdr;
+
+	l3_hdr = rte_pktmbuf_mtod(pkt, char *) + pkt->l2_len;
+	if (tbl->flows[flow_idx].key.is_ipv6) {
+		ipv6_hdr = (struct rte_ipv6_hdr *)l3_hdr;
+		ipv6_hdr->payload_len = rte_cpu_to_be_16(pkt->pkt_len -
+				pkt->l2_len - pkt->l3_len);
+	} else {
+		ipv4_hdr = (struct rte_ipv4_hdr *)l3_hdr;
+		ipv4_hdr->total_length = rte_cpu_to_be_16(pkt->pkt_len -
+				pkt->l2_len);
+	}
+	udp_hdr = (struct rte_udp_hdr *)(l3_hdr + pkt->l3_len);
+	udp_hdr->dgram_len = rte_cpu_to_be_16(pkt->pkt_len - pkt->l2_len -
+			pkt->l3_len);
+	pkt->tso_segsz = item->seg_size;
+}
+
+int32_t
+gro_udp_reassemble(struct rte_mbuf *pkt,
+		struct gro_udp_tbl *tbl,
+		uint64_t start_time,
+		uint8_t is_ipv6)
+{
+	struct rte_ether_hdr *eth_hdr;
+	struct rte_ipv4_hdr *ipv4_hdr;
+	struct rte_ipv6_hdr *ipv6_hdr;
+	struct rte_udp_hdr *udp_hdr;
+	int32_t udp_dl;
+	uint16_t hdr_len, frag_off;
+
+	struct udp_flow_key key;
+	uint32_t last_idx, item_idx;
+	uint32_t flow_idx, hash, bucket;
+
+	if (unlikely(pkt->l4_len != sizeof(struct rte_udp_hdr)))
+		return -1;
+
+	eth_hdr = rte_pktmbuf_mtod(pkt, struct rte_ether_hdr *);
+	udp_hdr = (struct rte_udp_hdr *)((char *)eth_hdr + pkt->l2_len +
+			pkt->l3_len);
+	hdr_len = pkt->l2_len + pkt->l3_len + pkt->l4_len;
+
+	/*
+	 * Don't process the packet whose payload length is less than or
+	 * equal to 0, or which has a padding after the datagram.
+	 */
+	udp_dl = rte_be_to_cpu_16(udp_hdr->dgram_len) -
+		(int32_t)sizeof(struct rte_udp_hdr);
+	if (udp_dl <= 0 || pkt->pkt_len != (uint32_t)hdr_len + udp_dl)
+		return -1;
+
+	memset(&key, 0, sizeof(key));
+	rte_ether_addr_copy(&(eth_hdr->s_addr), &(key.eth_saddr));
+	rte_ether_addr_copy(&(eth_hdr->d_addr), &(key.eth_daddr));
+	key.src_port = udp_hdr->src_port;
+	key.dst_port = udp_hdr->dst_port;
+	key.is_ipv6 = is_ipv6;
+
+	if (is_ipv6) {
+		/*
+		 * Don't process the packet which has IPv6 extension
+		 * headers.
+		 */
+		if (pkt->l3_len != sizeof(struct rte_ipv6_hdr))
+			return -1;
+		ipv6_hdr = (struct rte_ipv6_hdr *)((char *)eth_hdr +
+				pkt->l2_len);
+		memcpy(key.ip_src_addr, ipv6_hdr->src_addr,
+				sizeof(key.ip_src_addr));
+		memcpy(key.ip_dst_addr, ipv6_hdr->dst_addr,
+				sizeof(key.ip_dst_addr));
+	} else {
+		ipv4_hdr = (struct rte_ipv4_hdr *)((char *)eth_hdr +
+				pkt->l2_len);
+		/* Don't process the IPv4 fragments. */
+		frag_off = rte_be_to_cpu_16(ipv4_hdr->fragment_offset);
+		if (frag_off & (RTE_IPV4_HDR_MF_FLAG |
+					RTE_IPV4_HDR_OFFSET_MASK))
+			return -1;
+		memcpy(key.ip_src_addr, &ipv4_hdr->src_addr,
+				sizeof(ipv4_hdr->src_addr));
+		memcpy(key.ip_dst_addr, &ipv4_hdr->dst_addr,
+				sizeof(ipv4_hdr->dst_addr));
+	}
+
+	/* Search for a matched flow. */
+	hash = udp_flow_hash(&key);
+	flow_idx = find_a_flow(tbl, &key, hash, &bucket);
+
+	/*
+	 * Fail to find a matched flow. Insert a new flow and store the
+	 * packet into the flow.
+	 */
+	if (flow_idx == INVALID_ARRAY_INDEX) {
+		item_idx = insert_new_item(tbl, pkt, start_time,
+				INVALID_ARRAY_INDEX, udp_dl);
+		if (item_idx == INVALID_ARRAY_INDEX)
+			return -1;
+		if (insert_new_flow(tbl, &key, hash, bucket, item_idx) ==
+				INVALID_ARRAY_INDEX) {
+			/*
+			 * Fail to insert a new flow, so delete the
+			 * stored packet.
+			 */
+			delete_item(tbl, item_idx, INVALID_ARRAY_INDEX);
+			return -1;
+		}
+		return 0;
+	}
+
+	/*
+	 * The datagrams can't be reordered, so only try to append the
+	 * packet to the last packet of the flow.
+	 */
+	last_idx = tbl->flows[flow_idx].last_index;
+	if (merge_udp_packet(&(tbl->items[last_idx]), pkt, hdr_len, udp_dl))
+		return 1;
+
+	/* Fail to merge, so store the packet after the last one. */
+	item_idx = insert_new_item(tbl, pkt, start_time, last_idx, udp_dl);
+	if (item_idx == INVALID_ARRAY_INDEX)
+		return -1;
+	tbl->flows[flow_idx].last_index = item_idx;
+
+	return 0;
+}
+
+uint16_t
+gro_udp_tbl_timeout_flush(struct gro_udp_tbl *tbl,
+		uint64_t flush_timestamp,
+		struct rte_mbuf **out,
+		uint16_t nb_out)
+{
+	uint16_t k = 0;
+	uint32_t i, j;
+	uint32_t max_flow_num = tbl->max_flow_num;
+
+	for (i = 0; i < max_flow_num; i++) {
+		if (unlikely(tbl->flow_num == 0))
+			return k;
+
+		j = tbl->flows[i].start_index;
+		while (j != INVALID_ARRAY_INDEX) {
+			if (tbl->items[j].start_time <= flush_timestamp) {
+				out[k++] = tbl->items[j].firstseg;
+				if (tbl->items[j].nb_merged > 1)
+					update_header(tbl, &(tbl->items[j]),
+							i);
+				/*
+				 * Delete the packet and get the next
+				 * packet in the flow.
+				 */
+				j = delete_item(tbl, j, INVALID_ARRAY_INDEX);
+				tbl->flows[i].start_index = j;
+				if (j == INVALID_ARRAY_INDEX)
+					delete_flow(tbl, i);
+
+				if (unlikely(k == nb_out))
+					return k;
+			} else
+				/*
+				 * The left packets in this flow won't be
+				 * timeout. Go to check other flows.
+				 */
+				break;
+		}
+	}
+	return k;
+}
+
+uint32_t
+gro_udp_tbl_pkt_count(void *tbl)
+{
+	struct gro_udp_tbl *gro_tbl = tbl;
+
+	if (gro_tbl)
+		return gro_tbl->item_num;
+
+	return 0;
+}
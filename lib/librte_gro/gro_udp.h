@@ -0,0 +1,232 @@
+/* SPDX-License-Identifier: BSD-3-Clause
+ * Copyright(c) 2020 Intel Corporation
+ */
+
+#ifndef _GRO_UDP_H_
+#define _GRO_UDP_H_
+
+#include <rte_udp.h>
+
+#include "gro_tcp6.h"
+
+#define GRO_UDP_TBL_MAX_ITEM_NUM (1024UL * 1024UL)
+
+/* The maximum number of datagrams merged in a packet */
+#define GRO_UDP_MAX_MERGED 64
+
+/*
+ * Header fields representing a UDP flow, over IPv4 or IPv6. The IPv4
+ * addresses are kept in the first 4 bytes of the address arrays.
+ */
+struct udp_flow_key {
+	struct rte_ether_addr eth_saddr;
+	struct rte_ether_addr eth_daddr;
+	uint8_t ip_src_addr[16];
+	uint8_t ip_dst_addr[16];
+
+	uint16_t src_port;
+	uint16_t dst_port;
+	uint8_t is_ipv6;
+};
+
+struct gro_udp_flow {
+	struct udp_flow_key key;
+	/* hash of the key, see udp_flow_hash() */
+	uint32_t hash;
+	/*
+	 * The index of the first packet in the flow.
+	 * INVALID_ARRAY_INDEX indicates an empty flow.
+	 */
+	uint32_t start_index;
+	/* The index of the last packet in the flow */
+	uint32_t last_index;
+};
+
+struct gro_udp_item {
+	/*
+	 * The first MBUF segment of the packet. If the value
+	 * is NULL, it means the item is empty.
+	 */
+	struct rte_mbuf *firstseg;
+	/* The last MBUF segment of the packet */
+	struct rte_mbuf *lastseg;
+	/*
+	 * The time when the first packet is inserted into the table.
+	 * This value won't be updated, even if the packet is merged
+	 * with other packets.
+	 */
+	uint64_t start_time;
+	/*
+	 * next_pkt_idx is used to chain the packets of a flow which
+	 * can't be merged together, in the order they arrived.
+	 */
+	uint32_t next_pkt_idx;
+	/*
+	 * The payload length of the first datagram, which all the merged
+	 * datagrams but the last one have.
+	 */
+	uint16_t seg_size;
+	/* the number of merged datagrams */
+	uint16_t nb_merged;
+	/* Indicate if a shorter datagram ended the packet */
+	uint8_t closed;
+};
+
+/*
+ * UDP reassembly table structure.
+ */
+struct gro_udp_tbl {
+	/* item array */
+	struct gro_udp_item *items;
+	/* flow array */
+	struct gro_udp_flow *flows;
+	/*
+	 * Open addressed hash table of flow indexes, with linear probing.
+	 * INVALID_ARRAY_INDEX indicates an empty bucket.
+	 */
+	uint32_t *flow_hash;
+	/* free item indexes, the next one to use last */
+	uint32_t *free_items;
+	/* free flow indexes, the next one to use last */
+	uint32_t *free_flows;
+	/* current item number */
+	uint32_t item_num;
+	/* current flow num */
+	uint32_t flow_num;
+	/* item array size */
+	uint32_t max_item_num;
+	/* flow array size */
+	uint32_t max_flow_num;
+	/* number of buckets in the flow hash table minus 1 */
+	uint32_t flow_hash_mask;
+};
+
+/**
+ * This function creates a UDP reassembly table, for UDP/IPv4 and
+ * UDP/IPv6 packets.
+ *
+ * @param socket_id
+ *  Socket index for allocating the UDP reassemble table
+ * @param max_flow_num
+ *  The maximum number of flows in the UDP GRO table
+ * @param max_item_per_flow
+ *  The maximum number of packets per flow
+ *
+ * @return
+ *  - Return the table pointer on success.
+ *  - Return NULL on failure.
+ */
+void *gro_udp_tbl_create(uint16_t socket_id,
+		uint16_t max_flow_num,
+		uint16_t max_item_per_flow);
+
+/**
+ * This function destroys a UDP reassembly table.
+ *
+ * @param tbl
+ *  Pointer pointing to the UDP reassembly table.
+ */
+void gro_udp_tbl_destroy(void *tbl);
+
+/**
+ * This function merges a UDP/IPv4 or UDP/IPv6 datagram with the previous
+ * datagrams of its flow, if they all have the same payload length, like
+ * the Linux UDP GRO. A datagram shorter than the previous ones is merged
+ * as the last one of the packet. The payload length of the datagrams is
+ * given in the tso_segsz field of the flushed packets, so that they can
+ * be split back.
+ *
+ * This function doesn't check if the packet has correct checksums and
+ * doesn't re-calculate checksums for the merged packet. It doesn't
+ * process the IPv4 fragments, the IPv6 packets which have extension
+ * headers, and the packets without payload. It returns the packet, if
+ * the packet has invalid parameters or there is no available space in the
+ * table.
+ *
+ * @param pkt
+ *  Packet to reassemble
+ * @param tbl
+ *  Pointer pointing to the UDP reassembly table
+ * @start_time
+ *  The time when the packet is inserted into the table
+ * @param is_ipv6
+ *  Whether the packet is a UDP/IPv6 one
+ *
+ * @return
+ *  - Return a positive value if the packet is merged.
+ *  - Return zero if the packet isn't merged but stored in the table.
+ *  - Return a negative value for invalid parameters or no available
+ *    space in the table.
+ */
+int32_t gro_udp_reassemble(struct rte_mbuf *pkt,
+		struct gro_udp_tbl *tbl,
+		uint64_t start_time,
+		uint8_t is_ipv6);
+
+/**
+ * This function flushes timeout packets in a UDP reassembly table,
+ * and without updating checksums.
+ *
+ * @param tbl
+ *  UDP reassembly table pointer
+ * @param flush_timestamp
+ *  Flush packets which are inserted into the table before or at the
+ *  flush_timestamp.
+ * @param out
+ *  Pointer array used to keep flushed packets
+ * @param nb_out
+ *  The element number in 'out'. It also determines the maximum number of
+ *  packets that can be flushed finally.
+ *
+ * @return
+ *  The number of flushed packets
+ */
+uint16_t gro_udp_tbl_timeout_flush(struct gro_udp_tbl *tbl,
+		uint64_t flush_timestamp,
+		struct rte_mbuf **out,
+		uint16_t nb_out);
+
+/**
+ * This function returns the number of the packets in a UDP reassembly
+ * table.
+ *
+ * @param tbl
+ *  UDP reassembly table pointer
+ *
+ * @return
+ *  The number of packets in the table
+ */
+uint32_t gro_udp_tbl_pkt_count(void *tbl);
+
+/*
+ * Hash of a UDP flow.
+ */
+static inline uint32_t
+udp_flow_hash(const struct udp_flow_key *k)
+{
+	uint32_t h;
+
+	h = gro_hash_ipv6_addr(k->is_ipv6, k->ip_src_addr);
+	h = gro_hash_ipv6_addr(h, k->ip_dst_addr);
+	h = h * GRO_HASH_PRIME ^ ((uint32_t)k->src_port << 16 | k->dst_port);
+
+	return gro_hash_fini(h);
+}
+
+/*
+ * Check if two UDP packets belong to the same flow.
+ */
+static inline int
+is_same_udp_flow(const struct udp_flow_key *k1,
+		const struct udp_flow_key *k2)
+{
+	return (rte_is_same_ether_addr(&k1->eth_saddr, &k2->eth_saddr) &&
+			rte_is_same_ether_addr(&k1->eth_daddr,
+				&k2->eth_daddr) &&
+			(memcmp(k1->ip_src_addr, k2->ip_src_addr, 16) == 0) &&
+			(memcmp(k1->ip_dst_addr, k2->ip_dst_addr, 16) == 0) &&
+			(k1->src_port == k2->src_port) &&
+			(k1->dst_port == k2->dst_port) &&
+			(k1->is_ipv6 == k2->is_ipv6));
+}
+#endif
@@ -17,7 +17,7 @@ gro_vxlan_tcp4_tbl_create(uint16_t socket_id,
 {
 	struct gro_vxlan_tcp4_tbl *tbl;
 	size_t size;
-	uint32_t entries_num, i;
+	uint32_t entries_num, hash_size, i;
 
 	entries_num = max_flow_num * max_item_per_flow;
 	entries_num = RTE_MIN(entries_num, GRO_VXLAN_TCP4_TBL_MAX_ITEM_NUM);
@@ -58,6 +58,25 @@ gro_vxlan_tcp4_tbl_create(uint16_t socket_id,
 		tbl->flows[i].start_index = INVALID_ARRAY_INDEX;
 	tbl->max_flow_num = entries_num;
 
+	hash_size = gro_flow_hash_size(entries_num);
+	size = sizeof(uint32_t) * (hash_size + 2 * entries_num);
+	tbl->flow_hash = rte_malloc_socket(__func__,
+			size,
+			RTE_CACHE_LINE_SIZE,
+			socket_id);
+	if (tbl->flow_hash == NULL) {
+		rte_free(tbl->flows);
+		rte_free(tbl->items);
+		rte_free(tbl);
+		return NULL;
+	}
+	tbl->free_items = tbl->flow_hash + hash_size;
+	tbl->free_flows = tbl->free_items + entries_num;
+	tbl->flow_hash_mask = hash_size - 1;
+	gro_tbl_init_free(tbl->flow_hash, hash_size,
+			tbl->free_items, entries_num,
+			tbl->free_flows, entries_num);
+
 	return tbl;
 }
 
@@ -69,6 +88,7 @@ gro_vxlan_tcp4_tbl_destroy(void *tbl)
 	if (vxlan_tbl) {
 		rte_free(vxlan_tbl->items);
 		rte_free(vxlan_tbl->flows);
+		rte_free(vxlan_tbl->flow_hash);
 	}
 	rte_free(vxlan_tbl);
 }
@@ -76,23 +96,17 @@ gro_vxlan_tcp4_tbl_destroy(void *tbl)
 static inline uint32_t
 find_an_empty_item(struct gro_vxlan_tcp4_tbl *tbl)
 {
-	uint32_t max_item_num = tbl->max_item_num, i;
-
-	for (i = 0; i < max_item_num; i++)
-		if (tbl->items[i].inner_item.firstseg == NULL)
-			return i;
-	return INVALID_ARRAY_INDEX;
+	if (unlikely(tbl->item_num == tbl->max_item_num))
+		return INVALID_ARRAY_INDEX;
+	return tbl->free_items[tbl->max_item_num - tbl->item_num - 1];
 }
 
 static inline uint32_t
 find_an_empty_flow(struct gro_vxlan_tcp4_tbl *tbl)
 {
-	uint32_t max_flow_num = tbl->max_flow_num, i;
-
-	for (i = 0; i < max_flow_num; i++)
-		if (tbl->flows[i].start_index == INVALID_ARRAY_INDEX)
-			return i;
-	return INVALID_ARRAY_INDEX;
+	if (unlikely(tbl->flow_num == tbl->max_flow_num))
+		return INVALID_ARRAY_INDEX;
+	return tbl->free_flows[tbl->max_flow_num - tbl->flow_num - 1];
 }
 
 static inline uint32_t
@@ -144,6 +158,7 @@ delete_item(struct gro_vxlan_tcp4_tbl *tbl,
 	/* NULL indicates an empty item. */
 	tbl->items[item_idx].inner_item.firstseg = NULL;
 	tbl->item_num--;
+	tbl->free_items[tbl->max_item_num - tbl->item_num - 1] = item_idx;
 	if (prev_item_idx != INVALID_ARRAY_INDEX)
 		tbl->items[prev_item_idx].inner_item.next_pkt_idx = next_idx;
 
@@ -153,6 +168,8 @@ delete_item(struct gro_vxlan_tcp4_tbl *tbl,
 static inline uint32_t
 insert_new_flow(struct gro_vxlan_tcp4_tbl *tbl,
 		struct vxlan_tcp4_flow_key *src,
+		uint32_t hash,
+		uint32_t bucket,
 		uint32_t item_idx)
 {
 	struct vxlan_tcp4_flow_key *dst;
@@ -183,12 +200,64 @@ insert_new_flow(struct gro_vxlan_tcp4_tbl *tbl,
 	dst->outer_src_port = src->outer_src_port;
 	dst->outer_dst_port = src->outer_dst_port;
 
+	tbl->flows[flow_idx].hash = hash;
 	tbl->flows[flow_idx].start_index = item_idx;
+	tbl->flow_hash[bucket] = flow_idx;
 	tbl->flow_num++;
 
 	return flow_idx;
 }
 
+/*
+ * Delete an empty flow, shifting back the following entries of its probe
+ * sequence in the flow hash table.
+ */
+static inline void
+delete_flow(struct gro_vxlan_tcp4_tbl *tbl, uint32_t flow_idx)
+{
+	uint32_t mask = tbl->flow_hash_mask;
+	uint32_t i, j, idx, home;
+
+	i = tbl->flows[flow_idx].hash & mask;
+	while (tbl->flow_hash[i] != flow_idx)
+		i = (i + 1) & mask;
+
+	for (j = (i + 1) & mask; tbl->flow_hash[j] != INVALID_ARRAY_INDEX;
+			j = (j + 1) & mask) {
+		idx = tbl->flow_hash[j];
+		home = tbl->flows[idx].hash & mask;
+		/* an entry can't move before its home bucket */
+		if (((j - home) & mask) < ((j - i) & mask))
+			continue;
+		tbl->flow_hash[i] = idx;
+		i = j;
+	}
+	tbl->flow_hash[i] = INVALID_ARRAY_INDEX;
+
+	tbl->flows[flow_idx].start_index = INVALID_ARRAY_INDEX;
+	tbl->flow_num--;
+	tbl->free_flows[tbl->max_flow_num - tbl->flow_num - 1] = flow_idx;
+}
+
+/*
+ * Hash of a VxLAN flow, mixing the outer header fields into the hash of
+ * the inner TCP/IPv4 flow.
+ */
+static inline uint32_t
+vxlan_tcp4_flow_hash(const struct vxlan_tcp4_flow_key *k)
+{
+	uint32_t h;
+
+	h = tcp4_flow_hash(&k->inner_key);
+	h = h * GRO_HASH_PRIME ^ k->vxlan_hdr.vx_vni;
+	h = h * GRO_HASH_PRIME ^ k->outer_ip_src_addr;
+	h = h * GRO_HASH_PRIME ^ k->outer_ip_dst_addr;
+	h = h * GRO_HASH_PRIME ^ ((uint32_t)k->outer_src_port << 16 |
+			k->outer_dst_port);
+
+	return gro_hash_fini(h);
+}
+
 static inline int
 is_same_vxlan_tcp4_flow(struct vxlan_tcp4_flow_key k1,
 		struct vxlan_tcp4_flow_key k2)
@@ -206,6 +275,32 @@ is_same_vxlan_tcp4_flow(struct vxlan_tcp4_flow_key k1,
 			is_same_tcp4_flow(k1.inner_key, k2.inner_key));
 }
 
+/*
+ * Look a flow up in the flow hash table. If it isn't found, the empty
+ * bucket where to insert it is returned in 'bucket'.
+ */
+static inline uint32_t
+find_a_flow(struct gro_vxlan_tcp4_tbl *tbl,
+		struct vxlan_tcp4_flow_key *key,
+		uint32_t hash,
+		uint32_t *bucket)
+{
+	uint32_t mask = tbl->flow_hash_mask;
+	uint32_t b, flow_idx;
+
+	for (b = hash & mask; ; b = (b + 1) & mask) {
+		flow_idx = tbl->flow_hash[b];
+		if (flow_idx == INVALID_ARRAY_INDEX)
+			break;
+		if (tbl->flows[flow_idx].hash == hash &&
+				is_same_vxlan_tcp4_flow(
+					tbl->flows[flow_idx].key, *key))
+			return flow_idx;
+	}
+	*bucket = b;
+	return INVALID_ARRAY_INDEX;
+}
+
 static inline int
 check_vxlan_seq_option(struct gro_vxlan_tcp4_item *item,
 		struct rte_tcp_hdr *tcp_hdr,
@@ -302,10 +397,9 @@ gro_vxlan_tcp4_reassemble(struct rte_mbuf *pkt,
 
 	struct vxlan_tcp4_flow_key key;
 	uint32_t cur_idx, prev_idx, item_idx;
-	uint32_t i, max_flow_num, remaining_flow_num;
+	uint32_t flow_idx, hash, bucket;
 	int cmp;
 	uint16_t hdr_len;
-	uint8_t find;
 
 	/*
 	 * Don't process the packet whose TCP header length is greater
@@ -376,30 +470,20 @@ gro_vxlan_tcp4_reassemble(struct rte_mbuf *pkt,
 	key.outer_dst_port = udp_hdr->dst_port;
 
 	/* Search for a matched flow. */
-	max_flow_num = tbl->max_flow_num;
-	remaining_flow_num = tbl->flow_num;
-	find = 0;
-	for (i = 0; i < max_flow_num && remaining_flow_num; i++) {
-		if (tbl->flows[i].start_index != INVALID_ARRAY_INDEX) {
-			if (is_same_vxlan_tcp4_flow(tbl->flows[i].key, key)) {
-				find = 1;
-				break;
-			}
-			remaining_flow_num--;
-		}
-	}
+	hash = vxlan_tcp4_flow_hash(&key);
+	flow_idx = find_a_flow(tbl, &key, hash, &bucket);
 
 	/*
 	 * Can't find a matched flow. Insert a new flow and store the
 	 * packet into the flow.
 	 */
-	if (find == 0) {
+	if (flow_idx == INVALID_ARRAY_INDEX) {
 		item_idx = insert_new_item(tbl, pkt, start_time,
 				INVALID_ARRAY_INDEX, sent_seq, outer_ip_id,
 				ip_id, outer_is_atomic, is_atomic);
 		if (item_idx == INVALID_ARRAY_INDEX)
 			return -1;
-		if (insert_new_flow(tbl, &key, item_idx) ==
+		if (insert_new_flow(tbl, &key, hash, bucket, item_idx) ==
 				INVALID_ARRAY_INDEX) {
 			/*
 			 * Fail to insert a new flow, so
@@ -412,7 +496,7 @@ gro_vxlan_tcp4_reassemble(struct rte_mbuf *pkt,
 	}
 
 	/* Check all packets in the flow and try to find a neighbor. */
-	cur_idx = tbl->flows[i].start_index;
+	cur_idx = tbl->flows[flow_idx].start_index;
 	prev_idx = cur_idx;
 	do {
 		cmp = check_vxlan_seq_option(&(tbl->items[cur_idx]), tcp_hdr,
@@ -477,7 +561,7 @@ gro_vxlan_tcp4_tbl_timeout_flush(struct gro_vxlan_tcp4_tbl *tbl,
 				j = delete_item(tbl, j, INVALID_ARRAY_INDEX);
 				tbl->flows[i].start_index = j;
 				if (j == INVALID_ARRAY_INDEX)
-					tbl->flow_num--;
+					delete_flow(tbl, i);
 
 				if (unlikely(k == nb_out))
 					return k;
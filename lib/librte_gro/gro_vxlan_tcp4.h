@@ -28,6 +28,8 @@ struct vxlan_tcp4_flow_key {
 
 struct gro_vxlan_tcp4_flow {
 	struct vxlan_tcp4_flow_key key;
+	/* hash of the key, see vxlan_tcp4_flow_hash() */
+	uint32_t hash;
 	/*
 	 * The index of the first packet in the flow. INVALID_ARRAY_INDEX
 	 * indicates an empty flow.
@@ -52,6 +54,15 @@ struct gro_vxlan_tcp4_tbl {
 	struct gro_vxlan_tcp4_item *items;
 	/* flow array */
 	struct gro_vxlan_tcp4_flow *flows;
+	/*
+	 * Open addressed hash table of flow indexes, with linear probing.
+	 * INVALID_ARRAY_INDEX indicates an empty bucket.
+	 */
+	uint32_t *flow_hash;
+	/* free item indexes, the next one to use last */
+	uint32_t *free_items;
+	/* free flow indexes, the next one to use last */
+	uint32_t *free_flows;
 	/* current item number */
 	uint32_t item_num;
 	/* current flow number */
@@ -60,6 +71,8 @@ struct gro_vxlan_tcp4_tbl {
 	uint32_t max_item_num;
 	/* the maximum flow number */
 	uint32_t max_flow_num;
+	/* number of buckets in the flow hash table minus 1 */
+	uint32_t flow_hash_mask;
 };
 
 /**
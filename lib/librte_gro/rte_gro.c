@@ -10,6 +10,8 @@
 #include "rte_gro.h"
 #include "gro_tcp4.h"
 #include "gro_vxlan_tcp4.h"
+#include "gro_tcp6.h"
+#include "gro_udp.h"
 
 typedef void *(*gro_tbl_create_fn)(uint16_t socket_id,
 		uint16_t max_flow_num,
@@ -18,13 +20,21 @@ typedef void (*gro_tbl_destroy_fn)(void *tbl);
 typedef uint32_t (*gro_tbl_pkt_count_fn)(void *tbl);
 
 static gro_tbl_create_fn tbl_create_fn[RTE_GRO_TYPE_MAX_NUM] = {
-		gro_tcp4_tbl_create, gro_vxlan_tcp4_tbl_create, NULL};
+		gro_tcp4_tbl_create, gro_vxlan_tcp4_tbl_create,
+		gro_tcp6_tbl_create, gro_udp_tbl_create, gro_udp_tbl_create,
+		NULL};
 static gro_tbl_destroy_fn tbl_destroy_fn[RTE_GRO_TYPE_MAX_NUM] = {
 			gro_tcp4_tbl_destroy, gro_vxlan_tcp4_tbl_destroy,
-			NULL};
+			gro_tcp6_tbl_destroy, gro_udp_tbl_destroy,
+			gro_udp_tbl_destroy, NULL};
 static gro_tbl_pkt_count_fn tbl_pkt_count_fn[RTE_GRO_TYPE_MAX_NUM] = {
 			gro_tcp4_tbl_pkt_count, gro_vxlan_tcp4_tbl_pkt_count,
-			NULL};
+			gro_tcp6_tbl_pkt_count, gro_udp_tbl_pkt_count,
+			gro_udp_tbl_pkt_count, NULL};
+
+#define GRO_SUPPORTED_TYPES (RTE_GRO_TCP_IPV4 | \
+		RTE_GRO_IPV4_VXLAN_TCP_IPV4 | RTE_GRO_TCP_IPV6 | \
+		RTE_GRO_UDP_IPV4 | RTE_GRO_UDP_IPV6)
 
 #define IS_IPV4_TCP_PKT(ptype) (RTE_ETH_IS_IPV4_HDR(ptype) && \
 		((ptype & RTE_PTYPE_L4_TCP) == RTE_PTYPE_L4_TCP))
@@ -40,6 +50,18 @@ static gro_tbl_pkt_count_fn tbl_pkt_count_fn[RTE_GRO_TYPE_MAX_NUM] = {
 		     RTE_PTYPE_INNER_L3_IPV4_EXT | \
 		     RTE_PTYPE_INNER_L3_IPV4_EXT_UNKNOWN)) != 0))
 
+#define IS_IPV6_TCP_PKT(ptype) (RTE_ETH_IS_IPV6_HDR(ptype) && \
+		((ptype & RTE_PTYPE_L4_MASK) == RTE_PTYPE_L4_TCP) && \
+		((ptype & RTE_PTYPE_TUNNEL_MASK) == 0))
+
+#define IS_IPV4_UDP_PKT(ptype) (RTE_ETH_IS_IPV4_HDR(ptype) && \
+		((ptype & RTE_PTYPE_L4_MASK) == RTE_PTYPE_L4_UDP) && \
+		((ptype & RTE_PTYPE_TUNNEL_MASK) == 0))
+
+#define IS_IPV6_UDP_PKT(ptype) (RTE_ETH_IS_IPV6_HDR(ptype) && \
+		((ptype & RTE_PTYPE_L4_MASK) == RTE_PTYPE_L4_UDP) && \
+		((ptype & RTE_PTYPE_TUNNEL_MASK) == 0))
+
 /*
  * GRO context structure. It keeps the table structures, which are
  * used to merge packets, for different GRO types. Before using
@@ -121,28 +143,50 @@ rte_gro_reassemble_burst(struct rte_mbuf **pkts,
 	/* allocate a reassembly table for TCP/IPv4 GRO */
 	struct gro_tcp4_tbl tcp_tbl;
 	struct gro_tcp4_flow tcp_flows[RTE_GRO_MAX_BURST_ITEM_NUM];
-	struct gro_tcp4_item tcp_items[RTE_GRO_MAX_BURST_ITEM_NUM] = {{0} };
+	struct gro_tcp4_item tcp_items[RTE_GRO_MAX_BURST_ITEM_NUM];
+	uint32_t tcp_flow_hash[2 * RTE_GRO_MAX_BURST_ITEM_NUM];
+	uint32_t tcp_free_items[RTE_GRO_MAX_BURST_ITEM_NUM];
+	uint32_t tcp_free_flows[RTE_GRO_MAX_BURST_ITEM_NUM];
 
 	/* Allocate a reassembly table for VXLAN GRO */
 	struct gro_vxlan_tcp4_tbl vxlan_tbl;
 	struct gro_vxlan_tcp4_flow vxlan_flows[RTE_GRO_MAX_BURST_ITEM_NUM];
-	struct gro_vxlan_tcp4_item vxlan_items[RTE_GRO_MAX_BURST_ITEM_NUM] = {
-		{{0}, 0, 0} };
+	struct gro_vxlan_tcp4_item vxlan_items[RTE_GRO_MAX_BURST_ITEM_NUM];
+	uint32_t vxlan_flow_hash[2 * RTE_GRO_MAX_BURST_ITEM_NUM];
+	uint32_t vxlan_free_items[RTE_GRO_MAX_BURST_ITEM_NUM];
+	uint32_t vxlan_free_flows[RTE_GRO_MAX_BURST_ITEM_NUM];
+
+	/* Allocate a reassembly table for TCP/IPv6 GRO */
+	struct gro_tcp6_tbl tcp6_tbl;
+	struct gro_tcp6_flow tcp6_flows[RTE_GRO_MAX_BURST_ITEM_NUM];
+	struct gro_tcp4_item tcp6_items[RTE_GRO_MAX_BURST_ITEM_NUM];
+	uint32_t tcp6_flow_hash[2 * RTE_GRO_MAX_BURST_ITEM_NUM];
+	uint32_t tcp6_free_items[RTE_GRO_MAX_BURST_ITEM_NUM];
+	uint32_t tcp6_free_flows[RTE_GRO_MAX_BURST_ITEM_NUM];
+
+	/* Allocate a reassembly table for UDP/IPv4 and UDP/IPv6 GRO */
+	struct gro_udp_tbl udp_tbl;
+	struct gro_udp_flow udp_flows[RTE_GRO_MAX_BURST_ITEM_NUM];
+	struct gro_udp_item udp_items[RTE_GRO_MAX_BURST_ITEM_NUM];
+	uint32_t udp_flow_hash[2 * RTE_GRO_MAX_BURST_ITEM_NUM];
+	uint32_t udp_free_items[RTE_GRO_MAX_BURST_ITEM_NUM];
+	uint32_t udp_free_flows[RTE_GRO_MAX_BURST_ITEM_NUM];
 
 	struct rte_mbuf *unprocess_pkts[nb_pkts];
-	uint32_t item_num;
+	uint32_t item_num, hash_size;
 	int32_t ret;
 	uint16_t i, unprocess_num = 0, nb_after_gro = nb_pkts;
-	uint8_t do_tcp4_gro = 0, do_vxlan_gro = 0;
+	uint8_t do_tcp4_gro = 0, do_vxlan_gro = 0, do_tcp6_gro = 0;
+	uint8_t do_udp4_gro = 0, do_udp6_gro = 0;
 
-	if (unlikely((param->gro_types & (RTE_GRO_IPV4_VXLAN_TCP_IPV4 |
-					RTE_GRO_TCP_IPV4)) == 0))
+	if (unlikely((param->gro_types & GRO_SUPPORTED_TYPES) == 0))
 		return nb_pkts;
 
 	/* Get the maximum number of packets */
 	item_num = RTE_MIN(nb_pkts, (param->max_flow_num *
 				param->max_item_per_flow));
 	item_num = RTE_MIN(item_num, RTE_GRO_MAX_BURST_ITEM_NUM);
+	hash_size = gro_flow_hash_size(item_num);
 
 	if (param->gro_types & RTE_GRO_IPV4_VXLAN_TCP_IPV4) {
 		for (i = 0; i < item_num; i++)
@@ -154,6 +198,13 @@ rte_gro_reassemble_burst(struct rte_mbuf **pkts,
 		vxlan_tbl.item_num = 0;
 		vxlan_tbl.max_flow_num = item_num;
 		vxlan_tbl.max_item_num = item_num;
+		vxlan_tbl.flow_hash = vxlan_flow_hash;
+		vxlan_tbl.free_items = vxlan_free_items;
+		vxlan_tbl.free_flows = vxlan_free_flows;
+		vxlan_tbl.flow_hash_mask = hash_size - 1;
+		gro_tbl_init_free(vxlan_flow_hash, hash_size,
+				vxlan_free_items, item_num,
+				vxlan_free_flows, item_num);
 		do_vxlan_gro = 1;
 	}
 
@@ -167,9 +218,57 @@ rte_gro_reassemble_burst(struct rte_mbuf **pkts,
 		tcp_tbl.item_num = 0;
 		tcp_tbl.max_flow_num = item_num;
 		tcp_tbl.max_item_num = item_num;
+		tcp_tbl.flow_hash = tcp_flow_hash;
+		tcp_tbl.free_items = tcp_free_items;
+		tcp_tbl.free_flows = tcp_free_flows;
+		tcp_tbl.flow_hash_mask = hash_size - 1;
+		gro_tbl_init_free(tcp_flow_hash, hash_size,
+				tcp_free_items, item_num,
+				tcp_free_flows, item_num);
 		do_tcp4_gro = 1;
 	}
 
+	if (param->gro_types & RTE_GRO_TCP_IPV6) {
+		for (i = 0; i < item_num; i++)
+			tcp6_flows[i].start_index = INVALID_ARRAY_INDEX;
+
+		tcp6_tbl.flows = tcp6_flows;
+		tcp6_tbl.items = tcp6_items;
+		tcp6_tbl.flow_num = 0;
+		tcp6_tbl.item_num = 0;
+		tcp6_tbl.max_flow_num = item_num;
+		tcp6_tbl.max_item_num = item_num;
+		tcp6_tbl.flow_hash = tcp6_flow_hash;
+		tcp6_tbl.free_items = tcp6_free_items;
+		tcp6_tbl.free_flows = tcp6_free_flows;
+		tcp6_tbl.flow_hash_mask = hash_size - 1;
+		gro_tbl_init_free(tcp6_flow_hash, hash_size,
+				tcp6_free_items, item_num,
+				tcp6_free_flows, item_num);
+		do_tcp6_gro = 1;
+	}
+
+	if (param->gro_types & (RTE_GRO_UDP_IPV4 | RTE_GRO_UDP_IPV6)) {
+		for (i = 0; i < item_num; i++)
+			udp_flows[i].start_index = INVALID_ARRAY_INDEX;
+
+		udp_tbl.flows = udp_flows;
+		udp_tbl.items = udp_items;
+		udp_tbl.flow_num = 0;
+		udp_tbl.item_num = 0;
+		udp_tbl.max_flow_num = item_num;
+		udp_tbl.max_item_num = item_num;
+		udp_tbl.flow_hash = udp_flow_hash;
+		udp_tbl.free_items = udp_free_items;
+		udp_tbl.free_flows = udp_free_flows;
+		udp_tbl.flow_hash_mask = hash_size - 1;
+		gro_tbl_init_free(udp_flow_hash, hash_size,
+				udp_free_items, item_num,
+				udp_free_flows, item_num);
+		do_udp4_gro = (param->gro_types & RTE_GRO_UDP_IPV4) != 0;
+		do_udp6_gro = (param->gro_types & RTE_GRO_UDP_IPV6) != 0;
+	}
+
 	for (i = 0; i < nb_pkts; i++) {
 		/*
 		 * The timestamp is ignored, since all packets
@@ -191,6 +290,24 @@ rte_gro_reassemble_burst(struct rte_mbuf **pkts,
 				nb_after_gro--;
 			else if (ret < 0)
 				unprocess_pkts[unprocess_num++] = pkts[i];
+		} else if (IS_IPV6_TCP_PKT(pkts[i]->packet_type) &&
+				do_tcp6_gro) {
+			ret = gro_tcp6_reassemble(pkts[i], &tcp6_tbl, 0);
+			if (ret > 0)
+				nb_after_gro--;
+			else if (ret < 0)
+				unprocess_pkts[unprocess_num++] = pkts[i];
+		} else if ((IS_IPV4_UDP_PKT(pkts[i]->packet_type) &&
+					do_udp4_gro) ||
+				(IS_IPV6_UDP_PKT(pkts[i]->packet_type) &&
+				 do_udp6_gro)) {
+			ret = gro_udp_reassemble(pkts[i], &udp_tbl, 0,
+					RTE_ETH_IS_IPV6_HDR(
+						pkts[i]->packet_type) != 0);
+			if (ret > 0)
+				nb_after_gro--;
+			else if (ret < 0)
+				unprocess_pkts[unprocess_num++] = pkts[i];
 		} else
 			unprocess_pkts[unprocess_num++] = pkts[i];
 	}
@@ -206,6 +323,14 @@ rte_gro_reassemble_burst(struct rte_mbuf **pkts,
 			i += gro_tcp4_tbl_timeout_flush(&tcp_tbl, 0,
 					&pkts[i], nb_pkts - i);
 		}
+		if (do_tcp6_gro) {
+			i += gro_tcp6_tbl_timeout_flush(&tcp6_tbl, 0,
+					&pkts[i], nb_pkts - i);
+		}
+		if (do_udp4_gro || do_udp6_gro) {
+			i += gro_udp_tbl_timeout_flush(&udp_tbl, 0,
+					&pkts[i], nb_pkts - i);
+		}
 		/* Copy unprocessed packets */
 		if (unprocess_num > 0) {
 			memcpy(&pkts[i], unprocess_pkts,
@@ -224,22 +349,31 @@ rte_gro_reassemble(struct rte_mbuf **pkts,
 {
 	struct rte_mbuf *unprocess_pkts[nb_pkts];
 	struct gro_ctx *gro_ctx = ctx;
-	void *tcp_tbl, *vxlan_tbl;
+	void *tcp_tbl, *vxlan_tbl, *tcp6_tbl, *udp4_tbl, *udp6_tbl;
 	uint64_t current_time;
 	uint16_t i, unprocess_num = 0;
-	uint8_t do_tcp4_gro, do_vxlan_gro;
+	uint8_t do_tcp4_gro, do_vxlan_gro, do_tcp6_gro, do_udp4_gro;
+	uint8_t do_udp6_gro;
 
-	if (unlikely((gro_ctx->gro_types & (RTE_GRO_IPV4_VXLAN_TCP_IPV4 |
-					RTE_GRO_TCP_IPV4)) == 0))
+	if (unlikely((gro_ctx->gro_types & GRO_SUPPORTED_TYPES) == 0))
 		return nb_pkts;
 
 	tcp_tbl = gro_ctx->tbls[RTE_GRO_TCP_IPV4_INDEX];
 	vxlan_tbl = gro_ctx->tbls[RTE_GRO_IPV4_VXLAN_TCP_IPV4_INDEX];
+	tcp6_tbl = gro_ctx->tbls[RTE_GRO_TCP_IPV6_INDEX];
+	udp4_tbl = gro_ctx->tbls[RTE_GRO_UDP_IPV4_INDEX];
+	udp6_tbl = gro_ctx->tbls[RTE_GRO_UDP_IPV6_INDEX];
 
 	do_tcp4_gro = (gro_ctx->gro_types & RTE_GRO_TCP_IPV4) ==
 		RTE_GRO_TCP_IPV4;
 	do_vxlan_gro = (gro_ctx->gro_types & RTE_GRO_IPV4_VXLAN_TCP_IPV4) ==
 		RTE_GRO_IPV4_VXLAN_TCP_IPV4;
+	do_tcp6_gro = (gro_ctx->gro_types & RTE_GRO_TCP_IPV6) ==
+		RTE_GRO_TCP_IPV6;
+	do_udp4_gro = (gro_ctx->gro_types & RTE_GRO_UDP_IPV4) ==
+		RTE_GRO_UDP_IPV4;
+	do_udp6_gro = (gro_ctx->gro_types & RTE_GRO_UDP_IPV6) ==
+		RTE_GRO_UDP_IPV6;
 
 	current_time = rte_rdtsc();
 
@@ -254,6 +388,21 @@ rte_gro_reassemble(struct rte_mbuf **pkts,
 			if (gro_tcp4_reassemble(pkts[i], tcp_tbl,
 						current_time) < 0)
 				unprocess_pkts[unprocess_num++] = pkts[i];
+		} else if (IS_IPV6_TCP_PKT(pkts[i]->packet_type) &&
+				do_tcp6_gro) {
+			if (gro_tcp6_reassemble(pkts[i], tcp6_tbl,
+						current_time) < 0)
+				unprocess_pkts[unprocess_num++] = pkts[i];
+		} else if (IS_IPV4_UDP_PKT(pkts[i]->packet_type) &&
+				do_udp4_gro) {
+			if (gro_udp_reassemble(pkts[i], udp4_tbl,
+						current_time, 0) < 0)
+				unprocess_pkts[unprocess_num++] = pkts[i];
+		} else if (IS_IPV6_UDP_PKT(pkts[i]->packet_type) &&
+				do_udp6_gro) {
+			if (gro_udp_reassemble(pkts[i], udp6_tbl,
+						current_time, 1) < 0)
+				unprocess_pkts[unprocess_num++] = pkts[i];
 		} else
 			unprocess_pkts[unprocess_num++] = pkts[i];
 	}
@@ -274,7 +423,7 @@ rte_gro_timeout_flush(void *ctx,
 {
 	struct gro_ctx *gro_ctx = ctx;
 	uint64_t flush_timestamp;
-	uint16_t num = 0;
+	uint16_t num = 0, n;
 
 	gro_types = gro_types & gro_ctx->gro_types;
 	flush_timestamp = rte_rdtsc() - timeout_cycles;
@@ -288,10 +437,37 @@ rte_gro_timeout_flush(void *ctx,
 
 	/* If no available space in 'out', stop flushing. */
 	if ((gro_types & RTE_GRO_TCP_IPV4) && max_nb_out > 0) {
-		num += gro_tcp4_tbl_timeout_flush(
+		n = gro_tcp4_tbl_timeout_flush(
 				gro_ctx->tbls[RTE_GRO_TCP_IPV4_INDEX],
 				flush_timestamp,
 				&out[num], max_nb_out);
+		num += n;
+		max_nb_out -= n;
+	}
+
+	if ((gro_types & RTE_GRO_TCP_IPV6) && max_nb_out > 0) {
+		n = gro_tcp6_tbl_timeout_flush(
+				gro_ctx->tbls[RTE_GRO_TCP_IPV6_INDEX],
+				flush_timestamp,
+				&out[num], max_nb_out);
+		num += n;
+		max_nb_out -= n;
+	}
+
+	if ((gro_types & RTE_GRO_UDP_IPV4) && max_nb_out > 0) {
+		n = gro_udp_tbl_timeout_flush(
+				gro_ctx->tbls[RTE_GRO_UDP_IPV4_INDEX],
+				flush_timestamp,
+				&out[num], max_nb_out);
+		num += n;
+		max_nb_out -= n;
+	}
+
+	if ((gro_types & RTE_GRO_UDP_IPV6) && max_nb_out > 0) {
+		num += gro_udp_tbl_timeout_flush(
+				gro_ctx->tbls[RTE_GRO_UDP_IPV6_INDEX],
+				flush_timestamp,
+				&out[num], max_nb_out);
 	}
 
 	return num;
@@ -38,10 +38,186 @@ free_gso_segment(struct rte_mbuf **pkts, uint16_t nb_pkts)
 		rte_pktmbuf_free(pkts[i]);
 }
 
+/* The number of packet headers fitting in a header area */
+static inline uint32_t
+hdr_area_capacity(struct rte_mempool *direct_pool, uint16_t pkt_hdr_offset)
+{
+	uint32_t room = rte_pktmbuf_data_room_size(direct_pool);
+	uint32_t shinfo_size = sizeof(struct rte_mbuf_ext_shared_info) +
+		sizeof(uintptr_t);
+
+	if (pkt_hdr_offset == 0 || room <= shinfo_size)
+		return 0;
+	return (room - shinfo_size) / pkt_hdr_offset;
+}
+
+/* Free a header area, once all the GSO segments using it are freed */
+static void
+hdr_area_free(void *addr __rte_unused, void *opaque)
+{
+	rte_pktmbuf_free((struct rte_mbuf *)opaque);
+}
+
+/*
+ * Attach a payload segment to the data of a MBUF segment of the input
+ * packet, like rte_pktmbuf_attach(), but without taking the reference.
+ * The references are taken once per input segment by pyld_segment_ref().
+ */
+static inline void
+pyld_segment_attach(struct rte_mbuf *mi, struct rte_mbuf *m)
+{
+	if (RTE_MBUF_HAS_EXTBUF(m)) {
+		mi->ol_flags = m->ol_flags;
+		mi->shinfo = m->shinfo;
+	} else {
+		mi->priv_size = m->priv_size;
+		mi->ol_flags = m->ol_flags | IND_ATTACHED_MBUF;
+	}
+	mi->buf_iova = m->buf_iova;
+	mi->buf_addr = m->buf_addr;
+	mi->buf_len = m->buf_len;
+	mi->next = NULL;
+	mi->nb_segs = 1;
+}
+
+static inline void
+pyld_segment_ref(struct rte_mbuf *m, uint16_t nb_refs)
+{
+	if (RTE_MBUF_HAS_EXTBUF(m))
+		rte_mbuf_ext_refcnt_update(m->shinfo, nb_refs);
+	else
+		rte_mbuf_refcnt_update(rte_mbuf_from_indirect(m), nb_refs);
+}
+
+/* Skip the empty MBUF segments of the input packet */
+static inline struct rte_mbuf *
+next_pkt_in(struct rte_mbuf *pkt_in)
+{
+	do {
+		pkt_in = pkt_in->next;
+	} while (pkt_in != NULL && pkt_in->data_len == 0);
+
+	return pkt_in;
+}
+
+/*
+ * Segment the packet in nb_segs GSO segments, whose headers are stored in
+ * nb_areas header areas. nb_mbufs is the number of header and payload
+ * segments to allocate.
+ */
+static int
+gso_do_segment_extbuf(struct rte_mbuf *pkt,
+		uint16_t pkt_hdr_offset,
+		uint16_t pyld_unit_size,
+		uint32_t hdrs_per_area,
+		uint32_t nb_segs,
+		uint32_t nb_areas,
+		uint32_t nb_mbufs,
+		struct rte_mempool *direct_pool,
+		struct rte_mempool *indirect_pool,
+		struct rte_mbuf **pkts_out)
+{
+	struct rte_mbuf *areas[nb_areas];
+	struct rte_mbuf *segs[nb_mbufs];
+	struct rte_mbuf_ext_shared_info *shinfo = NULL;
+	struct rte_mbuf *pkt_in, *area = NULL;
+	struct rte_mbuf *hdr_segment, *pyld_segment, *prev_segment;
+	uint16_t pkt_in_data_pos, segment_bytes_remaining;
+	uint16_t pyld_len, area_len, hdr_pos = 0, nb_refs = 0;
+	uint32_t i, j;
+
+	if (unlikely(rte_pktmbuf_alloc_bulk(direct_pool, areas,
+					nb_areas) != 0))
+		return -ENOMEM;
+	if (unlikely(rte_pktmbuf_alloc_bulk(indirect_pool, segs,
+					nb_mbufs) != 0)) {
+		rte_mempool_put_bulk(direct_pool, (void **)areas, nb_areas);
+		return -ENOMEM;
+	}
+
+	pkt_in = pkt;
+	pkt_in_data_pos = pkt_hdr_offset;
+	if (pkt_in_data_pos == pkt_in->data_len) {
+		pkt_in = next_pkt_in(pkt_in);
+		pkt_in_data_pos = 0;
+	}
+	/* The payload segments follow the header ones in segs */
+	j = nb_segs;
+
+	for (i = 0; i < nb_segs; i++) {
+		/* Start a new header area */
+		if (i % hdrs_per_area == 0) {
+			area = areas[i / hdrs_per_area];
+			area_len = area->buf_len;
+			shinfo = rte_pktmbuf_ext_shinfo_init_helper(
+					area->buf_addr, &area_len,
+					hdr_area_free, area);
+			rte_mbuf_ext_refcnt_set(shinfo,
+					RTE_MIN(hdrs_per_area, nb_segs - i));
+			hdr_pos = 0;
+		}
+
+		/* Fill the packet header in the header area */
+		hdr_segment = segs[i];
+		rte_pktmbuf_attach_extbuf(hdr_segment,
+				RTE_PTR_ADD(area->buf_addr, hdr_pos),
+				area->buf_iova + hdr_pos,
+				pkt_hdr_offset, shinfo);
+		hdr_segment_init(hdr_segment, pkt, pkt_hdr_offset);
+		hdr_segment->ol_flags = (hdr_segment->ol_flags &
+				~IND_ATTACHED_MBUF) | EXT_ATTACHED_MBUF;
+		hdr_pos += pkt_hdr_offset;
+
+		prev_segment = hdr_segment;
+		segment_bytes_remaining = pyld_unit_size;
+
+		do {
+			pyld_segment = segs[j++];
+			pyld_segment_attach(pyld_segment, pkt_in);
+			nb_refs++;
+
+			pyld_len = RTE_MIN(segment_bytes_remaining,
+					pkt_in->data_len - pkt_in_data_pos);
+			pyld_segment->data_off = pkt_in_data_pos +
+				pkt_in->data_off;
+			pyld_segment->data_len = pyld_len;
+			pyld_segment->pkt_len = pyld_len;
+
+			prev_segment->next = pyld_segment;
+			prev_segment = pyld_segment;
+
+			/* Update header segment */
+			hdr_segment->pkt_len += pyld_len;
+			hdr_segment->nb_segs++;
+
+			pkt_in_data_pos += pyld_len;
+			segment_bytes_remaining -= pyld_len;
+
+			/* Finish processing a MBUF segment of pkt */
+			if (pkt_in_data_pos == pkt_in->data_len) {
+				pyld_segment_ref(pkt_in, nb_refs);
+				nb_refs = 0;
+				pkt_in = next_pkt_in(pkt_in);
+				pkt_in_data_pos = 0;
+			}
+		} while (segment_bytes_remaining > 0 && pkt_in != NULL);
+
+		pkts_out[i] = hdr_segment;
+	}
+
+	/* Give back the payload segments which weren't needed */
+	if (j < nb_mbufs)
+		rte_mempool_put_bulk(indirect_pool, (void **)&segs[j],
+				nb_mbufs - j);
+
+	return nb_segs;
+}
+
 int
 gso_do_segment(struct rte_mbuf *pkt,
 		uint16_t pkt_hdr_offset,
 		uint16_t pyld_unit_size,
+		uint8_t extbuf_hdr,
 		struct rte_mempool *direct_pool,
 		struct rte_mempool *indirect_pool,
 		struct rte_mbuf **pkts_out,
@@ -51,8 +227,34 @@ gso_do_segment(struct rte_mbuf *pkt,
 	struct rte_mbuf *hdr_segment, *pyld_segment, *prev_segment;
 	uint16_t pkt_in_data_pos, segment_bytes_remaining;
 	uint16_t pyld_len, nb_segs;
+	uint32_t hdrs_per_area, nb_hdrs, nb_pylds;
 	bool more_in_pkt, more_out_segs;
 
+	hdrs_per_area = extbuf_hdr ?
+		hdr_area_capacity(direct_pool, pkt_hdr_offset) : 0;
+	/* Otherwise, copy the header in a direct MBUF per GSO segment */
+	if (hdrs_per_area > 0) {
+		if (unlikely(pkt->pkt_len <= pkt_hdr_offset ||
+					pyld_unit_size == 0))
+			return -EINVAL;
+
+		nb_hdrs = (pkt->pkt_len - pkt_hdr_offset +
+				pyld_unit_size - 1) / pyld_unit_size;
+		if (unlikely(nb_hdrs > nb_pkts_out))
+			return -EINVAL;
+		/*
+		 * Each MBUF segment of the input packet but the first one
+		 * may add a payload segment to a GSO segment.
+		 */
+		nb_pylds = nb_hdrs + pkt->nb_segs - 1;
+
+		return gso_do_segment_extbuf(pkt, pkt_hdr_offset,
+				pyld_unit_size, hdrs_per_area, nb_hdrs,
+				(nb_hdrs + hdrs_per_area - 1) / hdrs_per_area,
+				nb_hdrs + nb_pylds, direct_pool,
+				indirect_pool, pkts_out);
+	}
+
 	pkt_in = pkt;
 	nb_segs = 0;
 	more_in_pkt = 1;
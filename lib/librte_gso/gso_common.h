@@ -31,6 +31,9 @@
 		(PKT_TX_TCP_SEG | PKT_TX_IPV4 | PKT_TX_OUTER_IPV4 | \
 		 PKT_TX_TUNNEL_GRE))
 
+#define IS_IPV6_TCP(flag) (((flag) & (PKT_TX_TCP_SEG | PKT_TX_IPV6)) == \
+		(PKT_TX_TCP_SEG | PKT_TX_IPV6))
+
 #define IS_IPV4_UDP(flag) (((flag) & (PKT_TX_UDP_SEG | PKT_TX_IPV4)) == \
 		(PKT_TX_UDP_SEG | PKT_TX_IPV4))
 
@@ -106,6 +109,27 @@ update_ipv4_header(struct rte_mbuf *pkt, uint16_t l3_offset, uint16_t id)
 	ipv4_hdr->packet_id = rte_cpu_to_be_16(id);
 }
 
+/**
+ * Internal function which updates the IPv6 header of a packet, following
+ * segmentation. This is required to update the header's 'payload_len'
+ * field, to reflect the reduced length of the now-segmented packet.
+ *
+ * @param pkt
+ *  The packet containing the IPv6 header.
+ * @param l3_offset
+ *  The offset of the IPv6 header from the start of the packet.
+ */
+static inline void
+update_ipv6_header(struct rte_mbuf *pkt, uint16_t l3_offset)
+{
+	struct rte_ipv6_hdr *ipv6_hdr;
+
+	ipv6_hdr = (struct rte_ipv6_hdr *)(rte_pktmbuf_mtod(pkt, char *) +
+			l3_offset);
+	ipv6_hdr->payload_len = rte_cpu_to_be_16(pkt->pkt_len - l3_offset -
+			sizeof(struct rte_ipv6_hdr));
+}
+
 /**
  * Internal function which divides the input packet into small segments.
  * Each of the newly-created segments is organized as a two-segment MBUF,
@@ -113,12 +137,19 @@ update_ipv4_header(struct rte_mbuf *pkt, uint16_t l3_offset, uint16_t id)
  * packet header, and the second is an indirect mbuf which points to a
  * section of data in the input packet.
  *
+ * With extbuf_hdr, the packet headers of the segments are instead copied
+ * next to each other in header areas taken from direct_pool, and the
+ * first segment is an indirect_pool mbuf attached to its header as an
+ * external buffer. All the mbufs are allocated in bulk.
+ *
  * @param pkt
  *  Packet to segment.
  * @param pkt_hdr_offset
  *  Packet header offset, measured in bytes.
  * @param pyld_unit_size
  *  The max payload length of a GSO segment.
+ * @param extbuf_hdr
+ *  Whether to store the packet headers in header areas.
  * @param direct_pool
  *  MBUF pool used for allocating direct buffers for output segments.
  * @param indirect_pool
@@ -138,6 +169,7 @@ update_ipv4_header(struct rte_mbuf *pkt, uint16_t l3_offset, uint16_t id)
 int gso_do_segment(struct rte_mbuf *pkt,
 		uint16_t pkt_hdr_offset,
 		uint16_t pyld_unit_size,
+		uint8_t extbuf_hdr,
 		struct rte_mempool *direct_pool,
 		struct rte_mempool *indirect_pool,
 		struct rte_mbuf **pkts_out,
@@ -35,6 +35,7 @@ int
 gso_tcp4_segment(struct rte_mbuf *pkt,
 		uint16_t gso_size,
 		uint8_t ipid_delta,
+		uint8_t extbuf_hdr,
 		struct rte_mempool *direct_pool,
 		struct rte_mempool *indirect_pool,
 		struct rte_mbuf **pkts_out,
@@ -64,8 +65,8 @@ gso_tcp4_segment(struct rte_mbuf *pkt,
 	pyld_unit_size = gso_size - hdr_offset;
 
 	/* Segment the payload */
-	ret = gso_do_segment(pkt, hdr_offset, pyld_unit_size, direct_pool,
-			indirect_pool, pkts_out, nb_pkts_out);
+	ret = gso_do_segment(pkt, hdr_offset, pyld_unit_size, extbuf_hdr,
+			direct_pool, indirect_pool, pkts_out, nb_pkts_out);
 	if (ret > 1)
 		update_ipv4_tcp_headers(pkt, ipid_delta, pkts_out, ret);
 
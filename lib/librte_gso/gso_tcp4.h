@@ -19,6 +19,9 @@
  *  The max length of a GSO segment, measured in bytes.
  * @param ipid_delta
  *  The increasing unit of IP ids.
+ * @param extbuf_hdr
+ *  Whether to store the packet headers of the segments in header areas
+ *  attached as external buffers.
  * @param direct_pool
  *  MBUF pool used for allocating direct buffers for output segments.
  * @param indirect_pool
@@ -38,6 +41,7 @@
 int gso_tcp4_segment(struct rte_mbuf *pkt,
 		uint16_t gso_size,
 		uint8_t ip_delta,
+		uint8_t extbuf_hdr,
 		struct rte_mempool *direct_pool,
 		struct rte_mempool *indirect_pool,
 		struct rte_mbuf **pkts_out,
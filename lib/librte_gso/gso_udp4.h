@@ -17,6 +17,9 @@
  *  The packet mbuf to segment.
  * @param gso_size
  *  The max length of a GSO segment, measured in bytes.
+ * @param extbuf_hdr
+ *  Whether to store the packet headers of the segments in header areas
+ *  attached as external buffers.
  * @param direct_pool
  *  MBUF pool used for allocating direct buffers for output segments.
  * @param indirect_pool
@@ -35,6 +38,7 @@
  */
 int gso_udp4_segment(struct rte_mbuf *pkt,
 		uint16_t gso_size,
+		uint8_t extbuf_hdr,
 		struct rte_mempool *direct_pool,
 		struct rte_mempool *indirect_pool,
 		struct rte_mbuf **pkts_out,
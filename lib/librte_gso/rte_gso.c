@@ -10,6 +10,7 @@
 #include "rte_gso.h"
 #include "gso_common.h"
 #include "gso_tcp4.h"
+#include "gso_tcp6.h"
 #include "gso_tunnel_tcp4.h"
 #include "gso_udp4.h"
 
@@ -33,7 +34,7 @@ rte_gso_segment(struct rte_mbuf *pkt,
 	struct rte_mbuf *pkt_seg;
 	uint64_t ol_flags;
 	uint16_t gso_size;
-	uint8_t ipid_delta;
+	uint8_t ipid_delta, extbuf_hdr;
 	int ret = 1;
 
 	if (pkt == NULL || pkts_out == NULL || gso_ctx == NULL ||
@@ -51,7 +52,8 @@ rte_gso_segment(struct rte_mbuf *pkt,
 	direct_pool = gso_ctx->direct_pool;
 	indirect_pool = gso_ctx->indirect_pool;
 	gso_size = gso_ctx->gso_size;
-	ipid_delta = (gso_ctx->flag != RTE_GSO_FLAG_IPID_FIXED);
+	ipid_delta = (gso_ctx->flag & RTE_GSO_FLAG_IPID_FIXED) == 0;
+	extbuf_hdr = (gso_ctx->flag & RTE_GSO_FLAG_EXTBUF_HDR) != 0;
 	ol_flags = pkt->ol_flags;
 
 	if ((IS_IPV4_VXLAN_TCP4(pkt->ol_flags) &&
@@ -60,19 +62,26 @@ rte_gso_segment(struct rte_mbuf *pkt,
 			 (gso_ctx->gso_types & DEV_TX_OFFLOAD_GRE_TNL_TSO)))) {
 		pkt->ol_flags &= (~PKT_TX_TCP_SEG);
 		ret = gso_tunnel_tcp4_segment(pkt, gso_size, ipid_delta,
-				direct_pool, indirect_pool,
+				extbuf_hdr, direct_pool, indirect_pool,
 				pkts_out, nb_pkts_out);
 	} else if (IS_IPV4_TCP(pkt->ol_flags) &&
 			(gso_ctx->gso_types & DEV_TX_OFFLOAD_TCP_TSO)) {
 		pkt->ol_flags &= (~PKT_TX_TCP_SEG);
 		ret = gso_tcp4_segment(pkt, gso_size, ipid_delta,
+				extbuf_hdr, direct_pool, indirect_pool,
+				pkts_out, nb_pkts_out);
+	} else if (IS_IPV6_TCP(pkt->ol_flags) &&
+			(gso_ctx->gso_types & DEV_TX_OFFLOAD_TCP_TSO)) {
+		pkt->ol_flags &= (~PKT_TX_TCP_SEG);
+		ret = gso_tcp6_segment(pkt, gso_size, extbuf_hdr,
 				direct_pool, indirect_pool,
 				pkts_out, nb_pkts_out);
 	} else if (IS_IPV4_UDP(pkt->ol_flags) &&
 			(gso_ctx->gso_types & DEV_TX_OFFLOAD_UDP_TSO)) {
 		pkt->ol_flags &= (~PKT_TX_UDP_SEG);
-		ret = gso_udp4_segment(pkt, gso_size, direct_pool,
-				indirect_pool, pkts_out, nb_pkts_out);
+		ret = gso_udp4_segment(pkt, gso_size, extbuf_hdr,
+				direct_pool, indirect_pool,
+				pkts_out, nb_pkts_out);
 	} else {
 		/* unsupported packet, skip */
 		pkts_out[0] = pkt;
@@ -30,6 +30,18 @@ extern "C" {
 /**< Use fixed IP ids for output GSO segments. Setting
  * 0 indicates using incremental IP ids.
  */
+#define RTE_GSO_FLAG_EXTBUF_HDR (1ULL << 1)
+/**< @warning
+ * @b EXPERIMENTAL: this flag may change without prior notice
+ *
+ * Store the packet headers of the output GSO segments next to each other
+ * in header areas, each taken from the direct pool and shared by several
+ * segments as an external buffer, instead of in a direct buffer per
+ * segment. The header and payload MBUFs of the segments, which are then
+ * all taken from the indirect pool, are allocated in bulk. The headers
+ * must fit in the data room of the direct pool, otherwise they are copied
+ * in direct buffers.
+ */
 
 /**
  * GSO context structure.
@@ -37,7 +49,9 @@ extern "C" {
 struct rte_gso_ctx {
 	struct rte_mempool *direct_pool;
 	/**< MBUF pool for allocating direct buffers, which are used
-	 * to store packet headers for GSO segments.
+	 * to store packet headers for GSO segments. With
+	 * RTE_GSO_FLAG_EXTBUF_HDR, a direct buffer stores the packet
+	 * headers of several GSO segments.
 	 */
 	struct rte_mempool *indirect_pool;
 	/**< MBUF pool for allocating indirect buffers, which are used
@@ -56,7 +70,7 @@ struct rte_gso_ctx {
 	 * gso_types.
 	 *
 	 * For example, if applications want to segment TCP/IPv4
-	 * packets, set DEV_TX_OFFLOAD_TCP_TSO in gso_types.
+	 * or TCP/IPv6 packets, set DEV_TX_OFFLOAD_TCP_TSO in gso_types.
 	 */
 	uint16_t gso_size;
 	/**< maximum size of an output GSO segment, including packet
@@ -78,13 +92,16 @@ struct rte_gso_ctx {
  * Before calling rte_gso_segment(), applications must set proper ol_flags
  * for the packet. The GSO library uses the same macros as that of TSO.
  * For example, set PKT_TX_TCP_SEG and PKT_TX_IPV4 in ol_flags to segment
- * a TCP/IPv4 packet. If rte_gso_segment() succeeds, the PKT_TX_TCP_SEG
+ * a TCP/IPv4 packet, or PKT_TX_TCP_SEG and PKT_TX_IPV6 to segment a
+ * TCP/IPv6 packet. If rte_gso_segment() succeeds, the PKT_TX_TCP_SEG
  * flag is removed for all GSO segments and the input packet.
  *
  * Each of the newly-created GSO segments is organized as a two-segment
  * MBUF, where the first segment is a standard MBUF, which stores a copy
  * of packet header, and the second is an indirect MBUF which points to
- * a section of data in the input packet. Since each GSO segment has
+ * a section of data in the input packet. With RTE_GSO_FLAG_EXTBUF_HDR,
+ * the first segment is instead attached to a copy of the packet header
+ * as an external buffer. Since each GSO segment has
  * multiple MBUFs (i.e. typically 2 MBUFs), the driver of the interface which
  * the GSO segments are sent to should support transmission of multi-segment
  * packets.
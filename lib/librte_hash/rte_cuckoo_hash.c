@@ -28,6 +28,7 @@
 #include <rte_compat.h>
 #include <rte_vect.h>
 #include <rte_tailq.h>
+#include <rte_cycles.h>
 
 #include "rte_hash.h"
 #include "rte_cuckoo_hash.h"
@@ -121,6 +122,20 @@ get_alt_bucket_index(const struct rte_hash *h,
 	return (cur_bkt_idx ^ sig) & h->bucket_bitmask;
 }
 
+/* Locate the buckets of a key among the buckets being migrated by a
+ * resize. The old bitmask is a subset of the current one.
+ */
+static inline void
+get_old_buckets(const struct rte_hash *h, uint32_t prim_bucket_idx,
+		uint16_t sig, struct rte_hash_bucket **prim_bkt,
+		struct rte_hash_bucket **sec_bkt)
+{
+	uint32_t old_idx = prim_bucket_idx & h->old_bucket_bitmask;
+
+	*prim_bkt = &h->old_buckets[old_idx];
+	*sec_bkt = &h->old_buckets[(old_idx ^ sig) & h->old_bucket_bitmask];
+}
+
 struct rte_hash *
 rte_hash_create(const struct rte_hash_parameters *params)
 {
@@ -143,6 +158,7 @@ rte_hash_create(const struct rte_hash_parameters *params)
 	unsigned int no_free_on_del = 0;
 	uint32_t *ext_bkt_to_free = NULL;
 	uint32_t *tbl_chng_cnt = NULL;
+	uint32_t *last_hit = NULL;
 	unsigned int readwrite_concur_lf_support = 0;
 	uint32_t i;
 
@@ -329,6 +345,16 @@ rte_hash_create(const struct rte_hash_parameters *params)
 		goto err_unlock;
 	}
 
+	if (params->extra_flag & RTE_HASH_EXTRA_FLAGS_AGING) {
+		last_hit = rte_zmalloc_socket(NULL,
+				sizeof(uint32_t) * num_key_slots,
+				RTE_CACHE_LINE_SIZE, params->socket_id);
+		if (last_hit == NULL) {
+			RTE_LOG(ERR, HASH, "memory allocation failed\n");
+			goto err_unlock;
+		}
+	}
+
 /*
  * If x86 architecture is used, select appropriate compare function,
  * which may use x86 intrinsics, otherwise use memcmp
@@ -400,6 +426,7 @@ rte_hash_create(const struct rte_hash_parameters *params)
 	h->ext_bkt_to_free = ext_bkt_to_free;
 	h->tbl_chng_cnt = tbl_chng_cnt;
 	*h->tbl_chng_cnt = 0;
+	h->last_hit = last_hit;
 	h->hw_trans_mem_support = hw_trans_mem_support;
 	h->use_local_cache = use_local_cache;
 	h->readwrite_concur_support = readwrite_concur_support;
@@ -407,8 +434,36 @@ rte_hash_create(const struct rte_hash_parameters *params)
 	h->writer_takes_lock = writer_takes_lock;
 	h->no_free_on_del = no_free_on_del;
 	h->readwrite_concur_lf_support = readwrite_concur_lf_support;
+	h->socket_id = params->socket_id;
 
 #if defined(RTE_ARCH_X86)
+#if defined(CC_AVX512_SUPPORT)
+	if (rte_cpu_get_flag_enabled(RTE_CPUFLAG_AVX512F) &&
+			rte_cpu_get_flag_enabled(RTE_CPUFLAG_AVX512BW) &&
+			rte_cpu_get_flag_enabled(RTE_CPUFLAG_AVX512VL)) {
+		h->sig_cmp_fn = RTE_HASH_COMPARE_AVX512;
+		/*
+		 * Use the wider registers to compare keys as well, 16 and
+		 * 32-byte keys of bulk lookups several at a time.
+		 */
+		switch (h->cmp_jump_table_idx) {
+		case KEY_16_BYTES:
+			h->cmp_jump_table_idx = KEY_16_BYTES_AVX512;
+			break;
+		case KEY_32_BYTES:
+			h->cmp_jump_table_idx = KEY_32_BYTES_AVX512;
+			break;
+		case KEY_48_BYTES:
+			h->cmp_jump_table_idx = KEY_48_BYTES_AVX512;
+			break;
+		case KEY_64_BYTES:
+			h->cmp_jump_table_idx = KEY_64_BYTES_AVX512;
+			break;
+		default:
+			break;
+		}
+	} else
+#endif
 	if (rte_cpu_get_flag_enabled(RTE_CPUFLAG_SSE2))
 		h->sig_cmp_fn = RTE_HASH_COMPARE_SSE;
 	else
@@ -453,6 +508,7 @@ rte_hash_create(const struct rte_hash_parameters *params)
 	rte_free(k);
 	rte_free(tbl_chng_cnt);
 	rte_free(ext_bkt_to_free);
+	rte_free(last_hit);
 	return NULL;
 }
 
@@ -484,6 +540,11 @@ rte_hash_free(struct rte_hash *h)
 
 	rte_mcfg_tailq_write_unlock();
 
+	if (h->dq != NULL && rte_rcu_qsbr_dq_delete(h->dq) != 0)
+		RTE_LOG(ERR, HASH, "RCU defer queue of %s is not empty\n",
+			h->name);
+	rte_free(h->hash_rcu_cfg);
+
 	if (h->use_local_cache)
 		rte_free(h->local_free_slots);
 	if (h->writer_takes_lock)
@@ -495,6 +556,10 @@ rte_hash_free(struct rte_hash *h)
 	rte_free(h->buckets_ext);
 	rte_free(h->tbl_chng_cnt);
 	rte_free(h->ext_bkt_to_free);
+	rte_free(h->last_hit);
+	rte_free(h->retired_key_store);
+	rte_free(h->retired_buckets);
+	rte_free(h->retired_last_hit);
 	rte_free(h);
 	rte_free(te);
 }
@@ -521,6 +586,47 @@ rte_hash_max_key_id(const struct rte_hash *h)
 		return h->entries;
 }
 
+int
+rte_hash_get_cmp_path(const struct rte_hash *h, const char **sig_cmp,
+		const char **key_cmp)
+{
+	static const char * const sig_cmp_names[RTE_HASH_COMPARE_NUM] = {
+		[RTE_HASH_COMPARE_SCALAR] = "scalar",
+		[RTE_HASH_COMPARE_SSE] = "sse",
+		[RTE_HASH_COMPARE_NEON] = "neon",
+		[RTE_HASH_COMPARE_AVX512] = "avx512",
+	};
+	static const char * const key_cmp_names[NUM_KEY_CMP_CASES] = {
+		[KEY_CUSTOM] = "custom",
+#if defined(RTE_ARCH_X86) || defined(RTE_ARCH_ARM64)
+		[KEY_16_BYTES] = "16 bytes",
+		[KEY_32_BYTES] = "32 bytes",
+		[KEY_48_BYTES] = "48 bytes",
+		[KEY_64_BYTES] = "64 bytes",
+		[KEY_80_BYTES] = "80 bytes",
+		[KEY_96_BYTES] = "96 bytes",
+		[KEY_112_BYTES] = "112 bytes",
+		[KEY_128_BYTES] = "128 bytes",
+#endif
+		[KEY_OTHER_BYTES] = "memcmp",
+#if defined(CC_AVX512_SUPPORT)
+		/* the bulk lookups compare 4 or 2 keys at a time */
+		[KEY_16_BYTES_AVX512] = "16 bytes avx512 x4",
+		[KEY_32_BYTES_AVX512] = "32 bytes avx512 x2",
+		[KEY_48_BYTES_AVX512] = "48 bytes avx512",
+		[KEY_64_BYTES_AVX512] = "64 bytes avx512",
+#endif
+	};
+
+	if (h == NULL || sig_cmp == NULL || key_cmp == NULL)
+		return -EINVAL;
+
+	*sig_cmp = sig_cmp_names[h->sig_cmp_fn];
+	*key_cmp = key_cmp_names[h->cmp_jump_table_idx];
+
+	return 0;
+}
+
 int32_t
 rte_hash_count(const struct rte_hash *h)
 {
@@ -582,6 +688,132 @@ __hash_rw_reader_unlock(const struct rte_hash *h)
 		rte_rwlock_read_unlock(h->readwrite_lock);
 }
 
+/* Current time in units of the key time stamps */
+static inline uint32_t
+__hash_age_now(void)
+{
+	return (uint32_t)(rte_get_tsc_cycles() >> AGE_TSC_SHIFT);
+}
+
+/* Record a hit on a key slot. The stamp is only written when it changes,
+ * so that readers hitting the same key do not keep bouncing its cache line.
+ */
+static inline void
+__hash_age_touch(const struct rte_hash *h, uint32_t key_idx, uint32_t now)
+{
+	if (__atomic_load_n(&h->last_hit[key_idx], __ATOMIC_RELAXED) != now)
+		__atomic_store_n(&h->last_hit[key_idx], now, __ATOMIC_RELAXED);
+}
+
+/* Free a key index, and the key-data if asked to, once the readers
+ * are done with it.
+ */
+static inline void
+__hash_rcu_free_key(const struct rte_hash *h, uint32_t key_idx)
+{
+	struct rte_hash_key *k;
+
+	if (h->hash_rcu_cfg->free_key_data_func != NULL) {
+		k = RTE_PTR_ADD(h->key_store, key_idx * h->key_entry_size);
+		h->hash_rcu_cfg->free_key_data_func(
+				h->hash_rcu_cfg->key_data_ptr, k->pdata);
+	}
+	rte_hash_free_key_with_position(h, key_idx - 1);
+}
+
+/* Defer queue callback */
+static void
+__hash_rcu_qsbr_free_resource(void *p, void *e, unsigned int n __rte_unused)
+{
+	__hash_rcu_free_key((const struct rte_hash *)p, *(uint32_t *)e);
+}
+
+/* Hand the key index of a deleted entry over to the defer queue.
+ * Writer is expected to hold the lock while calling this function.
+ * Return 0 if the index was queued, 1 if the caller has to wait for
+ * the readers and free it by itself.
+ */
+static inline int
+__hash_rcu_qsbr_defer(const struct rte_hash *h, uint32_t key_idx)
+{
+	if (h->dq != NULL && rte_rcu_qsbr_dq_enqueue(h->dq, &key_idx) == 0)
+		return 0;
+
+	return 1;
+}
+
+/* Try to get key indexes back from the defer queue when out of free slots */
+static inline int
+__hash_rcu_qsbr_reclaim(const struct rte_hash *h)
+{
+	unsigned int freed = 0;
+
+	if (h->dq == NULL)
+		return 0;
+
+	__hash_rw_writer_lock(h);
+	rte_rcu_qsbr_dq_reclaim(h->dq, h->hash_rcu_cfg->max_reclaim_size,
+				&freed, NULL, NULL);
+	__hash_rw_writer_unlock(h);
+
+	return freed;
+}
+
+int
+rte_hash_rcu_qsbr_add(struct rte_hash *h, struct rte_hash_rcu_config *cfg)
+{
+	struct rte_rcu_qsbr_dq_parameters params = {0};
+	struct rte_hash_rcu_config *hash_rcu_cfg;
+
+	if (h == NULL || cfg == NULL || cfg->v == NULL ||
+			(cfg->mode != RTE_HASH_QSBR_MODE_DQ &&
+			 cfg->mode != RTE_HASH_QSBR_MODE_SYNC))
+		return -EINVAL;
+
+	/* Key indexes freed on delete are not protected by a grace period */
+	if (h->no_free_on_del == 0) {
+		RTE_LOG(ERR, HASH, "RCU requires key index not freed on delete\n");
+		return -EINVAL;
+	}
+
+	if (h->hash_rcu_cfg != NULL)
+		return -EEXIST;
+
+	hash_rcu_cfg = rte_zmalloc(NULL, sizeof(struct rte_hash_rcu_config), 0);
+	if (hash_rcu_cfg == NULL) {
+		RTE_LOG(ERR, HASH, "memory allocation failed\n");
+		return -ENOMEM;
+	}
+	*hash_rcu_cfg = *cfg;
+
+	if (cfg->mode == RTE_HASH_QSBR_MODE_DQ) {
+		/* Init QSBR defer queue. */
+		params.name = h->name;
+		params.size = cfg->dq_size;
+		if (params.size == 0)
+			params.size = rte_hash_max_key_id(h);
+		params.trigger_reclaim_limit = cfg->trigger_reclaim_limit;
+		params.max_reclaim_size = cfg->max_reclaim_size;
+		if (params.max_reclaim_size == 0)
+			params.max_reclaim_size = RTE_HASH_RCU_DQ_RECLAIM_MAX;
+		params.esize = sizeof(uint32_t);	/* key index */
+		params.free_fn = __hash_rcu_qsbr_free_resource;
+		params.p = h;
+		params.v = cfg->v;
+		h->dq = rte_rcu_qsbr_dq_create(&params);
+		if (h->dq == NULL) {
+			rte_free(hash_rcu_cfg);
+			RTE_LOG(ERR, HASH, "HASH defer queue creation failed\n");
+			return -ENOMEM;
+		}
+		hash_rcu_cfg->max_reclaim_size = params.max_reclaim_size;
+	}
+
+	h->hash_rcu_cfg = hash_rcu_cfg;
+
+	return 0;
+}
+
 void
 rte_hash_reset(struct rte_hash *h)
 {
@@ -590,7 +822,32 @@ rte_hash_reset(struct rte_hash *h)
 	if (h == NULL)
 		return;
 
+	/* Indexes still on the defer queue would be handed out twice once
+	 * the free ring is repopulated. Wait for the readers before taking
+	 * the writer lock, as lock based readers can't report quiescent
+	 * while blocked on it, and drain the queue under the lock.
+	 */
+	if (h->dq != NULL)
+		rte_rcu_qsbr_synchronize(h->hash_rcu_cfg->v,
+					RTE_QSBR_THRID_INVALID);
+
 	__hash_rw_writer_lock(h);
+
+	if (h->dq != NULL)
+		rte_rcu_qsbr_dq_reclaim(h->dq, ~0, NULL, NULL, NULL);
+
+	/* No reader references the table, drop a resize in progress */
+	if (h->resize_state != RESIZE_IDLE) {
+		h->old_buckets = NULL;
+		rte_free(h->retired_key_store);
+		rte_free(h->retired_buckets);
+		rte_free(h->retired_last_hit);
+		h->retired_key_store = NULL;
+		h->retired_buckets = NULL;
+		h->retired_last_hit = NULL;
+		h->resize_state = RESIZE_IDLE;
+	}
+
 	memset(h->buckets, 0, h->num_buckets * sizeof(struct rte_hash_bucket));
 	memset(h->key_store, 0, h->key_entry_size * (h->entries + 1));
 	*h->tbl_chng_cnt = 0;
@@ -672,6 +929,9 @@ search_and_update(const struct rte_hash *h, void *data, const void *key,
 				__atomic_store_n(&k->pdata,
 					data,
 					__ATOMIC_RELEASE);
+				if (h->last_hit != NULL)
+					__hash_age_touch(h, bkt->key_idx[i],
+							__hash_age_now());
 				/*
 				 * Return index where key is stored,
 				 * subtracting the first dummy index
@@ -683,6 +943,24 @@ search_and_update(const struct rte_hash *h, void *data, const void *key,
 	return -1;
 }
 
+/* Search a key not migrated yet by a resize and update its data.
+ * Writer holds the lock before calling this.
+ */
+static inline int32_t
+search_and_update_old(const struct rte_hash *h, void *data, const void *key,
+	uint32_t prim_bucket_idx, uint16_t sig)
+{
+	struct rte_hash_bucket *prim_bkt, *sec_bkt;
+	int32_t ret;
+
+	get_old_buckets(h, prim_bucket_idx, sig, &prim_bkt, &sec_bkt);
+	ret = search_and_update(h, data, key, prim_bkt, sig);
+	if (ret == -1)
+		ret = search_and_update(h, data, key, sec_bkt, sig);
+
+	return ret;
+}
+
 /* Only tries to insert at one bucket (@prim_bkt) without trying to push
  * buckets around.
  * return 1 if matching existing key, return 0 if succeeds, return -1 for no
@@ -931,109 +1209,45 @@ rte_hash_cuckoo_make_space_mw(const struct rte_hash *h,
 	return -ENOSPC;
 }
 
+/*
+ * Insert a key whose key-store slot (@slot_id) has already been filled in,
+ * after the fast path failed to find an empty entry. Pushes entries around
+ * with cuckoo displacement and falls back to the extendable buckets.
+ * Return the position of the new key (slot_id - 1), the position of an
+ * already existing copy of the key, or a negative errno. The caller owns
+ * @slot_id unless slot_id - 1 is returned.
+ */
 static inline int32_t
-__rte_hash_add_key_with_hash(const struct rte_hash *h, const void *key,
-						hash_sig_t sig, void *data)
+__rte_hash_add_key_displace(const struct rte_hash *h, const void *key,
+			void *data, uint16_t short_sig,
+			uint32_t prim_bucket_idx, uint32_t sec_bucket_idx,
+			uint32_t slot_id)
 {
-	uint16_t short_sig;
-	uint32_t prim_bucket_idx, sec_bucket_idx;
 	struct rte_hash_bucket *prim_bkt, *sec_bkt, *cur_bkt;
-	struct rte_hash_key *new_k, *keys = h->key_store;
-	uint32_t slot_id;
 	uint32_t ext_bkt_id;
 	int ret;
-	unsigned n_slots;
-	unsigned lcore_id;
 	unsigned int i;
-	struct lcore_cache *cached_free_slots = NULL;
 	int32_t ret_val;
 	struct rte_hash_bucket *last;
 
-	short_sig = get_short_sig(sig);
-	prim_bucket_idx = get_prim_bucket_index(h, sig);
-	sec_bucket_idx = get_alt_bucket_index(h, prim_bucket_idx, short_sig);
 	prim_bkt = &h->buckets[prim_bucket_idx];
 	sec_bkt = &h->buckets[sec_bucket_idx];
-	rte_prefetch0(prim_bkt);
-	rte_prefetch0(sec_bkt);
-
-	/* Check if key is already inserted in primary location */
-	__hash_rw_writer_lock(h);
-	ret = search_and_update(h, data, key, prim_bkt, short_sig);
-	if (ret != -1) {
-		__hash_rw_writer_unlock(h);
-		return ret;
-	}
-
-	/* Check if key is already inserted in secondary location */
-	FOR_EACH_BUCKET(cur_bkt, sec_bkt) {
-		ret = search_and_update(h, data, key, cur_bkt, short_sig);
-		if (ret != -1) {
-			__hash_rw_writer_unlock(h);
-			return ret;
-		}
-	}
-
-	__hash_rw_writer_unlock(h);
-
-	/* Did not find a match, so get a new slot for storing the new key */
-	if (h->use_local_cache) {
-		lcore_id = rte_lcore_id();
-		cached_free_slots = &h->local_free_slots[lcore_id];
-		/* Try to get a free slot from the local cache */
-		if (cached_free_slots->len == 0) {
-			/* Need to get another burst of free slots from global ring */
-			n_slots = rte_ring_mc_dequeue_burst_elem(h->free_slots,
-					cached_free_slots->objs,
-					sizeof(uint32_t),
-					LCORE_CACHE_SIZE, NULL);
-			if (n_slots == 0) {
-				return -ENOSPC;
-			}
-
-			cached_free_slots->len += n_slots;
-		}
-
-		/* Get a free slot from the local cache */
-		cached_free_slots->len--;
-		slot_id = cached_free_slots->objs[cached_free_slots->len];
-	} else {
-		if (rte_ring_sc_dequeue_elem(h->free_slots, &slot_id,
-						sizeof(uint32_t)) != 0) {
-			return -ENOSPC;
-		}
-	}
-
-	new_k = RTE_PTR_ADD(keys, slot_id * h->key_entry_size);
-	/* The store to application data (by the application) at *data should
-	 * not leak after the store of pdata in the key store. i.e. pdata is
-	 * the guard variable. Release the application data to the readers.
-	 */
-	__atomic_store_n(&new_k->pdata,
-		data,
-		__ATOMIC_RELEASE);
-	/* Copy key */
-	memcpy(new_k->key, key, h->key_len);
 
 	/* Find an empty slot and insert */
 	ret = rte_hash_cuckoo_insert_mw(h, prim_bkt, sec_bkt, key, data,
 					short_sig, slot_id, &ret_val);
 	if (ret == 0)
 		return slot_id - 1;
-	else if (ret == 1) {
-		enqueue_slot_back(h, cached_free_slots, slot_id);
+	else if (ret == 1)
 		return ret_val;
-	}
 
 	/* Primary bucket full, need to make space for new entry */
 	ret = rte_hash_cuckoo_make_space_mw(h, prim_bkt, sec_bkt, key, data,
 				short_sig, prim_bucket_idx, slot_id, &ret_val);
 	if (ret == 0)
 		return slot_id - 1;
-	else if (ret == 1) {
-		enqueue_slot_back(h, cached_free_slots, slot_id);
+	else if (ret == 1)
 		return ret_val;
-	}
 
 	/* Also search secondary bucket to get better occupancy */
 	ret = rte_hash_cuckoo_make_space_mw(h, sec_bkt, prim_bkt, key, data,
@@ -1041,16 +1255,12 @@ __rte_hash_add_key_with_hash(const struct rte_hash *h, const void *key,
 
 	if (ret == 0)
 		return slot_id - 1;
-	else if (ret == 1) {
-		enqueue_slot_back(h, cached_free_slots, slot_id);
+	else if (ret == 1)
 		return ret_val;
-	}
 
 	/* if ext table not enabled, we failed the insertion */
-	if (!h->ext_table_support) {
-		enqueue_slot_back(h, cached_free_slots, slot_id);
+	if (!h->ext_table_support)
 		return ret;
-	}
 
 	/* Now we need to go through the extendable bucket. Protection is needed
 	 * to protect all extendable bucket processes.
@@ -1058,17 +1268,13 @@ __rte_hash_add_key_with_hash(const struct rte_hash *h, const void *key,
 	__hash_rw_writer_lock(h);
 	/* We check for duplicates again since could be inserted before the lock */
 	ret = search_and_update(h, data, key, prim_bkt, short_sig);
-	if (ret != -1) {
-		enqueue_slot_back(h, cached_free_slots, slot_id);
+	if (ret != -1)
 		goto failure;
-	}
 
 	FOR_EACH_BUCKET(cur_bkt, sec_bkt) {
 		ret = search_and_update(h, data, key, cur_bkt, short_sig);
-		if (ret != -1) {
-			enqueue_slot_back(h, cached_free_slots, slot_id);
+		if (ret != -1)
 			goto failure;
-		}
 	}
 
 	/* Search sec and ext buckets to find an empty entry to insert. */
@@ -1118,50 +1324,170 @@ __rte_hash_add_key_with_hash(const struct rte_hash *h, const void *key,
 failure:
 	__hash_rw_writer_unlock(h);
 	return ret;
-
 }
 
-int32_t
-rte_hash_add_key_with_hash(const struct rte_hash *h,
-			const void *key, hash_sig_t sig)
+/* Get a free key store slot, from the lcore cache if there is one.
+ * Return EMPTY_SLOT if there is none left.
+ */
+static inline uint32_t
+alloc_slot(const struct rte_hash *h, struct lcore_cache *cached_free_slots)
 {
-	RETURN_IF_TRUE(((h == NULL) || (key == NULL)), -EINVAL);
-	return __rte_hash_add_key_with_hash(h, key, sig, 0);
-}
+	unsigned int n_slots;
+	uint32_t slot_id;
 
-int32_t
-rte_hash_add_key(const struct rte_hash *h, const void *key)
-{
-	RETURN_IF_TRUE(((h == NULL) || (key == NULL)), -EINVAL);
-	return __rte_hash_add_key_with_hash(h, key, rte_hash_hash(h, key), 0);
-}
+	if (h->use_local_cache) {
+		/* Try to get a free slot from the local cache */
+		if (cached_free_slots->len == 0) {
+			/* Need to get another burst of free slots from global ring */
+			n_slots = rte_ring_mc_dequeue_burst_elem(h->free_slots,
+					cached_free_slots->objs,
+					sizeof(uint32_t),
+					LCORE_CACHE_SIZE, NULL);
+			if (n_slots == 0)
+				return EMPTY_SLOT;
 
-int
-rte_hash_add_key_with_hash_data(const struct rte_hash *h,
-			const void *key, hash_sig_t sig, void *data)
-{
-	int ret;
+			cached_free_slots->len += n_slots;
+		}
 
-	RETURN_IF_TRUE(((h == NULL) || (key == NULL)), -EINVAL);
-	ret = __rte_hash_add_key_with_hash(h, key, sig, data);
-	if (ret >= 0)
-		return 0;
-	else
-		return ret;
+		/* Get a free slot from the local cache */
+		cached_free_slots->len--;
+		slot_id = cached_free_slots->objs[cached_free_slots->len];
+	} else {
+		if (rte_ring_sc_dequeue_elem(h->free_slots, &slot_id,
+						sizeof(uint32_t)) != 0)
+			return EMPTY_SLOT;
+	}
+
+	return slot_id;
 }
 
-int
-rte_hash_add_key_data(const struct rte_hash *h, const void *key, void *data)
+static inline int32_t
+__rte_hash_add_key_with_hash(const struct rte_hash *h, const void *key,
+						hash_sig_t sig, void *data)
 {
+	uint16_t short_sig;
+	uint32_t prim_bucket_idx, sec_bucket_idx;
+	struct rte_hash_bucket *prim_bkt, *sec_bkt, *cur_bkt;
+	struct rte_hash_key *new_k, *keys = h->key_store;
+	uint32_t slot_id;
 	int ret;
+	struct lcore_cache *cached_free_slots = NULL;
 
-	RETURN_IF_TRUE(((h == NULL) || (key == NULL)), -EINVAL);
+	short_sig = get_short_sig(sig);
+	prim_bucket_idx = get_prim_bucket_index(h, sig);
+	sec_bucket_idx = get_alt_bucket_index(h, prim_bucket_idx, short_sig);
+	prim_bkt = &h->buckets[prim_bucket_idx];
+	sec_bkt = &h->buckets[sec_bucket_idx];
+	rte_prefetch0(prim_bkt);
+	rte_prefetch0(sec_bkt);
 
-	ret = __rte_hash_add_key_with_hash(h, key, rte_hash_hash(h, key), data);
-	if (ret >= 0)
-		return 0;
-	else
-		return ret;
+	/* Check if key is already inserted in primary location */
+	__hash_rw_writer_lock(h);
+	ret = search_and_update(h, data, key, prim_bkt, short_sig);
+	if (ret != -1) {
+		__hash_rw_writer_unlock(h);
+		return ret;
+	}
+
+	/* Check if key is already inserted in secondary location */
+	FOR_EACH_BUCKET(cur_bkt, sec_bkt) {
+		ret = search_and_update(h, data, key, cur_bkt, short_sig);
+		if (ret != -1) {
+			__hash_rw_writer_unlock(h);
+			return ret;
+		}
+	}
+
+	/* Check if key is still in the buckets being migrated */
+	if (unlikely(h->old_buckets != NULL)) {
+		ret = search_and_update_old(h, data, key, prim_bucket_idx,
+					short_sig);
+		if (ret != -1) {
+			__hash_rw_writer_unlock(h);
+			return ret;
+		}
+	}
+
+	__hash_rw_writer_unlock(h);
+
+	/* Did not find a match, so get a new slot for storing the new key */
+	if (h->use_local_cache)
+		cached_free_slots = &h->local_free_slots[rte_lcore_id()];
+	slot_id = alloc_slot(h, cached_free_slots);
+	if (slot_id == EMPTY_SLOT) {
+		/* Key indexes of deleted entries may be waiting for
+		 * the readers to go through a grace period.
+		 */
+		if (__hash_rcu_qsbr_reclaim(h) != 0)
+			slot_id = alloc_slot(h, cached_free_slots);
+		if (slot_id == EMPTY_SLOT)
+			return -ENOSPC;
+	}
+
+	new_k = RTE_PTR_ADD(keys, slot_id * h->key_entry_size);
+	/* The store to application data (by the application) at *data should
+	 * not leak after the store of pdata in the key store. i.e. pdata is
+	 * the guard variable. Release the application data to the readers.
+	 */
+	__atomic_store_n(&new_k->pdata,
+		data,
+		__ATOMIC_RELEASE);
+	/* Copy key */
+	memcpy(new_k->key, key, h->key_len);
+	/* Stamp the slot before the key becomes visible to aging scans */
+	if (h->last_hit != NULL)
+		__atomic_store_n(&h->last_hit[slot_id], __hash_age_now(),
+				__ATOMIC_RELAXED);
+
+	ret = __rte_hash_add_key_displace(h, key, data, short_sig,
+				prim_bucket_idx, sec_bucket_idx, slot_id);
+	if (ret != (int32_t)(slot_id - 1))
+		enqueue_slot_back(h, cached_free_slots, slot_id);
+
+	return ret;
+}
+
+int32_t
+rte_hash_add_key_with_hash(const struct rte_hash *h,
+			const void *key, hash_sig_t sig)
+{
+	RETURN_IF_TRUE(((h == NULL) || (key == NULL)), -EINVAL);
+	return __rte_hash_add_key_with_hash(h, key, sig, 0);
+}
+
+int32_t
+rte_hash_add_key(const struct rte_hash *h, const void *key)
+{
+	RETURN_IF_TRUE(((h == NULL) || (key == NULL)), -EINVAL);
+	return __rte_hash_add_key_with_hash(h, key, rte_hash_hash(h, key), 0);
+}
+
+int
+rte_hash_add_key_with_hash_data(const struct rte_hash *h,
+			const void *key, hash_sig_t sig, void *data)
+{
+	int ret;
+
+	RETURN_IF_TRUE(((h == NULL) || (key == NULL)), -EINVAL);
+	ret = __rte_hash_add_key_with_hash(h, key, sig, data);
+	if (ret >= 0)
+		return 0;
+	else
+		return ret;
+}
+
+int
+rte_hash_add_key_data(const struct rte_hash *h, const void *key, void *data)
+{
+	int ret;
+
+	RETURN_IF_TRUE(((h == NULL) || (key == NULL)), -EINVAL);
+
+	ret = __rte_hash_add_key_with_hash(h, key, rte_hash_hash(h, key), data);
+	if (ret >= 0)
+		return 0;
+	else
+		return ret;
 }
 
 /* Search one bucket to find the match key - uses rw lock */
@@ -1200,7 +1526,7 @@ search_one_bucket_lf(const struct rte_hash *h, const void *key, uint16_t sig,
 {
 	int i;
 	uint32_t key_idx;
-	struct rte_hash_key *k, *keys = h->key_store;
+	struct rte_hash_key *k;
 
 	for (i = 0; i < RTE_HASH_BUCKET_ENTRIES; i++) {
 		/* Signature comparison is done before the acquire-load
@@ -1214,7 +1540,11 @@ search_one_bucket_lf(const struct rte_hash *h, const void *key, uint16_t sig,
 			key_idx = __atomic_load_n(&bkt->key_idx[i],
 					  __ATOMIC_ACQUIRE);
 			if (key_idx != EMPTY_SLOT) {
-				k = (struct rte_hash_key *) ((char *)keys +
+				/* The key store is loaded after the key
+				 * index, so that the key store grown by a
+				 * resize is seen along with the new indexes.
+				 */
+				k = (struct rte_hash_key *) ((char *)h->key_store +
 						key_idx * h->key_entry_size);
 
 				if (rte_hash_cmp_eq(key, k->key, h) == 0) {
@@ -1276,19 +1606,48 @@ __rte_hash_lookup_with_hash_l(const struct rte_hash *h, const void *key,
 	return -ENOENT;
 }
 
+/* Search the primary and secondary buckets of a key in a bucket table */
 static inline int32_t
-__rte_hash_lookup_with_hash_lf(const struct rte_hash *h, const void *key,
-					hash_sig_t sig, void **data)
+search_buckets_lf(const struct rte_hash *h, const void *key, hash_sig_t sig,
+		void **data, struct rte_hash_bucket *buckets,
+		uint32_t bucket_bitmask)
 {
 	uint32_t prim_bucket_idx, sec_bucket_idx;
 	struct rte_hash_bucket *bkt, *cur_bkt;
-	uint32_t cnt_b, cnt_a;
-	int ret;
 	uint16_t short_sig;
+	int32_t ret;
 
 	short_sig = get_short_sig(sig);
-	prim_bucket_idx = get_prim_bucket_index(h, sig);
-	sec_bucket_idx = get_alt_bucket_index(h, prim_bucket_idx, short_sig);
+	prim_bucket_idx = sig & bucket_bitmask;
+	sec_bucket_idx = (prim_bucket_idx ^ short_sig) & bucket_bitmask;
+
+	/* Check if key is in primary location */
+	bkt = &buckets[prim_bucket_idx];
+	ret = search_one_bucket_lf(h, key, short_sig, data, bkt);
+	if (ret != -1)
+		return ret;
+	/* Calculate secondary hash */
+	bkt = &buckets[sec_bucket_idx];
+
+	/* Check if key is in secondary location */
+	FOR_EACH_BUCKET(cur_bkt, bkt) {
+		ret = search_one_bucket_lf(h, key, short_sig,
+					data, cur_bkt);
+		if (ret != -1)
+			return ret;
+	}
+
+	return -1;
+}
+
+static inline int32_t
+__rte_hash_lookup_with_hash_lf(const struct rte_hash *h, const void *key,
+					hash_sig_t sig, void **data)
+{
+	struct rte_hash_bucket *buckets, *old_buckets;
+	uint32_t bucket_bitmask;
+	uint32_t cnt_b, cnt_a;
+	int ret;
 
 	do {
 		/* Load the table change counter before the lookup
@@ -1298,18 +1657,23 @@ __rte_hash_lookup_with_hash_lf(const struct rte_hash *h, const void *key,
 		cnt_b = __atomic_load_n(h->tbl_chng_cnt,
 				__ATOMIC_ACQUIRE);
 
-		/* Check if key is in primary location */
-		bkt = &h->buckets[prim_bucket_idx];
-		ret = search_one_bucket_lf(h, key, short_sig, data, bkt);
+		/* A resize stores the new buckets before their bitmask, so
+		 * the bucket index never goes beyond the buckets loaded.
+		 */
+		bucket_bitmask = __atomic_load_n(&h->bucket_bitmask,
+				__ATOMIC_ACQUIRE);
+		buckets = __atomic_load_n(&h->buckets, __ATOMIC_ACQUIRE);
+		ret = search_buckets_lf(h, key, sig, data, buckets,
+				bucket_bitmask);
 		if (ret != -1)
 			return ret;
-		/* Calculate secondary hash */
-		bkt = &h->buckets[sec_bucket_idx];
 
-		/* Check if key is in secondary location */
-		FOR_EACH_BUCKET(cur_bkt, bkt) {
-			ret = search_one_bucket_lf(h, key, short_sig,
-						data, cur_bkt);
+		/* Keys not migrated yet by a resize are in the old buckets */
+		old_buckets = __atomic_load_n(&h->old_buckets,
+				__ATOMIC_ACQUIRE);
+		if (unlikely(old_buckets != NULL)) {
+			ret = search_buckets_lf(h, key, sig, data, old_buckets,
+					h->old_bucket_bitmask);
 			if (ret != -1)
 				return ret;
 		}
@@ -1334,7 +1698,7 @@ __rte_hash_lookup_with_hash_lf(const struct rte_hash *h, const void *key,
 }
 
 static inline int32_t
-__rte_hash_lookup_with_hash(const struct rte_hash *h, const void *key,
+__rte_hash_lookup_with_hash_noage(const struct rte_hash *h, const void *key,
 					hash_sig_t sig, void **data)
 {
 	if (h->readwrite_concur_lf_support)
@@ -1343,6 +1707,19 @@ __rte_hash_lookup_with_hash(const struct rte_hash *h, const void *key,
 		return __rte_hash_lookup_with_hash_l(h, key, sig, data);
 }
 
+static inline int32_t
+__rte_hash_lookup_with_hash(const struct rte_hash *h, const void *key,
+					hash_sig_t sig, void **data)
+{
+	int32_t ret;
+
+	ret = __rte_hash_lookup_with_hash_noage(h, key, sig, data);
+	if (h->last_hit != NULL && ret >= 0)
+		__hash_age_touch(h, ret + 1, __hash_age_now());
+
+	return ret;
+}
+
 int32_t
 rte_hash_lookup_with_hash(const struct rte_hash *h,
 			const void *key, hash_sig_t sig)
@@ -1489,23 +1866,20 @@ search_and_remove(const struct rte_hash *h, const void *key,
 	return -1;
 }
 
+/* Remove a key from its primary or secondary bucket and recycle an
+ * extendable bucket left empty. Writer is expected to hold the lock
+ * while calling this function.
+ */
 static inline int32_t
-__rte_hash_del_key_with_hash(const struct rte_hash *h, const void *key,
-						hash_sig_t sig)
+__rte_hash_del_key_locked(const struct rte_hash *h, const void *key,
+			uint16_t short_sig, struct rte_hash_bucket *prim_bkt,
+			struct rte_hash_bucket *sec_bkt)
 {
-	uint32_t prim_bucket_idx, sec_bucket_idx;
-	struct rte_hash_bucket *prim_bkt, *sec_bkt, *prev_bkt, *last_bkt;
+	struct rte_hash_bucket *prev_bkt, *last_bkt;
 	struct rte_hash_bucket *cur_bkt;
 	int pos;
 	int32_t ret, i;
-	uint16_t short_sig;
 
-	short_sig = get_short_sig(sig);
-	prim_bucket_idx = get_prim_bucket_index(h, sig);
-	sec_bucket_idx = get_alt_bucket_index(h, prim_bucket_idx, short_sig);
-	prim_bkt = &h->buckets[prim_bucket_idx];
-
-	__hash_rw_writer_lock(h);
 	/* look for key in primary bucket */
 	ret = search_and_remove(h, key, prim_bkt, short_sig, &pos);
 	if (ret != -1) {
@@ -1515,9 +1889,6 @@ __rte_hash_del_key_with_hash(const struct rte_hash *h, const void *key,
 		goto return_bkt;
 	}
 
-	/* Calculate secondary hash */
-	sec_bkt = &h->buckets[sec_bucket_idx];
-
 	FOR_EACH_BUCKET(cur_bkt, sec_bkt) {
 		ret = search_and_remove(h, key, cur_bkt, short_sig, &pos);
 		if (ret != -1) {
@@ -1528,15 +1899,13 @@ __rte_hash_del_key_with_hash(const struct rte_hash *h, const void *key,
 		}
 	}
 
-	__hash_rw_writer_unlock(h);
 	return -ENOENT;
 
 /* Search last bucket to see if empty to be recycled */
 return_bkt:
-	if (!last_bkt) {
-		__hash_rw_writer_unlock(h);
+	if (!last_bkt)
 		return ret;
-	}
+
 	while (last_bkt->next) {
 		prev_bkt = last_bkt;
 		last_bkt = last_bkt->next;
@@ -1567,7 +1936,45 @@ __rte_hash_del_key_with_hash(const struct rte_hash *h, const void *key,
 			rte_ring_sp_enqueue_elem(h->free_ext_bkts, &index,
 							sizeof(uint32_t));
 	}
+	return ret;
+}
+
+static inline int32_t
+__rte_hash_del_key_with_hash(const struct rte_hash *h, const void *key,
+						hash_sig_t sig)
+{
+	uint32_t prim_bucket_idx, sec_bucket_idx;
+	struct rte_hash_bucket *old_prim_bkt, *old_sec_bkt;
+	int32_t ret;
+	uint16_t short_sig;
+	int sync_free = 0;
+
+	short_sig = get_short_sig(sig);
+	prim_bucket_idx = get_prim_bucket_index(h, sig);
+	sec_bucket_idx = get_alt_bucket_index(h, prim_bucket_idx, short_sig);
+
+	__hash_rw_writer_lock(h);
+	ret = __rte_hash_del_key_locked(h, key, short_sig,
+			&h->buckets[prim_bucket_idx],
+			&h->buckets[sec_bucket_idx]);
+	if (ret == -ENOENT && unlikely(h->old_buckets != NULL)) {
+		/* Key not migrated yet by a resize */
+		get_old_buckets(h, prim_bucket_idx, short_sig,
+				&old_prim_bkt, &old_sec_bkt);
+		ret = __rte_hash_del_key_locked(h, key, short_sig,
+				old_prim_bkt, old_sec_bkt);
+	}
+	if (ret >= 0 && h->hash_rcu_cfg != NULL)
+		sync_free = __hash_rcu_qsbr_defer(h, ret + 1);
 	__hash_rw_writer_unlock(h);
+
+	if (sync_free) {
+		/* Wait for the readers to be done with the entry */
+		rte_rcu_qsbr_synchronize(h->hash_rcu_cfg->v,
+					RTE_QSBR_THRID_INVALID);
+		__hash_rcu_free_key(h, ret + 1);
+	}
+
 	return ret;
 }
 
@@ -1598,7 +2005,7 @@ rte_hash_get_key_with_position(const struct rte_hash *h, const int32_t position,
 	*key = k->key;
 
 	if (position !=
-	    __rte_hash_lookup_with_hash(h, *key, rte_hash_hash(h, *key),
+	    __rte_hash_lookup_with_hash_noage(h, *key, rte_hash_hash(h, *key),
 					NULL)) {
 		return -ENOENT;
 	}
@@ -1670,6 +2077,7 @@ compare_signatures(uint32_t *prim_hash_matches, uint32_t *sec_hash_matches,
 	/* For match mask the first bit of every two bits indicates the match */
 	switch (sig_cmp_fn) {
 #if defined(RTE_MACHINE_CPUFLAG_SSE2)
+	case RTE_HASH_COMPARE_AVX512:
 	case RTE_HASH_COMPARE_SSE:
 		/* Compare all signatures in the bucket */
 		*prim_hash_matches = _mm_movemask_epi8(_mm_cmpeq_epi16(
@@ -1711,6 +2119,113 @@ compare_signatures(uint32_t *prim_hash_matches, uint32_t *sec_hash_matches,
 	}
 }
 
+/* Compare the signatures of a burst of keys against their buckets */
+static inline void
+compare_signatures_bulk(uint32_t *prim_hash_matches,
+			uint32_t *sec_hash_matches,
+			const struct rte_hash_bucket **prim_bkt,
+			const struct rte_hash_bucket **sec_bkt,
+			const uint16_t *sig, int32_t num_keys,
+			enum rte_hash_sig_compare_function sig_cmp_fn)
+{
+	int32_t i;
+
+#if defined(CC_AVX512_SUPPORT)
+	if (sig_cmp_fn == RTE_HASH_COMPARE_AVX512) {
+		rte_hash_compare_signatures_avx512(prim_hash_matches,
+			sec_hash_matches, prim_bkt, sec_bkt, sig, num_keys);
+		return;
+	}
+#endif
+	for (i = 0; i < num_keys; i++)
+		compare_signatures(&prim_hash_matches[i],
+			&sec_hash_matches[i], prim_bkt[i], sec_bkt[i],
+			sig[i], sig_cmp_fn);
+}
+
+#if defined(CC_AVX512_SUPPORT)
+/*
+ * Compare the keys of a burst of 16 or 32 bytes with the key of their
+ * first signature hit, several keys at a time. The first hits are taken
+ * out of the hit masks, so only the next ones are left to the key
+ * compare loop. Bit i of the result is set if key i matched, its key
+ * index then being in key_idx[i].
+ */
+static inline uint64_t
+compare_first_hits_avx512(const struct rte_hash *h, const void **keys,
+			int32_t num_keys,
+			const struct rte_hash_bucket **prim_bkt,
+			const struct rte_hash_bucket **sec_bkt,
+			uint32_t *prim_hitmask, uint32_t *sec_hitmask,
+			uint32_t *key_idx)
+{
+	const void *slot_keys[RTE_HASH_LOOKUP_BULK_MAX];
+	const struct rte_hash_bucket *bkt;
+	uint32_t *hitmask, hit_index;
+	uint64_t valid = 0;
+	int32_t i;
+
+	for (i = 0; i < num_keys; i++) {
+		/* keys without a candidate are compared with themselves */
+		slot_keys[i] = keys[i];
+		if (prim_hitmask[i]) {
+			hitmask = &prim_hitmask[i];
+			bkt = prim_bkt[i];
+		} else if (sec_hitmask[i]) {
+			hitmask = &sec_hitmask[i];
+			bkt = sec_bkt[i];
+		} else
+			continue;
+
+		hit_index = __builtin_ctzl(*hitmask) >> 1;
+		*hitmask &= ~(3U << (hit_index << 1));
+		key_idx[i] = __atomic_load_n(&bkt->key_idx[hit_index],
+				__ATOMIC_ACQUIRE);
+		/* key index 0 is the dummy slot */
+		if (key_idx[i] == 0)
+			continue;
+		slot_keys[i] = ((const struct rte_hash_key *)(
+				(const char *)h->key_store +
+				key_idx[i] * h->key_entry_size))->key;
+		valid |= 1ULL << i;
+	}
+
+	return rte_hash_keys_cmp_eq_avx512(slot_keys, keys, num_keys,
+			h->key_len) & valid;
+}
+#endif
+
+/*
+ * Compare the keys of a burst with their first signature hit at once, if
+ * the key size and the CPU allow it. Returns the mask of matching keys,
+ * see compare_first_hits_avx512().
+ */
+static inline uint64_t
+compare_first_hits(const struct rte_hash *h, const void **keys,
+			int32_t num_keys,
+			const struct rte_hash_bucket **prim_bkt,
+			const struct rte_hash_bucket **sec_bkt,
+			uint32_t *prim_hitmask, uint32_t *sec_hitmask,
+			uint32_t *key_idx)
+{
+#if defined(CC_AVX512_SUPPORT)
+	if (h->cmp_jump_table_idx == KEY_16_BYTES_AVX512 ||
+			h->cmp_jump_table_idx == KEY_32_BYTES_AVX512)
+		return compare_first_hits_avx512(h, keys, num_keys, prim_bkt,
+				sec_bkt, prim_hitmask, sec_hitmask, key_idx);
+#else
+	RTE_SET_USED(h);
+	RTE_SET_USED(keys);
+	RTE_SET_USED(num_keys);
+	RTE_SET_USED(prim_bkt);
+	RTE_SET_USED(sec_bkt);
+	RTE_SET_USED(prim_hitmask);
+	RTE_SET_USED(sec_hitmask);
+	RTE_SET_USED(key_idx);
+#endif
+	return 0;
+}
+
 #define PREFETCH_OFFSET 4
 static inline void
 __rte_hash_lookup_bulk_l(const struct rte_hash *h, const void **keys,
@@ -1723,11 +2238,13 @@ __rte_hash_lookup_bulk_l(const struct rte_hash *h, const void **keys,
 	uint32_t prim_hash[RTE_HASH_LOOKUP_BULK_MAX];
 	uint32_t prim_index[RTE_HASH_LOOKUP_BULK_MAX];
 	uint32_t sec_index[RTE_HASH_LOOKUP_BULK_MAX];
-	uint16_t sig[RTE_HASH_LOOKUP_BULK_MAX];
+	uint16_t sig[RTE_HASH_LOOKUP_BULK_MAX] = {0};
 	const struct rte_hash_bucket *primary_bkt[RTE_HASH_LOOKUP_BULK_MAX];
 	const struct rte_hash_bucket *secondary_bkt[RTE_HASH_LOOKUP_BULK_MAX];
 	uint32_t prim_hitmask[RTE_HASH_LOOKUP_BULK_MAX] = {0};
 	uint32_t sec_hitmask[RTE_HASH_LOOKUP_BULK_MAX] = {0};
+	uint32_t first_idx[RTE_HASH_LOOKUP_BULK_MAX];
+	uint64_t first_hits;
 	struct rte_hash_bucket *cur_bkt, *next_bkt;
 
 	/* Prefetch first keys */
@@ -1772,11 +2289,10 @@ __rte_hash_lookup_bulk_l(const struct rte_hash *h, const void **keys,
 	__hash_rw_reader_lock(h);
 
 	/* Compare signatures and prefetch key slot of first hit */
-	for (i = 0; i < num_keys; i++) {
-		compare_signatures(&prim_hitmask[i], &sec_hitmask[i],
-			primary_bkt[i], secondary_bkt[i],
-			sig[i], h->sig_cmp_fn);
+	compare_signatures_bulk(prim_hitmask, sec_hitmask,
+		primary_bkt, secondary_bkt, sig, num_keys, h->sig_cmp_fn);
 
+	for (i = 0; i < num_keys; i++) {
 		if (prim_hitmask[i]) {
 			uint32_t first_hit =
 					__builtin_ctzl(prim_hitmask[i])
@@ -1805,9 +2321,24 @@ __rte_hash_lookup_bulk_l(const struct rte_hash *h, const void **keys,
 		}
 	}
 
+	first_hits = compare_first_hits(h, keys, num_keys, primary_bkt,
+			secondary_bkt, prim_hitmask, sec_hitmask, first_idx);
+
 	/* Compare keys, first hits in primary first */
 	for (i = 0; i < num_keys; i++) {
 		positions[i] = -ENOENT;
+		if (first_hits & (1ULL << i)) {
+			const struct rte_hash_key *key_slot =
+				(const struct rte_hash_key *)(
+				(const char *)h->key_store +
+				first_idx[i] * h->key_entry_size);
+
+			if (data != NULL)
+				data[i] = key_slot->pdata;
+			hits |= 1ULL << i;
+			positions[i] = first_idx[i] - 1;
+			continue;
+		}
 		while (prim_hitmask[i]) {
 			uint32_t hit_index =
 					__builtin_ctzl(prim_hitmask[i])
@@ -1913,14 +2444,24 @@ __rte_hash_lookup_bulk_lf(const struct rte_hash *h, const void **keys,
 	uint32_t prim_hash[RTE_HASH_LOOKUP_BULK_MAX];
 	uint32_t prim_index[RTE_HASH_LOOKUP_BULK_MAX];
 	uint32_t sec_index[RTE_HASH_LOOKUP_BULK_MAX];
-	uint16_t sig[RTE_HASH_LOOKUP_BULK_MAX];
+	uint16_t sig[RTE_HASH_LOOKUP_BULK_MAX] = {0};
 	const struct rte_hash_bucket *primary_bkt[RTE_HASH_LOOKUP_BULK_MAX];
 	const struct rte_hash_bucket *secondary_bkt[RTE_HASH_LOOKUP_BULK_MAX];
 	uint32_t prim_hitmask[RTE_HASH_LOOKUP_BULK_MAX] = {0};
 	uint32_t sec_hitmask[RTE_HASH_LOOKUP_BULK_MAX] = {0};
+	uint32_t first_idx[RTE_HASH_LOOKUP_BULK_MAX];
+	uint64_t first_hits;
 	struct rte_hash_bucket *cur_bkt, *next_bkt;
+	struct rte_hash_bucket *buckets;
+	uint32_t bucket_bitmask;
 	uint32_t cnt_b, cnt_a;
 
+	/* A resize stores the new buckets before their bitmask, so the
+	 * bucket indexes never go beyond the buckets loaded.
+	 */
+	bucket_bitmask = __atomic_load_n(&h->bucket_bitmask, __ATOMIC_ACQUIRE);
+	buckets = __atomic_load_n(&h->buckets, __ATOMIC_ACQUIRE);
+
 	/* Prefetch first keys */
 	for (i = 0; i < PREFETCH_OFFSET && i < num_keys; i++)
 		rte_prefetch0(keys[i]);
@@ -1935,11 +2476,12 @@ __rte_hash_lookup_bulk_lf(const struct rte_hash *h, const void **keys,
 		prim_hash[i] = rte_hash_hash(h, keys[i]);
 
 		sig[i] = get_short_sig(prim_hash[i]);
-		prim_index[i] = get_prim_bucket_index(h, prim_hash[i]);
-		sec_index[i] = get_alt_bucket_index(h, prim_index[i], sig[i]);
+		prim_index[i] = prim_hash[i] & bucket_bitmask;
+		sec_index[i] = (prim_index[i] ^ sig[i]) &
+				bucket_bitmask;
 
-		primary_bkt[i] = &h->buckets[prim_index[i]];
-		secondary_bkt[i] = &h->buckets[sec_index[i]];
+		primary_bkt[i] = &buckets[prim_index[i]];
+		secondary_bkt[i] = &buckets[sec_index[i]];
 
 		rte_prefetch0(primary_bkt[i]);
 		rte_prefetch0(secondary_bkt[i]);
@@ -1950,11 +2492,12 @@ __rte_hash_lookup_bulk_lf(const struct rte_hash *h, const void **keys,
 		prim_hash[i] = rte_hash_hash(h, keys[i]);
 
 		sig[i] = get_short_sig(prim_hash[i]);
-		prim_index[i] = get_prim_bucket_index(h, prim_hash[i]);
-		sec_index[i] = get_alt_bucket_index(h, prim_index[i], sig[i]);
+		prim_index[i] = prim_hash[i] & bucket_bitmask;
+		sec_index[i] = (prim_index[i] ^ sig[i]) &
+				bucket_bitmask;
 
-		primary_bkt[i] = &h->buckets[prim_index[i]];
-		secondary_bkt[i] = &h->buckets[sec_index[i]];
+		primary_bkt[i] = &buckets[prim_index[i]];
+		secondary_bkt[i] = &buckets[sec_index[i]];
 
 		rte_prefetch0(primary_bkt[i]);
 		rte_prefetch0(secondary_bkt[i]);
@@ -1972,11 +2515,11 @@ __rte_hash_lookup_bulk_lf(const struct rte_hash *h, const void **keys,
 					__ATOMIC_ACQUIRE);
 
 		/* Compare signatures and prefetch key slot of first hit */
-		for (i = 0; i < num_keys; i++) {
-			compare_signatures(&prim_hitmask[i], &sec_hitmask[i],
-				primary_bkt[i], secondary_bkt[i],
-				sig[i], h->sig_cmp_fn);
+		compare_signatures_bulk(prim_hitmask, sec_hitmask,
+			primary_bkt, secondary_bkt, sig, num_keys,
+			h->sig_cmp_fn);
 
+		for (i = 0; i < num_keys; i++) {
 			if (prim_hitmask[i]) {
 				uint32_t first_hit =
 						__builtin_ctzl(prim_hitmask[i])
@@ -2005,8 +2548,26 @@ __rte_hash_lookup_bulk_lf(const struct rte_hash *h, const void **keys,
 			}
 		}
 
+		first_hits = compare_first_hits(h, keys, num_keys,
+				primary_bkt, secondary_bkt, prim_hitmask,
+				sec_hitmask, first_idx);
+
 		/* Compare keys, first hits in primary first */
 		for (i = 0; i < num_keys; i++) {
+			if (first_hits & (1ULL << i)) {
+				const struct rte_hash_key *key_slot =
+					(const struct rte_hash_key *)(
+					(const char *)h->key_store +
+					first_idx[i] * h->key_entry_size);
+
+				if (data != NULL)
+					data[i] = __atomic_load_n(
+						&key_slot->pdata,
+						__ATOMIC_ACQUIRE);
+				hits |= 1ULL << i;
+				positions[i] = first_idx[i] - 1;
+				continue;
+			}
 			while (prim_hitmask[i]) {
 				uint32_t hit_index =
 						__builtin_ctzl(prim_hitmask[i])
@@ -2120,6 +2681,26 @@ __rte_hash_lookup_bulk_lf(const struct rte_hash *h, const void **keys,
 					__ATOMIC_ACQUIRE);
 	} while (cnt_b != cnt_a);
 
+	/* Keys missed while a resize is in progress, or because one was
+	 * completed during the lookup, are looked up again in both the old
+	 * and the new buckets.
+	 */
+	if (unlikely(__atomic_load_n(&h->old_buckets, __ATOMIC_ACQUIRE) !=
+			NULL || __atomic_load_n(&h->bucket_bitmask,
+				__ATOMIC_RELAXED) != bucket_bitmask)) {
+		for (i = 0; i < num_keys; i++) {
+			if ((hits & (1ULL << i)) != 0)
+				continue;
+			ret = __rte_hash_lookup_with_hash_lf(h, keys[i],
+					prim_hash[i],
+					(data != NULL) ? &data[i] : NULL);
+			if (ret >= 0) {
+				positions[i] = ret;
+				hits |= 1ULL << i;
+			}
+		}
+	}
+
 	if (hit_mask != NULL)
 		*hit_mask = hits;
 }
@@ -2129,12 +2710,22 @@ __rte_hash_lookup_bulk(const struct rte_hash *h, const void **keys,
 			int32_t num_keys, int32_t *positions,
 			uint64_t *hit_mask, void *data[])
 {
+	int32_t i;
+	uint32_t now;
+
 	if (h->readwrite_concur_lf_support)
 		__rte_hash_lookup_bulk_lf(h, keys, num_keys, positions,
 					  hit_mask, data);
 	else
 		__rte_hash_lookup_bulk_l(h, keys, num_keys, positions,
 					 hit_mask, data);
+
+	if (h->last_hit != NULL) {
+		now = __hash_age_now();
+		for (i = 0; i < num_keys; i++)
+			if (positions[i] >= 0)
+				__hash_age_touch(h, positions[i] + 1, now);
+	}
 }
 
 int
@@ -2165,17 +2756,379 @@ rte_hash_lookup_bulk_data(const struct rte_hash *h, const void **keys,
 	return __builtin_popcountl(*hit_mask);
 }
 
-int32_t
-rte_hash_iterate(const struct rte_hash *h, const void **key, void **data, uint32_t *next)
+/*
+ * Calculate signature and bucket locations of a burst of keys, prefetching
+ * keys ahead of the hash calculation and both candidate buckets of each key.
+ */
+static inline void
+__bulk_calc_buckets(const struct rte_hash *h, const void **keys,
+			int32_t num_keys, uint16_t *sig,
+			uint32_t *prim_index, uint32_t *sec_index)
 {
-	uint32_t bucket_idx, idx, position;
-	struct rte_hash_key *next_key;
+	hash_sig_t prim_hash;
+	int32_t i;
+
+	/* Prefetch first keys */
+	for (i = 0; i < PREFETCH_OFFSET && i < num_keys; i++)
+		rte_prefetch0(keys[i]);
+
+	for (i = 0; i < num_keys; i++) {
+		if (i + PREFETCH_OFFSET < num_keys)
+			rte_prefetch0(keys[i + PREFETCH_OFFSET]);
+
+		prim_hash = rte_hash_hash(h, keys[i]);
+
+		sig[i] = get_short_sig(prim_hash);
+		prim_index[i] = get_prim_bucket_index(h, prim_hash);
+		sec_index[i] = get_alt_bucket_index(h, prim_index[i], sig[i]);
+
+		rte_prefetch0(&h->buckets[prim_index[i]]);
+		rte_prefetch0(&h->buckets[sec_index[i]]);
+	}
+}
+
+/* Prefetch key slot of first signature hit of every key in a burst */
+static inline void
+__bulk_prefetch_key_slots(const struct rte_hash *h, int32_t num_keys,
+			const uint16_t *sig, const uint32_t *prim_index,
+			const uint32_t *sec_index)
+{
+	const struct rte_hash_bucket *prim_bkt, *sec_bkt;
+	uint32_t prim_hitmask, sec_hitmask;
+	uint32_t key_idx;
+	int32_t i;
+
+	for (i = 0; i < num_keys; i++) {
+		prim_bkt = &h->buckets[prim_index[i]];
+		sec_bkt = &h->buckets[sec_index[i]];
+		prim_hitmask = 0;
+		sec_hitmask = 0;
+		compare_signatures(&prim_hitmask, &sec_hitmask,
+			prim_bkt, sec_bkt, sig[i], h->sig_cmp_fn);
+
+		if (prim_hitmask)
+			key_idx = prim_bkt->key_idx[
+					__builtin_ctzl(prim_hitmask) >> 1];
+		else if (sec_hitmask)
+			key_idx = sec_bkt->key_idx[
+					__builtin_ctzl(sec_hitmask) >> 1];
+		else
+			continue;
+
+		rte_prefetch0((const char *)h->key_store +
+				key_idx * h->key_entry_size);
+	}
+}
+
+/* Get up to @n free key store slots, refilling the lcore cache if needed */
+static inline unsigned int
+alloc_slots_bulk(const struct rte_hash *h,
+		struct lcore_cache *cached_free_slots,
+		uint32_t *slot_ids, unsigned int n)
+{
+	unsigned int i, n_slots;
+
+	if (!h->use_local_cache)
+		return rte_ring_sc_dequeue_burst_elem(h->free_slots, slot_ids,
+						sizeof(uint32_t), n, NULL);
+
+	for (i = 0; i < n; i++) {
+		if (cached_free_slots->len == 0) {
+			/* Need to get another burst of free slots from global ring */
+			n_slots = rte_ring_mc_dequeue_burst_elem(h->free_slots,
+					cached_free_slots->objs,
+					sizeof(uint32_t),
+					LCORE_CACHE_SIZE, NULL);
+			if (n_slots == 0)
+				break;
+
+			cached_free_slots->len += n_slots;
+		}
+
+		cached_free_slots->len--;
+		slot_ids[i] = cached_free_slots->objs[cached_free_slots->len];
+	}
+
+	return i;
+}
+
+/* Give back key store slots not consumed by a bulk add */
+static inline void
+free_slots_bulk(const struct rte_hash *h,
+		struct lcore_cache *cached_free_slots,
+		const uint32_t *slot_ids, unsigned int n)
+{
+	unsigned int i, n_slots;
+
+	if (!h->use_local_cache) {
+		rte_ring_sp_enqueue_burst_elem(h->free_slots, slot_ids,
+						sizeof(uint32_t), n, NULL);
+		return;
+	}
+
+	for (i = 0; i < n; i++) {
+		/* Cache full, need to free it. */
+		if (cached_free_slots->len == LCORE_CACHE_SIZE) {
+			/* Need to enqueue the free slots in global ring. */
+			n_slots = rte_ring_mp_enqueue_burst_elem(h->free_slots,
+						cached_free_slots->objs,
+						sizeof(uint32_t),
+						LCORE_CACHE_SIZE, NULL);
+			cached_free_slots->len -= n_slots;
+		}
+		cached_free_slots->objs[cached_free_slots->len] = slot_ids[i];
+		cached_free_slots->len++;
+	}
+}
+
+/* Fill the first empty entry of a bucket without pushing anything around.
+ * Writer holds the lock before calling this.
+ * Return 0 on success, -1 if the bucket is full.
+ */
+static inline int
+bucket_insert_empty(struct rte_hash_bucket *bkt, uint16_t sig,
+			uint32_t new_idx)
+{
+	unsigned int i;
+
+	for (i = 0; i < RTE_HASH_BUCKET_ENTRIES; i++) {
+		if (bkt->key_idx[i] == EMPTY_SLOT) {
+			bkt->sig_current[i] = sig;
+			/* Store to signature and key should not
+			 * leak after the store to key_idx. i.e.
+			 * key_idx is the guard variable for signature
+			 * and key.
+			 */
+			__atomic_store_n(&bkt->key_idx[i],
+					 new_idx,
+					 __ATOMIC_RELEASE);
+			return 0;
+		}
+	}
+	return -1;
+}
+
+static inline void
+__rte_hash_add_key_bulk(const struct rte_hash *h, const void **keys,
+			void **data, int32_t num_keys, int32_t *positions)
+{
+	uint16_t sig[RTE_HASH_LOOKUP_BULK_MAX];
+	uint32_t prim_index[RTE_HASH_LOOKUP_BULK_MAX];
+	uint32_t sec_index[RTE_HASH_LOOKUP_BULK_MAX];
+	uint32_t slot_ids[RTE_HASH_LOOKUP_BULK_MAX];
+	uint32_t pending_slot[RTE_HASH_LOOKUP_BULK_MAX];
+	int32_t pending_key[RTE_HASH_LOOKUP_BULK_MAX];
+	struct rte_hash_bucket *prim_bkt, *sec_bkt, *cur_bkt;
+	struct rte_hash_key *new_k, *keys_store = h->key_store;
+	struct lcore_cache *cached_free_slots = NULL;
+	unsigned int n_slots, next_slot = 0, n_pending = 0, n_unused;
+	uint32_t slot_id, now = 0;
+	void *key_data;
+	int32_t i, ret;
+	unsigned int j;
+
+	__bulk_calc_buckets(h, keys, num_keys, sig, prim_index, sec_index);
+
+	/* Grab key store slots for the whole burst upfront. Slots not
+	 * needed because the key already exists are given back at the end.
+	 */
+	if (h->use_local_cache)
+		cached_free_slots = &h->local_free_slots[rte_lcore_id()];
+	n_slots = alloc_slots_bulk(h, cached_free_slots, slot_ids, num_keys);
+	if (n_slots < (unsigned int)num_keys && __hash_rcu_qsbr_reclaim(h) != 0)
+		n_slots += alloc_slots_bulk(h, cached_free_slots,
+				&slot_ids[n_slots], num_keys - n_slots);
+	for (j = 0; j < n_slots; j++)
+		rte_prefetch0(RTE_PTR_ADD(keys_store,
+				slot_ids[j] * h->key_entry_size));
+
+	__bulk_prefetch_key_slots(h, num_keys, sig, prim_index, sec_index);
+
+	if (h->last_hit != NULL)
+		now = __hash_age_now();
+
+	/* Update existing keys and fill empty entries of primary or
+	 * secondary bucket, taking the writer lock once for the burst.
+	 * Keys for which both buckets are full are left for cuckoo
+	 * displacement.
+	 */
+	__hash_rw_writer_lock(h);
+	for (i = 0; i < num_keys; i++) {
+		key_data = (data != NULL) ? data[i] : NULL;
+		prim_bkt = &h->buckets[prim_index[i]];
+		sec_bkt = &h->buckets[sec_index[i]];
+
+		ret = search_and_update(h, key_data, keys[i], prim_bkt, sig[i]);
+		if (ret == -1) {
+			FOR_EACH_BUCKET(cur_bkt, sec_bkt) {
+				ret = search_and_update(h, key_data, keys[i],
+							cur_bkt, sig[i]);
+				if (ret != -1)
+					break;
+			}
+		}
+		if (ret == -1 && unlikely(h->old_buckets != NULL))
+			ret = search_and_update_old(h, key_data, keys[i],
+						prim_index[i], sig[i]);
+		if (ret != -1) {
+			positions[i] = ret;
+			continue;
+		}
+
+		if (next_slot == n_slots) {
+			positions[i] = -ENOSPC;
+			continue;
+		}
+
+		slot_id = slot_ids[next_slot++];
+		new_k = RTE_PTR_ADD(keys_store, slot_id * h->key_entry_size);
+		/* The store to application data (by the application) at
+		 * *data should not leak after the store of pdata in the
+		 * key store. i.e. pdata is the guard variable. Release the
+		 * application data to the readers.
+		 */
+		__atomic_store_n(&new_k->pdata,
+			key_data,
+			__ATOMIC_RELEASE);
+		/* Copy key */
+		memcpy(new_k->key, keys[i], h->key_len);
+		if (h->last_hit != NULL)
+			__atomic_store_n(&h->last_hit[slot_id], now,
+					__ATOMIC_RELAXED);
+
+		if (bucket_insert_empty(prim_bkt, sig[i], slot_id) == 0 ||
+				bucket_insert_empty(sec_bkt, sig[i],
+						slot_id) == 0) {
+			positions[i] = slot_id - 1;
+			continue;
+		}
+
+		pending_key[n_pending] = i;
+		pending_slot[n_pending] = slot_id;
+		n_pending++;
+	}
+	__hash_rw_writer_unlock(h);
+
+	/* Slots never handed out are put back first, then the slots of
+	 * pending keys that turn out to exist or do not fit.
+	 */
+	n_unused = n_slots - next_slot;
+	for (j = 0; j < n_unused; j++)
+		slot_ids[j] = slot_ids[next_slot + j];
+
+	/* Push entries around for keys with both buckets full */
+	for (j = 0; j < n_pending; j++) {
+		i = pending_key[j];
+		slot_id = pending_slot[j];
+		ret = __rte_hash_add_key_displace(h, keys[i],
+				(data != NULL) ? data[i] : NULL, sig[i],
+				prim_index[i], sec_index[i], slot_id);
+		positions[i] = ret;
+		if (ret != (int32_t)(slot_id - 1))
+			slot_ids[n_unused++] = slot_id;
+	}
+
+	if (n_unused != 0)
+		free_slots_bulk(h, cached_free_slots, slot_ids, n_unused);
+}
+
+int
+rte_hash_add_key_bulk(const struct rte_hash *h, const void **keys,
+		void **data, uint32_t num_keys, int32_t *positions)
+{
+	uint32_t i;
+	int num_added = 0;
+
+	RETURN_IF_TRUE(((h == NULL) || (keys == NULL) || (num_keys == 0) ||
+			(num_keys > RTE_HASH_LOOKUP_BULK_MAX) ||
+			(positions == NULL)), -EINVAL);
+
+	__rte_hash_add_key_bulk(h, keys, data, num_keys, positions);
+
+	for (i = 0; i < num_keys; i++)
+		if (positions[i] >= 0)
+			num_added++;
+
+	return num_added;
+}
+
+static inline void
+__rte_hash_del_key_bulk(const struct rte_hash *h, const void **keys,
+			int32_t num_keys, int32_t *positions)
+{
+	uint16_t sig[RTE_HASH_LOOKUP_BULK_MAX];
+	uint32_t prim_index[RTE_HASH_LOOKUP_BULK_MAX];
+	uint32_t sec_index[RTE_HASH_LOOKUP_BULK_MAX];
+	uint32_t sync_free[RTE_HASH_LOOKUP_BULK_MAX];
+	struct rte_hash_bucket *old_prim_bkt, *old_sec_bkt;
+	uint32_t n_sync = 0;
+	int32_t i;
+
+	__bulk_calc_buckets(h, keys, num_keys, sig, prim_index, sec_index);
+	__bulk_prefetch_key_slots(h, num_keys, sig, prim_index, sec_index);
+
+	__hash_rw_writer_lock(h);
+	for (i = 0; i < num_keys; i++) {
+		positions[i] = __rte_hash_del_key_locked(h, keys[i], sig[i],
+					&h->buckets[prim_index[i]],
+					&h->buckets[sec_index[i]]);
+		if (positions[i] == -ENOENT &&
+				unlikely(h->old_buckets != NULL)) {
+			get_old_buckets(h, prim_index[i], sig[i],
+					&old_prim_bkt, &old_sec_bkt);
+			positions[i] = __rte_hash_del_key_locked(h, keys[i],
+					sig[i], old_prim_bkt, old_sec_bkt);
+		}
+		if (positions[i] >= 0 && h->hash_rcu_cfg != NULL &&
+				__hash_rcu_qsbr_defer(h, positions[i] + 1))
+			sync_free[n_sync++] = positions[i] + 1;
+	}
+	__hash_rw_writer_unlock(h);
+
+	if (n_sync != 0) {
+		/* A single grace period covers the whole burst */
+		rte_rcu_qsbr_synchronize(h->hash_rcu_cfg->v,
+					RTE_QSBR_THRID_INVALID);
+		for (i = 0; i < (int32_t)n_sync; i++)
+			__hash_rcu_free_key(h, sync_free[i]);
+	}
+}
+
+int
+rte_hash_del_key_bulk(const struct rte_hash *h, const void **keys,
+		uint32_t num_keys, int32_t *positions)
+{
+	uint32_t i;
+	int num_deleted = 0;
+
+	RETURN_IF_TRUE(((h == NULL) || (keys == NULL) || (num_keys == 0) ||
+			(num_keys > RTE_HASH_LOOKUP_BULK_MAX) ||
+			(positions == NULL)), -EINVAL);
+
+	__rte_hash_del_key_bulk(h, keys, num_keys, positions);
+
+	for (i = 0; i < num_keys; i++)
+		if (positions[i] >= 0)
+			num_deleted++;
+
+	return num_deleted;
+}
+
+int32_t
+rte_hash_iterate(const struct rte_hash *h, const void **key, void **data, uint32_t *next)
+{
+	uint32_t bucket_idx, idx, position, bucket_bitmask, total_entries;
+	struct rte_hash_bucket *buckets, *ext_buckets;
+	struct rte_hash_key *next_key;
 
 	RETURN_IF_TRUE(((h == NULL) || (next == NULL)), -EINVAL);
 
-	const uint32_t total_entries_main = h->num_buckets *
+	/* A resize stores the new buckets before their bitmask */
+	bucket_bitmask = __atomic_load_n(&h->bucket_bitmask, __ATOMIC_ACQUIRE);
+	buckets = __atomic_load_n(&h->buckets, __ATOMIC_ACQUIRE);
+
+	const uint32_t total_entries_main = (bucket_bitmask + 1) *
 							RTE_HASH_BUCKET_ENTRIES;
-	const uint32_t total_entries = total_entries_main << 1;
 
 	/* Out of bounds of all buckets (both main table and ext table) */
 	if (*next >= total_entries_main)
@@ -2186,7 +3139,7 @@ rte_hash_iterate(const struct rte_hash *h, const void **key, void **data, uint32
 	idx = *next % RTE_HASH_BUCKET_ENTRIES;
 
 	/* If current position is empty, go to the next one */
-	while ((position = __atomic_load_n(&h->buckets[bucket_idx].key_idx[idx],
+	while ((position = __atomic_load_n(&buckets[bucket_idx].key_idx[idx],
 					__ATOMIC_ACQUIRE)) == EMPTY_SLOT) {
 		(*next)++;
 		/* End of table */
@@ -2210,16 +3163,30 @@ rte_hash_iterate(const struct rte_hash *h, const void **key, void **data, uint32
 
 	return position - 1;
 
-/* Begin to iterate extendable buckets */
+/* Begin to iterate extendable buckets, or the buckets being migrated by
+ * a resize.
+ */
 extend_table:
-	/* Out of total bound or if ext bucket feature is not enabled */
-	if (*next >= total_entries || !h->ext_table_support)
+	if (h->ext_table_support) {
+		ext_buckets = h->buckets_ext;
+		total_entries = total_entries_main << 1;
+	} else {
+		ext_buckets = __atomic_load_n(&h->old_buckets,
+					__ATOMIC_ACQUIRE);
+		if (ext_buckets == NULL)
+			return -ENOENT;
+		total_entries = total_entries_main +
+			(h->old_bucket_bitmask + 1) * RTE_HASH_BUCKET_ENTRIES;
+	}
+
+	/* Out of total bound */
+	if (*next >= total_entries)
 		return -ENOENT;
 
 	bucket_idx = (*next - total_entries_main) / RTE_HASH_BUCKET_ENTRIES;
 	idx = (*next - total_entries_main) % RTE_HASH_BUCKET_ENTRIES;
 
-	while ((position = h->buckets_ext[bucket_idx].key_idx[idx]) == EMPTY_SLOT) {
+	while ((position = ext_buckets[bucket_idx].key_idx[idx]) == EMPTY_SLOT) {
 		(*next)++;
 		if (*next == total_entries)
 			return -ENOENT;
@@ -2240,3 +3207,351 @@ rte_hash_iterate(const struct rte_hash *h, const void **key, void **data, uint32
 	(*next)++;
 	return position - 1;
 }
+
+int
+rte_hash_age_scan(const struct rte_hash *h, uint64_t timeout, uint32_t *next,
+		uint32_t max_scan, const void **keys, void **data,
+		int32_t *positions, uint32_t max_expired)
+{
+	const struct rte_hash_bucket *bkt;
+	struct rte_hash_bucket *buckets, *ext_buckets;
+	struct rte_hash_key *k;
+	uint32_t total_entries, key_idx, idle_max, now, i, bucket_bitmask;
+	uint32_t num_expired = 0;
+
+	RETURN_IF_TRUE(((h == NULL) || (next == NULL) || (keys == NULL)),
+			-EINVAL);
+
+	if (h->last_hit == NULL)
+		return -EINVAL;
+
+	/* A resize stores the new buckets before their bitmask */
+	bucket_bitmask = __atomic_load_n(&h->bucket_bitmask, __ATOMIC_ACQUIRE);
+	buckets = __atomic_load_n(&h->buckets, __ATOMIC_ACQUIRE);
+
+	/* Extendable buckets, or buckets being migrated by a resize, are
+	 * scanned after the main buckets.
+	 */
+	const uint32_t total_entries_main = (bucket_bitmask + 1) *
+							RTE_HASH_BUCKET_ENTRIES;
+	total_entries = total_entries_main;
+	if (h->ext_table_support) {
+		ext_buckets = h->buckets_ext;
+		total_entries += total_entries_main;
+	} else {
+		ext_buckets = __atomic_load_n(&h->old_buckets,
+					__ATOMIC_ACQUIRE);
+		if (ext_buckets != NULL)
+			total_entries += (h->old_bucket_bitmask + 1) *
+						RTE_HASH_BUCKET_ENTRIES;
+	}
+
+	/* Convert the timeout to time stamp units */
+	timeout >>= AGE_TSC_SHIFT;
+	idle_max = (timeout > UINT32_MAX) ? UINT32_MAX : (uint32_t)timeout;
+	now = __hash_age_now();
+
+	if (*next >= total_entries)
+		*next = 0;
+
+	__hash_rw_reader_lock(h);
+	for (i = 0; i < max_scan && num_expired < max_expired; i++) {
+		if (*next < total_entries_main)
+			bkt = &buckets[*next / RTE_HASH_BUCKET_ENTRIES];
+		else
+			bkt = &ext_buckets[(*next - total_entries_main) /
+						RTE_HASH_BUCKET_ENTRIES];
+
+		key_idx = __atomic_load_n(
+				&bkt->key_idx[*next % RTE_HASH_BUCKET_ENTRIES],
+				__ATOMIC_ACQUIRE);
+		if (key_idx != EMPTY_SLOT && (uint32_t)(now -
+				__atomic_load_n(&h->last_hit[key_idx],
+					__ATOMIC_RELAXED)) > idle_max) {
+			k = (struct rte_hash_key *) ((char *)h->key_store +
+					key_idx * h->key_entry_size);
+			keys[num_expired] = k->key;
+			if (data != NULL)
+				data[num_expired] = __atomic_load_n(&k->pdata,
+							__ATOMIC_ACQUIRE);
+			if (positions != NULL)
+				positions[num_expired] = key_idx - 1;
+			num_expired++;
+		}
+
+		/* Wrap around at the end of the table */
+		if (++(*next) == total_entries) {
+			*next = 0;
+			break;
+		}
+	}
+	__hash_rw_reader_unlock(h);
+
+	return num_expired;
+}
+
+/* Insert a key being migrated by a resize in the new buckets, pushing
+ * other keys around if needed. The key keeps its key store slot.
+ */
+static int
+__hash_resize_insert(struct rte_hash *h, uint32_t key_idx)
+{
+	struct rte_hash_bucket *prim_bkt, *sec_bkt;
+	uint32_t prim_bucket_idx, sec_bucket_idx;
+	struct rte_hash_key *k;
+	const void *key;
+	hash_sig_t sig;
+	uint16_t short_sig;
+	int32_t ret_val;
+
+	k = RTE_PTR_ADD(h->key_store, key_idx * h->key_entry_size);
+	key = k->key;
+	sig = rte_hash_hash(h, key);
+	short_sig = get_short_sig(sig);
+	prim_bucket_idx = get_prim_bucket_index(h, sig);
+	sec_bucket_idx = get_alt_bucket_index(h, prim_bucket_idx, short_sig);
+	prim_bkt = &h->buckets[prim_bucket_idx];
+	sec_bkt = &h->buckets[sec_bucket_idx];
+
+	if (bucket_insert_empty(prim_bkt, short_sig, key_idx) == 0 ||
+			bucket_insert_empty(sec_bkt, short_sig, key_idx) == 0)
+		return 0;
+
+	if (rte_hash_cuckoo_make_space_mw(h, prim_bkt, sec_bkt, key, k->pdata,
+			short_sig, prim_bucket_idx, key_idx, &ret_val) == 0 ||
+			rte_hash_cuckoo_make_space_mw(h, sec_bkt, prim_bkt,
+				key, k->pdata, short_sig, sec_bucket_idx,
+				key_idx, &ret_val) == 0)
+		return 0;
+
+	return -ENOSPC;
+}
+
+/* Take a key copied by __hash_resize_insert out of the new buckets */
+static void
+__hash_resize_remove(struct rte_hash *h, uint32_t key_idx)
+{
+	uint32_t prim_bucket_idx, sec_bucket_idx;
+	struct rte_hash_key *k;
+	hash_sig_t sig;
+	uint16_t short_sig;
+
+	k = RTE_PTR_ADD(h->key_store, key_idx * h->key_entry_size);
+	sig = rte_hash_hash(h, k->key);
+	short_sig = get_short_sig(sig);
+	prim_bucket_idx = get_prim_bucket_index(h, sig);
+	sec_bucket_idx = get_alt_bucket_index(h, prim_bucket_idx, short_sig);
+
+	__rte_hash_del_key_locked(h, k->key, short_sig,
+			&h->buckets[prim_bucket_idx],
+			&h->buckets[sec_bucket_idx]);
+}
+
+int
+rte_hash_resize_start(struct rte_hash *h)
+{
+	struct rte_hash_bucket *buckets = NULL;
+	struct rte_ring *r = NULL;
+	uint32_t *last_hit = NULL;
+	void *k = NULL;
+	char ring_name[RTE_RING_NAMESIZE];
+	uint32_t slot_ids[LCORE_CACHE_SIZE];
+	uint32_t entries, num_buckets, old_key_slots, num_key_slots, i, n;
+
+	if (h == NULL)
+		return -EINVAL;
+
+	/* Only lock-free readers can follow the buckets being swapped, and
+	 * the old memory is freed after a grace period. Extendable buckets
+	 * and the lcore caches of multi-writer tables are not resized.
+	 */
+	if (!h->readwrite_concur_lf_support || h->ext_table_support ||
+			h->use_local_cache || h->hash_rcu_cfg == NULL)
+		return -ENOTSUP;
+
+	if (h->resize_state != RESIZE_IDLE)
+		return -EBUSY;
+
+	if (h->entries > RTE_HASH_ENTRIES_MAX / 2)
+		return -ENOSPC;
+
+	entries = h->entries * 2;
+	num_buckets = h->num_buckets * 2;
+	old_key_slots = h->entries + 1;
+	num_key_slots = entries + 1;
+
+	buckets = rte_zmalloc_socket(NULL,
+			num_buckets * sizeof(struct rte_hash_bucket),
+			RTE_CACHE_LINE_SIZE, h->socket_id);
+	k = rte_zmalloc_socket(NULL,
+			(uint64_t)h->key_entry_size * num_key_slots,
+			RTE_CACHE_LINE_SIZE, h->socket_id);
+	if (h->last_hit != NULL)
+		last_hit = rte_zmalloc_socket(NULL,
+				sizeof(uint32_t) * num_key_slots,
+				RTE_CACHE_LINE_SIZE, h->socket_id);
+
+	/* The current ring cannot be freed before its indexes are moved,
+	 * alternate between two names.
+	 */
+	snprintf(ring_name, sizeof(ring_name), "H%c_%s",
+			(h->num_resizes & 1) ? 'T' : 'R', h->name);
+	r = rte_ring_create_elem(ring_name, sizeof(uint32_t),
+			rte_align32pow2(num_key_slots), h->socket_id, 0);
+
+	if (buckets == NULL || k == NULL || r == NULL ||
+			(h->last_hit != NULL && last_hit == NULL)) {
+		RTE_LOG(ERR, HASH, "resize memory allocation failed\n");
+		rte_free(buckets);
+		rte_free(k);
+		rte_free(last_hit);
+		rte_ring_free(r);
+		return -ENOMEM;
+	}
+
+	__hash_rw_writer_lock(h);
+
+	/* Positions are kept, the keys are copied to the same slots */
+	memcpy(k, h->key_store, (uint64_t)h->key_entry_size * old_key_slots);
+	if (last_hit != NULL)
+		memcpy(last_hit, h->last_hit, sizeof(uint32_t) * old_key_slots);
+
+	/* Move the free indexes over and add the new ones */
+	while ((n = rte_ring_sc_dequeue_burst_elem(h->free_slots, slot_ids,
+			sizeof(uint32_t), RTE_DIM(slot_ids), NULL)) != 0)
+		rte_ring_sp_enqueue_burst_elem(r, slot_ids, sizeof(uint32_t),
+				n, NULL);
+	for (i = old_key_slots; i < num_key_slots; i++)
+		rte_ring_sp_enqueue_elem(r, &i, sizeof(uint32_t));
+	rte_ring_free(h->free_slots);
+	h->free_slots = r;
+
+	/* Readers load the key store after a key index, so the indexes
+	 * handed out from now on are always looked up in the new store.
+	 */
+	h->retired_key_store = h->key_store;
+	__atomic_store_n(&h->key_store, k, __ATOMIC_RELEASE);
+	h->retired_last_hit = h->last_hit;
+	__atomic_store_n(&h->last_hit, last_hit, __ATOMIC_RELEASE);
+	h->entries = entries;
+
+	/* Inform the readers that the buckets change. The old buckets are
+	 * published first and the bitmask last, so that readers never
+	 * index the buckets with a too large bitmask.
+	 */
+	__atomic_store_n(h->tbl_chng_cnt, *h->tbl_chng_cnt + 1,
+			__ATOMIC_RELEASE);
+	__atomic_thread_fence(__ATOMIC_RELEASE);
+	h->retired_buckets = h->buckets;
+	h->old_bucket_bitmask = h->bucket_bitmask;
+	__atomic_store_n(&h->old_buckets, h->buckets, __ATOMIC_RELEASE);
+	__atomic_store_n(&h->buckets, buckets, __ATOMIC_RELEASE);
+	h->num_buckets = num_buckets;
+	__atomic_store_n(&h->bucket_bitmask, num_buckets - 1,
+			__ATOMIC_RELEASE);
+
+	h->resize_next = 0;
+	h->resize_state = RESIZE_MIGRATE;
+	h->num_resizes++;
+
+	__hash_rw_writer_unlock(h);
+
+	return 0;
+}
+
+int
+rte_hash_resize_step(struct rte_hash *h, uint32_t max_buckets)
+{
+	struct rte_hash_bucket *bkt;
+	uint32_t old_num_buckets, end, b, i, j;
+	int ret = 0;
+
+	if (h == NULL)
+		return -EINVAL;
+
+	if (h->resize_state == RESIZE_IDLE)
+		return 0;
+
+	if (h->resize_state == RESIZE_RECLAIM) {
+		/* Free the old memory once the readers are done with it */
+		if (rte_rcu_qsbr_check(h->hash_rcu_cfg->v, h->resize_token,
+				false) != 1)
+			return 1;
+
+		rte_free(h->retired_key_store);
+		rte_free(h->retired_buckets);
+		rte_free(h->retired_last_hit);
+		h->retired_key_store = NULL;
+		h->retired_buckets = NULL;
+		h->retired_last_hit = NULL;
+		h->resize_state = RESIZE_IDLE;
+		return 0;
+	}
+
+	old_num_buckets = h->old_bucket_bitmask + 1;
+	end = (max_buckets < old_num_buckets - h->resize_next) ?
+			h->resize_next + max_buckets : old_num_buckets;
+
+	__hash_rw_writer_lock(h);
+
+	/* Copy the keys to the new buckets. They stay in the old buckets
+	 * as well until the readers are informed of the move.
+	 */
+	for (b = h->resize_next; b < end; b++) {
+		bkt = &h->old_buckets[b];
+		for (i = 0; i < RTE_HASH_BUCKET_ENTRIES; i++) {
+			if (bkt->key_idx[i] == EMPTY_SLOT)
+				continue;
+			ret = __hash_resize_insert(h, bkt->key_idx[i]);
+			if (ret != 0)
+				break;
+		}
+		if (ret != 0) {
+			/* Leave the keys of this bucket where they are */
+			for (j = 0; j < i; j++)
+				if (bkt->key_idx[j] != EMPTY_SLOT)
+					__hash_resize_remove(h,
+							bkt->key_idx[j]);
+			end = b;
+			break;
+		}
+	}
+
+	if (end != h->resize_next) {
+		/* Readers which did not see the copies must retry before
+		 * the keys go away from the old buckets.
+		 */
+		__atomic_store_n(h->tbl_chng_cnt, *h->tbl_chng_cnt + 1,
+				__ATOMIC_RELEASE);
+		__atomic_thread_fence(__ATOMIC_RELEASE);
+
+		for (b = h->resize_next; b < end; b++) {
+			bkt = &h->old_buckets[b];
+			for (i = 0; i < RTE_HASH_BUCKET_ENTRIES; i++) {
+				if (bkt->key_idx[i] == EMPTY_SLOT)
+					continue;
+				bkt->sig_current[i] = NULL_SIGNATURE;
+				__atomic_store_n(&bkt->key_idx[i],
+						EMPTY_SLOT,
+						__ATOMIC_RELEASE);
+			}
+		}
+		h->resize_next = end;
+	}
+
+	if (h->resize_next == old_num_buckets) {
+		/* All keys moved, readers stop looking at the old buckets.
+		 * Those still using them hold off the grace period.
+		 */
+		__atomic_store_n(&h->old_buckets, NULL, __ATOMIC_RELEASE);
+		h->resize_token = rte_rcu_qsbr_start(h->hash_rcu_cfg->v);
+		h->resize_state = RESIZE_RECLAIM;
+	}
+
+	__hash_rw_writer_unlock(h);
+
+	if (ret != 0)
+		return ret;
+
+	return old_num_buckets - h->resize_next + 1;
+}
@@ -59,14 +59,30 @@ enum cmp_jump_table_case {
 	KEY_112_BYTES,
 	KEY_128_BYTES,
 	KEY_OTHER_BYTES,
+#if defined(CC_AVX512_SUPPORT)
+	KEY_16_BYTES_AVX512,
+	KEY_32_BYTES_AVX512,
+	KEY_48_BYTES_AVX512,
+	KEY_64_BYTES_AVX512,
+#endif
 	NUM_KEY_CMP_CASES,
 };
 
+#if defined(CC_AVX512_SUPPORT)
+/* Key compare functions built with AVX512, see rte_cuckoo_hash_avx512.c */
+int rte_hash_k32_cmp_eq_avx512(const void *key1, const void *key2,
+		size_t key_len);
+int rte_hash_k48_cmp_eq_avx512(const void *key1, const void *key2,
+		size_t key_len);
+int rte_hash_k64_cmp_eq_avx512(const void *key1, const void *key2,
+		size_t key_len);
+#endif
+
 /*
  * Table storing all different key compare functions
  * (multi-process supported)
  */
-const rte_hash_cmp_eq_t cmp_jump_table[NUM_KEY_CMP_CASES] = {
+static const rte_hash_cmp_eq_t cmp_jump_table[NUM_KEY_CMP_CASES] = {
 	NULL,
 	rte_hash_k16_cmp_eq,
 	rte_hash_k32_cmp_eq,
@@ -76,7 +92,13 @@ const rte_hash_cmp_eq_t cmp_jump_table[NUM_KEY_CMP_CASES] = {
 	rte_hash_k96_cmp_eq,
 	rte_hash_k112_cmp_eq,
 	rte_hash_k128_cmp_eq,
-	memcmp
+	memcmp,
+#if defined(CC_AVX512_SUPPORT)
+	rte_hash_k16_cmp_eq,
+	rte_hash_k32_cmp_eq_avx512,
+	rte_hash_k48_cmp_eq_avx512,
+	rte_hash_k64_cmp_eq_avx512,
+#endif
 };
 #else
 /*
@@ -93,7 +115,7 @@ enum cmp_jump_table_case {
  * Table storing all different key compare functions
  * (multi-process supported)
  */
-const rte_hash_cmp_eq_t cmp_jump_table[NUM_KEY_CMP_CASES] = {
+static const rte_hash_cmp_eq_t cmp_jump_table[NUM_KEY_CMP_CASES] = {
 	NULL,
 	memcmp
 };
@@ -116,6 +138,12 @@ const rte_hash_cmp_eq_t cmp_jump_table[NUM_KEY_CMP_CASES] = {
 
 #define LCORE_CACHE_SIZE		64
 
+/* Key time stamps are kept in units of 2^AGE_TSC_SHIFT TSC cycles, so
+ * that a 32-bit stamp covers weeks and a hot key is written at most once
+ * per unit.
+ */
+#define AGE_TSC_SHIFT			20
+
 #define RTE_HASH_BFS_QUEUE_MAX_LEN       1000
 
 #define RTE_XABORT_CUCKOO_PATH_INVALIDED 0x4
@@ -142,9 +170,17 @@ enum rte_hash_sig_compare_function {
 	RTE_HASH_COMPARE_SCALAR = 0,
 	RTE_HASH_COMPARE_SSE,
 	RTE_HASH_COMPARE_NEON,
+	RTE_HASH_COMPARE_AVX512,
 	RTE_HASH_COMPARE_NUM
 };
 
+/* States of an online resize */
+enum rte_hash_resize_state {
+	RESIZE_IDLE = 0,
+	RESIZE_MIGRATE,		/* Keys move from the old to the new buckets */
+	RESIZE_RECLAIM		/* Old memory waits for a grace period */
+};
+
 /** Bucket structure */
 struct rte_hash_bucket {
 	uint16_t sig_current[RTE_HASH_BUCKET_ENTRIES];
@@ -220,6 +256,31 @@ struct rte_hash {
 	uint32_t *ext_bkt_to_free;
 	uint32_t *tbl_chng_cnt;
 	/**< Indicates if the hash table changed from last read. */
+	uint32_t *last_hit;
+	/**< Time stamp, in units of 2^AGE_TSC_SHIFT TSC cycles, of the last
+	 * add or successful lookup of each key slot. NULL if aging is not
+	 * enabled.
+	 */
+	struct rte_hash_rcu_config *hash_rcu_cfg;
+	/**< HASH RCU QSBR configuration structure */
+	struct rte_rcu_qsbr_dq *dq;	/**< RCU QSBR defer queue. */
+
+	/* Fields used by online resize */
+	int socket_id;			/**< Socket of the table memory. */
+	uint8_t resize_state;		/**< See enum rte_hash_resize_state. */
+	uint32_t num_resizes;		/**< Number of resizes started. */
+	struct rte_hash_bucket *old_buckets;
+	/**< Buckets being migrated to the new buckets by a resize, NULL if
+	 * there are none. Keys not migrated yet are looked up there.
+	 */
+	uint32_t old_bucket_bitmask;	/**< Bitmask of the old buckets. */
+	uint32_t resize_next;		/**< Next old bucket to migrate. */
+	void *retired_key_store;	/**< Key store replaced by a resize. */
+	struct rte_hash_bucket *retired_buckets;
+	/**< Buckets replaced by a resize. */
+	uint32_t *retired_last_hit;	/**< Time stamps replaced by a resize. */
+	uint64_t resize_token;
+	/**< QSBR token readers must pass before the retired memory is freed. */
 } __rte_cache_aligned;
 
 struct queue_node {
@@ -230,4 +291,25 @@ struct queue_node {
 	int prev_slot;               /* Parent(slot) in search path */
 };
 
+#if defined(CC_AVX512_SUPPORT)
+/*
+ * Compare the signatures of a burst of keys against their primary and
+ * secondary buckets, two keys per 512-bit register. The hit masks use the
+ * same two bits per entry layout as the SSE compare.
+ */
+void rte_hash_compare_signatures_avx512(uint32_t *prim_hash_matches,
+		uint32_t *sec_hash_matches,
+		const struct rte_hash_bucket **prim_bkt,
+		const struct rte_hash_bucket **sec_bkt,
+		const uint16_t *sig, int32_t num_keys);
+
+/*
+ * Compare the keys of a burst with the keys of their first signature hit,
+ * four 16-byte or two 32-byte keys per 512-bit compare. Bit i of the
+ * result is set if keys[i] equals slot_keys[i].
+ */
+uint64_t rte_hash_keys_cmp_eq_avx512(const void * const *slot_keys,
+		const void * const *keys, int32_t num_keys, uint32_t key_len);
+#endif
+
 #endif
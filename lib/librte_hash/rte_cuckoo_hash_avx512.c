@@ -0,0 +1,171 @@
+/* SPDX-License-Identifier: BSD-3-Clause
+ * Copyright(c) 2020 Intel Corporation
+ */
+
+#include <string.h>
+
+#include <rte_common.h>
+#include <rte_vect.h>
+#include <rte_hash.h>
+
+#include "rte_cuckoo_hash.h"
+
+int
+rte_hash_k32_cmp_eq_avx512(const void *key1, const void *key2,
+		size_t key_len __rte_unused)
+{
+	const __m256i k1 = _mm256_loadu_si256((const __m256i *)key1);
+	const __m256i k2 = _mm256_loadu_si256((const __m256i *)key2);
+
+	return _mm256_cmpneq_epi64_mask(k1, k2) != 0;
+}
+
+int
+rte_hash_k48_cmp_eq_avx512(const void *key1, const void *key2,
+		size_t key_len __rte_unused)
+{
+	const __m256i k1 = _mm256_loadu_si256((const __m256i *)key1);
+	const __m256i k2 = _mm256_loadu_si256((const __m256i *)key2);
+	const __m128i k3 = _mm_loadu_si128(
+			(const __m128i *)((const char *)key1 + 32));
+	const __m128i k4 = _mm_loadu_si128(
+			(const __m128i *)((const char *)key2 + 32));
+
+	return (_mm256_cmpneq_epi64_mask(k1, k2) |
+		_mm_cmpneq_epi64_mask(k3, k4)) != 0;
+}
+
+int
+rte_hash_k64_cmp_eq_avx512(const void *key1, const void *key2,
+		size_t key_len __rte_unused)
+{
+	const __m512i k1 = _mm512_loadu_si512(key1);
+	const __m512i k2 = _mm512_loadu_si512(key2);
+
+	return _mm512_cmpneq_epi64_mask(k1, k2) != 0;
+}
+
+/* Load four 16-byte keys in the 128-bit lanes of a register */
+static inline __m512i
+load_keys_x4(const void * const *k)
+{
+	__m512i v;
+
+	v = _mm512_castsi128_si512(_mm_loadu_si128((const __m128i *)k[0]));
+	v = _mm512_inserti32x4(v, _mm_loadu_si128((const __m128i *)k[1]), 1);
+	v = _mm512_inserti32x4(v, _mm_loadu_si128((const __m128i *)k[2]), 2);
+	return _mm512_inserti32x4(v,
+			_mm_loadu_si128((const __m128i *)k[3]), 3);
+}
+
+/* Load two 32-byte keys in the 256-bit lanes of a register */
+static inline __m512i
+load_keys_x2(const void * const *k)
+{
+	return _mm512_inserti64x4(_mm512_castsi256_si512(
+			_mm256_loadu_si256((const __m256i *)k[0])),
+			_mm256_loadu_si256((const __m256i *)k[1]), 1);
+}
+
+uint64_t
+rte_hash_keys_cmp_eq_avx512(const void * const *slot_keys,
+		const void * const *keys, int32_t num_keys, uint32_t key_len)
+{
+	uint64_t eq = 0;
+	uint32_t m;
+	int32_t i;
+
+	if (key_len == 16) {
+		for (i = 0; i + 3 < num_keys; i += 4) {
+			/* a key is equal if both its 64-bit halves are */
+			m = _mm512_cmpeq_epi64_mask(load_keys_x4(&slot_keys[i]),
+					load_keys_x4(&keys[i]));
+			m &= m >> 1;
+			m = (m & 0x1) | ((m >> 1) & 0x2) | ((m >> 2) & 0x4) |
+				((m >> 3) & 0x8);
+			eq |= (uint64_t)m << i;
+		}
+		for (; i < num_keys; i++)
+			if (!rte_hash_k16_cmp_eq(slot_keys[i], keys[i],
+					key_len))
+				eq |= 1ULL << i;
+	} else {
+		for (i = 0; i + 1 < num_keys; i += 2) {
+			m = _mm512_cmpeq_epi64_mask(load_keys_x2(&slot_keys[i]),
+					load_keys_x2(&keys[i]));
+			m = ((m & 0xf) == 0xf) | (((m >> 4) == 0xf) << 1);
+			eq |= (uint64_t)m << i;
+		}
+		if (i < num_keys &&
+				!rte_hash_k32_cmp_eq_avx512(slot_keys[i],
+					keys[i], key_len))
+			eq |= 1ULL << i;
+	}
+
+	return eq;
+}
+
+/*
+ * Widen a mask of one bit per 16-bit signature into the layout produced by
+ * _mm_movemask_epi8 on a 16-bit compare, i.e. two bits per entry.
+ */
+static inline uint64_t
+sig_mask_widen(__mmask32 m)
+{
+	return _mm512_movepi8_mask(_mm512_movm_epi16(m));
+}
+
+void
+rte_hash_compare_signatures_avx512(uint32_t *prim_hash_matches,
+		uint32_t *sec_hash_matches,
+		const struct rte_hash_bucket **prim_bkt,
+		const struct rte_hash_bucket **sec_bkt,
+		const uint16_t *sig, int32_t num_keys)
+{
+	__m512i bkt_sigs, key_sigs;
+	uint64_t matches;
+	int32_t i;
+
+	/*
+	 * Each 128-bit lane holds the eight signatures of one bucket:
+	 * lanes 0 and 1 are the buckets of key i, lanes 2 and 3 the buckets
+	 * of key i + 1.
+	 */
+	for (i = 0; i + 1 < num_keys; i += 2) {
+		bkt_sigs = _mm512_castsi128_si512(_mm_load_si128(
+			(const __m128i *)prim_bkt[i]->sig_current));
+		bkt_sigs = _mm512_inserti32x4(bkt_sigs, _mm_load_si128(
+			(const __m128i *)sec_bkt[i]->sig_current), 1);
+		bkt_sigs = _mm512_inserti32x4(bkt_sigs, _mm_load_si128(
+			(const __m128i *)prim_bkt[i + 1]->sig_current), 2);
+		bkt_sigs = _mm512_inserti32x4(bkt_sigs, _mm_load_si128(
+			(const __m128i *)sec_bkt[i + 1]->sig_current), 3);
+
+		key_sigs = _mm512_inserti64x4(
+			_mm512_castsi256_si512(_mm256_set1_epi16(sig[i])),
+			_mm256_set1_epi16(sig[i + 1]), 1);
+
+		matches = sig_mask_widen(
+			_mm512_cmpeq_epi16_mask(bkt_sigs, key_sigs));
+
+		prim_hash_matches[i] = (uint16_t)matches;
+		sec_hash_matches[i] = (uint16_t)(matches >> 16);
+		prim_hash_matches[i + 1] = (uint16_t)(matches >> 32);
+		sec_hash_matches[i + 1] = (uint16_t)(matches >> 48);
+	}
+
+	/* Odd key left over, compare its two buckets in one 256-bit op */
+	if (i < num_keys) {
+		__m256i sigs = _mm256_inserti128_si256(
+			_mm256_castsi128_si256(_mm_load_si128(
+				(const __m128i *)prim_bkt[i]->sig_current)),
+			_mm_load_si128(
+				(const __m128i *)sec_bkt[i]->sig_current), 1);
+
+		matches = sig_mask_widen(_mm256_cmpeq_epi16_mask(sigs,
+				_mm256_set1_epi16(sig[i])));
+
+		prim_hash_matches[i] = (uint16_t)matches;
+		sec_hash_matches[i] = (uint16_t)(matches >> 16);
+	}
+}
@@ -15,6 +15,7 @@
 #include <stddef.h>
 
 #include <rte_compat.h>
+#include <rte_rcu_qsbr.h>
 
 #ifdef __cplusplus
 extern "C" {
@@ -56,6 +57,14 @@ extern "C" {
  */
 #define RTE_HASH_EXTRA_FLAGS_RW_CONCURRENCY_LF 0x20
 
+/** Flag to record the time of the last add or successful lookup of each
+ * key, so that idle keys can be found with rte_hash_age_scan.
+ */
+#define RTE_HASH_EXTRA_FLAGS_AGING 0x40
+
+/** Default RCU defer queue entries to reclaim in one go. */
+#define RTE_HASH_RCU_DQ_RECLAIM_MAX	16
+
 /**
  * The type of hash value of a key.
  * It should be a value of at least 32bit with fully random pattern.
@@ -69,6 +78,21 @@ typedef uint32_t (*rte_hash_function)(const void *key, uint32_t key_len,
 /** Type of function used to compare the hash key. */
 typedef int (*rte_hash_cmp_eq_t)(const void *key1, const void *key2, size_t key_len);
 
+/**
+ * Type of function used to free data stored in the key.
+ * Required when using internal RCU to allow application to free key-data once
+ * the key is returned to the ring of free key-slots.
+ */
+typedef void (*rte_hash_free_key_data)(void *p, void *key_data);
+
+/** RCU reclamation modes */
+enum rte_hash_qsbr_mode {
+	/** Create defer queue for reclaim. */
+	RTE_HASH_QSBR_MODE_DQ = 0,
+	/** Use blocking mode reclaim. No defer queue created. */
+	RTE_HASH_QSBR_MODE_SYNC
+};
+
 /**
  * Parameters used when creating the hash table.
  */
@@ -83,6 +107,31 @@ struct rte_hash_parameters {
 	uint8_t extra_flag;		/**< Indicate if additional parameters are present. */
 };
 
+/** HASH RCU QSBR configuration structure. */
+struct rte_hash_rcu_config {
+	struct rte_rcu_qsbr *v;		/**< RCU QSBR variable. */
+	enum rte_hash_qsbr_mode mode;
+	/**< Mode of RCU QSBR. RTE_HASH_QSBR_MODE_xxx
+	 * '0' for default: create defer queue for reclaim.
+	 */
+	uint32_t dq_size;
+	/**< RCU defer queue size.
+	 * default: total hash table entries.
+	 */
+	uint32_t trigger_reclaim_limit;	/**< Threshold to trigger auto reclaim. */
+	uint32_t max_reclaim_size;
+	/**< Max entries to reclaim in one go.
+	 * default: RTE_HASH_RCU_DQ_RECLAIM_MAX.
+	 */
+	void *key_data_ptr;
+	/**< Pointer passed to the free function. Typically, this is the
+	 * pointer to the data structure to which the resource to free
+	 * (key-data) belongs. This can be NULL.
+	 */
+	rte_hash_free_key_data free_key_data_func;
+	/**< Function to call to free the resource (key-data). */
+};
+
 /** @internal A hash table structure. */
 struct rte_hash;
 
@@ -146,6 +195,9 @@ rte_hash_free(struct rte_hash *h);
  * it is application's responsibility to make sure that
  * none of the readers are referencing the hash table
  * while calling this API.
+ * If a QSBR variable was associated using rte_hash_rcu_qsbr_add, this
+ * API waits for the registered readers to report a quiescent state.
+ * A resize in progress is abandoned.
  *
  * @param h
  *   Hash table to reset
@@ -181,6 +233,28 @@ __rte_experimental
 int32_t
 rte_hash_max_key_id(const struct rte_hash *h);
 
+/**
+ * @warning
+ * @b EXPERIMENTAL: this API may change without prior notice
+ *
+ * Get the signature and key compare functions picked for a hash table
+ * when it was created, from its key length and the CPU flags.
+ *
+ * @param h
+ *  Hash table to query from
+ * @param sig_cmp
+ *  Output with the name of the signature compare, e.g. "sse" or "avx512"
+ * @param key_cmp
+ *  Output with the name of the key compare, e.g. "16 bytes avx512 x4"
+ * @return
+ *   - 0 on success
+ *   - -EINVAL if parameters are invalid
+ */
+__rte_experimental
+int
+rte_hash_get_cmp_path(const struct rte_hash *h, const char **sig_cmp,
+		const char **key_cmp);
+
 /**
  * Add a key-value pair to an existing hash table.
  * This operation is not multi-thread safe
@@ -282,6 +356,42 @@ rte_hash_add_key(const struct rte_hash *h, const void *key);
 int32_t
 rte_hash_add_key_with_hash(const struct rte_hash *h, const void *key, hash_sig_t sig);
 
+/**
+ * @warning
+ * @b EXPERIMENTAL: this API may change without prior notice
+ *
+ * Add multiple keys, with optional data, to an existing hash table.
+ * Hash values and bucket locations of the whole burst are calculated and
+ * prefetched before any insertion, and the writer lock (if any) is taken
+ * once for all the keys that fit without moving other entries. Keys whose
+ * buckets are full are inserted afterwards using cuckoo displacement.
+ * This operation is not multi-thread safe
+ * and should only be called from one thread by default.
+ * Thread safety can be enabled by setting flag during
+ * table creation.
+ * If a key exists already in the table, its value is updated with the
+ * corresponding entry of 'data', as with rte_hash_add_key_data.
+ *
+ * @param h
+ *   Hash table to add the keys to.
+ * @param keys
+ *   A pointer to a list of keys to add.
+ * @param data
+ *   A list of data to add with the keys, or NULL to store no data.
+ * @param num_keys
+ *   How many keys are in the keys list (less than RTE_HASH_LOOKUP_BULK_MAX).
+ * @param positions
+ *   Output containing a list of values, corresponding to the list of keys,
+ *   with the same meaning as the value returned by rte_hash_add_key for
+ *   each key (position of the key, or -ENOSPC if it did not fit).
+ * @return
+ *   -EINVAL if there's an error, otherwise number of keys added or updated.
+ */
+__rte_experimental
+int
+rte_hash_add_key_bulk(const struct rte_hash *h, const void **keys,
+		void **data, uint32_t num_keys, int32_t *positions);
+
 /**
  * Remove a key from an existing hash table.
  * This operation is not multi-thread safe
@@ -296,6 +406,8 @@ rte_hash_add_key_with_hash(const struct rte_hash *h, const void *key, hash_sig_t
  * rte_hash_free_key_with_position API should be called after all
  * the readers have stopped referencing the entry corresponding to
  * this key. RCU mechanisms could be used to determine such a state.
+ * If a QSBR variable was associated using rte_hash_rcu_qsbr_add, the
+ * index is freed by the library instead.
  *
  * @param h
  *   Hash table to remove the key from.
@@ -325,6 +437,8 @@ rte_hash_del_key(const struct rte_hash *h, const void *key);
  * rte_hash_free_key_with_position API should be called after all
  * the readers have stopped referencing the entry corresponding to
  * this key. RCU mechanisms could be used to determine such a state.
+ * If a QSBR variable was associated using rte_hash_rcu_qsbr_add, the
+ * index is freed by the library instead.
  *
  * @param h
  *   Hash table to remove the key from.
@@ -342,6 +456,44 @@ rte_hash_del_key(const struct rte_hash *h, const void *key);
 int32_t
 rte_hash_del_key_with_hash(const struct rte_hash *h, const void *key, hash_sig_t sig);
 
+/**
+ * @warning
+ * @b EXPERIMENTAL: this API may change without prior notice
+ *
+ * Remove multiple keys from an existing hash table.
+ * Hash values and bucket locations of the whole burst are calculated and
+ * prefetched before any removal, and the writer lock (if any) is taken
+ * once for the burst.
+ * This operation is not multi-thread safe
+ * and should only be called from one thread by default.
+ * Thread safety can be enabled by setting flag during
+ * table creation.
+ * If RTE_HASH_EXTRA_FLAGS_NO_FREE_ON_DEL or
+ * RTE_HASH_EXTRA_FLAGS_RW_CONCURRENCY_LF is enabled, the key indexes
+ * returned in 'positions' must be freed using
+ * rte_hash_free_key_with_position, as with rte_hash_del_key, unless
+ * a QSBR variable was associated using rte_hash_rcu_qsbr_add. In
+ * RTE_HASH_QSBR_MODE_SYNC mode, a single grace period is waited for
+ * the whole burst.
+ *
+ * @param h
+ *   Hash table to remove the keys from.
+ * @param keys
+ *   A pointer to a list of keys to remove.
+ * @param num_keys
+ *   How many keys are in the keys list (less than RTE_HASH_LOOKUP_BULK_MAX).
+ * @param positions
+ *   Output containing a list of values, corresponding to the list of keys,
+ *   with the same meaning as the value returned by rte_hash_del_key for
+ *   each key (position of the removed key, or -ENOENT if not found).
+ * @return
+ *   -EINVAL if there's an error, otherwise number of keys removed.
+ */
+__rte_experimental
+int
+rte_hash_del_key_bulk(const struct rte_hash *h, const void **keys,
+		uint32_t num_keys, int32_t *positions);
+
 /**
  * Find a key in the hash table given the position.
  * This operation is multi-thread safe with regarding to other lookup threads.
@@ -378,6 +530,8 @@ rte_hash_get_key_with_position(const struct rte_hash *h, const int32_t position,
  * have stopped referencing the entry corresponding to this key.
  * RCU mechanisms could be used to determine such a state.
  * This API does not validate if the key is already freed.
+ * It must not be used if a QSBR variable was associated using
+ * rte_hash_rcu_qsbr_add.
  *
  * @param h
  *   Hash table to free the key from.
@@ -566,6 +720,157 @@ rte_hash_lookup_bulk(const struct rte_hash *h, const void **keys,
  */
 int32_t
 rte_hash_iterate(const struct rte_hash *h, const void **key, void **data, uint32_t *next);
+
+/**
+ * @warning
+ * @b EXPERIMENTAL: this API may change without prior notice
+ *
+ * Associate RCU QSBR variable with a Hash object.
+ * This API should be called to enable the integrated RCU QSBR support and
+ * should be called immediately after creating the Hash object.
+ *
+ * Once it is called, the key index returned by rte_hash_del_xxx APIs is
+ * freed by the library after all the readers registered on the QSBR
+ * variable have gone through a grace period. The application must not
+ * call rte_hash_free_key_with_position for such indexes. Hence the hash
+ * table must be created with RTE_HASH_EXTRA_FLAGS_NO_FREE_ON_DEL or
+ * RTE_HASH_EXTRA_FLAGS_RW_CONCURRENCY_LF.
+ *
+ * In RTE_HASH_QSBR_MODE_DQ mode, deleted indexes are put on a defer
+ * queue and reclaimed when the queue grows beyond the configured limit
+ * or when an add finds no free key slot.
+ * In RTE_HASH_QSBR_MODE_SYNC mode, delete waits for the readers to go
+ * through a grace period before returning, so the writer must not be
+ * a reader registered on the same QSBR variable.
+ *
+ * @param h
+ *   the hash object to add RCU QSBR
+ * @param cfg
+ *   RCU QSBR configuration
+ * @return
+ *   0 on success.
+ *   - -EINVAL if the parameters are invalid or the hash table frees the
+ *     key index on delete.
+ *   - -EEXIST if already added QSBR.
+ *   - -ENOMEM if memory allocation failure.
+ */
+__rte_experimental
+int rte_hash_rcu_qsbr_add(struct rte_hash *h, struct rte_hash_rcu_config *cfg);
+
+/**
+ * @warning
+ * @b EXPERIMENTAL: this API may change without prior notice
+ *
+ * Scan part of the hash table for keys that have not been added or
+ * successfully looked up for longer than a timeout.
+ * The hash table must be created with RTE_HASH_EXTRA_FLAGS_AGING.
+ *
+ * The scan is incremental: at most max_scan bucket entries are visited
+ * per call, starting from the entry pointed by the iterator, so that the
+ * cost of aging can be spread over the packet processing loop. When the
+ * end of the table is reached, the iterator wraps around to 0 and the
+ * call returns.
+ * The expired keys are only reported, the application is expected to
+ * delete them, for example with rte_hash_del_key_bulk.
+ *
+ * The time stamps are kept with a resolution of 2^20 TSC cycles.
+ *
+ * @param h
+ *   Hash table to scan
+ * @param timeout
+ *   Idle time, in TSC cycles, after which a key is reported as expired.
+ * @param next
+ *   Pointer to iterator. Should be 0 to start scanning the hash table.
+ *   The same iterator must not be used with rte_hash_iterate.
+ * @param max_scan
+ *   Maximum number of bucket entries to visit in this call.
+ * @param keys
+ *   Output containing the expired keys.
+ * @param data
+ *   Output containing the data associated with the expired keys.
+ *   Can be NULL.
+ * @param positions
+ *   Output containing the positions of the expired keys.
+ *   Can be NULL.
+ * @param max_expired
+ *   Size of the output arrays. The scan stops once they are full.
+ * @return
+ *   Number of expired keys returned, if successful.
+ *   - -EINVAL if the parameters are invalid or aging is not enabled.
+ */
+__rte_experimental
+int
+rte_hash_age_scan(const struct rte_hash *h, uint64_t timeout, uint32_t *next,
+		uint32_t max_scan, const void **keys, void **data,
+		int32_t *positions, uint32_t max_expired);
+
+/**
+ * @warning
+ * @b EXPERIMENTAL: this API may change without prior notice
+ *
+ * Start doubling the capacity of a hash table, without stopping the
+ * lock-free readers.
+ *
+ * The new buckets and key store are allocated and published to the
+ * readers by this call. The keys are then moved from the old buckets to
+ * the new ones by rte_hash_resize_step, in bounded batches, while lookups,
+ * adds and deletes go on. Positions of the keys are not changed.
+ * The old memory is freed once the readers registered on the QSBR
+ * variable have gone through a grace period.
+ *
+ * The hash table must be created with
+ * RTE_HASH_EXTRA_FLAGS_RW_CONCURRENCY_LF, without
+ * RTE_HASH_EXTRA_FLAGS_EXT_TABLE and RTE_HASH_EXTRA_FLAGS_MULTI_WRITER_ADD,
+ * and a QSBR variable must be associated with rte_hash_rcu_qsbr_add.
+ * Since the keys are hashed again when moved, they must have been added
+ * with the hash function of the table.
+ * This API must be called from the writer thread.
+ *
+ * Key and data pointers returned by rte_hash_iterate or
+ * rte_hash_get_key_with_position before the resize point to the old key
+ * store, they must not be used after a quiescent state is reported.
+ *
+ * @param h
+ *   Hash table to resize
+ * @return
+ *   0 on success.
+ *   - -EINVAL if the parameters are invalid.
+ *   - -ENOTSUP if the hash table configuration does not allow resizing.
+ *   - -EBUSY if a resize is still in progress.
+ *   - -ENOSPC if the capacity would exceed RTE_HASH_ENTRIES_MAX.
+ *   - -ENOMEM if memory allocation failure.
+ */
+__rte_experimental
+int
+rte_hash_resize_start(struct rte_hash *h);
+
+/**
+ * @warning
+ * @b EXPERIMENTAL: this API may change without prior notice
+ *
+ * Make progress on a resize started with rte_hash_resize_start, by
+ * moving the keys of up to max_buckets old buckets to the new buckets.
+ * Once all the keys are moved, the following calls free the old memory
+ * when the readers have gone through a grace period. This API never
+ * waits for the readers.
+ * This API must be called from the writer thread.
+ *
+ * @param h
+ *   Hash table being resized
+ * @param max_buckets
+ *   Maximum number of old buckets to migrate in this call.
+ * @return
+ *   Number of old buckets left to migrate, plus one until the old memory
+ *   is freed. 0 when no resize is in progress anymore.
+ *   - -EINVAL if the parameters are invalid.
+ *   - -ENOSPC if a key did not fit in the new buckets. The keys of that
+ *     bucket stay where they are and the call can be repeated, for
+ *     example after some keys were deleted.
+ */
+__rte_experimental
+int
+rte_hash_resize_step(struct rte_hash *h, uint32_t max_buckets);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,530 @@
+/* SPDX-License-Identifier: BSD-3-Clause
+ * Copyright(c) 2020 Intel Corporation
+ */
+
+#include <string.h>
+#include <errno.h>
+#include <sys/queue.h>
+
+#include <rte_common.h>
+#include <rte_eal_memconfig.h>
+#include <rte_errno.h>
+#include <rte_log.h>
+#include <rte_malloc.h>
+#include <rte_prefetch.h>
+#include <rte_string_fns.h>
+#include <rte_tailq.h>
+#include <rte_vect.h>
+#include <rte_hash_crc.h>
+
+#include "rte_hash_flow_cache.h"
+
+TAILQ_HEAD(rte_hash_flow_cache_list, rte_tailq_entry);
+
+static struct rte_tailq_elem rte_hash_flow_cache_tailq = {
+	.name = "RTE_HASH_FLOW_CACHE",
+};
+EAL_REGISTER_TAILQ(rte_hash_flow_cache_tailq)
+
+/* Ways of a bucket ordered from most to least recently used, 4 bits each.
+ * Free ways are always the least recently used ones, so the way taken by
+ * an add is always the last one.
+ */
+#define LRU_INIT	0x76543210
+#define LRU_NIBBLES	0x11111111
+
+/* One cache line per bucket */
+struct rte_hash_flow_cache_bucket {
+	uint16_t sig[RTE_HASH_FLOW_CACHE_BUCKET_ENTRIES];
+	uint32_t lru;
+	uint8_t valid;
+} __rte_cache_aligned;
+
+struct rte_hash_flow_cache {
+	char name[RTE_HASH_FLOW_CACHE_NAMESIZE];
+	uint32_t entries;
+	uint32_t key_len;
+	uint32_t entry_size;
+	uint32_t bucket_mask;
+	rte_hash_function hash_func;
+	uint32_t hash_func_init_val;
+	rte_hash_flow_cache_evict_t evict_cb;
+	void *evict_cb_arg;
+	struct rte_hash_flow_cache_stats stats;
+	struct rte_hash_flow_cache_bucket *buckets;
+	uint8_t *entry_tbl;
+} __rte_cache_aligned;
+
+/* Position of a way in the LRU order */
+static inline uint32_t
+lru_pos(uint32_t lru, uint32_t way)
+{
+	uint32_t x = lru ^ (way * LRU_NIBBLES);
+
+	/* Lowest zero nibble */
+	return __builtin_ctz((x - LRU_NIBBLES) & ~x & (LRU_NIBBLES << 3)) >> 2;
+}
+
+/* Make a way the most recently used */
+static inline uint32_t
+lru_touch(uint32_t lru, uint32_t way)
+{
+	uint32_t low = (1U << (lru_pos(lru, way) << 2)) - 1;
+
+	return (lru & ~((low << 4) | 0xF)) | ((lru & low) << 4) | way;
+}
+
+/* Make a way the least recently used */
+static inline uint32_t
+lru_demote(uint32_t lru, uint32_t way)
+{
+	uint32_t low = (1U << (lru_pos(lru, way) << 2)) - 1;
+
+	return (lru & low) | ((lru >> 4) & ~low) | (way << 28);
+}
+
+static inline struct rte_hash_flow_cache_entry *
+get_entry(const struct rte_hash_flow_cache *fc, uint32_t bkt_idx, uint32_t way)
+{
+	return (struct rte_hash_flow_cache_entry *)(fc->entry_tbl +
+		((bkt_idx * RTE_HASH_FLOW_CACHE_BUCKET_ENTRIES + way) *
+		 (size_t)fc->entry_size));
+}
+
+static inline void *
+entry_key(struct rte_hash_flow_cache_entry *e)
+{
+	return e + 1;
+}
+
+static inline uint16_t
+get_sig(uint32_t hash)
+{
+	return hash >> 16;
+}
+
+/* Bitmask of the valid ways whose signature matches */
+static inline uint32_t
+match_sig(const struct rte_hash_flow_cache_bucket *bkt, uint16_t sig)
+{
+	uint32_t hits;
+#if defined(RTE_MACHINE_CPUFLAG_SSE2)
+	__m128i cmp = _mm_cmpeq_epi16(_mm_load_si128((const __m128i *)bkt->sig),
+			_mm_set1_epi16(sig));
+
+	hits = _mm_movemask_epi8(_mm_packs_epi16(cmp, _mm_setzero_si128()));
+#elif defined(RTE_MACHINE_CPUFLAG_NEON)
+	const uint16x8_t bits = {1, 2, 4, 8, 16, 32, 64, 128};
+	uint16x8_t cmp = vceqq_u16(vld1q_u16(bkt->sig), vdupq_n_u16(sig));
+
+	hits = vaddvq_u16(vandq_u16(cmp, bits));
+#else
+	uint32_t i;
+
+	hits = 0;
+	for (i = 0; i < RTE_HASH_FLOW_CACHE_BUCKET_ENTRIES; i++)
+		hits |= (bkt->sig[i] == sig) << i;
+#endif
+	return hits & bkt->valid;
+}
+
+/* Find the way holding a key among the signature hits */
+static inline int
+find_key(const struct rte_hash_flow_cache *fc, uint32_t bkt_idx, uint32_t hits,
+		const void *key)
+{
+	uint32_t way;
+
+	while (hits != 0) {
+		way = __builtin_ctz(hits);
+		if (memcmp(entry_key(get_entry(fc, bkt_idx, way)), key,
+				fc->key_len) == 0)
+			return way;
+		hits &= hits - 1;
+	}
+	return -1;
+}
+
+/* Add a key in the least recently used way of its bucket */
+static inline struct rte_hash_flow_cache_entry *
+add_key(struct rte_hash_flow_cache *fc, uint32_t bkt_idx, uint16_t sig,
+		const void *key)
+{
+	struct rte_hash_flow_cache_bucket *bkt = &fc->buckets[bkt_idx];
+	struct rte_hash_flow_cache_entry *e;
+	uint32_t way = bkt->lru >> 28;
+
+	e = get_entry(fc, bkt_idx, way);
+	if (bkt->valid & (1 << way)) {
+		if (fc->evict_cb != NULL)
+			fc->evict_cb(fc->evict_cb_arg, entry_key(e), e);
+		fc->stats.evictions++;
+	} else {
+		bkt->valid |= 1 << way;
+		fc->stats.used++;
+	}
+
+	memset(e, 0, sizeof(*e));
+	memcpy(entry_key(e), key, fc->key_len);
+	bkt->sig[way] = sig;
+	bkt->lru = lru_touch(bkt->lru, way);
+	fc->stats.misses++;
+
+	return e;
+}
+
+static inline struct rte_hash_flow_cache_entry *
+lookup_or_add(struct rte_hash_flow_cache *fc, uint32_t hash, const void *key,
+		int *added)
+{
+	uint32_t bkt_idx = hash & fc->bucket_mask;
+	struct rte_hash_flow_cache_bucket *bkt = &fc->buckets[bkt_idx];
+	int way;
+
+	way = find_key(fc, bkt_idx, match_sig(bkt, get_sig(hash)), key);
+	if (way < 0) {
+		*added = 1;
+		return add_key(fc, bkt_idx, get_sig(hash), key);
+	}
+
+	*added = 0;
+	bkt->lru = lru_touch(bkt->lru, way);
+	fc->stats.hits++;
+	return get_entry(fc, bkt_idx, way);
+}
+
+static inline void
+count_packet(struct rte_hash_flow_cache_entry *e, uint32_t pkt_len,
+		uint64_t now)
+{
+	e->packets++;
+	e->bytes += pkt_len;
+	e->last_seen = now;
+}
+
+struct rte_hash_flow_cache *
+rte_hash_flow_cache_create(const struct rte_hash_flow_cache_params *params)
+{
+	struct rte_hash_flow_cache *fc = NULL;
+	struct rte_tailq_entry *te;
+	struct rte_hash_flow_cache_list *fc_list;
+	char mem_name[RTE_HASH_FLOW_CACHE_NAMESIZE];
+	uint32_t num_buckets, entry_size;
+	size_t mem_size, bkt_size;
+
+	fc_list = RTE_TAILQ_CAST(rte_hash_flow_cache_tailq.head,
+			rte_hash_flow_cache_list);
+
+	if (params == NULL || params->name == NULL ||
+			params->entries < RTE_HASH_FLOW_CACHE_BUCKET_ENTRIES ||
+			params->entries > RTE_HASH_FLOW_CACHE_ENTRIES_MAX ||
+			!rte_is_power_of_2(params->entries) ||
+			params->key_len == 0 ||
+			params->key_len > RTE_HASH_FLOW_CACHE_KEY_LEN_MAX) {
+		rte_errno = EINVAL;
+		RTE_LOG(ERR, HASH, "%s has invalid parameters\n", __func__);
+		return NULL;
+	}
+
+	num_buckets = params->entries / RTE_HASH_FLOW_CACHE_BUCKET_ENTRIES;
+	/* Keep the entries from spanning more cache lines than needed */
+	entry_size = rte_align32pow2(sizeof(struct rte_hash_flow_cache_entry) +
+			params->key_len);
+	bkt_size = num_buckets * sizeof(struct rte_hash_flow_cache_bucket);
+	mem_size = sizeof(*fc) + bkt_size +
+			(size_t)params->entries * entry_size;
+
+	snprintf(mem_name, sizeof(mem_name), "FC_%s", params->name);
+
+	rte_mcfg_tailq_write_lock();
+
+	/* guarantee there's no existing */
+	TAILQ_FOREACH(te, fc_list, next) {
+		fc = (struct rte_hash_flow_cache *)te->data;
+		if (strncmp(params->name, fc->name,
+				RTE_HASH_FLOW_CACHE_NAMESIZE) == 0)
+			break;
+	}
+	fc = NULL;
+	if (te != NULL) {
+		rte_errno = EEXIST;
+		goto exit;
+	}
+
+	te = rte_zmalloc("HASH_FLOW_CACHE_TAILQ_ENTRY", sizeof(*te), 0);
+	if (te == NULL) {
+		RTE_LOG(ERR, HASH, "Failed to allocate tailq entry\n");
+		rte_errno = ENOMEM;
+		goto exit;
+	}
+
+	fc = rte_zmalloc_socket(mem_name, mem_size, RTE_CACHE_LINE_SIZE,
+			params->socket_id);
+	if (fc == NULL) {
+		RTE_LOG(ERR, HASH, "Failed to allocate flow cache\n");
+		rte_free(te);
+		rte_errno = ENOMEM;
+		goto exit;
+	}
+
+	strlcpy(fc->name, params->name, sizeof(fc->name));
+	fc->entries = params->entries;
+	fc->key_len = params->key_len;
+	fc->entry_size = entry_size;
+	fc->bucket_mask = num_buckets - 1;
+	fc->hash_func = params->hash_func != NULL ?
+			params->hash_func : rte_hash_crc;
+	fc->hash_func_init_val = params->hash_func_init_val;
+	fc->evict_cb = params->evict_cb;
+	fc->evict_cb_arg = params->evict_cb_arg;
+	fc->buckets = (struct rte_hash_flow_cache_bucket *)(fc + 1);
+	fc->entry_tbl = (uint8_t *)fc->buckets + bkt_size;
+	rte_hash_flow_cache_reset(fc);
+
+	te->data = fc;
+	TAILQ_INSERT_TAIL(fc_list, te, next);
+
+exit:
+	rte_mcfg_tailq_write_unlock();
+
+	return fc;
+}
+
+struct rte_hash_flow_cache *
+rte_hash_flow_cache_find_existing(const char *name)
+{
+	struct rte_hash_flow_cache *fc = NULL;
+	struct rte_tailq_entry *te;
+	struct rte_hash_flow_cache_list *fc_list;
+
+	fc_list = RTE_TAILQ_CAST(rte_hash_flow_cache_tailq.head,
+			rte_hash_flow_cache_list);
+
+	rte_mcfg_tailq_read_lock();
+	TAILQ_FOREACH(te, fc_list, next) {
+		fc = (struct rte_hash_flow_cache *)te->data;
+		if (strncmp(name, fc->name, RTE_HASH_FLOW_CACHE_NAMESIZE) == 0)
+			break;
+	}
+	rte_mcfg_tailq_read_unlock();
+
+	if (te == NULL) {
+		rte_errno = ENOENT;
+		return NULL;
+	}
+	return fc;
+}
+
+void
+rte_hash_flow_cache_free(struct rte_hash_flow_cache *fc)
+{
+	struct rte_tailq_entry *te;
+	struct rte_hash_flow_cache_list *fc_list;
+
+	if (fc == NULL)
+		return;
+
+	fc_list = RTE_TAILQ_CAST(rte_hash_flow_cache_tailq.head,
+			rte_hash_flow_cache_list);
+
+	rte_mcfg_tailq_write_lock();
+
+	TAILQ_FOREACH(te, fc_list, next) {
+		if (te->data == (void *)fc)
+			break;
+	}
+
+	if (te == NULL) {
+		rte_mcfg_tailq_write_unlock();
+		return;
+	}
+
+	TAILQ_REMOVE(fc_list, te, next);
+
+	rte_mcfg_tailq_write_unlock();
+
+	rte_free(fc);
+	rte_free(te);
+}
+
+void
+rte_hash_flow_cache_reset(struct rte_hash_flow_cache *fc)
+{
+	uint32_t i;
+
+	if (fc == NULL)
+		return;
+
+	memset(&fc->stats, 0, sizeof(fc->stats));
+	memset(fc->buckets, 0,
+		(fc->bucket_mask + 1) *
+		sizeof(struct rte_hash_flow_cache_bucket));
+	for (i = 0; i <= fc->bucket_mask; i++)
+		fc->buckets[i].lru = LRU_INIT;
+}
+
+struct rte_hash_flow_cache_entry *
+rte_hash_flow_cache_lookup(struct rte_hash_flow_cache *fc, const void *key)
+{
+	struct rte_hash_flow_cache_bucket *bkt;
+	uint32_t hash, bkt_idx;
+	int way;
+
+	if (fc == NULL || key == NULL)
+		return NULL;
+
+	hash = fc->hash_func(key, fc->key_len, fc->hash_func_init_val);
+	bkt_idx = hash & fc->bucket_mask;
+	bkt = &fc->buckets[bkt_idx];
+
+	way = find_key(fc, bkt_idx, match_sig(bkt, get_sig(hash)), key);
+	if (way < 0)
+		return NULL;
+
+	bkt->lru = lru_touch(bkt->lru, way);
+	return get_entry(fc, bkt_idx, way);
+}
+
+struct rte_hash_flow_cache_entry *
+rte_hash_flow_cache_lookup_or_add(struct rte_hash_flow_cache *fc,
+		const void *key, uint32_t pkt_len, uint64_t now, int *added)
+{
+	struct rte_hash_flow_cache_entry *e;
+	uint32_t hash;
+	int is_new;
+
+	if (fc == NULL || key == NULL)
+		return NULL;
+
+	hash = fc->hash_func(key, fc->key_len, fc->hash_func_init_val);
+	e = lookup_or_add(fc, hash, key, &is_new);
+	count_packet(e, pkt_len, now);
+	if (added != NULL)
+		*added = is_new;
+
+	return e;
+}
+
+int
+rte_hash_flow_cache_lookup_or_add_bulk(struct rte_hash_flow_cache *fc,
+		const void **keys, const uint32_t *pkt_len, uint32_t num_keys,
+		uint64_t now, struct rte_hash_flow_cache_entry **entries,
+		uint64_t *added_mask)
+{
+	uint32_t hash[RTE_HASH_FLOW_CACHE_LOOKUP_BULK_MAX];
+	uint32_t hits[RTE_HASH_FLOW_CACHE_LOOKUP_BULK_MAX];
+	struct rte_hash_flow_cache_bucket *bkt;
+	uint32_t i, bkt_idx;
+	uint64_t added = 0;
+	int num_added = 0;
+	int way, is_new;
+
+	if (fc == NULL || keys == NULL || entries == NULL ||
+			num_keys == 0 ||
+			num_keys > RTE_HASH_FLOW_CACHE_LOOKUP_BULK_MAX)
+		return -EINVAL;
+
+	/* Hash the keys and prefetch their buckets */
+	for (i = 0; i < num_keys; i++) {
+		hash[i] = fc->hash_func(keys[i], fc->key_len,
+				fc->hash_func_init_val);
+		rte_prefetch0(&fc->buckets[hash[i] & fc->bucket_mask]);
+	}
+
+	/* Compare the signatures and prefetch the first matching entry */
+	for (i = 0; i < num_keys; i++) {
+		bkt_idx = hash[i] & fc->bucket_mask;
+		hits[i] = match_sig(&fc->buckets[bkt_idx], get_sig(hash[i]));
+		if (hits[i] != 0)
+			rte_prefetch0(get_entry(fc, bkt_idx,
+					__builtin_ctz(hits[i])));
+	}
+
+	/* Compare the keys, add the ones not found */
+	for (i = 0; i < num_keys; i++) {
+		bkt_idx = hash[i] & fc->bucket_mask;
+		bkt = &fc->buckets[bkt_idx];
+
+		way = find_key(fc, bkt_idx, hits[i] & bkt->valid, keys[i]);
+		if (way >= 0) {
+			bkt->lru = lru_touch(bkt->lru, way);
+			fc->stats.hits++;
+			entries[i] = get_entry(fc, bkt_idx, way);
+		} else {
+			/* The key may have been added earlier in the burst */
+			entries[i] = lookup_or_add(fc, hash[i], keys[i],
+					&is_new);
+			if (is_new) {
+				added |= 1ULL << i;
+				num_added++;
+			}
+		}
+		count_packet(entries[i], pkt_len != NULL ? pkt_len[i] : 0,
+				now);
+	}
+
+	if (added_mask != NULL)
+		*added_mask = added;
+
+	return num_added;
+}
+
+int
+rte_hash_flow_cache_del(struct rte_hash_flow_cache *fc, const void *key)
+{
+	struct rte_hash_flow_cache_bucket *bkt;
+	uint32_t hash, bkt_idx;
+	int way;
+
+	if (fc == NULL || key == NULL)
+		return -EINVAL;
+
+	hash = fc->hash_func(key, fc->key_len, fc->hash_func_init_val);
+	bkt_idx = hash & fc->bucket_mask;
+	bkt = &fc->buckets[bkt_idx];
+
+	way = find_key(fc, bkt_idx, match_sig(bkt, get_sig(hash)), key);
+	if (way < 0)
+		return -ENOENT;
+
+	bkt->valid &= ~(1 << way);
+	bkt->lru = lru_demote(bkt->lru, way);
+	fc->stats.used--;
+
+	return 0;
+}
+
+int
+rte_hash_flow_cache_iterate(const struct rte_hash_flow_cache *fc,
+		const void **key, struct rte_hash_flow_cache_entry **entry,
+		uint32_t *next)
+{
+	uint32_t bkt_idx, way;
+
+	if (fc == NULL || key == NULL || entry == NULL || next == NULL)
+		return -EINVAL;
+
+	for (; *next < fc->entries; (*next)++) {
+		bkt_idx = *next / RTE_HASH_FLOW_CACHE_BUCKET_ENTRIES;
+		way = *next % RTE_HASH_FLOW_CACHE_BUCKET_ENTRIES;
+		if (fc->buckets[bkt_idx].valid & (1 << way)) {
+			*entry = get_entry(fc, bkt_idx, way);
+			*key = entry_key(*entry);
+			(*next)++;
+			return 0;
+		}
+	}
+
+	return -ENOENT;
+}
+
+int
+rte_hash_flow_cache_stats_get(const struct rte_hash_flow_cache *fc,
+		struct rte_hash_flow_cache_stats *stats)
+{
+	if (fc == NULL || stats == NULL)
+		return -EINVAL;
+
+	*stats = fc->stats;
+	return 0;
+}
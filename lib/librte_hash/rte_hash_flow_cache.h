@@ -0,0 +1,300 @@
+/* SPDX-License-Identifier: BSD-3-Clause
+ * Copyright(c) 2020 Intel Corporation
+ */
+
+#ifndef _RTE_HASH_FLOW_CACHE_H_
+#define _RTE_HASH_FLOW_CACHE_H_
+
+/**
+ * @file
+ *
+ * RTE Flow Cache
+ *
+ * A fixed size exact match cache for flow keys, meant to sit in front of
+ * a slower classifier (ACL, LPM, ...). The cache is made of 8-way buckets
+ * of one cache line each. A key can only live in the bucket its hash
+ * selects, so adding a key to a full bucket evicts the least recently
+ * used key of that bucket: adds never fail and take constant time.
+ *
+ * Each entry holds a 64-bit application data (e.g. the classification
+ * result) and the packet and byte counters and last seen time of the flow.
+ *
+ * The cache is not multi-thread safe, it is meant to be used by a single
+ * lcore, e.g. one cache per lcore.
+ */
+
+#include <stdint.h>
+
+#include <rte_compat.h>
+#include <rte_hash.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Maximum number of characters in flow cache name. */
+#define RTE_HASH_FLOW_CACHE_NAMESIZE		32
+
+/** Number of entries in a bucket. */
+#define RTE_HASH_FLOW_CACHE_BUCKET_ENTRIES	8
+
+/** Maximum number of entries of a flow cache. */
+#define RTE_HASH_FLOW_CACHE_ENTRIES_MAX	(1 << 24)
+
+/** Maximum key length of a flow cache. */
+#define RTE_HASH_FLOW_CACHE_KEY_LEN_MAX	64
+
+/** Maximum number of keys of rte_hash_flow_cache_lookup_or_add_bulk. */
+#define RTE_HASH_FLOW_CACHE_LOOKUP_BULK_MAX	64
+
+/** A flow cache entry. */
+struct rte_hash_flow_cache_entry {
+	uint64_t data;		/**< Application data, zero for new keys. */
+	uint64_t packets;	/**< Packets counted on the flow. */
+	uint64_t bytes;		/**< Bytes counted on the flow. */
+	uint64_t last_seen;	/**< Time of the last packet of the flow. */
+};
+
+/**
+ * Type of function called before an entry is evicted.
+ *
+ * @param arg
+ *   Argument given at the flow cache creation.
+ * @param key
+ *   Key of the evicted entry.
+ * @param entry
+ *   Evicted entry.
+ */
+typedef void (*rte_hash_flow_cache_evict_t)(void *arg, const void *key,
+		const struct rte_hash_flow_cache_entry *entry);
+
+/** Parameters used when creating a flow cache. */
+struct rte_hash_flow_cache_params {
+	const char *name;		/**< Name of the flow cache. */
+	uint32_t entries;		/**< Number of entries, power of 2. */
+	uint32_t key_len;		/**< Length of the keys. */
+	int socket_id;			/**< Socket to allocate memory on. */
+	rte_hash_function hash_func;	/**< Hash function, CRC if NULL. */
+	uint32_t hash_func_init_val;	/**< Init value of hash_func. */
+	rte_hash_flow_cache_evict_t evict_cb;
+	/**< Function called on eviction, may be NULL. */
+	void *evict_cb_arg;		/**< Argument of evict_cb. */
+};
+
+/** Flow cache statistics. */
+struct rte_hash_flow_cache_stats {
+	uint64_t hits;		/**< Keys found. */
+	uint64_t misses;	/**< Keys added. */
+	uint64_t evictions;	/**< Keys evicted to make room. */
+	uint32_t used;		/**< Entries in use. */
+};
+
+/** @internal A flow cache structure. */
+struct rte_hash_flow_cache;
+
+/**
+ * @warning
+ * @b EXPERIMENTAL: this API may change without prior notice
+ *
+ * Create a new flow cache.
+ *
+ * @param params
+ *   Parameters used to create the flow cache.
+ * @return
+ *   Pointer to the flow cache, or NULL on error with rte_errno set to:
+ *    - EINVAL - invalid parameter passed to function
+ *    - EEXIST - a flow cache with the same name already exists
+ *    - ENOMEM - no appropriate memory area found
+ */
+__rte_experimental
+struct rte_hash_flow_cache *
+rte_hash_flow_cache_create(const struct rte_hash_flow_cache_params *params);
+
+/**
+ * @warning
+ * @b EXPERIMENTAL: this API may change without prior notice
+ *
+ * Find an existing flow cache by name.
+ *
+ * @param name
+ *   Name of the flow cache.
+ * @return
+ *   Pointer to the flow cache, or NULL with rte_errno set to ENOENT.
+ */
+__rte_experimental
+struct rte_hash_flow_cache *
+rte_hash_flow_cache_find_existing(const char *name);
+
+/**
+ * @warning
+ * @b EXPERIMENTAL: this API may change without prior notice
+ *
+ * Free all memory used by a flow cache.
+ *
+ * @param fc
+ *   Flow cache to free.
+ */
+__rte_experimental
+void
+rte_hash_flow_cache_free(struct rte_hash_flow_cache *fc);
+
+/**
+ * @warning
+ * @b EXPERIMENTAL: this API may change without prior notice
+ *
+ * Remove all the entries of a flow cache and clear its statistics.
+ * The eviction function is not called.
+ *
+ * @param fc
+ *   Flow cache to reset.
+ */
+__rte_experimental
+void
+rte_hash_flow_cache_reset(struct rte_hash_flow_cache *fc);
+
+/**
+ * @warning
+ * @b EXPERIMENTAL: this API may change without prior notice
+ *
+ * Look up a key. A key found becomes the most recently used of its
+ * bucket, its counters are not updated.
+ *
+ * @param fc
+ *   Flow cache to look in.
+ * @param key
+ *   Key to find.
+ * @return
+ *   Entry of the key, or NULL if not found.
+ */
+__rte_experimental
+struct rte_hash_flow_cache_entry *
+rte_hash_flow_cache_lookup(struct rte_hash_flow_cache *fc, const void *key);
+
+/**
+ * @warning
+ * @b EXPERIMENTAL: this API may change without prior notice
+ *
+ * Look up a key and add it if not found, evicting the least recently
+ * used key of its bucket if the bucket is full. One packet of pkt_len
+ * bytes is counted on the entry and its last seen time set to now.
+ *
+ * @param fc
+ *   Flow cache to use.
+ * @param key
+ *   Key to find or add.
+ * @param pkt_len
+ *   Bytes to count on the entry.
+ * @param now
+ *   Current time, in any unit chosen by the application.
+ * @param added
+ *   Set to 1 if the key was added, 0 if found. May be NULL.
+ * @return
+ *   Entry of the key, or NULL if parameters are invalid.
+ */
+__rte_experimental
+struct rte_hash_flow_cache_entry *
+rte_hash_flow_cache_lookup_or_add(struct rte_hash_flow_cache *fc,
+		const void *key, uint32_t pkt_len, uint64_t now, int *added);
+
+/**
+ * @warning
+ * @b EXPERIMENTAL: this API may change without prior notice
+ *
+ * Look up a burst of keys and add the ones not found, as
+ * rte_hash_flow_cache_lookup_or_add does. The buckets and entries of the
+ * whole burst are prefetched before the keys are compared.
+ *
+ * An entry returned for a key may be evicted by a following key of the
+ * same burst only if more than RTE_HASH_FLOW_CACHE_BUCKET_ENTRIES keys of the
+ * burst are added to the same bucket.
+ *
+ * @param fc
+ *   Flow cache to use.
+ * @param keys
+ *   Keys to find or add.
+ * @param pkt_len
+ *   Bytes to count on the entry of each key. May be NULL to count
+ *   packets only.
+ * @param num_keys
+ *   Number of keys, at most RTE_HASH_FLOW_CACHE_LOOKUP_BULK_MAX.
+ * @param now
+ *   Current time, in any unit chosen by the application.
+ * @param entries
+ *   Output entry of each key.
+ * @param added_mask
+ *   Output bitmask of the keys added, bit i is set if keys[i] was not
+ *   found. May be NULL.
+ * @return
+ *   Number of keys added, or -EINVAL if parameters are invalid.
+ */
+__rte_experimental
+int
+rte_hash_flow_cache_lookup_or_add_bulk(struct rte_hash_flow_cache *fc,
+		const void **keys, const uint32_t *pkt_len, uint32_t num_keys,
+		uint64_t now, struct rte_hash_flow_cache_entry **entries,
+		uint64_t *added_mask);
+
+/**
+ * @warning
+ * @b EXPERIMENTAL: this API may change without prior notice
+ *
+ * Remove a key from a flow cache. The eviction function is not called.
+ *
+ * @param fc
+ *   Flow cache to remove the key from.
+ * @param key
+ *   Key to remove.
+ * @return
+ *   0 if removed, -ENOENT if not found, -EINVAL if parameters are invalid.
+ */
+__rte_experimental
+int
+rte_hash_flow_cache_del(struct rte_hash_flow_cache *fc, const void *key);
+
+/**
+ * @warning
+ * @b EXPERIMENTAL: this API may change without prior notice
+ *
+ * Iterate over the entries of a flow cache.
+ *
+ * @param fc
+ *   Flow cache to iterate.
+ * @param key
+ *   Output key of the entry.
+ * @param entry
+ *   Output entry.
+ * @param next
+ *   Iterator, must be set to 0 before the first call.
+ * @return
+ *   0 if an entry was returned, -ENOENT at the end of the cache,
+ *   -EINVAL if parameters are invalid.
+ */
+__rte_experimental
+int
+rte_hash_flow_cache_iterate(const struct rte_hash_flow_cache *fc,
+		const void **key, struct rte_hash_flow_cache_entry **entry,
+		uint32_t *next);
+
+/**
+ * @warning
+ * @b EXPERIMENTAL: this API may change without prior notice
+ *
+ * Get the statistics of a flow cache.
+ *
+ * @param fc
+ *   Flow cache to query.
+ * @param stats
+ *   Output statistics.
+ * @return
+ *   0 on success, -EINVAL if parameters are invalid.
+ */
+__rte_experimental
+int
+rte_hash_flow_cache_stats_get(const struct rte_hash_flow_cache *fc,
+		struct rte_hash_flow_cache_stats *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _RTE_HASH_FLOW_CACHE_H_ */
@@ -272,6 +272,104 @@ int32_t rte_ipv4_fragment_packet(struct rte_mbuf *pkt_in,
 			struct rte_mempool *pool_direct,
 			struct rte_mempool *pool_indirect);
 
+/**
+ * Copy the payload of the fragments in the direct mbufs, instead of
+ * attaching indirect mbufs to the input packet. The fragments are then
+ * made of a single mbuf, and the direct mbufs must have room for a whole
+ * fragment.
+ */
+#define RTE_IP_FRAG_BURST_F_COPY	(1 << 0)
+
+/** burst fragmentation parameters */
+struct rte_ip_frag_burst_params {
+	uint16_t mtu_size;
+	/**< MTU of the fragments, including the IP header but not L2 */
+	uint16_t flags;
+	/**< RTE_IP_FRAG_BURST_F_* flags */
+	struct rte_mempool *pool_direct;
+	/**< pool of the mbufs holding the headers of the fragments */
+	struct rte_mempool *pool_indirect;
+	/**< pool of the indirect mbufs holding the payload of the fragments,
+	 * unused with RTE_IP_FRAG_BURST_F_COPY
+	 */
+};
+
+/**
+ * @warning
+ * @b EXPERIMENTAL: this API may change without prior notice
+ *
+ * Fragment a burst of IPv4 packets, for transmission.
+ *
+ * The input packets start with their L2 header, of l2_len bytes, which
+ * is copied in each fragment. The headers of the fragments of a packet
+ * are copied from a template built once, only their length, offset and
+ * checksum fields being patched. The IPv4 checksum is computed, unless
+ * PKT_TX_IP_CKSUM is set in the packet. The mbufs of the fragments of
+ * a packet are allocated in bulk.
+ *
+ * The packets are processed in order. The ones which fit in the MTU are
+ * stored in pkts_out as is, the others are replaced by their fragments
+ * and freed. The processing stops at the first packet which can't be
+ * fragmented, or whose fragments don't fit in pkts_out, and rte_errno is
+ * set to:
+ * - ENOTSUP: the packet has the DF flag or IPv4 options.
+ * - ENOSPC: pkts_out is full.
+ * - ENOMEM: no mbuf available.
+ * - EINVAL: invalid packet headers or parameters.
+ *
+ * @param pkts_in
+ *   The input packets.
+ * @param nb_pkts_in
+ *   Number of input packets.
+ * @param pkts_out
+ *   Array storing the output packets, e.g. a TX burst array.
+ * @param nb_pkts_out
+ *   On input, the size of pkts_out. On output, the number of packets
+ *   stored in pkts_out.
+ * @param params
+ *   Fragmentation parameters.
+ * @return
+ *   Number of input packets processed. The remaining ones are still owned
+ *   by the caller.
+ */
+__rte_experimental
+uint16_t
+rte_ipv4_fragment_burst(struct rte_mbuf **pkts_in, uint16_t nb_pkts_in,
+		struct rte_mbuf **pkts_out, uint16_t *nb_pkts_out,
+		const struct rte_ip_frag_burst_params *params);
+
+/**
+ * @warning
+ * @b EXPERIMENTAL: this API may change without prior notice
+ *
+ * Fragment a burst of IPv6 packets, for transmission.
+ *
+ * This function is the IPv6 equivalent of rte_ipv4_fragment_burst().
+ * A fragment extension header, with a random identification, is added
+ * after the IPv6 header. The extension headers of the input packets are
+ * fragmented with the payload, like with rte_ipv6_fragment_packet().
+ *
+ * @param pkts_in
+ *   The input packets.
+ * @param nb_pkts_in
+ *   Number of input packets.
+ * @param pkts_out
+ *   Array storing the output packets, e.g. a TX burst array.
+ * @param nb_pkts_out
+ *   On input, the size of pkts_out. On output, the number of packets
+ *   stored in pkts_out.
+ * @param params
+ *   Fragmentation parameters.
+ * @return
+ *   Number of input packets processed. The remaining ones are still owned
+ *   by the caller, and rte_errno is set as in rte_ipv4_fragment_burst().
+ */
+__rte_experimental
+uint16_t
+rte_ipv6_fragment_burst(struct rte_mbuf **pkts_in, uint16_t nb_pkts_in,
+		struct rte_mbuf **pkts_out, uint16_t *nb_pkts_out,
+		const struct rte_ip_frag_burst_params *params);
+
 /**
  * This function implements reassembly of fragmented IPv4 packets.
  * Incoming mbufs should have its l2_len/l3_len fields setup correctly.
@@ -353,6 +451,211 @@ void
 rte_frag_table_del_expired_entries(struct rte_ip_frag_tbl *tbl,
 	struct rte_ip_frag_death_row *dr, uint64_t tms);
 
+/** reassembly engine, made of per lcore shards */
+struct rte_ip_frag_engine;
+
+/** reassembly engine shard, a reassembly table owned by one lcore */
+struct rte_ip_frag_shard;
+
+/** reassembly engine parameters */
+struct rte_ip_frag_engine_params {
+	uint32_t nb_shards;
+	/**< number of shards, typically one per RX queue */
+	uint32_t max_entries;
+	/**< maximum number of packets being reassembled in a shard */
+	uint32_t max_entries_per_src;
+	/**< maximum number of packets being reassembled in a shard for a
+	 * source address, up to UINT16_MAX, or 0 for no limit. The sources
+	 * are counted by hash, so sources sharing a counter share this limit.
+	 */
+	uint64_t max_cycles;
+	/**< maximum TTL in cycles for each fragmented packet */
+	int socket_id;
+	/**< socket to allocate the engine on */
+};
+
+/**
+ * @warning
+ * @b EXPERIMENTAL: this API may change without prior notice
+ *
+ * Create a reassembly engine.
+ *
+ * The engine is made of independent shards, each one used by a single
+ * lcore without any lock, e.g. the lcore polling a RX queue. The
+ * fragments of a packet must all be processed by the same shard, which
+ * is the case when the RSS of the port hashes the fragments on their IP
+ * addresses only. In a shard, the packets being reassembled are looked
+ * up through a hash table, and expire through a timer wheel, both in
+ * constant time. The number of packets being reassembled from a source
+ * can be bounded, so that a fragment flood from a few sources doesn't
+ * take the whole shard.
+ *
+ * @param params
+ *   Engine parameters.
+ * @return
+ *   The pointer to the new allocated engine, on success. NULL on error.
+ */
+__rte_experimental
+struct rte_ip_frag_engine *
+rte_ip_frag_engine_create(const struct rte_ip_frag_engine_params *params);
+
+/**
+ * @warning
+ * @b EXPERIMENTAL: this API may change without prior notice
+ *
+ * Free a reassembly engine and the fragments it holds.
+ *
+ * @param engine
+ *   Reassembly engine to free.
+ */
+__rte_experimental
+void
+rte_ip_frag_engine_destroy(struct rte_ip_frag_engine *engine);
+
+/**
+ * @warning
+ * @b EXPERIMENTAL: this API may change without prior notice
+ *
+ * Get a shard of a reassembly engine.
+ *
+ * @param engine
+ *   Reassembly engine.
+ * @param shard_id
+ *   Index of the shard, lower than the number of shards.
+ * @return
+ *   The shard, or NULL if shard_id is invalid.
+ */
+__rte_experimental
+struct rte_ip_frag_shard *
+rte_ip_frag_engine_get_shard(const struct rte_ip_frag_engine *engine,
+		uint32_t shard_id);
+
+/**
+ * @warning
+ * @b EXPERIMENTAL: this API may change without prior notice
+ *
+ * Get the index of the shard a fragment should be processed by, for the
+ * applications dispatching the fragments to the lcores in software. The
+ * RSS hash of the mbuf is used if any, otherwise the IP addresses are
+ * hashed. The mbuf should have its l2_len field setup correctly.
+ *
+ * @param engine
+ *   Reassembly engine.
+ * @param mb
+ *   Fragment mbuf.
+ * @return
+ *   Index of the shard.
+ */
+__rte_experimental
+uint32_t
+rte_ip_frag_engine_shard_id(const struct rte_ip_frag_engine *engine,
+		const struct rte_mbuf *mb);
+
+/**
+ * @warning
+ * @b EXPERIMENTAL: this API may change without prior notice
+ *
+ * Reassemble a burst of IPv4 fragments in a shard. This is the burst
+ * equivalent of rte_ipv4_frag_reassemble_packet(). The packets which
+ * aren't fragments are returned as is. The timed out packets of the
+ * shard are expired first.
+ *
+ * The incoming mbufs should have their l2_len/l3_len fields setup
+ * correctly. The death row is flushed with rte_ip_frag_free_death_row()
+ * when it may not have room for the mbufs of a packet.
+ *
+ * @param shard
+ *   Shard where to lookup/add the fragmented packets.
+ * @param dr
+ *   Death row to free buffers to.
+ * @param mbufs
+ *   Incoming mbufs.
+ * @param nb_mbufs
+ *   Number of incoming mbufs.
+ * @param tms
+ *   Fragments arrival timestamp.
+ * @param out
+ *   Array where to store the reassembled packets, and the ones which
+ *   aren't fragments. It can be the same array as mbufs.
+ * @return
+ *   Number of packets stored in out.
+ */
+__rte_experimental
+uint16_t
+rte_ipv4_frag_reassemble_burst(struct rte_ip_frag_shard *shard,
+		struct rte_ip_frag_death_row *dr, struct rte_mbuf **mbufs,
+		uint16_t nb_mbufs, uint64_t tms, struct rte_mbuf **out);
+
+/**
+ * @warning
+ * @b EXPERIMENTAL: this API may change without prior notice
+ *
+ * Reassemble a burst of IPv6 fragments in a shard. This is the burst
+ * equivalent of rte_ipv6_frag_reassemble_packet(). The packets without
+ * fragment extension header right after the IPv6 header are returned
+ * as is. The timed out packets of the shard are expired first.
+ *
+ * The incoming mbufs should have their l2_len/l3_len fields setup
+ * correctly. The death row is flushed with rte_ip_frag_free_death_row()
+ * when it may not have room for the mbufs of a packet.
+ *
+ * @param shard
+ *   Shard where to lookup/add the fragmented packets.
+ * @param dr
+ *   Death row to free buffers to.
+ * @param mbufs
+ *   Incoming mbufs.
+ * @param nb_mbufs
+ *   Number of incoming mbufs.
+ * @param tms
+ *   Fragments arrival timestamp.
+ * @param out
+ *   Array where to store the reassembled packets, and the ones which
+ *   aren't fragments. It can be the same array as mbufs.
+ * @return
+ *   Number of packets stored in out.
+ */
+__rte_experimental
+uint16_t
+rte_ipv6_frag_reassemble_burst(struct rte_ip_frag_shard *shard,
+		struct rte_ip_frag_death_row *dr, struct rte_mbuf **mbufs,
+		uint16_t nb_mbufs, uint64_t tms, struct rte_mbuf **out);
+
+/**
+ * @warning
+ * @b EXPERIMENTAL: this API may change without prior notice
+ *
+ * Delete the timed out packets of a shard, in constant time. It stops
+ * when the death row is full.
+ *
+ * @param shard
+ *   Shard to delete expired fragments from.
+ * @param dr
+ *   Death row to free buffers to.
+ * @param tms
+ *   Current timestamp.
+ */
+__rte_experimental
+void
+rte_ip_frag_shard_expire(struct rte_ip_frag_shard *shard,
+		struct rte_ip_frag_death_row *dr, uint64_t tms);
+
+/**
+ * @warning
+ * @b EXPERIMENTAL: this API may change without prior notice
+ *
+ * Dump the statistics of the shards of a reassembly engine to file.
+ *
+ * @param f
+ *   File to dump statistics to.
+ * @param engine
+ *   Reassembly engine to dump statistics from.
+ */
+__rte_experimental
+void
+rte_ip_frag_engine_statistics_dump(FILE *f,
+		const struct rte_ip_frag_engine *engine);
+
 #ifdef __cplusplus
 }
 #endif
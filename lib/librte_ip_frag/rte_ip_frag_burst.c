@@ -0,0 +1,418 @@
+/* SPDX-License-Identifier: BSD-3-Clause
+ * Copyright(c) 2020 Intel Corporation
+ */
+
+#include <stddef.h>
+#include <errno.h>
+
+#include <rte_errno.h>
+#include <rte_memcpy.h>
+#include <rte_mempool.h>
+#include <rte_random.h>
+
+#include "ip_frag_common.h"
+
+/*
+ * Burst fragmentation: the headers of the fragments of a packet are
+ * copied from a template, built once per packet, and only the length,
+ * offset, flags and checksum fields are patched for each fragment. The
+ * mbufs of a packet are allocated in bulk.
+ */
+
+/* largest L2 header length, l2_len being a 7 bits field */
+#define IP_FRAG_MAX_L2_LEN	128
+
+#define IP_FRAG_TMPL_LEN	(IP_FRAG_MAX_L2_LEN + \
+				sizeof(struct rte_ipv6_hdr) + \
+				sizeof(struct ipv6_extension_fragment))
+
+/* offload flags kept by the fragments */
+#define IP_FRAG_OL_FLAGS	(PKT_TX_IPV4 | PKT_TX_IPV6 | PKT_TX_IP_CKSUM | \
+				PKT_TX_VLAN_PKT | PKT_TX_QINQ_PKT)
+
+#define	IPV4_HDR_DF_MASK	(1 << 14)
+#define	IPV4_HDR_MF_MASK	(1 << 13)
+#define	IPV4_HDR_FO_SHIFT	3
+#define	IPV4_HDR_FO_ALIGN	(1 << IPV4_HDR_FO_SHIFT)
+
+/* headers of the fragments of a packet */
+struct ip_frag_tmpl {
+	uint8_t hdr[IP_FRAG_TMPL_LEN];
+	uint16_t hdr_len;     /* L2 and L3 headers length of the fragments */
+	uint16_t in_hdr_len;  /* L2 and L3 headers length of the packet */
+	uint16_t l2_len;
+	uint16_t l3_len;      /* L3 header length of the fragments */
+	uint16_t frag_size;   /* payload length of the fragments */
+	uint16_t fofs;        /* IPv4 flags and offset of the packet */
+	uint32_t pyld_len;    /* payload length of the packet */
+	uint32_t cksum;       /* IPv4 header sum, without the patched fields */
+	uint8_t sw_cksum;     /* IPv4 checksum computed in software */
+};
+
+/*
+ * Build the IPv4 fragment template of a packet. Return 1 if the packet
+ * doesn't need to be fragmented, a negative errno on error.
+ */
+static inline int
+ipv4_frag_tmpl_init(struct ip_frag_tmpl *tmpl, const struct rte_mbuf *pkt,
+		uint16_t mtu_size)
+{
+	const struct rte_ipv4_hdr *in_hdr;
+	struct rte_ipv4_hdr *hdr;
+	uint16_t total_len;
+
+	tmpl->l2_len = pkt->l2_len;
+	tmpl->l3_len = sizeof(struct rte_ipv4_hdr);
+	tmpl->hdr_len = tmpl->l2_len + tmpl->l3_len;
+	tmpl->in_hdr_len = tmpl->hdr_len;
+	if (unlikely(rte_pktmbuf_data_len(pkt) < tmpl->hdr_len))
+		return -EINVAL;
+
+	in_hdr = rte_pktmbuf_mtod_offset(pkt, const struct rte_ipv4_hdr *,
+			tmpl->l2_len);
+	total_len = rte_be_to_cpu_16(in_hdr->total_length);
+	if (unlikely(total_len <= tmpl->l3_len ||
+			pkt->pkt_len < tmpl->l2_len + total_len))
+		return -EINVAL;
+	if (total_len <= mtu_size)
+		return 1;
+
+	/* IPv4 options aren't supported */
+	if (unlikely(in_hdr->version_ihl != RTE_IPV4_VHL_DEF))
+		return -ENOTSUP;
+
+	tmpl->fofs = rte_be_to_cpu_16(in_hdr->fragment_offset);
+	if (unlikely((tmpl->fofs & IPV4_HDR_DF_MASK) != 0))
+		return -ENOTSUP;
+
+	tmpl->pyld_len = total_len - tmpl->l3_len;
+	tmpl->frag_size = RTE_ALIGN_FLOOR(mtu_size - tmpl->l3_len,
+			IPV4_HDR_FO_ALIGN);
+
+	rte_memcpy(tmpl->hdr, rte_pktmbuf_mtod(pkt, const void *),
+			tmpl->hdr_len);
+	hdr = (struct rte_ipv4_hdr *)(tmpl->hdr + tmpl->l2_len);
+	hdr->total_length = 0;
+	hdr->fragment_offset = 0;
+	hdr->hdr_checksum = 0;
+
+	tmpl->sw_cksum = !(pkt->ol_flags & PKT_TX_IP_CKSUM);
+	if (tmpl->sw_cksum)
+		tmpl->cksum = __rte_raw_cksum(hdr, sizeof(*hdr), 0);
+
+	return 0;
+}
+
+/*
+ * Build the IPv6 fragment template of a packet, with a fragment extension
+ * header. Return 1 if the packet doesn't need to be fragmented, a
+ * negative errno on error.
+ */
+static inline int
+ipv6_frag_tmpl_init(struct ip_frag_tmpl *tmpl, const struct rte_mbuf *pkt,
+		uint16_t mtu_size)
+{
+	const struct rte_ipv6_hdr *in_hdr;
+	struct ipv6_extension_fragment *fh;
+	struct rte_ipv6_hdr *hdr;
+	uint16_t pyld_len;
+
+	tmpl->l2_len = pkt->l2_len;
+	tmpl->l3_len = sizeof(struct rte_ipv6_hdr) + sizeof(*fh);
+	tmpl->in_hdr_len = tmpl->l2_len + sizeof(struct rte_ipv6_hdr);
+	tmpl->hdr_len = tmpl->l2_len + tmpl->l3_len;
+	if (unlikely(rte_pktmbuf_data_len(pkt) < tmpl->in_hdr_len))
+		return -EINVAL;
+
+	in_hdr = rte_pktmbuf_mtod_offset(pkt, const struct rte_ipv6_hdr *,
+			tmpl->l2_len);
+	pyld_len = rte_be_to_cpu_16(in_hdr->payload_len);
+	if (unlikely(pyld_len == 0 ||
+			pkt->pkt_len < tmpl->in_hdr_len + pyld_len))
+		return -EINVAL;
+	if (pyld_len + sizeof(*in_hdr) <= mtu_size)
+		return 1;
+
+	tmpl->pyld_len = pyld_len;
+	tmpl->frag_size = RTE_ALIGN_FLOOR(mtu_size - tmpl->l3_len,
+			RTE_IPV6_EHDR_FO_ALIGN);
+
+	rte_memcpy(tmpl->hdr, rte_pktmbuf_mtod(pkt, const void *),
+			tmpl->in_hdr_len);
+	hdr = (struct rte_ipv6_hdr *)(tmpl->hdr + tmpl->l2_len);
+	hdr->proto = IPPROTO_FRAGMENT;
+
+	fh = (struct ipv6_extension_fragment *)(hdr + 1);
+	fh->next_header = in_hdr->proto;
+	fh->reserved = 0;
+	fh->id = (uint32_t)rte_rand();
+
+	tmpl->sw_cksum = 0;
+
+	return 0;
+}
+
+/* patch the template fields of a fragment header */
+static inline void
+ip_frag_hdr_patch(const struct ip_frag_tmpl *tmpl, uint8_t *dst,
+		uint32_t ofs, uint16_t len, uint32_t mf, uint8_t is_ipv6)
+{
+	struct ipv6_extension_fragment *fh;
+	struct rte_ipv6_hdr *ip6;
+	struct rte_ipv4_hdr *ip;
+	uint16_t fofs, cksum;
+
+	if (is_ipv6) {
+		ip6 = (struct rte_ipv6_hdr *)(dst + tmpl->l2_len);
+		ip6->payload_len = rte_cpu_to_be_16(sizeof(*fh) + len);
+		fh = (struct ipv6_extension_fragment *)(ip6 + 1);
+		fh->frag_data = rte_cpu_to_be_16(
+				RTE_IPV6_SET_FRAG_DATA(ofs, mf));
+	} else {
+		ip = (struct rte_ipv4_hdr *)(dst + tmpl->l2_len);
+		fofs = tmpl->fofs + (ofs >> IPV4_HDR_FO_SHIFT);
+		if (mf)
+			fofs |= IPV4_HDR_MF_MASK;
+		ip->total_length = rte_cpu_to_be_16(sizeof(*ip) + len);
+		ip->fragment_offset = rte_cpu_to_be_16(fofs);
+		if (tmpl->sw_cksum) {
+			cksum = __rte_raw_cksum_reduce(tmpl->cksum +
+					ip->total_length +
+					ip->fragment_offset);
+			ip->hdr_checksum = (cksum == 0xffff) ?
+				cksum : (uint16_t)~cksum;
+		}
+	}
+}
+
+/* initialize the direct mbuf of a fragment, with its headers */
+static inline void
+ip_frag_out_init(struct rte_mbuf *out, const struct rte_mbuf *pkt,
+		const struct ip_frag_tmpl *tmpl)
+{
+	rte_memcpy(rte_pktmbuf_mtod(out, void *), tmpl->hdr, tmpl->hdr_len);
+	out->data_len = tmpl->hdr_len;
+	out->pkt_len = tmpl->hdr_len;
+	out->l2_len = tmpl->l2_len;
+	out->l3_len = tmpl->l3_len;
+	out->ol_flags = pkt->ol_flags & IP_FRAG_OL_FLAGS;
+	out->vlan_tci = pkt->vlan_tci;
+	out->vlan_tci_outer = pkt->vlan_tci_outer;
+}
+
+/*
+ * Fragment a packet, the payload of the fragments being indirect mbufs
+ * attached to the packet segments.
+ */
+static int
+ip_frag_attach(struct rte_mbuf *pkt, const struct ip_frag_tmpl *tmpl,
+		struct rte_mbuf **out, uint16_t nb_frags, uint16_t nb_segs,
+		const struct rte_ip_frag_burst_params *params, uint8_t is_ipv6)
+{
+	struct rte_mbuf *segs[nb_segs];
+	struct rte_mbuf *in_seg, *prev, *seg;
+	uint32_t in_pos, ofs, remain, len;
+	uint16_t i, n = 0;
+
+	if (unlikely(rte_pktmbuf_alloc_bulk(params->pool_direct, out,
+					nb_frags) != 0))
+		return -ENOMEM;
+	if (unlikely(rte_pktmbuf_alloc_bulk(params->pool_indirect, segs,
+					nb_segs) != 0)) {
+		rte_mempool_put_bulk(params->pool_direct, (void **)out,
+				nb_frags);
+		return -ENOMEM;
+	}
+	if (unlikely(rte_pktmbuf_tailroom(out[0]) < tmpl->hdr_len)) {
+		rte_mempool_put_bulk(params->pool_direct, (void **)out,
+				nb_frags);
+		rte_mempool_put_bulk(params->pool_indirect, (void **)segs,
+				nb_segs);
+		return -EINVAL;
+	}
+
+	in_seg = pkt;
+	in_pos = tmpl->in_hdr_len;
+	ofs = 0;
+	for (i = 0; i != nb_frags; i++) {
+		ip_frag_out_init(out[i], pkt, tmpl);
+		prev = out[i];
+		remain = RTE_MIN((uint32_t)tmpl->frag_size,
+				tmpl->pyld_len - ofs);
+
+		while (remain != 0) {
+			while (in_pos == in_seg->data_len) {
+				in_seg = in_seg->next;
+				in_pos = 0;
+			}
+			len = RTE_MIN(remain, in_seg->data_len - in_pos);
+
+			seg = segs[n++];
+			rte_pktmbuf_attach(seg, in_seg);
+			seg->data_off = in_seg->data_off + in_pos;
+			seg->data_len = len;
+			prev->next = seg;
+			prev = seg;
+			out[i]->pkt_len += len;
+			out[i]->nb_segs++;
+
+			in_pos += len;
+			remain -= len;
+		}
+
+		len = out[i]->pkt_len - tmpl->hdr_len;
+		ip_frag_hdr_patch(tmpl, rte_pktmbuf_mtod(out[i], uint8_t *),
+				ofs, len, ofs + len != tmpl->pyld_len,
+				is_ipv6);
+		ofs += len;
+	}
+
+	if (n != nb_segs)
+		rte_mempool_put_bulk(params->pool_indirect,
+				(void **)&segs[n], nb_segs - n);
+
+	return 0;
+}
+
+/* Fragment a packet, the payload being copied in the direct mbufs */
+static int
+ip_frag_copy(struct rte_mbuf *pkt, const struct ip_frag_tmpl *tmpl,
+		struct rte_mbuf **out, uint16_t nb_frags,
+		const struct rte_ip_frag_burst_params *params, uint8_t is_ipv6)
+{
+	const struct rte_mbuf *in_seg;
+	uint32_t in_pos, ofs, remain, len;
+	uint8_t *dst;
+	uint16_t i;
+
+	if (unlikely(rte_pktmbuf_alloc_bulk(params->pool_direct, out,
+					nb_frags) != 0))
+		return -ENOMEM;
+	if (unlikely(rte_pktmbuf_tailroom(out[0]) <
+				tmpl->hdr_len + tmpl->frag_size)) {
+		rte_mempool_put_bulk(params->pool_direct, (void **)out,
+				nb_frags);
+		return -EINVAL;
+	}
+
+	in_seg = pkt;
+	in_pos = tmpl->in_hdr_len;
+	ofs = 0;
+	for (i = 0; i != nb_frags; i++) {
+		ip_frag_out_init(out[i], pkt, tmpl);
+		remain = RTE_MIN((uint32_t)tmpl->frag_size,
+				tmpl->pyld_len - ofs);
+		dst = rte_pktmbuf_mtod_offset(out[i], uint8_t *,
+				tmpl->hdr_len);
+		ip_frag_hdr_patch(tmpl, rte_pktmbuf_mtod(out[i], uint8_t *),
+				ofs, remain, ofs + remain != tmpl->pyld_len,
+				is_ipv6);
+		out[i]->data_len += remain;
+		out[i]->pkt_len += remain;
+		ofs += remain;
+
+		while (remain != 0) {
+			while (in_pos == in_seg->data_len) {
+				in_seg = in_seg->next;
+				in_pos = 0;
+			}
+			len = RTE_MIN(remain, in_seg->data_len - in_pos);
+			rte_memcpy(dst, rte_pktmbuf_mtod_offset(in_seg,
+					const uint8_t *, in_pos), len);
+			dst += len;
+			in_pos += len;
+			remain -= len;
+		}
+	}
+
+	return 0;
+}
+
+static inline uint16_t
+ip_fragment_burst(struct rte_mbuf **pkts_in, uint16_t nb_pkts_in,
+		struct rte_mbuf **pkts_out, uint16_t *nb_pkts_out,
+		const struct rte_ip_frag_burst_params *params, uint8_t is_ipv6)
+{
+	struct ip_frag_tmpl tmpl;
+	struct rte_mbuf *pkt;
+	uint16_t i, nb_out = 0, nb_frags;
+	int ret;
+
+	if (unlikely(params->mtu_size < (is_ipv6 ?
+				sizeof(struct rte_ipv6_hdr) +
+				sizeof(struct ipv6_extension_fragment) :
+				sizeof(struct rte_ipv4_hdr)) +
+				IPV4_HDR_FO_ALIGN)) {
+		rte_errno = EINVAL;
+		*nb_pkts_out = 0;
+		return 0;
+	}
+
+	for (i = 0; i != nb_pkts_in; i++) {
+		pkt = pkts_in[i];
+
+		if (is_ipv6)
+			ret = ipv6_frag_tmpl_init(&tmpl, pkt,
+					params->mtu_size);
+		else
+			ret = ipv4_frag_tmpl_init(&tmpl, pkt,
+					params->mtu_size);
+
+		/* small enough, pass it through */
+		if (ret == 1) {
+			if (unlikely(nb_out == *nb_pkts_out)) {
+				ret = -ENOSPC;
+				break;
+			}
+			pkts_out[nb_out++] = pkt;
+			continue;
+		}
+		if (unlikely(ret < 0))
+			break;
+
+		nb_frags = (tmpl.pyld_len + tmpl.frag_size - 1) /
+			tmpl.frag_size;
+		if (unlikely(nb_frags > *nb_pkts_out - nb_out)) {
+			ret = -ENOSPC;
+			break;
+		}
+
+		if (params->flags & RTE_IP_FRAG_BURST_F_COPY)
+			ret = ip_frag_copy(pkt, &tmpl, &pkts_out[nb_out],
+					nb_frags, params, is_ipv6);
+		else
+			/* a payload segment per fragment and segment end */
+			ret = ip_frag_attach(pkt, &tmpl, &pkts_out[nb_out],
+					nb_frags, nb_frags + pkt->nb_segs - 1,
+					params, is_ipv6);
+		if (unlikely(ret < 0))
+			break;
+
+		/* the fragments hold references to the packet segments */
+		rte_pktmbuf_free(pkt);
+		nb_out += nb_frags;
+	}
+
+	if (i != nb_pkts_in)
+		rte_errno = -ret;
+	*nb_pkts_out = nb_out;
+	return i;
+}
+
+uint16_t
+rte_ipv4_fragment_burst(struct rte_mbuf **pkts_in, uint16_t nb_pkts_in,
+		struct rte_mbuf **pkts_out, uint16_t *nb_pkts_out,
+		const struct rte_ip_frag_burst_params *params)
+{
+	return ip_fragment_burst(pkts_in, nb_pkts_in, pkts_out, nb_pkts_out,
+			params, 0);
+}
+
+uint16_t
+rte_ipv6_fragment_burst(struct rte_mbuf **pkts_in, uint16_t nb_pkts_in,
+		struct rte_mbuf **pkts_out, uint16_t *nb_pkts_out,
+		const struct rte_ip_frag_burst_params *params)
+{
+	return ip_fragment_burst(pkts_in, nb_pkts_in, pkts_out, nb_pkts_out,
+			params, 1);
+}
@@ -0,0 +1,596 @@
+/* SPDX-License-Identifier: BSD-3-Clause
+ * Copyright(c) 2020 Intel Corporation
+ */
+
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <rte_common.h>
+#include <rte_hash_crc.h>
+#include <rte_log.h>
+#include <rte_malloc.h>
+#include <rte_mbuf.h>
+#include <rte_memcpy.h>
+
+#include "ip_frag_common.h"
+
+/*
+ * Reassembly engine: a set of independent shards, each one owned by a
+ * single lcore. A shard looks the packets being reassembled up through a
+ * chained hash table, and keeps them in a timer wheel of start times, so
+ * that both the lookup and the expiry are O(1).
+ */
+
+/* number of slots in the timer wheel of a shard, a power of 2 */
+#define IP_FRAG_WHEEL_SLOTS	64
+/* number of wheel ticks in the TTL of the entries */
+#define IP_FRAG_WHEEL_TTL_TICKS	(IP_FRAG_WHEEL_SLOTS / 2)
+
+#define IP_FRAG_INVALID_IDX	UINT32_MAX
+
+#define IP_FRAG_KEY_SEED	0xeaad8405
+#define IP_FRAG_SRC_SEED	0x9e3779b9
+
+/* room needed in the death row to process one fragment */
+#define IP_FRAG_DR_ROOM		(IP_MAX_FRAG_NUM + 1)
+
+#define IP_FRAG_DR_PREFETCH	3
+
+#define IPV6_MORE_FRAGS(x)	(((x) & 0x100) >> 8)
+#define IPV6_FRAG_OFFSET(x)	(rte_cpu_to_be_16(x) >> 3)
+
+/* shard statistics */
+struct ip_frag_shard_stat {
+	uint64_t find_num;        /* total # of find/insert attempts */
+	uint64_t add_num;         /* # of add ops */
+	uint64_t del_num;         /* # of entries deleted by timeout */
+	uint64_t reuse_num;       /* # of entries reused by timeout */
+	uint64_t fail_nospace;    /* # of 'no space' add failures */
+	uint64_t fail_src_limit;  /* # of 'per source limit' add failures */
+};
+
+/* a packet being reassembled */
+struct ip_frag_shard_entry {
+	struct ip_frag_pkt pkt;
+	uint32_t hash;        /* hash of the key */
+	uint32_t src_idx;     /* per source counter of the entry */
+	uint32_t hash_next;   /* next entry in the bucket, or free entry */
+	uint32_t wheel_prev;  /* previous entry in the wheel slot */
+	uint32_t wheel_next;  /* next entry in the wheel slot */
+	uint32_t slot;        /* wheel slot of the entry */
+} __rte_cache_aligned;
+
+struct rte_ip_frag_shard {
+	uint64_t max_cycles;         /* TTL of the entries */
+	uint64_t tick_cycles;        /* cycles per wheel tick */
+	uint64_t expire_tick;        /* start tick of the next slot to expire */
+	uint32_t max_entries;        /* entry array size */
+	uint32_t use_entries;        /* entries in use */
+	uint32_t max_entries_per_src; /* 0 for no limit */
+	uint32_t hash_mask;          /* number of buckets minus 1 */
+	uint32_t src_mask;           /* number of source counters minus 1 */
+	uint32_t free_head;          /* first free entry */
+	uint32_t wheel[IP_FRAG_WHEEL_SLOTS]; /* first entry of each slot */
+	uint32_t *buckets;           /* first entry of each bucket */
+	uint16_t *src_count;         /* entries per source hash */
+	struct ip_frag_shard_entry *entries;
+	struct ip_frag_shard_stat stat;
+} __rte_cache_aligned;
+
+struct rte_ip_frag_engine {
+	uint32_t nb_shards;
+	__extension__ struct rte_ip_frag_shard *shards[0];
+};
+
+static inline uint32_t
+ip_frag_key_hash(const struct ip_frag_key *key)
+{
+	const uint32_t *p = (const uint32_t *)key->src_dst;
+	uint32_t i, v = IP_FRAG_KEY_SEED;
+
+	for (i = 0; i != key->key_len * 2; i++)
+		v = rte_hash_crc_4byte(p[i], v);
+
+	return rte_hash_crc_4byte(key->id, v);
+}
+
+/* hash of the source address, the first word or 4 words of the key */
+static inline uint32_t
+ip_frag_src_hash(const struct ip_frag_key *key)
+{
+	const uint32_t *p = (const uint32_t *)key->src_dst;
+	uint32_t v;
+
+	v = rte_hash_crc_4byte(p[0], IP_FRAG_SRC_SEED);
+	if (key->key_len == IPV6_KEYLEN) {
+		v = rte_hash_crc_4byte(p[1], v);
+		v = rte_hash_crc_4byte(p[2], v);
+		v = rte_hash_crc_4byte(p[3], v);
+	}
+
+	return v;
+}
+
+static inline void
+shard_wheel_insert(struct rte_ip_frag_shard *shard, uint32_t idx,
+		uint64_t tms)
+{
+	struct ip_frag_shard_entry *e = &shard->entries[idx];
+	uint32_t slot, head;
+
+	slot = (tms / shard->tick_cycles) & (IP_FRAG_WHEEL_SLOTS - 1);
+	head = shard->wheel[slot];
+
+	e->slot = slot;
+	e->wheel_prev = IP_FRAG_INVALID_IDX;
+	e->wheel_next = head;
+	if (head != IP_FRAG_INVALID_IDX)
+		shard->entries[head].wheel_prev = idx;
+	shard->wheel[slot] = idx;
+}
+
+static inline void
+shard_wheel_remove(struct rte_ip_frag_shard *shard, uint32_t idx)
+{
+	struct ip_frag_shard_entry *e = &shard->entries[idx];
+
+	if (e->wheel_prev != IP_FRAG_INVALID_IDX)
+		shard->entries[e->wheel_prev].wheel_next = e->wheel_next;
+	else
+		shard->wheel[e->slot] = e->wheel_next;
+	if (e->wheel_next != IP_FRAG_INVALID_IDX)
+		shard->entries[e->wheel_next].wheel_prev = e->wheel_prev;
+}
+
+/* give back an entry, whose fragments are already freed or reassembled */
+static inline void
+shard_entry_release(struct rte_ip_frag_shard *shard, uint32_t idx)
+{
+	struct ip_frag_shard_entry *e = &shard->entries[idx];
+	uint32_t *pidx;
+
+	pidx = &shard->buckets[e->hash & shard->hash_mask];
+	while (*pidx != idx)
+		pidx = &shard->entries[*pidx].hash_next;
+	*pidx = e->hash_next;
+
+	shard_wheel_remove(shard, idx);
+	shard->src_count[e->src_idx]--;
+
+	ip_frag_key_invalidate(&e->pkt.key);
+	e->hash_next = shard->free_head;
+	shard->free_head = idx;
+	shard->use_entries--;
+}
+
+/* free the fragments of an expired entry and give it back */
+static inline void
+shard_entry_del(struct rte_ip_frag_shard *shard,
+		struct rte_ip_frag_death_row *dr, uint32_t idx)
+{
+	ip_frag_free(&shard->entries[idx].pkt, dr);
+	shard_entry_release(shard, idx);
+	IP_FRAG_TBL_STAT_UPDATE(&shard->stat, del_num, 1);
+}
+
+/* flush the death row, if it may not have room for one more fragment */
+static inline void
+ip_frag_dr_make_room(struct rte_ip_frag_death_row *dr)
+{
+	if (unlikely(dr->cnt > IP_FRAG_DEATH_ROW_MBUF_LEN - IP_FRAG_DR_ROOM))
+		rte_ip_frag_free_death_row(dr, IP_FRAG_DR_PREFETCH);
+}
+
+/*
+ * Find the entry of a key, or add one. Return NULL if the shard or the
+ * per source limit is full.
+ */
+static struct ip_frag_pkt *
+shard_find(struct rte_ip_frag_shard *shard, struct rte_ip_frag_death_row *dr,
+		const struct ip_frag_key *key, uint64_t tms)
+{
+	struct ip_frag_shard_entry *e;
+	uint32_t hash, idx, src_idx;
+
+	IP_FRAG_TBL_STAT_UPDATE(&shard->stat, find_num, 1);
+
+	hash = ip_frag_key_hash(key);
+	for (idx = shard->buckets[hash & shard->hash_mask];
+			idx != IP_FRAG_INVALID_IDX; idx = e->hash_next) {
+		e = &shard->entries[idx];
+		if (e->hash != hash || ip_frag_key_cmp(key, &e->pkt.key) != 0)
+			continue;
+
+		/* timed out but not expired yet, reuse it */
+		if (unlikely(shard->max_cycles + e->pkt.start < tms)) {
+			ip_frag_free(&e->pkt, dr);
+			ip_frag_reset(&e->pkt, tms);
+			shard_wheel_remove(shard, idx);
+			shard_wheel_insert(shard, idx, tms);
+			IP_FRAG_TBL_STAT_UPDATE(&shard->stat, reuse_num, 1);
+		}
+		return &e->pkt;
+	}
+
+	idx = shard->free_head;
+	if (unlikely(idx == IP_FRAG_INVALID_IDX)) {
+		IP_FRAG_TBL_STAT_UPDATE(&shard->stat, fail_nospace, 1);
+		return NULL;
+	}
+
+	/*
+	 * Without a limit, the counters are kept but never checked, so
+	 * they may wrap around when more than UINT16_MAX entries share one.
+	 */
+	src_idx = ip_frag_src_hash(key) & shard->src_mask;
+	if (unlikely(shard->max_entries_per_src != 0 &&
+			shard->src_count[src_idx] >=
+				shard->max_entries_per_src)) {
+		IP_FRAG_TBL_STAT_UPDATE(&shard->stat, fail_src_limit, 1);
+		return NULL;
+	}
+
+	e = &shard->entries[idx];
+	shard->free_head = e->hash_next;
+
+	e->pkt.key = *key;
+	ip_frag_reset(&e->pkt, tms);
+	e->hash = hash;
+	e->src_idx = src_idx;
+	e->hash_next = shard->buckets[hash & shard->hash_mask];
+	shard->buckets[hash & shard->hash_mask] = idx;
+	shard_wheel_insert(shard, idx, tms);
+	shard->src_count[src_idx]++;
+	shard->use_entries++;
+	IP_FRAG_TBL_STAT_UPDATE(&shard->stat, add_num, 1);
+
+	return &e->pkt;
+}
+
+/* add a fragment to its packet, return the packet once reassembled */
+static inline struct rte_mbuf *
+shard_process(struct rte_ip_frag_shard *shard,
+		struct rte_ip_frag_death_row *dr, struct rte_mbuf *mb,
+		const struct ip_frag_key *key, uint64_t tms,
+		uint16_t ofs, int32_t len, uint16_t more_frags)
+{
+	struct ip_frag_pkt *fp;
+
+	/* check that fragment length is greater then zero. */
+	if (len <= 0) {
+		IP_FRAG_MBUF2DR(dr, mb);
+		return NULL;
+	}
+
+	fp = shard_find(shard, dr, key, tms);
+	if (fp == NULL) {
+		IP_FRAG_MBUF2DR(dr, mb);
+		return NULL;
+	}
+
+	mb = ip_frag_process(fp, dr, mb, ofs, len, more_frags);
+
+	/* reassembled or erroneous packet, the entry is done */
+	if (ip_frag_key_is_empty(&fp->key))
+		shard_entry_release(shard,
+			(struct ip_frag_shard_entry *)fp - shard->entries);
+
+	return mb;
+}
+
+/* delete the timed out entries, sweeping the wheel slots up to now */
+static void
+shard_expire(struct rte_ip_frag_shard *shard,
+		struct rte_ip_frag_death_row *dr, uint64_t tms)
+{
+	struct ip_frag_shard_entry *e;
+	uint64_t now_tick, end_tick;
+	uint32_t idx, next;
+
+	now_tick = tms / shard->tick_cycles;
+	if (now_tick <= IP_FRAG_WHEEL_TTL_TICKS)
+		return;
+
+	/* the entries started before end_tick are timed out */
+	end_tick = now_tick - IP_FRAG_WHEEL_TTL_TICKS;
+
+	/* a slot holds the entries of several ticks, sweep it once */
+	if (end_tick - shard->expire_tick > IP_FRAG_WHEEL_SLOTS)
+		shard->expire_tick = end_tick - IP_FRAG_WHEEL_SLOTS;
+
+	for (; shard->expire_tick < end_tick; shard->expire_tick++) {
+		idx = shard->wheel[shard->expire_tick &
+			(IP_FRAG_WHEEL_SLOTS - 1)];
+		for (; idx != IP_FRAG_INVALID_IDX; idx = next) {
+			e = &shard->entries[idx];
+			next = e->wheel_next;
+			if (shard->max_cycles + e->pkt.start >= tms)
+				continue;
+			/* check that death row has enough space */
+			if (IP_FRAG_DEATH_ROW_MBUF_LEN - dr->cnt <
+					e->pkt.last_idx)
+				return;
+			shard_entry_del(shard, dr, idx);
+		}
+	}
+}
+
+/* free the shards, with the fragments they hold, and the engine */
+static void
+engine_free(struct rte_ip_frag_engine *engine)
+{
+	struct rte_ip_frag_shard *shard;
+	uint32_t i, j;
+
+	if (engine == NULL)
+		return;
+
+	for (i = 0; i != engine->nb_shards; i++) {
+		shard = engine->shards[i];
+		if (shard == NULL)
+			continue;
+		for (j = 0; j != shard->max_entries; j++)
+			if (!ip_frag_key_is_empty(&shard->entries[j].pkt.key))
+				ip_frag_free_immediate(&shard->entries[j].pkt);
+		rte_free(shard);
+	}
+
+	rte_free(engine);
+}
+
+struct rte_ip_frag_engine *
+rte_ip_frag_engine_create(const struct rte_ip_frag_engine_params *params)
+{
+	struct rte_ip_frag_engine *engine;
+	struct rte_ip_frag_shard *shard;
+	uint32_t i, j, nb_buckets, nb_src;
+	size_t sz;
+
+	if (params == NULL || params->nb_shards == 0 ||
+			params->max_entries == 0 ||
+			params->max_entries > (1U << 24) ||
+			params->max_entries_per_src > UINT16_MAX ||
+			params->max_cycles == 0) {
+		RTE_LOG(ERR, USER1, "%s: invalid input parameter\n", __func__);
+		return NULL;
+	}
+
+	engine = rte_zmalloc_socket(__func__, sizeof(*engine) +
+			params->nb_shards * sizeof(engine->shards[0]),
+			RTE_CACHE_LINE_SIZE, params->socket_id);
+	if (engine == NULL) {
+		RTE_LOG(ERR, USER1, "%s: allocation failed\n", __func__);
+		return NULL;
+	}
+	engine->nb_shards = params->nb_shards;
+
+	nb_buckets = rte_align32pow2(params->max_entries);
+	nb_src = nb_buckets;
+
+	for (i = 0; i != params->nb_shards; i++) {
+		sz = sizeof(*shard) +
+			params->max_entries * sizeof(shard->entries[0]) +
+			nb_buckets * sizeof(shard->buckets[0]) +
+			nb_src * sizeof(shard->src_count[0]);
+		shard = rte_zmalloc_socket(__func__, sz, RTE_CACHE_LINE_SIZE,
+				params->socket_id);
+		if (shard == NULL) {
+			RTE_LOG(ERR, USER1,
+				"%s: allocation of %zu bytes at socket %d failed\n",
+				__func__, sz, params->socket_id);
+			engine_free(engine);
+			return NULL;
+		}
+		engine->shards[i] = shard;
+
+		shard->entries = (struct ip_frag_shard_entry *)(shard + 1);
+		shard->buckets = (uint32_t *)(shard->entries +
+				params->max_entries);
+		shard->src_count = (uint16_t *)(shard->buckets + nb_buckets);
+
+		shard->max_cycles = params->max_cycles;
+		shard->tick_cycles = RTE_MAX(params->max_cycles /
+				IP_FRAG_WHEEL_TTL_TICKS, 1ULL);
+		/* round up, so that an entry expires within its TTL ticks */
+		if (shard->tick_cycles * IP_FRAG_WHEEL_TTL_TICKS <
+				params->max_cycles)
+			shard->tick_cycles++;
+		shard->max_entries = params->max_entries;
+		shard->max_entries_per_src = params->max_entries_per_src;
+		shard->hash_mask = nb_buckets - 1;
+		shard->src_mask = nb_src - 1;
+
+		for (j = 0; j != IP_FRAG_WHEEL_SLOTS; j++)
+			shard->wheel[j] = IP_FRAG_INVALID_IDX;
+		for (j = 0; j != nb_buckets; j++)
+			shard->buckets[j] = IP_FRAG_INVALID_IDX;
+		for (j = 0; j != params->max_entries; j++)
+			shard->entries[j].hash_next = j + 1;
+		shard->entries[params->max_entries - 1].hash_next =
+			IP_FRAG_INVALID_IDX;
+		shard->free_head = 0;
+	}
+
+	return engine;
+}
+
+void
+rte_ip_frag_engine_destroy(struct rte_ip_frag_engine *engine)
+{
+	engine_free(engine);
+}
+
+struct rte_ip_frag_shard *
+rte_ip_frag_engine_get_shard(const struct rte_ip_frag_engine *engine,
+		uint32_t shard_id)
+{
+	if (engine == NULL || shard_id >= engine->nb_shards)
+		return NULL;
+
+	return engine->shards[shard_id];
+}
+
+uint32_t
+rte_ip_frag_engine_shard_id(const struct rte_ip_frag_engine *engine,
+		const struct rte_mbuf *mb)
+{
+	const struct rte_ipv4_hdr *ip4_hdr;
+	const struct rte_ipv6_hdr *ip6_hdr;
+	const uint32_t *p;
+	uint32_t v;
+
+	if (mb->ol_flags & PKT_RX_RSS_HASH)
+		return mb->hash.rss % engine->nb_shards;
+
+	/* hash the addresses, like a RSS of the fragments */
+	ip4_hdr = rte_pktmbuf_mtod_offset(mb, const struct rte_ipv4_hdr *,
+			mb->l2_len);
+	if ((ip4_hdr->version_ihl >> 4) == 4) {
+		v = rte_hash_crc_4byte(ip4_hdr->src_addr, IP_FRAG_KEY_SEED);
+		v = rte_hash_crc_4byte(ip4_hdr->dst_addr, v);
+	} else {
+		ip6_hdr = (const struct rte_ipv6_hdr *)ip4_hdr;
+		p = (const uint32_t *)ip6_hdr->src_addr;
+		v = rte_hash_crc(p, 32, IP_FRAG_KEY_SEED);
+	}
+
+	return v % engine->nb_shards;
+}
+
+void
+rte_ip_frag_shard_expire(struct rte_ip_frag_shard *shard,
+		struct rte_ip_frag_death_row *dr, uint64_t tms)
+{
+	shard_expire(shard, dr, tms);
+}
+
+uint16_t
+rte_ipv4_frag_reassemble_burst(struct rte_ip_frag_shard *shard,
+		struct rte_ip_frag_death_row *dr, struct rte_mbuf **mbufs,
+		uint16_t nb_mbufs, uint64_t tms, struct rte_mbuf **out)
+{
+	struct rte_ipv4_hdr *ip_hdr;
+	struct ip_frag_key key;
+	struct rte_mbuf *mb;
+	const unaligned_uint64_t *psd;
+	uint16_t i, nb_out = 0, flag_offset, ip_ofs, ip_flag;
+	int32_t ip_len;
+
+	ip_frag_dr_make_room(dr);
+	shard_expire(shard, dr, tms);
+
+	key.key_len = IPV4_KEYLEN;
+
+	for (i = 0; i != nb_mbufs; i++) {
+		mb = mbufs[i];
+		ip_hdr = rte_pktmbuf_mtod_offset(mb, struct rte_ipv4_hdr *,
+				mb->l2_len);
+
+		flag_offset = rte_be_to_cpu_16(ip_hdr->fragment_offset);
+		ip_ofs = (uint16_t)(flag_offset & RTE_IPV4_HDR_OFFSET_MASK);
+		ip_flag = (uint16_t)(flag_offset & RTE_IPV4_HDR_MF_FLAG);
+
+		/* not a fragment, return it as is */
+		if (ip_ofs == 0 && ip_flag == 0) {
+			out[nb_out++] = mb;
+			continue;
+		}
+
+		psd = (unaligned_uint64_t *)&ip_hdr->src_addr;
+		/* use first 8 bytes only */
+		key.src_dst[0] = psd[0];
+		key.id = ip_hdr->packet_id;
+
+		ip_ofs *= RTE_IPV4_HDR_OFFSET_UNITS;
+		ip_len = rte_be_to_cpu_16(ip_hdr->total_length) - mb->l3_len;
+
+		ip_frag_dr_make_room(dr);
+		mb = shard_process(shard, dr, mb, &key, tms, ip_ofs, ip_len,
+				ip_flag);
+		if (mb != NULL)
+			out[nb_out++] = mb;
+	}
+
+	return nb_out;
+}
+
+uint16_t
+rte_ipv6_frag_reassemble_burst(struct rte_ip_frag_shard *shard,
+		struct rte_ip_frag_death_row *dr, struct rte_mbuf **mbufs,
+		uint16_t nb_mbufs, uint64_t tms, struct rte_mbuf **out)
+{
+	struct rte_ipv6_hdr *ip_hdr;
+	struct ipv6_extension_fragment *frag_hdr;
+	struct ip_frag_key key;
+	struct rte_mbuf *mb;
+	uint16_t i, nb_out = 0, ip_ofs;
+	int32_t ip_len;
+
+	ip_frag_dr_make_room(dr);
+	shard_expire(shard, dr, tms);
+
+	key.key_len = IPV6_KEYLEN;
+
+	for (i = 0; i != nb_mbufs; i++) {
+		mb = mbufs[i];
+		ip_hdr = rte_pktmbuf_mtod_offset(mb, struct rte_ipv6_hdr *,
+				mb->l2_len);
+
+		/* not a fragment, return it as is */
+		frag_hdr = rte_ipv6_frag_get_ipv6_fragment_header(ip_hdr);
+		if (frag_hdr == NULL) {
+			out[nb_out++] = mb;
+			continue;
+		}
+
+		rte_memcpy(&key.src_dst[0], ip_hdr->src_addr, 16);
+		rte_memcpy(&key.src_dst[2], ip_hdr->dst_addr, 16);
+		key.id = frag_hdr->id;
+
+		ip_ofs = IPV6_FRAG_OFFSET(frag_hdr->frag_data) * 8;
+		/* only the fragment header is supported, like in
+		 * rte_ipv6_frag_reassemble_packet()
+		 */
+		ip_len = rte_be_to_cpu_16(ip_hdr->payload_len) -
+			sizeof(*frag_hdr);
+
+		ip_frag_dr_make_room(dr);
+		mb = shard_process(shard, dr, mb, &key, tms, ip_ofs, ip_len,
+				IPV6_MORE_FRAGS(frag_hdr->frag_data));
+		if (mb != NULL)
+			out[nb_out++] = mb;
+	}
+
+	return nb_out;
+}
+
+void
+rte_ip_frag_engine_statistics_dump(FILE *f,
+		const struct rte_ip_frag_engine *engine)
+{
+	const struct rte_ip_frag_shard *shard;
+	uint32_t i;
+
+	for (i = 0; i != engine->nb_shards; i++) {
+		shard = engine->shards[i];
+		fprintf(f, "shard %u:\n"
+			"max entries:\t%u;\n"
+			"entries in use:\t%u;\n"
+			"finds/inserts:\t%" PRIu64 ";\n"
+			"entries added:\t%" PRIu64 ";\n"
+			"entries deleted by timeout:\t%" PRIu64 ";\n"
+			"entries reused by timeout:\t%" PRIu64 ";\n"
+			"add no-space failures:\t%" PRIu64 ";\n"
+			"add per source limit failures:\t%" PRIu64 ";\n",
+			i,
+			shard->max_entries,
+			shard->use_entries,
+			shard->stat.find_num,
+			shard->stat.add_num,
+			shard->stat.del_num,
+			shard->stat.reuse_num,
+			shard->stat.fail_nospace,
+			shard->stat.fail_src_limit);
+	}
+}
@@ -35,6 +35,10 @@ EAL_REGISTER_TAILQ(rte_lpm_tailq)
 
 #define MAX_DEPTH_TBL24 24
 
+/* Saved LPM file identification and layout version */
+#define LPM_FILE_MAGIC		0x344d504c /* "LPM4" */
+#define LPM_FILE_VERSION	1
+
 enum valid_flag {
 	INVALID = 0,
 	VALID
@@ -1065,3 +1069,187 @@ rte_lpm_delete_all(struct rte_lpm *lpm)
 	/* Delete all rules form the rules table. */
 	memset(lpm->rules_tbl, 0, sizeof(lpm->rules_tbl[0]) * lpm->max_rules);
 }
+
+/*
+ * Header of a saved LPM, followed by the rule info, the rules in use,
+ * the tbl24, then the index and entries of each tbl8 group in use.
+ */
+struct lpm_file_hdr {
+	uint32_t magic;
+	uint32_t version;
+	uint32_t max_rules;
+	uint32_t number_tbl8s;
+	uint32_t nb_rules; /**< Number of saved rules. */
+	uint32_t nb_tbl8s; /**< Number of saved tbl8 groups. */
+};
+
+static inline int
+is_tbl8_used(const struct rte_lpm *lpm, uint32_t group_idx)
+{
+	return lpm->tbl8[group_idx * RTE_LPM_TBL8_GROUP_NUM_ENTRIES].valid_group;
+}
+
+int
+rte_lpm_save(struct rte_lpm *lpm, const char *filename)
+{
+	struct lpm_file_hdr hdr;
+	uint32_t i;
+	FILE *f;
+	int ret = 0;
+
+	if ((lpm == NULL) || (filename == NULL))
+		return -EINVAL;
+
+	memset(&hdr, 0, sizeof(hdr));
+	hdr.magic = LPM_FILE_MAGIC;
+	hdr.version = LPM_FILE_VERSION;
+	hdr.max_rules = lpm->max_rules;
+	hdr.number_tbl8s = lpm->number_tbl8s;
+	/* rule groups are stored in order of depth, up to the last one used */
+	for (i = 0; i < RTE_LPM_MAX_DEPTH; i++)
+		if (lpm->rule_info[i].used_rules != 0)
+			hdr.nb_rules = lpm->rule_info[i].first_rule +
+				lpm->rule_info[i].used_rules;
+	for (i = 0; i < lpm->number_tbl8s; i++)
+		hdr.nb_tbl8s += is_tbl8_used(lpm, i);
+
+	f = fopen(filename, "w");
+	if (f == NULL)
+		return -errno;
+
+	if ((fwrite(&hdr, sizeof(hdr), 1, f) != 1) ||
+			(fwrite(lpm->rule_info, sizeof(lpm->rule_info), 1,
+			f) != 1) ||
+			(fwrite(lpm->rules_tbl, sizeof(lpm->rules_tbl[0]),
+			hdr.nb_rules, f) != hdr.nb_rules) ||
+			(fwrite(lpm->tbl24, sizeof(lpm->tbl24), 1, f) != 1))
+		ret = -EIO;
+
+	for (i = 0; (i < lpm->number_tbl8s) && (ret == 0); i++) {
+		if (!is_tbl8_used(lpm, i))
+			continue;
+		if ((fwrite(&i, sizeof(i), 1, f) != 1) ||
+				(fwrite(&lpm->tbl8[i *
+				RTE_LPM_TBL8_GROUP_NUM_ENTRIES],
+				sizeof(lpm->tbl8[0]),
+				RTE_LPM_TBL8_GROUP_NUM_ENTRIES, f) !=
+				RTE_LPM_TBL8_GROUP_NUM_ENTRIES))
+			ret = -EIO;
+	}
+
+	if ((fclose(f) != 0) && (ret == 0))
+		ret = -EIO;
+
+	return ret;
+}
+
+/*
+ * Check that the restored rule groups fit in the saved rules and that
+ * every tbl24 entry extended to a tbl8 points to a restored group.
+ */
+static int
+lpm_restore_check(const struct rte_lpm *lpm, uint32_t nb_rules)
+{
+	const struct rte_lpm_rule_info *info;
+	uint32_t i, next_rule = 0;
+
+	for (i = 0; i < RTE_LPM_MAX_DEPTH; i++) {
+		info = &lpm->rule_info[i];
+		if (info->used_rules == 0) {
+			if (info->first_rule > lpm->max_rules)
+				return -EINVAL;
+			continue;
+		}
+		/* groups are stored in order of depth and can not overlap */
+		if ((info->first_rule < next_rule) ||
+				(info->first_rule > nb_rules) ||
+				(info->used_rules >
+				nb_rules - info->first_rule))
+			return -EINVAL;
+		next_rule = info->first_rule + info->used_rules;
+	}
+
+	for (i = 0; i < RTE_LPM_TBL24_NUM_ENTRIES; i++) {
+		if (!lpm->tbl24[i].valid || !lpm->tbl24[i].valid_group)
+			continue;
+		if ((lpm->tbl24[i].next_hop >= lpm->number_tbl8s) ||
+				!is_tbl8_used(lpm, lpm->tbl24[i].next_hop))
+			return -EINVAL;
+	}
+
+	return 0;
+}
+
+struct rte_lpm *
+rte_lpm_restore(const char *name, int socket_id, const char *filename)
+{
+	struct rte_lpm_config config;
+	struct lpm_file_hdr hdr;
+	struct rte_lpm *lpm;
+	uint32_t i, group_idx;
+	FILE *f;
+	int ret = 0;
+
+	if ((name == NULL) || (filename == NULL)) {
+		rte_errno = EINVAL;
+		return NULL;
+	}
+
+	f = fopen(filename, "r");
+	if (f == NULL) {
+		rte_errno = errno;
+		return NULL;
+	}
+
+	if ((fread(&hdr, sizeof(hdr), 1, f) != 1) ||
+			(hdr.magic != LPM_FILE_MAGIC) ||
+			(hdr.version != LPM_FILE_VERSION) ||
+			(hdr.nb_rules > hdr.max_rules) ||
+			(hdr.nb_tbl8s > hdr.number_tbl8s)) {
+		fclose(f);
+		rte_errno = EINVAL;
+		return NULL;
+	}
+
+	config.max_rules = hdr.max_rules;
+	config.number_tbl8s = hdr.number_tbl8s;
+	config.flags = 0;
+	lpm = rte_lpm_create(name, socket_id, &config);
+	if (lpm == NULL) {
+		fclose(f);
+		return NULL;
+	}
+
+	if ((fread(lpm->rule_info, sizeof(lpm->rule_info), 1, f) != 1) ||
+			(fread(lpm->rules_tbl, sizeof(lpm->rules_tbl[0]),
+			hdr.nb_rules, f) != hdr.nb_rules) ||
+			(fread(lpm->tbl24, sizeof(lpm->tbl24), 1, f) != 1))
+		ret = -EIO;
+
+	for (i = 0; (i < hdr.nb_tbl8s) && (ret == 0); i++) {
+		if (fread(&group_idx, sizeof(group_idx), 1, f) != 1)
+			ret = -EIO;
+		else if (group_idx >= lpm->number_tbl8s)
+			ret = -EINVAL;
+		else if (fread(&lpm->tbl8[group_idx *
+				RTE_LPM_TBL8_GROUP_NUM_ENTRIES],
+				sizeof(lpm->tbl8[0]),
+				RTE_LPM_TBL8_GROUP_NUM_ENTRIES, f) !=
+				RTE_LPM_TBL8_GROUP_NUM_ENTRIES)
+			ret = -EIO;
+	}
+	fclose(f);
+
+	if (ret == 0)
+		ret = lpm_restore_check(lpm, hdr.nb_rules);
+
+	if (ret != 0) {
+		RTE_LOG(ERR, LPM, "Can not restore LPM %s from %s, err %d\n",
+			name, filename, ret);
+		rte_lpm_free(lpm);
+		rte_errno = -ret;
+		return NULL;
+	}
+
+	return lpm;
+}
@@ -19,6 +19,7 @@
 #include <rte_config.h>
 #include <rte_memory.h>
 #include <rte_common.h>
+#include <rte_compat.h>
 #include <rte_vect.h>
 
 #ifdef __cplusplus
@@ -239,6 +240,51 @@ rte_lpm_delete(struct rte_lpm *lpm, uint32_t ip, uint8_t depth);
 void
 rte_lpm_delete_all(struct rte_lpm *lpm);
 
+/**
+ * @warning
+ * @b EXPERIMENTAL: this API may change without prior notice
+ *
+ * Save an LPM table to a file.
+ *
+ * The rules and the tbl24 are written as they are, followed by the tbl8
+ * groups in use, to be restored by rte_lpm_restore() on the same
+ * architecture. Lookups can go on while the table is saved but it must
+ * not be modified.
+ *
+ * @param lpm
+ *   LPM object handle
+ * @param filename
+ *   Path of the file to write
+ * @return
+ *   0 on success, negative errno value otherwise
+ */
+__rte_experimental
+int
+rte_lpm_save(struct rte_lpm *lpm, const char *filename);
+
+/**
+ * @warning
+ * @b EXPERIMENTAL: this API may change without prior notice
+ *
+ * Create an LPM table from a file written by rte_lpm_save().
+ *
+ * The table is created with the saved configuration, then its rules and
+ * tables are loaded without adding the rules again.
+ *
+ * @param name
+ *   LPM object name
+ * @param socket_id
+ *   NUMA socket ID for LPM table memory allocation
+ * @param filename
+ *   Path of the file to read
+ * @return
+ *   Handle to LPM object on success, NULL otherwise with rte_errno set
+ *   to an appropriate values.
+ */
+__rte_experimental
+struct rte_lpm *
+rte_lpm_restore(const char *name, int socket_id, const char *filename);
+
 /**
  * Lookup an IP into the LPM table.
  *
@@ -21,9 +21,8 @@
 #include <rte_errno.h>
 #include <rte_rwlock.h>
 #include <rte_spinlock.h>
-#include <rte_hash.h>
 #include <assert.h>
-#include <rte_jhash.h>
+#include <rte_rib6.h>
 #include <rte_tailq.h>
 #include <rte_function_versioning.h>
 
@@ -42,7 +41,6 @@
 #define BYTE_SIZE                                 8
 #define BYTES2_SIZE                              16
 
-#define RULE_HASH_TABLE_EXTRA_SPACE              64
 #define TBL24_IND                        UINT32_MAX
 
 #define lpm6_tbl8_gindex next_hop
@@ -78,12 +76,6 @@ struct rte_lpm6_rule {
 	uint8_t depth; /**< Rule depth. */
 };
 
-/** Rules tbl entry key. */
-struct rte_lpm6_rule_key {
-	uint8_t ip[RTE_LPM6_IPV6_ADDR_SIZE]; /**< Rule IP address. */
-	uint8_t depth; /**< Rule depth. */
-};
-
 /* Header of tbl8 */
 struct rte_lpm_tbl8_hdr {
 	uint32_t owner_tbl_ind; /**< owner table: TBL24_IND if owner is tbl24,
@@ -104,7 +96,7 @@ struct rte_lpm6 {
 	uint32_t number_tbl8s;           /**< Number of tbl8s to allocate. */
 
 	/* LPM Tables. */
-	struct rte_hash *rules_tbl; /**< LPM rules. */
+	struct rte_rib6 *rules_tbl; /**< LPM rules. */
 	struct rte_lpm6_tbl_entry tbl24[RTE_LPM6_TBL24_NUM_ENTRIES]
 			__rte_cache_aligned; /**< LPM tbl24 table. */
 
@@ -148,19 +140,6 @@ ip6_copy_addr(uint8_t *dst, const uint8_t *src)
 	rte_memcpy(dst, src, RTE_LPM6_IPV6_ADDR_SIZE);
 }
 
-/*
- * LPM6 rule hash function
- *
- * It's used as a hash function for the rte_hash
- *	containing rules
- */
-static inline uint32_t
-rule_hash(const void *data, __rte_unused uint32_t data_len,
-		  uint32_t init_val)
-{
-	return rte_jhash(data, sizeof(struct rte_lpm6_rule_key), init_val);
-}
-
 /*
  * Init pool of free tbl8 indexes
  */
@@ -214,33 +193,6 @@ tbl8_available(struct rte_lpm6 *lpm)
 	return lpm->number_tbl8s - lpm->tbl8_pool_pos;
 }
 
-/*
- * Init a rule key.
- *	  note that ip must be already masked
- */
-static inline void
-rule_key_init(struct rte_lpm6_rule_key *key, uint8_t *ip, uint8_t depth)
-{
-	ip6_copy_addr(key->ip, ip);
-	key->depth = depth;
-}
-
-/*
- * Rebuild the entire LPM tree by reinserting all rules
- */
-static void
-rebuild_lpm(struct rte_lpm6 *lpm)
-{
-	uint64_t next_hop;
-	struct rte_lpm6_rule_key *rule_key;
-	uint32_t iter = 0;
-
-	while (rte_hash_iterate(lpm->rules_tbl, (void *) &rule_key,
-			(void **) &next_hop, &iter) >= 0)
-		rte_lpm6_add(lpm, rule_key->ip, rule_key->depth,
-			(uint32_t) next_hop);
-}
-
 /*
  * Allocates memory for LPM object
  */
@@ -253,7 +205,7 @@ rte_lpm6_create(const char *name, int socket_id,
 	struct rte_tailq_entry *te;
 	uint64_t mem_size;
 	struct rte_lpm6_list *lpm_list;
-	struct rte_hash *rules_tbl = NULL;
+	struct rte_rib6 *rules_tbl = NULL;
 	uint32_t *tbl8_pool = NULL;
 	struct rte_lpm_tbl8_hdr *tbl8_hdrs = NULL;
 
@@ -269,23 +221,19 @@ rte_lpm6_create(const char *name, int socket_id,
 		return NULL;
 	}
 
-	/* create rules hash table */
+	/*
+	 * create rules RIB, it holds the rules and the intermediate nodes
+	 * joining them
+	 */
 	snprintf(mem_name, sizeof(mem_name), "LRH_%s", name);
-	struct rte_hash_parameters rule_hash_tbl_params = {
-		.entries = config->max_rules * 1.2 +
-			RULE_HASH_TABLE_EXTRA_SPACE,
-		.key_len = sizeof(struct rte_lpm6_rule_key),
-		.hash_func = rule_hash,
-		.hash_func_init_val = 0,
-		.name = mem_name,
-		.reserved = 0,
-		.socket_id = socket_id,
-		.extra_flag = 0
+	struct rte_rib6_conf rule_rib_conf = {
+		.ext_sz = 0,
+		.max_nodes = config->max_rules * 2,
 	};
 
-	rules_tbl = rte_hash_create(&rule_hash_tbl_params);
+	rules_tbl = rte_rib6_create(mem_name, socket_id, &rule_rib_conf);
 	if (rules_tbl == NULL) {
-		RTE_LOG(ERR, LPM, "LPM rules hash table allocation failed: %s (%d)",
+		RTE_LOG(ERR, LPM, "LPM rules RIB allocation failed: %s (%d)",
 				  rte_strerror(rte_errno), rte_errno);
 		goto fail_wo_unlock;
 	}
@@ -374,7 +322,7 @@ rte_lpm6_create(const char *name, int socket_id,
 fail_wo_unlock:
 	rte_free(tbl8_hdrs);
 	rte_free(tbl8_pool);
-	rte_hash_free(rules_tbl);
+	rte_rib6_free(rules_tbl);
 
 	return NULL;
 }
@@ -437,42 +385,27 @@ rte_lpm6_free(struct rte_lpm6 *lpm)
 
 	rte_free(lpm->tbl8_hdrs);
 	rte_free(lpm->tbl8_pool);
-	rte_hash_free(lpm->rules_tbl);
+	rte_rib6_free(lpm->rules_tbl);
 	rte_free(lpm);
 	rte_free(te);
 }
 
-/* Find a rule */
-static inline int
-rule_find_with_key(struct rte_lpm6 *lpm,
-		  const struct rte_lpm6_rule_key *rule_key,
-		  uint32_t *next_hop)
-{
-	uint64_t hash_val;
-	int ret;
-
-	/* lookup for a rule */
-	ret = rte_hash_lookup_data(lpm->rules_tbl, (const void *) rule_key,
-		(void **) &hash_val);
-	if (ret >= 0) {
-		*next_hop = (uint32_t) hash_val;
-		return 1;
-	}
-
-	return 0;
-}
-
 /* Find a rule */
 static int
 rule_find(struct rte_lpm6 *lpm, uint8_t *ip, uint8_t depth,
 		  uint32_t *next_hop)
 {
-	struct rte_lpm6_rule_key rule_key;
+	struct rte_rib6_node *node;
+	uint64_t nh;
 
-	/* init a rule key */
-	rule_key_init(&rule_key, ip, depth);
+	/* lookup for a rule */
+	node = rte_rib6_lookup_exact(lpm->rules_tbl, ip, depth);
+	if (node == NULL)
+		return 0;
 
-	return rule_find_with_key(lpm, &rule_key, next_hop);
+	rte_rib6_get_nh(node, &nh);
+	*next_hop = (uint32_t) nh;
+	return 1;
 }
 
 /*
@@ -487,36 +420,31 @@ rule_find(struct rte_lpm6 *lpm, uint8_t *ip, uint8_t depth,
 static inline int
 rule_add(struct rte_lpm6 *lpm, uint8_t *ip, uint8_t depth, uint32_t next_hop)
 {
-	int ret, rule_exist;
-	struct rte_lpm6_rule_key rule_key;
-	uint32_t unused;
-
-	/* init a rule key */
-	rule_key_init(&rule_key, ip, depth);
+	struct rte_rib6_node *node;
 
-	/* Scan through rule list to see if rule already exists. */
-	rule_exist = rule_find_with_key(lpm, &rule_key, &unused);
+	/* Check if the rule already exists, update its next hop if so. */
+	node = rte_rib6_lookup_exact(lpm->rules_tbl, ip, depth);
+	if (node != NULL) {
+		rte_rib6_set_nh(node, next_hop);
+		return 0;
+	}
 
 	/*
 	 * If rule does not exist check if there is space to add a new rule to
 	 * this rule group. If there is no space return error.
 	 */
-	if (!rule_exist && lpm->used_rules == lpm->max_rules)
+	if (lpm->used_rules == lpm->max_rules)
 		return -ENOSPC;
 
-	/* add the rule or update rules next hop */
-	ret = rte_hash_add_key_data(lpm->rules_tbl, &rule_key,
-		(void *)(uintptr_t) next_hop);
-	if (ret < 0)
-		return ret;
+	/* add the rule */
+	node = rte_rib6_insert(lpm->rules_tbl, ip, depth);
+	if (node == NULL)
+		return -rte_errno;
+	rte_rib6_set_nh(node, next_hop);
 
 	/* Increment the used rules counter for this rule group. */
-	if (!rule_exist) {
-		lpm->used_rules++;
-		return 1;
-	}
-
-	return 0;
+	lpm->used_rules++;
+	return 1;
 }
 
 /*
@@ -1038,68 +966,60 @@ rte_lpm6_is_rule_present(struct rte_lpm6 *lpm, uint8_t *ip, uint8_t depth,
 }
 
 /*
- * Delete a rule from the rule table.
+ * Delete a rule from the rule table, and find the less specific rule
+ * (a rule with smaller depth) now covering its address range.
  * NOTE: Valid range for depth parameter is 1 .. 128 inclusive.
  * return
- *	  0 on success
+ *	  1 on success, a less specific rule is found
+ *	  0 on success, there is no less specific rule
  *   <0 on failure
  */
 static inline int
-rule_delete(struct rte_lpm6 *lpm, uint8_t *ip, uint8_t depth)
+rule_delete(struct rte_lpm6 *lpm, uint8_t *ip, uint8_t depth,
+	struct rte_lpm6_rule *lsp_rule)
 {
-	int ret;
-	struct rte_lpm6_rule_key rule_key;
+	struct rte_rib6_node *node, *parent;
+	uint64_t next_hop;
+
+	node = rte_rib6_lookup_exact(lpm->rules_tbl, ip, depth);
+	if (node == NULL)
+		return -ENOENT;
 
-	/* init rule key */
-	rule_key_init(&rule_key, ip, depth);
+	/* the closest valid ancestor in the RIB is the less specific rule */
+	parent = rte_rib6_lookup_parent(node);
+	if (parent != NULL) {
+		rte_rib6_get_ip(parent, lsp_rule->ip);
+		rte_rib6_get_depth(parent, &lsp_rule->depth);
+		rte_rib6_get_nh(parent, &next_hop);
+		lsp_rule->next_hop = (uint32_t) next_hop;
+	}
 
 	/* delete the rule */
-	ret = rte_hash_del_key(lpm->rules_tbl, (void *) &rule_key);
-	if (ret >= 0)
-		lpm->used_rules--;
+	rte_rib6_remove(lpm->rules_tbl, ip, depth);
+	lpm->used_rules--;
 
-	return ret;
+	return parent != NULL;
 }
 
 /*
  * Deletes a group of rules
  *
- * Note that the function rebuilds the lpm table,
- * rather than doing incremental updates like
- * the regular delete function
+ * Each rule is deleted like with the regular delete function, only
+ * rewriting the table ranges it occupies.
  */
 int
 rte_lpm6_delete_bulk_func(struct rte_lpm6 *lpm,
 		uint8_t ips[][RTE_LPM6_IPV6_ADDR_SIZE], uint8_t *depths,
 		unsigned n)
 {
-	uint8_t masked_ip[RTE_LPM6_IPV6_ADDR_SIZE];
 	unsigned i;
 
 	/* Check input arguments. */
 	if ((lpm == NULL) || (ips == NULL) || (depths == NULL))
 		return -EINVAL;
 
-	for (i = 0; i < n; i++) {
-		ip6_copy_addr(masked_ip, ips[i]);
-		ip6_mask_addr(masked_ip, depths[i]);
-		rule_delete(lpm, masked_ip, depths[i]);
-	}
-
-	/*
-	 * Set all the table entries to 0 (ie delete every rule
-	 * from the data structure.
-	 */
-	memset(lpm->tbl24, 0, sizeof(lpm->tbl24));
-	memset(lpm->tbl8, 0, sizeof(lpm->tbl8[0])
-			* RTE_LPM6_TBL8_GROUP_NUM_ENTRIES * lpm->number_tbl8s);
-	tbl8_pool_init(lpm);
-
-	/*
-	 * Add every rule again (except for the ones that were removed from
-	 * the rules table).
-	 */
-	rebuild_lpm(lpm);
+	for (i = 0; i < n; i++)
+		rte_lpm6_delete(lpm, ips[i], depths[i]);
 
 	return 0;
 }
@@ -1110,6 +1030,11 @@ rte_lpm6_delete_bulk_func(struct rte_lpm6 *lpm,
 void
 rte_lpm6_delete_all(struct rte_lpm6 *lpm)
 {
+	static const uint8_t zero_ip[RTE_LPM6_IPV6_ADDR_SIZE];
+	uint8_t ip[RTE_LPM6_IPV6_ADDR_SIZE];
+	struct rte_rib6_node *node;
+	uint8_t depth;
+
 	/* Zero used rules counter. */
 	lpm->used_rules = 0;
 
@@ -1124,7 +1049,12 @@ rte_lpm6_delete_all(struct rte_lpm6 *lpm)
 	tbl8_pool_init(lpm);
 
 	/* Delete all rules form the rules table. */
-	rte_hash_reset(lpm->rules_tbl);
+	while ((node = rte_rib6_get_nxt(lpm->rules_tbl, zero_ip, 0, NULL,
+			RTE_RIB6_GET_NXT_ALL)) != NULL) {
+		rte_rib6_get_ip(node, ip);
+		rte_rib6_get_depth(node, &depth);
+		rte_rib6_remove(lpm->rules_tbl, ip, depth);
+	}
 }
 
 /*
@@ -1140,46 +1070,6 @@ depth_to_mask_1b(uint8_t depth)
 	return (signed char)0x80 >> (depth - 1);
 }
 
-/*
- * Find a less specific rule
- */
-static int
-rule_find_less_specific(struct rte_lpm6 *lpm, uint8_t *ip, uint8_t depth,
-	struct rte_lpm6_rule *rule)
-{
-	int ret;
-	uint32_t next_hop;
-	uint8_t mask;
-	struct rte_lpm6_rule_key rule_key;
-
-	if (depth == 1)
-		return 0;
-
-	rule_key_init(&rule_key, ip, depth);
-
-	while (depth > 1) {
-		depth--;
-
-		/* each iteration zero one more bit of the key */
-		mask = depth & 7; /* depth % BYTE_SIZE */
-		if (mask > 0)
-			mask = depth_to_mask_1b(mask);
-
-		rule_key.depth = depth;
-		rule_key.ip[depth >> 3] &= mask;
-
-		ret = rule_find_with_key(lpm, &rule_key, &next_hop);
-		if (ret) {
-			rule->depth = depth;
-			ip6_copy_addr(rule->ip, rule_key.ip);
-			rule->next_hop = next_hop;
-			return 1;
-		}
-	}
-
-	return 0;
-}
-
 /*
  * Find range of tbl8 cells occupied by a rule
  */
@@ -1308,21 +1198,17 @@ rte_lpm6_delete(struct rte_lpm6 *lpm, uint8_t *ip, uint8_t depth)
 	ip6_copy_addr(masked_ip, ip);
 	ip6_mask_addr(masked_ip, depth);
 
-	/* Delete the rule from the rule table. */
-	ret = rule_delete(lpm, masked_ip, depth);
+	/* Delete the rule from the rule table and find a less specific
+	 * rule (a rule with smaller depth)
+	 */
+	ret = rule_delete(lpm, masked_ip, depth, &lsp_rule_obj);
 	if (ret < 0)
 		return -ENOENT;
+	lsp_rule = ret ? &lsp_rule_obj : NULL;
 
 	/* find rule cells */
 	rule_find_range(lpm, masked_ip, depth, &from, &to, &tbl_ind);
 
-	/* find a less specific rule (a rule with smaller depth)
-	 * note: masked_ip will be modified, don't use it anymore
-	 */
-	ret = rule_find_less_specific(lpm, masked_ip, depth,
-			&lsp_rule_obj);
-	lsp_rule = ret ? &lsp_rule_obj : NULL;
-
 	/* decrement the table rule counter,
 	 * note that tbl24 doesn't have a header
 	 */
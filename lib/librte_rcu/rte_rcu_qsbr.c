@@ -18,9 +18,50 @@
 #include <rte_per_lcore.h>
 #include <rte_lcore.h>
 #include <rte_errno.h>
+#include <rte_ring_elem.h>
 
 #include "rte_rcu_qsbr.h"
 
+/* Size of the token stored in front of each defer queue element */
+#define __RTE_QSBR_TOKEN_SIZE sizeof(uint64_t)
+
+/* RTE defer queue structure.
+ * This structure holds the defer queue. The defer queue is used to
+ * hold the deleted entries from the data structure that are not
+ * yet freed.
+ */
+struct rte_rcu_qsbr_dq {
+	struct rte_rcu_qsbr *v; /**< RCU QSBR variable used by this queue.*/
+	struct rte_ring *r;     /**< RCU QSBR defer queue. */
+	uint32_t size;
+	/**< Number of elements in the defer queue */
+	uint32_t esize;
+	/**< Size (in bytes) of data, including the token, stored on the
+	 *   defer queue.
+	 */
+	uint32_t trigger_reclaim_limit;
+	/**< Trigger automatic reclamation after the defer queue
+	 *   has at least these many resources waiting.
+	 */
+	uint32_t max_reclaim_size;
+	/**< Reclaim at the max these many resources during auto
+	 *   reclamation.
+	 */
+	rte_rcu_qsbr_free_resource_t free_fn;
+	/**< Function to call to free the resource. */
+	void *p;
+	/**< Pointer passed to the free function. Typically, this is the
+	 *   pointer to the data structure to which the resource to free
+	 *   belongs.
+	 */
+	uint32_t head_valid;
+	/**< Set when 'head' holds the oldest element, already dequeued
+	 *   from the ring, whose grace period was not over yet.
+	 */
+	uint8_t head[0] __rte_aligned(sizeof(uint64_t));
+	/**< Storage for the oldest element, 'esize' bytes. */
+};
+
 /* Get the memory size of QSBR variable */
 size_t
 rte_rcu_qsbr_get_memsize(uint32_t max_threads)
@@ -270,6 +311,218 @@ rte_rcu_qsbr_dump(FILE *f, struct rte_rcu_qsbr *v)
 	return 0;
 }
 
+/* Create a queue used to store the data structure elements that can
+ * be freed later. This queue is referred to as 'defer queue'.
+ */
+struct rte_rcu_qsbr_dq *
+rte_rcu_qsbr_dq_create(const struct rte_rcu_qsbr_dq_parameters *params)
+{
+	struct rte_rcu_qsbr_dq *dq;
+	uint32_t qs_fifo_size;
+	unsigned int esize;
+	char rcu_dq_name[RTE_RING_NAMESIZE];
+
+	if (params == NULL || params->free_fn == NULL ||
+		params->v == NULL || params->name == NULL ||
+		params->size == 0 || params->esize == 0 ||
+		(params->esize % 4 != 0)) {
+		rte_log(RTE_LOG_ERR, rte_rcu_log_type,
+			"%s(): Invalid input parameter\n", __func__);
+		rte_errno = EINVAL;
+
+		return NULL;
+	}
+	/* If auto reclamation is configured, reclaim limit
+	 * should be a valid value.
+	 */
+	if ((params->trigger_reclaim_limit <= params->size) &&
+	    (params->max_reclaim_size == 0)) {
+		rte_log(RTE_LOG_ERR, rte_rcu_log_type,
+			"%s(): Invalid input parameter, size = %u, trigger_reclaim_limit = %u, max_reclaim_size = %u\n",
+			__func__, params->size, params->trigger_reclaim_limit,
+			params->max_reclaim_size);
+		rte_errno = EINVAL;
+
+		return NULL;
+	}
+
+	/* Add token size to ring element size */
+	esize = params->esize + __RTE_QSBR_TOKEN_SIZE;
+
+	dq = rte_zmalloc(NULL, sizeof(struct rte_rcu_qsbr_dq) + esize,
+		RTE_CACHE_LINE_SIZE);
+	if (dq == NULL) {
+		rte_errno = ENOMEM;
+
+		return NULL;
+	}
+
+	/* Allocate the ring. The caller serializes the accesses to the
+	 * defer queue, hence single producer/single consumer is enough.
+	 */
+	snprintf(rcu_dq_name, sizeof(rcu_dq_name), "RCU_DQ_%s", params->name);
+	qs_fifo_size = params->size;
+	dq->r = rte_ring_create_elem(rcu_dq_name, esize, qs_fifo_size,
+			SOCKET_ID_ANY, RING_F_SP_ENQ | RING_F_SC_DEQ |
+			RING_F_EXACT_SZ);
+	if (dq->r == NULL) {
+		rte_log(RTE_LOG_ERR, rte_rcu_log_type,
+			"%s(): defer queue create failed\n", __func__);
+		rte_free(dq);
+		return NULL;
+	}
+
+	dq->v = params->v;
+	dq->size = params->size;
+	dq->esize = esize;
+	dq->trigger_reclaim_limit = params->trigger_reclaim_limit;
+	dq->max_reclaim_size = params->max_reclaim_size;
+	dq->free_fn = params->free_fn;
+	dq->p = params->p;
+
+	return dq;
+}
+
+/* Enqueue one resource to the defer queue to free after the grace
+ * period is over.
+ */
+int
+rte_rcu_qsbr_dq_enqueue(struct rte_rcu_qsbr_dq *dq, void *e)
+{
+	uint64_t token;
+	uint32_t cnt;
+
+	if (dq == NULL || e == NULL) {
+		rte_log(RTE_LOG_ERR, rte_rcu_log_type,
+			"%s(): Invalid input parameter\n", __func__);
+		rte_errno = EINVAL;
+
+		return 1;
+	}
+
+	/* Start the grace period */
+	token = rte_rcu_qsbr_start(dq->v);
+
+	/* Reclaim resources if the queue size has hit the reclaim
+	 * limit. This helps the queue from growing too large and
+	 * allows time for reader threads to report their quiescent state.
+	 */
+	cnt = rte_ring_count(dq->r) + dq->head_valid;
+	if (cnt >= dq->trigger_reclaim_limit) {
+		__RTE_RCU_DP_LOG(DEBUG, "Triggering reclamation");
+		rte_rcu_qsbr_dq_reclaim(dq, dq->max_reclaim_size,
+					NULL, NULL, NULL);
+	}
+
+	/* The queue can be full if the readers have not reported their
+	 * quiescent state for a while. Try to make space before failing.
+	 * The oldest resource kept aside by the reclamation counts
+	 * against the queue size.
+	 */
+	if (rte_ring_count(dq->r) + dq->head_valid >= dq->size) {
+		rte_rcu_qsbr_dq_reclaim(dq, dq->max_reclaim_size == 0 ?
+					dq->size : dq->max_reclaim_size,
+					NULL, NULL, NULL);
+		if (rte_ring_count(dq->r) + dq->head_valid >= dq->size) {
+			rte_log(RTE_LOG_ERR, rte_rcu_log_type,
+				"%s(): Enqueue failed\n", __func__);
+			rte_errno = ENOSPC;
+
+			return 1;
+		}
+	}
+
+	/* Enqueue the token and resource */
+	char data[dq->esize];
+	memcpy(data, &token, __RTE_QSBR_TOKEN_SIZE);
+	memcpy(data + __RTE_QSBR_TOKEN_SIZE, e,
+		dq->esize - __RTE_QSBR_TOKEN_SIZE);
+	rte_ring_sp_enqueue_elem(dq->r, data, dq->esize);
+
+	return 0;
+}
+
+/* Reclaim resources from the defer queue. */
+int
+rte_rcu_qsbr_dq_reclaim(struct rte_rcu_qsbr_dq *dq, unsigned int n,
+			unsigned int *freed, unsigned int *pending,
+			unsigned int *available)
+{
+	uint32_t cnt;
+	uint64_t token;
+
+	if (dq == NULL || n == 0) {
+		rte_log(RTE_LOG_ERR, rte_rcu_log_type,
+			"%s(): Invalid input parameter\n", __func__);
+		rte_errno = EINVAL;
+
+		return 1;
+	}
+
+	cnt = 0;
+	while (cnt < n) {
+		/* The oldest resource is kept aside until its grace
+		 * period is over, so that the resources are freed in
+		 * the order they were enqueued.
+		 */
+		if (dq->head_valid == 0) {
+			if (rte_ring_sc_dequeue_elem(dq->r, dq->head,
+						dq->esize) != 0)
+				break;
+			dq->head_valid = 1;
+		}
+
+		memcpy(&token, dq->head, __RTE_QSBR_TOKEN_SIZE);
+
+		/* Reclaim the entry only if the grace period is over */
+		if (rte_rcu_qsbr_check(dq->v, token, false) != 1)
+			break;
+
+		/* Free the resource */
+		dq->free_fn(dq->p, dq->head + __RTE_QSBR_TOKEN_SIZE, 1);
+		dq->head_valid = 0;
+
+		cnt++;
+	}
+
+	__RTE_RCU_DP_LOG(DEBUG, "Reclaimed %u resources", cnt);
+
+	if (freed != NULL)
+		*freed = cnt;
+	if (pending != NULL)
+		*pending = rte_ring_count(dq->r) + dq->head_valid;
+	if (available != NULL)
+		*available = dq->size - rte_ring_count(dq->r) - dq->head_valid;
+
+	return 0;
+}
+
+/* Delete a defer queue. */
+int
+rte_rcu_qsbr_dq_delete(struct rte_rcu_qsbr_dq *dq)
+{
+	unsigned int pending;
+
+	if (dq == NULL) {
+		__RTE_RCU_DP_LOG(DEBUG, "Invalid input parameter");
+
+		return 0;
+	}
+
+	/* Reclaim all the resources */
+	rte_rcu_qsbr_dq_reclaim(dq, ~0, NULL, &pending, NULL);
+	if (pending != 0) {
+		rte_errno = EAGAIN;
+
+		return 1;
+	}
+
+	rte_ring_free(dq->r);
+	rte_free(dq);
+
+	return 0;
+}
+
 int rte_rcu_log_type;
 
 RTE_INIT(rte_rcu_register)
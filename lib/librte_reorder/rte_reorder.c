@@ -6,11 +6,15 @@
 #include <string.h>
 
 #include <rte_string_fns.h>
+#include <rte_cycles.h>
 #include <rte_log.h>
 #include <rte_mbuf.h>
+#include <rte_mbuf_dyn.h>
 #include <rte_eal_memconfig.h>
 #include <rte_errno.h>
 #include <rte_malloc.h>
+#include <rte_pause.h>
+#include <rte_spinlock.h>
 #include <rte_tailq.h>
 
 #include "rte_reorder.h"
@@ -29,6 +33,18 @@ EAL_REGISTER_TAILQ(rte_reorder_tailq)
 /* Macros for printing using RTE_LOG */
 #define RTE_LOGTYPE_REORDER	RTE_LOGTYPE_USER1
 
+int rte_reorder_seqn_dynfield_offset = -1;
+
+/* Concurrent mode occupancy bitmap, one bit per order buffer slot */
+#define REORDER_BMP_SHIFT	6
+#define REORDER_BMP_BITS	(1U << REORDER_BMP_SHIFT)
+#define REORDER_BMP_MASK	(REORDER_BMP_BITS - 1)
+
+/* States of is_initialized in concurrent mode */
+#define REORDER_UNINIT		0
+#define REORDER_INIT_BUSY	1
+#define REORDER_READY		2
+
 /* A generic circular buffer */
 struct cir_buffer {
 	unsigned int size;   /**< Number of entries that can be stored */
@@ -46,8 +62,20 @@ struct rte_reorder_buffer {
 	struct cir_buffer ready_buf; /**< temp buffer for dequeued entries */
 	struct cir_buffer order_buf; /**< buffer used to reorder entries */
 	int is_initialized;
+	uint32_t flags;       /**< RTE_REORDER_F_* flags */
+	uint64_t gap_timeout; /**< cycles to wait on a gap before skipping */
+	uint64_t gap_tsc;     /**< time the drain got stalled on a gap */
+	rte_spinlock_t drain_lock; /**< serializes concurrent drainers */
+	int seqn_off;         /**< offset of the sequence number in mbufs */
+	uint64_t *occupied;   /**< concurrent mode bitmap of filled slots */
 } __rte_cache_aligned;
 
+static inline uint32_t
+reorder_seqn(const struct rte_reorder_buffer *b, const struct rte_mbuf *m)
+{
+	return *RTE_MBUF_DYNFIELD(m, b->seqn_off, const uint32_t *);
+}
+
 static void
 rte_reorder_free_mbufs(struct rte_reorder_buffer *b);
 
@@ -86,6 +114,7 @@ rte_reorder_init(struct rte_reorder_buffer *b, unsigned int bufsize,
 	memset(b, 0, bufsize);
 	strlcpy(b->name, name, sizeof(b->name));
 	b->memsize = bufsize;
+	b->seqn_off = offsetof(struct rte_mbuf, seqn);
 	b->order_buf.size = b->ready_buf.size = size;
 	b->order_buf.mask = b->ready_buf.mask = size - 1;
 	b->ready_buf.entries = (void *)&b[1];
@@ -95,30 +124,100 @@ rte_reorder_init(struct rte_reorder_buffer *b, unsigned int bufsize,
 	return b;
 }
 
-struct rte_reorder_buffer*
-rte_reorder_create(const char *name, unsigned socket_id, unsigned int size)
+static unsigned int
+reorder_memsize_mt(unsigned int size)
+{
+	return sizeof(struct rte_reorder_buffer) +
+		size * sizeof(struct rte_mbuf *) +
+		RTE_ALIGN_CEIL(size, REORDER_BMP_BITS) / CHAR_BIT;
+}
+
+/*
+ * In concurrent mode the order buffer entries are the only storage: slot
+ * (seqn & mask) holds the mbuf with that sequence number, inserters claim
+ * it with a compare-and-swap and drainers take it back out. Once the slot
+ * is filled, its bit is set in the occupied bitmap, which the drain scans
+ * for runs of filled slots 64 at a time.
+ */
+static void
+reorder_init_mt(struct rte_reorder_buffer *b, unsigned int bufsize,
+		const char *name, unsigned int size, uint64_t gap_timeout)
+{
+	memset(b, 0, bufsize);
+	strlcpy(b->name, name, sizeof(b->name));
+	b->memsize = bufsize;
+	b->flags = RTE_REORDER_F_MT;
+	b->gap_timeout = gap_timeout;
+	b->seqn_off = offsetof(struct rte_mbuf, seqn);
+	b->order_buf.size = size;
+	b->order_buf.mask = size - 1;
+	b->order_buf.entries = (void *)&b[1];
+	b->occupied = RTE_PTR_ADD(&b[1], size * sizeof(struct rte_mbuf *));
+	rte_spinlock_init(&b->drain_lock);
+}
+
+static int
+reorder_seqn_dynfield_register(void)
+{
+	static const struct rte_mbuf_dynfield reorder_seqn_dynfield_desc = {
+		.name = RTE_REORDER_SEQN_DYNFIELD_NAME,
+		.size = sizeof(rte_reorder_seqn_t),
+		.align = __alignof__(rte_reorder_seqn_t),
+	};
+	int offset;
+
+	offset = rte_mbuf_dynfield_register(&reorder_seqn_dynfield_desc);
+	if (offset < 0) {
+		RTE_LOG(ERR, REORDER, "Failed to register mbuf field "
+			"for reorder sequence number\n");
+		return -1;
+	}
+	rte_reorder_seqn_dynfield_offset = offset;
+	return 0;
+}
+
+struct rte_reorder_buffer *
+rte_reorder_create_params(const struct rte_reorder_params *params)
 {
 	struct rte_reorder_buffer *b = NULL;
 	struct rte_tailq_entry *te;
 	struct rte_reorder_list *reorder_list;
-	const unsigned int bufsize = sizeof(struct rte_reorder_buffer) +
-					(2 * size * sizeof(struct rte_mbuf *));
+	unsigned int bufsize, size;
+	const char *name;
 
 	reorder_list = RTE_TAILQ_CAST(rte_reorder_tailq.head, rte_reorder_list);
 
 	/* Check user arguments. */
+	if (params == NULL || params->name == NULL) {
+		RTE_LOG(ERR, REORDER, "Invalid reorder buffer name ptr:"
+					" NULL\n");
+		rte_errno = EINVAL;
+		return NULL;
+	}
+	name = params->name;
+	size = params->size;
 	if (!rte_is_power_of_2(size)) {
 		RTE_LOG(ERR, REORDER, "Invalid reorder buffer size"
 				" - Not a power of 2\n");
 		rte_errno = EINVAL;
 		return NULL;
 	}
-	if (name == NULL) {
-		RTE_LOG(ERR, REORDER, "Invalid reorder buffer name ptr:"
-					" NULL\n");
+	if ((params->flags & ~(RTE_REORDER_F_MT |
+				RTE_REORDER_F_SEQN_DYNFIELD)) != 0 ||
+			(params->gap_timeout != 0 &&
+			 !(params->flags & RTE_REORDER_F_MT))) {
+		RTE_LOG(ERR, REORDER, "Invalid reorder buffer flags\n");
 		rte_errno = EINVAL;
 		return NULL;
 	}
+	if ((params->flags & RTE_REORDER_F_SEQN_DYNFIELD) &&
+			reorder_seqn_dynfield_register() != 0)
+		return NULL;
+
+	if (params->flags & RTE_REORDER_F_MT)
+		bufsize = reorder_memsize_mt(size);
+	else
+		bufsize = sizeof(*b) + 2 * size * sizeof(struct rte_mbuf *);
 
 	rte_mcfg_tailq_write_lock();
 
@@ -141,13 +240,22 @@ rte_reorder_create(const char *name, unsigned socket_id, unsigned int size)
 	}
 
 	/* Allocate memory to store the reorder buffer structure. */
-	b = rte_zmalloc_socket("REORDER_BUFFER", bufsize, 0, socket_id);
+	b = rte_zmalloc_socket("REORDER_BUFFER", bufsize, 0,
+			params->socket_id);
 	if (b == NULL) {
 		RTE_LOG(ERR, REORDER, "Memzone allocation failed\n");
 		rte_errno = ENOMEM;
 		rte_free(te);
 	} else {
-		rte_reorder_init(b, bufsize, name, size);
+		if (params->flags & RTE_REORDER_F_MT)
+			reorder_init_mt(b, bufsize, name, size,
+					params->gap_timeout);
+		else
+			rte_reorder_init(b, bufsize, name, size);
+		if (params->flags & RTE_REORDER_F_SEQN_DYNFIELD) {
+			b->flags |= RTE_REORDER_F_SEQN_DYNFIELD;
+			b->seqn_off = rte_reorder_seqn_dynfield_offset;
+		}
 		te->data = (void *)b;
 		TAILQ_INSERT_TAIL(reorder_list, te, next);
 	}
@@ -157,15 +265,35 @@ rte_reorder_create(const char *name, unsigned socket_id, unsigned int size)
 	return b;
 }
 
+struct rte_reorder_buffer*
+rte_reorder_create(const char *name, unsigned socket_id, unsigned int size)
+{
+	struct rte_reorder_params params = {
+		.name = name,
+		.socket_id = socket_id,
+		.size = size,
+	};
+
+	return rte_reorder_create_params(&params);
+}
+
 void
 rte_reorder_reset(struct rte_reorder_buffer *b)
 {
 	char name[RTE_REORDER_NAMESIZE];
+	uint32_t flags = b->flags;
+	int seqn_off = b->seqn_off;
 
 	rte_reorder_free_mbufs(b);
 	strlcpy(name, b->name, sizeof(name));
 	/* No error checking as current values should be valid */
-	rte_reorder_init(b, b->memsize, name, b->order_buf.size);
+	if (flags & RTE_REORDER_F_MT)
+		reorder_init_mt(b, b->memsize, name, b->order_buf.size,
+				b->gap_timeout);
+	else
+		rte_reorder_init(b, b->memsize, name, b->order_buf.size);
+	b->flags = flags;
+	b->seqn_off = seqn_off;
 }
 
 static void
@@ -177,6 +305,8 @@ rte_reorder_free_mbufs(struct rte_reorder_buffer *b)
 	for (i = 0; i < b->order_buf.size; i++) {
 		if (b->order_buf.entries[i])
 			rte_pktmbuf_free(b->order_buf.entries[i]);
+		if (b->flags & RTE_REORDER_F_MT)
+			continue;
 		if (b->ready_buf.entries[i])
 			rte_pktmbuf_free(b->ready_buf.entries[i]);
 	}
@@ -297,10 +427,137 @@ rte_reorder_fill_overflow(struct rte_reorder_buffer *b, unsigned n)
 	return order_head_adv;
 }
 
+/*
+ * The first inserted mbuf sets the start of the sequence window, as in
+ * single-threaded mode. Inserters racing with it wait until it is set.
+ */
+static void
+reorder_mt_start(struct rte_reorder_buffer *b, uint32_t seqn)
+{
+	int state = REORDER_UNINIT;
+
+	if (__atomic_compare_exchange_n(&b->is_initialized, &state,
+			REORDER_INIT_BUSY, 0, __ATOMIC_ACQUIRE,
+			__ATOMIC_ACQUIRE)) {
+		__atomic_store_n(&b->min_seqn, seqn, __ATOMIC_RELAXED);
+		__atomic_store_n(&b->is_initialized, REORDER_READY,
+				__ATOMIC_RELEASE);
+		return;
+	}
+
+	while (__atomic_load_n(&b->is_initialized, __ATOMIC_ACQUIRE) !=
+			REORDER_READY)
+		rte_pause();
+}
+
+/*
+ * Claim the slot of the mbuf and return its index in *pos. The caller
+ * still has to mark it in the occupied bitmap for the drain to see it.
+ */
+static inline int
+reorder_mt_claim(struct rte_reorder_buffer *b, struct rte_mbuf *mbuf,
+		uint32_t *pos)
+{
+	struct cir_buffer *order_buf = &b->order_buf;
+	struct rte_mbuf *empty = NULL;
+	uint32_t seqn, offset;
+
+	seqn = reorder_seqn(b, mbuf);
+	if (unlikely(__atomic_load_n(&b->is_initialized, __ATOMIC_ACQUIRE) !=
+			REORDER_READY))
+		reorder_mt_start(b, seqn);
+
+	/*
+	 * Same error codes as the single-threaded insert, except that an
+	 * early mbuf never moves the window by itself: the drain does that.
+	 */
+	offset = seqn - __atomic_load_n(&b->min_seqn, __ATOMIC_ACQUIRE);
+	if (offset >= order_buf->size) {
+		rte_errno = (offset < 2 * order_buf->size) ? ENOSPC : ERANGE;
+		return -1;
+	}
+
+	/*
+	 * The slot is only still taken if a late mbuf was stored there
+	 * around a gap skip and has not been drained yet. Reading it empty
+	 * orders the drain clearing its bit before the one set here.
+	 */
+	*pos = seqn & order_buf->mask;
+	if (!__atomic_compare_exchange_n(&order_buf->entries[*pos], &empty,
+			mbuf, 0, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+		rte_errno = ENOSPC;
+		return -1;
+	}
+
+	/*
+	 * A gap skip may have moved the window past seqn since it was
+	 * checked, the slot then belonging to seqn + size: give it back.
+	 * The drain catches the mbufs stored just before the window moved.
+	 */
+	offset = seqn - __atomic_load_n(&b->min_seqn, __ATOMIC_ACQUIRE);
+	if (unlikely(offset >= order_buf->size)) {
+		__atomic_store_n(&order_buf->entries[*pos], NULL,
+				__ATOMIC_RELAXED);
+		rte_errno = ERANGE;
+		return -1;
+	}
+
+	return 0;
+}
+
+/* Publish filled slots to the drain, along with the mbufs stored in them */
+static inline void
+reorder_mt_mark(struct rte_reorder_buffer *b, uint32_t word, uint64_t bits)
+{
+	__atomic_fetch_or(&b->occupied[word], bits, __ATOMIC_RELEASE);
+}
+
+static inline int
+reorder_insert_mt(struct rte_reorder_buffer *b, struct rte_mbuf *mbuf)
+{
+	uint32_t pos;
+
+	if (reorder_mt_claim(b, mbuf, &pos) != 0)
+		return -1;
+
+	reorder_mt_mark(b, pos >> REORDER_BMP_SHIFT,
+			1ULL << (pos & REORDER_BMP_MASK));
+	return 0;
+}
+
+/*
+ * Consecutive sequence numbers share bitmap words, so a burst only needs
+ * one atomic update per word it touches.
+ */
+static unsigned int
+reorder_insert_burst_mt(struct rte_reorder_buffer *b,
+		struct rte_mbuf **mbufs, unsigned int nb_mbufs)
+{
+	uint32_t i, pos, word = UINT32_MAX;
+	uint64_t bits = 0;
+
+	for (i = 0; i != nb_mbufs; i++) {
+		if (reorder_mt_claim(b, mbufs[i], &pos) != 0)
+			break;
+		if ((pos >> REORDER_BMP_SHIFT) != word) {
+			if (bits != 0)
+				reorder_mt_mark(b, word, bits);
+			word = pos >> REORDER_BMP_SHIFT;
+			bits = 0;
+		}
+		bits |= 1ULL << (pos & REORDER_BMP_MASK);
+	}
+
+	if (bits != 0)
+		reorder_mt_mark(b, word, bits);
+
+	return i;
+}
+
 int
 rte_reorder_insert(struct rte_reorder_buffer *b, struct rte_mbuf *mbuf)
 {
-	uint32_t offset, position;
+	uint32_t seqn, offset, position;
 	struct cir_buffer *order_buf;
 
 	if (b == NULL || mbuf == NULL) {
@@ -308,9 +565,13 @@ rte_reorder_insert(struct rte_reorder_buffer *b, struct rte_mbuf *mbuf)
 		return -1;
 	}
 
+	if (b->flags & RTE_REORDER_F_MT)
+		return reorder_insert_mt(b, mbuf);
+
 	order_buf = &b->order_buf;
+	seqn = reorder_seqn(b, mbuf);
 	if (!b->is_initialized) {
-		b->min_seqn = mbuf->seqn;
+		b->min_seqn = seqn;
 		b->is_initialized = 1;
 	}
 
@@ -322,7 +583,7 @@ rte_reorder_insert(struct rte_reorder_buffer *b, struct rte_mbuf *mbuf)
 	 *	mbuf_seqn = 0x0010
 	 *	offset    = 0x0010 - 0xFFFD = 0x13
 	 */
-	offset = mbuf->seqn - b->min_seqn;
+	offset = seqn - b->min_seqn;
 
 	/*
 	 * action to take depends on offset.
@@ -352,7 +613,7 @@ rte_reorder_insert(struct rte_reorder_buffer *b, struct rte_mbuf *mbuf)
 			rte_errno = ENOSPC;
 			return -1;
 		}
-		offset = mbuf->seqn - b->min_seqn;
+		offset = seqn - b->min_seqn;
 		position = (order_buf->head + offset) & order_buf->mask;
 		order_buf->entries[position] = mbuf;
 	} else {
@@ -363,6 +624,201 @@ rte_reorder_insert(struct rte_reorder_buffer *b, struct rte_mbuf *mbuf)
 	return 0;
 }
 
+unsigned int
+rte_reorder_insert_burst(struct rte_reorder_buffer *b,
+		struct rte_mbuf **mbufs, unsigned int nb_mbufs)
+{
+	unsigned int i;
+
+	if (b == NULL || mbufs == NULL) {
+		rte_errno = EINVAL;
+		return 0;
+	}
+
+	if (b->flags & RTE_REORDER_F_MT)
+		return reorder_insert_burst_mt(b, mbufs, nb_mbufs);
+
+	for (i = 0; i != nb_mbufs; i++) {
+		if (rte_reorder_insert(b, mbufs[i]) != 0)
+			break;
+	}
+
+	return i;
+}
+
+/*
+ * Return the number of filled slots in a row from head, up to max. The
+ * complement of a bitmap word gives the length of the run of filled slots
+ * within the word from its first trailing one. Bits past the end of a
+ * window smaller than a word are never set, so a run never goes beyond
+ * the end of the order buffer within a word.
+ */
+static inline uint32_t
+reorder_mt_run(const struct rte_reorder_buffer *b, uint32_t head,
+		uint32_t max)
+{
+	uint32_t idx, bit, n = 0;
+	uint64_t holes;
+
+	/* with all slots filled, the run would wrap into the next lap */
+	max = RTE_MIN(max, b->order_buf.size);
+	while (n < max) {
+		idx = (head + n) & b->order_buf.mask;
+		bit = idx & REORDER_BMP_MASK;
+		holes = ~__atomic_load_n(&b->occupied[idx >> REORDER_BMP_SHIFT],
+				__ATOMIC_ACQUIRE) >> bit;
+		if (holes == 0) {
+			n += REORDER_BMP_BITS - bit;
+			continue;
+		}
+		n += __builtin_ctzll(holes);
+		break;
+	}
+
+	return RTE_MIN(n, max);
+}
+
+/* Clear the bits of n slots from head, before the slots are emptied */
+static inline void
+reorder_mt_clear(struct rte_reorder_buffer *b, uint32_t head, uint32_t n)
+{
+	uint32_t idx, bit, len;
+	uint64_t bits;
+
+	while (n != 0) {
+		idx = head & b->order_buf.mask;
+		bit = idx & REORDER_BMP_MASK;
+		len = RTE_MIN(n, REORDER_BMP_BITS - bit);
+		len = RTE_MIN(len, b->order_buf.size - idx);
+		bits = (len == REORDER_BMP_BITS) ? UINT64_MAX :
+			((1ULL << len) - 1) << bit;
+		__atomic_fetch_and(&b->occupied[idx >> REORDER_BMP_SHIFT],
+				~bits, __ATOMIC_RELAXED);
+		head += len;
+		n -= len;
+	}
+}
+
+/*
+ * Return the distance from head to the first occupied slot of the window,
+ * or 0 if the whole window is empty.
+ */
+static uint32_t
+reorder_mt_next(const struct rte_reorder_buffer *b, uint32_t head)
+{
+	const struct cir_buffer *order_buf = &b->order_buf;
+	uint32_t idx, bit, n = 1;
+	uint64_t filled;
+
+	while (n < order_buf->size) {
+		idx = (head + n) & order_buf->mask;
+		bit = idx & REORDER_BMP_MASK;
+		filled = __atomic_load_n(&b->occupied[idx >> REORDER_BMP_SHIFT],
+				__ATOMIC_RELAXED) >> bit;
+		if (filled != 0) {
+			n += __builtin_ctzll(filled);
+			return (n < order_buf->size) ? n : 0;
+		}
+		n += RTE_MIN(REORDER_BMP_BITS - bit, order_buf->size - idx);
+	}
+
+	return 0;
+}
+
+/*
+ * Called with the drain stalled on an empty head slot. Returns how far
+ * the head may be moved to skip the gap: non-zero only once the drain has
+ * been stalled for gap_timeout cycles with mbufs waiting behind the gap.
+ */
+static uint32_t
+reorder_mt_gap(struct rte_reorder_buffer *b, uint32_t head)
+{
+	uint64_t now;
+	uint32_t skip;
+
+	if (b->gap_timeout == 0)
+		return 0;
+
+	now = rte_get_timer_cycles();
+	if (b->gap_tsc != 0 && now - b->gap_tsc < b->gap_timeout)
+		return 0;
+
+	skip = reorder_mt_next(b, head);
+	if (skip == 0)
+		/* nothing waits behind the gap, restart the timer later */
+		b->gap_tsc = 0;
+	else if (b->gap_tsc == 0) {
+		b->gap_tsc = now;
+		skip = 0;
+	}
+
+	return skip;
+}
+
+static unsigned int
+reorder_drain_mt(struct rte_reorder_buffer *b, struct rte_mbuf **mbufs,
+		unsigned int max_mbufs)
+{
+	struct cir_buffer *order_buf = &b->order_buf;
+	uint32_t head, pos, skip, late, i, n;
+
+	/* another drainer owns the head, let it make progress */
+	if (!rte_spinlock_trylock(&b->drain_lock))
+		return 0;
+
+	if (__atomic_load_n(&b->is_initialized, __ATOMIC_ACQUIRE) !=
+			REORDER_READY) {
+		rte_spinlock_unlock(&b->drain_lock);
+		return 0;
+	}
+
+	head = b->min_seqn;
+	n = reorder_mt_run(b, head, max_mbufs);
+	if (n == 0 && max_mbufs != 0) {
+		skip = reorder_mt_gap(b, head);
+		if (skip != 0) {
+			head += skip;
+			n = reorder_mt_run(b, head, max_mbufs);
+		}
+	}
+
+	if (n != 0) {
+		late = 0;
+		for (i = 0; i != n; i++) {
+			mbufs[i] = order_buf->entries[(head + i) &
+					order_buf->mask];
+			/*
+			 * A late mbuf stored in the slot of seqn + size around
+			 * a gap skip is returned, but its slot stays in the
+			 * window for the mbuf it belongs to.
+			 */
+			if (unlikely(reorder_seqn(b, mbufs[i]) != head + i)) {
+				n = i + 1;
+				late = 1;
+				break;
+			}
+		}
+		/*
+		 * Clear the bits before freeing the slots: an inserter can
+		 * only claim a slot once it reads empty, so the bit it sets
+		 * afterwards is not lost. The slots have to read empty to
+		 * inserters before they can see the window moved past them.
+		 */
+		reorder_mt_clear(b, head, n);
+		for (i = 0; i != n; i++) {
+			pos = (head + i) & order_buf->mask;
+			__atomic_store_n(&order_buf->entries[pos], NULL,
+					__ATOMIC_RELEASE);
+		}
+		b->gap_tsc = 0;
+		__atomic_store_n(&b->min_seqn, head + n - late,
+				__ATOMIC_RELEASE);
+	}
+
+	rte_spinlock_unlock(&b->drain_lock);
+	return n;
+}
+
 unsigned int
 rte_reorder_drain(struct rte_reorder_buffer *b, struct rte_mbuf **mbufs,
 		unsigned max_mbufs)
@@ -372,9 +828,13 @@ rte_reorder_drain(struct rte_reorder_buffer *b, struct rte_mbuf **mbufs,
 	struct cir_buffer *order_buf = &b->order_buf,
 			*ready_buf = &b->ready_buf;
 
+	if (b->flags & RTE_REORDER_F_MT)
+		return reorder_drain_mt(b, mbufs, max_mbufs);
+
 	/* Try to fetch requested number of mbufs from ready buffer */
 	while ((drain_cnt < max_mbufs) && (ready_buf->tail != ready_buf->head)) {
 		mbufs[drain_cnt++] = ready_buf->entries[ready_buf->tail];
+		ready_buf->entries[ready_buf->tail] = NULL;
 		ready_buf->tail = (ready_buf->tail + 1) & ready_buf->mask;
 	}
 
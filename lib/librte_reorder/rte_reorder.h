@@ -15,7 +15,9 @@
  *
  */
 
+#include <rte_compat.h>
 #include <rte_mbuf.h>
+#include <rte_mbuf_dyn.h>
 
 #ifdef __cplusplus
 extern "C" {
@@ -23,6 +25,69 @@ extern "C" {
 
 struct rte_reorder_buffer;
 
+/**
+ * Concurrent mode: any number of lcores may call rte_reorder_insert() and
+ * rte_reorder_insert_burst() on the buffer at the same time, without
+ * locking, and any number of lcores may call rte_reorder_drain().
+ */
+#define RTE_REORDER_F_MT	(1 << 0)
+
+/**
+ * Take the sequence number of mbufs from the reorder dynamic field, see
+ * rte_reorder_seqn(), instead of the seqn field of struct rte_mbuf.
+ */
+#define RTE_REORDER_F_SEQN_DYNFIELD	(1 << 1)
+
+/** Name of the mbuf dynamic field holding the reorder sequence number */
+#define RTE_REORDER_SEQN_DYNFIELD_NAME "rte_reorder_seqn_dynfield"
+
+/** Reorder sequence number, as stored in the mbuf dynamic field */
+typedef uint32_t rte_reorder_seqn_t;
+
+/**
+ * Offset of the reorder sequence number dynamic field in mbufs, registered
+ * on the creation of a reorder buffer with RTE_REORDER_F_SEQN_DYNFIELD.
+ * -1 until then.
+ */
+extern int rte_reorder_seqn_dynfield_offset;
+
+/**
+ * @warning
+ * @b EXPERIMENTAL: this API may change without prior notice
+ *
+ * Get a pointer to the reorder sequence number dynamic field of an mbuf.
+ * Only valid once a reorder buffer has been created with the
+ * RTE_REORDER_F_SEQN_DYNFIELD flag.
+ *
+ * @param mbuf
+ *   The mbuf.
+ * @return
+ *   Pointer to the sequence number of the mbuf.
+ */
+__rte_experimental
+static inline rte_reorder_seqn_t *
+rte_reorder_seqn(struct rte_mbuf *mbuf)
+{
+	return RTE_MBUF_DYNFIELD(mbuf, rte_reorder_seqn_dynfield_offset,
+		rte_reorder_seqn_t *);
+}
+
+/** Parameters for rte_reorder_create_params() */
+struct rte_reorder_params {
+	const char *name;  /**< Name of the reorder buffer */
+	int socket_id;     /**< NUMA node to allocate the buffer on */
+	unsigned int size; /**< Reorder window size, a power of 2 */
+	uint32_t flags;    /**< RTE_REORDER_F_* flags */
+	/**
+	 * Concurrent mode only: once the drain has been held up by a
+	 * missing sequence number for that many timer cycles (see
+	 * rte_get_timer_hz()), skip it and return the packets behind it.
+	 * 0 waits for the missing packet forever, as in single-threaded
+	 * mode.
+	 */
+	uint64_t gap_timeout;
+};
+
 /**
  * Create a new reorder buffer instance
  *
@@ -45,6 +110,37 @@ struct rte_reorder_buffer;
 struct rte_reorder_buffer *
 rte_reorder_create(const char *name, unsigned socket_id, unsigned int size);
 
+/**
+ * @warning
+ * @b EXPERIMENTAL: this API may change without prior notice
+ *
+ * Create a new reorder buffer instance with extended parameters
+ *
+ * In concurrent mode (RTE_REORDER_F_MT), workers insert mbufs straight
+ * into their slot of the sequence window with an atomic operation.
+ * Drainers take turns: a drainer finding another one in progress returns
+ * no packets rather than waiting, and each burst returned is in order
+ * and follows the previous one. The window only moves on drain, so an
+ * insert ahead of the window fails with ENOSPC until the drain catches up.
+ *
+ * With RTE_REORDER_F_SEQN_DYNFIELD, the mbuf dynamic field for the
+ * sequence number is registered if needed, and all inserts of this buffer
+ * read the sequence number from it.
+ *
+ * @param params
+ *   Parameters of the reorder buffer
+ * @return
+ *   The initialized reorder buffer instance, or NULL on error
+ *   On error case, rte_errno will be set appropriately:
+ *    - ENOMEM - no appropriate memory area found in which to create memzone
+ *    - EINVAL - invalid parameters
+ *    - other values set by rte_mbuf_dynfield_register() on failure to
+ *      register the sequence number field
+ */
+__rte_experimental
+struct rte_reorder_buffer *
+rte_reorder_create_params(const struct rte_reorder_params *params);
+
 /**
  * Initializes given reorder buffer instance
  *
@@ -125,6 +221,33 @@ rte_reorder_free(struct rte_reorder_buffer *b);
 int
 rte_reorder_insert(struct rte_reorder_buffer *b, struct rte_mbuf *mbuf);
 
+/**
+ * @warning
+ * @b EXPERIMENTAL: this API may change without prior notice
+ *
+ * Insert a burst of mbufs in reorder buffer
+ *
+ * Inserts the mbufs in order as rte_reorder_insert() would, stopping at
+ * the first mbuf which cannot be inserted. In concurrent mode, mbufs with
+ * consecutive sequence numbers are published to the drain together, so
+ * inserting them as a burst is cheaper than one at a time.
+ *
+ * @param b
+ *   Reorder buffer where the mbufs have to be inserted.
+ * @param mbufs
+ *   Array of mbufs to insert.
+ * @param nb_mbufs
+ *   Number of mbufs in the array.
+ * @return
+ *   Number of mbufs inserted from the start of the array. If less than
+ *   nb_mbufs, rte_errno is set as by rte_reorder_insert() for the first
+ *   mbuf not inserted, which stays owned by the caller.
+ */
+__rte_experimental
+unsigned int
+rte_reorder_insert_burst(struct rte_reorder_buffer *b,
+		struct rte_mbuf **mbufs, unsigned int nb_mbufs);
+
 /**
  * Fetch reordered buffers
  *
@@ -133,6 +256,11 @@ rte_reorder_insert(struct rte_reorder_buffer *b, struct rte_mbuf *mbuf);
  * delayed too long before reaching the reorder window, or have been previously
  * dropped by the system.
  *
+ * In concurrent mode, a gap is only skipped once it is older than the
+ * configured gap timeout. A late mbuf inserted while its gap was being
+ * skipped is either rejected with ERANGE, or returned after the packets
+ * which followed it.
+ *
  * @param b
  *   Reorder buffer instance from which packets are to be drained
  * @param mbufs
@@ -5,6 +5,8 @@
 
 #include <stdbool.h>
 #include <stdint.h>
+#include <stdio.h>
+#include <string.h>
 
 #include <rte_eal.h>
 #include <rte_eal_memconfig.h>
@@ -391,6 +393,214 @@ rte_rib_set_nh(struct rte_rib_node *node, uint64_t nh)
 	return 0;
 }
 
+/* Children flags of a saved node record */
+#define RIB_REC_LEFT		0x40
+#define RIB_REC_RIGHT		0x80
+
+/* Header of a saved RIB */
+struct rib_save_hdr {
+	uint32_t	nb_nodes;
+	uint32_t	nb_routes;
+	uint32_t	ext_sz;
+};
+
+/*
+ * Saved node, followed by its ext bytes. Nodes are saved in pre-order
+ * with flags telling which children follow, so that no pointer is saved.
+ */
+struct rib_node_rec {
+	uint64_t	nh;
+	uint32_t	ip;
+	uint8_t		depth;
+	uint8_t		flag;
+};
+
+static uint32_t
+get_ext_sz(struct rte_rib *rib)
+{
+	return rib->node_pool->elt_size - sizeof(struct rte_rib_node);
+}
+
+int
+rte_rib_save(struct rte_rib *rib, FILE *f)
+{
+	struct rte_rib_node *stack[RIB_MAXDEPTH + 2];
+	struct rte_rib_node *node;
+	struct rib_save_hdr hdr;
+	struct rib_node_rec rec;
+	uint32_t ext_sz;
+	unsigned int top = 0;
+
+	if ((rib == NULL) || (f == NULL))
+		return -EINVAL;
+
+	ext_sz = get_ext_sz(rib);
+	memset(&hdr, 0, sizeof(hdr));
+	hdr.nb_nodes = rib->cur_nodes;
+	hdr.nb_routes = rib->cur_routes;
+	hdr.ext_sz = ext_sz;
+	if (fwrite(&hdr, sizeof(hdr), 1, f) != 1)
+		return -EIO;
+
+	if (rib->tree != NULL)
+		stack[top++] = rib->tree;
+	while (top != 0) {
+		node = stack[--top];
+		memset(&rec, 0, sizeof(rec));
+		rec.nh = node->nh;
+		rec.ip = node->ip;
+		rec.depth = node->depth;
+		rec.flag = node->flag;
+		if (node->left != NULL)
+			rec.flag |= RIB_REC_LEFT;
+		if (node->right != NULL)
+			rec.flag |= RIB_REC_RIGHT;
+		if ((fwrite(&rec, sizeof(rec), 1, f) != 1) ||
+				((ext_sz != 0) &&
+				(fwrite(node->ext, ext_sz, 1, f) != 1)))
+			return -EIO;
+
+		/* the left subtree is saved first */
+		if (node->right != NULL)
+			stack[top++] = node->right;
+		if (node->left != NULL)
+			stack[top++] = node->left;
+	}
+
+	return 0;
+}
+
+/* Free all the nodes of a RIB, leaves first */
+static void
+free_nodes(struct rte_rib *rib)
+{
+	struct rte_rib_node *node = rib->tree;
+	struct rte_rib_node *parent;
+
+	while (node != NULL) {
+		if (node->left != NULL) {
+			node = node->left;
+			continue;
+		}
+		if (node->right != NULL) {
+			node = node->right;
+			continue;
+		}
+		parent = node->parent;
+		if (parent != NULL) {
+			if (parent->left == node)
+				parent->left = NULL;
+			else
+				parent->right = NULL;
+		}
+		node_free(rib, node);
+		node = parent;
+	}
+	rib->tree = NULL;
+	rib->cur_routes = 0;
+}
+
+static inline bool
+is_complete_node(struct rte_rib_node *node, uint8_t children)
+{
+	return (!(children & RIB_REC_LEFT) || (node->left != NULL)) &&
+		(!(children & RIB_REC_RIGHT) || (node->right != NULL));
+}
+
+int
+rte_rib_restore(struct rte_rib *rib, FILE *f)
+{
+	struct rte_rib_node *stack[RIB_MAXDEPTH + 2];
+	uint8_t children[RIB_MAXDEPTH + 2];
+	struct rte_rib_node *node, *parent;
+	struct rib_save_hdr hdr;
+	struct rib_node_rec rec;
+	unsigned int top = 0;
+	uint32_t i, ext_sz;
+	int ret = -EINVAL;
+
+	if ((rib == NULL) || (f == NULL))
+		return -EINVAL;
+	if (rib->tree != NULL)
+		return -EEXIST;
+
+	if (fread(&hdr, sizeof(hdr), 1, f) != 1)
+		return -EIO;
+	ext_sz = get_ext_sz(rib);
+	if (hdr.ext_sz != ext_sz)
+		return -EINVAL;
+	if (hdr.nb_nodes > (uint32_t)rib->max_nodes)
+		return -ENOSPC;
+
+	for (i = 0; i < hdr.nb_nodes; i++) {
+		if (fread(&rec, sizeof(rec), 1, f) != 1) {
+			ret = -EIO;
+			goto free;
+		}
+		node = node_alloc(rib);
+		if (node == NULL) {
+			ret = -ENOSPC;
+			goto free;
+		}
+		node->left = NULL;
+		node->right = NULL;
+		node->nh = rec.nh;
+		node->ip = rec.ip;
+		node->depth = rec.depth;
+		node->flag = rec.flag & RTE_RIB_VALID_NODE;
+		if ((ext_sz != 0) && (fread(node->ext, ext_sz, 1, f) != 1)) {
+			node->parent = NULL;
+			node_free(rib, node);
+			ret = -EIO;
+			goto free;
+		}
+
+		/* a node is the next child of the deepest incomplete node */
+		while ((top != 0) &&
+				is_complete_node(stack[top - 1], children[top - 1]))
+			top--;
+		if (top == 0) {
+			if (rib->tree != NULL) {
+				node->parent = NULL;
+				node_free(rib, node);
+				goto free;
+			}
+			node->parent = NULL;
+			rib->tree = node;
+		} else {
+			parent = stack[top - 1];
+			node->parent = parent;
+			if ((children[top - 1] & RIB_REC_LEFT) &&
+					(parent->left == NULL))
+				parent->left = node;
+			else
+				parent->right = node;
+		}
+
+		if (rec.flag & (RIB_REC_LEFT | RIB_REC_RIGHT)) {
+			if ((top == RTE_DIM(stack)) ||
+					(rec.depth >= RIB_MAXDEPTH))
+				goto free;
+			children[top] = rec.flag;
+			stack[top++] = node;
+		}
+	}
+
+	/* every announced child must have been read */
+	while (top != 0) {
+		top--;
+		if (!is_complete_node(stack[top], children[top]))
+			goto free;
+	}
+	rib->cur_routes = hdr.nb_routes;
+
+	return 0;
+
+free:
+	free_nodes(rib);
+	return ret;
+}
+
 struct rte_rib *
 rte_rib_create(const char *name, int socket_id, struct rte_rib_conf *conf)
 {
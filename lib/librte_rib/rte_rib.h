@@ -11,6 +11,8 @@
  * Level compressed tree implementation for IPv4 Longest Prefix Match
  */
 
+#include <stdio.h>
+
 #include <rte_compat.h>
 
 /**
@@ -274,4 +276,43 @@ __rte_experimental
 void
 rte_rib_free(struct rte_rib *rib);
 
+/**
+ * Save the routes of a RIB to a file.
+ *
+ * The nodes are written without their pointers, in an order allowing
+ * rte_rib_restore() to link them back in a single pass. The RIB must not
+ * be modified while it is saved.
+ *
+ * @param rib
+ *   RIB object handle
+ * @param f
+ *   File open for writing, the RIB is written at the current position
+ * @return
+ *   0 on success, -EINVAL if parameters are invalid, -EIO on write error
+ */
+__rte_experimental
+int
+rte_rib_save(struct rte_rib *rib, FILE *f);
+
+/**
+ * Restore the routes saved with rte_rib_save() into an empty RIB.
+ *
+ * The RIB must have been created with the same ext_sz as the saved one,
+ * and max_nodes large enough for its nodes.
+ *
+ * @param rib
+ *   RIB object handle
+ * @param f
+ *   File open for reading, positioned at the saved RIB
+ * @return
+ *   0 on success,
+ *   -EINVAL if parameters are invalid or the saved RIB is corrupted,
+ *   -EEXIST if the RIB is not empty,
+ *   -ENOSPC if the RIB has not enough nodes,
+ *   -EIO on read error
+ */
+__rte_experimental
+int
+rte_rib_restore(struct rte_rib *rib, FILE *f);
+
 #endif /* _RTE_RIB_H_ */
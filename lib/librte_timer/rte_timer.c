@@ -55,9 +55,34 @@ struct priv_timer {
 #endif
 } __rte_cache_aligned;
 
+#define TIMER_WHEEL_BITS 6
+#define TIMER_WHEEL_SLOTS (1 << TIMER_WHEEL_BITS)
+#define TIMER_WHEEL_MASK (TIMER_WHEEL_SLOTS - 1)
+#define TIMER_WHEEL_LEVELS 4
+/** number of ticks covered by the wheel, later timers are clamped */
+#define TIMER_WHEEL_RANGE (1ULL << (TIMER_WHEEL_BITS * TIMER_WHEEL_LEVELS))
+
+/**
+ * Per-lcore hierarchical timer wheel, replacing the skiplist in the timer
+ * data instances allocated with rte_timer_data_alloc_wheel().
+ *
+ * The slot lists are linked through sl_next[0], while sl_next[1] points
+ * to the previous link, so that a timer is removed in constant time.
+ * The level n slots are cascaded to the lower levels each time the
+ * level n - 1 wraps.
+ */
+struct timer_wheel {
+	uint64_t cur_tick;   /**< next tick to process */
+	uint32_t nb_pending; /**< number of timers in the wheel */
+	uint64_t slot_map[TIMER_WHEEL_LEVELS]; /**< bitmap of non-empty slots */
+	struct rte_timer *slots[TIMER_WHEEL_LEVELS][TIMER_WHEEL_SLOTS];
+} __rte_cache_aligned;
+
 #define FL_ALLOCATED	(1 << 0)
 struct rte_timer_data {
 	struct priv_timer priv_timer[RTE_MAX_LCORE];
+	struct timer_wheel *wheels; /**< per-lcore wheels, NULL for skiplists */
+	uint8_t wheel_shift;        /**< log2 of the wheel tick, in cycles */
 	uint8_t internal_flags;
 };
 
@@ -117,12 +142,54 @@ rte_timer_data_alloc(uint32_t *id_ptr)
 	return -ENOSPC;
 }
 
+int
+rte_timer_data_alloc_wheel(uint32_t *id_ptr, uint64_t resolution)
+{
+	struct rte_timer_data *data;
+	struct timer_wheel *wheels;
+	uint64_t cur_tick;
+	unsigned int lcore_id;
+	uint32_t id;
+	int ret;
+
+	if (!rte_timer_subsystem_initialized)
+		return -ENOMEM;
+
+	if (resolution == 0)
+		resolution = rte_get_timer_hz() / MS_PER_S;
+
+	wheels = rte_zmalloc("rte_timer_wheels",
+			sizeof(*wheels) * RTE_MAX_LCORE, RTE_CACHE_LINE_SIZE);
+	if (wheels == NULL)
+		return -ENOMEM;
+
+	ret = rte_timer_data_alloc(&id);
+	if (ret < 0) {
+		rte_free(wheels);
+		return ret;
+	}
+
+	data = &rte_timer_data_arr[id];
+	data->wheel_shift = rte_log2_u64(resolution);
+	cur_tick = rte_get_timer_cycles() >> data->wheel_shift;
+	for (lcore_id = 0; lcore_id < RTE_MAX_LCORE; lcore_id++)
+		wheels[lcore_id].cur_tick = cur_tick;
+	data->wheels = wheels;
+
+	if (id_ptr)
+		*id_ptr = id;
+
+	return 0;
+}
+
 int
 rte_timer_data_dealloc(uint32_t id)
 {
 	struct rte_timer_data *timer_data;
 	TIMER_DATA_VALID_GET_OR_ERR_RET(id, timer_data, -EINVAL);
 
+	rte_free(timer_data->wheels);
+	timer_data->wheels = NULL;
 	timer_data->internal_flags &= ~(FL_ALLOCATED);
 
 	return 0;
@@ -374,6 +441,131 @@ timer_get_prev_entries_for_node(struct rte_timer *tim, unsigned tim_lcore,
 	}
 }
 
+static inline struct rte_timer **
+timer_wheel_pprev(const struct rte_timer *tim)
+{
+	return (struct rte_timer **)(void *)tim->sl_next[1];
+}
+
+static inline void
+timer_wheel_set_pprev(struct rte_timer *tim, struct rte_timer **pprev)
+{
+	tim->sl_next[1] = (struct rte_timer *)(void *)pprev;
+}
+
+/*
+ * Link a timer in the wheel slot of its expiry tick. The level is given by
+ * the distance to the current tick, each level being 64 times coarser
+ * than the previous one.
+ */
+static void
+timer_wheel_insert(struct timer_wheel *wheel, struct rte_timer *tim,
+		   unsigned int shift)
+{
+	uint64_t tick, delta;
+	unsigned int lvl, idx;
+	struct rte_timer **head;
+
+	/* round up, so that the timer never expires early */
+	tick = (tim->expire >> shift) +
+		((tim->expire & ((1ULL << shift) - 1)) != 0);
+	if (tick < wheel->cur_tick)
+		tick = wheel->cur_tick;
+	delta = tick - wheel->cur_tick;
+	if (delta >= TIMER_WHEEL_RANGE) {
+		/* the timer is inserted again when its slot is cascaded */
+		delta = TIMER_WHEEL_RANGE - 1;
+		tick = wheel->cur_tick + delta;
+	}
+
+	lvl = delta < TIMER_WHEEL_SLOTS ? 0 :
+		(rte_fls_u64(delta) - 1) / TIMER_WHEEL_BITS;
+	idx = (tick >> (lvl * TIMER_WHEEL_BITS)) & TIMER_WHEEL_MASK;
+
+	head = &wheel->slots[lvl][idx];
+	tim->sl_next[0] = *head;
+	if (*head != NULL)
+		timer_wheel_set_pprev(*head, &tim->sl_next[0]);
+	timer_wheel_set_pprev(tim, head);
+	*head = tim;
+	wheel->slot_map[lvl] |= 1ULL << idx;
+}
+
+/* Unlink a timer from its wheel slot, a NULL pprev marking it unlinked. */
+static void
+timer_wheel_unlink(struct timer_wheel *wheel, struct rte_timer *tim)
+{
+	struct rte_timer **pprev = timer_wheel_pprev(tim);
+	struct rte_timer *next = tim->sl_next[0];
+	uintptr_t off;
+
+	timer_wheel_set_pprev(tim, NULL);
+	*pprev = next;
+	if (next != NULL) {
+		timer_wheel_set_pprev(next, pprev);
+		return;
+	}
+
+	/* the timer was alone in its slot: clear the slot bit */
+	off = (uintptr_t)pprev - (uintptr_t)wheel->slots;
+	if (off < sizeof(wheel->slots)) {
+		off /= sizeof(wheel->slots[0][0]);
+		wheel->slot_map[off / TIMER_WHEEL_SLOTS] &=
+			~(1ULL << (off % TIMER_WHEEL_SLOTS));
+	}
+}
+
+/* call with lock held as necessary
+ * timer must be in config state
+ * timer must not be in a wheel
+ */
+static void
+timer_wheel_add(struct timer_wheel *wheel, struct rte_timer *tim,
+		unsigned int shift)
+{
+	uint64_t cur_tick;
+
+	/* the manage functions don't process the ticks of an empty wheel,
+	 * catch up before adding the first timer
+	 */
+	if (wheel->nb_pending == 0) {
+		cur_tick = rte_get_timer_cycles() >> shift;
+		if (cur_tick > wheel->cur_tick)
+			wheel->cur_tick = cur_tick;
+	}
+
+	timer_wheel_insert(wheel, tim, shift);
+	wheel->nb_pending++;
+}
+
+/*
+ * Move the timers of the upper level slots ending at the current tick to
+ * the lower levels. Called when the level 0 wraps.
+ */
+static void
+timer_wheel_cascade(struct timer_wheel *wheel, unsigned int shift)
+{
+	struct rte_timer *tim, *next_tim;
+	unsigned int lvl, idx;
+
+	for (lvl = 1; lvl < TIMER_WHEEL_LEVELS; lvl++) {
+		idx = (wheel->cur_tick >> (lvl * TIMER_WHEEL_BITS)) &
+			TIMER_WHEEL_MASK;
+		if (wheel->slot_map[lvl] & (1ULL << idx)) {
+			tim = wheel->slots[lvl][idx];
+			wheel->slots[lvl][idx] = NULL;
+			wheel->slot_map[lvl] &= ~(1ULL << idx);
+			for ( ; tim != NULL; tim = next_tim) {
+				next_tim = tim->sl_next[0];
+				timer_wheel_insert(wheel, tim, shift);
+			}
+		}
+		/* the next level wraps too */
+		if (idx != 0)
+			break;
+	}
+}
+
 /* call with lock held as necessary
  * add in list
  * timer must be in config state
@@ -381,10 +573,17 @@ timer_get_prev_entries_for_node(struct rte_timer *tim, unsigned tim_lcore,
  */
 static void
 timer_add(struct rte_timer *tim, unsigned int tim_lcore,
-	  struct priv_timer *priv_timer)
+	  struct rte_timer_data *timer_data)
 {
 	unsigned lvl;
 	struct rte_timer *prev[MAX_SKIPLIST_DEPTH+1];
+	struct priv_timer *priv_timer = timer_data->priv_timer;
+
+	if (timer_data->wheels != NULL) {
+		timer_wheel_add(&timer_data->wheels[tim_lcore], tim,
+				timer_data->wheel_shift);
+		return;
+	}
 
 	/* find where exactly this element goes in the list of elements
 	 * for each depth. */
@@ -412,25 +611,17 @@ timer_add(struct rte_timer *tim, unsigned int tim_lcore,
 }
 
 /*
- * del from list, lock if needed
+ * del from skiplist, call with lock held
  * timer must be in config state
  * timer must be in a list
  */
 static void
-timer_del(struct rte_timer *tim, union rte_timer_status prev_status,
-	  int local_is_locked, struct priv_timer *priv_timer)
+timer_list_del(struct rte_timer *tim, unsigned int prev_owner,
+	       struct priv_timer *priv_timer)
 {
-	unsigned lcore_id = rte_lcore_id();
-	unsigned prev_owner = prev_status.owner;
 	int i;
 	struct rte_timer *prev[MAX_SKIPLIST_DEPTH+1];
 
-	/* if timer needs is pending another core, we need to lock the
-	 * list; if it is on local core, we need to lock if we are not
-	 * called from rte_timer_manage() */
-	if (prev_owner != lcore_id || !local_is_locked)
-		rte_spinlock_lock(&priv_timer[prev_owner].list_lock);
-
 	/* save the lowest list entry into the expire field of the dummy hdr.
 	 * NOTE: this is not atomic on 32-bit */
 	if (tim == priv_timer[prev_owner].pending_head.sl_next[0])
@@ -450,6 +641,39 @@ timer_del(struct rte_timer *tim, union rte_timer_status prev_status,
 			priv_timer[prev_owner].curr_skiplist_depth --;
 		else
 			break;
+}
+
+/*
+ * del from list, lock if needed
+ * timer must be in config state
+ * timer must be in a list
+ */
+static void
+timer_del(struct rte_timer *tim, union rte_timer_status prev_status,
+	  int local_is_locked, struct rte_timer_data *timer_data)
+{
+	unsigned lcore_id = rte_lcore_id();
+	unsigned prev_owner = prev_status.owner;
+	struct priv_timer *priv_timer = timer_data->priv_timer;
+	struct timer_wheel *wheel;
+
+	/* if timer needs is pending another core, we need to lock the
+	 * list; if it is on local core, we need to lock if we are not
+	 * called from rte_timer_manage() */
+	if (prev_owner != lcore_id || !local_is_locked)
+		rte_spinlock_lock(&priv_timer[prev_owner].list_lock);
+
+	if (timer_data->wheels != NULL) {
+		/* a periodical timer reloaded by the manage function is
+		 * pending but was already taken out of the wheel
+		 */
+		if (timer_wheel_pprev(tim) != NULL) {
+			wheel = &timer_data->wheels[prev_owner];
+			timer_wheel_unlink(wheel, tim);
+			wheel->nb_pending--;
+		}
+	} else
+		timer_list_del(tim, prev_owner, priv_timer);
 
 	if (prev_owner != lcore_id || !local_is_locked)
 		rte_spinlock_unlock(&priv_timer[prev_owner].list_lock);
@@ -496,7 +720,7 @@ __rte_timer_reset(struct rte_timer *tim, uint64_t expire,
 
 	/* remove it from list */
 	if (prev_status.state == RTE_TIMER_PENDING) {
-		timer_del(tim, prev_status, local_is_locked, priv_timer);
+		timer_del(tim, prev_status, local_is_locked, timer_data);
 		__TIMER_STAT_ADD(priv_timer, pending, -1);
 	}
 
@@ -513,7 +737,7 @@ __rte_timer_reset(struct rte_timer *tim, uint64_t expire,
 		rte_spinlock_lock(&priv_timer[tim_lcore].list_lock);
 
 	__TIMER_STAT_ADD(priv_timer, pending, 1);
-	timer_add(tim, tim_lcore, priv_timer);
+	timer_add(tim, tim_lcore, timer_data);
 
 	/* update state: as we are in CONFIG state, only us can modify
 	 * the state so we don't need to use cmpset() here */
@@ -592,7 +816,7 @@ __rte_timer_stop(struct rte_timer *tim, int local_is_locked,
 
 	/* remove it from list */
 	if (prev_status.state == RTE_TIMER_PENDING) {
-		timer_del(tim, prev_status, local_is_locked, priv_timer);
+		timer_del(tim, prev_status, local_is_locked, timer_data);
 		__TIMER_STAT_ADD(priv_timer, pending, -1);
 	}
 
@@ -637,85 +861,201 @@ rte_timer_pending(struct rte_timer *tim)
 	return tim->status.state == RTE_TIMER_PENDING;
 }
 
-/* must be called periodically, run all timer that expired */
+/*
+ * Mark the timers of an expired list as running, removing the ones being
+ * reconfigured by another core. Call with lock held.
+ */
 static void
-__rte_timer_manage(struct rte_timer_data *timer_data)
+timer_set_list_running(struct rte_timer **run_first_tim)
 {
-	union rte_timer_status status;
-	struct rte_timer *tim, *next_tim;
-	struct rte_timer *run_first_tim, **pprev;
-	unsigned lcore_id = rte_lcore_id();
+	struct rte_timer *tim, *next_tim, **pprev;
+	int ret;
+
+	pprev = run_first_tim;
+
+	for (tim = *run_first_tim; tim != NULL; tim = next_tim) {
+		next_tim = tim->sl_next[0];
+
+		ret = timer_set_running_state(tim);
+		if (likely(ret == 0)) {
+			pprev = &tim->sl_next[0];
+		} else {
+			/* another core is trying to re-config this one,
+			 * remove it from local expired list
+			 */
+			*pprev = next_tim;
+		}
+	}
+}
+
+/*
+ * Break the skiplist of an lcore at current time point, and return the
+ * expired timers, marked as running.
+ */
+static struct rte_timer *
+timer_list_collect(struct priv_timer *priv_timer, unsigned int lcore_id)
+{
+	struct rte_timer *run_first_tim;
 	struct rte_timer *prev[MAX_SKIPLIST_DEPTH + 1];
+	struct priv_timer *privp = &priv_timer[lcore_id];
 	uint64_t cur_time;
-	int i, ret;
-	struct priv_timer *priv_timer = timer_data->priv_timer;
-
-	/* timer manager only runs on EAL thread with valid lcore_id */
-	assert(lcore_id < RTE_MAX_LCORE);
+	int i;
 
-	__TIMER_STAT_ADD(priv_timer, manage, 1);
 	/* optimize for the case where per-cpu list is empty */
-	if (priv_timer[lcore_id].pending_head.sl_next[0] == NULL)
-		return;
+	if (privp->pending_head.sl_next[0] == NULL)
+		return NULL;
 	cur_time = rte_get_timer_cycles();
 
 #ifdef RTE_ARCH_64
 	/* on 64-bit the value cached in the pending_head.expired will be
 	 * updated atomically, so we can consult that for a quick check here
 	 * outside the lock */
-	if (likely(priv_timer[lcore_id].pending_head.expire > cur_time))
-		return;
+	if (likely(privp->pending_head.expire > cur_time))
+		return NULL;
 #endif
 
 	/* browse ordered list, add expired timers in 'expired' list */
-	rte_spinlock_lock(&priv_timer[lcore_id].list_lock);
+	rte_spinlock_lock(&privp->list_lock);
 
 	/* if nothing to do just unlock and return */
-	if (priv_timer[lcore_id].pending_head.sl_next[0] == NULL ||
-	    priv_timer[lcore_id].pending_head.sl_next[0]->expire > cur_time) {
-		rte_spinlock_unlock(&priv_timer[lcore_id].list_lock);
-		return;
+	if (privp->pending_head.sl_next[0] == NULL ||
+	    privp->pending_head.sl_next[0]->expire > cur_time) {
+		rte_spinlock_unlock(&privp->list_lock);
+		return NULL;
 	}
 
 	/* save start of list of expired timers */
-	tim = priv_timer[lcore_id].pending_head.sl_next[0];
+	run_first_tim = privp->pending_head.sl_next[0];
 
 	/* break the existing list at current time point */
 	timer_get_prev_entries(cur_time, lcore_id, prev, priv_timer);
-	for (i = priv_timer[lcore_id].curr_skiplist_depth -1; i >= 0; i--) {
-		if (prev[i] == &priv_timer[lcore_id].pending_head)
+	for (i = privp->curr_skiplist_depth - 1; i >= 0; i--) {
+		if (prev[i] == &privp->pending_head)
 			continue;
-		priv_timer[lcore_id].pending_head.sl_next[i] =
-		    prev[i]->sl_next[i];
+		privp->pending_head.sl_next[i] = prev[i]->sl_next[i];
 		if (prev[i]->sl_next[i] == NULL)
-			priv_timer[lcore_id].curr_skiplist_depth--;
-		prev[i] ->sl_next[i] = NULL;
+			privp->curr_skiplist_depth--;
+		prev[i]->sl_next[i] = NULL;
 	}
 
 	/* transition run-list from PENDING to RUNNING */
-	run_first_tim = tim;
+	timer_set_list_running(&run_first_tim);
+
+	/* update the next to expire timer value */
+	privp->pending_head.expire =
+	    (privp->pending_head.sl_next[0] == NULL) ? 0 :
+		privp->pending_head.sl_next[0]->expire;
+
+	rte_spinlock_unlock(&privp->list_lock);
+
+	return run_first_tim;
+}
+
+/*
+ * Advance the wheel of an lcore up to the current tick, and return the
+ * expired timers, marked as running. All the ticks elapsed since the
+ * previous call are processed under a single lock.
+ */
+static struct rte_timer *
+timer_wheel_collect(struct rte_timer_data *timer_data, unsigned int lcore_id)
+{
+	struct timer_wheel *wheel = &timer_data->wheels[lcore_id];
+	struct priv_timer *privp = &timer_data->priv_timer[lcore_id];
+	struct rte_timer *tim, *next_tim, *run_first_tim, **pprev;
+	uint64_t cur_tick, next_tick, map;
+	unsigned int idx;
+
+	/* optimize for the case where the wheel is empty */
+	if (wheel->nb_pending == 0)
+		return NULL;
+	cur_tick = rte_get_timer_cycles() >> timer_data->wheel_shift;
+
+#ifdef RTE_ARCH_64
+	/* on 64-bit the current tick of the wheel is updated atomically,
+	 * so we can check outside the lock whether a tick elapsed
+	 */
+	if (likely(wheel->cur_tick > cur_tick))
+		return NULL;
+#endif
+
+	run_first_tim = NULL;
 	pprev = &run_first_tim;
 
-	for ( ; tim != NULL; tim = next_tim) {
-		next_tim = tim->sl_next[0];
+	rte_spinlock_lock(&privp->list_lock);
 
-		ret = timer_set_running_state(tim);
-		if (likely(ret == 0)) {
-			pprev = &tim->sl_next[0];
-		} else {
-			/* another core is trying to re-config this one,
-			 * remove it from local expired list
-			 */
-			*pprev = next_tim;
+	while (wheel->cur_tick <= cur_tick) {
+		if (wheel->nb_pending == 0) {
+			wheel->cur_tick = cur_tick + 1;
+			break;
 		}
+
+		idx = wheel->cur_tick & TIMER_WHEEL_MASK;
+		if (idx == 0)
+			timer_wheel_cascade(wheel, timer_data->wheel_shift);
+
+		/* detach the slot and transition its timers from PENDING to
+		 * RUNNING; the ones being re-configured by another core are
+		 * put back, that core removes them
+		 */
+		*pprev = wheel->slots[0][idx];
+		wheel->slots[0][idx] = NULL;
+		wheel->slot_map[0] &= ~(1ULL << idx);
+		for (tim = *pprev; tim != NULL; tim = next_tim) {
+			next_tim = tim->sl_next[0];
+			if (likely(timer_set_running_state(tim) == 0)) {
+				wheel->nb_pending--;
+				timer_wheel_set_pprev(tim, NULL);
+				pprev = &tim->sl_next[0];
+			} else {
+				*pprev = next_tim;
+				timer_wheel_insert(wheel, tim,
+						   timer_data->wheel_shift);
+			}
+		}
+
+		/* skip the empty slots, up to the next cascade */
+		map = wheel->slot_map[0] >> idx >> 1;
+		if (map == 0)
+			next_tick = (wheel->cur_tick | TIMER_WHEEL_MASK) + 1;
+		else
+			next_tick = wheel->cur_tick + rte_bsf64(map) + 1;
+		wheel->cur_tick = RTE_MIN(next_tick, cur_tick + 1);
 	}
+	*pprev = NULL;
 
-	/* update the next to expire timer value */
-	priv_timer[lcore_id].pending_head.expire =
-	    (priv_timer[lcore_id].pending_head.sl_next[0] == NULL) ? 0 :
-		priv_timer[lcore_id].pending_head.sl_next[0]->expire;
+	rte_spinlock_unlock(&privp->list_lock);
 
-	rte_spinlock_unlock(&priv_timer[lcore_id].list_lock);
+	return run_first_tim;
+}
+
+/* return the expired timers of an lcore, marked as running */
+static struct rte_timer *
+timer_collect(struct rte_timer_data *timer_data, unsigned int lcore_id)
+{
+	if (timer_data->wheels != NULL)
+		return timer_wheel_collect(timer_data, lcore_id);
+
+	return timer_list_collect(timer_data->priv_timer, lcore_id);
+}
+
+/* must be called periodically, run all timer that expired */
+static void
+__rte_timer_manage(struct rte_timer_data *timer_data)
+{
+	union rte_timer_status status;
+	struct rte_timer *tim, *next_tim;
+	struct rte_timer *run_first_tim;
+	unsigned lcore_id = rte_lcore_id();
+	struct priv_timer *priv_timer = timer_data->priv_timer;
+
+	/* timer manager only runs on EAL thread with valid lcore_id */
+	assert(lcore_id < RTE_MAX_LCORE);
+
+	__TIMER_STAT_ADD(priv_timer, manage, 1);
+
+	run_first_tim = timer_collect(timer_data, lcore_id);
+	if (run_first_tim == NULL)
+		return;
 
 	/* now scan expired list and call callbacks */
 	for (tim = run_first_tim; tim != NULL; tim = next_tim) {
@@ -776,15 +1116,12 @@ rte_timer_alt_manage(uint32_t timer_data_id,
 {
 	unsigned int default_poll_lcores[] = {rte_lcore_id()};
 	union rte_timer_status status;
-	struct rte_timer *tim, *next_tim, **pprev;
+	struct rte_timer *tim;
 	struct rte_timer *run_first_tims[RTE_MAX_LCORE];
 	unsigned int this_lcore = rte_lcore_id();
-	struct rte_timer *prev[MAX_SKIPLIST_DEPTH + 1];
-	uint64_t cur_time;
-	int i, j, ret;
+	int i;
 	int nb_runlists = 0;
 	struct rte_timer_data *data;
-	struct priv_timer *privp;
 	uint32_t poll_lcore;
 
 	TIMER_DATA_VALID_GET_OR_ERR_RET(timer_data_id, data, -EINVAL);
@@ -801,74 +1138,10 @@ rte_timer_alt_manage(uint32_t timer_data_id,
 
 	for (i = 0; i < nb_poll_lcores; i++) {
 		poll_lcore = poll_lcores[i];
-		privp = &data->priv_timer[poll_lcore];
-
-		/* optimize for the case where per-cpu list is empty */
-		if (privp->pending_head.sl_next[0] == NULL)
-			continue;
-		cur_time = rte_get_timer_cycles();
-
-#ifdef RTE_ARCH_64
-		/* on 64-bit the value cached in the pending_head.expired will
-		 * be updated atomically, so we can consult that for a quick
-		 * check here outside the lock
-		 */
-		if (likely(privp->pending_head.expire > cur_time))
-			continue;
-#endif
-
-		/* browse ordered list, add expired timers in 'expired' list */
-		rte_spinlock_lock(&privp->list_lock);
 
-		/* if nothing to do just unlock and return */
-		if (privp->pending_head.sl_next[0] == NULL ||
-		    privp->pending_head.sl_next[0]->expire > cur_time) {
-			rte_spinlock_unlock(&privp->list_lock);
-			continue;
-		}
-
-		/* save start of list of expired timers */
-		tim = privp->pending_head.sl_next[0];
-
-		/* break the existing list at current time point */
-		timer_get_prev_entries(cur_time, poll_lcore, prev,
-				       data->priv_timer);
-		for (j = privp->curr_skiplist_depth - 1; j >= 0; j--) {
-			if (prev[j] == &privp->pending_head)
-				continue;
-			privp->pending_head.sl_next[j] =
-				prev[j]->sl_next[j];
-			if (prev[j]->sl_next[j] == NULL)
-				privp->curr_skiplist_depth--;
-
-			prev[j]->sl_next[j] = NULL;
-		}
-
-		/* transition run-list from PENDING to RUNNING */
-		run_first_tims[nb_runlists] = tim;
-		pprev = &run_first_tims[nb_runlists];
-		nb_runlists++;
-
-		for ( ; tim != NULL; tim = next_tim) {
-			next_tim = tim->sl_next[0];
-
-			ret = timer_set_running_state(tim);
-			if (likely(ret == 0)) {
-				pprev = &tim->sl_next[0];
-			} else {
-				/* another core is trying to re-config this one,
-				 * remove it from local expired list
-				 */
-				*pprev = next_tim;
-			}
-		}
-
-		/* update the next to expire timer value */
-		privp->pending_head.expire =
-		    (privp->pending_head.sl_next[0] == NULL) ? 0 :
-			privp->pending_head.sl_next[0]->expire;
-
-		rte_spinlock_unlock(&privp->list_lock);
+		tim = timer_collect(data, poll_lcore);
+		if (tim != NULL)
+			run_first_tims[nb_runlists++] = tim;
 	}
 
 	/* Now process the run lists */
@@ -940,6 +1213,31 @@ rte_timer_alt_manage(uint32_t timer_data_id,
 	return 0;
 }
 
+/* Walk the wheel slots of an lcore, stopping timers. Call with lock held. */
+static void
+timer_wheel_stop_all(struct rte_timer_data *timer_data, unsigned int lcore_id,
+		     rte_timer_stop_all_cb_t f, void *f_arg)
+{
+	struct timer_wheel *wheel = &timer_data->wheels[lcore_id];
+	struct rte_timer *tim, *next_tim;
+	unsigned int lvl, idx;
+
+	for (lvl = 0; lvl < TIMER_WHEEL_LEVELS; lvl++) {
+		for (idx = 0; idx < TIMER_WHEEL_SLOTS; idx++) {
+			for (tim = wheel->slots[lvl][idx];
+			     tim != NULL;
+			     tim = next_tim) {
+				next_tim = tim->sl_next[0];
+
+				__rte_timer_stop(tim, 1, timer_data);
+
+				if (f)
+					f(tim, f_arg);
+			}
+		}
+	}
+}
+
 /* Walk pending lists, stopping timers and calling user-specified function */
 int
 rte_timer_stop_all(uint32_t timer_data_id, unsigned int *walk_lcores,
@@ -960,6 +1258,12 @@ rte_timer_stop_all(uint32_t timer_data_id, unsigned int *walk_lcores,
 
 		rte_spinlock_lock(&priv_timer->list_lock);
 
+		if (timer_data->wheels != NULL) {
+			timer_wheel_stop_all(timer_data, walk_lcore, f, f_arg);
+			rte_spinlock_unlock(&priv_timer->list_lock);
+			continue;
+		}
+
 		for (tim = priv_timer->pending_head.sl_next[0];
 		     tim != NULL;
 		     tim = next_tim) {
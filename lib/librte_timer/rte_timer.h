@@ -150,6 +150,34 @@ struct rte_timer
 __rte_experimental
 int rte_timer_data_alloc(uint32_t *id_ptr);
 
+/**
+ * @warning
+ * @b EXPERIMENTAL: this API may change without prior notice
+ *
+ * Allocate a timer data instance keeping the pending timers in per-lcore
+ * hierarchical timer wheels instead of skiplists.
+ *
+ * The timers of this instance are added, stopped and expired in constant
+ * time, through the rte_timer_alt_*() functions. The expiry time of a timer
+ * is rounded up to the wheel resolution, so the timer may expire up to one
+ * resolution late. The wheels cover 2^24 ticks; the timers expiring later
+ * are kept in the wheel and re-examined until they get in range.
+ *
+ * @param id_ptr
+ *   Pointer to variable into which to write the identifier of the allocated
+ *   timer data instance.
+ * @param resolution
+ *   Duration of a wheel tick, in timer cycles, rounded up to a power of 2.
+ *   0 selects about one millisecond.
+ *
+ * @return
+ *   - 0: Success
+ *   - -ENOSPC: maximum number of timer data instances already allocated
+ *   - -ENOMEM: unable to allocate the wheels
+ */
+__rte_experimental
+int rte_timer_data_alloc_wheel(uint32_t *id_ptr, uint64_t resolution);
+
 /**
  * @warning
  * @b EXPERIMENTAL: this API may change without prior notice